@@ -55,6 +55,7 @@
 #include "nitf/List.hpp"
 #include "nitf/LookupTable.hpp"
 #include "nitf/MemoryIO.hpp"
+#include "nitf/MMapIO.hpp"
 #include "nitf/NITFException.hpp"
 #include "nitf/Object.hpp"
 #include "nitf/Pair.hpp"
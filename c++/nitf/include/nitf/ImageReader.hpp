@@ -59,6 +59,8 @@ public:
 
     /*!
      *  Read a sub-window.  See ImageIO::read for more details.
+     *  Several threads may read from the same ImageReader at once,
+     *  each with its own sub-window and buffers.
      *  \param  subWindow  The sub-window to read
      *  \param  user  User-defined data buffers for read
      *  \param  padded  Returns TRUE if pad pixels may have been read
@@ -66,9 +68,59 @@ public:
     void read(nitf::SubWindow & subWindow, nitf::Uint8 ** user, int * padded)
         throw (nitf::NITFException);
 
+    /*!
+     *  Read a sub-window of a reduced resolution level.  Each level
+     *  halves the rows and columns of the image and the sub-window is
+     *  in level coordinates.  Level 0 is the same as read.
+     *  \param  level  The resolution level
+     *  \param  subWindow  The sub-window to read
+     *  \param  user  User-defined data buffers for read
+     *  \param  padded  Returns TRUE if pad pixels may have been read
+     */
+    void readLevel(nitf::Uint32 level, nitf::SubWindow & subWindow,
+                   nitf::Uint8 ** user, int * padded)
+        throw (nitf::NITFException);
+
     //!  Set read caching
     void setReadCaching();
 
+    /*!
+     *  Enable read caching with a budget of maxBytes of decoded blocks.
+     *  The least recently used blocks are released when it is exceeded.
+     */
+    void setReadCacheSize(size_t maxBytes);
+
+    //!  Get the number of block requests satisfied from the read cache
+    nitf::Uint64 getReadCacheHits();
+
+    //!  Get the number of block requests that missed the read cache
+    nitf::Uint64 getReadCacheMisses();
+
+    /*!
+     *  Decode the blocks touched by each read with up to numThreads
+     *  threads when the decompression plugin supports it
+     */
+    void setDecodeThreads(nitf::Uint32 numThreads);
+
+    /*!
+     *  Fetch the blocks of the expected next strip on a background thread
+     *  after each read. mode is one of the NITF_READ_AHEAD_* modes. The
+     *  IO of the last read must stay open until the next read, until
+     *  read-ahead is turned off or until the reader is destroyed.
+     */
+    void setReadAhead(int mode);
+
+    /*!
+     *  Get a pointer to a block inside the memory mapping of a reader
+     *  opened on an MMapIO, without copying it.  The pointer remains valid
+     *  until the IO is closed.  See nitf_ImageReader_borrowBlock.
+     *  \param  blockNumber  The block to borrow
+     *  \param  blockSize  Returns the size of the block in bytes
+     */
+    const nitf::Uint8* borrowBlock(nitf::Uint32 blockNumber,
+                                   nitf::Uint64& blockSize)
+        throw (nitf::NITFException);
+
 private:
     nitf_Error error;
     ImageReader() throw(nitf::NITFException){}
@@ -68,6 +68,20 @@ public:
     //! Enable/disable cached writes
     void setWriteCaching(int enable);
 
+    /*!
+     *  Set the number of rows read from the sources and written at a time
+     *  (see nitf_ImageWriter_setRowsPerStrip).  0 selects one block row.
+     *  \return The previous setting
+     */
+    nitf::Uint32 setRowsPerStrip(nitf::Uint32 numRows);
+
+    /*!
+     *  Read, format and write strips in parallel (see
+     *  nitf_ImageWriter_setPipelining)
+     *  \return The previous setting
+     */
+    int setPipelining(int enable);
+
     /*!
      *  Function allows the user access to the product's pad pixels.
      *  For example, if you wanted transparent pixels for fill, you would
@@ -75,6 +89,32 @@ public:
      */
     void setPadPixel(nitf::Uint8* value, nitf::Uint32 length);
 
+    /*!
+     *  Leave blocks of only pad pixels out of the file, changing an "NC"
+     *  image to "NM" (see nitf_ImageWriter_enablePadBlockOmission).  Must
+     *  be called before the Writer writes the file.
+     */
+    void enablePadBlockOmission();
+
+    /*!
+     *  Write the image a block at a time with writeBlock instead of from
+     *  an image source (see nitf_ImageWriter_enableBlockWrites).  Must be
+     *  called before the Writer writes the file.
+     */
+    void enableBlockWrites();
+
+    /*!
+     *  Write one band of one block, after the Writer has written the file.
+     *  May be called from several threads at once.
+     */
+    void writeBlock(nitf::Uint32 blockRow, nitf::Uint32 blockCol,
+                    nitf::Uint32 band, const nitf::Uint8* data);
+
+    /*!
+     *  Finish block writes, throws if some blocks were not complete
+     */
+    void blockWritesDone();
+
 private:
     nitf_Error error;
 //    bool mAdopt;
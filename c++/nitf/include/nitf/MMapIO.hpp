@@ -0,0 +1,61 @@
+/* =========================================================================
+ * This file is part of NITRO
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2010, General Dynamics - Advanced Information Systems
+ *
+ * NITRO is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __NITF_MMAP_IO_HPP__
+#define __NITF_MMAP_IO_HPP__
+
+#include <string>
+
+#include "nitf/NITFException.hpp"
+#include "nitf/System.hpp"
+#include "nitf/IOInterface.hpp"
+
+/*!
+ * \file MMapIO.hpp
+ * \brief Contains wrapper implementation for MMapAdapter
+ */
+
+namespace nitf
+{
+
+/*!
+ *  \class MMapIO
+ *  \brief The C++ wrapper of the nitf_MMapAdapter
+ *
+ *  Opens a file read-only and maps it into memory.  Readers created on
+ *  it copy pixel data straight out of the mapping, and
+ *  ImageReader::borrowBlock can hand out pointers into it.
+ */
+class DLL_PUBLIC_CLASS MMapIO : public IOInterface
+{
+public:
+    MMapIO(const std::string& fname) throw (nitf::NITFException);
+
+    MMapIO(const char* fname) throw (nitf::NITFException);
+
+private:
+    static
+    nitf_IOInterface* open(const char* fname) throw (nitf::NITFException);
+};
+
+}
+#endif
@@ -31,6 +31,7 @@
 #include "nitf/SegmentReader.hpp"
 #include "nitf/Object.hpp"
 #include <string>
+#include <vector>
 
 /*!
  *  \file Reader.hpp
@@ -48,6 +49,48 @@ struct DLL_PUBLIC_CLASS ReaderDestructor : public nitf::MemoryDestructor<nitf_Re
     void operator()(nitf_Reader *reader);
 };
 
+//! The kinds of segment that follow the file header
+typedef nitf_SegmentType SegmentType;
+
+class Reader;
+
+/*!
+ *  \class ScanHandler
+ *  \brief  Receives the files read by Reader::scanFiles
+ *
+ *  The methods are called from several threads at once.  Exceptions
+ *  thrown by them are dropped.
+ */
+class DLL_PUBLIC_CLASS ScanHandler
+{
+public:
+    virtual ~ScanHandler()
+    {
+    }
+
+    /*!
+     *  Called with the index-only record of each file that was read.
+     *  The reader and record are destroyed once this returns.
+     *  \param index    The index of the file in the list
+     *  \param fileName The name of the file
+     *  \param reader   The reader, for loading subheaders
+     *  \param record   The index-only record
+     */
+    virtual void onFile(size_t index, const std::string& fileName,
+                        nitf::Reader& reader, nitf::Record& record) = 0;
+
+    /*!
+     *  Called for each file that could not be read
+     *  \param index    The index of the file in the list
+     *  \param fileName The name of the file
+     *  \param ex       What went wrong
+     */
+    virtual void onError(size_t index, const std::string& fileName,
+                         const nitf::NITFException& ex)
+    {
+    }
+};
+
 /*!
  *  \class Reader
  *  \brief  The C++ wrapper for the nitf_Reader
@@ -90,6 +133,42 @@ public:
      */
     nitf::Record readIO(nitf::IOInterface & io) throw (nitf::NITFException);
 
+    /*!
+     *  Read only the file header and the location of each segment
+     *  \see nitf_Reader_readIndex
+     *  \param io  The IO handle
+     *  \return  An index-only Record
+     */
+    nitf::Record readIndex(nitf::IOHandle & io) throw (nitf::NITFException);
+
+    /*!
+     *  Read only the file header and the location of each segment
+     *  \see nitf_Reader_readIndexIO
+     *  \param io  The IO interface
+     *  \return  An index-only Record
+     */
+    nitf::Record readIndexIO(nitf::IOInterface & io)
+        throw (nitf::NITFException);
+
+    /*!
+     *  Read the subheader of a segment of an index-only Record
+     *  \param type  The type of the segment
+     *  \param index The index of the segment among those of its type
+     */
+    void loadSubheader(nitf::SegmentType type, nitf::Uint32 index)
+        throw (nitf::NITFException);
+
+    /*!
+     *  Read the index of each file in a list using several threads
+     *  \see nitf_Reader_scanFiles
+     *  \param fileNames  The files to scan
+     *  \param numThreads The number of threads to use
+     *  \param handler    Receives each file
+     */
+    static void scanFiles(const std::vector<std::string>& fileNames,
+                          size_t numThreads, nitf::ScanHandler& handler)
+        throw (nitf::NITFException);
+
     /*!
      *  Get a new image reader for the segment
      *  \param imageSegmentNumber  The image segment number
@@ -122,6 +201,20 @@ public:
     nitf::SegmentReader newTextReader(int segmentNumber)
         throw (nitf::NITFException);
 
+    /*!
+     *  Defer TRE parsing until the first access of each TRE
+     *  \see nitf_Reader_setLazyTREs
+     *  \param lazy  true to defer TRE parsing
+     */
+    void setLazyTREs(bool lazy);
+
+    /*!
+     *  Parse each record into its own arena
+     *  \see nitf_Reader_setUseArena
+     *  \param use  true to parse into an arena
+     */
+    void setUseArena(bool use);
+
     //! Get the warningList
     nitf::List getWarningList() const;
 
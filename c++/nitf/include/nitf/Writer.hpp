@@ -74,6 +74,12 @@ public:
     //! Write the record to disk
     void write();
 
+    /*!
+     *  Write the record strictly in order, for an output that cannot seek
+     *  (see nitf_Writer_writeStreamed)
+     */
+    void writeStreamed();
+
     /*!
      *  Prepare the writer
      *  \param io  The IO handle to use
@@ -51,12 +51,65 @@ nitf::BlockingInfo ImageReader::getBlockingInfo() throw (nitf::NITFException)
 
 void ImageReader::read(nitf::SubWindow & subWindow, nitf::Uint8 ** user, int * padded) throw (nitf::NITFException)
 {
-    NITF_BOOL x = nitf_ImageReader_read(getNativeOrThrow(), subWindow.getNative(), user, padded, &error);
+    // Use a local error so concurrent reads do not share it
+    nitf_Error readError;
+    NITF_BOOL x = nitf_ImageReader_read(getNativeOrThrow(), subWindow.getNative(), user, padded, &readError);
     if (!x)
-        throw nitf::NITFException(&error);
+        throw nitf::NITFException(&readError);
+}
+
+void ImageReader::readLevel(nitf::Uint32 level, nitf::SubWindow & subWindow,
+                            nitf::Uint8 ** user, int * padded)
+    throw (nitf::NITFException)
+{
+    nitf_Error readError;
+    NITF_BOOL x = nitf_ImageReader_readLevel(getNativeOrThrow(), level, subWindow.getNative(), user, padded, &readError);
+    if (!x)
+        throw nitf::NITFException(&readError);
 }
 
 void ImageReader::setReadCaching()
 {
     nitf_ImageReader_setReadCaching(getNativeOrThrow());
 }
+
+void ImageReader::setReadCacheSize(size_t maxBytes)
+{
+    nitf_ImageReader_setReadCacheSize(getNativeOrThrow(), maxBytes);
+}
+
+nitf::Uint64 ImageReader::getReadCacheHits()
+{
+    nitf::Uint64 hits;
+    nitf_ImageReader_getReadCacheStats(getNativeOrThrow(), &hits, NULL);
+    return hits;
+}
+
+nitf::Uint64 ImageReader::getReadCacheMisses()
+{
+    nitf::Uint64 misses;
+    nitf_ImageReader_getReadCacheStats(getNativeOrThrow(), NULL, &misses);
+    return misses;
+}
+
+void ImageReader::setDecodeThreads(nitf::Uint32 numThreads)
+{
+    nitf_ImageReader_setDecodeThreads(getNativeOrThrow(), numThreads);
+}
+
+void ImageReader::setReadAhead(int mode)
+{
+    nitf_ImageReader_setReadAhead(getNativeOrThrow(), mode);
+}
+
+const nitf::Uint8* ImageReader::borrowBlock(nitf::Uint32 blockNumber,
+                                            nitf::Uint64& blockSize)
+    throw (nitf::NITFException)
+{
+    nitf_Error borrowError;
+    const nitf::Uint8* block = nitf_ImageReader_borrowBlock(
+            getNativeOrThrow(), blockNumber, &blockSize, &borrowError);
+    if (!block)
+        throw nitf::NITFException(&borrowError);
+    return block;
+}
@@ -56,8 +56,46 @@ void ImageWriter::setWriteCaching(int enable)
     nitf_ImageWriter_setWriteCaching(getNativeOrThrow(), enable);
 }
 
+nitf::Uint32 ImageWriter::setRowsPerStrip(nitf::Uint32 numRows)
+{
+    return nitf_ImageWriter_setRowsPerStrip(getNativeOrThrow(), numRows);
+}
+
+int ImageWriter::setPipelining(int enable)
+{
+    return nitf_ImageWriter_setPipelining(getNativeOrThrow(), enable);
+}
+
 void ImageWriter::setPadPixel(nitf::Uint8* value, nitf::Uint32 length)
 {
     if (!nitf_ImageWriter_setPadPixel(getNativeOrThrow(), value, length, &error))
         throw nitf::NITFException(&error);
 }
+
+void ImageWriter::enablePadBlockOmission()
+{
+    if (!nitf_ImageWriter_enablePadBlockOmission(getNativeOrThrow(), &error))
+        throw nitf::NITFException(&error);
+}
+
+void ImageWriter::enableBlockWrites()
+{
+    if (!nitf_ImageWriter_enableBlockWrites(getNativeOrThrow(), &error))
+        throw nitf::NITFException(&error);
+}
+
+void ImageWriter::writeBlock(nitf::Uint32 blockRow, nitf::Uint32 blockCol,
+                             nitf::Uint32 band, const nitf::Uint8* data)
+{
+    /* Blocks may be written from several threads, so the error is local */
+    nitf_Error blockError;
+    if (!nitf_ImageWriter_writeBlock(getNativeOrThrow(), blockRow, blockCol,
+                                     band, data, &blockError))
+        throw nitf::NITFException(&blockError);
+}
+
+void ImageWriter::blockWritesDone()
+{
+    if (!nitf_ImageWriter_blockWritesDone(getNativeOrThrow(), &error))
+        throw nitf::NITFException(&error);
+}
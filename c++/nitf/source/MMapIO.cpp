@@ -0,0 +1,51 @@
+/* =========================================================================
+ * This file is part of NITRO
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2010, General Dynamics - Advanced Information Systems
+ *
+ * NITRO is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <nitf/MMapIO.hpp>
+
+namespace nitf
+{
+MMapIO::MMapIO(const std::string& fname) throw (nitf::NITFException) :
+    IOInterface(open(fname.c_str()))
+{
+    setManaged(false);
+}
+
+MMapIO::MMapIO(const char* fname) throw (nitf::NITFException) :
+    IOInterface(open(fname))
+{
+    setManaged(false);
+}
+
+nitf_IOInterface* MMapIO::open(const char* fname) throw (nitf::NITFException)
+{
+    nitf_Error error;
+    nitf_IOInterface* const iface = nitf_MMapAdapter_open(fname, &error);
+
+    if (!iface)
+    {
+        throw nitf::NITFException(&error);
+    }
+
+    return iface;
+}
+}
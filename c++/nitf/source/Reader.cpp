@@ -116,6 +116,96 @@ nitf::Record Reader::readIO(nitf::IOInterface & io) throw (nitf::NITFException)
     return rec;
 }
 
+nitf::Record Reader::readIndex(nitf::IOHandle & io) throw (nitf::NITFException)
+{
+    return readIndexIO(io);
+}
+
+nitf::Record Reader::readIndexIO(nitf::IOInterface & io)
+    throw (nitf::NITFException)
+{
+    //free up the existing record, if we have one
+    nitf_Reader *reader = getNativeOrThrow();
+    if (reader->record)
+    {
+        nitf::Record rec(reader->record);
+        rec.setManaged(false);
+    }
+    if (reader->input && !reader->ownInput)
+    {
+        nitf::IOInterface oldIO(reader->input);
+        oldIO.setManaged(false);
+    }
+
+    nitf_Record * x = nitf_Reader_readIndexIO(getNativeOrThrow(),
+                                              io.getNative(), &error);
+
+    // As in readIO(), the reader may hold on to the io object even if
+    // the read failed.
+    if (getNativeOrThrow()->input == io.getNative())
+    {
+        io.setManaged(true);
+    }
+
+    if (!x)
+        throw nitf::NITFException(&error);
+    nitf::Record rec(x);
+
+    return rec;
+}
+
+void Reader::loadSubheader(nitf::SegmentType type, nitf::Uint32 index)
+    throw (nitf::NITFException)
+{
+    if (!nitf_Reader_loadSubheader(getNativeOrThrow(), type, index, &error))
+        throw nitf::NITFException(&error);
+}
+
+namespace
+{
+// Hands the files of nitf_Reader_scanFiles to a ScanHandler
+void scanCallback(NITF_DATA* userData, nitf_Uint32 fileIndex,
+                  const char* fileName, nitf_Reader* reader,
+                  nitf_Record* record, nitf_Error* error)
+{
+    nitf::ScanHandler* handler = (nitf::ScanHandler*)userData;
+    try
+    {
+        if (record)
+        {
+            // both stay managed, the C library destroys them
+            nitf::Reader readerObj(reader);
+            nitf::Record recordObj(record);
+            handler->onFile(fileIndex, fileName, readerObj, recordObj);
+        }
+        else
+        {
+            handler->onError(fileIndex, fileName,
+                             nitf::NITFException(error));
+        }
+    }
+    catch (...)
+    {
+    }
+}
+}
+
+void Reader::scanFiles(const std::vector<std::string>& fileNames,
+                       size_t numThreads, nitf::ScanHandler& handler)
+    throw (nitf::NITFException)
+{
+    nitf_Error error;
+    std::vector<const char*> names(fileNames.size());
+    for (size_t i = 0; i < fileNames.size(); ++i)
+        names[i] = fileNames[i].c_str();
+
+    if (!nitf_Reader_scanFiles(names.empty() ? NULL : &names[0],
+                               (nitf_Uint32)names.size(),
+                               (nitf_Uint32)numThreads, scanCallback,
+                               &handler, &error))
+        throw nitf::NITFException(&error);
+}
+
 nitf::ImageReader Reader::newImageReader(int imageSegmentNumber)
         throw (nitf::NITFException)
 {
@@ -174,6 +264,16 @@ nitf::SegmentReader Reader::newTextReader(int segmentNumber)
     return reader;
 }
 
+void Reader::setLazyTREs(bool lazy)
+{
+    nitf_Reader_setLazyTREs(getNativeOrThrow(), lazy ? 1 : 0);
+}
+
+void Reader::setUseArena(bool use)
+{
+    nitf_Reader_setUseArena(getNativeOrThrow(), use ? 1 : 0);
+}
+
 nitf::List Reader::getWarningList() const
 {
     return nitf::List(getNativeOrThrow()->warningList);
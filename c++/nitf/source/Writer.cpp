@@ -82,6 +82,13 @@ void Writer::write()
         throw nitf::NITFException(&error);
 }
 
+void Writer::writeStreamed()
+{
+    NITF_BOOL x = nitf_Writer_writeStreamed(getNativeOrThrow(), &error);
+    if (!x)
+        throw nitf::NITFException(&error);
+}
+
 void Writer::prepare(nitf::IOHandle & io, nitf::Record & record)
         throw (nitf::NITFException)
 {
@@ -26,6 +26,7 @@
 #include "j2k/Container.h"
 #include "j2k/Defines.h"
 #include "j2k/Reader.h"
+#include "j2k/TileIndex.h"
 #include "j2k/Writer.h"
 
 #endif
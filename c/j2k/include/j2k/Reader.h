@@ -37,6 +37,20 @@ typedef nrt_Uint64      (*J2K_IREADER_READ_REGION)(J2K_USER_DATA*, nrt_Uint32 x0
                                                   nrt_Error*);
 typedef j2k_Container*  (*J2K_IREADER_GET_CONTAINER)(J2K_USER_DATA*, nrt_Error*);
 typedef void            (*J2K_IREADER_DESTRUCT)(J2K_USER_DATA *);
+typedef nrt_Uint64      (*J2K_IREADER_READ_TILE_REDUCED)(J2K_USER_DATA*,
+                                                        nrt_Uint32 tileX,
+                                                        nrt_Uint32 tileY,
+                                                        nrt_Uint32 discardLevels,
+                                                        nrt_Uint8 **buf,
+                                                        nrt_Error*);
+typedef nrt_Uint64      (*J2K_IREADER_READ_REGION_REDUCED)(J2K_USER_DATA*,
+                                                          nrt_Uint32 x0,
+                                                          nrt_Uint32 y0,
+                                                          nrt_Uint32 x1,
+                                                          nrt_Uint32 y1,
+                                                          nrt_Uint32 discardLevels,
+                                                          nrt_Uint8 **buf,
+                                                          nrt_Error*);
 
 typedef struct _j2k_IReader
 {
@@ -45,6 +59,8 @@ typedef struct _j2k_IReader
     J2K_IREADER_READ_REGION     readRegion;
     J2K_IREADER_GET_CONTAINER   getContainer;
     J2K_IREADER_DESTRUCT        destruct;
+    J2K_IREADER_READ_TILE_REDUCED   readTileReduced;
+    J2K_IREADER_READ_REGION_REDUCED readRegionReduced;
 } j2k_IReader;
 
 typedef struct _j2k_Reader
@@ -83,6 +99,28 @@ J2KAPI(nrt_Uint64) j2k_Reader_readRegion(j2k_Reader*, nrt_Uint32 x0,
                                           nrt_Uint32 y1, nrt_Uint8 **buf,
                                           nrt_Error*);
 
+/**
+ * Reads an individual tile at a reduced resolution, decoding only the
+ * wavelet levels that are needed. Each discarded level halves the tile's
+ * width and height (rounding up). Fails if the implementation cannot
+ * read reduced resolutions.
+ */
+J2KAPI(nrt_Uint64) j2k_Reader_readTileReduced(j2k_Reader*, nrt_Uint32 tileX,
+                                              nrt_Uint32 tileY,
+                                              nrt_Uint32 discardLevels,
+                                              nrt_Uint8 **buf, nrt_Error*);
+
+/**
+ * Reads a region at a reduced resolution. The region is given in full
+ * resolution coordinates; the result covers the pixels [x0, x1) x [y0, y1)
+ * divided by 2^discardLevels (rounding up).
+ */
+J2KAPI(nrt_Uint64) j2k_Reader_readRegionReduced(j2k_Reader*, nrt_Uint32 x0,
+                                                nrt_Uint32 y0, nrt_Uint32 x1,
+                                                nrt_Uint32 y1,
+                                                nrt_Uint32 discardLevels,
+                                                nrt_Uint8 **buf, nrt_Error*);
+
 /**
  * Returns the associated container (the Reader will still own it)
  */
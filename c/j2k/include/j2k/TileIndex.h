@@ -0,0 +1,102 @@
+/* =========================================================================
+ * This file is part of NITRO
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2010, General Dynamics - Advanced Information Systems
+ *
+ * NITRO is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __J2K_TILE_INDEX_H__
+#define __J2K_TILE_INDEX_H__
+
+#include "j2k/Defines.h"
+
+J2K_CXX_GUARD
+
+/**
+ * A tile-part of a codestream. The offset is from the SOC marker and the
+ * length includes the SOT marker segment.
+ */
+typedef struct _j2k_TilePart
+{
+    nrt_Uint64 offset;
+    nrt_Uint32 length;
+} j2k_TilePart;
+
+/**
+ * Locations of the tile-parts of a codestream, so a tile can be read
+ * without scanning the tiles before it.
+ *
+ * The tile-parts of tile t are parts[firstPart[t]] up to (but not
+ * including) parts[firstPart[t + 1]], in codestream order.
+ */
+typedef struct _j2k_TileIndex
+{
+    nrt_Uint32 numTiles;
+    nrt_Uint64 headerLength;    /* Main header length (SOC to first SOT) */
+    nrt_Uint32 numParts;
+    j2k_TilePart *parts;
+    nrt_Uint32 *firstPart;      /* numTiles + 1 entries */
+} j2k_TileIndex;
+
+/**
+ * Builds the index of the codestream that starts at the current offset
+ * of the IOInterface. The tile-part lengths come from the TLM marker
+ * segments if the main header has them, otherwise the tile-part headers
+ * are walked once. A length of 0 means the codestream runs to the end of
+ * the IOInterface.
+ */
+J2KAPI(j2k_TileIndex*) j2k_TileIndex_construct(nrt_IOInterface *io,
+                                               nrt_Uint64 length,
+                                               nrt_Error *error);
+
+/**
+ * Reads an index saved by j2k_TileIndex_save (e.g., from a sidecar file)
+ */
+J2KAPI(j2k_TileIndex*) j2k_TileIndex_load(nrt_IOInterface *io,
+                                          nrt_Error *error);
+
+/**
+ * Writes the index so it can be reloaded with j2k_TileIndex_load
+ */
+J2KAPI(NRT_BOOL) j2k_TileIndex_save(j2k_TileIndex *index,
+                                    nrt_IOInterface *io,
+                                    nrt_Error *error);
+
+/**
+ * Reads the main header, the tile-parts of one tile and an EOC marker into
+ * a new buffer. The result is a codestream that holds only that tile (the
+ * TLM and PLM marker segments, which describe every tile, are left out).
+ * The codestream must start at offset in the IOInterface.
+ *
+ * Returns NULL on error, the caller frees the buffer with J2K_FREE.
+ */
+J2KAPI(nrt_Uint8*) j2k_TileIndex_readTile(j2k_TileIndex *index,
+                                          nrt_IOInterface *io,
+                                          nrt_Off offset,
+                                          nrt_Uint32 tile,
+                                          nrt_Uint64 *size,
+                                          nrt_Error *error);
+
+/**
+ * Destroys the index
+ */
+J2KAPI(void) j2k_TileIndex_destruct(j2k_TileIndex **index);
+
+J2K_CXX_ENDGUARD
+
+#endif
@@ -34,6 +34,10 @@ typedef J2K_BOOL        (*J2K_IWRITER_WRITE)(J2K_USER_DATA*, nrt_IOInterface*,
                                              nrt_Error*);
 typedef j2k_Container*  (*J2K_IWRITER_GET_CONTAINER)(J2K_USER_DATA*, nrt_Error*);
 typedef void            (*J2K_IWRITER_DESTRUCT)(J2K_USER_DATA *);
+typedef J2K_BOOL        (*J2K_IWRITER_ENCODE_TILE)(J2K_USER_DATA*, nrt_Uint32,
+                                                   nrt_Uint32, const nrt_Uint8 *,
+                                                   nrt_Uint32, nrt_Uint8 **,
+                                                   nrt_Uint64 *, nrt_Error*);
 
 typedef struct _j2k_IWriter
 {
@@ -41,19 +45,51 @@ typedef struct _j2k_IWriter
     J2K_IWRITER_WRITE           write;
     J2K_IWRITER_GET_CONTAINER   getContainer;
     J2K_IWRITER_DESTRUCT        destruct;
+
+    /*
+     * Optional, may be NULL. Encodes the tile at the given indices on its
+     * own, into a complete single-tile codestream allocated with J2K_MALLOC.
+     * The tile must be coded at its position on the full image canvas with
+     * the same coding parameters as every other tile, so that its tile-part
+     * can be spliced into the full codestream. Must be safe to call from
+     * several threads at once.
+     */
+    J2K_IWRITER_ENCODE_TILE     encodeTile;
 } j2k_IWriter;
 
+/*
+ * Default limit on the uncompressed tile data held for the encode threads
+ */
+#define J2K_WRITER_DEFAULT_MAX_PENDING (256 * 1024 * 1024)
+
 typedef struct _j2k_WriterOptions
 {
     /* TODO add more options as we see fit */
     double compressionRatio;
     nrt_Uint32 numResolutions;
+
+    /*
+     * Number of threads encoding tiles. 0 or 1 encodes each tile on the
+     * calling thread, in order, as it is set
+     */
+    nrt_Uint32 numThreads;
+
+    /*
+     * Maximum bytes of uncompressed tile data queued for the encode
+     * threads before they are run. 0 selects J2K_WRITER_DEFAULT_MAX_PENDING
+     */
+    nrt_Uint64 maxPendingBytes;
 } j2k_WriterOptions;
 
+struct _j2k_TileBatch;
+
 typedef struct _j2k_Writer
 {
     j2k_IWriter *iface;
     J2K_USER_DATA *data;
+    nrt_Uint32 numThreads;
+    nrt_Uint64 maxPendingBytes;
+    struct _j2k_TileBatch *batch;
 } j2k_Writer;
 
 /**
@@ -62,10 +98,21 @@ typedef struct _j2k_Writer
 J2KAPI(j2k_Writer*) j2k_Writer_construct(j2k_Container*, j2k_WriterOptions*,
                                          nrt_Error*);
 
+/**
+ * Copies the threading options into a newly constructed Writer. Called by
+ * the j2k_Writer_construct implementations.
+ */
+J2KPROT(void) j2k_Writer_setOptions(j2k_Writer*, j2k_WriterOptions*);
+
 /**
  * Sets the uncompressed data for the tile at the given indices.
  * It is assumed that the passed-in buffer will be available for deletion
  * immediately after the call returns.
+ *
+ * When the Writer has more than one thread and the implementation can
+ * encode tiles on their own, the tile is copied and queued. Queued tiles
+ * are encoded concurrently once they exceed the pending memory limit, or
+ * at j2k_Writer_write, which assembles the tiles in index order.
  */
 J2KAPI(J2K_BOOL) j2k_Writer_setTile(j2k_Writer*, nrt_Uint32 tileX,
                                     nrt_Uint32 tileY, nrt_Uint8 *buf,
@@ -27,6 +27,13 @@
 
 NITF_CXX_GUARD
 
+/*
+ * Environment variables that set the number of tile encode threads and the
+ * limit, in bytes, on uncompressed tiles queued for them
+ */
+#define J2K_COMPRESS_THREADS_ENV "NITF_J2K_ENCODE_THREADS"
+#define J2K_COMPRESS_MAX_PENDING_ENV "NITF_J2K_MAX_PENDING_BYTES"
+
 NITFPRIV(nitf_CompressionControl*) implOpen(nitf_ImageSubheader*, nitf_Error*);
 
 NITFPRIV(NITF_BOOL) implStart(nitf_CompressionControl *control,
@@ -125,10 +132,16 @@ NITFPRIV(nitf_CompressionControl*) implOpen(nitf_ImageSubheader *subheader,
     int imageType;
     J2K_BOOL isSigned = 0;
     nrt_Uint32 idx;
+    const char *envValue;
 
     /* reset the options */
     memset(&options, 0, sizeof(j2k_WriterOptions));
 
+    if ((envValue = getenv(J2K_COMPRESS_THREADS_ENV)) != NULL)
+        options.numThreads = (nrt_Uint32) NITF_ATO32(envValue);
+    if ((envValue = getenv(J2K_COMPRESS_MAX_PENDING_ENV)) != NULL)
+        options.maxPendingBytes = (nrt_Uint64) NITF_ATO64(envValue);
+
     if(!nitf_Field_get(subheader->NITF_NROWS, &nRows,
                     NITF_CONV_INT, sizeof(nitf_Uint32), error))
     {
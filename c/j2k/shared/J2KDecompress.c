@@ -37,6 +37,26 @@ NITFPRIV(nitf_DecompressionControl*) implOpen(nitf_IOInterface*  io,
 NITFPRIV(nitf_Uint8*) implReadBlock(nitf_DecompressionControl *control,
                                     nitf_Uint32 blockNumber,
                                     nitf_Error* error);
+NITFPRIV(NITF_BOOL) implReadBlockInto(nitf_DecompressionControl *control,
+                                      nitf_Uint32 blockNumber,
+                                      nitf_Uint8* buffer,
+                                      size_t size,
+                                      nitf_Error* error);
+NITFPRIV(NITF_BOOL) implReadBlockReduced(nitf_DecompressionControl *control,
+                                         nitf_Uint32 blockNumber,
+                                         nitf_Uint32 discardLevels,
+                                         nitf_Uint8* buffer,
+                                         size_t size,
+                                         nitf_Error* error);
+NITFPRIV(NITF_BOOL) implReadBlockRegion(nitf_DecompressionControl *control,
+                                        nitf_Uint32 blockNumber,
+                                        nitf_Uint32 row,
+                                        nitf_Uint32 column,
+                                        nitf_Uint32 numRows,
+                                        nitf_Uint32 numColumns,
+                                        nitf_Uint8* buffer,
+                                        size_t size,
+                                        nitf_Error* error);
 NITFPRIV(int) implFreeBlock(nitf_DecompressionControl* control,
                             nitf_Uint8* block,
                             nitf_Error* error);
@@ -52,7 +72,10 @@ static char *ident[] =
 
 static nitf_DecompressionInterface interfaceTable =
 {
-    implOpen, implReadBlock, implFreeBlock, implClose, NULL
+    implOpen, implReadBlock, implFreeBlock, implClose, NULL,
+    NITF_DECOMPRESSION_READ_BLOCK_INTO | NITF_DECOMPRESSION_READ_BLOCK_REDUCED
+        | NITF_DECOMPRESSION_READ_BLOCK_REGION,
+    implReadBlockInto, implReadBlockReduced, implReadBlockRegion
 };
 
 typedef struct _ImplControl
@@ -102,14 +125,60 @@ NITFAPI(void*) C8_construct(char *compressionType,
     return((void *) &interfaceTable);
 }
 
-NITFPRIV(nitf_Uint8*) implReadBlock(nitf_DecompressionControl *control,
-                                    nitf_Uint32 blockNumber,
-                                    nitf_Error* error)
+/*
+ *  Move the components of a w x h (full resolution) region, decoded with
+ *  discardLevels levels discarded and packed in buf, to the positions they
+ *  have in a block of that resolution. buf must hold a whole block.
+ *  Working backwards lets this be done in place.
+ */
+NITFPRIV(void) spreadRegion(ImplControl *implControl,
+                            nrt_Uint8 *buf,
+                            nrt_Uint64 bufSize,
+                            nitf_Uint32 w,
+                            nitf_Uint32 h,
+                            nitf_Uint32 discardLevels,
+                            nitf_Uint32 nComponents)
+{
+    nitf_Uint32 factor = ((nitf_Uint32) 1) << discardLevels;
+    nitf_Uint32 blockCols, blockRows, cols, rows, row, c;
+    size_t nBytes, srcComp, dstComp;
+
+    blockCols = implControl->blockInfo.numColsPerBlock / factor;
+    blockRows = implControl->blockInfo.numRowsPerBlock / factor;
+    cols = (w + factor - 1) / factor;
+    rows = (h + factor - 1) / factor;
+    if ((cols == blockCols && rows == blockRows) || nComponents == 0)
+        return;
+
+    nBytes = (size_t) (bufSize / ((nrt_Uint64) cols * rows * nComponents));
+    srcComp = (size_t) cols * rows * nBytes;
+    dstComp = (size_t) blockCols * blockRows * nBytes;
+
+    for (c = nComponents; c-- > 0;)
+    {
+        for (row = rows; row-- > 0;)
+        {
+            nrt_Uint8 *dest = buf + c * dstComp + row * blockCols * nBytes;
+            memmove(dest, buf + c * srcComp + row * cols * nBytes,
+                    cols * nBytes);
+            memset(dest + cols * nBytes, 0, (blockCols - cols) * nBytes);
+        }
+    }
+}
+
+/*
+ *  Decode a block into *buf, discarding discardLevels resolution levels.
+ *  The j2k readers use *buf if it is set and allocate it otherwise.
+ */
+NITFPRIV(NITF_BOOL) decodeBlock(ImplControl *implControl,
+                                nitf_Uint32 blockNumber,
+                                nitf_Uint32 discardLevels,
+                                nrt_Uint8 **buf,
+                                nitf_Error* error)
 {
-    ImplControl *implControl = (ImplControl*)control;
-    nrt_Uint8 *buf = NULL;
     nrt_Uint64 bufSize;
     j2k_Container* container = NULL;
+    NITF_BOOL intoBlock = (*buf != NULL);
 
     if (j2k_Reader_canReadTiles(implControl->reader, error))
     {
@@ -119,11 +188,12 @@ NITFPRIV(nitf_Uint8*) implReadBlock(nitf_DecompressionControl *control,
         tileY = blockNumber / implControl->blockInfo.numBlocksPerRow;
         tileX = blockNumber % implControl->blockInfo.numBlocksPerRow;
 
-        if (0 == (bufSize = j2k_Reader_readTile(implControl->reader, tileX,
-                                                tileY, &buf, error)))
+        if (0 == (bufSize = j2k_Reader_readTileReduced(implControl->reader,
+                                                       tileX, tileY,
+                                                       discardLevels,
+                                                       buf, error)))
         {
-            implMemFree(buf);
-            return NULL;
+            return NITF_FAILURE;
         }
     }
     else
@@ -143,7 +213,7 @@ NITFPRIV(nitf_Uint8*) implReadBlock(nitf_DecompressionControl *control,
         container = j2k_Reader_getContainer(implControl->reader, error);
         if (container == NULL)
         {
-            return NULL;
+            return NITF_FAILURE;
         }
         totalRows = j2k_Container_getHeight(container, error);
         totalCols = j2k_Container_getWidth(container, error);
@@ -153,16 +223,166 @@ NITFPRIV(nitf_Uint8*) implReadBlock(nitf_DecompressionControl *control,
         if (y1 > totalRows)
             y1 = totalRows;
 
-        if (0 == (bufSize = j2k_Reader_readRegion(implControl->reader, x0, y0,
-                                                  x1, y1, &buf, error)))
+        if (0 == (bufSize = j2k_Reader_readRegionReduced(implControl->reader,
+                                                         x0, y0, x1, y1,
+                                                         discardLevels,
+                                                         buf, error)))
         {
-            implMemFree(buf);
-            return NULL;
+            return NITF_FAILURE;
         }
+
+        /*
+         *  A caller's buffer gets the block's layout, spread a clipped
+         *  region out to the block's rows and columns
+         */
+        if (intoBlock)
+            spreadRegion(implControl, *buf, bufSize, x1 - x0, y1 - y0,
+                         discardLevels,
+                         j2k_Container_getNumComponents(container, error));
+    }
+    return NITF_SUCCESS;
+}
+
+NITFPRIV(nitf_Uint8*) implReadBlock(nitf_DecompressionControl *control,
+                                    nitf_Uint32 blockNumber,
+                                    nitf_Error* error)
+{
+    nrt_Uint8 *buf = NULL;
+
+    if (!decodeBlock((ImplControl*)control, blockNumber, 0, &buf, error))
+    {
+        implMemFree(buf);
+        return NULL;
     }
     return buf;
 }
 
+NITFPRIV(NITF_BOOL) implReadBlockInto(nitf_DecompressionControl *control,
+                                      nitf_Uint32 blockNumber,
+                                      nitf_Uint8* buffer,
+                                      size_t size,
+                                      nitf_Error* error)
+{
+    ImplControl *implControl = (ImplControl*)control;
+    nrt_Uint8 *buf = buffer;
+
+    /* The readers fill a whole block */
+    if (size < implControl->blockInfo.length)
+    {
+        nitf_Error_initf(error, NITF_CTXT, NITF_ERR_DECOMPRESSION,
+                         "Block buffer too small (%lu < %lu)",
+                         (unsigned long) size,
+                         (unsigned long) implControl->blockInfo.length);
+        return NITF_FAILURE;
+    }
+    return decodeBlock(implControl, blockNumber, 0, &buf, error);
+}
+
+NITFPRIV(NITF_BOOL) implReadBlockReduced(nitf_DecompressionControl *control,
+                                         nitf_Uint32 blockNumber,
+                                         nitf_Uint32 discardLevels,
+                                         nitf_Uint8* buffer,
+                                         size_t size,
+                                         nitf_Error* error)
+{
+    ImplControl *implControl = (ImplControl*)control;
+    nrt_Uint8 *buf = buffer;
+    nitf_Uint64 length;
+
+    /* Each discarded level quarters the block */
+    length = implControl->blockInfo.length >> (2 * discardLevels);
+    if (size < length)
+    {
+        nitf_Error_initf(error, NITF_CTXT, NITF_ERR_DECOMPRESSION,
+                         "Block buffer too small (%lu < %lu)",
+                         (unsigned long) size, (unsigned long) length);
+        return NITF_FAILURE;
+    }
+    return decodeBlock(implControl, blockNumber, discardLevels, &buf, error);
+}
+
+/*
+ *  Decode only part of a block. The region is decoded with
+ *  j2k_Reader_readRegion, so the reader only decodes the code-blocks it
+ *  covers, and copied to its place in the block.
+ */
+NITFPRIV(NITF_BOOL) implReadBlockRegion(nitf_DecompressionControl *control,
+                                        nitf_Uint32 blockNumber,
+                                        nitf_Uint32 row,
+                                        nitf_Uint32 column,
+                                        nitf_Uint32 numRows,
+                                        nitf_Uint32 numColumns,
+                                        nitf_Uint8* buffer,
+                                        size_t size,
+                                        nitf_Error* error)
+{
+    ImplControl *implControl = (ImplControl*)control;
+    j2k_Container *container = NULL;
+    nrt_Uint8 *region = NULL;
+    nrt_Uint64 regionSize;
+    nitf_Uint32 tileX, tileY, x0, x1, y0, y1, totalRows, totalCols;
+    nitf_Uint32 blockRows, blockCols, nComponents, c, r;
+    size_t nBytes, srcStride, dstStride;
+
+    if (size < implControl->blockInfo.length)
+    {
+        nitf_Error_initf(error, NITF_CTXT, NITF_ERR_DECOMPRESSION,
+                         "Block buffer too small (%lu < %lu)",
+                         (unsigned long) size,
+                         (unsigned long) implControl->blockInfo.length);
+        return NITF_FAILURE;
+    }
+
+    blockRows = implControl->blockInfo.numRowsPerBlock;
+    blockCols = implControl->blockInfo.numColsPerBlock;
+    tileY = blockNumber / implControl->blockInfo.numBlocksPerRow;
+    tileX = blockNumber % implControl->blockInfo.numBlocksPerRow;
+
+    x0 = tileX * blockCols + column;
+    x1 = x0 + numColumns;
+    y0 = tileY * blockRows + row;
+    y1 = y0 + numRows;
+
+    container = j2k_Reader_getContainer(implControl->reader, error);
+    if (container == NULL)
+        return NITF_FAILURE;
+    totalRows = j2k_Container_getHeight(container, error);
+    totalCols = j2k_Container_getWidth(container, error);
+    nComponents = j2k_Container_getNumComponents(container, error);
+    nBytes = (j2k_Container_getPrecision(container, error) - 1) / 8 + 1;
+
+    if (x1 > totalCols)
+        x1 = totalCols;
+    if (y1 > totalRows)
+        y1 = totalRows;
+
+    /* Nothing but pad pixels */
+    if (x0 >= x1 || y0 >= y1)
+        return NITF_SUCCESS;
+
+    if (0 == (regionSize = j2k_Reader_readRegion(implControl->reader, x0, y0,
+                                                 x1, y1, &region, error)))
+    {
+        implMemFree(region);
+        return NITF_FAILURE;
+    }
+
+    srcStride = (x1 - x0) * nBytes;
+    dstStride = blockCols * nBytes;
+    for (c = 0; c < nComponents; ++c)
+    {
+        nrt_Uint8 *src = region + (size_t) c * (y1 - y0) * srcStride;
+        nrt_Uint8 *dest = buffer + (size_t) c * blockRows * dstStride
+            + (size_t) row * dstStride + column * nBytes;
+
+        for (r = 0; r < y1 - y0; ++r)
+            memcpy(dest + r * dstStride, src + r * srcStride, srcStride);
+    }
+
+    implMemFree(region);
+    return NITF_SUCCESS;
+}
+
 NITFPRIV(void*) implMemAlloc(size_t size, nitf_Error* error)
 {
     void * p = NITF_MALLOC(size);
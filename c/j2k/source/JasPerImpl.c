@@ -74,11 +74,19 @@ J2KPRIV( nrt_Uint64)     JasPerReader_readRegion(J2K_USER_DATA *, nrt_Uint32,
                                                  nrt_Error *);
 J2KPRIV( j2k_Container*) JasPerReader_getContainer(J2K_USER_DATA *, nrt_Error *);
 J2KPRIV(void)            JasPerReader_destruct(J2K_USER_DATA *);
+J2KPRIV( nrt_Uint64)     JasPerReader_readRegionReduced(J2K_USER_DATA *,
+                                                        nrt_Uint32, nrt_Uint32,
+                                                        nrt_Uint32, nrt_Uint32,
+                                                        nrt_Uint32,
+                                                        nrt_Uint8 **,
+                                                        nrt_Error *);
 
 static j2k_IReader ReaderInterface = {NULL, &JasPerReader_readTile,
                                       &JasPerReader_readRegion,
                                       &JasPerReader_getContainer,
-                                      &JasPerReader_destruct };
+                                      &JasPerReader_destruct,
+                                      NULL,
+                                      &JasPerReader_readRegionReduced };
 
 J2KPRIV( NRT_BOOL)       JasPerWriter_setTile(J2K_USER_DATA *,
                                               nrt_Uint32, nrt_Uint32,
@@ -88,17 +96,26 @@ J2KPRIV( NRT_BOOL)       JasPerWriter_write(J2K_USER_DATA *, nrt_IOInterface *,
                                             nrt_Error *);
 J2KPRIV( j2k_Container*) JasPerWriter_getContainer(J2K_USER_DATA *, nrt_Error *);
 J2KPRIV(void)            JasPerWriter_destruct(J2K_USER_DATA *);
+J2KPRIV( NRT_BOOL)       JasPerWriter_encodeTile(J2K_USER_DATA *, nrt_Uint32,
+                                                 nrt_Uint32, const nrt_Uint8 *,
+                                                 nrt_Uint32, nrt_Uint8 **,
+                                                 nrt_Uint64 *, nrt_Error *);
 
 static j2k_IWriter WriterInterface = {&JasPerWriter_setTile,
                                       &JasPerWriter_write,
                                       &JasPerWriter_getContainer,
-                                      &JasPerWriter_destruct };
+                                      &JasPerWriter_destruct,
+                                      &JasPerWriter_encodeTile };
 
 
 J2KPRIV( J2K_BOOL) JasPer_setup(JasPerReaderImpl *, jas_stream_t **,
                                 jas_image_t **, nrt_Error *);
 J2KPRIV(void)      JasPer_cleanup(jas_stream_t **, jas_image_t **);
 J2KPRIV( J2K_BOOL) JasPer_readHeader(JasPerReaderImpl *, nrt_Error *);
+J2KPRIV(void)      JasPer_reduceMatrix(jas_matrix_t *, nrt_Uint32, nrt_Uint32,
+                                       nrt_Uint8 *);
+J2KPRIV(jas_image_t*) JasPer_createImage(j2k_Container *, nrt_Uint32,
+                                         nrt_Uint32, nrt_Error *);
 J2KPRIV( J2K_BOOL) JasPer_initImage(JasPerWriterImpl *, j2k_WriterOptions *,
                                     nrt_Error *);
 
@@ -380,23 +397,22 @@ JasPer_readHeader(JasPerReaderImpl *impl, nrt_Error *error)
     return rc;
 }
 
-J2KPRIV( NRT_BOOL)
-JasPer_initImage(JasPerWriterImpl *impl, j2k_WriterOptions *writerOps,
-                 nrt_Error *error)
+/*
+ * Creates the image to encode. A width of 0 gives the full image described
+ * by the container, otherwise an image of the given size at the origin.
+ */
+J2KPRIV(jas_image_t*)
+JasPer_createImage(j2k_Container *container, nrt_Uint32 width,
+                   nrt_Uint32 height, nrt_Error *error)
 {
-    NRT_BOOL rc = NRT_SUCCESS;
-    jas_clrspc_t colorSpace;
+    jas_image_t *image = NULL;
     jas_image_cmptparm_t *cmptParams = NULL;
     j2k_Component *component = NULL;
-    nrt_Uint32 i, nComponents, height, width, nBits;
+    nrt_Uint32 i, nComponents;
     int imageType;
-    J2K_BOOL isSigned;
 
-    nComponents = j2k_Container_getNumComponents(impl->container, error);
-    width = j2k_Container_getWidth(impl->container, error);
-    height = j2k_Container_getHeight(impl->container, error);
-    nBits = j2k_Container_getPrecision(impl->container, error);
-    imageType = j2k_Container_getImageType(impl->container, error);
+    nComponents = j2k_Container_getNumComponents(container, error);
+    imageType = j2k_Container_getImageType(container, error);
 
     if (!(cmptParams = (jas_image_cmptparm_t*)J2K_MALLOC(sizeof(
             jas_image_cmptparm_t) * nComponents)))
@@ -408,19 +424,29 @@ JasPer_initImage(JasPerWriterImpl *impl, j2k_WriterOptions *writerOps,
 
     for(i = 0; i < nComponents; ++i)
     {
-        component = j2k_Container_getComponent(impl->container, i, error);
-        cmptParams[i].width = j2k_Component_getWidth(component, error);
-        cmptParams[i].height = j2k_Component_getHeight(component, error);
+        component = j2k_Container_getComponent(container, i, error);
+        if (width == 0)
+        {
+            cmptParams[i].width = j2k_Component_getWidth(component, error);
+            cmptParams[i].height = j2k_Component_getHeight(component, error);
+            cmptParams[i].tlx = j2k_Component_getOffsetX(component, error);
+            cmptParams[i].tly = j2k_Component_getOffsetY(component, error);
+        }
+        else
+        {
+            cmptParams[i].width = width;
+            cmptParams[i].height = height;
+            cmptParams[i].tlx = 0;
+            cmptParams[i].tly = 0;
+        }
         cmptParams[i].prec = j2k_Component_getPrecision(component, error);
-        cmptParams[i].tlx = j2k_Component_getOffsetX(component, error);
-        cmptParams[i].tly = j2k_Component_getOffsetY(component, error);
         cmptParams[i].hstep = j2k_Component_getSeparationX(component, error);
         cmptParams[i].vstep = j2k_Component_getSeparationY(component, error);
         cmptParams[i].sgnd = j2k_Component_isSigned(component, error);
     }
 
-    if (!(impl->image = jas_image_create(nComponents, cmptParams,
-                                         JAS_CLRSPC_UNKNOWN)))
+    if (!(image = jas_image_create(nComponents, cmptParams,
+                                   JAS_CLRSPC_UNKNOWN)))
     {
 
         nrt_Error_init(error, "Error creating JasPer image", NRT_CTXT,
@@ -430,20 +456,20 @@ JasPer_initImage(JasPerWriterImpl *impl, j2k_WriterOptions *writerOps,
 
     if (imageType == J2K_TYPE_RGB && nComponents == 3)
     {
-        jas_image_setclrspc(impl->image, JAS_CLRSPC_GENRGB);
-        jas_image_setcmpttype(impl->image, 0,
+        jas_image_setclrspc(image, JAS_CLRSPC_GENRGB);
+        jas_image_setcmpttype(image, 0,
                               JAS_IMAGE_CT_COLOR(JAS_IMAGE_CT_RGB_R));
-        jas_image_setcmpttype(impl->image, 1,
+        jas_image_setcmpttype(image, 1,
                               JAS_IMAGE_CT_COLOR(JAS_IMAGE_CT_RGB_G));
-        jas_image_setcmpttype(impl->image, 2,
+        jas_image_setcmpttype(image, 2,
                               JAS_IMAGE_CT_COLOR(JAS_IMAGE_CT_RGB_B));
     }
     else
     {
-        jas_image_setclrspc(impl->image, JAS_CLRSPC_GENGRAY);
+        jas_image_setclrspc(image, JAS_CLRSPC_GENGRAY);
         for(i = 0; i < nComponents; ++i)
         {
-            jas_image_setcmpttype(impl->image, i,
+            jas_image_setcmpttype(image, i,
                                   JAS_IMAGE_CT_COLOR(JAS_IMAGE_CT_GRAY_Y));
         }
     }
@@ -452,7 +478,7 @@ JasPer_initImage(JasPerWriterImpl *impl, j2k_WriterOptions *writerOps,
 
     CATCH_ERROR:
     {
-        rc = NRT_FAILURE;
+        image = NULL;
     }
 
     CLEANUP:
@@ -461,8 +487,16 @@ JasPer_initImage(JasPerWriterImpl *impl, j2k_WriterOptions *writerOps,
             J2K_FREE(cmptParams);
     }
 
+    return image;
+}
 
-    return rc;
+J2KPRIV( NRT_BOOL)
+JasPer_initImage(JasPerWriterImpl *impl, j2k_WriterOptions *writerOps,
+                 nrt_Error *error)
+{
+    if (!(impl->image = JasPer_createImage(impl->container, 0, 0, error)))
+        return NRT_FAILURE;
+    return NRT_SUCCESS;
 }
 
 /******************************************************************************/
@@ -489,15 +523,77 @@ for (rowIdx = 0; rowIdx < rowCt; ++rowIdx){ \
 jas_matrix_destroy (matrix##_SZ); }
 
 
+/*
+ * JasPer cannot skip resolution levels, so a reduced resolution is made
+ * from the full resolution pixels by averaging 2^discardLevels square
+ * boxes (clipped at the matrix edges)
+ */
+J2KPRIV(void)
+JasPer_reduceMatrix(jas_matrix_t *matrix, nrt_Uint32 discardLevels,
+                    nrt_Uint32 nBytes, nrt_Uint8 *out)
+{
+    const nrt_Uint32 factor = ((nrt_Uint32) 1) << discardLevels;
+    const nrt_Uint32 nRows = jas_matrix_numrows(matrix);
+    const nrt_Uint32 nCols = jas_matrix_numcols(matrix);
+    nrt_Uint32 outRow, outCol, row, col, rowEnd, colEnd;
+
+    for (outRow = 0; outRow * factor < nRows; ++outRow)
+    {
+        rowEnd = (outRow + 1) * factor;
+        if (rowEnd > nRows)
+            rowEnd = nRows;
+
+        for (outCol = 0; outCol * factor < nCols; ++outCol)
+        {
+            long sum = 0, count;
+            colEnd = (outCol + 1) * factor;
+            if (colEnd > nCols)
+                colEnd = nCols;
+
+            for (row = outRow * factor; row < rowEnd; ++row)
+                for (col = outCol * factor; col < colEnd; ++col)
+                    sum += (long) jas_matrix_get(matrix, row, col);
+            count = (long) (rowEnd - outRow * factor) *
+                    (colEnd - outCol * factor);
+            sum = (sum + count / 2) / count;
+
+            switch(nBytes)
+            {
+            case 1:
+                *out = (nrt_Uint8) sum;
+                break;
+            case 2:
+                *((nrt_Uint16*) out) = (nrt_Uint16) sum;
+                break;
+            default:
+                *((nrt_Uint32*) out) = (nrt_Uint32) sum;
+                break;
+            }
+            out += nBytes;
+        }
+    }
+}
+
 J2KPRIV( nrt_Uint64)
 JasPerReader_readRegion(J2K_USER_DATA *data, nrt_Uint32 x0, nrt_Uint32 y0,
                   nrt_Uint32 x1, nrt_Uint32 y1, nrt_Uint8 **buf,
                   nrt_Error *error)
+{
+    return JasPerReader_readRegionReduced(data, x0, y0, x1, y1, 0, buf, error);
+}
+
+J2KPRIV( nrt_Uint64)
+JasPerReader_readRegionReduced(J2K_USER_DATA *data, nrt_Uint32 x0,
+                               nrt_Uint32 y0, nrt_Uint32 x1, nrt_Uint32 y1,
+                               nrt_Uint32 discardLevels, nrt_Uint8 **buf,
+                               nrt_Error *error)
 {
     JasPerReaderImpl *impl = (JasPerReaderImpl*) data;
     jas_stream_t *stream = NULL;
     jas_image_t *image = NULL;
+    jas_matrix_t *matrix = NULL;
     nrt_Uint32 i, cmptIdx, nBytes, nComponents;
+    nrt_Uint32 width, height, factor;
     nrt_Uint64 bufSize, componentSize;
     nrt_Uint8 *bufPtr = NULL;
 
@@ -506,13 +602,30 @@ JasPerReader_readRegion(J2K_USER_DATA *data, nrt_Uint32 x0, nrt_Uint32 y0,
         goto CATCH_ERROR;
     }
 
+    width = j2k_Container_getWidth(impl->container, error);
+    height = j2k_Container_getHeight(impl->container, error);
     if (x1 == 0)
-        x1 = j2k_Container_getWidth(impl->container, error);
+        x1 = width;
     if (y1 == 0)
-        y1 = j2k_Container_getHeight(impl->container, error);
+        y1 = height;
+
+    /* Widen the region to whole boxes of the reduced resolution */
+    factor = ((nrt_Uint32) 1) << discardLevels;
+    if (discardLevels > 0)
+    {
+        x0 -= x0 % factor;
+        y0 -= y0 % factor;
+        x1 = (x1 + factor - 1) / factor * factor;
+        y1 = (y1 + factor - 1) / factor * factor;
+        if (x1 > width)
+            x1 = width;
+        if (y1 > height)
+            y1 = height;
+    }
 
     nBytes = (j2k_Container_getPrecision(impl->container, error) - 1) / 8 + 1;
-    componentSize = (nrt_Uint64)(x1 - x0) * (y1 - y0) * nBytes;
+    componentSize = (nrt_Uint64)((x1 - x0 + factor - 1) / factor) *
+                    ((y1 - y0 + factor - 1) / factor) * nBytes;
     nComponents = j2k_Container_getNumComponents(impl->container, error);
     bufSize = componentSize * nComponents;
 
@@ -542,7 +655,22 @@ JasPerReader_readRegion(J2K_USER_DATA *data, nrt_Uint32 x0, nrt_Uint32 y0,
             goto CATCH_ERROR;
         }
 
-        switch(nBytes)
+        if (discardLevels > 0 && (nBytes == 1 || nBytes == 2 || nBytes == 4))
+        {
+            if (!(matrix = jas_matrix_create(y1 - y0, x1 - x0)))
+            {
+                nrt_Error_init(error, "Cannot allocate memory - JasPer "
+                               "jas_matrix_create failed!", NRT_CTXT,
+                               NRT_ERR_MEMORY);
+                goto CATCH_ERROR;
+            }
+            jas_image_readcmpt(image, cmptIdx, x0, y0, x1 - x0, y1 - y0,
+                               matrix);
+            JasPer_reduceMatrix(matrix, discardLevels, nBytes, bufPtr);
+            jas_matrix_destroy(matrix);
+            matrix = NULL;
+        }
+        else switch(nBytes)
         {
         case 1:
         {
@@ -743,6 +871,142 @@ JasPerWriter_write(J2K_USER_DATA *data, nrt_IOInterface *io, nrt_Error *error)
     return rc;
 }
 
+#define PRIV_WRITE_TILE_MATRIX(_SZ) { \
+nrt_Uint32 rowIdx, colIdx, cmpIdx; \
+const nrt_Uint##_SZ* data##_SZ = NULL; \
+jas_matrix_t* matrix##_SZ = jas_matrix_create(height, width); \
+if (!matrix##_SZ){ \
+    nrt_Error_init(error, "Cannot allocate memory - JasPer jas_matrix_create failed!", \
+            NRT_CTXT, NRT_ERR_MEMORY); \
+    goto CATCH_ERROR; \
+} \
+for (cmpIdx = 0; cmpIdx < nComponents; ++cmpIdx){ \
+    for (rowIdx = 0; rowIdx < height; ++rowIdx){ \
+        data##_SZ = (const nrt_Uint##_SZ*)buf \
+                + ((size_t)cmpIdx * tileHeight + rowIdx) * tileWidth; \
+        for (colIdx = 0; colIdx < width; ++colIdx){ \
+            jas_matrix_set(matrix##_SZ, rowIdx, colIdx, (jas_seqent_t)*data##_SZ++); \
+        } \
+    } \
+    if (jas_image_writecmpt (image, cmpIdx, 0, 0, width, height, \
+                              matrix##_SZ) != 0) { \
+        nrt_Error_init(error, "JasPer was unable to write image component", \
+                NRT_CTXT, NRT_ERR_UNK); \
+        jas_matrix_destroy (matrix##_SZ); \
+        goto CATCH_ERROR; \
+    } \
+} \
+jas_matrix_destroy (matrix##_SZ); }
+
+/*
+ * Encodes one tile as its own codestream. The image area and the tile grid
+ * both start at the tile's position on the full canvas, so the tile is
+ * coded exactly as it would be within the full image.
+ */
+J2KPRIV( NRT_BOOL)
+JasPerWriter_encodeTile(J2K_USER_DATA *data, nrt_Uint32 tileX,
+                        nrt_Uint32 tileY, const nrt_Uint8 *buf,
+                        nrt_Uint32 tileSize, nrt_Uint8 **codestream,
+                        nrt_Uint64 *codestreamSize, nrt_Error *error)
+{
+    JasPerWriterImpl *impl = (JasPerWriterImpl*) data;
+    jas_image_t *image = NULL;
+    jas_stream_t *stream = NULL;
+    jas_stream_memobj_t *memory = NULL;
+    NRT_BOOL rc = NRT_SUCCESS;
+    nrt_Uint32 nComponents, tileHeight, tileWidth, nBits, nBytes;
+    nrt_Uint32 x0, y0, width, height, gridWidth, gridHeight;
+    char options[256];
+
+    nComponents = j2k_Container_getNumComponents(impl->container, error);
+    tileWidth = j2k_Container_getTileWidth(impl->container, error);
+    tileHeight = j2k_Container_getTileHeight(impl->container, error);
+    gridWidth = j2k_Container_getGridWidth(impl->container, error);
+    gridHeight = j2k_Container_getGridHeight(impl->container, error);
+    nBits = j2k_Container_getPrecision(impl->container, error);
+    nBytes = (nBits - 1) / 8 + 1;
+
+    x0 = tileX * tileWidth;
+    y0 = tileY * tileHeight;
+    if (x0 >= gridWidth || y0 >= gridHeight
+            || tileSize < (nrt_Uint64) nComponents * tileWidth * tileHeight
+                          * nBytes)
+    {
+        nrt_Error_initf(error, NRT_CTXT, NRT_ERR_INVALID_PARAMETER,
+                        "Invalid tile (%d, %d)", tileX, tileY);
+        goto CATCH_ERROR;
+    }
+    width = gridWidth - x0 < tileWidth ? gridWidth - x0 : tileWidth;
+    height = gridHeight - y0 < tileHeight ? gridHeight - y0 : tileHeight;
+
+    if (!(image = JasPer_createImage(impl->container, width, height, error)))
+        goto CATCH_ERROR;
+
+    switch(nBytes)
+    {
+    case 1:
+        PRIV_WRITE_TILE_MATRIX(8);
+        break;
+    case 2:
+        PRIV_WRITE_TILE_MATRIX(16);
+        break;
+    case 4:
+        PRIV_WRITE_TILE_MATRIX(32);
+        break;
+    default:
+        nrt_Error_init(error, "Invalid pixel size", NRT_CTXT,
+                       NRT_ERR_INVALID_OBJECT);
+        goto CATCH_ERROR;
+    }
+
+    if (!(stream = jas_stream_memopen(NULL, 0)))
+    {
+        nrt_Error_init(error, "Error opening JasPer memory stream", NRT_CTXT,
+                       NRT_ERR_MEMORY);
+        goto CATCH_ERROR;
+    }
+
+    NRT_SNPRINTF(options, sizeof(options),
+                 "imgareatlx=%u imgareatly=%u tilegrdtlx=%u tilegrdtly=%u "
+                 "tilewidth=%u tileheight=%u", x0, y0, x0, y0, tileWidth,
+                 tileHeight);
+    if (jas_image_encode(image, stream, jas_image_strtofmt((char*)"jpc"),
+                         options) != 0)
+    {
+        nrt_Error_initf(error, NRT_CTXT, NRT_ERR_INVALID_OBJECT,
+                        "Error encoding tile (%d, %d)", tileX, tileY);
+        goto CATCH_ERROR;
+    }
+    jas_stream_flush(stream);
+
+    memory = (jas_stream_memobj_t*) stream->obj_;
+    if (!(*codestream = (nrt_Uint8*) J2K_MALLOC(memory->len_)))
+    {
+        nrt_Error_init(error, NRT_STRERROR(NRT_ERRNO), NRT_CTXT,
+                       NRT_ERR_MEMORY);
+        goto CATCH_ERROR;
+    }
+    memcpy(*codestream, memory->buf_, memory->len_);
+    *codestreamSize = memory->len_;
+
+    goto CLEANUP;
+
+    CATCH_ERROR:
+    {
+        rc = NRT_FAILURE;
+    }
+
+    CLEANUP:
+    {
+        if (stream)
+            jas_stream_close(stream);
+        if (image)
+            jas_image_destroy(image);
+    }
+
+    return rc;
+}
+
 J2KPRIV( j2k_Container*)
 JasPerWriter_getContainer(J2K_USER_DATA *data, nrt_Error *error)
 {
@@ -882,7 +1146,7 @@ J2KAPI(j2k_Writer*) j2k_Writer_construct(j2k_Container *container,
         goto CATCH_ERROR;
     }
 
-    writer = (j2k_Writer*) J2K_MALLOC(sizeof(j2k_Container));
+    writer = (j2k_Writer*) J2K_MALLOC(sizeof(j2k_Writer));
     if (!writer)
     {
         nrt_Error_init(error, NRT_STRERROR(NRT_ERRNO), NRT_CTXT, NRT_ERR_MEMORY);
@@ -907,6 +1171,7 @@ J2KAPI(j2k_Writer*) j2k_Writer_construct(j2k_Container *container,
 
     writer->data = impl;
     writer->iface = &WriterInterface;
+    j2k_Writer_setOptions(writer, options);
 
     return writer;
 
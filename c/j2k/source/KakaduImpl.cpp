@@ -853,7 +853,7 @@ J2KAPI(j2k_Writer*) j2k_Writer_construct(j2k_Container *container,
     j2k_Writer *writer = NULL;
 //    j2k::kakadu::UserContainer *userContainer = NULL;
 //
-    writer = (j2k_Writer*) J2K_MALLOC(sizeof(j2k_Container));
+    writer = (j2k_Writer*) J2K_MALLOC(sizeof(j2k_Writer));
     if (!writer)
     {
         nrt_Error_init(error, NRT_STRERROR(NRT_ERRNO), NRT_CTXT, NRT_ERR_MEMORY);
@@ -26,6 +26,7 @@
 
 #include "j2k/Container.h"
 #include "j2k/Reader.h"
+#include "j2k/TileIndex.h"
 #include "j2k/Writer.h"
 
 #include <openjpeg.h>
@@ -51,6 +52,7 @@ typedef struct _OpenJPEGReaderImpl
     nrt_IOInterface *io;
     int ownIO;
     j2k_Container *container;
+    j2k_TileIndex *index;   /* NULL if the codestream could not be indexed */
 } OpenJPEGReaderImpl;
 
 typedef struct _OpenJPEGWriterImpl
@@ -61,6 +63,7 @@ typedef struct _OpenJPEGWriterImpl
     char *compressedBuf;
     nrt_IOInterface *compressed;
     opj_stream_t *stream;
+    opj_cparameters_t encoderParams;
 } OpenJPEGWriterImpl;
 
 typedef struct _OpenJPEGError
@@ -85,12 +88,27 @@ J2KPRIV( nrt_Uint64)     OpenJPEGReader_readRegion(J2K_USER_DATA *, nrt_Uint32,
                                                    nrt_Error *);
 J2KPRIV( j2k_Container*) OpenJPEGReader_getContainer(J2K_USER_DATA *, nrt_Error *);
 J2KPRIV(void)            OpenJPEGReader_destruct(J2K_USER_DATA *);
+J2KPRIV( nrt_Uint64)     OpenJPEGReader_readTileReduced(J2K_USER_DATA *,
+                                                        nrt_Uint32, nrt_Uint32,
+                                                        nrt_Uint32,
+                                                        nrt_Uint8 **,
+                                                        nrt_Error *);
+J2KPRIV( nrt_Uint64)     OpenJPEGReader_readRegionReduced(J2K_USER_DATA *,
+                                                          nrt_Uint32,
+                                                          nrt_Uint32,
+                                                          nrt_Uint32,
+                                                          nrt_Uint32,
+                                                          nrt_Uint32,
+                                                          nrt_Uint8 **,
+                                                          nrt_Error *);
 
 static j2k_IReader ReaderInterface = {&OpenJPEGReader_canReadTiles,
                                       &OpenJPEGReader_readTile,
                                       &OpenJPEGReader_readRegion,
                                       &OpenJPEGReader_getContainer,
-                                      &OpenJPEGReader_destruct };
+                                      &OpenJPEGReader_destruct,
+                                      &OpenJPEGReader_readTileReduced,
+                                      &OpenJPEGReader_readRegionReduced };
 
 J2KPRIV( NRT_BOOL)       OpenJPEGWriter_setTile(J2K_USER_DATA *,
                                                 nrt_Uint32, nrt_Uint32,
@@ -100,14 +118,24 @@ J2KPRIV( NRT_BOOL)       OpenJPEGWriter_write(J2K_USER_DATA *, nrt_IOInterface *
                                               nrt_Error *);
 J2KPRIV( j2k_Container*) OpenJPEGWriter_getContainer(J2K_USER_DATA *, nrt_Error *);
 J2KPRIV(void)            OpenJPEGWriter_destruct(J2K_USER_DATA *);
+J2KPRIV( NRT_BOOL)       OpenJPEGWriter_encodeTile(J2K_USER_DATA *, nrt_Uint32,
+                                                   nrt_Uint32, const nrt_Uint8 *,
+                                                   nrt_Uint32, nrt_Uint8 **,
+                                                   nrt_Uint64 *, nrt_Error *);
 
 static j2k_IWriter WriterInterface = {&OpenJPEGWriter_setTile,
                                       &OpenJPEGWriter_write,
                                       &OpenJPEGWriter_getContainer,
-                                      &OpenJPEGWriter_destruct };
+                                      &OpenJPEGWriter_destruct,
+                                      &OpenJPEGWriter_encodeTile };
 
 
 J2KPRIV(void) OpenJPEG_cleanup(opj_stream_t **, opj_codec_t **, opj_image_t **);
+J2KPRIV(void) OpenJPEG_setupParameters(j2k_Container *, j2k_WriterOptions *,
+                                       opj_cparameters_t *, nrt_Error *);
+J2KPRIV(opj_image_t*) OpenJPEG_createImage(j2k_Container *, nrt_Uint32,
+                                           nrt_Uint32, nrt_Uint32, nrt_Uint32,
+                                           nrt_Error *);
 J2KPRIV( J2K_BOOL) OpenJPEG_initImage(OpenJPEGWriterImpl *, j2k_WriterOptions *,
                                       nrt_Error *);
 
@@ -260,19 +288,22 @@ OpenJPEG_cleanup(opj_stream_t **stream, opj_codec_t **codec,
 /* UTILITIES                                                                  */
 /******************************************************************************/
 
+/*
+ * Creates a decoder for the codestream at offset in io, which is either
+ * the reader's own IOInterface or a single tile read through the index
+ */
 J2KPRIV( NRT_BOOL)
-OpenJPEG_setup(OpenJPEGReaderImpl *impl, opj_stream_t **stream,
-               opj_codec_t **codec, nrt_Error *error)
+OpenJPEG_setup(OpenJPEGReaderImpl *impl, nrt_IOInterface *io, nrt_Off offset,
+               opj_stream_t **stream, opj_codec_t **codec,
+               nrt_Uint32 discardLevels, nrt_Error *error)
 {
-    if (!NRT_IO_SUCCESS(nrt_IOInterface_seek(impl->io,
-                                             impl->ioOffset,
-                                             NRT_SEEK_SET,
+    if (!NRT_IO_SUCCESS(nrt_IOInterface_seek(io, offset, NRT_SEEK_SET,
                                              error)))
     {
         goto CATCH_ERROR;
     }
 
-    if (!(*stream = OpenJPEG_createIO(impl->io, 0, 1, error)))
+    if (!(*stream = OpenJPEG_createIO(io, 0, 1, error)))
     {
         goto CATCH_ERROR;
     }
@@ -296,6 +327,9 @@ OpenJPEG_setup(OpenJPEGReaderImpl *impl, opj_stream_t **stream,
     
     opj_set_default_decoder_parameters(&impl->parameters);
 
+    /* Skip the highest resolution levels when reading an overview */
+    impl->parameters.cp_reduce = discardLevels;
+
     if (!opj_setup_decoder(*codec, &impl->parameters))
     {
         /*nrt_Error_init(error, "Error setting up openjpeg decoder", NRT_CTXT,
@@ -323,7 +357,8 @@ OpenJPEG_readHeader(OpenJPEGReaderImpl *impl, nrt_Error *error)
     OPJ_UINT32 tileWidth, tileHeight;
     OPJ_UINT32 imageWidth, imageHeight;
 
-    if (!OpenJPEG_setup(impl, &stream, &codec, error))
+    if (!OpenJPEG_setup(impl, impl->io, impl->ioOffset, &stream, &codec, 0,
+                        error))
     {
         goto CATCH_ERROR;
     }
@@ -426,6 +461,20 @@ OpenJPEG_readHeader(OpenJPEGReaderImpl *impl, nrt_Error *error)
         }
     }
 
+    if (!impl->index)
+    {
+        /*
+         * Locate the tile-parts once so each tile read only touches its own
+         * bytes. Codestreams that can't be indexed are read as before.
+         */
+        nrt_Error indexError;
+        if (NRT_IO_SUCCESS(nrt_IOInterface_seek(impl->io, impl->ioOffset,
+                                                NRT_SEEK_SET, &indexError)))
+        {
+            impl->index = j2k_TileIndex_construct(impl->io, 0, &indexError);
+        }
+    }
+
     goto CLEANUP;
 
     CATCH_ERROR:
@@ -440,43 +489,30 @@ OpenJPEG_readHeader(OpenJPEGReaderImpl *impl, nrt_Error *error)
     return rc;
 }
 
-J2KPRIV( NRT_BOOL) OpenJPEG_initImage(OpenJPEGWriterImpl *impl,
-                                      j2k_WriterOptions *writerOps,
-                                      nrt_Error *error)
+J2KPRIV(void) OpenJPEG_setupParameters(j2k_Container *container,
+                                       j2k_WriterOptions *writerOps,
+                                       opj_cparameters_t *encoderParams,
+                                       nrt_Error *error)
 {
-    NRT_BOOL rc = NRT_SUCCESS;
-    nrt_Uint32 i, nComponents, height, width, tileHeight, tileWidth;
-    nrt_Uint32 nBytes ,xTiles, yTiles;
-    j2k_Component *component = NULL;
-    size_t uncompressedSize;
-    int imageType;
-    opj_cparameters_t encoderParams;
-    opj_image_cmptparm_t *cmptParams;
-    OPJ_COLOR_SPACE colorSpace;
+    nrt_Uint32 tileHeight, tileWidth;
 
-    nComponents = j2k_Container_getNumComponents(impl->container, error);
-    width = j2k_Container_getWidth(impl->container, error);
-    height = j2k_Container_getHeight(impl->container, error);
-    tileWidth = j2k_Container_getTileWidth(impl->container, error);
-    tileHeight = j2k_Container_getTileHeight(impl->container, error);
-    xTiles = j2k_Container_getTilesX(impl->container, error);
-    yTiles = j2k_Container_getTilesY(impl->container, error);
-    imageType = j2k_Container_getImageType(impl->container, error);
+    tileWidth = j2k_Container_getTileWidth(container, error);
+    tileHeight = j2k_Container_getTileHeight(container, error);
 
     /* setup the encoder parameters */
     /* TODO allow overrides somehow? */
-    opj_set_default_encoder_parameters(&encoderParams);
-    encoderParams.cp_disto_alloc = 1;
-    encoderParams.tcp_numlayers = 1;
+    opj_set_default_encoder_parameters(encoderParams);
+    encoderParams->cp_disto_alloc = 1;
+    encoderParams->tcp_numlayers = 1;
 
     /*if (writerOps && writerOps->compressionRatio > 0.0001)
-        encoderParams.tcp_rates[0] = 1.0 / writerOps->compressionRatio;
+        encoderParams->tcp_rates[0] = 1.0 / writerOps->compressionRatio;
     else
-        encoderParams.tcp_rates[0] = 4.0;
+        encoderParams->tcp_rates[0] = 4.0;
     */
-    encoderParams.tcp_rates[0] = 1.0; /* lossless */
+    encoderParams->tcp_rates[0] = 1.0; /* lossless */
     if (writerOps && writerOps->numResolutions > 0)
-        encoderParams.numresolution = writerOps->numResolutions;
+        encoderParams->numresolution = writerOps->numResolutions;
     else
     {
         /* 
@@ -489,15 +525,36 @@ J2KPRIV( NRT_BOOL) OpenJPEG_initImage(OpenJPEGWriterImpl *impl,
         OPJ_UINT32 minX = (OPJ_UINT32)floor(log(tileWidth) / logTwo);
         OPJ_UINT32 minY = (OPJ_UINT32)floor(log(tileHeight) / logTwo);
         OPJ_UINT32 minXY = (minX < minY) ? minX : minY;
-        encoderParams.numresolution = (minXY < res) ? minXY : res;
-    }
-    encoderParams.prog_order = OPJ_LRCP; /* the default */
-    encoderParams.cp_tx0 = 0;
-    encoderParams.cp_ty0 = 0;
-    encoderParams.tile_size_on = 1;
-    encoderParams.cp_tdx = tileWidth;
-    encoderParams.cp_tdy = tileHeight;
-    encoderParams.irreversible = 0;
+        encoderParams->numresolution = (minXY < res) ? minXY : res;
+    }
+    encoderParams->prog_order = OPJ_LRCP; /* the default */
+    encoderParams->cp_tx0 = 0;
+    encoderParams->cp_ty0 = 0;
+    encoderParams->tile_size_on = 1;
+    encoderParams->cp_tdx = tileWidth;
+    encoderParams->cp_tdy = tileHeight;
+    encoderParams->irreversible = 0;
+}
+
+/*
+ * Creates the image to encode. A width of 0 gives the full image described
+ * by the container, otherwise an image of the given size at (x0, y0) on the
+ * full image canvas.
+ */
+J2KPRIV(opj_image_t*) OpenJPEG_createImage(j2k_Container *container,
+                                           nrt_Uint32 x0, nrt_Uint32 y0,
+                                           nrt_Uint32 width, nrt_Uint32 height,
+                                           nrt_Error *error)
+{
+    nrt_Uint32 i, nComponents;
+    j2k_Component *component = NULL;
+    int imageType;
+    opj_image_t *image = NULL;
+    opj_image_cmptparm_t *cmptParams;
+    OPJ_COLOR_SPACE colorSpace;
+
+    nComponents = j2k_Container_getNumComponents(container, error);
+    imageType = j2k_Container_getImageType(container, error);
 
     if (!(cmptParams = (opj_image_cmptparm_t*)J2K_MALLOC(sizeof(
             opj_image_cmptparm_t) * nComponents)))
@@ -510,17 +567,86 @@ J2KPRIV( NRT_BOOL) OpenJPEG_initImage(OpenJPEGWriterImpl *impl,
 
     for(i = 0; i < nComponents; ++i)
     {
-        component = j2k_Container_getComponent(impl->container, i, error);
-        cmptParams[i].w = j2k_Component_getWidth(component, error);
-        cmptParams[i].h = j2k_Component_getHeight(component, error);
+        component = j2k_Container_getComponent(container, i, error);
+        if (width == 0)
+        {
+            cmptParams[i].w = j2k_Component_getWidth(component, error);
+            cmptParams[i].h = j2k_Component_getHeight(component, error);
+            cmptParams[i].x0 = j2k_Component_getOffsetX(component, error);
+            cmptParams[i].y0 = j2k_Component_getOffsetY(component, error);
+        }
+        else
+        {
+            cmptParams[i].w = width;
+            cmptParams[i].h = height;
+            cmptParams[i].x0 = x0;
+            cmptParams[i].y0 = y0;
+        }
         cmptParams[i].prec = j2k_Component_getPrecision(component, error);
-        cmptParams[i].x0 = j2k_Component_getOffsetX(component, error);
-        cmptParams[i].y0 = j2k_Component_getOffsetY(component, error);
         cmptParams[i].dx = j2k_Component_getSeparationX(component, error);
         cmptParams[i].dy = j2k_Component_getSeparationY(component, error);
         cmptParams[i].sgnd = j2k_Component_isSigned(component, error);
     }
 
+    switch(imageType)
+    {
+    case J2K_TYPE_RGB:
+        colorSpace = OPJ_CLRSPC_SRGB;
+        break;
+    default:
+        colorSpace = OPJ_CLRSPC_GRAY;
+    }
+
+    if (!(image = opj_image_tile_create(nComponents, cmptParams, colorSpace)))
+    {
+        nrt_Error_init(error, "Error creating OpenJPEG image", NRT_CTXT,
+                       NRT_ERR_INVALID_OBJECT);
+        goto CATCH_ERROR;
+    }
+
+    if (width == 0)
+    {
+        width = j2k_Container_getWidth(container, error);
+        height = j2k_Container_getHeight(container, error);
+    }
+
+    /* for some reason we must also explicitly specify these in the image... */
+    image->numcomps = nComponents;
+    image->x0 = x0;
+    image->y0 = y0;
+    image->x1 = x0 + width;
+    image->y1 = y0 + height;
+    image->color_space = colorSpace;
+
+    CATCH_ERROR:
+    {
+        if (cmptParams)
+            J2K_FREE(cmptParams);
+    }
+
+    return image;
+}
+
+J2KPRIV( NRT_BOOL) OpenJPEG_initImage(OpenJPEGWriterImpl *impl,
+                                      j2k_WriterOptions *writerOps,
+                                      nrt_Error *error)
+{
+    NRT_BOOL rc = NRT_SUCCESS;
+    nrt_Uint32 nComponents, height, width;
+    nrt_Uint32 nBytes;
+    size_t uncompressedSize;
+
+    nComponents = j2k_Container_getNumComponents(impl->container, error);
+    width = j2k_Container_getWidth(impl->container, error);
+    height = j2k_Container_getHeight(impl->container, error);
+
+    OpenJPEG_setupParameters(impl->container, writerOps, &impl->encoderParams,
+                             error);
+
+    /* tiles are encoded on their own by OpenJPEGWriter_encodeTile */
+    if (writerOps && writerOps->numThreads > 1)
+        return NRT_SUCCESS;
+
     nBytes = (j2k_Container_getPrecision(impl->container, error) - 1) / 8 + 1;
     uncompressedSize = width * height * nComponents * nBytes;
 
@@ -543,39 +669,19 @@ J2KPRIV( NRT_BOOL) OpenJPEG_initImage(OpenJPEGWriterImpl *impl,
         goto CATCH_ERROR;
     }
 
-
-    switch(imageType)
-    {
-    case J2K_TYPE_RGB:
-        colorSpace = OPJ_CLRSPC_SRGB;
-        break;
-    default:
-        colorSpace = OPJ_CLRSPC_GRAY;
-    }
-
     if (!(impl->codec = opj_create_compress(OPJ_CODEC_J2K)))
     {
         nrt_Error_init(error, "Error creating OpenJPEG codec", NRT_CTXT,
                        NRT_ERR_INVALID_OBJECT);
         goto CATCH_ERROR;
     }
-    if (!(impl->image = opj_image_tile_create(nComponents, cmptParams,
-                                              colorSpace)))
+    if (!(impl->image = OpenJPEG_createImage(impl->container, 0, 0, 0, 0,
+                                             error)))
     {
-        nrt_Error_init(error, "Error creating OpenJPEG image", NRT_CTXT,
-                       NRT_ERR_INVALID_OBJECT);
         goto CATCH_ERROR;
     }
 
-    /* for some reason we must also explicitly specify these in the image... */
-    impl->image->numcomps = nComponents;
-    impl->image->x0 = 0;
-    impl->image->y0 = 0;
-    impl->image->x1 = width;
-    impl->image->y1 = height;
-    impl->image->color_space = colorSpace;
-
-    if (!opj_setup_encoder(impl->codec, &encoderParams, impl->image))
+    if (!opj_setup_encoder(impl->codec, &impl->encoderParams, impl->image))
     {
         /*nrt_Error_init(error, "Error setting up OpenJPEG decoder", NRT_CTXT,
           NRT_ERR_INVALID_OBJECT);*/
@@ -598,8 +704,6 @@ J2KPRIV( NRT_BOOL) OpenJPEG_initImage(OpenJPEGWriterImpl *impl,
 
     CLEANUP:
     {
-        if (cmptParams)
-            J2K_FREE(cmptParams);
     }
 
     return rc;
@@ -619,20 +723,59 @@ OpenJPEGReader_canReadTiles(J2K_USER_DATA *data, nrt_Error *error)
 J2KPRIV( nrt_Uint64)
 OpenJPEGReader_readTile(J2K_USER_DATA *data, nrt_Uint32 tileX, nrt_Uint32 tileY,
                   nrt_Uint8 **buf, nrt_Error *error)
+{
+    return OpenJPEGReader_readTileReduced(data, tileX, tileY, 0, buf, error);
+}
+
+J2KPRIV( nrt_Uint64)
+OpenJPEGReader_readTileReduced(J2K_USER_DATA *data, nrt_Uint32 tileX,
+                               nrt_Uint32 tileY, nrt_Uint32 discardLevels,
+                               nrt_Uint8 **buf, nrt_Error *error)
 {
     OpenJPEGReaderImpl *impl = (OpenJPEGReaderImpl*) data;
 
     opj_stream_t *stream = NULL;
     opj_image_t *image = NULL;
     opj_codec_t *codec = NULL;
+    nrt_IOInterface *tileIO = NULL;
     nrt_Uint32 bufSize;
     const OPJ_UINT32 tileWidth = j2k_Container_getTileWidth(impl->container, error);
     const OPJ_UINT32 tileHeight = j2k_Container_getTileHeight(impl->container, error);
+    const OPJ_UINT32 factor = ((OPJ_UINT32) 1) << discardLevels;
+    /* Width of a whole tile at the decoded resolution */
+    const OPJ_UINT32 levelTileWidth = (tileWidth + factor - 1) / factor;
     size_t numBitsPerPixel = 0;
     size_t numBytesPerPixel = 0;
     nrt_Uint64 fullBufSize = 0;
 
-    if (!OpenJPEG_setup(impl, &stream, &codec, error))
+    if (impl->index)
+    {
+        /* Decode a codestream holding just this tile */
+        nrt_Uint8 *tileStream = NULL;
+        nrt_Uint64 tileStreamSize;
+        nrt_Uint32 tilesX = j2k_Container_getTilesX(impl->container, error);
+
+        if (!(tileStream = j2k_TileIndex_readTile(impl->index, impl->io,
+                                                  impl->ioOffset,
+                                                  tileY * tilesX + tileX,
+                                                  &tileStreamSize, error)))
+        {
+            goto CATCH_ERROR;
+        }
+        if (!(tileIO = nrt_BufferAdapter_construct((char*) tileStream,
+                                                   tileStreamSize, 1, error)))
+        {
+            J2K_FREE(tileStream);
+            goto CATCH_ERROR;
+        }
+        if (!OpenJPEG_setup(impl, tileIO, 0, &stream, &codec, discardLevels,
+                            error))
+        {
+            goto CATCH_ERROR;
+        }
+    }
+    else if (!OpenJPEG_setup(impl, impl->io, impl->ioOffset, &stream, &codec,
+                             discardLevels, error))
     {
         goto CATCH_ERROR;
     }
@@ -683,9 +826,11 @@ OpenJPEGReader_readTile(J2K_USER_DATA *data, nrt_Uint32 tileX, nrt_Uint32 tileY,
              *       to memcpy these in - we only need to get the stride to
              *       work out correctly.
              */
-            const OPJ_UINT32 thisTileWidth = tileX1 - tileX0;
-            const OPJ_UINT32 thisTileHeight = tileY1 - tileY0;
-            if (thisTileWidth < tileWidth)
+            const OPJ_UINT32 thisTileWidth =
+                (tileX1 + factor - 1) / factor - (tileX0 + factor - 1) / factor;
+            const OPJ_UINT32 thisTileHeight =
+                (tileY1 + factor - 1) / factor - (tileY0 + factor - 1) / factor;
+            if (thisTileWidth < levelTileWidth)
             {
                 /* TODO: The current approach below only works for single band
                  *       imagery.  For RGB data, I believe it is stored as all
@@ -705,7 +850,8 @@ OpenJPEGReader_readTile(J2K_USER_DATA *data, nrt_Uint32 tileX, nrt_Uint32 tileY,
                     j2k_Container_getPrecision(impl->container, error);
                 numBytesPerPixel =
                     (numBitsPerPixel / 8) + (numBitsPerPixel % 8 != 0);
-                fullBufSize = tileWidth * thisTileHeight * numBytesPerPixel;
+                fullBufSize = levelTileWidth * thisTileHeight *
+                              numBytesPerPixel;
             }
             else
             {
@@ -730,14 +876,14 @@ OpenJPEGReader_readTile(J2K_USER_DATA *data, nrt_Uint32 tileX, nrt_Uint32 tileY,
                 goto CATCH_ERROR;
             }
 
-            if (thisTileWidth < tileWidth)
+            if (thisTileWidth < levelTileWidth)
             {
                 /* We have a tile that isn't as wide as it "should" be
                  * Need to add in the extra columns ourselves.  By marching
                  * through the rows backwards, we can do this in place.
                  */
                 const size_t srcStride = thisTileWidth * numBytesPerPixel;
-                const size_t destStride = tileWidth * numBytesPerPixel;
+                const size_t destStride = levelTileWidth * numBytesPerPixel;
                 const size_t numLeftoverBytes = destStride - srcStride;
                 OPJ_UINT32 lastRow = thisTileHeight - 1;
                 size_t srcOffset = lastRow * srcStride;
@@ -767,6 +913,8 @@ OpenJPEGReader_readTile(J2K_USER_DATA *data, nrt_Uint32 tileX, nrt_Uint32 tileY,
     CLEANUP:
     {
         OpenJPEG_cleanup(&stream, &codec, &image);
+        if (tileIO)
+            nrt_IOInterface_destruct(&tileIO);
     }
     return fullBufSize;
 }
@@ -775,8 +923,19 @@ J2KPRIV( nrt_Uint64)
 OpenJPEGReader_readRegion(J2K_USER_DATA *data, nrt_Uint32 x0, nrt_Uint32 y0,
                           nrt_Uint32 x1, nrt_Uint32 y1, nrt_Uint8 **buf,
                           nrt_Error *error)
+{
+    return OpenJPEGReader_readRegionReduced(data, x0, y0, x1, y1, 0, buf,
+                                            error);
+}
+
+J2KPRIV( nrt_Uint64)
+OpenJPEGReader_readRegionReduced(J2K_USER_DATA *data, nrt_Uint32 x0,
+                                 nrt_Uint32 y0, nrt_Uint32 x1, nrt_Uint32 y1,
+                                 nrt_Uint32 discardLevels, nrt_Uint8 **buf,
+                                 nrt_Error *error)
 {
     OpenJPEGReaderImpl *impl = (OpenJPEGReaderImpl*) data;
+    const nrt_Uint32 factor = ((nrt_Uint32) 1) << discardLevels;
 
     opj_stream_t *stream = NULL;
     opj_image_t *image = NULL;
@@ -785,7 +944,8 @@ OpenJPEGReader_readRegion(J2K_USER_DATA *data, nrt_Uint32 x0, nrt_Uint32 y0,
     nrt_Uint64 offset = 0;
     nrt_Uint32 componentBytes, nComponents;
 
-    if (!OpenJPEG_setup(impl, &stream, &codec, error))
+    if (!OpenJPEG_setup(impl, impl->io, impl->ioOffset, &stream, &codec,
+                        discardLevels, error))
     {
         goto CATCH_ERROR;
     }
@@ -811,7 +971,9 @@ OpenJPEGReader_readRegion(J2K_USER_DATA *data, nrt_Uint32 x0, nrt_Uint32 y0,
 
     nComponents = j2k_Container_getNumComponents(impl->container, error);
     componentBytes = (j2k_Container_getPrecision(impl->container, error) - 1) / 8 + 1;
-    bufSize = (nrt_Uint64)(x1 - x0) * (y1 - y0) * componentBytes * nComponents;
+    bufSize = (nrt_Uint64)((x1 + factor - 1) / factor - (x0 + factor - 1) / factor) *
+              ((y1 + factor - 1) / factor - (y0 + factor - 1) / factor) *
+              componentBytes * nComponents;
     if (buf && !*buf)
     {
         *buf = (nrt_Uint8*)J2K_MALLOC(bufSize);
@@ -886,6 +1048,7 @@ OpenJPEGReader_destruct(J2K_USER_DATA * data)
             nrt_IOInterface_destruct(&impl->io);
             impl->io = NULL;
         }
+        j2k_TileIndex_destruct(&impl->index);
         J2K_FREE(data);
     }
 }
@@ -1047,6 +1210,159 @@ OpenJPEGWriter_write(J2K_USER_DATA *data, nrt_IOInterface *io, nrt_Error *error)
     return rc;
 }
 
+/*
+ * Encodes one tile as its own codestream. The image and the tile grid both
+ * start at the tile's position on the full canvas, so the tile is coded
+ * exactly as it would be within the full image.
+ */
+J2KPRIV( NRT_BOOL)
+OpenJPEGWriter_encodeTile(J2K_USER_DATA *data, nrt_Uint32 tileX,
+                          nrt_Uint32 tileY, const nrt_Uint8 *buf,
+                          nrt_Uint32 tileSize, nrt_Uint8 **codestream,
+                          nrt_Uint64 *codestreamSize, nrt_Error *error)
+{
+    OpenJPEGWriterImpl *impl = (OpenJPEGWriterImpl*) data;
+    NRT_BOOL rc = NRT_SUCCESS;
+    opj_cparameters_t encoderParams;
+    opj_codec_t *codec = NULL;
+    opj_image_t *image = NULL;
+    opj_stream_t *stream = NULL;
+    nrt_IOInterface *compressed = NULL;
+    char *compressedBuf = NULL;
+    size_t compressedSize;
+    nrt_Uint32 width, height, tileWidth, tileHeight, x0, y0;
+    nrt_Uint32 thisTileWidth, thisTileHeight, thisTileSize, nComponents;
+    nrt_Uint32 nBytes, i;
+    nrt_Uint8 *newTileBuf = NULL;
+
+    width  = j2k_Container_getWidth(impl->container, error);
+    height = j2k_Container_getHeight(impl->container, error);
+    tileWidth  = j2k_Container_getTileWidth(impl->container, error);
+    tileHeight = j2k_Container_getTileHeight(impl->container, error);
+    nComponents = j2k_Container_getNumComponents(impl->container, error);
+    nBytes = (j2k_Container_getPrecision(impl->container, error) - 1) / 8 + 1;
+
+    x0 = tileX * tileWidth;
+    y0 = tileY * tileHeight;
+    if (x0 >= width || y0 >= height
+            || tileSize < (nrt_Uint64) tileWidth * tileHeight * nComponents
+                          * nBytes)
+    {
+        nrt_Error_initf(error, NRT_CTXT, NRT_ERR_INVALID_PARAMETER,
+                        "Invalid tile (%d, %d)", tileX, tileY);
+        goto CATCH_ERROR;
+    }
+
+    /* Check for edge case where we may have partial tile */
+    thisTileWidth = width - x0 < tileWidth ? width - x0 : tileWidth;
+    thisTileHeight = height - y0 < tileHeight ? height - y0 : tileHeight;
+    thisTileSize = thisTileWidth * thisTileHeight * nComponents * nBytes;
+
+    if (thisTileWidth < tileWidth || thisTileHeight < tileHeight)
+    {
+        /* Pack each component's rows into a buffer of the partial size */
+        const size_t srcStride = tileWidth * nBytes;
+        const size_t destStride = thisTileWidth * nBytes;
+        nrt_Uint32 row;
+
+        if (!(newTileBuf = (nrt_Uint8*) J2K_MALLOC(thisTileSize)))
+        {
+            nrt_Error_init(error, NRT_STRERROR(NRT_ERRNO), NRT_CTXT,
+                           NRT_ERR_MEMORY);
+            goto CATCH_ERROR;
+        }
+        for (i = 0; i < nComponents; ++i)
+        {
+            for (row = 0; row < thisTileHeight; ++row)
+            {
+                memcpy(newTileBuf + ((size_t) i * thisTileHeight + row)
+                           * destStride,
+                       buf + ((size_t) i * tileHeight + row) * srcStride,
+                       destStride);
+            }
+        }
+        buf = newTileBuf;
+    }
+
+    /* leave room for the headers when the tile does not compress */
+    compressedSize = (size_t) thisTileSize * 2 + 1024;
+    if (!(compressedBuf = (char*) J2K_MALLOC(compressedSize)))
+    {
+        nrt_Error_init(error, NRT_STRERROR(NRT_ERRNO), NRT_CTXT,
+                       NRT_ERR_MEMORY);
+        goto CATCH_ERROR;
+    }
+    if (!(compressed = nrt_BufferAdapter_construct(compressedBuf,
+                                                   compressedSize, 0, error)))
+    {
+        goto CATCH_ERROR;
+    }
+    if (!(stream = OpenJPEG_createIO(compressed, 0, 0, error)))
+    {
+        goto CATCH_ERROR;
+    }
+
+    if (!(codec = opj_create_compress(OPJ_CODEC_J2K)))
+    {
+        nrt_Error_init(error, "Error creating OpenJPEG codec", NRT_CTXT,
+                       NRT_ERR_INVALID_OBJECT);
+        goto CATCH_ERROR;
+    }
+
+    memset(error->message, 0, NRT_MAX_EMESSAGE);
+    if(!opj_set_error_handler(codec, OpenJPEG_errorHandler, error))
+    {
+        nrt_Error_init(error, "Unable to set OpenJPEG error handler", NRT_CTXT,
+                       NRT_ERR_UNK);
+        goto CATCH_ERROR;
+    }
+
+    if (!(image = OpenJPEG_createImage(impl->container, x0, y0, thisTileWidth,
+                                       thisTileHeight, error)))
+    {
+        goto CATCH_ERROR;
+    }
+
+    encoderParams = impl->encoderParams;
+    encoderParams.cp_tx0 = x0;
+    encoderParams.cp_ty0 = y0;
+
+    if (!opj_setup_encoder(codec, &encoderParams, image)
+            || !opj_start_compress(codec, image, stream)
+            || !opj_write_tile(codec, 0, (OPJ_BYTE*) buf, thisTileSize, stream)
+            || !opj_end_compress(codec, stream))
+    {
+        if (strlen(error->message) == 0)
+            nrt_Error_initf(error, NRT_CTXT, NRT_ERR_INVALID_OBJECT,
+                            "Error encoding tile (%d, %d)", tileX, tileY);
+        goto CATCH_ERROR;
+    }
+
+    *codestreamSize = (nrt_Uint64) nrt_IOInterface_tell(compressed, error);
+    *codestream = (nrt_Uint8*) compressedBuf;
+    compressedBuf = NULL;
+
+    goto CLEANUP;
+
+    CATCH_ERROR:
+    {
+        rc = NRT_FAILURE;
+    }
+
+    CLEANUP:
+    {
+        OpenJPEG_cleanup(&stream, &codec, &image);
+        if (compressed)
+            nrt_IOInterface_destruct(&compressed);
+        if (compressedBuf)
+            J2K_FREE(compressedBuf);
+        if (newTileBuf)
+            J2K_FREE(newTileBuf);
+    }
+
+    return rc;
+}
+
 J2KPRIV( j2k_Container*)
 OpenJPEGWriter_getContainer(J2K_USER_DATA *data, nrt_Error *error)
 {
@@ -1160,7 +1476,7 @@ J2KAPI(j2k_Writer*) j2k_Writer_construct(j2k_Container *container,
     j2k_Writer *writer = NULL;
     OpenJPEGWriterImpl *impl = NULL;
 
-    writer = (j2k_Writer*) J2K_MALLOC(sizeof(j2k_Container));
+    writer = (j2k_Writer*) J2K_MALLOC(sizeof(j2k_Writer));
     if (!writer)
     {
         nrt_Error_init(error, NRT_STRERROR(NRT_ERRNO), NRT_CTXT, NRT_ERR_MEMORY);
@@ -1185,6 +1501,7 @@ J2KAPI(j2k_Writer*) j2k_Writer_construct(j2k_Container *container,
 
     writer->data = impl;
     writer->iface = &WriterInterface;
+    j2k_Writer_setOptions(writer, writerOps);
 
     return writer;
 
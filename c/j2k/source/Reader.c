@@ -44,6 +44,38 @@ J2KAPI(nrt_Uint64) j2k_Reader_readRegion(j2k_Reader *reader,
     return reader->iface->readRegion(reader->data, x0, y0, x1, y1, buf, error);
 }
 
+J2KAPI(nrt_Uint64) j2k_Reader_readTileReduced(j2k_Reader *reader,
+        nrt_Uint32 tileX, nrt_Uint32 tileY, nrt_Uint32 discardLevels,
+        nrt_Uint8 **buf, nrt_Error *error)
+{
+    if (discardLevels == 0)
+        return j2k_Reader_readTile(reader, tileX, tileY, buf, error);
+    if (!reader->iface->readTileReduced)
+    {
+        nrt_Error_init(error, "Reduced resolution reads are not supported",
+                       NRT_CTXT, NRT_ERR_INVALID_OBJECT);
+        return 0;
+    }
+    return reader->iface->readTileReduced(reader->data, tileX, tileY,
+                                          discardLevels, buf, error);
+}
+
+J2KAPI(nrt_Uint64) j2k_Reader_readRegionReduced(j2k_Reader *reader,
+        nrt_Uint32 x0, nrt_Uint32 y0, nrt_Uint32 x1, nrt_Uint32 y1,
+        nrt_Uint32 discardLevels, nrt_Uint8 **buf, nrt_Error *error)
+{
+    if (discardLevels == 0)
+        return j2k_Reader_readRegion(reader, x0, y0, x1, y1, buf, error);
+    if (!reader->iface->readRegionReduced)
+    {
+        nrt_Error_init(error, "Reduced resolution reads are not supported",
+                       NRT_CTXT, NRT_ERR_INVALID_OBJECT);
+        return 0;
+    }
+    return reader->iface->readRegionReduced(reader->data, x0, y0, x1, y1,
+                                            discardLevels, buf, error);
+}
+
 J2KAPI(j2k_Container*) j2k_Reader_getContainer(j2k_Reader *reader,
                                                nrt_Error *error)
 {
@@ -0,0 +1,618 @@
+/* =========================================================================
+ * This file is part of NITRO
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2010, General Dynamics - Advanced Information Systems
+ *
+ * NITRO is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "j2k/TileIndex.h"
+
+/*
+ * Codestream markers used when indexing tile-parts
+ */
+#define J2K_MARKER_SOC 0xFF4F
+#define J2K_MARKER_SIZ 0xFF51
+#define J2K_MARKER_TLM 0xFF55
+#define J2K_MARKER_PLM 0xFF57
+#define J2K_MARKER_PPM 0xFF60
+#define J2K_MARKER_SOT 0xFF90
+#define J2K_MARKER_EOC 0xFFD9
+
+/* Length of an SOT marker segment, marker included */
+#define J2K_SOT_LENGTH 12
+
+/*
+ * The saved form of an index: the magic, numTiles, headerLength and
+ * numParts, then the tile, offset and length of each part, big-endian
+ */
+#define J2K_TILE_INDEX_MAGIC "J2KTIDX1"
+#define J2K_TILE_INDEX_HEADER_LENGTH 24
+#define J2K_TILE_INDEX_PART_LENGTH 16
+
+/*
+ * A tile-part found while indexing, before it is grouped by tile
+ */
+typedef struct _j2k_TilePartEntry
+{
+    nrt_Uint32 tile;
+    nrt_Uint64 offset;
+    nrt_Uint32 length;
+} j2k_TilePartEntry;
+
+J2KPRIV(nrt_Uint32) j2k_TileIndex_get16(const nrt_Uint8 *p)
+{
+    return ((nrt_Uint32) p[0] << 8) | p[1];
+}
+
+J2KPRIV(nrt_Uint32) j2k_TileIndex_get32(const nrt_Uint8 *p)
+{
+    return ((nrt_Uint32) p[0] << 24) | ((nrt_Uint32) p[1] << 16)
+        | ((nrt_Uint32) p[2] << 8) | p[3];
+}
+
+J2KPRIV(nrt_Uint64) j2k_TileIndex_get64(const nrt_Uint8 *p)
+{
+    return ((nrt_Uint64) j2k_TileIndex_get32(p) << 32)
+        | j2k_TileIndex_get32(p + 4);
+}
+
+J2KPRIV(void) j2k_TileIndex_put32(nrt_Uint8 *p, nrt_Uint32 value)
+{
+    p[0] = (nrt_Uint8) (value >> 24);
+    p[1] = (nrt_Uint8) (value >> 16);
+    p[2] = (nrt_Uint8) (value >> 8);
+    p[3] = (nrt_Uint8) value;
+}
+
+J2KPRIV(void) j2k_TileIndex_put64(nrt_Uint8 *p, nrt_Uint64 value)
+{
+    j2k_TileIndex_put32(p, (nrt_Uint32) (value >> 32));
+    j2k_TileIndex_put32(p + 4, (nrt_Uint32) value);
+}
+
+/*
+ * Appends a tile-part to a growing list
+ */
+J2KPRIV(NRT_BOOL) j2k_TileIndex_addEntry(j2k_TilePartEntry **entries,
+                                         nrt_Uint32 *numEntries,
+                                         nrt_Uint32 *capacity,
+                                         nrt_Uint32 tile, nrt_Uint64 offset,
+                                         nrt_Uint32 length, nrt_Error *error)
+{
+    j2k_TilePartEntry *grown = NULL;
+
+    if (*numEntries == *capacity)
+    {
+        *capacity = *capacity ? *capacity * 2 : 64;
+        if (!(grown = (j2k_TilePartEntry*) J2K_REALLOC(*entries,
+                                *capacity * sizeof(j2k_TilePartEntry))))
+        {
+            nrt_Error_init(error, NRT_STRERROR(NRT_ERRNO), NRT_CTXT,
+                           NRT_ERR_MEMORY);
+            return NRT_FAILURE;
+        }
+        *entries = grown;
+    }
+    (*entries)[*numEntries].tile = tile;
+    (*entries)[*numEntries].offset = offset;
+    (*entries)[*numEntries].length = length;
+    (*numEntries)++;
+    return NRT_SUCCESS;
+}
+
+/*
+ * Reads the TLM entries of one marker segment body (Ztlm onward).
+ * implicitTile counts the tile-parts of segments without tile numbers.
+ */
+J2KPRIV(NRT_BOOL) j2k_TileIndex_readTLM(const nrt_Uint8 *body,
+                                        nrt_Uint32 bodyLength,
+                                        nrt_Uint32 *implicitTile,
+                                        j2k_TilePartEntry **entries,
+                                        nrt_Uint32 *numEntries,
+                                        nrt_Uint32 *capacity,
+                                        nrt_Error *error)
+{
+    nrt_Uint32 st, sp, entrySize, pos, tile, length;
+
+    if (bodyLength < 2)
+    {
+        nrt_Error_init(error, "Invalid TLM marker segment", NRT_CTXT,
+                       NRT_ERR_INVALID_OBJECT);
+        return NRT_FAILURE;
+    }
+
+    /* Stlm: bits 4-5 are the size of Ttlm, bit 6 the size of Ptlm */
+    st = (body[1] >> 4) & 0x3;
+    sp = (body[1] >> 6) & 0x1;
+    if (st == 3)
+    {
+        nrt_Error_init(error, "Invalid TLM marker segment", NRT_CTXT,
+                       NRT_ERR_INVALID_OBJECT);
+        return NRT_FAILURE;
+    }
+    entrySize = st + (sp ? 4 : 2);
+
+    for (pos = 2; pos + entrySize <= bodyLength; pos += entrySize)
+    {
+        if (st == 0)
+            tile = (*implicitTile)++;
+        else if (st == 1)
+            tile = body[pos];
+        else
+            tile = j2k_TileIndex_get16(body + pos);
+
+        length = sp ? j2k_TileIndex_get32(body + pos + st)
+                    : j2k_TileIndex_get16(body + pos + st);
+
+        /* The offsets are filled in once the main header length is known */
+        if (!j2k_TileIndex_addEntry(entries, numEntries, capacity, tile, 0,
+                                    length, error))
+            return NRT_FAILURE;
+    }
+    return NRT_SUCCESS;
+}
+
+/*
+ * Groups the tile-parts by tile, keeping codestream order within a tile
+ */
+J2KPRIV(NRT_BOOL) j2k_TileIndex_build(j2k_TileIndex *index,
+                                      const j2k_TilePartEntry *entries,
+                                      nrt_Uint32 numEntries,
+                                      nrt_Error *error)
+{
+    nrt_Uint32 *next = NULL;
+    nrt_Uint32 i;
+
+    for (i = 0; i < numEntries; ++i)
+    {
+        if (entries[i].tile >= index->numTiles
+                || entries[i].length < J2K_SOT_LENGTH)
+        {
+            nrt_Error_initf(error, NRT_CTXT, NRT_ERR_INVALID_OBJECT,
+                            "Invalid tile-part %d (tile %d, %d bytes)", i,
+                            entries[i].tile, entries[i].length);
+            return NRT_FAILURE;
+        }
+    }
+
+    index->numParts = numEntries;
+    index->parts = (j2k_TilePart*) J2K_MALLOC(
+            (numEntries ? numEntries : 1) * sizeof(j2k_TilePart));
+    index->firstPart = (nrt_Uint32*) J2K_MALLOC(
+            (index->numTiles + 1) * sizeof(nrt_Uint32));
+    next = (nrt_Uint32*) J2K_MALLOC(index->numTiles * sizeof(nrt_Uint32));
+    if (!index->parts || !index->firstPart || !next)
+    {
+        nrt_Error_init(error, NRT_STRERROR(NRT_ERRNO), NRT_CTXT,
+                       NRT_ERR_MEMORY);
+        if (next)
+            J2K_FREE(next);
+        return NRT_FAILURE;
+    }
+
+    memset(index->firstPart, 0, (index->numTiles + 1) * sizeof(nrt_Uint32));
+    for (i = 0; i < numEntries; ++i)
+        index->firstPart[entries[i].tile + 1]++;
+    for (i = 0; i < index->numTiles; ++i)
+    {
+        index->firstPart[i + 1] += index->firstPart[i];
+        next[i] = index->firstPart[i];
+    }
+    for (i = 0; i < numEntries; ++i)
+    {
+        j2k_TilePart *part = &index->parts[next[entries[i].tile]++];
+        part->offset = entries[i].offset;
+        part->length = entries[i].length;
+    }
+
+    J2K_FREE(next);
+    return NRT_SUCCESS;
+}
+
+J2KPRIV(j2k_TileIndex*) j2k_TileIndex_new(nrt_Error *error)
+{
+    j2k_TileIndex *index = NULL;
+
+    if (!(index = (j2k_TileIndex*) J2K_MALLOC(sizeof(j2k_TileIndex))))
+    {
+        nrt_Error_init(error, NRT_STRERROR(NRT_ERRNO), NRT_CTXT,
+                       NRT_ERR_MEMORY);
+        return NULL;
+    }
+    memset(index, 0, sizeof(j2k_TileIndex));
+    return index;
+}
+
+J2KAPI(j2k_TileIndex*) j2k_TileIndex_construct(nrt_IOInterface *io,
+                                               nrt_Uint64 length,
+                                               nrt_Error *error)
+{
+    j2k_TileIndex *index = NULL;
+    j2k_TilePartEntry *entries = NULL;
+    nrt_Uint32 numEntries = 0, capacity = 0, implicitTile = 0;
+    nrt_Uint8 *body = NULL;
+    nrt_Uint8 segment[J2K_SOT_LENGTH];
+    nrt_Uint32 marker, segmentLength, partLength, i;
+    nrt_Uint32 tilesX, tilesY;
+    nrt_Uint64 pos, end, base;
+    NRT_BOOL haveTLM = NRT_FALSE;
+    nrt_Off offset;
+
+    if ((offset = nrt_IOInterface_tell(io, error)) < 0)
+        return NULL;
+    base = (nrt_Uint64) offset;
+    if (length)
+        end = length;
+    else
+    {
+        if ((offset = nrt_IOInterface_getSize(io, error)) < 0)
+            return NULL;
+        end = (nrt_Uint64) offset - base;
+    }
+
+    if (!(index = j2k_TileIndex_new(error)))
+        return NULL;
+
+    /* Main header: pick up the tile grid and any TLM segments */
+    if (end < 2 || !nrt_IOInterface_readAt(io, base, (char*) segment, 2, error))
+        goto CATCH_ERROR;
+    if (j2k_TileIndex_get16(segment) != J2K_MARKER_SOC)
+    {
+        nrt_Error_init(error, "Codestream does not start with SOC", NRT_CTXT,
+                       NRT_ERR_INVALID_OBJECT);
+        goto CATCH_ERROR;
+    }
+
+    for (pos = 2;; pos += 2 + segmentLength)
+    {
+        if (pos + 4 > end
+                || !nrt_IOInterface_readAt(io, base + pos, (char*) segment, 4, error))
+        {
+            nrt_Error_init(error, "Main header has no SOT marker", NRT_CTXT,
+                           NRT_ERR_INVALID_OBJECT);
+            goto CATCH_ERROR;
+        }
+        marker = j2k_TileIndex_get16(segment);
+        segmentLength = j2k_TileIndex_get16(segment + 2);
+        if (marker == J2K_MARKER_SOT)
+            break;
+        if ((marker & 0xFF00) != 0xFF00 || segmentLength < 2
+                || pos + 2 + segmentLength > end)
+        {
+            nrt_Error_initf(error, NRT_CTXT, NRT_ERR_INVALID_OBJECT,
+                            "Invalid marker segment at offset %lld",
+                            (long long) pos);
+            goto CATCH_ERROR;
+        }
+
+        if (marker == J2K_MARKER_PPM)
+        {
+            /* Packet headers for every tile live in the main header */
+            nrt_Error_init(error, "Codestreams with PPM marker segments "
+                           "cannot be split by tile", NRT_CTXT,
+                           NRT_ERR_INVALID_OBJECT);
+            goto CATCH_ERROR;
+        }
+        if (marker != J2K_MARKER_SIZ && marker != J2K_MARKER_TLM)
+            continue;
+
+        if (!(body = (nrt_Uint8*) J2K_MALLOC(segmentLength)))
+        {
+            nrt_Error_init(error, NRT_STRERROR(NRT_ERRNO), NRT_CTXT,
+                           NRT_ERR_MEMORY);
+            goto CATCH_ERROR;
+        }
+        if (!nrt_IOInterface_readAt(io, base + pos + 4, (char*) body,
+                                    segmentLength - 2, error))
+            goto CATCH_ERROR;
+
+        if (marker == J2K_MARKER_SIZ)
+        {
+            nrt_Uint32 xsiz, ysiz, xtsiz, ytsiz, xtosiz, ytosiz;
+
+            /* Rsiz, Xsiz, Ysiz, XOsiz, YOsiz, XTsiz, YTsiz, XTOsiz, YTOsiz */
+            if (segmentLength < 38)
+            {
+                nrt_Error_init(error, "Invalid SIZ marker segment", NRT_CTXT,
+                               NRT_ERR_INVALID_OBJECT);
+                goto CATCH_ERROR;
+            }
+            xsiz = j2k_TileIndex_get32(body + 2);
+            ysiz = j2k_TileIndex_get32(body + 6);
+            xtsiz = j2k_TileIndex_get32(body + 18);
+            ytsiz = j2k_TileIndex_get32(body + 22);
+            xtosiz = j2k_TileIndex_get32(body + 26);
+            ytosiz = j2k_TileIndex_get32(body + 30);
+            if (!xtsiz || !ytsiz || xtosiz >= xsiz || ytosiz >= ysiz)
+            {
+                nrt_Error_init(error, "Invalid SIZ marker segment", NRT_CTXT,
+                               NRT_ERR_INVALID_OBJECT);
+                goto CATCH_ERROR;
+            }
+            tilesX = (xsiz - xtosiz - 1) / xtsiz + 1;
+            tilesY = (ysiz - ytosiz - 1) / ytsiz + 1;
+            index->numTiles = tilesX * tilesY;
+        }
+        else
+        {
+            haveTLM = NRT_TRUE;
+            if (!j2k_TileIndex_readTLM(body, segmentLength - 2, &implicitTile,
+                                       &entries, &numEntries, &capacity,
+                                       error))
+                goto CATCH_ERROR;
+        }
+        J2K_FREE(body);
+        body = NULL;
+    }
+
+    if (!index->numTiles)
+    {
+        nrt_Error_init(error, "Main header has no SIZ marker", NRT_CTXT,
+                       NRT_ERR_INVALID_OBJECT);
+        goto CATCH_ERROR;
+    }
+    index->headerLength = pos;
+
+    if (haveTLM)
+    {
+        /* The tile-parts follow the main header back to back */
+        for (i = 0; i < numEntries; ++i)
+        {
+            entries[i].offset = pos;
+            pos += entries[i].length;
+        }
+        if (pos > end)
+        {
+            nrt_Error_init(error, "TLM lengths run past the codestream",
+                           NRT_CTXT, NRT_ERR_INVALID_OBJECT);
+            goto CATCH_ERROR;
+        }
+    }
+    else
+    {
+        /* Hop from SOT to SOT using Psot */
+        while (pos + J2K_SOT_LENGTH <= end)
+        {
+            if (!nrt_IOInterface_readAt(io, base + pos, (char*) segment,
+                                        J2K_SOT_LENGTH, error))
+                goto CATCH_ERROR;
+            marker = j2k_TileIndex_get16(segment);
+            if (marker == J2K_MARKER_EOC)
+                break;
+            if (marker != J2K_MARKER_SOT)
+            {
+                nrt_Error_initf(error, NRT_CTXT, NRT_ERR_INVALID_OBJECT,
+                                "Expected SOT marker at offset %lld",
+                                (long long) pos);
+                goto CATCH_ERROR;
+            }
+
+            /* Lsot, Isot, Psot, TPsot, TNsot */
+            partLength = j2k_TileIndex_get32(segment + 6);
+            if (partLength == 0)
+            {
+                /* The last tile-part runs to the EOC marker */
+                partLength = (nrt_Uint32) (end - pos - 2);
+            }
+            if (partLength < J2K_SOT_LENGTH || pos + partLength > end)
+            {
+                nrt_Error_initf(error, NRT_CTXT, NRT_ERR_INVALID_OBJECT,
+                                "Invalid tile-part length at offset %lld",
+                                (long long) pos);
+                goto CATCH_ERROR;
+            }
+            if (!j2k_TileIndex_addEntry(&entries, &numEntries, &capacity,
+                                        j2k_TileIndex_get16(segment + 4),
+                                        pos, partLength, error))
+                goto CATCH_ERROR;
+            pos += partLength;
+        }
+    }
+
+    if (!j2k_TileIndex_build(index, entries, numEntries, error))
+        goto CATCH_ERROR;
+
+    if (entries)
+        J2K_FREE(entries);
+    return index;
+
+  CATCH_ERROR:
+    {
+        if (body)
+            J2K_FREE(body);
+        if (entries)
+            J2K_FREE(entries);
+        j2k_TileIndex_destruct(&index);
+        return NULL;
+    }
+}
+
+J2KAPI(j2k_TileIndex*) j2k_TileIndex_load(nrt_IOInterface *io,
+                                          nrt_Error *error)
+{
+    j2k_TileIndex *index = NULL;
+    j2k_TilePartEntry *entries = NULL;
+    nrt_Uint8 header[J2K_TILE_INDEX_HEADER_LENGTH];
+    nrt_Uint8 record[J2K_TILE_INDEX_PART_LENGTH];
+    nrt_Uint32 numParts, i;
+
+    if (!(index = j2k_TileIndex_new(error)))
+        return NULL;
+
+    if (!nrt_IOInterface_read(io, (char*) header, sizeof(header), error))
+        goto CATCH_ERROR;
+    if (memcmp(header, J2K_TILE_INDEX_MAGIC, 8) != 0)
+    {
+        nrt_Error_init(error, "Not a J2K tile index", NRT_CTXT,
+                       NRT_ERR_INVALID_OBJECT);
+        goto CATCH_ERROR;
+    }
+    index->numTiles = j2k_TileIndex_get32(header + 8);
+    index->headerLength = j2k_TileIndex_get64(header + 12);
+    numParts = j2k_TileIndex_get32(header + 20);
+    if (!index->numTiles)
+    {
+        nrt_Error_init(error, "Invalid J2K tile index", NRT_CTXT,
+                       NRT_ERR_INVALID_OBJECT);
+        goto CATCH_ERROR;
+    }
+
+    if (!(entries = (j2k_TilePartEntry*) J2K_MALLOC(
+            (numParts ? numParts : 1) * sizeof(j2k_TilePartEntry))))
+    {
+        nrt_Error_init(error, NRT_STRERROR(NRT_ERRNO), NRT_CTXT,
+                       NRT_ERR_MEMORY);
+        goto CATCH_ERROR;
+    }
+    for (i = 0; i < numParts; ++i)
+    {
+        if (!nrt_IOInterface_read(io, (char*) record, sizeof(record), error))
+            goto CATCH_ERROR;
+        entries[i].tile = j2k_TileIndex_get32(record);
+        entries[i].offset = j2k_TileIndex_get64(record + 4);
+        entries[i].length = j2k_TileIndex_get32(record + 12);
+    }
+
+    if (!j2k_TileIndex_build(index, entries, numParts, error))
+        goto CATCH_ERROR;
+
+    J2K_FREE(entries);
+    return index;
+
+  CATCH_ERROR:
+    {
+        if (entries)
+            J2K_FREE(entries);
+        j2k_TileIndex_destruct(&index);
+        return NULL;
+    }
+}
+
+J2KAPI(NRT_BOOL) j2k_TileIndex_save(j2k_TileIndex *index,
+                                    nrt_IOInterface *io,
+                                    nrt_Error *error)
+{
+    nrt_Uint8 header[J2K_TILE_INDEX_HEADER_LENGTH];
+    nrt_Uint8 record[J2K_TILE_INDEX_PART_LENGTH];
+    nrt_Uint32 tile, i;
+
+    memcpy(header, J2K_TILE_INDEX_MAGIC, 8);
+    j2k_TileIndex_put32(header + 8, index->numTiles);
+    j2k_TileIndex_put64(header + 12, index->headerLength);
+    j2k_TileIndex_put32(header + 20, index->numParts);
+    if (!nrt_IOInterface_write(io, (char*) header, sizeof(header), error))
+        return NRT_FAILURE;
+
+    for (tile = 0; tile < index->numTiles; ++tile)
+    {
+        for (i = index->firstPart[tile]; i < index->firstPart[tile + 1]; ++i)
+        {
+            j2k_TileIndex_put32(record, tile);
+            j2k_TileIndex_put64(record + 4, index->parts[i].offset);
+            j2k_TileIndex_put32(record + 12, index->parts[i].length);
+            if (!nrt_IOInterface_write(io, (char*) record, sizeof(record),
+                                       error))
+                return NRT_FAILURE;
+        }
+    }
+    return NRT_SUCCESS;
+}
+
+J2KAPI(nrt_Uint8*) j2k_TileIndex_readTile(j2k_TileIndex *index,
+                                          nrt_IOInterface *io,
+                                          nrt_Off offset,
+                                          nrt_Uint32 tile,
+                                          nrt_Uint64 *size,
+                                          nrt_Error *error)
+{
+    nrt_Uint8 *buf = NULL;
+    nrt_Uint64 total, pos, in;
+    nrt_Uint32 marker, segmentLength, i;
+
+    if (tile >= index->numTiles)
+    {
+        nrt_Error_initf(error, NRT_CTXT, NRT_ERR_INVALID_PARAMETER,
+                        "Tile %d is out of range", tile);
+        return NULL;
+    }
+
+    total = index->headerLength + 2;
+    for (i = index->firstPart[tile]; i < index->firstPart[tile + 1]; ++i)
+        total += index->parts[i].length;
+
+    if (!(buf = (nrt_Uint8*) J2K_MALLOC(total)))
+    {
+        nrt_Error_init(error, NRT_STRERROR(NRT_ERRNO), NRT_CTXT,
+                       NRT_ERR_MEMORY);
+        return NULL;
+    }
+    if (!nrt_IOInterface_readAt(io, offset, (char*) buf,
+                                index->headerLength, error))
+        goto CATCH_ERROR;
+
+    /* Drop the segments that describe the tile-parts of every tile */
+    for (in = pos = 2; in + 4 <= index->headerLength; in += 2 + segmentLength)
+    {
+        marker = j2k_TileIndex_get16(buf + in);
+        segmentLength = j2k_TileIndex_get16(buf + in + 2);
+        if (in + 2 + segmentLength > index->headerLength)
+        {
+            nrt_Error_init(error, "Invalid main header", NRT_CTXT,
+                           NRT_ERR_INVALID_OBJECT);
+            goto CATCH_ERROR;
+        }
+        if (marker == J2K_MARKER_TLM || marker == J2K_MARKER_PLM)
+            continue;
+        if (pos != in)
+            memmove(buf + pos, buf + in, 2 + segmentLength);
+        pos += 2 + segmentLength;
+    }
+
+    for (i = index->firstPart[tile]; i < index->firstPart[tile + 1]; ++i)
+    {
+        if (!nrt_IOInterface_readAt(io, offset + index->parts[i].offset,
+                                    (char*) buf + pos,
+                                    index->parts[i].length, error))
+            goto CATCH_ERROR;
+        pos += index->parts[i].length;
+    }
+    buf[pos++] = (nrt_Uint8) (J2K_MARKER_EOC >> 8);
+    buf[pos++] = (nrt_Uint8) J2K_MARKER_EOC;
+
+    *size = pos;
+    return buf;
+
+  CATCH_ERROR:
+    {
+        J2K_FREE(buf);
+        return NULL;
+    }
+}
+
+J2KAPI(void) j2k_TileIndex_destruct(j2k_TileIndex **index)
+{
+    if (*index)
+    {
+        if ((*index)->parts)
+            J2K_FREE((*index)->parts);
+        if ((*index)->firstPart)
+            J2K_FREE((*index)->firstPart);
+        J2K_FREE(*index);
+        *index = NULL;
+    }
+}
@@ -22,6 +22,421 @@
 
 #include "j2k/Writer.h"
 
+/*
+ * Codestream markers used when splicing single-tile codestreams
+ */
+#define J2K_MARKER_SOC 0xFF4F
+#define J2K_MARKER_SIZ 0xFF51
+#define J2K_MARKER_SOT 0xFF90
+#define J2K_MARKER_EOC 0xFFD9
+
+/*
+ * An uncompressed tile waiting for the encode threads
+ */
+typedef struct _j2k_PendingTile
+{
+    nrt_Uint32 tileX;
+    nrt_Uint32 tileY;
+    nrt_Uint8 *buf;
+    nrt_Uint32 bufSize;
+} j2k_PendingTile;
+
+/*
+ * Tiles queued for concurrent encoding and the codestreams of the tiles
+ * encoded so far, indexed by tile number
+ */
+typedef struct _j2k_TileBatch
+{
+    j2k_Writer *writer;
+    nrt_Uint32 tilesX;
+    nrt_Uint32 numTiles;
+    j2k_PendingTile *pending;
+    nrt_Uint32 numPending;
+    nrt_Uint64 pendingBytes;
+    nrt_Uint8 **codestreams;
+    nrt_Uint64 *codestreamSizes;
+
+    /* Shared by the encode threads during a flush */
+    nrt_Mutex lock;
+    nrt_Uint32 next;
+    int failed;
+    nrt_Error error;
+} j2k_TileBatch;
+
+J2KPRIV(nrt_Uint32) j2k_Writer_get16(const nrt_Uint8 *p)
+{
+    return ((nrt_Uint32) p[0] << 8) | p[1];
+}
+
+J2KPRIV(nrt_Uint32) j2k_Writer_get32(const nrt_Uint8 *p)
+{
+    return ((nrt_Uint32) p[0] << 24) | ((nrt_Uint32) p[1] << 16)
+        | ((nrt_Uint32) p[2] << 8) | p[3];
+}
+
+J2KPRIV(void) j2k_Writer_put16(nrt_Uint8 *p, nrt_Uint32 value)
+{
+    p[0] = (nrt_Uint8) (value >> 8);
+    p[1] = (nrt_Uint8) value;
+}
+
+J2KPRIV(void) j2k_Writer_put32(nrt_Uint8 *p, nrt_Uint32 value)
+{
+    p[0] = (nrt_Uint8) (value >> 24);
+    p[1] = (nrt_Uint8) (value >> 16);
+    p[2] = (nrt_Uint8) (value >> 8);
+    p[3] = (nrt_Uint8) value;
+}
+
+J2KPRIV(void) j2k_TileBatch_destruct(j2k_TileBatch **batch)
+{
+    nrt_Uint32 i;
+
+    if (*batch)
+    {
+        if ((*batch)->pending)
+        {
+            for (i = 0; i < (*batch)->numPending; ++i)
+                J2K_FREE((*batch)->pending[i].buf);
+            J2K_FREE((*batch)->pending);
+        }
+        if ((*batch)->codestreams)
+        {
+            for (i = 0; i < (*batch)->numTiles; ++i)
+            {
+                if ((*batch)->codestreams[i])
+                    J2K_FREE((*batch)->codestreams[i]);
+            }
+            J2K_FREE((*batch)->codestreams);
+        }
+        if ((*batch)->codestreamSizes)
+            J2K_FREE((*batch)->codestreamSizes);
+        nrt_Mutex_delete(&(*batch)->lock);
+        J2K_FREE(*batch);
+        *batch = NULL;
+    }
+}
+
+J2KPRIV(j2k_TileBatch*) j2k_TileBatch_construct(j2k_Writer *writer,
+                                                nrt_Error *error)
+{
+    j2k_TileBatch *batch = NULL;
+    j2k_Container *container = NULL;
+
+    if (!(container = writer->iface->getContainer(writer->data, error)))
+        return NULL;
+
+    batch = (j2k_TileBatch*) J2K_MALLOC(sizeof(j2k_TileBatch));
+    if (!batch)
+    {
+        nrt_Error_init(error, NRT_STRERROR(NRT_ERRNO), NRT_CTXT, NRT_ERR_MEMORY);
+        return NULL;
+    }
+    memset(batch, 0, sizeof(j2k_TileBatch));
+    nrt_Mutex_init(&batch->lock);
+    batch->writer = writer;
+    batch->tilesX = j2k_Container_getTilesX(container, error);
+    batch->numTiles = batch->tilesX * j2k_Container_getTilesY(container, error);
+
+    batch->pending = (j2k_PendingTile*) J2K_MALLOC(
+            sizeof(j2k_PendingTile) * batch->numTiles);
+    batch->codestreams = (nrt_Uint8**) J2K_MALLOC(
+            sizeof(nrt_Uint8*) * batch->numTiles);
+    batch->codestreamSizes = (nrt_Uint64*) J2K_MALLOC(
+            sizeof(nrt_Uint64) * batch->numTiles);
+    if (!batch->pending || !batch->codestreams || !batch->codestreamSizes)
+    {
+        nrt_Error_init(error, NRT_STRERROR(NRT_ERRNO), NRT_CTXT, NRT_ERR_MEMORY);
+        j2k_TileBatch_destruct(&batch);
+        return NULL;
+    }
+    memset(batch->codestreams, 0, sizeof(nrt_Uint8*) * batch->numTiles);
+    memset(batch->codestreamSizes, 0, sizeof(nrt_Uint64) * batch->numTiles);
+    return batch;
+}
+
+/*
+ * Encode thread body, takes pending tiles until there are none left or
+ * another thread has failed
+ */
+J2KPRIV(void) j2k_TileBatch_encodeWorker(void *data)
+{
+    j2k_TileBatch *batch = (j2k_TileBatch*) data;
+    j2k_Writer *writer = batch->writer;
+    j2k_PendingTile *tile = NULL;
+    nrt_Uint8 *codestream = NULL;
+    nrt_Uint64 codestreamSize;
+    nrt_Uint32 tileIdx;
+    nrt_Error error;
+
+    for (;;)
+    {
+        nrt_Mutex_lock(&batch->lock);
+        if (batch->failed || batch->next >= batch->numPending)
+        {
+            nrt_Mutex_unlock(&batch->lock);
+            return;
+        }
+        tile = &batch->pending[batch->next++];
+        nrt_Mutex_unlock(&batch->lock);
+
+        codestream = NULL;
+        codestreamSize = 0;
+        if (!writer->iface->encodeTile(writer->data, tile->tileX, tile->tileY,
+                                       tile->buf, tile->bufSize, &codestream,
+                                       &codestreamSize, &error))
+        {
+            nrt_Mutex_lock(&batch->lock);
+            if (!batch->failed)
+            {
+                batch->failed = 1;
+                batch->error = error;
+            }
+            nrt_Mutex_unlock(&batch->lock);
+            return;
+        }
+
+        tileIdx = tile->tileY * batch->tilesX + tile->tileX;
+        nrt_Mutex_lock(&batch->lock);
+        if (batch->codestreams[tileIdx])
+            J2K_FREE(batch->codestreams[tileIdx]);
+        batch->codestreams[tileIdx] = codestream;
+        batch->codestreamSizes[tileIdx] = codestreamSize;
+        nrt_Mutex_unlock(&batch->lock);
+    }
+}
+
+/*
+ * Encodes the pending tiles on the Writer's threads, the calling thread
+ * included, and releases their uncompressed data
+ */
+J2KPRIV(NRT_BOOL) j2k_TileBatch_flush(j2k_TileBatch *batch, nrt_Error *error)
+{
+    nrt_Thread *threads = NULL;
+    nrt_Error threadError;
+    nrt_Uint32 nThreads, nStarted, i;
+
+    if (batch->numPending == 0)
+        return NRT_SUCCESS;
+
+    batch->next = 0;
+    batch->failed = 0;
+
+    nThreads = batch->writer->numThreads;
+    if (nThreads > batch->numPending)
+        nThreads = batch->numPending;
+    nThreads -= 1;
+
+    nStarted = 0;
+    if (nThreads > 0)
+        threads = (nrt_Thread*) J2K_MALLOC(sizeof(nrt_Thread) * nThreads);
+    if (threads)
+    {
+        /* If a thread cannot be started, make do with the ones that were */
+        while (nStarted < nThreads
+               && nrt_Thread_create(&threads[nStarted],
+                                    j2k_TileBatch_encodeWorker, batch,
+                                    &threadError))
+            ++nStarted;
+    }
+
+    j2k_TileBatch_encodeWorker(batch);
+
+    for (i = 0; i < nStarted; ++i)
+        nrt_Thread_join(&threads[i]);
+    if (threads)
+        J2K_FREE(threads);
+
+    for (i = 0; i < batch->numPending; ++i)
+        J2K_FREE(batch->pending[i].buf);
+    batch->numPending = 0;
+    batch->pendingBytes = 0;
+
+    if (batch->failed)
+    {
+        *error = batch->error;
+        return NRT_FAILURE;
+    }
+    return NRT_SUCCESS;
+}
+
+J2KPRIV(NRT_BOOL) j2k_TileBatch_addTile(j2k_TileBatch *batch,
+                                        nrt_Uint32 tileX, nrt_Uint32 tileY,
+                                        nrt_Uint8 *buf, nrt_Uint32 bufSize,
+                                        nrt_Error *error)
+{
+    j2k_PendingTile *tile = NULL;
+
+    if (tileX >= batch->tilesX || tileY * batch->tilesX + tileX
+            >= batch->numTiles)
+    {
+        nrt_Error_initf(error, NRT_CTXT, NRT_ERR_INVALID_PARAMETER,
+                        "Invalid tile (%d, %d)", tileX, tileY);
+        return NRT_FAILURE;
+    }
+
+    /* Encode what is queued rather than go over the memory limit */
+    if (batch->numPending == batch->numTiles || (batch->numPending > 0
+            && batch->pendingBytes + bufSize > batch->writer->maxPendingBytes))
+    {
+        if (!j2k_TileBatch_flush(batch, error))
+            return NRT_FAILURE;
+    }
+
+    tile = &batch->pending[batch->numPending];
+    if (!(tile->buf = (nrt_Uint8*) J2K_MALLOC(bufSize ? bufSize : 1)))
+    {
+        nrt_Error_init(error, NRT_STRERROR(NRT_ERRNO), NRT_CTXT, NRT_ERR_MEMORY);
+        return NRT_FAILURE;
+    }
+    memcpy(tile->buf, buf, bufSize);
+    tile->tileX = tileX;
+    tile->tileY = tileY;
+    tile->bufSize = bufSize;
+    batch->numPending++;
+    batch->pendingBytes += bufSize;
+    return NRT_SUCCESS;
+}
+
+/*
+ * Returns the offset of the first SOT marker of a codestream, or 0 if the
+ * main header is malformed
+ */
+J2KPRIV(nrt_Uint64) j2k_Writer_findFirstTile(const nrt_Uint8 *codestream,
+                                             nrt_Uint64 size,
+                                             nrt_Uint64 *sizOffset)
+{
+    nrt_Uint64 pos = 2;
+    nrt_Uint32 marker;
+
+    if (size < 2 || j2k_Writer_get16(codestream) != J2K_MARKER_SOC)
+        return 0;
+
+    while (pos + 4 <= size)
+    {
+        marker = j2k_Writer_get16(codestream + pos);
+        if (marker == J2K_MARKER_SOT)
+            return pos;
+        if (marker == J2K_MARKER_SIZ && sizOffset)
+            *sizOffset = pos;
+        pos += 2 + j2k_Writer_get16(codestream + pos + 2);
+    }
+    return 0;
+}
+
+/*
+ * Writes the full codestream: the main header of the first tile with its
+ * SIZ marker widened to the whole image, then the tile-parts of every tile
+ * renumbered to their tile index, in index order
+ */
+J2KPRIV(NRT_BOOL) j2k_TileBatch_write(j2k_TileBatch *batch,
+                                      nrt_IOInterface *io, nrt_Error *error)
+{
+    j2k_Container *container = NULL;
+    nrt_Uint8 *codestream = NULL;
+    nrt_Uint64 size, pos, sizOffset, partSize;
+    nrt_Uint8 eoc[2];
+    nrt_Uint32 i;
+
+    if (!(container = batch->writer->iface->getContainer(batch->writer->data,
+                                                         error)))
+        return NRT_FAILURE;
+
+    for (i = 0; i < batch->numTiles; ++i)
+    {
+        if (!batch->codestreams[i])
+        {
+            nrt_Error_initf(error, NRT_CTXT, NRT_ERR_INVALID_OBJECT,
+                            "Tile %d was never set", i);
+            return NRT_FAILURE;
+        }
+    }
+
+    for (i = 0; i < batch->numTiles; ++i)
+    {
+        codestream = batch->codestreams[i];
+        size = batch->codestreamSizes[i];
+        sizOffset = 0;
+        if (!(pos = j2k_Writer_findFirstTile(codestream, size, &sizOffset))
+                || (i == 0 && (sizOffset == 0 || sizOffset + 38 > pos)))
+        {
+            nrt_Error_initf(error, NRT_CTXT, NRT_ERR_INVALID_OBJECT,
+                            "Invalid codestream for tile %d", i);
+            return NRT_FAILURE;
+        }
+
+        if (i == 0)
+        {
+            /* Xsiz, Ysiz, XOsiz, YOsiz, XTsiz, YTsiz, XTOsiz, YTOsiz */
+            j2k_Writer_put32(codestream + sizOffset + 6,
+                             j2k_Container_getGridWidth(container, error));
+            j2k_Writer_put32(codestream + sizOffset + 10,
+                             j2k_Container_getGridHeight(container, error));
+            j2k_Writer_put32(codestream + sizOffset + 14, 0);
+            j2k_Writer_put32(codestream + sizOffset + 18, 0);
+            j2k_Writer_put32(codestream + sizOffset + 22,
+                             j2k_Container_getTileWidth(container, error));
+            j2k_Writer_put32(codestream + sizOffset + 26,
+                             j2k_Container_getTileHeight(container, error));
+            j2k_Writer_put32(codestream + sizOffset + 30, 0);
+            j2k_Writer_put32(codestream + sizOffset + 34, 0);
+
+            if (!nrt_IOInterface_write(io, (const char*) codestream,
+                                       (size_t) pos, error))
+                return NRT_FAILURE;
+        }
+
+        while (pos + 12 <= size
+                && j2k_Writer_get16(codestream + pos) == J2K_MARKER_SOT)
+        {
+            /*
+             * Psot of 0 means the tile-part runs to the EOC marker. That
+             * is only allowed for the last tile-part of the output, so the
+             * real length is written in its place
+             */
+            partSize = j2k_Writer_get32(codestream + pos + 6);
+            if (partSize == 0)
+            {
+                if (j2k_Writer_get16(codestream + size - 2) != J2K_MARKER_EOC
+                        || size - 2 - pos > 0xFFFFFFFF)
+                {
+                    nrt_Error_initf(error, NRT_CTXT, NRT_ERR_INVALID_OBJECT,
+                                    "Unterminated tile-part in codestream "
+                                    "for tile %d", i);
+                    return NRT_FAILURE;
+                }
+                partSize = size - 2 - pos;
+                j2k_Writer_put32(codestream + pos + 6, (nrt_Uint32) partSize);
+            }
+            if (partSize < 12 || pos + partSize > size)
+            {
+                nrt_Error_initf(error, NRT_CTXT, NRT_ERR_INVALID_OBJECT,
+                                "Invalid tile-part in codestream for tile %d",
+                                i);
+                return NRT_FAILURE;
+            }
+
+            j2k_Writer_put16(codestream + pos + 4, i);
+            if (!nrt_IOInterface_write(io, (const char*) (codestream + pos),
+                                       (size_t) partSize, error))
+                return NRT_FAILURE;
+            pos += partSize;
+        }
+    }
+
+    j2k_Writer_put16(eoc, J2K_MARKER_EOC);
+    return nrt_IOInterface_write(io, (const char*) eoc, 2, error);
+}
+
+J2KPROT(void) j2k_Writer_setOptions(j2k_Writer *writer,
+                                    j2k_WriterOptions *options)
+{
+    writer->numThreads = options ? options->numThreads : 0;
+    writer->maxPendingBytes = options ? options->maxPendingBytes : 0;
+    if (writer->maxPendingBytes == 0)
+        writer->maxPendingBytes = J2K_WRITER_DEFAULT_MAX_PENDING;
+}
+
 J2KAPI(NRT_BOOL) j2k_Writer_setTile(j2k_Writer *writer,
                                     nrt_Uint32 tileX,
                                     nrt_Uint32 tileY,
@@ -29,6 +444,14 @@ J2KAPI(NRT_BOOL) j2k_Writer_setTile(j2k_Writer *writer,
                                     nrt_Uint32 bufSize,
                                     nrt_Error *error)
 {
+    if (writer->numThreads > 1 && writer->iface->encodeTile)
+    {
+        if (!writer->batch
+                && !(writer->batch = j2k_TileBatch_construct(writer, error)))
+            return NRT_FAILURE;
+        return j2k_TileBatch_addTile(writer->batch, tileX, tileY, buf,
+                                     bufSize, error);
+    }
     return writer->iface->setTile(writer->data, tileX, tileY, buf, bufSize, error);
 }
 
@@ -36,6 +459,12 @@ J2KAPI(NRT_BOOL) j2k_Writer_write(j2k_Writer *writer,
                                   nrt_IOInterface *io,
                                   nrt_Error *error)
 {
+    if (writer->batch)
+    {
+        if (!j2k_TileBatch_flush(writer->batch, error))
+            return NRT_FAILURE;
+        return j2k_TileBatch_write(writer->batch, io, error);
+    }
     return writer->iface->write(writer->data, io, error);
 }
 
@@ -51,6 +480,7 @@ J2KAPI(void) j2k_Writer_destruct(j2k_Writer **writer)
     {
         if ((*writer)->iface && (*writer)->data)
             (*writer)->iface->destruct((*writer)->data);
+        j2k_TileBatch_destruct(&(*writer)->batch);
         J2K_FREE(*writer);
         *writer = NULL;
     }
@@ -0,0 +1,157 @@
+/* =========================================================================
+ * This file is part of NITRO
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2010, General Dynamics - Advanced Information Systems
+ *
+ * NITRO is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <import/nrt.h>
+#include <import/j2k.h>
+
+/*
+ * Indexes the tile-parts of a raw codestream, optionally saves the index,
+ * checks that it reloads the same, and writes one tile as its own
+ * codestream
+ */
+int main(int argc, char **argv)
+{
+    int rc = 0;
+    nrt_Error error;
+    nrt_IOInterface *io = NULL;
+    nrt_IOInterface *indexIO = NULL;
+    j2k_TileIndex *index = NULL;
+    j2k_TileIndex *loaded = NULL;
+    int argIt = 0;
+    char *fname = NULL;
+    char *indexName = NULL;
+    char filename[NRT_MAX_PATH];
+    nrt_Uint32 tile = 0;
+    nrt_Uint32 i;
+    nrt_Uint64 tileSize = 0;
+    nrt_Uint8 *tileBuf = NULL;
+    nrt_IOHandle outHandle = NRT_INVALID_HANDLE_VALUE;
+
+    for (argIt = 1; argIt < argc; ++argIt)
+    {
+        if (strcmp(argv[argIt], "--tile") == 0)
+        {
+            if (argIt >= argc - 1)
+                goto CATCH_ERROR;
+            tile = atoi(argv[++argIt]);
+        }
+        else if (strcmp(argv[argIt], "--index") == 0)
+        {
+            if (argIt >= argc - 1)
+                goto CATCH_ERROR;
+            indexName = argv[++argIt];
+        }
+        else if (!fname)
+        {
+            fname = argv[argIt];
+        }
+    }
+
+    if (!fname)
+    {
+        printf("Usage: %s [--tile --index] <j2k-file>\n", argv[0]);
+        goto CATCH_ERROR;
+    }
+
+    if (!(io = nrt_IOHandleAdapter_open(fname, NRT_ACCESS_READONLY,
+                                        NRT_OPEN_EXISTING, &error)))
+        goto CATCH_ERROR;
+    if (!(index = j2k_TileIndex_construct(io, 0, &error)))
+        goto CATCH_ERROR;
+
+    printf("Tiles: %d, tile-parts: %d, main header: %lld bytes\n",
+           index->numTiles, index->numParts,
+           (long long) index->headerLength);
+
+    if (indexName)
+    {
+        if (!(indexIO = nrt_IOHandleAdapter_open(indexName,
+                                                 NRT_ACCESS_WRITEONLY,
+                                                 NRT_CREATE, &error)))
+            goto CATCH_ERROR;
+        if (!j2k_TileIndex_save(index, indexIO, &error))
+            goto CATCH_ERROR;
+        nrt_IOInterface_destruct(&indexIO);
+
+        if (!(indexIO = nrt_IOHandleAdapter_open(indexName,
+                                                 NRT_ACCESS_READONLY,
+                                                 NRT_OPEN_EXISTING, &error)))
+            goto CATCH_ERROR;
+        if (!(loaded = j2k_TileIndex_load(indexIO, &error)))
+            goto CATCH_ERROR;
+
+        if (loaded->numTiles != index->numTiles
+                || loaded->numParts != index->numParts
+                || loaded->headerLength != index->headerLength)
+        {
+            printf("Reloaded index does not match\n");
+            rc = 1;
+        }
+        for (i = 0; rc == 0 && i < index->numParts; ++i)
+        {
+            if (loaded->parts[i].offset != index->parts[i].offset
+                    || loaded->parts[i].length != index->parts[i].length)
+            {
+                printf("Reloaded tile-part %d does not match\n", i);
+                rc = 1;
+            }
+        }
+    }
+
+    if (!(tileBuf = j2k_TileIndex_readTile(index, io, 0, tile, &tileSize,
+                                           &error)))
+        goto CATCH_ERROR;
+
+    NRT_SNPRINTF(filename, NRT_MAX_PATH, "tile-%d.j2k", tile);
+    outHandle = nrt_IOHandle_create(filename, NRT_ACCESS_WRITEONLY, NRT_CREATE,
+                                    &error);
+    if (NRT_INVALID_HANDLE(outHandle))
+        goto CATCH_ERROR;
+    if (!nrt_IOHandle_write(outHandle, (const char *) tileBuf,
+                            (size_t) tileSize, &error))
+        goto CATCH_ERROR;
+    printf("Wrote file: %s\n", filename);
+
+    goto CLEANUP;
+
+    CATCH_ERROR:
+    {
+        nrt_Error_print(&error, stdout, "Exiting...");
+        rc = 1;
+    }
+    CLEANUP:
+    {
+        if (!NRT_INVALID_HANDLE(outHandle))
+            nrt_IOHandle_close(outHandle);
+        if (tileBuf)
+            NRT_FREE(tileBuf);
+        if (loaded)
+            j2k_TileIndex_destruct(&loaded);
+        if (index)
+            j2k_TileIndex_destruct(&index);
+        if (indexIO)
+            nrt_IOInterface_destruct(&indexIO);
+        if (io)
+            nrt_IOInterface_destruct(&io);
+    }
+    return rc;
+}
@@ -27,12 +27,12 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <ctype.h>
+#include <setjmp.h>
 #ifdef WIN32
     #include <Winsock2.h>
 #else
     #include <netinet/in.h>
 #endif
-#define _BLOCK_SIZE(BLOCK) (BLOCK->rows * BLOCK->cols * BLOCK->bands)
 
 /* borrowed from ImageIO.c */
 #ifndef NITF_IMAGE_IO_NO_BLOCK
@@ -40,6 +40,7 @@
 #endif
 
 #define INPUT_BUF_SIZE  4096
+#define SCAN_BUF_SIZE   (1024 * 1024)   /* Chunk size for the marker scan */
 
 /*
       Zero Block enable
@@ -142,67 +143,86 @@ static int Q5[] =
         16,  14,  20,  21,  20,  27,  27,  36
     };
 
-typedef struct _JPEGMarkerItem
+/*!
+ *  \struct JPEGBlockEntry
+ *  \brief Where the JPEG stream of one block lives in the file
+ *
+ *  \ar block The block number
+ *  \ar soi The file offset of the block's SOI marker
+ *  \ar eoi The file offset just past the block's EOI marker, or 0 if
+ *  it is not known
+ */
+typedef struct _JPEGBlockEntry
 {
-    char name[4];
-    nitf_Off off;
     nitf_Uint32 block;
-
+    nitf_Off soi;
+    nitf_Off eoi;
 }
-JPEGMarkerItem;
+JPEGBlockEntry;
 
-NITFPRIV(JPEGMarkerItem*) JPEGMarkerItem_construct(nitf_Error* error)
+/*!
+ *  \struct JPEGBlockTable
+ *  \brief The block offsets of an image segment, in block order
+ *
+ *  \ar entries One entry per block found
+ *  \ar numEntries The number of entries in use
+ *  \ar capacity The number of entries allocated
+ */
+typedef struct _JPEGBlockTable
 {
-    JPEGMarkerItem* item = (JPEGMarkerItem*)NITF_MALLOC(sizeof(JPEGMarkerItem));
-    if (! item )
-    {
-        nitf_Error_init(error, NITF_STRERROR( NITF_ERRNO ),
-                NITF_CTXT, NITF_ERR_DECOMPRESSION);
-        return NULL;
-    }
-    memset(item->name, 0, 4);
-    item->off = 0;
-    return item;
+    JPEGBlockEntry* entries;
+    nitf_Uint32 numEntries;
+    nitf_Uint32 capacity;
 }
+JPEGBlockTable;
 
-/* not used - the list destructor will NITF_FREE these */
-NITFPRIV(void) JPEGMarkerItem_destruct(JPEGMarkerItem** item)
+/*
+ *  Add the SOI of the next block.  The block number is filled in later.
+ */
+NITFPRIV(NITF_BOOL) JPEGBlockTable_add(JPEGBlockTable* table,
+                                       nitf_Off soi,
+                                       nitf_Error* error)
 {
-    if (*item)
+    if (table->numEntries == table->capacity)
     {
-        NITF_FREE( *item );
-        *item = NULL;
+        nitf_Uint32 capacity = table->capacity ? 2 * table->capacity : 64;
+        JPEGBlockEntry* entries = (JPEGBlockEntry*)
+            NITF_REALLOC(table->entries, capacity * sizeof(JPEGBlockEntry));
+        if (!entries)
+        {
+            nitf_Error_init(error, NITF_STRERROR( NITF_ERRNO ),
+                    NITF_CTXT, NITF_ERR_MEMORY);
+            return NITF_FAILURE;
+        }
+        table->entries = entries;
+        table->capacity = capacity;
     }
+    table->entries[table->numEntries].block = NITF_IMAGE_IO_NO_BLOCK;
+    table->entries[table->numEntries].soi = soi;
+    table->entries[table->numEntries].eoi = 0;
+    table->numEntries++;
+    return NITF_SUCCESS;
 }
 
-/* Added for diagnostics */
-
-NITFPRIV(void) JPEGMarkerItem_print(
-        JPEGMarkerItem* item, FILE *file)
-{
-    if (file == NULL)
-    file = stdout;
-
-    fprintf(file, "JPEG Marker: %s %lld\n", item->name, item->off);
-    return;
-}
-
-NITFPRIV(void) JPEGMarkerItem_printList(
-        nitf_List* markerList, FILE *file)
+/*
+ *  Binary search for a block; entries are in increasing block order
+ */
+NITFPRIV(JPEGBlockEntry*) JPEGBlockTable_find(JPEGBlockTable* table,
+                                              nitf_Uint32 blockNumber)
 {
-    nitf_ListIterator x; /* Iterator for walking list */
-    nitf_ListIterator end; /* End of list iterator */
-    JPEGMarkerItem* item; /* Current marker */
-
-    end = nitf_List_end(markerList);
-    for (x = nitf_List_begin(markerList);
-            nitf_ListIterator_notEqualTo(&x, &end);
-            nitf_ListIterator_increment(&x))
+    nitf_Uint32 lo = 0;
+    nitf_Uint32 hi = table->numEntries;
+    while (lo < hi)
     {
-        item = (JPEGMarkerItem*)nitf_ListIterator_get(&x);
-        JPEGMarkerItem_print(item, file);
+        nitf_Uint32 mid = lo + (hi - lo) / 2;
+        if (table->entries[mid].block < blockNumber)
+            lo = mid + 1;
+        else
+            hi = mid;
     }
-    return;
+    if (lo < table->numEntries && table->entries[lo].block == blockNumber)
+        return &(table->entries[lo]);
+    return NULL;
 }
 
 /*!
@@ -262,9 +282,6 @@ NITFPRIV(void) implClose(nitf_DecompressionControl** control);
  *
  *  \param control  The control object
  *  \param blockNumber  The block number to retrieve from file
- *  \param separateBands Should the bands be separated?  Hint: if
- *  it is single band data, I optimize it for you by ignoring this
- *  entirely, so any time you get B or S, you can set this
  *  \param error  An error to populate on failure
  *  \return NULL on failure, or a pointer to a block on success.
  *
@@ -272,9 +289,25 @@ NITFPRIV(void) implClose(nitf_DecompressionControl** control);
 
 NITFPRIV(nitf_Uint8*) implReadBlock(nitf_DecompressionControl* control,
                                     nitf_Uint32 blockNumber,
-                                    /*        NITF_BOOL separateBands,*/
                                     nitf_Error* error);
 
+/*!
+ *  Like implReadBlock(), but the block is decoded straight into the
+ *  buffer given, so nothing is allocated and nothing needs to be freed.
+ *
+ *  \param control  The control object
+ *  \param blockNumber  The block number to retrieve from file
+ *  \param buffer  The buffer to decode into
+ *  \param size  The size of the buffer, at least the block length
+ *  \param error  An error to populate on failure
+ *  \return One on success, zero on failure
+ */
+NITFPRIV(NITF_BOOL) implReadBlockInto(nitf_DecompressionControl* control,
+                                      nitf_Uint32 blockNumber,
+                                      nitf_Uint8* buffer,
+                                      size_t size,
+                                      nitf_Error* error);
+
 
 /*!
  *  This static array of strings describes the contract of our
@@ -291,8 +324,6 @@ static char *ident[] =
         NULL,
     };
 
-/*! Simple little typedef to make life easier for me  */
-typedef nitf_Uint8* DATA_BUFFER;
 
 /*!
  *  \struct ImplControl
@@ -303,10 +334,14 @@ typedef nitf_Uint8* DATA_BUFFER;
  *  the decompression control.
  *
  *  \ar io The io handle (provided when we opened the interface)
- *  \ar markerList A list of SOI markers which we need to read blocks out
+ *  \ar table The offsets of the blocks, which we need to read blocks out
  *  of order
  *  \ar quantTable  Quantization table (currently not used)
  *  \ar length  The length of the block in bytes
+ *  \ar map  The mapped source, if the io interface has one
+ *  \ar ioSize  The size of the io interface
+ *  \ar lock  Guards the decoder pool
+ *  \ar decoders  The decoders not in use, one per concurrent readBlock
  *
  *  The length value is needed to generate the zero block for decompresion
  *  error recovery. If enabled, blocks that can not be decompressed are
@@ -315,9 +350,13 @@ typedef nitf_Uint8* DATA_BUFFER;
 typedef struct _JPEGImplControl
 {
     nitf_IOInterface* ioInterface;
-    nitf_List*        markerList;
+    JPEGBlockTable    table;
     int*              quantTable;
     nitf_Uint32       length;       /* Total length of the block in bytes */
+    const char*       map;          /* The mapped source, or NULL */
+    nitf_Off          ioSize;       /* The size of the source */
+    nitf_Mutex        lock;         /* Guards the decoder pool */
+    struct _JPEGDecoder* decoders;  /* Decoders not in use */
 }
 JPEGImplControl;
 
@@ -330,147 +369,16 @@ JPEGImplControl;
 
 /* } */
 
-/*!
- *  \struct JPEGBlock
- *  \brief One more object to simplify the components one level further
- *
- *  The JPEGBlock structure has characteristics that make up one block
- *  of once JPEG compressed imagery, in uncompressed form.  This is
- *  the structure which contains the uncompressed imagery once it has been
- *  read.
- *
- *  The buffer of uncompressed data is given by reference back to the caller.
- *
- *  \ar uncompressed The uncompressed data
- *  \ar rows The number of rows
- *  \ar cols The number of cols
- *  \ar bands The number of bands (components in JPEG terms)
- *  \ar current A placeholder for the current end of the buffer
- */
-typedef struct _JPEGBlock
-{
-    DATA_BUFFER uncompressed;
-    int         rows;
-    int         cols;
-    int         bands;
-    int         current;
-}
-JPEGBlock;
-
-/*!
- *  Destruct ourselves a JPEGBlock
- *  \param block An address of a pointer to delete (we NULL-set the pointer)
- *
- */
-void JPEGBlock_destruct(JPEGBlock** block)
-{
-    if (block == NULL)
-        return;
-    if (*block == NULL)
-        return;
-
-    if ((*block)->uncompressed != NULL)
-        NITF_FREE((*block)->uncompressed);
-
-    NITF_FREE(*block);
-    *block = NULL;
-}
-
-/*!
- *  Construct a new JPEGBlock object.  'Give me lots of info, and
- *  I will build it'-type contract.  We don't populate the uncompressed
- *  section until later
- *  \param rows The number of rows in the block
- *  \param cols The number of cols in the block
- *
- */
-JPEGBlock* JPEGBlock_construct(int rows, int cols, int bands, nitf_Error* error)
-{
-    JPEGBlock* block = (JPEGBlock*) NITF_MALLOC(sizeof(JPEGBlock));
-    if (!block)
-    {
-        nitf_Error_init(error, "Failure to construct JPEG block", NITF_CTXT,
-                        NITF_ERR_MEMORY);
-        return NULL;
-    }
-    block->rows = rows;
-    block->cols = cols;
-    block->bands = bands;
-    block->current = 0;
-
-    block->uncompressed = (DATA_BUFFER) NITF_MALLOC(_BLOCK_SIZE(block));
-    if (!block->uncompressed)
-    {
-        /* need to destroy */
-        JPEGBlock_destruct(&block);
-    }
-    return block;
-}
-
-/*!
- *  Here, we append uncompressed scanlines as we read them.  This
- *  of course, does not solve the band interleaved by block issue
- *  \param block The block to append to
- *  \param buffer The sample buffer
- *  \param rowStride The stride of the row (keeping in mind there
- *  may be multiple bands.
- */
-void JPEGBlock_append(JPEGBlock* block, JSAMPLE* buffer, int rowStride)
-{
-    assert(rowStride + block->current <= _BLOCK_SIZE(block));
-    /*hexDump(buffer, rowStride);*/
-
-    DPRINTA3("Copying %d components from ranges [%d - %d]\n", rowStride,
-            block->current, block->current + rowStride);
-    memcpy(block->uncompressed + block->current, buffer, rowStride);
-    block->current += rowStride;
-}
-
-
-void JPEGBlock_reorder(JPEGBlock* block)
-{
-    int i;
-    int n;
-    int j;
-    off_t current = 0;
-    DATA_BUFFER* bands = (DATA_BUFFER*) NITF_MALLOC(sizeof(DATA_BUFFER)
-            * block->bands);
-    for (i = 0; i < block->bands; i++)
-    {
-        bands[i] = (DATA_BUFFER) NITF_MALLOC(block->rows * block->cols);
-    }
-
-    for (n = 0; n < block->rows * block->cols; n++)
-    {
-        j = n * block->bands;
-
-        for (i = 0; i < block->bands; i++)
-        {
-            DATA_BUFFER thisBand = bands[i];
-            thisBand[n] = block->uncompressed[j + i];
-        }
-    }
-
-    for (i = 0; i < block->bands; i++)
-    {
-        memcpy(block->uncompressed + current, bands[i], n);
-        current += n;
-    }
-
-    for (i = 0; i < block->bands; i++)
-    {
-        NITF_FREE(bands[i]);
-    }
-    NITF_FREE(bands);
-}
-
 static nitf_DecompressionInterface interfaceTable =
 {
     implOpen,
     implReadBlock,
     implFreeBlock,
     implClose,
-    NULL
+    NULL,
+    NITF_DECOMPRESSION_CONCURRENT_READ_BLOCK
+        | NITF_DECOMPRESSION_READ_BLOCK_INTO,
+    implReadBlockInto
 };
 
 NITFPRIV(int) implFreeBlock(nitf_DecompressionControl* control,
@@ -499,19 +407,121 @@ typedef enum _JPEGMarker
     JPEG_MARKER_DONT_CARE,
 } JPEGMarker;
 
-NITFPRIV(NITF_BOOL) readByte(nitf_IOInterface* io,
+/*!
+ *  \struct JPEGScanBuffer
+ *  \brief A window onto the compressed data for the marker scan
+ *
+ *  The scan reads the compressed data in large chunks rather than a byte
+ *  at a time, so it costs one read per chunk instead of one per byte.
+ *
+ *  \ar io The source
+ *  \ar data The chunk buffer
+ *  \ar base The file offset of data[0]
+ *  \ar size The number of valid bytes in data
+ *  \ar pos The index of the next byte to look at
+ *  \ar end The file offset of the end of the compressed data
+ */
+typedef struct _JPEGScanBuffer
+{
+    nitf_IOInterface* io;
+    nitf_Uint8* data;
+    nitf_Off base;
+    size_t size;
+    size_t pos;
+    nitf_Off end;
+}
+JPEGScanBuffer;
+
+/*
+ *  The file offset of the next byte
+ */
+#define scanTell(scan) ((scan)->base + (nitf_Off)(scan)->pos)
+
+/*
+ *  Copy the next bytes out of the chunk, reading chunks as needed
+ */
+NITFPRIV(NITF_BOOL) scanRead(JPEGScanBuffer* scan,
+        char* buf,
+        size_t size,
+        nitf_Error* error)
+{
+    while (size > 0)
+    {
+        size_t count = scan->size - scan->pos;
+        if (count == 0)
+        {
+            nitf_Off start = scanTell(scan);
+            if (start >= scan->end)
+            {
+                nitf_Error_init(error, "Premature end of JPEG data",
+                        NITF_CTXT, NITF_ERR_DECOMPRESSION);
+                return NITF_FAILURE;
+            }
+            count = SCAN_BUF_SIZE;
+            if ((nitf_Off)count > scan->end - start)
+                count = (size_t)(scan->end - start);
+            if (!NITF_IO_SUCCESS(nitf_IOInterface_seek(scan->io, start,
+                                                       NITF_SEEK_SET,
+                                                       error)) ||
+                !nitf_IOInterface_read(scan->io, (char*)scan->data,
+                                       count, error))
+                return NITF_FAILURE;
+            scan->base = start;
+            scan->size = count;
+            scan->pos = 0;
+        }
+        if (count > size)
+            count = size;
+        memcpy(buf, scan->data + scan->pos, count);
+        scan->pos += count;
+        buf += count;
+        size -= count;
+    }
+    return NITF_SUCCESS;
+}
+
+/*
+ *  Move past bytes that need not be looked at
+ */
+NITFPRIV(void) scanSkip(JPEGScanBuffer* scan, size_t size)
+{
+    if (scan->size - scan->pos >= size)
+        scan->pos += size;
+    else
+    {
+        /* The next read starts past them */
+        scan->base = scanTell(scan) + (nitf_Off)size;
+        scan->pos = 0;
+        scan->size = 0;
+    }
+}
+
+/*
+ *  Move up to the next 0xFF in the chunk, or to the end of the chunk,
+ *  and return the number of bytes passed over
+ */
+NITFPRIV(size_t) scanToFF(JPEGScanBuffer* scan)
+{
+    size_t from = scan->pos;
+    nitf_Uint8* ff = (nitf_Uint8*)memchr(scan->data + from, 0xFF,
+                                         scan->size - from);
+    scan->pos = ff ? (size_t)(ff - scan->data) : scan->size;
+    return scan->pos - from;
+}
+
+NITFPRIV(NITF_BOOL) readByte(JPEGScanBuffer* scan,
         unsigned char* b,
         nitf_Error* error)
 {
-    return nitf_IOInterface_read(io, (NITF_DATA *) b, 1, error);
+    return scanRead(scan, (char *) b, 1, error);
 }
 
-NITFPRIV(NITF_BOOL) readShort(nitf_IOInterface* io,
+NITFPRIV(NITF_BOOL) readShort(JPEGScanBuffer* scan,
         nitf_Uint16* native,
         nitf_Error* error)
 {
     nitf_Uint16 raw;
-    if (!nitf_IOInterface_read(io, (char*)&raw, 2, error))
+    if (!scanRead(scan, (char*)&raw, 2, error))
     {
         return NITF_FAILURE;
     }
@@ -519,11 +529,11 @@ NITFPRIV(NITF_BOOL) readShort(nitf_IOInterface* io,
     return NITF_SUCCESS;
 }
 
-NITFPRIV(int) readMarker(nitf_IOInterface* io, nitf_Error* error)
+NITFPRIV(int) readMarker(JPEGScanBuffer* scan, nitf_Error* error)
 {
     int markerEnum = JPEG_MARKER_ERROR;
     unsigned char native = 0x0000;
-    if (readByte(io, &native, error) )
+    if (readByte(scan, &native, error) )
     {
         switch (native)
         {
@@ -580,14 +590,14 @@ NITFPRIV(int) readMarker(nitf_IOInterface* io, nitf_Error* error)
 }
 
 
-NITFPRIV(NITF_BOOL) readSOI(nitf_IOInterface* io,
+NITFPRIV(NITF_BOOL) readSOI(JPEGScanBuffer* scan,
         nitf_Uint64* bytesRead,
         nitf_Error* error)
 {
     unsigned char needFF;
     int tokenType;
 
-    if (! readByte(io, &needFF, error) ) return NITF_FAILURE;
+    if (! readByte(scan, &needFF, error) ) return NITF_FAILURE;
     (*bytesRead)++;
 
     if ( needFF != 0xFF )
@@ -599,7 +609,7 @@ NITFPRIV(NITF_BOOL) readSOI(nitf_IOInterface* io,
 
         return NITF_FAILURE;
     }
-    tokenType = readMarker(io, error);
+    tokenType = readMarker(scan, error);
     (*bytesRead)++;
 
     if (tokenType == JPEG_MARKER_ERROR)
@@ -676,7 +686,7 @@ NITFPRIV(NITF_BOOL) readSOF(nitf_IOInterface* io,
     In order to get here, we must have read:
     SOI, APP6, DQT, SOF0, DHT
 */
-NITFPRIV(NITF_BOOL) readSOS(nitf_IOInterface* io,
+NITFPRIV(NITF_BOOL) readSOS(JPEGScanBuffer* scan,
                             nitf_Uint64* bytesRead,
                             nitf_Error* error)
 {
@@ -684,7 +694,7 @@ NITFPRIV(NITF_BOOL) readSOS(nitf_IOInterface* io,
     /*  Need to read bytes in header  */
     nitf_Uint16 numBytesInHdr;
     /*  If this isnt happening, throw up  */
-    if (! readShort(io, &numBytesInHdr, error) )
+    if (! readShort(scan, &numBytesInHdr, error) )
         return NITF_FAILURE;
     /*  Print  now     */
     DPRINTA1("SOS: Header length: [%d]\n", numBytesInHdr);
@@ -693,11 +703,7 @@ NITFPRIV(NITF_BOOL) readSOS(nitf_IOInterface* io,
     /*  Normalize now  */
     numBytesInHdr -= 2;
     /*  Skip for now   */
-    if (!  NITF_IO_SUCCESS(nitf_IOInterface_seek(io,
-                                                 numBytesInHdr,
-                                                 NITF_SEEK_CUR,
-                                                 error)))
-        return NITF_FAILURE;
+    scanSkip(scan, numBytesInHdr);
     /*  Be happy now   */
     DPRINT("Successful SOS read!\n");
     /*  Return success */
@@ -709,14 +715,14 @@ NITFPRIV(NITF_BOOL) readSOS(nitf_IOInterface* io,
 */
 
 
-NITFPRIV(NITF_BOOL) readHuffTable(nitf_IOInterface* io,
+NITFPRIV(NITF_BOOL) readHuffTable(JPEGScanBuffer* scan,
                                   nitf_Uint64* bytesRead,
                                   nitf_Error* error)
 {
     /*  Need to read a header length */
     nitf_Uint16 numBytesInHdr;
     /*  Read it or die  */
-    if (! readShort(io, &numBytesInHdr, error) )
+    if (! readShort(scan, &numBytesInHdr, error) )
         return NITF_FAILURE;
     /*  Print now  */
     DPRINTA1("Huff Table: Header length: [%d]\n", numBytesInHdr);
@@ -725,11 +731,7 @@ NITFPRIV(NITF_BOOL) readHuffTable(nitf_IOInterface* io,
     /*  Adjust for what we have read already  */
     numBytesInHdr -= 2;
 
-    if (! NITF_IO_SUCCESS(nitf_IOInterface_seek(io,
-                                                numBytesInHdr,
-                                                NITF_SEEK_CUR,
-                                                error)))
-        return NITF_FAILURE;
+    scanSkip(scan, numBytesInHdr);
 
     /*  Rejoice!  */
     DPRINT("Successful Huff Table read!\n");
@@ -737,14 +739,14 @@ NITFPRIV(NITF_BOOL) readHuffTable(nitf_IOInterface* io,
     return NITF_SUCCESS;
 }
 
-NITFPRIV(NITF_BOOL) readQuantTable(nitf_IOInterface* io,
+NITFPRIV(NITF_BOOL) readQuantTable(JPEGScanBuffer* scan,
                                    nitf_Uint64* bytesRead,
                                    nitf_Error* error)
 {
     /*  Declare something to read into  */
     nitf_Uint16 numBytesInHdr;
     /*  Now start reading... */
-    if (! readShort(io, &numBytesInHdr, error) )
+    if (! readShort(scan, &numBytesInHdr, error) )
         return NITF_FAILURE;
 
     /*  Print now   */
@@ -755,11 +757,7 @@ NITFPRIV(NITF_BOOL) readQuantTable(nitf_IOInterface* io,
     /*  Adjust now  */
     numBytesInHdr -= 2;
 
-    if (! NITF_IO_SUCCESS(nitf_IOInterface_seek(io,
-                                                numBytesInHdr,
-                                                NITF_SEEK_CUR,
-                                                error)))
-        return NITF_FAILURE;
+    scanSkip(scan, numBytesInHdr);
 
     /*  Celebrate  */
     DPRINT("Successful Quant Table read!\n");
@@ -768,50 +766,49 @@ NITFPRIV(NITF_BOOL) readQuantTable(nitf_IOInterface* io,
 }
 
 /*
-   This method is currently used to push a marker and its
-   respective offset onto our list.
-*/
-
-NITFPRIV(NITF_BOOL) pushMarker(nitf_List* markerList,
-                               const char* name,
-                               off_t where,
-                               nitf_Error* error)
-{
-    JPEGMarkerItem* item = JPEGMarkerItem_construct(error);
-    strcpy(item->name,  name);
-    item->off = where;
-    if (!item) return NITF_FAILURE;
-    if (!nitf_List_pushBack(markerList, item, error) )
-        return NITF_FAILURE;
-    return  NITF_SUCCESS;
-}
-
-/*
-  This gets called (for now) when we open the interface.
-  We then begin to apply that information later.
-
-  This is basically a book-keeping function (and not a
-  terribly efficient one at that...)
+  This gets called (for now) when we open the interface, unless the
+  block mask gives the offsets (see maskOffsets).  It finds the SOI
+  and EOI of every JPEG stream in the compressed data.
 
+  The data is read in large chunks, and the bytes between markers are
+  passed over with memchr.
 */
 NITFPRIV(NITF_BOOL) scanOffsets(nitf_IOInterface* io,
-                                nitf_List* markerList,
+                                nitf_Uint64 offset,
                                 nitf_Uint64 fileLength,
+                                JPEGBlockTable* table,
                                 nitf_Error* error)
 {
 
     nitf_Uint64 bytesRead = 0;
+    JPEGScanBuffer scan;
 
     /*  Book keeping block  */
-    nitf_Uint64 origin = nitf_IOInterface_tell(io, error);
-    assert(NITF_IO_SUCCESS(origin));
+    nitf_Uint64 origin = offset;
+    scan.io = io;
+    scan.base = (nitf_Off)offset;
+    scan.size = 0;
+    scan.pos = 0;
+    scan.end = (nitf_Off)(offset + fileLength);
+    scan.data = (nitf_Uint8*)NITF_MALLOC(SCAN_BUF_SIZE);
+    if (!scan.data)
+    {
+        nitf_Error_init(error, NITF_STRERROR( NITF_ERRNO ),
+                NITF_CTXT, NITF_ERR_MEMORY);
+        goto CATCH_ERROR;
+    }
     /*  End book keeping block  */
     DPRINTA1("File length: %ld\n",  fileLength);
     while (bytesRead < fileLength)
     {
 
         unsigned char b;
-        if (! readByte(io, &b, error) )
+
+        /*  Only the bytes at a marker need to be looked at  */
+        bytesRead += scanToFF(&scan);
+        if (bytesRead >= fileLength)
+            break;
+        if (! readByte(&scan, &b, error) )
         {
 
             DPRINTA1("Read byte failed on byte %ld!\n", bytesRead);
@@ -820,10 +817,11 @@ NITFPRIV(NITF_BOOL) scanOffsets(nitf_IOInterface* io,
         ++bytesRead;
 
 
-        if (b == 0xFF )
+        /*  A marker code cut off by the end of the data is ignored  */
+        if (b == 0xFF && bytesRead < fileLength)
         {
             int tokenType;
-            tokenType = readMarker(io, error);
+            tokenType = readMarker(&scan, error);
             ++bytesRead;
 
             if (tokenType == JPEG_MARKER_ERROR)
@@ -838,7 +836,7 @@ NITFPRIV(NITF_BOOL) scanOffsets(nitf_IOInterface* io,
             }
             else
             {
-                off_t where = nitf_IOInterface_tell(io, error);
+                off_t where = scanTell(&scan);
 
                 nitf_Uint64 totalBytes = (fileLength - bytesRead) +
                     (where - origin);
@@ -846,11 +844,9 @@ NITFPRIV(NITF_BOOL) scanOffsets(nitf_IOInterface* io,
                 switch (tokenType)
                 {
                 case JPEG_MARKER_EOI:
-                    if (! pushMarker(markerList, "EOI", where, error) )
-                    {
-                        DPRINT("Failure EOI (pushMarker)\n");
-                        goto CATCH_ERROR;
-                    }
+                    if (table->numEntries > 0 &&
+                        table->entries[table->numEntries - 1].eoi == 0)
+                        table->entries[table->numEntries - 1].eoi = where;
 
                     DPRINT("~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~\n");
                     DPRINT("Successful EOI!\n");
@@ -863,13 +859,13 @@ NITFPRIV(NITF_BOOL) scanOffsets(nitf_IOInterface* io,
 
                     /*  If it is the start of image, I want to read an APP6  */
                 case JPEG_MARKER_SOI:
-                    if (! pushMarker(markerList, "SOI", where, error) )
+                    if (! JPEGBlockTable_add(table, where - 2, error) )
                     {
-                        DPRINT("Failure SOI (pushMarker)\n");
+                        DPRINT("Failure SOI (JPEGBlockTable_add)\n");
                         goto CATCH_ERROR;
                     }
 
-                    if (!readSOI(io, &bytesRead, error))
+                    if (!readSOI(&scan, &bytesRead, error))
                     {
                         DPRINT("Failure SOF (readSOI)\n");
                         goto CATCH_ERROR;
@@ -878,13 +874,7 @@ NITFPRIV(NITF_BOOL) scanOffsets(nitf_IOInterface* io,
                     break;
 
                 case JPEG_MARKER_SOS:
-                    if (! pushMarker(markerList, "SOS", where, error) )
-                    {
-                        DPRINT("Failure SOS (pushMarker)\n");
-                        goto CATCH_ERROR;
-                    }
-
-                    if (!readSOS(io, &bytesRead, error))
+                    if (!readSOS(&scan, &bytesRead, error))
                     {
                         DPRINT("Failure SOS (readSOS)\n");
                         goto CATCH_ERROR;
@@ -893,13 +883,7 @@ NITFPRIV(NITF_BOOL) scanOffsets(nitf_IOInterface* io,
 
 
                 case JPEG_MARKER_DECL_QUANT_TABLE:
-                    if (! pushMarker(markerList, "DQT", where, error) )
-                    {
-                        DPRINT("Failure DQT (pushMarker)\n");
-                        goto CATCH_ERROR;
-                    }
-
-                    if (!readQuantTable(io, &bytesRead, error))
+                    if (!readQuantTable(&scan, &bytesRead, error))
                     {
                         DPRINT("Failure DQT (readQuantTable)\n");
                         goto CATCH_ERROR;
@@ -907,13 +891,7 @@ NITFPRIV(NITF_BOOL) scanOffsets(nitf_IOInterface* io,
                     break;
 
                 case JPEG_MARKER_DECL_HUFF_TABLE:
-                    if (! pushMarker(markerList, "DHT", where, error) )
-                    {
-                        DPRINT("Failure DHT (pushMarker)\n");
-                        goto CATCH_ERROR;
-                    }
-
-                    if (!readHuffTable(io, &bytesRead, error))
+                    if (!readHuffTable(&scan, &bytesRead, error))
                     {
                         DPRINT("Failure DHT (readHuffTable)\n");
                         goto CATCH_ERROR;
@@ -922,12 +900,6 @@ NITFPRIV(NITF_BOOL) scanOffsets(nitf_IOInterface* io,
                     break;
 
                 case JPEG_MARKER_SOF:
-                    if (! pushMarker(markerList, "SOF", where, error) )
-                    {
-                        DPRINT("Failure SOF (pushMarker)\n");
-                        goto CATCH_ERROR;
-                    }
-
                     /* if (!readSOF(io, error)) */
                     /*       goto CATCH_ERROR; */
                     break;
@@ -944,17 +916,75 @@ NITFPRIV(NITF_BOOL) scanOffsets(nitf_IOInterface* io,
     {
         DPRINT("Warning: couldnt equalize the number of bytes desired and those read\n");
     }
+    NITF_FREE(scan.data);
     return NITF_SUCCESS;
 
 CATCH_ERROR:
+    if (scan.data)
+        NITF_FREE(scan.data);
     nitf_Error_print(error, stdout, "While scanning offsets!");
     return NITF_FAILURE;
 }
 
+/*
+ *  Check one block offset from the mask by looking for an SOI there
+ */
+NITFPRIV(NITF_BOOL) isSOI(nitf_IOInterface* io, nitf_Off where,
+                          nitf_Error* error)
+{
+    unsigned char marker[2];
+    if (!NITF_IO_SUCCESS(nitf_IOInterface_seek(io, where,
+                                               NITF_SEEK_SET, error)) ||
+        !nitf_IOInterface_read(io, (char*)marker, 2, error))
+        return NITF_FAILURE;
+    return marker[0] == 0xFF && marker[1] == 0xD8;
+}
+
+/*
+ *  An M3 image carries a block mask with the offset of every block, so
+ *  there is no need to scan.  ImageIO hands C3 images a mask too, made up
+ *  from the uncompressed block size, so the mask is only trusted if its
+ *  offsets fit in the data and SOI markers sit at the first, middle and
+ *  last of them.  Returns NITF_FAILURE, with no error, if it is not.
+ */
+NITFPRIV(NITF_BOOL) maskOffsets(nitf_IOInterface* io,
+                                nitf_Uint64 offset,
+                                nitf_Uint64 fileLength,
+                                nitf_BlockingInfo* blockInfo,
+                                nitf_Uint64* blockMask,
+                                JPEGBlockTable* table,
+                                nitf_Error* error)
+{
+    nitf_Uint32 numBlocks;
+    nitf_Uint32 i;
+    nitf_Uint64 last = 0;
+
+    numBlocks = blockInfo->numBlocksPerRow * blockInfo->numBlocksPerCol;
+    for (i = 0; i < numBlocks; i++)
+    {
+        if (blockMask[i] == NITF_IMAGE_IO_NO_BLOCK)
+            continue;
+        if (blockMask[i] + 2 > fileLength ||
+            (table->numEntries > 0 && blockMask[i] <= last))
+            return NITF_FAILURE;
+        last = blockMask[i];
+        if (!JPEGBlockTable_add(table, (nitf_Off)(offset + blockMask[i]),
+                                error))
+            return NITF_FAILURE;
+        table->entries[table->numEntries - 1].block = i;
+    }
+    if (table->numEntries == 0)
+        return NITF_FAILURE;
+
+    return isSOI(io, table->entries[0].soi, error) &&
+        isSOI(io, table->entries[table->numEntries / 2].soi, error) &&
+        isSOI(io, table->entries[table->numEntries - 1].soi, error);
+}
+
 /*!
  *  Open our interface up.  This thing saves a reference to our
- *  io, and sets us up to read.  We call fdopen() to get a FILE*
- *  back from our IOInterface.
+ *  io, and finds the offset of every block, from the block mask or
+ *  a scan of the compressed data.
  *
  *  \todo  This function needs to know Bits per pixel so that it
  *  can load the correct JPEG library
@@ -989,14 +1019,12 @@ NITFPRIV(nitf_DecompressionControl*) implOpen(nitf_IOInterface* io,
         return NULL;
     }
 
-    /*  For right now, we are storing this silly markerList.  I think
-     this will prove to be a useless mechanism  */
-    implControl->markerList = nitf_List_construct(error);
-    if (!implControl->markerList)
-    {
-        /*  If this fails, the error is already set  */
-        return NULL;
-    }
+    /*  The block offsets live as long as the control  */
+    implControl->table.entries = NULL;
+    implControl->table.numEntries = 0;
+    implControl->table.capacity = 0;
+    implControl->decoders = NULL;
+    nitf_Mutex_init(&(implControl->lock));
 
     /*  Seek to our start point, just in case... */
     if ( ! NITF_IO_SUCCESS( nitf_IOInterface_seek(io,
@@ -1011,35 +1039,40 @@ NITFPRIV(nitf_DecompressionControl*) implOpen(nitf_IOInterface* io,
                 NITF_ERR_DECOMPRESSION,
                 "Error seeking to offset for JPEG block [%ld]",
                 offset);
+        implClose((nitf_DecompressionControl**)&implControl);
         return NULL;
     }
 
-    /*  Find all marker offsets!!!!  */
-    if (!scanOffsets(io, implControl->markerList, fileLength, error))
-    {
-        return NULL;
-    }
-
+    if (!maskOffsets(io, offset, fileLength, blockInfo, blockMask,
+                     &implControl->table, error))
     {
         nitf_Uint32 nextBlock = 0;
-        nitf_ListIterator x = nitf_List_begin((implControl->markerList));
-        nitf_ListIterator e = nitf_List_end((implControl->markerList));
-        while (nitf_ListIterator_notEqualTo(&x, &e))
+        nitf_Uint32 numBlocks = blockInfo->numBlocksPerRow *
+            blockInfo->numBlocksPerCol;
+        nitf_Uint32 i;
 
+        /*  Find all marker offsets!!!!  */
+        implControl->table.numEntries = 0;
+        if (!scanOffsets(io, offset, fileLength, &implControl->table, error))
         {
-            JPEGMarkerItem *item = nitf_ListIterator_get(&x);
-            DPRINTA2("[%s:%d]", item->name, item->off );
-
-            if (strcmp(item->name, "SOI") == 0)
-            {
-                while(blockMask[nextBlock++] == NITF_IMAGE_IO_NO_BLOCK);
-                item->block = nextBlock - 1;
-            }
-            else
-            item->block = NITF_IMAGE_IO_NO_BLOCK;
+            implClose((nitf_DecompressionControl**)&implControl);
+            return NULL;
+        }
 
-            nitf_ListIterator_increment(&x);
+        /*  The streams belong to the blocks that are present, in order  */
+        for (i = 0; i < implControl->table.numEntries; i++)
+        {
+            JPEGBlockEntry* entry = &(implControl->table.entries[i]);
+            DPRINTA2("[SOI:%d]", (int)entry->soi, 0);
+
+            while (nextBlock < numBlocks &&
+                   blockMask[nextBlock] == NITF_IMAGE_IO_NO_BLOCK)
+                nextBlock++;
+            if (nextBlock == numBlocks)
+                break;
+            entry->block = nextBlock++;
         }
+        implControl->table.numEntries = i;
         DPRINT("\n");
     }
 
@@ -1055,11 +1088,24 @@ NITFPRIV(nitf_DecompressionControl*) implOpen(nitf_IOInterface* io,
                 "Error seeking to necessary offset for JPEG block",
                 NITF_CTXT,
                 NITF_ERR_DECOMPRESSION);
+        implClose((nitf_DecompressionControl**)&implControl);
         return NULL;
     }
 
     implControl->ioInterface = io;
     implControl->length = blockInfo->length;
+
+    /*  Blocks are read straight from memory if we can  */
+    implControl->map = nitf_IOInterface_getMapping(io, &implControl->ioSize);
+    if (!implControl->map)
+    {
+        implControl->ioSize = nitf_IOInterface_getSize(io, error);
+        if (!NITF_IO_SUCCESS(implControl->ioSize))
+        {
+            implClose((nitf_DecompressionControl**)&implControl);
+            return NULL;
+        }
+    }
     return (nitf_DecompressionControl*)implControl;
 }
 
@@ -1069,13 +1115,40 @@ typedef struct _JPEGIOManager
     nitf_Uint8 buffer[INPUT_BUF_SIZE];  /* start of buffer */
     boolean start_of_file;              /* have we gotten any data yet? */
     nitf_IOInterface* ioInterface;      /* source IO */
-    nitf_Off ioStart;                   /* the io interface start offset (tell) */
+    const char* map;                    /* the mapped source, if any */
+    nitf_Off ioStart;                   /* the offset of the block's SOI */
     nitf_Off ioEnd;                     /* the io interface end offset (size) */
     nitf_Uint32 blockLength;            /* the length of the block */
     nitf_Uint32 bytesRead;              /* the number of bytes read so far */
     nitf_Error *error;
 } JPEGIOManager;
 
+/*!
+ *  \struct JPEGDecoder
+ *  \brief The libjpeg state of one decoding thread
+ *
+ *  A libjpeg decompressor cannot be used by two threads at once, so each
+ *  call to implReadBlock takes one from the pool in the control object,
+ *  creating it if the pool is empty, and returns it when the block is
+ *  done.  The pool grows to the number of blocks decoded at once, and
+ *  each decoder is reused for block after block.
+ *
+ *  \ar cinfo The decompressor
+ *  \ar jerr The error manager, which jumps back to implReadBlock
+ *  \ar src The source manager
+ *  \ar jump Where the error manager jumps to
+ *  \ar next The next free decoder in the pool
+ */
+typedef struct _JPEGDecoder
+{
+    struct jpeg_decompress_struct cinfo;
+    struct jpeg_error_mgr jerr;
+    JPEGIOManager src;
+    jmp_buf jump;
+    struct _JPEGDecoder* next;
+}
+JPEGDecoder;
+
 
 NITFPRIV(void) JPEGInitSource (j_decompress_ptr cinfo)
 {
@@ -1089,21 +1162,8 @@ NITFPRIV(void) JPEGInitSource (j_decompress_ptr cinfo)
 
 NITFPRIV(void) JPEGTerminateSource(j_decompress_ptr cinfo)
 {
-    /* delete the source manager and buffer */
-    if (cinfo)
-    {
-        JPEGIOManager* src = (JPEGIOManager*)cinfo->src;
-        /*if (src && src->buffer)
-        {
-            NITF_FREE(src->buffer);
-            src->buffer = NULL;
-        }*/
-        if (src)
-        {
-            NITF_FREE(src);
-        }
-        cinfo->src = NULL;
-    }
+    /* The source manager belongs to the decoder and is reused */
+    (void)cinfo;
 }
 
 NITFPRIV(boolean) JPEGFillInputBuffer (j_decompress_ptr cinfo)
@@ -1113,7 +1173,7 @@ NITFPRIV(boolean) JPEGFillInputBuffer (j_decompress_ptr cinfo)
     nitf_Off ioOff;
 
     toRead = src->blockLength - src->bytesRead;
-    if (toRead > INPUT_BUF_SIZE)
+    if (toRead > INPUT_BUF_SIZE && !src->map)
     {
         toRead = INPUT_BUF_SIZE;
     }
@@ -1122,7 +1182,7 @@ NITFPRIV(boolean) JPEGFillInputBuffer (j_decompress_ptr cinfo)
     ioOff = src->ioStart + src->bytesRead;
     if (ioOff + toRead > src->ioEnd)
     {
-        nitf_Int32 ioDiff = src->ioEnd - ioOff;
+        nitf_Off ioDiff = src->ioEnd - ioOff;
         if (ioDiff < 0)
             toRead = 0;
         else
@@ -1140,19 +1200,27 @@ NITFPRIV(boolean) JPEGFillInputBuffer (j_decompress_ptr cinfo)
         /* Insert a fake EOI marker */
         src->buffer[0] = 0xFF;
         src->buffer[1] = JPEG_EOI;
+        src->pub.next_input_byte = src->buffer;
         toRead = 2;
     }
+    else if (src->map)
+    {
+        /* The whole block is in memory already */
+        src->pub.next_input_byte = (const JOCTET*)(src->map + ioOff);
+        src->bytesRead += toRead;
+    }
     else
     {
-        if (!nitf_IOInterface_read(src->ioInterface, src->buffer,
-                                   toRead, src->error))
+        /* Positional reads leave the file offset alone for other threads */
+        if (!nitf_IOInterface_readAt(src->ioInterface, ioOff,
+                                     (char*)src->buffer, toRead, src->error))
         {
-            return FALSE;
+            ERREXIT(cinfo, JERR_FILE_READ);
         }
+        src->pub.next_input_byte = src->buffer;
         src->bytesRead += toRead;
     }
 
-    src->pub.next_input_byte = src->buffer;
     src->pub.bytes_in_buffer = toRead;
     src->start_of_file = FALSE;
     return TRUE;
@@ -1177,38 +1245,15 @@ NITFPRIV(void) JPEGSkipInputData(j_decompress_ptr cinfo, long num_bytes)
     }
 }
 
-NITFPRIV(NITF_BOOL) JPEGCreateIOSource(j_decompress_ptr cinfo,
-                                       JPEGImplControl* implControl,
-                                       nitf_Error* error)
+/*
+ *  Point the decoder's source at one block
+ */
+NITFPRIV(void) JPEGSetIOSource(JPEGDecoder* decoder,
+                               JPEGImplControl* implControl,
+                               JPEGBlockEntry* entry,
+                               nitf_Error* error)
 {
-    JPEGIOManager* src = NULL;
-    if (!cinfo->src)
-    {
-        src = (JPEGIOManager*)NITF_MALLOC(sizeof(JPEGIOManager));
-        if (src == NULL)
-        {
-            nitf_Error_init(error,
-                            "Error creating IO manager object",
-                            NITF_CTXT,
-                            NITF_ERR_DECOMPRESSION);
-            return NITF_FAILURE;
-        }
-        cinfo->src = (struct jpeg_source_mgr*)src;
-
-        /*src->buffer = (nitf_Uint8*)NITF_MALLOC(INPUT_BUF_SIZE);
-        if (src->buffer == NULL)
-        {
-            nitf_Error_init(error,
-                            "Error creating IO buffer",
-                            NITF_CTXT,
-                            NITF_ERR_DECOMPRESSION);
-            return NITF_FAILURE;
-        }*/
-    }
-    else
-    {
-        src = (JPEGIOManager*)cinfo->src;
-    }
+    JPEGIOManager* src = &(decoder->src);
 
     src->pub.init_source = JPEGInitSource;
     src->pub.fill_input_buffer = JPEGFillInputBuffer;
@@ -1218,237 +1263,258 @@ NITFPRIV(NITF_BOOL) JPEGCreateIOSource(j_decompress_ptr cinfo,
     src->pub.bytes_in_buffer = 0; /* forces fill_input_buffer on first read */
     src->pub.next_input_byte = NULL; /* until buffer loaded */
     src->ioInterface = implControl->ioInterface;
-    src->blockLength = implControl->length;
+    src->map = implControl->map;
+    src->ioStart = entry->soi;
+    src->ioEnd = implControl->ioSize;
+
+    /* Without the EOI, read until libjpeg has enough */
+    if (entry->eoi > entry->soi)
+        src->blockLength = (nitf_Uint32)(entry->eoi - entry->soi);
+    else
+        src->blockLength = implControl->length;
     src->bytesRead = 0;
-    src->ioStart = nitf_IOInterface_tell(src->ioInterface, error);
-    src->ioEnd = nitf_IOInterface_getSize(src->ioInterface, error);
     src->error = error;
+    decoder->cinfo.src = (struct jpeg_source_mgr*)src;
+}
 
-    return NITF_SUCCESS;
+/*
+ *  libjpeg calls this on a fatal error.  Rather than exit, go back to
+ *  implReadBlock, which reports the error for the block.
+ */
+NITFPRIV(void) JPEGErrorExit(j_common_ptr cinfo)
+{
+    JPEGDecoder* decoder = (JPEGDecoder*)cinfo->client_data;
+    longjmp(decoder->jump, 1);
 }
 
+/*
+ *  Take a decoder from the pool, or make one
+ */
+NITFPRIV(JPEGDecoder*) JPEGDecoder_acquire(JPEGImplControl* implControl,
+                                           nitf_Error* error)
+{
+    JPEGDecoder* decoder;
+
+    nitf_Mutex_lock(&(implControl->lock));
+    decoder = implControl->decoders;
+    if (decoder)
+        implControl->decoders = decoder->next;
+    nitf_Mutex_unlock(&(implControl->lock));
+    if (decoder)
+        return decoder;
+
+    decoder = (JPEGDecoder*)NITF_MALLOC(sizeof(JPEGDecoder));
+    if (!decoder)
+    {
+        nitf_Error_init(error, NITF_STRERROR( NITF_ERRNO ),
+                NITF_CTXT, NITF_ERR_MEMORY);
+        return NULL;
+    }
 
-/*!
- *  Returns a starting offset for the block number indicated.
- *  The information is in the control structure, which was
- *  generated during implOpen.
+    /*  Set up the error handler  */
+    decoder->cinfo.err = jpeg_std_error(&(decoder->jerr));
+    decoder->jerr.error_exit = JPEGErrorExit;
+    decoder->cinfo.client_data = decoder;
+    if (setjmp(decoder->jump))
+    {
+        /* Only out of memory can fail here */
+        nitf_Error_init(error, "Unable to create JPEG decompressor",
+                NITF_CTXT, NITF_ERR_MEMORY);
+        NITF_FREE(decoder);
+        return NULL;
+    }
+    DPRINT("Creating decompression struct!\n");
+    /*  Tell our info struct to be decompression  */
+    jpeg_create_decompress(&(decoder->cinfo));
+    decoder->next = NULL;
+    return decoder;
+}
+
+/*
+ *  Put a decoder back in the pool, ready for the next block
  */
-NITFPRIV(NITF_BOOL) findBlockSOI(JPEGImplControl* control,
-                                 nitf_Uint32 blockNumber,
-                                 off_t* soi,
-                                 nitf_Error* error)
+NITFPRIV(void) JPEGDecoder_release(JPEGImplControl* implControl,
+                                   JPEGDecoder* decoder)
 {
-    nitf_ListIterator x = nitf_List_begin(control->markerList);
-    nitf_ListIterator end = nitf_List_end(control->markerList);
-    int j = -1;
+    jpeg_abort_decompress(&(decoder->cinfo));
+
+    nitf_Mutex_lock(&(implControl->lock));
+    decoder->next = implControl->decoders;
+    implControl->decoders = decoder;
+    nitf_Mutex_unlock(&(implControl->lock));
+}
 
-    for (x = nitf_List_begin(control->markerList);
-            nitf_ListIterator_notEqualTo(&x, &end);
-            nitf_ListIterator_increment(&x))
+NITFPRIV(void) JPEGDecoder_destruct(JPEGDecoder** decoder)
+{
+    if (*decoder)
     {
-        JPEGMarkerItem* item = (JPEGMarkerItem*)nitf_ListIterator_get(&x);
-        if (strcmp(item->name, "SOI") == 0 && 
-            ((j = item->block) == blockNumber))
-        {
-            *soi = item->off - 2;
-            break;
-        }
-        /*++j;
-        if (j == blockNumber)
-        {
-            *soi = item->off - 2;
-            break;
-        } */
+        jpeg_destroy_decompress(&((*decoder)->cinfo));
+        NITF_FREE(*decoder);
+        *decoder = NULL;
     }
-    if (j != blockNumber)
+}
+
+
+/*!
+ *  Returns the table entry for the block number indicated.
+ *  The information is in the control structure, which was
+ *  generated during implOpen.
+ */
+NITFPRIV(JPEGBlockEntry*) findBlock(JPEGImplControl* control,
+                                    nitf_Uint32 blockNumber,
+                                    nitf_Error* error)
+{
+    JPEGBlockEntry* entry = JPEGBlockTable_find(&control->table,
+                                                blockNumber);
+    if (!entry)
     {
         nitf_Error_initf(error,
                          NITF_CTXT,
                          NITF_ERR_DECOMPRESSION,
                          "Invalid block (no offset found) [%d]", blockNumber);
-        return NITF_FAILURE;
+        return NULL;
     }
-    return NITF_SUCCESS;
+    return entry;
 }
 
-NITFPRIV(nitf_Uint8*) implReadBlock(nitf_DecompressionControl* control,
-        nitf_Uint32 blockNumber,
-        /*        NITF_BOOL separateBands,*/
-        nitf_Error* error)
+/*
+ *  The block could not be decoded and the error says why.  Fail, or
+ *  fill the block with zeros if zero blocks are enabled.
+ */
+NITFPRIV(NITF_BOOL) failBlock(JPEGImplControl* implControl,
+                              nitf_Uint32 blockNumber,
+                              nitf_Uint8* buffer,
+                              size_t size,
+                              nitf_Error* error)
 {
-    /*
-     *  For now, do as I say (to test that you dont break anything in
-     *  the trivial case  
-     */
-    NITF_BOOL separateBands = 0;
+#ifdef ZERO_BLOCK
+#ifdef ZERO_BLOCK_WARN
+    fprintf(stderr,
+            "JPEG Decompression error: %s, returning zeros for block %d\n",
+            error->message, blockNumber);
+#endif
+    (void)implControl;
+    memset(buffer, 0, size);
+    return NITF_SUCCESS;
+#else
+    (void)implControl;
+    (void)blockNumber;
+    (void)buffer;
+    (void)size;
+    (void)error;
+    return NITF_FAILURE;
+#endif
+}
 
+NITFPRIV(NITF_BOOL) implReadBlockInto(nitf_DecompressionControl* control,
+                                      nitf_Uint32 blockNumber,
+                                      nitf_Uint8* buffer,
+                                      size_t size,
+                                      nitf_Error* error)
+{
     /*  Get out the read object from the opaque handle  */
     JPEGImplControl* implControl = (JPEGImplControl*)control;
-    off_t soi;
-
-    struct jpeg_error_mgr jerr;
-    struct jpeg_decompress_struct cinfo;
+    JPEGBlockEntry* entry;
+    JPEGDecoder* decoder;
+    struct jpeg_decompress_struct* cinfo;
 
-    JSAMPARRAY buffer;
-    int row_stride;
+    JSAMPROW row;
+    size_t row_stride;
     int ret;
-    JPEGBlock* block;
-    NITF_DATA *uncompressed;
 
-    if (!findBlockSOI(control, blockNumber, &soi, error))
-#ifdef ZERO_BLOCK
-    {
-        nitf_Uint8 *zeros; /* Buffer of zeros */
+    entry = findBlock(implControl, blockNumber, error);
+    if (!entry)
+        return failBlock(implControl, blockNumber, buffer, size, error);
 
-        zeros = NITF_MALLOC(implControl->length);
-        if (zeros == NULL)
-        {
-            nitf_Error_init(error, "Malloc failure for zero block",
-                    NITF_CTXT, NITF_ERR_MEMORY);
-            return(NULL);
-        }
-#ifdef ZERO_BLOCK_WARN
-        fprintf(stderr,
-                "JPEG Decompression error: No SOI for block %d, returning zeros\n",
-                blockNumber);
-#endif
-        memset(zeros, 0, implControl->length);
-        return(zeros);
-    }
-#else
-    {
-        nitf_Error_initf(error, NITF_CTXT, NITF_ERR_DECOMPRESSION,
-                "Missing SOI for block %d", blockNumber);
-        return(NULL);
-    }
-#endif
+    DPRINTA2("Found SOI [%d] for block # %d\n", (int)entry->soi,
+             (int)blockNumber);
+
+    decoder = JPEGDecoder_acquire(implControl, error);
+    if (!decoder)
+        return NITF_FAILURE;
+    cinfo = &(decoder->cinfo);
 
-    DPRINTA2("Found SOI [%d] for block # %d\n", (int)soi, (int)blockNumber);
-    /*  We need to locate our block offset!! */
-    if (nitf_IOInterface_seek(implControl->ioInterface, soi,
-                    NITF_SEEK_SET, error) == (nitf_Off)-1)
+    if (setjmp(decoder->jump))
     {
-        nitf_Error_init(error, NITF_STRERROR( NITF_ERRNO ),
+        char message[JMSG_LENGTH_MAX];
+        (*(cinfo->err->format_message)) ((j_common_ptr)cinfo, message);
+        nitf_Error_initf(error,
                 NITF_CTXT,
-                NITF_ERR_DECOMPRESSION);
+                NITF_ERR_DECOMPRESSION,
+                "JPEG decompression failed for block [%d]: %s",
+                blockNumber, message);
+        JPEGDecoder_release(implControl, decoder);
+        return failBlock(implControl, blockNumber, buffer, size, error);
     }
 
-    /*  Set up the error handler  */
-    cinfo.err = jpeg_std_error(&jerr);
-    DPRINT("Creating decompression struct!\n");
-    /*  Tell our info struct to be decompression  */
-    jpeg_create_decompress(&cinfo);
-
     /*  Bind up our source location */
-    /*jpeg_stdio_src(&cinfo, jstream);*/
-    JPEGCreateIOSource(&cinfo, implControl, error);
+    JPEGSetIOSource(decoder, implControl, entry, error);
 
     /*  Read the header  */
     DPRINT("Reading header... ");
-    ret = jpeg_read_header(&cinfo, 0);
-    DPRINTA2("success! [%dx%d]\n", cinfo.image_width, cinfo.image_height);
+    ret = jpeg_read_header(cinfo, 0);
+    DPRINTA2("success! [%dx%d]\n", cinfo->image_width, cinfo->image_height);
     if (ret != JPEG_HEADER_OK)
-#ifdef ZERO_BLOCK
-    {
-        nitf_Uint8 *zeros; /* Buffer of zeros */
-
-        zeros = NITF_MALLOC(implControl->length);
-        if (zeros == NULL)
-        {
-            nitf_Error_init(error, "Malloc failure for zero block",
-                    NITF_CTXT, NITF_ERR_MEMORY);
-            return(NULL);
-        }
-#ifdef ZERO_BLOCK_WARN
-        fprintf(stderr,
-                "JPEG Decompression error: "
-                "Invalid JPEG Header for block %d, returning zeros\n",
-                blockNumber);
-#endif
-        memset(zeros, 0, implControl->length);
-        return(zeros);
-    }
-#else
     {
         nitf_Error_initf(error,
                 NITF_CTXT,
                 NITF_ERR_READING_FROM_FILE,
                 "Invalid JPEG Header for block [%d]",
                 blockNumber);
-        return NULL;
+        JPEGDecoder_release(implControl, decoder);
+        return failBlock(implControl, blockNumber, buffer, size, error);
     }
-#endif
 
-    jpeg_start_decompress(&cinfo);
+    jpeg_start_decompress(cinfo);
     DPRINT("Started decompress... \n");
-    block =
-    JPEGBlock_construct(cinfo.output_height,
-            cinfo.output_width,
-            cinfo.output_components,
-            error);
 
-    if (!block)
-#ifdef ZERO_BLOCK
-    {
-        nitf_Uint8 *zeros; /* Buffer of zeros */
-
-        zeros = NITF_MALLOC(implControl->length);
-        if (zeros == NULL)
-        {
-            nitf_Error_init(error, "Malloc failure for zero block",
-                    NITF_CTXT, NITF_ERR_MEMORY);
-            return(NULL);
-        }
-#ifdef ZERO_BLOCK_WARN
-        fprintf(stderr,
-                "JPEG Decompression error: "
-                "Block object construct failed for block %d, returning zeros",
-                blockNumber);
-#endif
-        memset(zeros, 0, implControl->length);
-        return(zeros);
-    }
-#else
+    /*  The scanlines go straight into the caller's buffer  */
+    row_stride = (size_t)cinfo->output_width * cinfo->output_components;
+    if (row_stride * cinfo->output_height > size)
     {
         nitf_Error_initf(error,
                 NITF_CTXT,
                 NITF_ERR_DECOMPRESSION,
-                "Block object construct failed for block [%d]",
+                "Block [%d] is larger than the blocking info allows",
                 blockNumber);
-        return NULL;
+        JPEGDecoder_release(implControl, decoder);
+        return failBlock(implControl, blockNumber, buffer, size, error);
     }
-#endif
 
-    row_stride = cinfo.output_width *
-    cinfo.output_components;
-    buffer = (cinfo.mem->alloc_sarray)
-    ((j_common_ptr) & cinfo,
-            JPOOL_IMAGE, row_stride, 1);
-
-    while (cinfo.output_scanline <
-            cinfo.output_height)
+    while (cinfo->output_scanline < cinfo->output_height)
     {
-        jpeg_read_scanlines(&cinfo, buffer, 1);
-        /* Clobbering each time  */
-        JPEGBlock_append(block, buffer[0], row_stride);
+        row = buffer + cinfo->output_scanline * row_stride;
+        jpeg_read_scanlines(cinfo, &row, 1);
     }
 
-    jpeg_finish_decompress(&cinfo);
-    jpeg_destroy_decompress(&cinfo);
+    jpeg_finish_decompress(cinfo);
+    JPEGDecoder_release(implControl, decoder);
     DPRINT("JPEG decompression complete\n");
     DPRINT("=============================================================\n");
+    return NITF_SUCCESS;
+}
+
+NITFPRIV(nitf_Uint8*) implReadBlock(nitf_DecompressionControl* control,
+        nitf_Uint32 blockNumber,
+        nitf_Error* error)
+{
+    JPEGImplControl* implControl = (JPEGImplControl*)control;
+    nitf_Uint8* uncompressed;
 
-    /*  We separate bands if it is multi-band AND Band-interleaved */
-    /*  by block                                                   */
-    if (separateBands)
+    uncompressed = (nitf_Uint8*)NITF_MALLOC(implControl->length);
+    if (!uncompressed)
     {
-        JPEGBlock_reorder(block);
+        nitf_Error_init(error, NITF_STRERROR( NITF_ERRNO ),
+                NITF_CTXT, NITF_ERR_MEMORY);
+        return NULL;
     }
 
-    uncompressed = (nitf_Uint8*)(block->uncompressed);
-    block->uncompressed = NULL;
-    JPEGBlock_destruct(&block);
-
+    if (!implReadBlockInto(control, blockNumber, uncompressed,
+                           implControl->length, error))
+    {
+        NITF_FREE(uncompressed);
+        return NULL;
+    }
     return uncompressed;
 }
 
@@ -1459,13 +1525,18 @@ NITFPRIV(void) implClose(nitf_DecompressionControl** control)
     DPRINT("Destroying compression object in JPEG plugin\n");
     implControl = (JPEGImplControl*) * control;
 
-    /* delete marker list */
-    if (implControl && implControl->markerList)
-    {
-        nitf_List_destruct(&implControl->markerList);
-    }
+    /* delete the decoders and the block table */
     if (implControl)
     {
+        while (implControl->decoders)
+        {
+            JPEGDecoder* decoder = implControl->decoders;
+            implControl->decoders = decoder->next;
+            JPEGDecoder_destruct(&decoder);
+        }
+        nitf_Mutex_delete(&(implControl->lock));
+        if (implControl->table.entries)
+            NITF_FREE(implControl->table.entries);
         NITF_FREE(implControl);
     }
     *control = NULL;
@@ -45,6 +45,7 @@
 #include "nitf/ImageWriter.h"
 #include "nitf/LabelSegment.h"
 #include "nitf/LabelSubheader.h"
+#include "nitf/LazyTRE.h"
 #include "nitf/LookupTable.h"
 #include "nitf/PluginIdentifier.h"
 #include "nitf/PluginRegistry.h"
@@ -74,6 +74,10 @@ typedef enum _nitf_FieldType
  *  to be a field.  Finally, it contains a type, which is responsible
  *  for determining how it should compensate for the disparity between
  *  an actual length provided by the user, and the length that is required
+ *
+ *  A field parsed while an arena is current (see nitf_Reader_setUseArena)
+ *  keeps its buffer in that arena, so the buffer of such a field must only
+ *  be replaced through the nitf_Field API.
  */
 typedef struct _nitf_Field
 {
@@ -68,6 +68,15 @@
 /*! \def NITF_IMAGE_IO_PIXEL_TYPE_12 - 12 bit integer signed or unsigned */
 #define NITF_IMAGE_IO_PIXEL_TYPE_12 ((nitf_Uint32) 0x01000000)
 
+/*! \def NITF_READ_AHEAD_OFF - No read-ahead (the default) */
+#define NITF_READ_AHEAD_OFF 0
+
+/*! \def NITF_READ_AHEAD_AUTO - Read ahead once reads are sequential */
+#define NITF_READ_AHEAD_AUTO 1
+
+/*! \def NITF_READ_AHEAD_SEQUENTIAL - Read ahead after every read */
+#define NITF_READ_AHEAD_SEQUENTIAL 2
+
 NITF_CXX_GUARD
 
 /*!
@@ -163,6 +172,86 @@ NITFPROT(NITF_BOOL) nitf_ImageIO_writeSequential(nitf_ImageIO * nitf,
                                                  nitf_Error * error
                                                 );
 
+/*!
+  \brief nitf_ImageIO_writeBlocksBegin - Lay out the image data for writes
+   of whole blocks in any order
+
+  nitf_ImageIO_writeBlocksBegin sets up the object for
+  nitf_ImageIO_writeBlock. The block and pad masks are written for masked
+  ("NM") images and the file is extended to the end of the image data, so
+  the handle is left positioned after the image data, as after a sequential
+  write. The blocks themselves are written later at their fixed offsets.
+
+  Only uncompressed images ("NC" and "NM") can be written this way, since
+  every block must have a known size. Single bit and 12-bit pixels are not
+  supported.
+
+  \param nitf Associated ImageIO object
+  \param io The IO interface to use
+  \param error [out] return errors
+  \return FALSE is returned on error and the error object is set
+*/
+
+NITFPROT(NITF_BOOL) nitf_ImageIO_writeBlocksBegin(nitf_ImageIO * nitf,
+                                                  nitf_IOInterface* io,
+                                                  nitf_Error * error);
+
+/*!
+  \brief nitf_ImageIO_writeBlock - Write one band of one block
+
+  nitf_ImageIO_writeBlock writes one band of the block at the given block
+  row and column. The data is numRowsPerBlock rows of numColsPerBlock
+  pixels in native byte order, including any fill past the edges of the
+  image. It is not modified.
+
+  Blocks may be written in any order, and different blocks (or different
+  bands of one block) may be written from several threads at once. If the
+  interface supports positional writes (see nitf_IOInterface_canWriteAt)
+  the writes proceed concurrently; otherwise they are serialized.
+
+  In the "P" and "R" blocking modes the bands of a block are interleaved in
+  the file, so the bands of a block are collected in memory and the block
+  is written when its last band arrives.
+
+  The object must have been set up by nitf_ImageIO_writeBlocksBegin
+
+  \param nitf Associated ImageIO object
+  \param io The IO interface given to nitf_ImageIO_writeBlocksBegin
+  \param blockRow Block row (zero based)
+  \param blockCol Block column (zero based)
+  \param band Band (zero based)
+  \param data The pixels of the band of the block
+  \param error [out] return errors
+  \return FALSE is returned on error and the error object is set
+*/
+
+NITFPROT(NITF_BOOL) nitf_ImageIO_writeBlock(nitf_ImageIO * nitf,
+                                            nitf_IOInterface* io,
+                                            nitf_Uint32 blockRow,
+                                            nitf_Uint32 blockCol,
+                                            nitf_Uint32 band,
+                                            const nitf_Uint8 * data,
+                                            nitf_Error * error);
+
+/*!
+  \brief nitf_ImageIO_writeBlocksDone - Finish writes of whole blocks
+
+  nitf_ImageIO_writeBlocksDone ends the block writes started by
+  nitf_ImageIO_writeBlocksBegin. Blocks still waiting for some of their
+  bands are discarded and reported as an error. No block writes may be in
+  progress. For images with a pad mask, the masks are written again with
+  the blocks found to hold pad pixels.
+
+  \param nitf Associated ImageIO object
+  \param io The IO interface given to nitf_ImageIO_writeBlocksBegin
+  \param error [out] return errors
+  \return FALSE is returned on error and the error object is set
+*/
+
+NITFPROT(NITF_BOOL) nitf_ImageIO_writeBlocksDone(nitf_ImageIO * nitf,
+                                                 nitf_IOInterface* io,
+                                                 nitf_Error * error);
+
 /*!
   \brief nitf_ImageIO_writeDone - Cleanup for write
  
@@ -283,6 +372,51 @@ nitf_ImageIO_setPadPixel(nitf_ImageIO * object,
     );
 
 
+/*!
+  \brief nitf_ImageIO_setPadBlockOmission - Leave blocks of only pad pixels
+  out of the written image
+
+  nitf_ImageIO_setPadBlockOmission changes an uncompressed ("NC") image to
+  the masked type ("NM"). As each block is completed it is scanned for pad
+  pixels and a block holding nothing else is not written; the block and pad
+  masks that record this are written ahead of the image data. Masked types
+  already do this and are left unchanged.
+
+  The caller must change the IC field of the image subheader to match. S
+  mode blocking is not supported, and the call must be made before the
+  write starts.
+
+  \param object The ImageIO object
+  \param error [out] return errors
+  \return FALSE is returned on error and the error object is set
+*/
+
+NITFPROT(NITF_BOOL)
+nitf_ImageIO_setPadBlockOmission(nitf_ImageIO * object,
+                                 nitf_Error * error);
+
+
+/*!
+  \brief nitf_ImageIO_streamLength - Length of the image data, if it can be
+  known before it is written
+
+  nitf_ImageIO_streamLength gives the number of bytes a sequential write of
+  the image will produce when that depends only on the image layout, that
+  is for uncompressed unmasked ("NC") images of whole byte pixels. A cached
+  write of such an image (see nitf_ImageIO_setWriteCaching) also writes
+  the blocks strictly in file order, except in S mode with several bands
+  and block rows, for which FALSE is returned.
+
+  \param object The ImageIO object
+  \param length [out] The length of the image data
+  \return FALSE if the length is only known by writing the image
+*/
+
+NITFPROT(NITF_BOOL)
+nitf_ImageIO_streamLength(nitf_ImageIO * object,
+                          nitf_Uint64 * length);
+
+
 /*!
   \brief nitf_CompressionControl - Compression control object
 
@@ -511,6 +645,100 @@ typedef NITF_BOOL(*NITF_DECOMPRESSION_INTERFACE_FREE_BLOCK_FUNCTION)
 (nitf_DecompressionControl * object,
  nitf_Uint8 * block, nitf_Error * error);
 
+/*!
+    \brief NITF_DECOMPRESSION_INTERFACE_READ_BLOCK_INTO_FUNCTION - Image
+  decompression interface read block into function
+ 
+  This function pointer type is the type for the readBlockInto field in the
+  decompression interface object. The function reads a block like the
+  readBlock function, but decodes it into a buffer supplied by the caller
+  instead of one allocated by the plugin, so no freeBlock call is needed.
+ 
+  The buffer is at least as large as the block length given in the blocking
+  information passed to the open function.
+ 
+  \ar object      - Associated reader
+  \ar blockNumber - Block number
+  \ar buffer      - Buffer to decode into
+  \ar size        - Size of the buffer in bytes
+  \ar error       - Error object
+ 
+  \return On error, FALSE is returned
+ 
+  On error, the error object is set
+*/
+
+typedef NITF_BOOL(*NITF_DECOMPRESSION_INTERFACE_READ_BLOCK_INTO_FUNCTION)
+(nitf_DecompressionControl * object,
+ nitf_Uint32 blockNumber,
+ nitf_Uint8 * buffer, size_t size, nitf_Error * error);
+
+/*!
+    \brief NITF_DECOMPRESSION_INTERFACE_READ_BLOCK_REDUCED_FUNCTION - Image
+  decompression interface reduced resolution read block function
+ 
+  This function pointer type is the type for the readBlockReduced field in
+  the decompression interface object. The function decodes a block like the
+  readBlockInto function, but at a reduced resolution. Each discarded level
+  halves the block's rows and columns, so only the wavelet levels (or other
+  multi-resolution data) needed for that resolution are decoded.
+ 
+  The block is laid out as a full resolution block would be, with the rows
+  and columns per block divided by 2^discardLevels.
+ 
+  \ar object        - Associated reader
+  \ar blockNumber   - Block number
+  \ar discardLevels - Number of resolution levels to discard
+  \ar buffer        - Buffer to decode into
+  \ar size          - Size of the buffer in bytes
+  \ar error         - Error object
+ 
+  \return On error, FALSE is returned
+ 
+  On error, the error object is set
+*/
+
+typedef NITF_BOOL(*NITF_DECOMPRESSION_INTERFACE_READ_BLOCK_REDUCED_FUNCTION)
+(nitf_DecompressionControl * object,
+ nitf_Uint32 blockNumber, nitf_Uint32 discardLevels,
+ nitf_Uint8 * buffer, size_t size, nitf_Error * error);
+
+/*!
+    \brief NITF_DECOMPRESSION_INTERFACE_READ_BLOCK_REGION_FUNCTION - Image
+  decompression interface read block region function
+ 
+  This function pointer type is the type for the readBlockRegion field in
+  the decompression interface object. The function decodes only a
+  rectangle of a block, so a read of a small part of a large block (e.g.,
+  an untiled JPEG 2000 image) costs in proportion to the part read.
+ 
+  The rectangle is given in pixels relative to the block's upper left
+  corner. The decoded pixels are stored where they would be in the whole
+  block (i.e., the buffer has the layout of a full block). Pixels outside
+  the rectangle are not modified.
+ 
+  \ar object     - Associated reader
+  \ar blockNumber - Block number
+  \ar row        - First row of the rectangle in the block
+  \ar column     - First column of the rectangle in the block
+  \ar numRows    - Number of rows in the rectangle
+  \ar numColumns - Number of columns in the rectangle
+  \ar buffer     - Block buffer to decode into
+  \ar size       - Size of the buffer in bytes
+  \ar error      - Error object
+ 
+  \return On error, FALSE is returned
+ 
+  On error, the error object is set
+*/
+
+typedef NITF_BOOL(*NITF_DECOMPRESSION_INTERFACE_READ_BLOCK_REGION_FUNCTION)
+(nitf_DecompressionControl * object,
+ nitf_Uint32 blockNumber,
+ nitf_Uint32 row, nitf_Uint32 column,
+ nitf_Uint32 numRows, nitf_Uint32 numColumns,
+ nitf_Uint8 * buffer, size_t size, nitf_Error * error);
+
 /*!
     \brief NITF_DECOMPRESSION_CONTROL_DESTROY_FUNCTION - Image decompression
     interface control object destructor
@@ -570,9 +798,42 @@ nitf_CompressionInterface;
   The nitf_DecompressionInterface object provides function entry points for
   decompressing image data. Each object handles a particular type of
   compression.
+
+  The flags field describes what the plugin supports. A plugin that sets
+  NITF_DECOMPRESSION_CONCURRENT_READ_BLOCK may have readBlock called from
+  several threads at once on the same control object, as long as the
+  IOInterface supports positional reads (nitf_IOInterface_canReadAt).
+  Plugins that leave the field zero are always called one block at a time.
+
+  The readBlockInto field was added after the others. Only plugins that set
+  NITF_DECOMPRESSION_READ_BLOCK_INTO in the flags field are known to have it,
+  so it is never used otherwise. When it is present, the library decodes into
+  its own block buffers and does not call readBlock or freeBlock.
+
+  Likewise the readBlockReduced field is only used if the plugin sets
+  NITF_DECOMPRESSION_READ_BLOCK_REDUCED, which requires
+  NITF_DECOMPRESSION_READ_BLOCK_INTO as well. It is used for reads of
+  reduced resolution levels (nitf_ImageIO_readLevel).
+
+  The readBlockRegion field is only used if the plugin sets
+  NITF_DECOMPRESSION_READ_BLOCK_REGION (which also requires
+  NITF_DECOMPRESSION_READ_BLOCK_INTO). The library then decodes only the
+  part of each block a read needs, widening it if later reads need more.
  
 */
 
+/*! \def NITF_DECOMPRESSION_CONCURRENT_READ_BLOCK - readBlock is reentrant */
+#define NITF_DECOMPRESSION_CONCURRENT_READ_BLOCK ((nitf_Uint32) 0x00000001)
+
+/*! \def NITF_DECOMPRESSION_READ_BLOCK_INTO - readBlockInto is present */
+#define NITF_DECOMPRESSION_READ_BLOCK_INTO ((nitf_Uint32) 0x00000002)
+
+/*! \def NITF_DECOMPRESSION_READ_BLOCK_REDUCED - readBlockReduced is present */
+#define NITF_DECOMPRESSION_READ_BLOCK_REDUCED ((nitf_Uint32) 0x00000004)
+
+/*! \def NITF_DECOMPRESSION_READ_BLOCK_REGION - readBlockRegion is present */
+#define NITF_DECOMPRESSION_READ_BLOCK_REGION ((nitf_Uint32) 0x00000008)
+
 typedef struct _nitf_DecompressionInterface
 {
     NITF_DECOMPRESSION_INTERFACE_OPEN_FUNCTION open;    /*!< Prepare for first image data access */
@@ -580,6 +841,10 @@ typedef struct _nitf_DecompressionInterface
     NITF_DECOMPRESSION_INTERFACE_FREE_BLOCK_FUNCTION freeBlock; /*!< Free block returned by readBlock */
     NITF_DECOMPRESSION_CONTROL_DESTROY_FUNCTION destroyControl; /*!< Destructor for decompression control object */
     void *internal;             /*!< Pointer to compression specific internal data */
+    nitf_Uint32 flags;          /*!< Capability flags (NITF_DECOMPRESSION_*) */
+    NITF_DECOMPRESSION_INTERFACE_READ_BLOCK_INTO_FUNCTION readBlockInto; /*!< Read a block into a caller buffer */
+    NITF_DECOMPRESSION_INTERFACE_READ_BLOCK_REDUCED_FUNCTION readBlockReduced; /*!< Read a block at reduced resolution */
+    NITF_DECOMPRESSION_INTERFACE_READ_BLOCK_REGION_FUNCTION readBlockRegion; /*!< Read part of a block */
 }
 nitf_DecompressionInterface;
 
@@ -716,8 +981,14 @@ NITFPROT(void) nitf_ImageIO_destruct(nitf_ImageIO ** nitf);
   \brief nitf_ImageIO_read - Read a sub-window
  
   \b nitf_ImageIO_read reads a sub-window. The user supplies the opened file
-  descriptor and data buffers. The file should allow seeks. The file is left in
-  the file position of the last read.
+  descriptor and data buffers. The file should allow seeks. If the interface
+  supports positional reads, pixel data is read without moving the file
+  position, otherwise the file is left in the file position of the last read.
+ 
+  Several threads may call this function at once on the same object. Each
+  call has its own control state, the shared set-up and block cache are
+  protected by a lock. Interfaces without positional reads, and
+  decompression plugins, are serialized.
  
   If the \em padded argument returns TRUE the request may include pad pixels.
   For blocked images, each block may contain pad pixels. It is possible to
@@ -757,6 +1028,40 @@ NITFPROT(NITF_BOOL) nitf_ImageIO_read(nitf_ImageIO * nitf,
                                       nitf_Error * error
                                      );
 
+/*!
+  \brief nitf_ImageIO_readLevel - Read a sub-window at a reduced resolution
+ 
+  \b nitf_ImageIO_readLevel reads a sub-window of a resolution level of the
+  image. Level 0 is the full resolution image and is read exactly like
+  nitf_ImageIO_read. Each level halves the resolution, the image at level L
+  has ceil(rows/2^L) rows and ceil(columns/2^L) columns, and the sub-window
+  is given in the coordinates of that level. Any down-sampling in the
+  sub-window is applied to the level image.
+ 
+  Only the data needed for the level is decoded. This requires a
+  decompressor that sets NITF_DECOMPRESSION_READ_BLOCK_REDUCED (i.e., JPEG
+  2000) and block dimensions that are multiples of 2^L.
+ 
+  \param nitf         - The ImageIO object
+  \param io           - IO handle for read
+  \param level        - Resolution level (number of levels discarded)
+  \param subWindow    - Sub-window to read, in level coordinates
+  \param user         - User buffers, one per requested band
+  \param padded       - Returns TRUE if pad pixels may have been read
+  \param error        - Error object
+ 
+  \return FALSE is returned on error and the error object is set
+*/
+
+NITFPROT(NITF_BOOL) nitf_ImageIO_readLevel(nitf_ImageIO * nitf,
+                                           nitf_IOInterface* io,
+                                           nitf_Uint32 level,
+                                           nitf_SubWindow * subWindow,
+                                           nitf_Uint8 ** user,
+                                           int *padded,
+                                           nitf_Error * error
+                                          );
+
 /*!
   \brief  nitf_ImageIO_pixelSize - Return the pixel size
  
@@ -849,6 +1154,82 @@ NITFPROT(void) nitf_ImageIO_setReadCaching
     nitf_ImageIO * nitf      /*!< Object to modify */
 );
 
+/*!
+  \brief nitf_ImageIO_setReadCacheSize - Enable cached reads with a budget
+ 
+  See the documentation for nitf_ImageReader_setReadCacheSize
+ 
+  \return None
+*/
+
+NITFPROT(void) nitf_ImageIO_setReadCacheSize
+(
+    nitf_ImageIO * nitf,      /*!< Object to modify */
+    size_t maxBytes           /*!< Maximum bytes of cached blocks */
+);
+
+/*!
+  \brief nitf_ImageIO_getReadCacheStats - Get read cache statistics
+ 
+  See the documentation for nitf_ImageReader_getReadCacheStats
+ 
+  \return None
+*/
+
+NITFPROT(void) nitf_ImageIO_getReadCacheStats
+(
+    nitf_ImageIO * nitf,      /*!< Object to query */
+    nitf_Uint64 * hits,       /*!< Returns the number of cache hits */
+    nitf_Uint64 * misses      /*!< Returns the number of cache misses */
+);
+
+/*!
+  \brief nitf_ImageIO_setDecodeThreads - Set the number of block decode
+  threads
+ 
+  See the documentation for nitf_ImageReader_setDecodeThreads
+ 
+  \return None
+*/
+
+NITFPROT(void) nitf_ImageIO_setDecodeThreads
+(
+    nitf_ImageIO * nitf,      /*!< Object to modify */
+    nitf_Uint32 numThreads    /*!< Number of threads, one disables */
+);
+
+/*!
+  \brief nitf_ImageIO_setReadAhead - Set the read-ahead mode
+
+  See the documentation for nitf_ImageReader_setReadAhead
+
+  \return None
+*/
+
+NITFPROT(void) nitf_ImageIO_setReadAhead
+(
+    nitf_ImageIO * nitf,      /*!< Object to modify */
+    int mode                  /*!< One of the NITF_READ_AHEAD_* modes */
+);
+
+/*!
+  \brief nitf_ImageIO_borrowBlock - Get a pointer to a block in a memory
+  mapped file
+ 
+  See the documentation for nitf_ImageReader_borrowBlock
+ 
+  \return A pointer to the block data or NULL on error
+*/
+
+NITFPROT(const nitf_Uint8 *) nitf_ImageIO_borrowBlock
+(
+    nitf_ImageIO * nitf,      /*!< Object to read from */
+    nitf_IOInterface* io,     /*!< IO interface, must provide a mapping */
+    nitf_Uint32 blockNumber,  /*!< Block to borrow */
+    nitf_Uint64 * blockSize,  /*!< Returns the block size in bytes */
+    nitf_Error * error        /*!< For error returns */
+);
+
 /*!
   \brief nitf_BlockingInfo_print - Print blocking information
  
@@ -47,13 +47,43 @@ nitf_ImageReader_getBlockingInfo(nitf_ImageReader * imageReader,
                                  nitf_Error * error);
 
 /*!
- *  TODO: Add documentation
+ *  Read a sub-window into the user buffers (one per band).
+ *
+ *  Several threads may call this function at once on the same reader,
+ *  each with its own sub-window and buffers. Pixel data is read with
+ *  positional reads when the reader's IOInterface supports them, so the
+ *  calls do not contend for the file offset. Blocks are read and
+ *  decompressed outside the reader's lock; only plugins that do not declare
+ *  NITF_DECOMPRESSION_CONCURRENT_READ_BLOCK decode one block at a time.
+ *
+ *  Three band RGB and two band I/Q pixel interleaved images are read as one
+ *  band of packed pixels until a read asks for all of the bands. That read
+ *  switches the reader to separate bands, so it waits for the packed reads
+ *  in progress to finish, and reads that start meanwhile wait for it.
  */
 NITFAPI(NITF_BOOL) nitf_ImageReader_read(nitf_ImageReader * imageReader,
         nitf_SubWindow * subWindow,
         nitf_Uint8 ** user,
         int *padded, nitf_Error * error);
 
+/*!
+  \brief nitf_ImageReader_readLevel - Read a reduced resolution sub-window
+
+  nitf_ImageReader_readLevel reads a sub-window of resolution level "level",
+  where each level halves the rows and columns of the image and the
+  sub-window is in the coordinates of the level. Only the data needed for
+  the level is decoded. Level 0 is the same as nitf_ImageReader_read. See
+  nitf_ImageIO_readLevel for the requirements on the image.
+
+  \return FALSE is returned on error and the error object is set
+*/
+
+NITFAPI(NITF_BOOL) nitf_ImageReader_readLevel(nitf_ImageReader * imageReader,
+        nitf_Uint32 level,
+        nitf_SubWindow * subWindow,
+        nitf_Uint8 ** user,
+        int *padded, nitf_Error * error);
+
 /*!
  *  TODO: Add documentation
  */
@@ -76,6 +106,144 @@ NITFAPI(void) nitf_ImageReader_setReadCaching
     nitf_ImageReader * iReader  /*!< Object to modify */
 );
 
+/*!
+  \brief nitf_ImageReader_setReadCacheSize - Enable cached reads with a
+  memory budget
+
+  nitf_ImageReader_setReadCacheSize enables cached reads (see
+  nitf_ImageReader_setReadCaching) and sets the maximum number of bytes of
+  decoded blocks kept in the cache. When the budget is exceeded the least
+  recently used blocks are released. The cache always holds at least one
+  block, so a budget of zero gives the default single block cache.
+
+  Compressed blocks are charged their decompressed size.
+
+  \return None
+*/
+
+NITFAPI(void) nitf_ImageReader_setReadCacheSize
+(
+    nitf_ImageReader * iReader, /*!< Object to modify */
+    size_t maxBytes             /*!< Maximum bytes of cached blocks */
+);
+
+/*!
+  \brief nitf_ImageReader_getReadCacheStats - Get read cache statistics
+
+  nitf_ImageReader_getReadCacheStats returns the number of block requests
+  satisfied from the read cache (hits) and the number that required a
+  read or decompression (misses) since the reader was created. Either
+  argument may be NULL.
+
+  \return None
+*/
+
+NITFAPI(void) nitf_ImageReader_getReadCacheStats
+(
+    nitf_ImageReader * iReader, /*!< Object to query */
+    nitf_Uint64 * hits,         /*!< Returns the number of cache hits */
+    nitf_Uint64 * misses        /*!< Returns the number of cache misses */
+);
+
+/*!
+  \brief nitf_ImageReader_setDecodeThreads - Decode blocks in parallel
+
+  nitf_ImageReader_setDecodeThreads sets the number of threads used to
+  decompress blocks. When more than one thread is requested, each read
+  of a compressed image first finds the blocks its sub-window touches that
+  are not already in the read cache and decodes them concurrently, in
+  batches, as the rows are assembled from the decoded blocks. The decoded
+  blocks of a batch are added to the read cache when the read moves on to
+  the next batch or completes.
+
+  Parallel decoding is only done if the decompression plugin declares
+  NITF_DECOMPRESSION_CONCURRENT_READ_BLOCK and the IOInterface supports
+  positional reads. Otherwise, and when numThreads is zero or one, blocks
+  are decoded one at a time as they are needed.
+
+  A batch is half of the read cache size (see
+  nitf_ImageReader_setReadCacheSize), but at least numThreads blocks, and
+  room is made in the cache for it before it is decoded, so a parallel read
+  keeps the cache and the batch it is using within the cache size unless
+  numThreads blocks do not fit.
+
+  \return None
+*/
+
+NITFAPI(void) nitf_ImageReader_setDecodeThreads
+(
+    nitf_ImageReader * iReader, /*!< Object to modify */
+    nitf_Uint32 numThreads      /*!< Number of threads, one disables */
+);
+
+/*!
+  \brief nitf_ImageReader_setReadAhead - Read the next strip in the
+  background
+
+  nitf_ImageReader_setReadAhead lets the reader guess the next read and
+  fetch its blocks while the caller works on the current one. The guess is
+  the same columns and bands as the last read, starting on the row after
+  it. When the last read returns, the blocks of the guessed read that are
+  not in the read cache are read or decompressed on a background thread
+  and added to the cache. The file system is also told to start reading
+  them in (posix_fadvise on Unix). The next read waits for the background
+  thread before it starts.
+
+  In NITF_READ_AHEAD_AUTO mode, reads ahead only after a read that starts
+  on the row after the previous read (a top to bottom strip scan). In
+  NITF_READ_AHEAD_SEQUENTIAL mode, the caller promises a strip scan and
+  every read is followed by a read-ahead. NITF_READ_AHEAD_OFF, the
+  default, disables it. Read-ahead does nothing for down-sampled reads,
+  for IOInterfaces without positional reads or for compressed images whose
+  plugin does not declare NITF_DECOMPRESSION_CONCURRENT_READ_BLOCK.
+
+  Read-ahead enables cached reads (see nitf_ImageReader_setReadCaching).
+  The cache must hold the blocks of two reads or the blocks read ahead
+  will be evicted before they are used; see
+  nitf_ImageReader_setReadCacheSize. Errors in the background are not
+  reported, the read that needs the block reports them.
+
+  The background thread keeps reading the IOInterface of the last read
+  after that read returns. The IOInterface must stay open until the next
+  read, until read-ahead is turned off with NITF_READ_AHEAD_OFF, which
+  waits for the thread, or until the reader is destructed.
+
+  \return None
+*/
+
+NITFAPI(void) nitf_ImageReader_setReadAhead
+(
+    nitf_ImageReader * iReader, /*!< Object to modify */
+    int mode                    /*!< One of the NITF_READ_AHEAD_* modes */
+);
+
+/*!
+  \brief nitf_ImageReader_borrowBlock - Get a pointer to a block without
+  copying it
+
+  nitf_ImageReader_borrowBlock returns a pointer to the pixel data of one
+  block inside the memory mapping of a reader opened on a memory mapped
+  IOInterface (see nitf_MMapAdapter_open). No data is copied. The block is
+  returned as it is stored: blockSize bytes holding the rows of the block
+  in order, with the bands interleaved as the blocking mode requires. In S
+  mode the block numbers of each band follow those of the previous band.
+
+  Borrowing is only supported for uncompressed images whose pixels do not
+  need byte swapping or unpacking on this machine, and only for blocks that
+  are present in the file. The pointer remains valid until the reader's
+  IOInterface is closed and must not be written through.
+
+  \return A pointer to the block data or NULL on error
+*/
+
+NITFAPI(const nitf_Uint8 *) nitf_ImageReader_borrowBlock
+(
+    nitf_ImageReader * iReader, /*!< Object to read from */
+    nitf_Uint32 blockNumber,    /*!< Block to borrow */
+    nitf_Uint64 * blockSize,    /*!< Returns the block size in bytes */
+    nitf_Error * error          /*!< For error returns */
+);
+
 NITF_CXX_ENDGUARD
 
 #endif
@@ -65,6 +65,9 @@ NITFAPI(NITF_BOOL) nitf_ImageWriter_attachSource(nitf_ImageWriter * writer,
  * same storage since the blocks of the S mode image are smaller (each
  * contains only one band of data)
  *
+ * Compressed images and packed (1 and 12-bit) pixels are always written
+ * with caching, since they are only formatted a block at a time.
+ *
  * \return Returns the current enable/disable state
  */
 NITFAPI(int) nitf_ImageWriter_setWriteCaching
@@ -73,6 +76,52 @@ NITFAPI(int) nitf_ImageWriter_setWriteCaching
     int enable                      /*!< Enable cached writes if true */
 );
 
+/*!
+ * \brief nitf_ImageWriter_setRowsPerStrip - Set the rows moved per write
+ *
+ * nitf_ImageWriter_setRowsPerStrip sets how many rows the writer reads from
+ * each band source, and hands to the image blocker, at a time. Each band
+ * source is read for a whole strip before the next band is read, so one
+ * strip buffer per band is held for the duration of the write.
+ *
+ * The default (numRows of 0) is one block row, limited to about 64MB of
+ * buffers for very tall blocks. When the strip height is a whole number of
+ * block rows, and write caching has not been set explicitly with
+ * nitf_ImageWriter_setWriteCaching, blocks are written whole through the
+ * write cache. A strip height of 1 gives the original row at a time order.
+ *
+ * \return Returns the previous setting
+ */
+NITFAPI(nitf_Uint32) nitf_ImageWriter_setRowsPerStrip
+(
+    nitf_ImageWriter * iWriter,     /*!< Object to modify */
+    nitf_Uint32 numRows             /*!< Rows per strip, 0 for the default */
+);
+
+/*!
+ * \brief nitf_ImageWriter_setPipelining - Enable/disable pipelined writes
+ *
+ * nitf_ImageWriter_setPipelining enables/disables pipelined writes. A
+ * pipelined write runs its three stages at once: the next strip (see
+ * nitf_ImageWriter_setRowsPerStrip) is read from the band sources on one
+ * thread while the current strip is formatted, packed and compressed, and
+ * the finished data is written to the output from a third thread through
+ * a write behind adapter (nitf_WriteBehindAdapter_construct). Large writes
+ * then take about as long as the slowest stage rather than the sum of all
+ * three.
+ *
+ * This takes a second strip buffer for each band and two output buffers of
+ * about a strip. The band sources are read concurrently with the output
+ * writes, so they must not read from the output.
+ *
+ * \return Returns the previous enable/disable state
+ */
+NITFAPI(int) nitf_ImageWriter_setPipelining
+(
+    nitf_ImageWriter * iWriter,     /*!< Object to modify */
+    int enable                      /*!< Enable pipelined writes if true */
+);
+
 /*!
  *  Function allows the user access to the product's pad pixels.
  *  For example, if you wanted transparent pixels for fill, you would
@@ -90,6 +139,100 @@ NITFAPI(NITF_BOOL) nitf_ImageWriter_setPadPixel(nitf_ImageWriter* imageWriter,
                                                 nitf_Uint32 length,
                                                 nitf_Error* error);
 
+/*!
+ *  Leave blocks that hold nothing but pad pixels out of the file. Each
+ *  block is scanned for pad as it is completed, and the block and pad masks
+ *  that describe the missing blocks are written with the image. An
+ *  uncompressed ("NC") image is changed to the masked type ("NM"), which
+ *  sets the IC field of the image subheader. Masked images ("NM" and "M*")
+ *  already omit pad blocks and are left unchanged.
+ *
+ *  The pad value is the one given to nitf_ImageWriter_setPadPixel (zero
+ *  by default). S mode blocking is not supported, and this cannot be
+ *  combined with nitf_ImageWriter_enableBlockWrites, since the offset of
+ *  each block depends on the blocks written before it. This must be
+ *  called before nitf_Writer_write.
+ *
+ *  \param writer  The image writer
+ *  \param error   An error to populate if the function fails
+ *  \return NITF_SUCCESS if function succeeded, NITF_FAILURE if function
+ *  failed
+ */
+NITFAPI(NITF_BOOL) nitf_ImageWriter_enablePadBlockOmission(
+        nitf_ImageWriter* writer, nitf_Error* error);
+
+/*!
+ *  Write the image a block at a time instead of from an image source.
+ *  Blocks may then be written in any order, and from several threads at
+ *  once, with nitf_ImageWriter_writeBlock.
+ *
+ *  nitf_Writer_write lays out the image data, writing the block mask for
+ *  "NM" images and extending the file past the image, and the blocks are
+ *  written afterwards. Every band of every block must be written before
+ *  nitf_ImageWriter_blockWritesDone is called, and before the output is
+ *  closed or the Writer destructed.
+ *
+ *  Only uncompressed ("NC" and "NM") images with whole byte pixels can be
+ *  written this way, since each block must have a fixed place in the file.
+ *  This must be called before nitf_Writer_write and cannot be combined with
+ *  an image source.
+ *
+ *  \param writer  The image writer
+ *  \param error   An error to populate if the function fails
+ *  \return NITF_SUCCESS if function succeeded, NITF_FAILURE if function
+ *  failed
+ */
+NITFAPI(NITF_BOOL) nitf_ImageWriter_enableBlockWrites(nitf_ImageWriter* writer,
+                                                      nitf_Error* error);
+
+/*!
+ *  Write one band of one block. The data is the block in row major order
+ *  (numRowsPerBlock by numColumnsPerBlock pixels) in native byte order,
+ *  padded as needed for the blocks on the right and bottom edges. This
+ *  function may be called concurrently from several threads.
+ *
+ *  For the "P" and "R" blocking modes, where the bands of a block are
+ *  interleaved, the bands are held in memory until the last band of the
+ *  block is written.
+ *
+ *  \param writer    The image writer
+ *  \param blockRow  Row of the block, in blocks
+ *  \param blockCol  Column of the block, in blocks
+ *  \param band      Band to write
+ *  \param data      The band of the block
+ *  \param error     An error to populate if the function fails
+ *  \return NITF_SUCCESS if function succeeded, NITF_FAILURE if function
+ *  failed
+ */
+NITFAPI(NITF_BOOL) nitf_ImageWriter_writeBlock(nitf_ImageWriter* writer,
+                                               nitf_Uint32 blockRow,
+                                               nitf_Uint32 blockCol,
+                                               nitf_Uint32 band,
+                                               const nitf_Uint8* data,
+                                               nitf_Error* error);
+
+/*!
+ *  Finish block writes. Fails if some blocks had only part of their bands
+ *  written, since those blocks have not been written to the file.
+ *
+ *  \param writer  The image writer
+ *  \param error   An error to populate if the function fails
+ *  \return NITF_SUCCESS if function succeeded, NITF_FAILURE if function
+ *  failed
+ */
+NITFAPI(NITF_BOOL) nitf_ImageWriter_blockWritesDone(nitf_ImageWriter* writer,
+                                                    nitf_Error* error);
+
+/*!
+ *  Tell whether a write handler is an image writer with block writes
+ *  enabled. Used by nitf_Writer_write to decide whether the segment
+ *  writers must outlive the write.
+ *
+ *  \param handler  The write handler, of any kind
+ *  \return NITF_SUCCESS if the handler writes blocks, NITF_FAILURE if not
+ */
+NITFPROT(NITF_BOOL) nitf_ImageWriter_writesBlocks(nitf_WriteHandler* handler);
+
 NITF_CXX_ENDGUARD
 
 #endif
@@ -0,0 +1,85 @@
+/* =========================================================================
+ * This file is part of NITRO
+ * =========================================================================
+ * 
+ * (C) Copyright 2004 - 2010, General Dynamics - Advanced Information Systems
+ *
+ * NITRO is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public 
+ * License along with this program; if not, If not, 
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef __NITF_LAZY_TRE_H__
+#define __NITF_LAZY_TRE_H__
+
+#include "nitf/System.h"
+#include "nitf/TRE.h"
+
+NITF_CXX_GUARD
+
+struct _nitf_Record;
+
+/*!
+ *  \fn nitf_LazyTRE_handler
+ *  \brief The handler installed on TREs whose parsing has been deferred
+ *
+ *  When the reader is asked to defer TRE parsing, it keeps the raw bytes
+ *  of each TRE along with the handler that would have parsed them.  The
+ *  lazy handler parses the bytes the first time a field is requested
+ *  (getField, find, begin, setField, getID or clone), and then hands the
+ *  TRE over to the real handler for good.  A TRE that is never touched is
+ *  written back verbatim.
+ *
+ *  \param error The structure to populate if an error occurs
+ *  \return The handler
+ */
+NITFAPI(nitf_TREHandler*) nitf_LazyTRE_handler(nitf_Error * error);
+
+/*!
+ *  Turn a TRE skeleton into a lazy TRE that adopts the given raw data.
+ *  The data is parsed by handler on first access.  The record is passed
+ *  on to the handler's read method when that happens, so it must still
+ *  exist at that time.
+ *
+ *  \param tre     The TRE skeleton
+ *  \param handler The handler that will parse the data
+ *  \param raw     The raw TRE data (adopted, even on failure)
+ *  \param length  The length of the raw data
+ *  \param record  The record the TRE was read from
+ *  \param error   The structure to populate if an error occurs
+ *  \return NITF_SUCCESS or NITF_FAILURE
+ */
+NITFPROT(NITF_BOOL) nitf_LazyTRE_adopt(nitf_TRE * tre,
+                                       nitf_TREHandler * handler,
+                                       char *raw,
+                                       nitf_Uint32 length,
+                                       struct _nitf_Record *record,
+                                       nitf_Error * error);
+
+/*!
+ *  Parse a lazy TRE now, so that its private data belongs to its real
+ *  handler.  This does nothing for a TRE that is already parsed.  If the
+ *  real handler cannot parse the data, the default handler is used, as
+ *  the reader does for eagerly parsed TREs.
+ *
+ *  \param tre   The TRE
+ *  \param error The structure to populate if an error occurs
+ *  \return NITF_SUCCESS or NITF_FAILURE
+ */
+NITFAPI(NITF_BOOL) nitf_LazyTRE_parse(nitf_TRE * tre, nitf_Error * error);
+
+NITF_CXX_ENDGUARD
+
+#endif
@@ -26,6 +26,7 @@
 #include "nitf/System.h"
 #include "nitf/PluginRegistry.h"
 #include "nitf/DefaultTRE.h"
+#include "nitf/LazyTRE.h"
 #include "nitf/Record.h"
 #include "nitf/FieldWarning.h"
 #include "nitf/ImageReader.h"
@@ -33,6 +34,20 @@
 
 NITF_CXX_GUARD
 
+/*!
+ *  \enum nitf_SegmentType
+ *  \brief The kinds of segment that follow the file header
+ */
+typedef enum _nitf_SegmentType
+{
+    NITF_SEGMENT_IMAGE,         /* Image segment */
+    NITF_SEGMENT_GRAPHIC,       /* Graphic (symbol) segment */
+    NITF_SEGMENT_LABEL,         /* Label segment (2.0 only) */
+    NITF_SEGMENT_TEXT,          /* Text segment */
+    NITF_SEGMENT_DE,            /* Data extension segment */
+    NITF_SEGMENT_RE             /* Reserved extension segment */
+} nitf_SegmentType;
+
 /*!
  *  \struct nitf_Reader
  *  \brief  This object represents the 2.1 file reader
@@ -46,6 +61,12 @@ typedef struct _nitf_Reader
     nitf_IOInterface* input;
     nitf_Record *record;
     NITF_BOOL ownInput;
+    NITF_BOOL lazyTREs;     /* Defer TRE parsing until first access */
+    NITF_BOOL useArena;     /* Parse records into an arena */
+    nitf_Arena *arena;      /* The arena of the last record read */
+    /* Index records: per segment, set once its subheader is loaded */
+    nitf_Uint8 *loaded[NITF_SEGMENT_RE + 1];
+    nitf_Uint32 numIndexed[NITF_SEGMENT_RE + 1];
 
 }
 nitf_Reader;
@@ -94,6 +115,101 @@ NITFAPI(nitf_Record *) nitf_Reader_readIO(nitf_Reader* reader,
                                           nitf_Error* error);
 
 
+/*!
+ *  Read only the index of a NITF: the file header and the location of
+ *  every segment.  This is much cheaper than nitf_Reader_read, and is
+ *  meant for scanning large numbers of files.
+ *
+ *  The returned record has a fully read file header, and one segment per
+ *  entry in the header's component info.  The data offsets and ends of the
+ *  segments are set, but their subheaders are left empty until they are
+ *  loaded with nitf_Reader_loadSubheader.  TREs are not parsed until they
+ *  are accessed (see nitf_Reader_setLazyTREs), so looking TREs up by name
+ *  only parses the ones that are found.
+ *
+ *  An index-only record is for inspection.  Load the subheader of an image
+ *  segment before calling nitf_Reader_newImageReader on it, and load all of
+ *  them before writing the record.  TRE_OVERFLOW segments are only read
+ *  when their subheader is loaded.
+ *
+ *  \param reader   The reader object
+ *  \param ioHandle The file io
+ *  \param error    A populated error if return value is NULL
+ *  \return A dynamically allocated, index-only record
+ */
+NITFAPI(nitf_Record *) nitf_Reader_readIndex(nitf_Reader * reader,
+                                             nitf_IOHandle ioHandle,
+                                             nitf_Error * error);
+
+/*!
+ *  Same as nitf_Reader_readIndex, using an IOInterface.
+ */
+NITFAPI(nitf_Record *) nitf_Reader_readIndexIO(nitf_Reader * reader,
+                                               nitf_IOInterface * io,
+                                               nitf_Error * error);
+
+/*!
+ *  Read the subheader of one segment of a record returned by
+ *  nitf_Reader_readIndex.  The subheader is read in place, so pointers to
+ *  the segment stay valid.  Loading a subheader that is already loaded
+ *  does nothing, and any record from nitf_Reader_read is fully loaded.
+ *  If loading fails, the segment gets a new, empty subheader, and loading
+ *  it may be tried again.  TREs in the subheader are parsed on first
+ *  access.
+ *
+ *  \param reader The reader that read the record
+ *  \param type   The type of the segment
+ *  \param index  The index of the segment among those of its type
+ *  \param error  A populated error if return value is zero
+ *  \return NITF_SUCCESS or NITF_FAILURE
+ */
+NITFAPI(NITF_BOOL) nitf_Reader_loadSubheader(nitf_Reader * reader,
+                                             nitf_SegmentType type,
+                                             nitf_Uint32 index,
+                                             nitf_Error * error);
+
+/*!
+ *  Called by nitf_Reader_scanFiles for each file.  On success, record is
+ *  the index-only record of the file, and reader may be used to load
+ *  subheaders from it.  On failure, record is NULL and error says why.
+ *  The reader and record are destroyed once the function returns.  The
+ *  function is called from several threads at once.
+ *
+ *  \param userData  The data given to nitf_Reader_scanFiles
+ *  \param fileIndex The index of the file in the list
+ *  \param fileName  The name of the file
+ *  \param reader    The reader of the file, or NULL
+ *  \param record    The index-only record of the file, or NULL
+ *  \param error     The error, if record is NULL
+ */
+typedef void (*NITF_READER_SCAN_FUNCTION) (NITF_DATA * userData,
+                                           nitf_Uint32 fileIndex,
+                                           const char *fileName,
+                                           nitf_Reader * reader,
+                                           nitf_Record * record,
+                                           nitf_Error * error);
+
+/*!
+ *  Read the index of each file in a list, using several threads, and
+ *  hand each one to a callback.  Files that cannot be read are reported
+ *  to the callback and do not stop the scan.
+ *
+ *  \param fileNames  The files to scan
+ *  \param numFiles   The number of files
+ *  \param numThreads The number of threads to use (0 is treated as 1)
+ *  \param callback   Called once for each file
+ *  \param userData   Passed to the callback
+ *  \param error      A populated error if return value is zero
+ *  \return NITF_SUCCESS, or NITF_FAILURE if the scan could not be run
+ */
+NITFAPI(NITF_BOOL) nitf_Reader_scanFiles(const char **fileNames,
+                                         nitf_Uint32 numFiles,
+                                         nitf_Uint32 numThreads,
+                                         NITF_READER_SCAN_FUNCTION callback,
+                                         NITF_DATA * userData,
+                                         nitf_Error * error);
+
+
 /*!
  * This creates a new ImageReader object that can be used to access the
  * data in the image segment.  This should be done after the read()
@@ -166,6 +282,42 @@ NITFAPI(nitf_SegmentReader *) nitf_Reader_newDEReader
 );
 
 
+/*!
+ *  Choose whether TREs are parsed as they are read (the default) or on
+ *  first access.  A deferred TRE keeps only its raw bytes until one of
+ *  its fields is asked for through nitf_TRE_getField, nitf_TRE_find,
+ *  nitf_TRE_begin or the like, and is written back verbatim if it is
+ *  never touched.  This makes opening files with large TREs much cheaper
+ *  when only a few of them are used.  Parsing a deferred TRE modifies it,
+ *  so concurrent first accesses to the same TRE must be synchronized by
+ *  the caller.  DES user-defined subheaders are always parsed.
+ *
+ *  \param reader The reader object
+ *  \param lazy   Non-zero to defer TRE parsing
+ */
+NITFAPI(void) nitf_Reader_setLazyTREs(nitf_Reader * reader, NITF_BOOL lazy);
+
+
+/*!
+ *  Choose whether records are parsed into an arena (see nrt/Arena.h).
+ *  When on, each record read gets its own arena, and the fields, lists
+ *  and hash tables built while parsing it are carved out of large chunks
+ *  rather than allocated one by one.  Subheaders loaded later with
+ *  nitf_Reader_loadSubheader go into the same arena.  The record may be
+ *  modified, cloned or taken apart as usual; objects replaced later come
+ *  from the heap, and the chunks are released together once the last
+ *  object in the arena has been destroyed.  The default is off.
+ *
+ *  Field buffers and pair keys of such a record are arena memory, so they
+ *  must be replaced through the nitf_Field and nrt_HashTable APIs rather
+ *  than freed directly (as the Python Field.raw and Pair.key setters do).
+ *
+ *  \param reader The reader object
+ *  \param use    Non-zero to parse into an arena
+ */
+NITFAPI(void) nitf_Reader_setUseArena(nitf_Reader * reader, NITF_BOOL use);
+
+
 /*!
  * Return the NITFVersion of the file passed in by its file name.
  * This is a static method (not associated with a specific Reader).
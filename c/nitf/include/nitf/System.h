@@ -204,6 +204,23 @@ typedef nrt_DLL             nitf_DLL;
 #define nitf_Mutex_unlock   nrt_Mutex_unlock
 #define nitf_Mutex_init     nrt_Mutex_init
 #define nitf_Mutex_delete   nrt_Mutex_delete
+#define nitf_Thread         nrt_Thread
+#define NITF_THREAD_RUN_FUNCTION NRT_THREAD_RUN_FUNCTION
+#define nitf_Thread_create  nrt_Thread_create
+#define nitf_Thread_join    nrt_Thread_join
+
+
+/******************************************************************************/
+/* ARENA                                                                      */
+/******************************************************************************/
+#include "nrt/Arena.h"
+typedef nrt_Arena                       nitf_Arena;
+#define NITF_ARENA_DEFAULT_CHUNK_SIZE   NRT_ARENA_DEFAULT_CHUNK_SIZE
+#define nitf_Arena_construct            nrt_Arena_construct
+#define nitf_Arena_release              nrt_Arena_release
+#define nitf_Arena_setCurrent           nrt_Arena_setCurrent
+#define nitf_Arena_malloc               nrt_Arena_malloc
+#define nitf_Arena_free                 nrt_Arena_free
 
 
 /******************************************************************************/
@@ -224,10 +241,15 @@ typedef nrt_Directory                   nitf_Directory;
 #include "nrt/IOHandle.h"
 #define NITF_IO_SUCCESS         NRT_IO_SUCCESS
 #define NITF_MAX_READ_ATTEMPTS  NRT_MAX_READ_ATTEMPTS
+typedef nrt_IOVec               nitf_IOVec;
 
 #define nitf_IOHandle_create    nrt_IOHandle_create
 #define nitf_IOHandle_read      nrt_IOHandle_read
+#define nitf_IOHandle_readAt    nrt_IOHandle_readAt
+#define nitf_IOHandle_readvAt   nrt_IOHandle_readvAt
+#define nitf_IOHandle_adviseWillNeed nrt_IOHandle_adviseWillNeed
 #define nitf_IOHandle_write     nrt_IOHandle_write
+#define nitf_IOHandle_writeAt   nrt_IOHandle_writeAt
 #define nitf_IOHandle_seek      nrt_IOHandle_seek
 #define nitf_IOHandle_tell      nrt_IOHandle_tell
 #define nitf_IOHandle_getSize   nrt_IOHandle_getSize
@@ -248,12 +270,26 @@ typedef NRT_IO_INTERFACE_GET_SIZE       NITF_IO_INTERFACE_GET_SIZE;
 typedef NRT_IO_INTERFACE_GET_MODE       NITF_IO_INTERFACE_GET_MODE;
 typedef NRT_IO_INTERFACE_CLOSE          NITF_IO_INTERFACE_CLOSE;
 typedef NRT_IO_INTERFACE_DESTRUCT       NITF_IO_INTERFACE_DESTRUCT;
+typedef NRT_IO_INTERFACE_READ_AT        NITF_IO_INTERFACE_READ_AT;
+typedef NRT_IO_INTERFACE_WRITE_AT       NITF_IO_INTERFACE_WRITE_AT;
+typedef NRT_IO_COMPLETION               NITF_IO_COMPLETION;
+
+typedef nrt_IORequest                   nitf_IORequest;
 
 typedef nrt_IIOInterface                nitf_IIOInterface;
 typedef nrt_IOInterface                 nitf_IOInterface;
 
 #define nitf_IOInterface_read           nrt_IOInterface_read
+#define nitf_IOInterface_readAt         nrt_IOInterface_readAt
+#define nitf_IOInterface_readvAt        nrt_IOInterface_readvAt
+#define nitf_IOInterface_readBatch      nrt_IOInterface_readBatch
+#define nitf_IOInterface_canReadBatch   nrt_IOInterface_canReadBatch
+#define nitf_IOInterface_canReadAt      nrt_IOInterface_canReadAt
+#define nitf_IOInterface_getMapping     nrt_IOInterface_getMapping
+#define nitf_IOInterface_adviseWillNeed nrt_IOInterface_adviseWillNeed
 #define nitf_IOInterface_write          nrt_IOInterface_write
+#define nitf_IOInterface_writeAt        nrt_IOInterface_writeAt
+#define nitf_IOInterface_canWriteAt     nrt_IOInterface_canWriteAt
 #define nitf_IOInterface_canSeek        nrt_IOInterface_canSeek
 #define nitf_IOInterface_seek           nrt_IOInterface_seek
 #define nitf_IOInterface_tell           nrt_IOInterface_tell
@@ -264,6 +300,13 @@ typedef nrt_IOInterface                 nitf_IOInterface;
 #define nitf_IOHandleAdapter_construct  nrt_IOHandleAdapter_construct
 #define nitf_IOHandleAdapter_open       nrt_IOHandleAdapter_open
 #define nitf_BufferAdapter_construct    nrt_BufferAdapter_construct
+#define nitf_MMapAdapter_construct      nrt_MMapAdapter_construct
+#define nitf_MMapAdapter_open           nrt_MMapAdapter_open
+#define nitf_AsyncIOAdapter_construct   nrt_AsyncIOAdapter_construct
+#define nitf_AsyncIOAdapter_open        nrt_AsyncIOAdapter_open
+#define nitf_AsyncIOAdapter_usesRing    nrt_AsyncIOAdapter_usesRing
+#define nitf_WriteBehindAdapter_construct nrt_WriteBehindAdapter_construct
+#define nitf_WriteBehindAdapter_flush   nrt_WriteBehindAdapter_flush
 
 
 /******************************************************************************/
@@ -42,6 +42,18 @@ typedef NITF_BOOL(*NITF_IWRITEHANDLER_WRITE)(NITF_DATA *data,
  */
 typedef void (*NITF_IWRITEHANDLER_DESTRUCT)(NITF_DATA *);
 
+/*
+ *  Function pointer for finding the length of the data before it is
+ *  written, used by nitf_Writer_writeStreamed.  The handler agrees that
+ *  its next write will write exactly that many bytes, strictly in order,
+ *  seeking only to where the output already is.
+ *  \param data     The ancillary "helper" data
+ *  \param length   [out] The length, or -1 if it is only known by writing
+ *  \param error    populated on error
+ */
+typedef NITF_BOOL(*NITF_IWRITEHANDLER_STREAM_LENGTH)(NITF_DATA *data,
+        nitf_Off *length, nitf_Error *error);
+
 /*!
  *  \struct nitf_IWriteHandler
  *  \brief The "write handler" interface, which handles writing data
@@ -50,6 +62,8 @@ typedef struct _nitf_IWriteHandler
 {
     NITF_IWRITEHANDLER_WRITE write;
     NITF_IWRITEHANDLER_DESTRUCT destruct;
+    /* Optional, may be NULL. Must go last so existing initializers work */
+    NITF_IWRITEHANDLER_STREAM_LENGTH streamLength;
 } nitf_IWriteHandler;
 
 typedef struct _nitf_WriteHandler
@@ -165,10 +165,36 @@ NITFAPI(nitf_SegmentWriter*) nitf_Writer_newDEWriter(nitf_Writer *writer,
 /*!
  * Performs the write operation
  *
+ * The segment writers are destructed by a successful write, unless an
+ * image writer uses block writes (nitf_ImageWriter_enableBlockWrites).
+ * Then they remain valid until the Writer is destructed or prepared
+ * again, so the image writer can write its blocks.
+ *
  * \return NITF_SUCCESS or NITF_FAILURE
  */
 NITFAPI(NITF_BOOL) nitf_Writer_write(nitf_Writer * writer, nitf_Error * error);
 
+/*!
+ * Performs the write operation strictly in order, for an output that
+ * cannot seek, such as a pipe or socket
+ *
+ * nitf_Writer_write fills in the file, header and segment lengths after
+ * the data is written. Here every length is found first. The length of
+ * uncompressed image data and of segment sources comes from the handlers,
+ * which then write it straight to the output as the file is written.
+ * Other data, such as compressed images, is written to memory first
+ * to size it, so enough memory is needed to hold it. An image that is
+ * written straight to the output is written through the block cache.
+ *
+ * The output is only written, never read, sought or sized, and the file
+ * starts where the output is.  Block writes
+ * (nitf_ImageWriter_enableBlockWrites) cannot be streamed.
+ *
+ * \return NITF_SUCCESS or NITF_FAILURE
+ */
+NITFAPI(NITF_BOOL) nitf_Writer_writeStreamed(nitf_Writer * writer,
+                                             nitf_Error * error);
+
 
 NITF_CXX_ENDGUARD
 
@@ -65,7 +65,7 @@ NITFAPI(nitf_Field *) nitf_Field_construct(size_t length,
         goto CATCH_ERROR;
     }
 
-    field = (nitf_Field *) NITF_MALLOC(sizeof(nitf_Field));
+    field = (nitf_Field *) nitf_Arena_malloc(sizeof(nitf_Field));
     if (!field)
     {
         nitf_Error_init(error, NITF_STRERROR(NITF_ERRNO),
@@ -527,11 +527,11 @@ NITFAPI(void) nitf_Field_destruct(nitf_Field ** field)
     {
         if ((*field)->raw)
         {
-            NITF_FREE((*field)->raw);
+            nitf_Arena_free((*field)->raw);
             (*field)->raw = NULL;
         }
 
-        NITF_FREE(*field);
+        nitf_Arena_free(*field);
         *field = NULL;
     }
 }
@@ -1008,7 +1008,7 @@ NITFPROT(NITF_BOOL) nitf_Field_resetLength(nitf_Field * field,
         /* remember old data */
         raw = field->raw;
 
-        field->raw = (char *) NITF_MALLOC(newLength + 1);
+        field->raw = (char *) nitf_Arena_malloc(newLength + 1);
         if (!field->raw)
         {
             field->raw = raw;
@@ -1049,7 +1049,7 @@ NITFPROT(NITF_BOOL) nitf_Field_resetLength(nitf_Field * field,
         }
 
         /* free the old memory */
-        NITF_FREE(raw);
+        nitf_Arena_free(raw);
     }
     else
     {
@@ -1098,12 +1098,12 @@ NITFAPI(NITF_BOOL) nitf_Field_resizeField(nitf_Field *field,
     if (field && newLength != field->length)
     {
         if (field->raw)
-            NITF_FREE(field->raw);
+            nitf_Arena_free(field->raw);
 
         field->raw = NULL;
 
         /* re-malloc */
-        field->raw = (char *) NITF_MALLOC(newLength + 1);
+        field->raw = (char *) nitf_Arena_malloc(newLength + 1);
         if (!field->raw)
         {
             nitf_Error_init(error, NITF_STRERROR(NITF_ERRNO),
@@ -22,6 +22,43 @@
 
 #include "nitf/ImageIO.h"
 
+#ifndef WIN32
+#include <sched.h>
+#endif
+
+/*
+ *  Vector unformat/format kernels. SSE2 is part of the x86-64 instruction
+ *  set so those kernels are always usable there. The AVX2 kernels are
+ *  compiled for that target function by function and are only selected if
+ *  the CPU supports them (see nitf_ImageIO_vectorKernel)
+ */
+#if defined(__GNUC__) && defined(__SSE2__) \
+    && (defined(__x86_64__) || defined(__i386__))
+#define NITF_IMAGE_IO_SSE2
+#if defined(__clang__) || (__GNUC__ > 4) \
+    || ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 9))
+#define NITF_IMAGE_IO_AVX2
+#define NITF_IMAGE_IO_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#elif defined(_MSC_VER) \
+    && (defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2)))
+#define NITF_IMAGE_IO_SSE2
+#if _MSC_VER >= 1700
+#define NITF_IMAGE_IO_AVX2
+#define NITF_IMAGE_IO_TARGET_AVX2
+#endif
+#endif
+
+#ifdef NITF_IMAGE_IO_SSE2
+#include <emmintrin.h>
+#endif
+#ifdef NITF_IMAGE_IO_AVX2
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
 
 /*!
   \file
@@ -132,16 +169,36 @@ compression of a one byte unsigned image.\n
    in bytes */
 #define NITF_IMAGE_IO_PAD_MAX_LENGTH (16)
 
+/*! \def NITF_IMAGE_IO_MAX_EXTENTS - Number of row segments gathered by a
+   coalesced read before they are read */
+#define NITF_IMAGE_IO_MAX_EXTENTS (4096)
+
+/*! \def NITF_IMAGE_IO_COALESCE_GAP - Largest run of unwanted bytes between
+   two row segments that a coalesced read reads through rather than
+   starting a new read */
+#define NITF_IMAGE_IO_COALESCE_GAP (4096)
+
 /*!
   \def NITF_IMAGE_IO_PAD_SCANNER - Macro to a create pad scan function
 
   Most of the logic is to avoid the fill pixels which are at the ends of the
   rows and last rows in blocks on the right and bottom border of the image.
 
+  The block holds all bands (B, P and R blocking modes). It is scanned as
+  one or more planes (one per band for B, one for P and R) of rows. A P
+  mode row holds the pixels of all bands and an R mode plane has one row
+  per band for each row of the block.
+
+  The pad pixels in a row are counted rather than tested one at a time
+  so the inner loop has no branches and can be vectorized. The scan stops
+  as soon as both pad and data have been found.
+
   Notes:
 
-    The padColumnCount is a byte count not a pixel count
-    The padRowCount is a row count
+    The padColumnCount is a byte count not a pixel count, for P mode it
+      includes all of the bands
+    The padRowCount is a row count, for R mode it counts the rows of
+      every band
     The padRowCount only applies if the block is the last
       block in the block column
 
@@ -153,32 +210,56 @@ compression of a one byte unsigned image.\n
     (struct _nitf_ImageIOBlock_s *blockIO, \
      NITF_BOOL *padFound,NITF_BOOL *dataFound) \
     { \
-        type *pixels = (type *) (blockIO->blockControl.block); \
-        type padValue = *((type *) (blockIO->cntl->nitf->pixel.pad)); \
+        _nitf_ImageIO *nitf = blockIO->cntl->nitf; \
+        const type *pixels = (const type *) (blockIO->blockControl.block); \
+        type padValue = *((type *) (nitf->pixel.pad)); \
+        nitf_Uint32 bandFactor; \
+        nitf_Uint32 numPlanes; \
+        size_t planeSize; \
+        size_t rowStride; \
+        nitf_Uint32 rowLimit; \
+        nitf_Uint32 colLimit; \
+        nitf_Uint32 plane; \
         nitf_Uint32 row; \
         nitf_Uint32 col; \
-        nitf_Uint32 rowEndIncr; \
-        nitf_Uint32 colLimit; \
-        nitf_Uint32 rowLimit; \
-        _nitf_ImageIO *nitf = blockIO->cntl->nitf; \
         NITF_BOOL pFound = 0; \
         NITF_BOOL dFound = 0; \
-        rowEndIncr = blockIO->padColumnCount/(nitf->pixel.bytes); \
-        colLimit = blockIO->cntl->nitf->numColumnsPerBlock - rowEndIncr; \
-        rowLimit = blockIO->cntl->nitf->numRowsPerBlock;\
+        bandFactor = \
+            (nitf->blockingMode == NITF_IMAGE_IO_BLOCKING_MODE_S) ? \
+            1 : nitf->numBands; \
+        numPlanes = \
+            (nitf->blockingMode == NITF_IMAGE_IO_BLOCKING_MODE_B) ? \
+            nitf->numBands : 1; \
+        planeSize = ((size_t) nitf->numRowsPerBlock) * \
+            (nitf->numColumnsPerBlock); \
+        rowStride = nitf->numColumnsPerBlock; \
+        if(nitf->blockingMode == NITF_IMAGE_IO_BLOCKING_MODE_P) \
+            rowStride *= bandFactor; \
+        colLimit = (nitf_Uint32) rowStride - \
+            blockIO->padColumnCount/(nitf->pixel.bytes); \
+        rowLimit = nitf->numRowsPerBlock; \
+        if(nitf->blockingMode == NITF_IMAGE_IO_BLOCKING_MODE_R) \
+            rowLimit *= bandFactor; \
         if(blockIO->currentRow >= (nitf->numRows - 1)) \
             rowLimit -= blockIO->padRowCount; \
-        for(row=0;row<rowLimit;row++) \
+        for(plane=0;plane<numPlanes;plane++) \
         { \
-            for(col=0;col<colLimit;col++) \
+            const type *rowPixels = pixels + plane*planeSize; \
+            for(row=0;row<rowLimit;row++) \
             { \
-                if(*(pixels++) == padValue) \
+                nitf_Uint32 padCount = 0; \
+                for(col=0;col<colLimit;col++) \
+                    padCount += (rowPixels[col] == padValue); \
+                if(padCount != 0) \
                     pFound = 1; \
-                else \
+                if(padCount != colLimit) \
                     dFound = 1; \
+                if(pFound && dFound) \
+                    goto done; \
+                rowPixels += rowStride; \
             } \
-            pixels += rowEndIncr; \
         } \
+    done: \
         *padFound = pFound; \
         *dataFound = dFound; \
         return; \
@@ -218,14 +299,19 @@ typedef int (*_NITF_IMAGE_IO_IO_FUNC)(struct _nitf_ImageIOBlock_s * block,
 /*!
   \brief _NITF_IMAGE_IO_PACK_FUNC - Pack/unpack function pointer
 
-  \ar io    - Block I/O structure
-  \ar error - Error object
+  The pack and unpack functions are called once per row segment with the
+  block I/O structures of all of the bands of a block column
+
+  \ar blocks    - Block I/O structures, one for each band
+  \ar numBlocks - Number of block I/O structures
+  \ar error     - Error object
 
   \return None
 */
 
 typedef void (*_NITF_IMAGE_IO_PACK_FUNC)
-(struct _nitf_ImageIOBlock_s * block, nitf_Error * error);
+(struct _nitf_ImageIOBlock_s * blocks, nitf_Uint32 numBlocks,
+ nitf_Error * error);
 
 /*!
   \brief _NITF_IMAGE_IO_UNFORMAT_FUNC - Pixel unformat function pointer
@@ -463,7 +549,8 @@ _nitf_ImageIOParameters;
 
   The block buffers are allocated by the system memory allocation facility
 
-The current implementation supports a cache of one block
+This structure holds a single block and is used by the cached writer. The
+cached reader uses the multi-block _nitf_ImageIOBlockCache
 
 */
 
@@ -475,6 +562,164 @@ typedef struct
 }
 _nitf_ImageIOBlockCacheControl;
 
+/*!
+  \brief _nitf_ImageIOCachedBlock - One entry in the read block cache
+
+  The block number is the index into the full block mask, so for blocking
+  mode "S" it includes the band.
+
+  If the decoded flag is set the buffer was returned by the decompression
+  plugin and must be released through its freeBlock function, otherwise it
+  was allocated by the system memory allocation facility
+
+  A block decoded with the decompressor's readBlockRegion function is only
+  valid in a rectangle (block relative). Whole blocks have a rectangle
+  that covers the block.
+
+  Entries are not changed once they are in the cache. A read copies from an
+  entry without the object's lock, so it holds a use on it while it does.
+  An entry that is evicted or replaced while in use is marked stale and
+  freed when the last use is released.
+*/
+
+typedef struct _nitf_ImageIOCachedBlock_s
+{
+    nitf_Uint32 number;         /*!< Block number */
+    NITF_BOOL decoded;          /*!< Buffer owned by the decompressor if TRUE */
+    nitf_Uint8 *block;          /*!< Block buffer */
+    nitf_Uint32 row;            /*!< First valid row */
+    nitf_Uint32 column;         /*!< First valid column */
+    nitf_Uint32 numRows;        /*!< Number of valid rows */
+    nitf_Uint32 numColumns;     /*!< Number of valid columns */
+    int users;                  /*!< Reads copying from the block */
+    NITF_BOOL stale;            /*!< No longer in the cache if TRUE */
+    /*! Next more recently used entry */
+    struct _nitf_ImageIOCachedBlock_s *prev;
+    /*! Next less recently used entry */
+    struct _nitf_ImageIOCachedBlock_s *next;
+}
+_nitf_ImageIOCachedBlock;
+
+/*!
+  \brief _nitf_ImageIODecodedBlock - Block decoded ahead of a read
+
+  When blocks are decoded in parallel, each read keeps the blocks it needs
+  in an array of these entries sorted by block number (all bands). The
+  blocks are split, in the order the read uses them, into batches that fit
+  the read cache and only one batch is fetched at a time. The blocks belong
+  to the read until the next batch is fetched or the read completes and are
+  then handed to the block cache.
+*/
+
+typedef struct
+{
+    nitf_Uint32 number;         /*!< Block number, all bands */
+    nitf_Uint32 blockNumber;    /*!< Block number passed to readBlock */
+    nitf_Uint8 *block;          /*!< Decoded block, NULL if not decoded */
+    nitf_Uint32 row;            /*!< First decoded row */
+    nitf_Uint32 column;         /*!< First decoded column */
+    nitf_Uint32 numRows;        /*!< Number of decoded rows */
+    nitf_Uint32 numColumns;     /*!< Number of decoded columns */
+    nitf_Uint32 batch;          /*!< Batch the block is fetched in */
+}
+_nitf_ImageIODecodedBlock;
+
+/*!
+  \brief _nitf_ImageIOBlockCache - Read block cache
+
+  The _nitf_ImageIOBlockCache structure manages the least recently used
+  cache of decoded blocks used by the cached reader.
+
+  The entries form a doubly linked list ordered from most (head) to least
+  (tail) recently used. The lookup array is indexed by block number and
+  is allocated on first use.
+
+  The cache is bounded by maxBytes, each entry is charged the full block
+  size. The cache always holds at least one block so a budget of zero (the
+  default) gives the original single block cache.
+*/
+
+typedef struct
+{
+    size_t maxBytes;                    /*!< Byte budget */
+    size_t usedBytes;                   /*!< Bytes currently cached */
+    _nitf_ImageIOCachedBlock *head;     /*!< Most recently used entry */
+    _nitf_ImageIOCachedBlock *tail;     /*!< Least recently used entry */
+    _nitf_ImageIOCachedBlock **lookup;  /*!< Entries indexed by block number */
+    nitf_Uint64 hits;                   /*!< Requests found in the cache */
+    nitf_Uint64 misses;                 /*!< Requests that required a read */
+}
+_nitf_ImageIOBlockCache;
+
+/*!
+  \brief _nitf_ImageIOReadAhead - Read-ahead state
+
+  The _nitf_ImageIOReadAhead structure holds the read-ahead mode and the
+  thread that fetches the blocks of the expected next read (see
+  nitf_ImageIO_readAheadStart). At most one read-ahead is joined by each
+  read; running is cleared by the thread that joins it.
+*/
+
+typedef struct
+{
+    int mode;                   /*!< One of the NITF_READ_AHEAD_* modes */
+    nitf_Uint32 nextRow;        /*!< Row after the last read */
+    int running;                /*!< A thread is started and not joined */
+    nitf_Thread thread;         /*!< The read-ahead thread */
+}
+_nitf_ImageIOReadAhead;
+
+/*!
+  \brief _nitf_ImageIOReadAheadWork - Blocks fetched by a read-ahead
+
+  The work list belongs to the read-ahead thread, which frees it.
+*/
+
+typedef struct
+{
+    struct _nitf_ImageIO_s *nitf;       /*!< Associated ImageIO object */
+    nitf_IOInterface *io;               /*!< IOInterface of the last read */
+    _nitf_ImageIODecodedBlock *blocks;  /*!< Blocks to fetch */
+    nitf_Uint32 count;                  /*!< Number of blocks */
+}
+_nitf_ImageIOReadAheadWork;
+
+/*!
+  \brief _nitf_ImageIOExtent - One row segment of a coalesced read
+
+  A coalesced read (see nitf_ImageIO_readRequestCoalesced) records an
+  extent for every row segment of the request. The bytes are read later,
+  merged with the extents next to them in the file, and the unformat step
+  runs after that.
+*/
+
+typedef struct
+{
+    nitf_Uint64 fileOffset;     /*!< Offset of the data in the file */
+    nitf_Uint8 *buffer;         /*!< Where the data is read to */
+    size_t count;               /*!< Bytes to read, zero if none */
+    nitf_Uint8 *user;           /*!< Row segment in the user's buffer */
+    size_t pixelCount;          /*!< Pixels to unformat */
+}
+_nitf_ImageIOExtent;
+
+/*!
+  \brief _nitf_ImageIOStagedBlock - Block collecting bands for writeBlock
+
+  In the "P" and "R" blocking modes the bands of a block are interleaved in
+  the file, so nitf_ImageIO_writeBlock collects the bands of each block in
+  one of these and writes the block when the last band arrives. The
+  received flags and the block buffer are allocated with the structure.
+*/
+
+typedef struct
+{
+    nitf_Uint32 bandsLeft;      /*!< Bands not yet received */
+    nitf_Uint8 *received;       /*!< Per band flag, set when received */
+    nitf_Uint8 *block;          /*!< The block in file layout */
+}
+_nitf_ImageIOStagedBlock;
+
 /*!
   \brief _nitf_ImageIO - Object private data structure
 
@@ -487,6 +732,11 @@ _nitf_ImageIOBlockCacheControl;
   interleaved by block) and NBANDS is 2 and NPPBV is 128, then numRowsPerBlock
   is 128 not 256.
 
+A reduced resolution view (see nitf_ImageIO_readLevel) is an object with the
+geometry of a resolution level of its parent. It shares the parent's masks
+and decompression control and decodes blocks with the decompressor's
+readBlockReduced function. The parent owns and destroys its views.
+
 The imageBase and pixelBase offset will differ if there is block or
 pad pixel mask data which (The masks are stored at the from of the image
 data and is part of the image data area.
@@ -501,7 +751,7 @@ The extra entry avoids making the last block a special case. This
 calculation is used to read compressed blocks.
 */
 
-typedef struct
+typedef struct _nitf_ImageIO_s
 {
     nitf_Uint32 numRows;          /*!< Number of rows */
     nitf_Uint32 numColumns;       /*!< Number of columns */
@@ -525,8 +775,8 @@ typedef struct
     nitf_Uint64 dataLength;     /*!< Length of the data including masks */
     /*!< Configuration parameters */
     _nitf_ImageIOParameters parameters;
-    /*!< Block control */
-    _nitf_ImageIOBlockCacheControl blockControl;
+    /*!< Read block cache */
+    _nitf_ImageIOBlockCache blockCache;
     /*!< Compression handler function */
     nitf_CompressionInterface *compressor;
     /*!< Decompression handler function */
@@ -544,12 +794,48 @@ typedef struct
     int oneBand;                /*!< Read/write one band at a time if TRUE */
     /*!< Control structure for current write */
     struct _nitf_ImageIOWriteControl_s *writeControl;
-    /*!< Control structure for current read */
-    struct _nitf_ImageIOReadControl_s *readControl;
+    int blockWriting;           /*!< Set up for nitf_ImageIO_writeBlock */
+    /*!< Partly written blocks ("P" and "R" modes), indexed by block number */
+    _nitf_ImageIOStagedBlock **stagedBlocks;
+    int readCount;              /*!< Number of reads in progress */
+    int revertWaiting;          /*!< Reads waiting to revert optimized modes */
+    nitf_Uint32 decodeThreads;  /*!< Threads used to decode blocks */
+    /*!< Background fetch of the next read's blocks */
+    _nitf_ImageIOReadAhead readAhead;
+    /*!< Protects setup, the read count and the block cache */
+    nitf_Mutex lock;
+    /*!< Serializes I/O that depends on the shared file position */
+    nitf_Mutex ioLock;
     _NITF_IMAGE_IO_PAD_SCAN_FUNC padScanner; /*! Scans for pad pixels in write */
+    nitf_Uint32 discardLevels;  /*!< Resolution levels discarded by a view */
+    /*!< Full resolution object of a reduced resolution view */
+    struct _nitf_ImageIO_s *parent;
+    /*!< Reduced resolution views, indexed by level - 1 */
+    struct _nitf_ImageIO_s **levels;
+    nitf_Uint32 numLevels;      /*!< Number of entries in levels */
 }
 _nitf_ImageIO;
 
+/*!
+  \brief _nitf_ImageIODecodeWork - Shared state for parallel block decode
+
+  The decode threads take the blocks of one batch from the list in order.
+  The first error stops the remaining threads.
+*/
+
+typedef struct
+{
+    _nitf_ImageIO *nitf;                /*!< Associated ImageIO object */
+    _nitf_ImageIODecodedBlock *blocks;  /*!< Blocks to decode */
+    nitf_Uint32 count;                  /*!< Number of blocks */
+    nitf_Uint32 batch;                  /*!< Batch to decode */
+    nitf_Uint32 next;                   /*!< Next block to decode */
+    nitf_Mutex lock;                    /*!< Protects next and the error */
+    int failed;                         /*!< A decode failed if TRUE */
+    nitf_Error error;                   /*!< First decode error */
+}
+_nitf_ImageIODecodeWork;
+
 /*!
   \brief _nitf_ImageIOControl - IO control structure
 
@@ -666,6 +952,21 @@ typedef struct _nitf_ImageIOControl_s
 
     /*! Save buffer for partial down-sample windows */
     nitf_Uint8 *columnSave;
+
+    /*! Number of blocks decoded ahead of the read */
+    nitf_Uint32 nDecoded;
+
+    /*! Blocks decoded ahead of the read, sorted by number */
+    _nitf_ImageIODecodedBlock *decoded;
+
+    /*! Batch of the decoded blocks that is currently fetched */
+    nitf_Uint32 batch;
+
+    /*! Batches are read with nitf_IOInterface_readBatch, not decoded */
+    int batchReads;
+
+    /*! Buffer pointers by band for the block mode P pack and unpack */
+    nitf_Uint8 **bandBuffers;
 }
 _nitf_ImageIOControl;
 
@@ -900,8 +1201,9 @@ _nitf_ImageIOWriteControl;
   Each of these functions configures the read control object for a
   particular writing method, such as sequential reads.
 
-  The ImageIO structure maintains a pointer to the current read control.
-  There can be only one active reader or writer for each ImageIO.
+  Each call to nitf_ImageIO_read has its own read control so several
+  threads may read from one ImageIO at once. The ImageIO structure only
+  counts the reads in progress, a write cannot start while any are active.
 
 This is an internal object and is not used directly by the user.
 
@@ -936,9 +1238,6 @@ typedef struct _nitf_ImageIO_BPixelControl
 
     /*! Size of compressed block in bytes */
     size_t blockSizeCompressed;
-
-    /*! Buffer for compressed block */
-    nitf_Uint8 *buffer;
 }
 nitf_ImageIO_BPixelControl;
 
@@ -970,9 +1269,6 @@ typedef struct _nitf_ImageIO_12PixelControl
 
     /*! Size of compressed block in bytes */
     size_t blockSizeCompressed;
-
-    /*! Buffer for compressed block */
-    nitf_Uint8 *buffer;
 }
 nitf_ImageIO_12PixelControl;
 
@@ -1075,6 +1371,15 @@ NITFPRIV(int) nitf_ImageIO_decodeBlockingMode(_nitf_ImageIO* nitf,
 NITFPRIV(void) nitf_ImageIO_revertOptimizedModes(_nitf_ImageIO *nitfI,
                                                  int numBands);
 
+/*!
+ * Checks if nitf_ImageIO_revertOptimizedModes would change the object
+ * \param nitfI        the ImageIO structure
+ * \param numBands    the number of bands (when reading), or 0 when writing.
+ * \return TRUE if the RGB24 or IQ mode is set and would be reverted
+ */
+NITFPRIV(NITF_BOOL) nitf_ImageIO_revertsOptimizedModes(_nitf_ImageIO *nitfI,
+                                                       int numBands);
+
 
 /*!
   \brief nitf_ImageIO_setIO - Set the reader and writer functions
@@ -1703,6 +2008,74 @@ I/O error
 NITFPRIV(int) nitf_ImageIO_readRequest(_nitf_ImageIOControl * cntl, nitf_IOInterface* io, nitf_Error * error    /*!< Error object */
                                       );
 
+/*!
+  \brief nitf_ImageIO_readRequestCoalesced - Do the read request with
+  merged reads
+
+  nitf_ImageIO_readRequestCoalesced is the version of
+  nitf_ImageIO_readRequest used when the row segments are read straight
+  from the file into the user's buffer (uncompressed data, no unpacking
+  and no block cache). Rather than one seek and read per row segment, the
+  segments are gathered into a list of extents which is handed to
+  nitf_ImageIO_readExtents in batches.
+
+  \b Note:
+
+  This is an internal function and is not intended to be called
+directly by the user.
+
+On error, FALSE is returned and error is set.
+
+Possible errors include:
+
+I/O error
+Memory allocation error
+*/
+
+NITFPRIV(int) nitf_ImageIO_readRequestCoalesced(_nitf_ImageIOControl * cntl,
+                                                nitf_IOInterface* io,
+                                                nitf_Error * error);
+
+/*!
+  \brief nitf_ImageIO_readExtents - Read and unformat a list of extents
+
+  nitf_ImageIO_readExtents sorts the extents by file offset and reads each
+  run of extents that are next to each other in the file (or separated by
+  no more than NITF_IMAGE_IO_COALESCE_GAP bytes) with one vectored read.
+  The bytes in the gaps are read into the scratch buffer and dropped.
+  Memory mapped files are copied extent by extent. The unformat function,
+  if any, is then applied to every extent.
+
+  If the IOInterface reads batches concurrently (see
+  nitf_IOInterface_canReadBatch) the runs are submitted as one batch.
+
+  The order and requests arguments are work space for
+  NITF_IMAGE_IO_MAX_EXTENTS entries and vec for twice that many, scratch
+  holds NITF_IMAGE_IO_COALESCE_GAP bytes.
+
+\return Returns FALSE on error
+*/
+
+NITFPRIV(int) nitf_ImageIO_readExtents(_nitf_ImageIO * nitf,
+                                       nitf_IOInterface* io,
+                                       _nitf_ImageIOExtent * extents,
+                                       size_t count,
+                                       _nitf_ImageIOExtent ** order,
+                                       nitf_IOVec * vec,
+                                       nitf_IORequest * requests,
+                                       nitf_Uint8 * scratch,
+                                       nitf_Error * error);
+
+/*!
+  \brief nitf_ImageIO_compareExtents - Compare extents by file offset
+
+  Comparison function for qsort, the arguments point to extent pointers
+
+  \return Returns the usual negative, zero or positive result
+*/
+
+NITFPRIV(int) nitf_ImageIO_compareExtents(const void *a, const void *b);
+
 /*!
   \brief nitf_ImageIO_readRequestDownSample - Do the read request with
   down-smapling
@@ -1800,6 +2173,117 @@ NITFPRIV(int) nitf_ImageIO_readFromFile(nitf_IOInterface* io, nitf_Uint64 fileOf
                                         nitf_Error * errorBuffer        /*!< Error object */
                                        );
 
+/*!
+  \brief nitf_ImageIO_readAt - Read pixel data at an offset
+
+  nitf_ImageIO_readAt reads data from a file at a specified offset without
+  depending on the file position shared with other readers. If the
+  interface is memory mapped the data is copied straight out of the
+  mapping. If the interface does not support positional reads, the seek
+  and read are serialized with the object's I/O lock.
+
+  This function is used by the reader functions which may run in several
+  threads at once.
+
+\return Returns FALSE on error
+
+On error, the supplied error object is set. Possible errors include:
+
+I/O error
+*/
+
+NITFPRIV(int) nitf_ImageIO_readAt(_nitf_ImageIO * nitf,
+                                  nitf_IOInterface* io,
+                                  nitf_Uint64 fileOffset,
+                                  nitf_Uint8 * buffer,
+                                  size_t count,
+                                  nitf_Error * error);
+
+/*!
+  \brief nitf_ImageIO_readvAt - Read a range of a file into several buffers
+
+  nitf_ImageIO_readvAt is the vectored form of nitf_ImageIO_readAt for
+  interfaces that are not memory mapped. The buffers are filled in turn
+  from one contiguous range starting at fileOffset. If the interface does
+  not support positional reads, the reads are serialized with the
+  object's I/O lock.
+
+\return Returns FALSE on error
+*/
+
+NITFPRIV(int) nitf_ImageIO_readvAt(_nitf_ImageIO * nitf,
+                                   nitf_IOInterface* io,
+                                   nitf_Uint64 fileOffset,
+                                   const nitf_IOVec * vec,
+                                   int count,
+                                   nitf_Error * error);
+
+/*!
+  \brief nitf_ImageIO_writeAt - Write pixel data at an offset
+
+  nitf_ImageIO_writeAt writes data to a file at a specified offset without
+  depending on the file position shared with other writers. If the
+  interface does not support positional writes, the seek and write are
+  serialized with the object's I/O lock.
+
+  This function is used by nitf_ImageIO_writeBlock which may run in several
+  threads at once.
+
+\return Returns FALSE on error
+*/
+
+NITFPRIV(int) nitf_ImageIO_writeAt(_nitf_ImageIO * nitf,
+                                   nitf_IOInterface* io,
+                                   nitf_Uint64 fileOffset,
+                                   const nitf_Uint8 * buffer,
+                                   size_t count,
+                                   nitf_Error * error);
+
+/*!
+  \brief nitf_ImageIO_stagedBlocksFree - Free the partly written blocks
+
+  nitf_ImageIO_stagedBlocksFree frees the blocks that
+  nitf_ImageIO_writeBlock is collecting bands for and the table that holds
+  them. It returns the number of blocks that were freed.
+*/
+
+NITFPRIV(nitf_Uint32) nitf_ImageIO_stagedBlocksFree(_nitf_ImageIO * nitf);
+
+/*!
+  \brief nitf_ImageIO_markPad - Mark a written block that holds pad pixels
+
+  nitf_ImageIO_markPad scans the formatted data of a block written by
+  nitf_ImageIO_writeBlock for the pad value, the way the pad scanner does
+  for sequential writes, and records the block in the pad mask if it is
+  found. The data is numRows rows of numCols pixels each, rowStride pixels
+  apart, and only covers the part of the block inside the image.
+*/
+
+NITFPRIV(void) nitf_ImageIO_markPad(_nitf_ImageIO * nitf,
+                                    nitf_Uint32 maskIdx,
+                                    const nitf_Uint8 * data,
+                                    nitf_Uint32 numRows,
+                                    size_t rowStride,
+                                    size_t numCols);
+
+/*!
+  \brief nitf_ImageIO_initBlocking - Read the masks and open the
+  decompressor
+
+  nitf_ImageIO_initBlocking does the one time set-up required before the
+  first read: reading or creating the block and pad masks, setting the
+  "official" blocking information and creating the decompression control
+  object. Calls after the first return immediately.
+
+  The caller must hold the object's lock.
+
+\return Returns FALSE on error
+*/
+
+NITFPRIV(NITF_BOOL) nitf_ImageIO_initBlocking(_nitf_ImageIO * img,
+                                              nitf_IOInterface* io,
+                                              nitf_Error * error);
+
 /*!
   \brief nitf_ImageIO_writeToFile - Write data to a file
 
@@ -1947,137 +2431,515 @@ int nitf_ImageIO_cachedReader(_nitf_ImageIOBlock * blockIO, nitf_IOInterface* io
                              );
 
 /*!
-  \brief nitf_ImageIO_uncachedWriter - Write pixel data to a file without
-   block caching
+  \brief nitf_ImageIO_cachedBlock - Find or load a block in the read cache
 
-  nitf_ImageIO_uncachedWriter writes pixel data to a file without block
-  caching. This is a "writer" function for the vtbl "writer" field.
+  nitf_ImageIO_cachedBlock returns the cache entry for the block referenced
+  by blockIO, reading or decompressing it if it is not already cached. The
+  entry becomes the most recently used.
 
-  \b Note:
+  The caller must not hold the object's lock, the block is read or decoded
+  without it. The returned entry is in use by the caller, who must release
+  it with nitf_ImageIO_blockCacheRelease when done with the block.
 
-  This is an internal function and is not intended to be called
-  directly by the user.
+  \return Returns NULL on error
+*/
 
-\return Returns FALSE on error
+NITFPRIV(_nitf_ImageIOCachedBlock *)
+nitf_ImageIO_cachedBlock(_nitf_ImageIOBlock * blockIO,
+                         nitf_IOInterface* io,
+                         nitf_Error * error);
 
-On error, FALSE is returned the error object is set.
+/*!
+  \brief nitf_ImageIO_decodeCachedRegion - Decode a rectangle of a block
+  into a cache entry
 
-Possible errors include:
+  The entry's valid rectangle is set to the decoded rectangle. The entry
+  must not be in the cache yet. The caller must not hold the object's lock,
+  the decompressor is only serialized if it is not reentrant.
 
-I/O errors
+  \return FALSE on error, the error object is set
 */
 
-/*!< NITF block structure */
-/*!< I/O handle */
-int nitf_ImageIO_uncachedWriter(_nitf_ImageIOBlock * blockIO, nitf_IOInterface* io, nitf_Error * error    /*!< Error object */
-                               );
+NITFPRIV(NITF_BOOL)
+nitf_ImageIO_decodeCachedRegion(_nitf_ImageIO * nitf,
+                                nitf_IOInterface* io,
+                                _nitf_ImageIOCachedBlock * entry,
+                                nitf_Uint32 blockNumber,
+                                nitf_Uint32 row,
+                                nitf_Uint32 column,
+                                nitf_Uint32 numRows,
+                                nitf_Uint32 numColumns,
+                                nitf_Error * error);
 
 /*!
-  \brief nitf_ImageIO_cachedWriter - Write pixel data to a file with
-   block caching
+  \brief nitf_ImageIO_blockCacheTrim - Evict blocks from the read cache
 
-  nitf_ImageIO_cachedWriter writes pixel data to a file with block
-  caching. This is a "writer" function for the vtbl "writer" field
+  nitf_ImageIO_blockCacheTrim evicts least recently used blocks until
+  "needed" additional bytes fit in the cache budget.
 
-  \b Note:
+  If reuse is not NULL and an evicted block that is not in use has a buffer
+  allocated by the library (not the decompressor), that entry is unlinked
+  but not freed and is returned in reuse so the caller can read the next
+  block into it. At most one entry is returned this way, *reuse is set to
+  NULL if none is available.
 
-  This is an internal function and is not intended to be called directly by
-  the user.
+  \return None
+*/
 
-\return Returns FALSE on error
+NITFPRIV(void) nitf_ImageIO_blockCacheTrim(_nitf_ImageIO * nitf,
+                                           size_t needed,
+                                           _nitf_ImageIOCachedBlock ** reuse);
 
-On error, the error object is set. Possible errors include:
+/*!
+  \brief nitf_ImageIO_blockCacheRemove - Remove an entry from the read cache
 
-I/O errors
+  The entry is unlinked and freed, or marked stale if it is in use. The
+  caller must hold the object's lock.
+
+  \return None
 */
 
-/*!< NITF block structure */
-/*!< I/O handle */
-int nitf_ImageIO_cachedWriter(_nitf_ImageIOBlock * blockIO, nitf_IOInterface* io, nitf_Error * error      /*!< Error object */
-                             );
+NITFPRIV(void) nitf_ImageIO_blockCacheRemove(_nitf_ImageIO * nitf,
+                                             _nitf_ImageIOCachedBlock * entry);
 
 /*!
-  \brief nitf_ImageIO_setDefaultParameters - Set defaults for parameters
+  \brief nitf_ImageIO_blockCacheUnlink - Take an entry out of the read cache
 
-  This function initializes the  _nitf_ImageIOParameters in the nitf_ImageIO
-  object
+  The entry is unlinked but not freed. The caller must hold the object's
+  lock.
 
   \return None
 */
 
-/*!< The object to setup */
-void nitf_ImageIO_setDefaultParameters(_nitf_ImageIO * object);
+NITFPRIV(void) nitf_ImageIO_blockCacheUnlink(_nitf_ImageIO * nitf,
+                                             _nitf_ImageIOCachedBlock * entry);
 
 /*!
-  \brief nitf_ImageIO_unpack_P_* - Unpack functions for block mode P
-
-  The nitf_ImageIO_nitf_ImageIO_unpack_P_* function do the unpacking
-  operation for blocking mode "P" (band interleaved by pixel) reads
-  involving byte swaps only
+  \brief nitf_ImageIO_blockCacheRelease - Release a use of a cache entry
 
-  There are five variants of this function that operate on various lengths
-  of data:
+  Releases the use returned by nitf_ImageIO_cachedBlock and frees the entry
+  if it is stale and this was the last use. The caller must hold the
+  object's lock.
 
-  nitf_ImageIO_unpack_P_1   - Unpack 2 byte data\\n
-nitf_ImageIO_unpack_P_2   - Unpack 4 byte data\\n
-nitf_ImageIO_unpack_P_4   - Unpack 8 byte data\\n
-nitf_ImageIO_unpack_P_8   - Unpack 8 byte, complex data data\\n
-nitf_ImageIO_unpack_P_16  - Unpack 16 byte data\\n
+  \return None
+*/
 
-There is no difference between anytypes when it comes to unpacking.
+NITFPRIV(void) nitf_ImageIO_blockCacheRelease(_nitf_ImageIO * nitf,
+                                              _nitf_ImageIOCachedBlock * entry);
 
-\b Note:
+/*!
+  \brief nitf_ImageIO_decodeLock - Lock that serializes the decompressor
 
-These are internal functions and are not intended to be called
-directly by the user.
+  Decompressors that declare NITF_DECOMPRESSION_CONCURRENT_READ_BLOCK run
+  unlocked when the IOInterface supports positional reads.
 
-\return None
+  \return The lock to hold around decompressor calls, NULL if none
 */
 
-/*!< NITF block structure */
-/*!< Error object */
-void nitf_ImageIO_unpack_P_1(_nitf_ImageIOBlock * blockIO,
-                             nitf_Error * error);
+NITFPRIV(nitf_Mutex *) nitf_ImageIO_decodeLock(_nitf_ImageIO * nitf,
+                                               nitf_IOInterface* io);
 
-/*!< NITF block structure */
-/*!< Error object */
-void nitf_ImageIO_unpack_P_2(_nitf_ImageIOBlock * blockIO,
-                             nitf_Error * error);
+/*!
+  \brief nitf_ImageIO_blockCacheClear - Release all blocks in the read cache
 
-/*!< NITF block structure */
-/*!< Error object */
-void nitf_ImageIO_unpack_P_4(_nitf_ImageIOBlock * blockIO,
-                             nitf_Error * error);
+  The hit and miss counters are not reset
+
+  \return None
+*/
+
+NITFPRIV(void) nitf_ImageIO_blockCacheClear(_nitf_ImageIO * nitf);
+
+/*!
+  \brief nitf_ImageIO_blockCacheAlloc - Allocate the read cache lookup table
+
+  The lookup table is allocated on first use. The caller must hold the
+  object's lock.
+
+  \return Returns FALSE on error
+*/
+
+NITFPRIV(int) nitf_ImageIO_blockCacheAlloc(_nitf_ImageIO * nitf,
+                                           nitf_Error * error);
+
+/*!
+  \brief nitf_ImageIO_blockCacheInsert - Add a block to the read cache
+
+  The entry is made the most recently used and is not in use. The caller
+  must hold the object's lock, have allocated the lookup table and have
+  trimmed the cache to make room.
+
+  \return None
+*/
+
+NITFPRIV(void) nitf_ImageIO_blockCacheInsert(_nitf_ImageIO * nitf,
+                                             _nitf_ImageIOCachedBlock * entry);
+
+/*!
+  \brief nitf_ImageIO_waitForReads - Let the reads in progress run
+
+  nitf_ImageIO_waitForReads releases the object's lock, gives up the
+  processor and takes the lock again. The caller holds the lock and calls
+  this in a loop until the read count it is waiting on drops.
+
+  \return None
+*/
+
+NITFPRIV(void) nitf_ImageIO_waitForReads(_nitf_ImageIO * nitf);
+
+/*!
+  \brief nitf_ImageIO_decodesInto - Test for a decompressor that decodes
+  into library buffers
+
+  The readBlockInto field is only present if the plugin sets the
+  NITF_DECOMPRESSION_READ_BLOCK_INTO flag. Blocks from such a decompressor
+  are allocated by the system memory allocation facility, not the plugin.
+
+  \return TRUE if the decompressor has a readBlockInto function
+*/
+
+NITFPRIV(NITF_BOOL) nitf_ImageIO_decodesInto(_nitf_ImageIO * nitf);
+
+/*!
+  \brief nitf_ImageIO_freeDecoded - Free a block decoded by the
+  decompressor, or read without one
+
+  \return None
+*/
+
+NITFPRIV(void) nitf_ImageIO_freeDecoded(_nitf_ImageIO * nitf,
+                                        nitf_Uint8 * block);
+
+/*!
+  \brief nitf_ImageIO_decodeInto - Decode a block into a library buffer
+
+  The decompressor must decode into library buffers (see
+  nitf_ImageIO_decodesInto). Reduced resolution views decode with the
+  readBlockReduced function at their level.
+
+  \return FALSE on error, the error object is set
+*/
+
+NITFPRIV(NITF_BOOL) nitf_ImageIO_decodeInto(_nitf_ImageIO * nitf,
+                                            nitf_Uint32 blockNumber,
+                                            nitf_Uint8 * buffer,
+                                            nitf_Error * error);
+
+/*!
+  \brief nitf_ImageIO_blockRegion - Get the part of a block a read needs
+
+  nitf_ImageIO_blockRegion returns the rectangle (block relative) of the
+  block that the request described by the control object touches. The
+  rectangle is the whole block unless the decompressor can decode regions
+  (see readBlockRegion in the decompression interface).
+
+  \return None
+*/
+
+NITFPRIV(void) nitf_ImageIO_blockRegion(_nitf_ImageIOControl * cntl,
+                                        nitf_Uint32 blockNumber,
+                                        nitf_Uint32 * row,
+                                        nitf_Uint32 * column,
+                                        nitf_Uint32 * numRows,
+                                        nitf_Uint32 * numColumns);
+
+/*!
+  \brief nitf_ImageIO_decodeRegion - Decode part of a block into a library
+  buffer
+
+  The rectangle is decoded with the readBlockRegion function, a whole
+  block with nitf_ImageIO_decodeInto.
+
+  \return FALSE on error, the error object is set
+*/
+
+NITFPRIV(NITF_BOOL) nitf_ImageIO_decodeRegion(_nitf_ImageIO * nitf,
+                                              nitf_Uint32 blockNumber,
+                                              nitf_Uint32 row,
+                                              nitf_Uint32 column,
+                                              nitf_Uint32 numRows,
+                                              nitf_Uint32 numColumns,
+                                              nitf_Uint8 * buffer,
+                                              nitf_Error * error);
+
+/*!
+  \brief nitf_ImageIO_levelView - Get the reduced resolution view of a level
+
+  The view is created on first use. The caller must hold the object's
+  lock and have initialized its blocking.
+
+  \return The view or NULL on error, the error object is set
+*/
+
+NITFPRIV(_nitf_ImageIO *) nitf_ImageIO_levelView(_nitf_ImageIO * nitf,
+                                                 nitf_Uint32 level,
+                                                 nitf_Error * error);
+
+/*!
+  \brief nitf_ImageIO_findBlocks - List the blocks a read must fetch
+
+  nitf_ImageIO_findBlocks lists the blocks touched by the request described
+  by the control object that are neither pad blocks nor in the read cache,
+  sorted by block number, and counts them as cache misses. If fewer than
+  two are found the list is left NULL and the reader is left to fetch
+  them.
+
+  The blocks are numbered into batches in the order the read uses them
+  (block row, then band, then block column). A batch is half of the read
+  cache budget, so the previous batch stays cached while the next one is
+  fetched, but at least minBatch blocks.
+
+  \return Returns FALSE on error
+*/
+
+NITFPRIV(int) nitf_ImageIO_findBlocks(_nitf_ImageIOControl * cntl,
+                                      nitf_Uint32 minBatch,
+                                      _nitf_ImageIODecodedBlock ** blocksOut,
+                                      nitf_Uint32 * countOut,
+                                      nitf_Error * error);
+
+/*!
+  \brief nitf_ImageIO_decodeBlocks - Decode the blocks of a read in parallel
+
+  nitf_ImageIO_decodeBlocks finds the blocks touched by the request
+  described by the control object that are not in the read cache, saves
+  them in the control object's decoded array and decodes the first batch
+  with the object's decode threads. The cached reader fetches the other
+  batches as it reaches them (see nitf_ImageIO_fetchBatch).
+
+  Nothing is done unless more than one thread is configured, the image is
+  read through the decompression interface, the plugin declares
+  NITF_DECOMPRESSION_CONCURRENT_READ_BLOCK and the IOInterface supports
+  positional reads.
+
+  \return Returns FALSE on error
+*/
+
+NITFPRIV(int) nitf_ImageIO_decodeBlocks(_nitf_ImageIOControl * cntl,
+                                        nitf_IOInterface* io,
+                                        nitf_Error * error);
+
+/*!
+  \brief nitf_ImageIO_readBlocksBatch - Read the blocks of a read as one
+  batch
+
+  nitf_ImageIO_readBlocksBatch is the counterpart of
+  nitf_ImageIO_decodeBlocks for cached reads of uncompressed images. The
+  blocks the request needs that are not in the read cache are saved in the
+  control object's decoded array and the blocks of each batch are
+  submitted to the IOInterface at once (see nitf_IOInterface_readBatch).
+
+  Nothing is done unless the IOInterface reads batches concurrently and is
+  not memory mapped, or if nitf_ImageIO_decodeBlocks already ran.
+
+  \return Returns FALSE on error
+*/
+
+NITFPRIV(int) nitf_ImageIO_readBlocksBatch(_nitf_ImageIOControl * cntl,
+                                           nitf_IOInterface* io,
+                                           nitf_Error * error);
+
+/*!
+  \brief nitf_ImageIO_fetchBatch - Fetch a batch of the blocks of a read
+
+  nitf_ImageIO_fetchBatch hands the blocks of the current batch to the
+  read cache, makes room in the cache for the new batch and decodes it
+  with the object's decode threads or reads it with
+  nitf_IOInterface_readBatch. On error the blocks of the batch are left
+  NULL.
+
+  \return Returns FALSE on error
+*/
+
+NITFPRIV(int) nitf_ImageIO_fetchBatch(_nitf_ImageIOControl * cntl,
+                                      nitf_IOInterface* io,
+                                      nitf_Uint32 batch,
+                                      nitf_Error * error);
+
+/*!
+  \brief nitf_ImageIO_decodeBatch - Decode the current batch in parallel
+
+  \return Returns FALSE on error
+*/
+
+NITFPRIV(int) nitf_ImageIO_decodeBatch(_nitf_ImageIOControl * cntl,
+                                       nitf_Error * error);
+
+/*!
+  \brief nitf_ImageIO_readBlockBatch - Read the current batch at once
+
+  \return Returns FALSE on error
+*/
+
+NITFPRIV(int) nitf_ImageIO_readBlockBatch(_nitf_ImageIOControl * cntl,
+                                          nitf_IOInterface* io,
+                                          nitf_Error * error);
+
+/*!
+  \brief nitf_ImageIO_blockReadDone - Batch completion for
+  nitf_ImageIO_readBlocksBatch
+
+  The request's user field is the block and its buffer the block data.
+
+  \return Returns TRUE
+*/
+
+NITFPRIV(NITF_BOOL) nitf_ImageIO_blockReadDone(void *arg,
+                                               nitf_IORequest * request,
+                                               nitf_Error * error);
+
+/*!
+  \brief nitf_ImageIO_decodeWorker - Block decode thread function
+
+  nitf_ImageIO_decodeWorker decodes the blocks of one batch from a shared
+  work list until the list is exhausted or a decode fails. The argument is a
+  _nitf_ImageIODecodeWork structure.
+
+  \return None
+*/
+
+NITFPRIV(void) nitf_ImageIO_decodeWorker(void *data);
+
+/*!
+  \brief nitf_ImageIO_releaseDecoded - Hand decoded blocks to the cache
+
+  nitf_ImageIO_releaseDecoded moves the blocks decoded ahead of a read
+  into the read cache, freeing any that are already cached. It is called
+  before the next batch is fetched and when the control object is
+  destroyed. The decoded array itself is kept.
+
+  \return None
+*/
+
+NITFPRIV(void) nitf_ImageIO_releaseDecoded(_nitf_ImageIOControl * cntl);
+
+/*!
+  \brief nitf_ImageIO_readAheadStart - Fetch the blocks of the next read
+
+  nitf_ImageIO_readAheadStart is called when a read succeeds. If the
+  read-ahead mode calls for it, it guesses the next read (the same columns
+  and bands, starting on the row after this read), hints the file system
+  that the blocks will be needed and starts a thread that reads or decodes
+  the blocks that are not cached into the read cache.
+
+  Nothing is done unless the IOInterface supports positional reads and,
+  for compressed images, the plugin declares
+  NITF_DECOMPRESSION_CONCURRENT_READ_BLOCK, since the thread runs while
+  the caller may be using the IOInterface or reading.
+
+  \return None
+*/
+
+NITFPRIV(void) nitf_ImageIO_readAheadStart(_nitf_ImageIO * nitf,
+                                           nitf_IOInterface* io,
+                                           nitf_SubWindow * subWindow);
+
+/*!
+  \brief nitf_ImageIO_readAheadJoin - Wait for a read-ahead to finish
+
+  nitf_ImageIO_readAheadJoin waits for the read-ahead thread, if one is
+  running. The caller must not hold the object's lock.
+
+  \return None
+*/
+
+NITFPRIV(void) nitf_ImageIO_readAheadJoin(_nitf_ImageIO * nitf);
+
+/*!
+  \brief nitf_ImageIO_readAheadWorker - Read-ahead thread function
+
+  nitf_ImageIO_readAheadWorker fetches each block of a
+  _nitf_ImageIOReadAheadWork list and adds it to the read cache unless
+  another read cached it first. A block that cannot be fetched is skipped,
+  the read that needs it will report the error.
+
+  \return None
+*/
+
+NITFPRIV(void) nitf_ImageIO_readAheadWorker(void *data);
+
+/*!
+  \brief nitf_ImageIO_compareDecoded - Compare decoded blocks by number
+
+  Comparison function for qsort and bsearch
+
+  \return Returns the usual negative, zero or positive result
+*/
+
+NITFPRIV(int) nitf_ImageIO_compareDecoded(const void *a, const void *b);
+
+/*!
+  \brief nitf_ImageIO_uncachedWriter - Write pixel data to a file without
+   block caching
+
+  nitf_ImageIO_uncachedWriter writes pixel data to a file without block
+  caching. This is a "writer" function for the vtbl "writer" field.
+
+  \b Note:
+
+  This is an internal function and is not intended to be called
+  directly by the user.
+
+\return Returns FALSE on error
+
+On error, FALSE is returned the error object is set.
+
+Possible errors include:
+
+I/O errors
+*/
 
 /*!< NITF block structure */
-/*!< Error object */
-void nitf_ImageIO_unpack_P_8(_nitf_ImageIOBlock * blockIO,
-                             nitf_Error * error);
+/*!< I/O handle */
+int nitf_ImageIO_uncachedWriter(_nitf_ImageIOBlock * blockIO, nitf_IOInterface* io, nitf_Error * error    /*!< Error object */
+                               );
+
+/*!
+  \brief nitf_ImageIO_cachedWriter - Write pixel data to a file with
+   block caching
+
+  nitf_ImageIO_cachedWriter writes pixel data to a file with block
+  caching. This is a "writer" function for the vtbl "writer" field
+
+  \b Note:
+
+  This is an internal function and is not intended to be called directly by
+  the user.
+
+\return Returns FALSE on error
+
+On error, the error object is set. Possible errors include:
+
+I/O errors
+*/
 
 /*!< NITF block structure */
-/*!< Error object */
-void nitf_ImageIO_unpack_P_16(_nitf_ImageIOBlock * blockIO,
-                              nitf_Error * error);
+/*!< I/O handle */
+int nitf_ImageIO_cachedWriter(_nitf_ImageIOBlock * blockIO, nitf_IOInterface* io, nitf_Error * error      /*!< Error object */
+                             );
 
 /*!
-  \brief nitf_ImageIO_pack_P_* - Pack functions for block mode P
+  \brief nitf_ImageIO_setDefaultParameters - Set defaults for parameters
 
-  The nitf_ImageIO_nitf_ImageIO_pack_P_* function do the packing
-  operation for blocking mode "P" (band interleaved by pixel) reads
-  involving byte swaps only
+  This function initializes the  _nitf_ImageIOParameters in the nitf_ImageIO
+  object
 
-  There are five variants of this function that operate on various lengths
-  of data:
+  \return None
+*/
+
+/*!< The object to setup */
+void nitf_ImageIO_setDefaultParameters(_nitf_ImageIO * object);
 
-  nitf_ImageIO_pack_P_1   - Pack 2 byte data\\n
-nitf_ImageIO_pack_P_2   - Pack 4 byte data\\n
-nitf_ImageIO_pack_P_4   - Pack 8 byte data\\n
-nitf_ImageIO_pack_P_8   - Pack 8 byte, complex data data\\n
-nitf_ImageIO_pack_P_16  - Pack 16 byte data\\n
+/*!
+  \brief nitf_ImageIO_unpack_P - Unpack function for block mode P
 
-There is no difference between anytypes when it comes to packing.
+  The nitf_ImageIO_unpack_P function does the unpacking operation for
+  blocking mode "P" (band interleaved by pixel) reads. It is called once
+  per row segment with the block I/O structures of all of the requested
+  bands of a block column and separates every requested band in a single
+  pass over the read buffer. Bands that were not requested are skipped and
+  a band requested more than once is copied from its first occurrence.
 
-\b Note:
+  \b Note:
 
 These are internal functions and are not intended to be called
 directly by the user.
@@ -2085,26 +2947,71 @@ directly by the user.
 \return None
 */
 
-/*!< NITF block structure */
+/*!< NITF block structures, one for each band */
+/*!< Number of block structures */
 /*!< Error object */
-void nitf_ImageIO_pack_P_1(_nitf_ImageIOBlock * blockIO, nitf_Error * error);
+void nitf_ImageIO_unpack_P(_nitf_ImageIOBlock * blocks,
+                           nitf_Uint32 numBlocks,
+                           nitf_Error * error);
 
-/*!< NITF block structure */
-/*!< Error object */
-void nitf_ImageIO_pack_P_2(_nitf_ImageIOBlock * blockIO, nitf_Error * error);
+/*!
+  \brief nitf_ImageIO_pack_P - Pack function for block mode P
 
-/*!< NITF block structure */
-/*!< Error object */
-void nitf_ImageIO_pack_P_4(_nitf_ImageIOBlock * blockIO, nitf_Error * error);
+  The nitf_ImageIO_pack_P function does the packing operation for blocking
+  mode "P" (band interleaved by pixel) writes. Like nitf_ImageIO_unpack_P,
+  it is called once per row segment and interleaves all bands of a block
+  column into the write buffer at once.
 
-/*!< NITF block structure */
-/*!< Error object */
-void nitf_ImageIO_pack_P_8(_nitf_ImageIOBlock * blockIO, nitf_Error * error);
+\b Note:
 
-/*!< NITF block structure */
+These are internal functions and are not intended to be called
+directly by the user.
+
+\return None
+*/
+
+/*!< NITF block structures, one for each band */
+/*!< Number of block structures */
 /*!< Error object */
-void nitf_ImageIO_pack_P_16(_nitf_ImageIOBlock * blockIO,
-                            nitf_Error * error);
+void nitf_ImageIO_pack_P(_nitf_ImageIOBlock * blocks,
+                         nitf_Uint32 numBlocks,
+                         nitf_Error * error);
+
+/*!
+  \brief nitf_ImageIO_deinterleave - Separate band interleaved pixels
+
+  nitf_ImageIO_deinterleave copies count pixels of each band from a band
+  interleaved by pixel buffer to a separate buffer per band. Band counts of
+  2, 4 and 8 use SSE2 shuffles and 3 bands uses byte shuffles when the CPU
+  supports AVX2. Other band counts and pixel sizes and the pixels left over
+  after the last full vector are done a pixel at a time.
+
+  \return None
+*/
+NITFPRIV(void) nitf_ImageIO_deinterleave
+(const nitf_Uint8 * src,     /*!< Interleaved pixels */
+ nitf_Uint8 ** dst,          /*!< Output by band, NULL to skip a band */
+ nitf_Uint32 numBands,       /*!< Number of interleaved bands */
+ nitf_Uint32 bytes,          /*!< Pixel size in bytes */
+ size_t count                /*!< Pixels per band */
+);
+
+/*!
+  \brief nitf_ImageIO_interleave - Interleave separate band buffers
+
+  nitf_ImageIO_interleave is the inverse of nitf_ImageIO_deinterleave. A
+  band with a NULL source is left unchanged in the output buffer, which
+  disables the vector kernels.
+
+  \return None
+*/
+NITFPRIV(void) nitf_ImageIO_interleave
+(nitf_Uint8 ** src,          /*!< Input by band, NULL to skip a band */
+ nitf_Uint8 * dst,           /*!< Interleaved pixels */
+ nitf_Uint32 numBands,       /*!< Number of interleaved bands */
+ nitf_Uint32 bytes,          /*!< Pixel size in bytes */
+ size_t count                /*!< Pixels per band */
+);
 
 /*!
   \brief nitf_ImageIO_unformatExtend - Do pixel unformats involving sign
@@ -2604,7 +3511,25 @@ void nitf_ImageIO_formatMaskSwap_8(nitf_Uint8 * buffer, size_t count, nitf_Uint3
                                   );
 
 /*!
-  \brief nitf_ImageIO_print - Do a formatted print of
+  \brief nitf_ImageIO_vectorKernel - Select the vector version of an
+  unformat or format function
+
+  nitf_ImageIO_vectorKernel returns the fastest implementation of the given
+  unformat or format function that the CPU supports. The byte swapping
+  functions have SSE2 and AVX2 versions that do the swap and any shift,
+  sign extension or masking in one pass. Functions without a vector version,
+  and all functions on other architectures, are returned unchanged.
+
+  The vector versions produce exactly the same results as the scalar ones.
+
+  \return The function to use
+*/
+
+NITFPRIV(_NITF_IMAGE_IO_UNFORMAT_FUNC) nitf_ImageIO_vectorKernel
+(_NITF_IMAGE_IO_UNFORMAT_FUNC func);
+
+/*!
+  \brief nitf_ImageIO_print - Do a formatted print of
   a _nitf_ImageIO structure
 
   nitf_ImageIO_print does a formatted print of a _nitf_ImageIO structure.
@@ -2760,6 +3685,20 @@ NITFPRIV(void) nitf_ImageIO_bPixelClose(nitf_DecompressionControl **
 NITFPRIV(nitf_Uint8 *) nitf_ImageIO_bPixelReadBlock(nitf_DecompressionControl * control, nitf_Uint32 blockNumber, nitf_Error * error    /*!< For error returns */
                                                    );
 
+/*!
+  \brief nitf_ImageIO_bPixelReadBlockInto - Read block into function for B
+  pixel type psuedo-decompression interface.
+
+  \returns TRUE on success. On error, the error object is set
+*/
+
+/*!< Associated control structure */
+/*!< Block number to read */
+/*!< Buffer to decode into */
+/*!< Size of the buffer */
+NITFPRIV(NITF_BOOL) nitf_ImageIO_bPixelReadBlockInto(nitf_DecompressionControl * control, nitf_Uint32 blockNumber, nitf_Uint8 * block, size_t size, nitf_Error * error    /*!< For error returns */
+                                                    );
+
 /*!
   \brief nitf_ImageIO_bPixelInterface - Decompression interface for B pixel
   type psuedo-decompression interface.
@@ -2771,7 +3710,10 @@ static nitf_DecompressionInterface nitf_ImageIO_bPixelInterface =
         nitf_ImageIO_bPixelReadBlock,
         nitf_ImageIO_bPixelFreeBlock,
         nitf_ImageIO_bPixelClose,
-        NULL
+        NULL,
+        NITF_DECOMPRESSION_CONCURRENT_READ_BLOCK
+            | NITF_DECOMPRESSION_READ_BLOCK_INTO,
+        nitf_ImageIO_bPixelReadBlockInto
     };
 
 /*!
@@ -2829,6 +3771,20 @@ NITFPRIV(nitf_Uint8 *) nitf_ImageIO_12PixelReadBlock(
   nitf_Uint32 blockNumber, /*!< Block number to read */
   nitf_Error * error);    /*!< For error returns */
 
+/*!
+  \brief nitf_ImageIO_12PixelReadBlockInto - Read block into function for
+  12-bit pixel type psuedo-decompression interface.
+
+  \returns TRUE on success. On error, the error object is set
+*/
+
+NITFPRIV(NITF_BOOL) nitf_ImageIO_12PixelReadBlockInto(
+  nitf_DecompressionControl * control, /*!< Associated control structure */
+  nitf_Uint32 blockNumber, /*!< Block number to read */
+  nitf_Uint8 * block,      /*!< Buffer to decode into */
+  size_t size,             /*!< Size of the buffer */
+  nitf_Error * error);    /*!< For error returns */
+
 /*!
   \brief nitf_ImageIO_12PixelInterface - Decompression interface for 12-bit
   pixel type psuedo-decompression interface. (NBPP == ABPP)
@@ -2840,7 +3796,10 @@ static nitf_DecompressionInterface nitf_ImageIO_12PixelInterface =
         nitf_ImageIO_12PixelReadBlock,
         nitf_ImageIO_12PixelFreeBlock,
         nitf_ImageIO_12PixelClose,
-        NULL
+        NULL,
+        NITF_DECOMPRESSION_CONCURRENT_READ_BLOCK
+            | NITF_DECOMPRESSION_READ_BLOCK_INTO,
+        nitf_ImageIO_12PixelReadBlockInto
     };
 
 /*!
@@ -2996,10 +3955,16 @@ NITFPROT(nitf_ImageIO *) nitf_ImageIO_construct(nitf_ImageSubheader *
     nitf->decompressor = decompressor;
     nitf->compressionControl = NULL;
     nitf->decompressionControl = NULL;
-    nitf->blockControl.number = NITF_IMAGE_IO_NO_BLOCK;
-    nitf->blockControl.freeFlag = 1;
-    nitf->blockControl.block = NULL;
+    memset(&(nitf->blockCache), 0, sizeof(_nitf_ImageIOBlockCache));
     nitf->cachedWriteFlag = 0;
+    nitf->readCount = 0;
+    nitf->revertWaiting = 0;
+    nitf->decodeThreads = 1;
+    nitf->readAhead.mode = NITF_READ_AHEAD_OFF;
+    nitf->readAhead.nextRow = NITF_IMAGE_IO_NO_OFFSET;
+    nitf->readAhead.running = 0;
+    nitf_Mutex_init(&(nitf->lock));
+    nitf_Mutex_init(&(nitf->ioLock));
 
     nitf_ImageIO_setDefaultParameters(nitf);
 
@@ -3107,52 +4072,169 @@ NITFPROT(nitf_ImageIO *) nitf_ImageIO_clone(nitf_ImageIO * image,
 
     clone->blockInfoFlag = 0;
 
-    memset(&(clone->blockControl), 0,
-           sizeof(_nitf_ImageIOBlockCacheControl));
+    /* Keep the cache budget but not the blocks or statistics */
+    memset(&(clone->blockCache), 0, sizeof(_nitf_ImageIOBlockCache));
+    clone->blockCache.maxBytes =
+        ((_nitf_ImageIO *) image)->blockCache.maxBytes;
 
     clone->decompressionControl = NULL;
+    clone->readCount = 0;
+    clone->revertWaiting = 0;
+    clone->readAhead.nextRow = NITF_IMAGE_IO_NO_OFFSET;
+    clone->readAhead.running = 0;
+    nitf_Mutex_init(&(clone->lock));
+    nitf_Mutex_init(&(clone->ioLock));
 
     memset(&(clone->maskHeader), 0, sizeof(_nitf_ImageIO_MaskHeader));
     clone->blockMask = NULL;
     clone->padMask = NULL;
+    clone->levels = NULL;
+    clone->numLevels = 0;
 
     return (nitf_ImageIO *) clone;
 }
 
+NITFPRIV(_nitf_ImageIO *) nitf_ImageIO_levelView(_nitf_ImageIO * nitf,
+                                                 nitf_Uint32 level,
+                                                 nitf_Error * error)
+{
+    _nitf_ImageIO *view;        /* The result */
+    _nitf_ImageIO **levels;     /* Resized view table */
+    nitf_Uint32 factor;         /* Size reduction factor */
+    nitf_DecompressionInterface *iface; /* Decompression interface */
+
+    if ((nitf->levels != NULL) && (level <= nitf->numLevels)
+            && (nitf->levels[level - 1] != NULL))
+        return nitf->levels[level - 1];
+
+    iface = nitf->decompressor;
+    if ((iface == NULL) || (nitf->compression & NITF_IMAGE_IO_NO_COMPRESSION)
+            || !(iface->flags & NITF_DECOMPRESSION_READ_BLOCK_INTO)
+            || !(iface->flags & NITF_DECOMPRESSION_READ_BLOCK_REDUCED)
+            || (iface->readBlockReduced == NULL))
+    {
+        nitf_Error_initf(error, NITF_CTXT, NITF_ERR_DECOMPRESSION,
+                         "Compression type does not support reduced "
+                         "resolution reads");
+        return NULL;
+    }
+
+    /* The blocks of every level must have the same size */
+
+    factor = ((nitf_Uint32) 1) << level;
+    if ((level >= 32) || (nitf->numRowsPerBlock % factor != 0)
+            || (nitf->numColumnsPerBlock % factor != 0))
+    {
+        nitf_Error_initf(error, NITF_CTXT, NITF_ERR_INVALID_PARAMETER,
+                         "Resolution level %d does not evenly divide the "
+                         "%d x %d blocks", level, nitf->numRowsPerBlock,
+                         nitf->numColumnsPerBlock);
+        return NULL;
+    }
+
+    if (level > nitf->numLevels)
+    {
+        levels = (_nitf_ImageIO **)
+            NITF_MALLOC(level * sizeof(_nitf_ImageIO *));
+        if (levels == NULL)
+        {
+            nitf_Error_initf(error, NITF_CTXT, NITF_ERR_MEMORY,
+                             "Error allocating object: %s",
+                             NITF_STRERROR(NITF_ERRNO));
+            return NULL;
+        }
+        memset(levels, 0, level * sizeof(_nitf_ImageIO *));
+        if (nitf->levels != NULL)
+        {
+            memcpy(levels, nitf->levels,
+                   nitf->numLevels * sizeof(_nitf_ImageIO *));
+            NITF_FREE(nitf->levels);
+        }
+        nitf->levels = levels;
+        nitf->numLevels = level;
+    }
+
+    view = (_nitf_ImageIO *) nitf_ImageIO_clone((nitf_ImageIO *) nitf, error);
+    if (view == NULL)
+        return NULL;
+
+    view->parent = nitf;
+    view->discardLevels = level;
+    view->compressor = NULL;
+    view->compressionControl = NULL;
+    view->writeControl = NULL;
+    view->decompressionControl = nitf->decompressionControl;
+    view->maskHeader = nitf->maskHeader;
+    view->blockMask = nitf->blockMask;
+    view->padMask = nitf->padMask;
+
+    /* A level of a W x H image is ceil(W / 2^level) x ceil(H / 2^level) */
+
+    view->numRows = (nitf->numRows + factor - 1) / factor;
+    view->numColumns = (nitf->numColumns + factor - 1) / factor;
+    view->numRowsPerBlock = nitf->numRowsPerBlock / factor;
+    view->numColumnsPerBlock = nitf->numColumnsPerBlock / factor;
+    view->numRowsActual = view->numRowsPerBlock * view->nBlocksPerColumn;
+    view->numColumnsActual = view->numColumnsPerBlock * view->nBlocksPerRow;
+    view->blockSize = (nitf->blockSize / factor) / factor;
+
+    view->blockInfo = nitf->blockInfo;
+    view->blockInfo.numRowsPerBlock = view->numRowsPerBlock;
+    view->blockInfo.numColsPerBlock = view->numColumnsPerBlock;
+    view->blockInfo.length = view->blockSize;
+    view->blockInfoFlag = 1;
+
+    nitf->levels[level - 1] = view;
+    return view;
+}
+
+
 NITFPROT(void) nitf_ImageIO_destruct(nitf_ImageIO ** nitf)
 {
     _nitf_ImageIO *nitfp;       /* Pointer to internal type */
-    nitf_Error error;           /* For decompressor free block call */
 
     if (*nitf == NULL)
         return;
 
     nitfp = *((_nitf_ImageIO **) nitf);
 
-    if (nitfp->blockMask != NULL)
-        NITF_FREE(nitfp->blockMask);
+    /* The read-ahead thread uses the cache and the decompressor */
+    nitf_ImageIO_readAheadJoin(nitfp);
 
-    if (nitfp->padMask != NULL)
-        NITF_FREE(nitfp->padMask);
+    /* Views share the masks and decompression control of their parent */
 
-    if (nitfp->blockControl.block != NULL)
+    if (nitfp->levels != NULL)
     {
-        /* No plugin */
-        if (nitfp->decompressor == NULL)
-            NITF_FREE(nitfp->blockControl.block);
-        else
-            (*(nitfp->decompressor->freeBlock)) (nitfp->
-                                                 decompressionControl,
-                                                 nitfp->blockControl.block,
-                                                 &error);
+        nitf_Uint32 i;
+
+        for (i = 0; i < nitfp->numLevels; i++)
+            if (nitfp->levels[i] != NULL)
+                nitf_ImageIO_destruct((nitf_ImageIO **) &(nitfp->levels[i]));
+        NITF_FREE(nitfp->levels);
     }
 
-    if (nitfp->decompressionControl != NULL)
-        (*(nitfp->decompressor->destroyControl))(&(nitfp->decompressionControl));
+    nitf_ImageIO_blockCacheClear(nitfp);
+    nitf_ImageIO_stagedBlocksFree(nitfp);
+
+    if (nitfp->parent == NULL)
+    {
+        if (nitfp->blockMask != NULL)
+            NITF_FREE(nitfp->blockMask);
+
+        if (nitfp->padMask != NULL)
+            NITF_FREE(nitfp->padMask);
+
+        if (nitfp->decompressionControl != NULL)
+            (*(nitfp->decompressor->destroyControl))
+                (&(nitfp->decompressionControl));
+    }
 
     if (nitfp->compressionControl != NULL)
         (*(nitfp->compressor->destroyControl))(&(nitfp->compressionControl));
 
+    nitf_Mutex_delete(&(nitfp->lock));
+    nitf_Mutex_delete(&(nitfp->ioLock));
+
     NITF_FREE(nitfp);
     *nitf = NULL;
     return;
@@ -3169,7 +4251,6 @@ NITFPROT(NITF_BOOL) nitf_ImageIO_read(nitf_ImageIO * nitf,
 {
     _nitf_ImageIO *nitfI;       /* Internal version of nitf */
     int all;                    /* Full image read flag */
-    nitf_BlockingInfo *blockInfo; /* For get blocking info call */
     NITF_BOOL oneRead;          /* Complete request in one read flag */
     int oneBand;                /* One band flag */
     _nitf_ImageIOControl *cntl; /* IO control structure */
@@ -3182,15 +4263,44 @@ NITFPROT(NITF_BOOL) nitf_ImageIO_read(nitf_ImageIO * nitf,
     ret = 1;                    /* To avoid warning */
     nitfI = (_nitf_ImageIO *) nitf;
 
-    if ((nitfI->writeControl != NULL) || (nitfI->readControl != NULL))
+    /* The blocks read ahead for this read are needed now */
+    nitf_ImageIO_readAheadJoin(nitfI);
+
+    /*
+     * Set-up that changes the object is done under the lock. Once the
+     * read is counted, everything it uses is either read-only or
+     * belongs to this call's control objects
+     */
+
+    nitf_Mutex_lock(&(nitfI->lock));
+    if (nitfI->writeControl != NULL)
     {
+        nitf_Mutex_unlock(&(nitfI->lock));
         nitf_Error_initf(error, NITF_CTXT, NITF_ERR_MEMORY,
                          "I/O operation in progress");
         return NITF_FAILURE;
     }
 
-    /* *possibly* revert the optimized modes */
-    nitf_ImageIO_revertOptimizedModes(nitfI, subWindow->numBands);
+    /*
+     * *possibly* revert the optimized modes. The reads in progress use the
+     * object's mode, so a read that needs the other mode waits for them to
+     * finish, and reads that arrive meanwhile wait for it
+     */
+    if (nitf_ImageIO_revertsOptimizedModes(nitfI, subWindow->numBands))
+    {
+        nitfI->revertWaiting += 1;
+        while (nitfI->readCount != 0)
+            nitf_ImageIO_waitForReads(nitfI);
+        nitfI->revertWaiting -= 1;
+
+        /* Another waiting read may have reverted already */
+        nitf_ImageIO_revertOptimizedModes(nitfI, subWindow->numBands);
+    }
+    else
+    {
+        while (nitfI->revertWaiting != 0)
+            nitf_ImageIO_waitForReads(nitfI);
+    }
 
     /*  Create I/O control */
 
@@ -3199,15 +4309,20 @@ NITFPROT(NITF_BOOL) nitf_ImageIO_read(nitf_ImageIO * nitf,
      *  check requires the block size
      */
 
-    blockInfo = nitf_ImageIO_getBlockingInfo(nitf, io, error);
-    if (blockInfo == NULL)
+    if (!nitf_ImageIO_initBlocking(nitfI, io, error))
+    {
+        nitf_Mutex_unlock(&(nitfI->lock));
         return NITF_FAILURE;
+    }
 
-    /* Not needed */
-    nitf_BlockingInfo_destruct(&blockInfo);
+    nitfI->readCount += 1;
+    nitf_Mutex_unlock(&(nitfI->lock));
 
     if (!nitf_ImageIO_checkSubWindow(nitfI, subWindow, &all, error))
-        return 0;
+    {
+        ret = 0;
+        goto DONE;
+    }
 
     /*
      *   Look for single read cases (down-sampling never does a single read ori
@@ -3241,16 +4356,29 @@ NITFPROT(NITF_BOOL) nitf_ImageIO_read(nitf_ImageIO * nitf,
                                                  &tmpSub, 1 /* Reading */ ,
                                                  error);
             if (cntl == NULL)
-                return 0;
+            {
+                ret = 0;
+                goto DONE;
+            }
 
             readCntl =
                 nitf_ImageIOReadControl_construct(cntl, subWindow, error);
             if (readCntl == NULL)
             {
                 nitf_ImageIOControl_destruct(&cntl);
-                return 0;
+                ret = 0;
+                goto DONE;
+            }
+
+            if (!nitf_ImageIO_decodeBlocks(cntl, io, error)
+                || !nitf_ImageIO_readBlocksBatch(cntl, io, error))
+            {
+                nitf_ImageIOControl_destruct(&cntl);
+                nitf_ImageIOReadControl_destruct(&readCntl);
+                ret = 0;
+                goto DONE;
             }
-            nitfI->readControl = readCntl;
+
             if (oneRead)
                 ret = nitf_ImageIO_oneRead(cntl, io, error);
             else
@@ -3264,7 +4392,7 @@ NITFPROT(NITF_BOOL) nitf_ImageIO_read(nitf_ImageIO * nitf,
             }
 
             nitf_ImageIOControl_destruct(&cntl);
-            nitf_ImageIOReadControl_destruct(&(nitfI->readControl));
+            nitf_ImageIOReadControl_destruct(&readCntl);
         }
     }
     else
@@ -3274,16 +4402,28 @@ NITFPROT(NITF_BOOL) nitf_ImageIO_read(nitf_ImageIO * nitf,
                                              subWindow, 1 /* Reading */ ,
                                              error);
         if (cntl == NULL)
-            return 0;
+        {
+            ret = 0;
+            goto DONE;
+        }
 
         readCntl =
             nitf_ImageIOReadControl_construct(cntl, subWindow, error);
         if (readCntl == NULL)
         {
             nitf_ImageIOControl_destruct(&cntl);
-            return 0;
+            ret = 0;
+            goto DONE;
+        }
+
+        if (!nitf_ImageIO_decodeBlocks(cntl, io, error)
+            || !nitf_ImageIO_readBlocksBatch(cntl, io, error))
+        {
+            nitf_ImageIOControl_destruct(&cntl);
+            nitf_ImageIOReadControl_destruct(&readCntl);
+            ret = 0;
+            goto DONE;
         }
-        nitfI->readControl = readCntl;
 
         if (cntl->downSampling)
             ret =
@@ -3294,13 +4434,54 @@ NITFPROT(NITF_BOOL) nitf_ImageIO_read(nitf_ImageIO * nitf,
 
         *padded = cntl->padded;
         nitf_ImageIOControl_destruct(&cntl);
-        nitf_ImageIOReadControl_destruct(&(nitfI->readControl));
+        nitf_ImageIOReadControl_destruct(&readCntl);
     }
 
+DONE:
+    nitf_Mutex_lock(&(nitfI->lock));
+    nitfI->readCount -= 1;
+    nitf_Mutex_unlock(&(nitfI->lock));
+
+    if (ret)
+        nitf_ImageIO_readAheadStart(nitfI, io, subWindow);
+
     return ret;
 }
 
 
+NITFPROT(NITF_BOOL) nitf_ImageIO_readLevel(nitf_ImageIO * nitf,
+                                           nitf_IOInterface* io,
+                                           nitf_Uint32 level,
+                                           nitf_SubWindow * subWindow,
+                                           nitf_Uint8 ** user,
+                                           int *padded, nitf_Error * error)
+{
+    _nitf_ImageIO *nitfI;       /* Internal version of nitf */
+    _nitf_ImageIO *view;        /* View of the requested level */
+
+    if (level == 0)
+        return nitf_ImageIO_read(nitf, io, subWindow, user, padded, error);
+
+    nitfI = (_nitf_ImageIO *) nitf;
+
+    /* The view shares the masks and decompression control, set them up */
+
+    nitf_Mutex_lock(&(nitfI->lock));
+    if (!nitf_ImageIO_initBlocking(nitfI, io, error))
+    {
+        nitf_Mutex_unlock(&(nitfI->lock));
+        return NITF_FAILURE;
+    }
+    view = nitf_ImageIO_levelView(nitfI, level, error);
+    nitf_Mutex_unlock(&(nitfI->lock));
+    if (view == NULL)
+        return NITF_FAILURE;
+
+    return nitf_ImageIO_read((nitf_ImageIO *) view, io, subWindow, user,
+                             padded, error);
+}
+
+
 NITFPROT(NITF_BOOL) nitf_ImageIO_writeDone(nitf_ImageIO * object,
                                            nitf_IOInterface* io,
                                            nitf_Error * error)
@@ -3392,7 +4573,8 @@ NITFPROT(NITF_BOOL) nitf_ImageIO_writeSequential(nitf_ImageIO * nitf,
 
     /*      Check for I/O in progress */
 
-    if ((nitfI->writeControl != NULL) || (nitfI->readControl != NULL))
+    if ((nitfI->writeControl != NULL) || (nitfI->readCount != 0)
+        || nitfI->blockWriting)
     {
         nitf_Error_initf(error, NITF_CTXT, NITF_ERR_MEMORY,
                          "I/O operation in progress");
@@ -3449,6 +4631,8 @@ NITFPROT(NITF_BOOL) nitf_ImageIO_writeRows(nitf_ImageIO * object,
     nitf_Uint32 numBands;         /* Number of bands */
     nitf_Uint32 col;            /* Block column index */
     nitf_Uint32 row;            /* Current row in sub-window */
+    nitf_Uint32 rowStart;       /* First row of the current block row */
+    nitf_Uint32 rowEnd;         /* Row after the current block row */
     nitf_Uint32 band;           /* Current band in sub-window */
     _nitf_ImageIOBlock *blockIO; /* The current  block IO structure */
 
@@ -3496,19 +4680,34 @@ NITFPROT(NITF_BOOL) nitf_ImageIO_writeRows(nitf_ImageIO * object,
         blockIO += 1;
     }
 
-    /*      Main write loop */
+    /*
+     *  Main write loop. The rows are done a block row at a time so blocks
+     *  are completed in file order, which compressors require
+     */
     blockIO = &(ioCntl->blockIO[0][0]);
     blockIO->currentRow = cntl->nextRow;
-    for (col = 0; col < nBlockCols; col++)
+    for (rowStart = 0; rowStart < numRows; rowStart = rowEnd)
     {
-        for (row = 0; row < numRows; row++)
+      rowEnd = rowStart + nitf->numRowsPerBlock
+               - (cntl->nextRow + rowStart) % nitf->numRowsPerBlock;
+      if (rowEnd > numRows)
+          rowEnd = numRows;
+
+      for (col = 0; col < nBlockCols; col++)
+      {
+        for (row = rowStart; row < rowEnd; row++)
         {
             for (band = 0; band < numBands; band++)
             {
                 blockIO = &(ioCntl->blockIO[col][band]);
 
+                /* One pack does all of the bands of the row segment */
                 if (nitf->vtbl.pack != NULL)
-                    (*(nitf->vtbl.pack)) (blockIO, error);
+                {
+                    if (band == 0)
+                        (*(nitf->vtbl.pack)) (ioCntl->blockIO[col],
+                                              numBands, error);
+                }
                 else
                     memcpy(blockIO->rwBuffer.buffer,blockIO->user.buffer
                           + blockIO->user.offset.mark,blockIO->readCount);
@@ -3534,7 +4733,7 @@ NITFPROT(NITF_BOOL) nitf_ImageIO_writeRows(nitf_ImageIO * object,
                  * setting-up for
                  * the non-existant next block.
                  */
-                if (row != nitf->numRows - 1)
+                if (cntl->nextRow + row != nitf->numRows - 1)
                     nitf_ImageIO_nextRow(blockIO, 0);
 
                 if (blockIO->rowsUntil == 0)
@@ -3543,6 +4742,7 @@ NITFPROT(NITF_BOOL) nitf_ImageIO_writeRows(nitf_ImageIO * object,
                     blockIO->rowsUntil -= 1;
             }
         }
+      }
     }
 
     cntl->nextRow += numRows;
@@ -3550,118 +4750,554 @@ NITFPROT(NITF_BOOL) nitf_ImageIO_writeRows(nitf_ImageIO * object,
 }
 
 
-NITFPROT(NITF_BOOL) nitf_ImageIO_setPadPixel(nitf_ImageIO * object,
-                                             nitf_Uint8 * value,
-                                             nitf_Uint32 length,
-                                             nitf_Error* error)
+/*========================= nitf_ImageIO_writeBlocksBegin ====================*/
+
+NITFPROT(NITF_BOOL) nitf_ImageIO_writeBlocksBegin(nitf_ImageIO * nitf,
+                                                  nitf_IOInterface* io,
+                                                  nitf_Error * error)
 {
-    
-    _nitf_ImageIO* nio = (_nitf_ImageIO*)object;
+    _nitf_ImageIO *nitfI;       /* Internal version of nitf */
+    nitf_Uint64 dataEnd;        /* File offset after the image data */
+    nitf_Uint8 zero;            /* Written to extend the file */
 
-    if (length > NITF_IMAGE_IO_PAD_MAX_LENGTH)
-        length = NITF_IMAGE_IO_PAD_MAX_LENGTH;
+    nitfI = (_nitf_ImageIO *) nitf;
 
-    memmove(nio->pixel.pad, value, length);
-    
-    /*  The pad value is stored big endian */
+    /* Writes of single bands of blocks use the normal blocking modes */
+    nitf_ImageIO_revertOptimizedModes(nitfI, 0);
 
-    switch (length)
-    {
-    case 2:
+    if ((nitfI->writeControl != NULL) || (nitfI->readCount != 0)
+        || nitfI->blockWriting)
     {
-        nitf_Uint16* int16 = 
-            (nitf_Uint16*)&(nio->pixel.pad);
-        *int16 = NITF_HTONS(*int16);
-        break;
-
+        nitf_Error_initf(error, NITF_CTXT, NITF_ERR_MEMORY,
+                         "I/O operation in progress");
+        return NITF_FAILURE;
     }
-    case 4:
-    {
-        nitf_Uint32* int32 = 
-            (nitf_Uint32*)&(nio->pixel.pad);
-        *int32 = NITF_HTONL(*int32);
-        break;
+
+    /*
+     * Each block needs a fixed size to have a fixed offset, which rules out
+     * compression and the packed pixel types
+     */
+    if ((nitfI->compressor != NULL)
+        || !(nitfI->compression & (NITF_IMAGE_IO_NO_COMPRESSION
+                                   | NITF_IMAGE_IO_COMPRESSION_NM))
+        || (nitfI->pixel.type == NITF_IMAGE_IO_PIXEL_TYPE_B)
+        || (nitfI->pixel.type == NITF_IMAGE_IO_PIXEL_TYPE_12))
+    {
+        nitf_Error_initf(error, NITF_CTXT, NITF_ERR_INVALID_PARAMETER,
+                         "Block writes require uncompressed pixels of "
+                         "whole bytes");
+        return NITF_FAILURE;
     }
-    case 8:
+
+    if ((nitfI->blockMask == NULL)
+        && !nitf_ImageIO_mkMasks(nitf, io, 0, error))
+        return NITF_FAILURE;
+
+    /* Every block is present, so the masks are complete before any data */
+    if (!nitf_ImageIO_writeMasks(nitfI, io, error))
+        return NITF_FAILURE;
+
+    if ((nitfI->blockingMode == NITF_IMAGE_IO_BLOCKING_MODE_P
+         || nitfI->blockingMode == NITF_IMAGE_IO_BLOCKING_MODE_R)
+        && (nitfI->numBands > 1))
     {
-        nitf_Uint64* int64 =
-            (nitf_Uint64*)&(nio->pixel.pad);
-        
-        if (nio->pixel.type == NITF_IMAGE_IO_PIXEL_TYPE_C)
-        {
-            *int64 = NITF_HTONLC(*int64);
-            
-        }
-        else
+        nitfI->stagedBlocks = (_nitf_ImageIOStagedBlock **)
+            NITF_MALLOC(nitfI->nBlocksTotal
+                        * sizeof(_nitf_ImageIOStagedBlock *));
+        if (nitfI->stagedBlocks == NULL)
         {
-            *int64 = NITF_HTONLL(*int64);
+            nitf_Error_initf(error, NITF_CTXT, NITF_ERR_MEMORY,
+                             "Error allocating block table: %s",
+                             NITF_STRERROR(NITF_ERRNO));
+            return NITF_FAILURE;
         }
-        break;
+        memset(nitfI->stagedBlocks, 0,
+               nitfI->nBlocksTotal * sizeof(_nitf_ImageIOStagedBlock *));
     }
 
-        /* The 16 byte complex pixel is not actually possible */
-    default:
-        nitf_Error_initf(error, NITF_CTXT, NITF_ERR_INVALID_PARAMETER, 
-                         "Invalid format size [%s]", length);
+    /*
+     * Write the last byte of the image data so the file has its final
+     * length and the handle is left after the image data
+     */
+    dataEnd = nitfI->pixelBase + nitfI->blockMask[nitfI->nBlocksTotal];
+    zero = 0;
+    if (!nitf_ImageIO_writeToFile(io, dataEnd - 1, &zero, 1, error))
+    {
+        nitf_ImageIO_stagedBlocksFree(nitfI);
         return NITF_FAILURE;
     }
 
+    nitfI->blockWriting = 1;
     return NITF_SUCCESS;
 }
 
 
-/*=================== nitf_ImageIO_pixelSize =================================*/
+/*========================= nitf_ImageIO_writeBlock ==========================*/
 
-NITFPROT(nitf_Uint32) nitf_ImageIO_pixelSize(nitf_ImageIO * nitf)
+NITFPROT(NITF_BOOL) nitf_ImageIO_writeBlock(nitf_ImageIO * nitf,
+                                            nitf_IOInterface* io,
+                                            nitf_Uint32 blockRow,
+                                            nitf_Uint32 blockCol,
+                                            nitf_Uint32 band,
+                                            const nitf_Uint8 * data,
+                                            nitf_Error * error)
 {
-    return (((_nitf_ImageIO *) nitf)->pixel.bytes);
-}
+    _nitf_ImageIO *nitfI;       /* Internal version of nitf */
+    nitf_Uint32 blockNumber;    /* Block number within a band */
+    nitf_Uint32 maskIdx;        /* Index of the block in the block mask */
+    nitf_Uint64 fileOffset;     /* Offset of the data in the file */
+    size_t bytes;               /* Bytes per pixel */
+    size_t pixels;              /* Pixels in one band of a block */
+    nitf_Uint32 validRows;      /* Rows of the block inside the image */
+    nitf_Uint32 validCols;      /* Columns of the block inside the image */
+    nitf_Uint8 *buffer;         /* Formatted data */
+    size_t count;               /* Bytes to write */
+    _nitf_ImageIOStagedBlock *staged; /* Block collecting its bands */
+    NITF_BOOL rc;
 
+    nitfI = (_nitf_ImageIO *) nitf;
+    if (!nitfI->blockWriting)
+    {
+        nitf_Error_initf(error, NITF_CTXT, NITF_ERR_INVALID_PARAMETER,
+                         "Block writes have not been set up");
+        return NITF_FAILURE;
+    }
 
-/*=================== nitf_ImageIO_pixelSize =================================*/
+    if ((blockRow >= nitfI->nBlocksPerColumn)
+        || (blockCol >= nitfI->nBlocksPerRow) || (band >= nitfI->numBands))
+    {
+        nitf_Error_initf(error, NITF_CTXT, NITF_ERR_INVALID_PARAMETER,
+                         "Block row %ld column %ld band %ld is out of range",
+                         (long) blockRow, (long) blockCol, (long) band);
+        return NITF_FAILURE;
+    }
 
-NITFPROT(NITF_BOOL) nitf_ImageIO_setFileOffset(nitf_ImageIO * nitf,
-        nitf_Uint64 offset,
-        nitf_Error * error)
-{
-    _nitf_ImageIO *nitfI;       /* Internal version of the handle */
+    bytes = nitfI->pixel.bytes;
+    pixels = (size_t) nitfI->numRowsPerBlock * nitfI->numColumnsPerBlock;
+    blockNumber = blockRow * nitfI->nBlocksPerRow + blockCol;
+    validRows = nitfI->numRows - blockRow * nitfI->numRowsPerBlock;
+    if (validRows > nitfI->numRowsPerBlock)
+        validRows = nitfI->numRowsPerBlock;
+    validCols = nitfI->numColumns - blockCol * nitfI->numColumnsPerBlock;
+    if (validCols > nitfI->numColumnsPerBlock)
+        validCols = nitfI->numColumnsPerBlock;
 
-    nitfI = (_nitf_ImageIO *) nitf;
+    /* Single bands in the file: "B" and "S" modes and one band images */
+    if (nitfI->stagedBlocks == NULL)
+    {
+        maskIdx = blockNumber;
+        fileOffset = 0;
+        if (nitfI->blockingMode == NITF_IMAGE_IO_BLOCKING_MODE_S)
+            maskIdx += band * nitfI->nBlocksPerRow * nitfI->nBlocksPerColumn;
+        else
+            fileOffset = (nitf_Uint64) band * pixels * bytes;
+        fileOffset += nitfI->pixelBase + nitfI->blockMask[maskIdx];
+        count = pixels * bytes;
 
-    /* Write in progress */
-    if (nitfI->writeControl != NULL)
+        buffer = (nitf_Uint8 *) NITF_MALLOC(count);
+        if (buffer == NULL)
+        {
+            nitf_Error_initf(error, NITF_CTXT, NITF_ERR_MEMORY,
+                             "Error allocating block buffer: %s",
+                             NITF_STRERROR(NITF_ERRNO));
+            return NITF_FAILURE;
+        }
+        memcpy(buffer, data, count);
+        if (nitfI->vtbl.format != NULL)
+            (*(nitfI->vtbl.format)) (buffer, pixels, nitfI->pixel.shift);
+        if (nitfI->padScanner != NULL)
+            nitf_ImageIO_markPad(nitfI, maskIdx, buffer, validRows,
+                                 nitfI->numColumnsPerBlock, validCols);
+
+        rc = nitf_ImageIO_writeAt(nitfI, io, fileOffset, buffer, count,
+                                  error);
+        NITF_FREE(buffer);
+        return rc;
+    }
+
+    /*      Find or create the block, and claim the band */
+
+    nitf_Mutex_lock(&(nitfI->lock));
+    staged = nitfI->stagedBlocks[blockNumber];
+    if (staged == NULL)
     {
-        nitf_Error_initf(error, NITF_CTXT, NITF_ERR_MEMORY,
-                         "Can not change file offset during I/O operation");
+        staged = (_nitf_ImageIOStagedBlock *)
+            NITF_MALLOC(sizeof(_nitf_ImageIOStagedBlock) + nitfI->numBands
+                        + nitfI->blockSize);
+        if (staged == NULL)
+        {
+            nitf_Mutex_unlock(&(nitfI->lock));
+            nitf_Error_initf(error, NITF_CTXT, NITF_ERR_MEMORY,
+                             "Error allocating block buffer: %s",
+                             NITF_STRERROR(NITF_ERRNO));
+            return NITF_FAILURE;
+        }
+        staged->bandsLeft = nitfI->numBands;
+        staged->received = (nitf_Uint8 *) (staged + 1);
+        staged->block = staged->received + nitfI->numBands;
+        memset(staged->received, 0, nitfI->numBands);
+        nitfI->stagedBlocks[blockNumber] = staged;
+    }
+    if (staged->received[band])
+    {
+        nitf_Mutex_unlock(&(nitfI->lock));
+        nitf_Error_initf(error, NITF_CTXT, NITF_ERR_INVALID_PARAMETER,
+                         "Band %ld of block %ld was already written",
+                         (long) band, (long) blockNumber);
         return NITF_FAILURE;
     }
+    staged->received[band] = 1;
+    nitf_Mutex_unlock(&(nitfI->lock));
 
     /*
-     * The two relevant fields are imageBase and pixelBase. pixelBase the
-     * imageBase offset plus another offset so subtract the current imageBase
-     * value from pixelBase and then add the new offset.
+     * Interleave the band into the block. Each band fills different bytes
+     * so the bands of one block can be copied in concurrently
      */
+    if (nitfI->blockingMode == NITF_IMAGE_IO_BLOCKING_MODE_R)
+    {
+        size_t rowBytes = nitfI->numColumnsPerBlock * bytes;
+        nitf_Uint32 row;
 
-    nitfI->pixelBase -= nitfI->imageBase;
-    nitfI->imageBase = offset;
-    nitfI->pixelBase += offset;
-    return NITF_SUCCESS;
-}
+        for (row = 0; row < nitfI->numRowsPerBlock; row++)
+            memcpy(staged->block
+                   + ((size_t) row * nitfI->numBands + band) * rowBytes,
+                   data + row * rowBytes, rowBytes);
+    }
+    else
+    {
+        size_t stride = nitfI->numBands * bytes;
+        nitf_Uint8 *dst = staged->block + band * bytes;
+        size_t i;
 
+        for (i = 0; i < pixels; i++)
+        {
+            memcpy(dst, data, bytes);
+            dst += stride;
+            data += bytes;
+        }
+    }
 
-NITFPROT(nitf_BlockingInfo *) nitf_BlockingInfo_construct(nitf_Error *
-        error)
-{
-    /*  Allocate the info object */
-    nitf_BlockingInfo *info =
-        (nitf_BlockingInfo *) NITF_MALLOC(sizeof(nitf_BlockingInfo));
+    /*      The last band to arrive writes the block */
 
-    /*  Return now if we have a problem above */
-    if (!info)
+    nitf_Mutex_lock(&(nitfI->lock));
+    staged->bandsLeft -= 1;
+    if (staged->bandsLeft != 0)
     {
-        nitf_Error_init(error, NITF_STRERROR(NITF_ERRNO),
-                        NITF_CTXT, NITF_ERR_MEMORY);
-        return NULL;
+        nitf_Mutex_unlock(&(nitfI->lock));
+        return NITF_SUCCESS;
+    }
+    nitfI->stagedBlocks[blockNumber] = NULL;
+    nitf_Mutex_unlock(&(nitfI->lock));
+
+    if (nitfI->vtbl.format != NULL)
+        (*(nitfI->vtbl.format)) (staged->block, pixels * nitfI->numBands,
+                                 nitfI->pixel.shift);
+    if ((nitfI->padScanner != NULL)
+        && (nitfI->blockingMode == NITF_IMAGE_IO_BLOCKING_MODE_R))
+        nitf_ImageIO_markPad(nitfI, blockNumber, staged->block,
+                             validRows * nitfI->numBands,
+                             nitfI->numColumnsPerBlock, validCols);
+    else if (nitfI->padScanner != NULL)
+        nitf_ImageIO_markPad(nitfI, blockNumber, staged->block, validRows,
+                             (size_t) nitfI->numColumnsPerBlock
+                             * nitfI->numBands,
+                             (size_t) validCols * nitfI->numBands);
+
+    rc = nitf_ImageIO_writeAt(nitfI, io,
+                              nitfI->pixelBase
+                              + nitfI->blockMask[blockNumber],
+                              staged->block, nitfI->blockSize, error);
+    NITF_FREE(staged);
+    return rc;
+}
+
+
+/*========================= nitf_ImageIO_writeBlocksDone =====================*/
+
+NITFPROT(NITF_BOOL) nitf_ImageIO_writeBlocksDone(nitf_ImageIO * nitf,
+                                                 nitf_IOInterface* io,
+                                                 nitf_Error * error)
+{
+    _nitf_ImageIO *nitfI;       /* Internal version of nitf */
+    nitf_Uint32 incomplete;     /* Blocks missing some bands */
+    nitf_Uint64 dataEnd;        /* File offset after the image data */
+
+    nitfI = (_nitf_ImageIO *) nitf;
+    if (!nitfI->blockWriting)
+    {
+        nitf_Error_initf(error, NITF_CTXT, NITF_ERR_INVALID_PARAMETER,
+                         "Block writes have not been set up");
+        return NITF_FAILURE;
+    }
+
+    nitfI->blockWriting = 0;
+    incomplete = nitf_ImageIO_stagedBlocksFree(nitfI);
+    if (incomplete != 0)
+    {
+        nitf_Error_initf(error, NITF_CTXT, NITF_ERR_INVALID_PARAMETER,
+                         "%ld blocks were not written because some of their "
+                         "bands were missing", (long) incomplete);
+        return NITF_FAILURE;
+    }
+
+    /*
+     * The pad mask is only known once the blocks have been seen. Rewrite
+     * the masks and leave the handle after the image data again
+     */
+    if (nitfI->padScanner != NULL)
+    {
+        if (!nitf_ImageIO_writeMasks(nitfI, io, error))
+            return NITF_FAILURE;
+        dataEnd = nitfI->pixelBase + nitfI->blockMask[nitfI->nBlocksTotal];
+        if (!NITF_IO_SUCCESS(nitf_IOInterface_seek(io, (nitf_Off) dataEnd,
+                                                   NITF_SEEK_SET, error)))
+            return NITF_FAILURE;
+    }
+    return NITF_SUCCESS;
+}
+
+
+NITFPRIV(nitf_Uint32) nitf_ImageIO_stagedBlocksFree(_nitf_ImageIO * nitf)
+{
+    nitf_Uint32 freed;          /* Blocks freed */
+    nitf_Uint32 i;
+
+    if (nitf->stagedBlocks == NULL)
+        return 0;
+
+    freed = 0;
+    for (i = 0; i < nitf->nBlocksTotal; i++)
+        if (nitf->stagedBlocks[i] != NULL)
+        {
+            NITF_FREE(nitf->stagedBlocks[i]);
+            freed += 1;
+        }
+
+    NITF_FREE(nitf->stagedBlocks);
+    nitf->stagedBlocks = NULL;
+    return freed;
+}
+
+
+NITFPRIV(void) nitf_ImageIO_markPad(_nitf_ImageIO * nitf,
+                                    nitf_Uint32 maskIdx,
+                                    const nitf_Uint8 * data,
+                                    nitf_Uint32 numRows,
+                                    size_t rowStride,
+                                    size_t numCols)
+{
+    size_t bytes;               /* Bytes per pixel */
+    nitf_Uint32 row;            /* Current row */
+    size_t col;                 /* Current column */
+
+    bytes = nitf->pixel.bytes;
+    for (row = 0; row < numRows; row++)
+    {
+        const nitf_Uint8 *pixel = data + row * rowStride * bytes;
+
+        for (col = 0; col < numCols; col++, pixel += bytes)
+            if (memcmp(pixel, nitf->pixel.pad, bytes) == 0)
+            {
+                /* Bands of one block may find pad at the same time */
+                nitf_Mutex_lock(&(nitf->lock));
+                nitf->padMask[maskIdx] = nitf->blockMask[maskIdx];
+                nitf_Mutex_unlock(&(nitf->lock));
+                return;
+            }
+    }
+}
+
+
+NITFPROT(NITF_BOOL) nitf_ImageIO_setPadPixel(nitf_ImageIO * object,
+                                             nitf_Uint8 * value,
+                                             nitf_Uint32 length,
+                                             nitf_Error* error)
+{
+    
+    _nitf_ImageIO* nio = (_nitf_ImageIO*)object;
+
+    if (length > NITF_IMAGE_IO_PAD_MAX_LENGTH)
+        length = NITF_IMAGE_IO_PAD_MAX_LENGTH;
+
+    memmove(nio->pixel.pad, value, length);
+    
+    /*  The pad value is stored big endian */
+
+    switch (length)
+    {
+    case 2:
+    {
+        nitf_Uint16* int16 = 
+            (nitf_Uint16*)&(nio->pixel.pad);
+        *int16 = NITF_HTONS(*int16);
+        break;
+
+    }
+    case 4:
+    {
+        nitf_Uint32* int32 = 
+            (nitf_Uint32*)&(nio->pixel.pad);
+        *int32 = NITF_HTONL(*int32);
+        break;
+    }
+    case 8:
+    {
+        nitf_Uint64* int64 =
+            (nitf_Uint64*)&(nio->pixel.pad);
+        
+        if (nio->pixel.type == NITF_IMAGE_IO_PIXEL_TYPE_C)
+        {
+            *int64 = NITF_HTONLC(*int64);
+            
+        }
+        else
+        {
+            *int64 = NITF_HTONLL(*int64);
+        }
+        break;
+    }
+
+        /* The 16 byte complex pixel is not actually possible */
+    default:
+        nitf_Error_initf(error, NITF_CTXT, NITF_ERR_INVALID_PARAMETER, 
+                         "Invalid format size [%s]", length);
+        return NITF_FAILURE;
+    }
+
+    return NITF_SUCCESS;
+}
+
+
+/*====================== nitf_ImageIO_setPadBlockOmission ===================*/
+
+NITFPROT(NITF_BOOL) nitf_ImageIO_setPadBlockOmission(nitf_ImageIO * object,
+                                                     nitf_Error * error)
+{
+    _nitf_ImageIO *nio = (_nitf_ImageIO *) object;
+
+    if ((nio->writeControl != NULL) || (nio->readCount != 0)
+        || nio->blockWriting || (nio->blockMask != NULL))
+    {
+        nitf_Error_initf(error, NITF_CTXT, NITF_ERR_INVALID_PARAMETER,
+                         "Pad block omission must be set before the "
+                         "image is written");
+        return NITF_FAILURE;
+    }
+
+    /* Masked types already omit pad blocks */
+    if (nio->compression & (NITF_IMAGE_IO_COMPRESSION_NM
+                            | NITF_IMAGE_IO_COMPRESSION_M1
+                            | NITF_IMAGE_IO_COMPRESSION_M3
+                            | NITF_IMAGE_IO_COMPRESSION_M4
+                            | NITF_IMAGE_IO_COMPRESSION_M5
+                            | NITF_IMAGE_IO_COMPRESSION_M8))
+        return NITF_SUCCESS;
+
+    if (nio->compression != NITF_IMAGE_IO_COMPRESSION_NC)
+    {
+        nitf_Error_initf(error, NITF_CTXT, NITF_ERR_INVALID_PARAMETER,
+                         "Pad block omission requires an uncompressed "
+                         "or masked image");
+        return NITF_FAILURE;
+    }
+
+    /* The block mask has no entries for the bands of an S mode image */
+    if (nio->blockingMode == NITF_IMAGE_IO_BLOCKING_MODE_S)
+    {
+        nitf_Error_init(error,
+                        "Masked image with S mode blocking is not supported",
+                        NITF_CTXT, NITF_ERR_INVALID_PARAMETER);
+        return NITF_FAILURE;
+    }
+
+    nio->compression = NITF_IMAGE_IO_COMPRESSION_NM;
+    return NITF_SUCCESS;
+}
+
+
+/*========================= nitf_ImageIO_streamLength ========================*/
+
+NITFPROT(NITF_BOOL) nitf_ImageIO_streamLength(nitf_ImageIO * object,
+                                              nitf_Uint64 * length)
+{
+    _nitf_ImageIO *nio = (_nitf_ImageIO *) object;
+
+    /*
+     * Compressed and masked data is only sized by writing it, and packed
+     * pixels are not always formatted a whole block at a time
+     */
+    if ((nio->compression != NITF_IMAGE_IO_COMPRESSION_NC)
+        || (nio->compressor != NULL)
+        || (nio->pixel.type == NITF_IMAGE_IO_PIXEL_TYPE_B)
+        || (nio->pixel.type == NITF_IMAGE_IO_PIXEL_TYPE_12))
+        return NITF_FAILURE;
+
+    /*
+     * Cached writes complete blocks in file order, except for S mode
+     * with several bands and block rows, where the bands of one block row
+     * complete together but are far apart in the file
+     */
+    if ((nio->blockingMode == NITF_IMAGE_IO_BLOCKING_MODE_S)
+        && (nio->numBands > 1) && (nio->nBlocksPerColumn > 1))
+        return NITF_FAILURE;
+
+    *length = ((nitf_Uint64) nio->nBlocksTotal) * (nio->blockSize);
+    return NITF_SUCCESS;
+}
+
+
+/*=================== nitf_ImageIO_pixelSize =================================*/
+
+NITFPROT(nitf_Uint32) nitf_ImageIO_pixelSize(nitf_ImageIO * nitf)
+{
+    return (((_nitf_ImageIO *) nitf)->pixel.bytes);
+}
+
+
+/*=================== nitf_ImageIO_pixelSize =================================*/
+
+NITFPROT(NITF_BOOL) nitf_ImageIO_setFileOffset(nitf_ImageIO * nitf,
+        nitf_Uint64 offset,
+        nitf_Error * error)
+{
+    _nitf_ImageIO *nitfI;       /* Internal version of the handle */
+
+    nitfI = (_nitf_ImageIO *) nitf;
+
+    /* Write in progress */
+    if (nitfI->writeControl != NULL)
+    {
+        nitf_Error_initf(error, NITF_CTXT, NITF_ERR_MEMORY,
+                         "Can not change file offset during I/O operation");
+        return NITF_FAILURE;
+    }
+
+    /*
+     * The two relevant fields are imageBase and pixelBase. pixelBase the
+     * imageBase offset plus another offset so subtract the current imageBase
+     * value from pixelBase and then add the new offset.
+     */
+
+    nitfI->pixelBase -= nitfI->imageBase;
+    nitfI->imageBase = offset;
+    nitfI->pixelBase += offset;
+    return NITF_SUCCESS;
+}
+
+
+NITFPROT(nitf_BlockingInfo *) nitf_BlockingInfo_construct(nitf_Error *
+        error)
+{
+    /*  Allocate the info object */
+    nitf_BlockingInfo *info =
+        (nitf_BlockingInfo *) NITF_MALLOC(sizeof(nitf_BlockingInfo));
+
+    /*  Return now if we have a problem above */
+    if (!info)
+    {
+        nitf_Error_init(error, NITF_STRERROR(NITF_ERRNO),
+                        NITF_CTXT, NITF_ERR_MEMORY);
+        return NULL;
     }
 
     return info;
@@ -3687,16 +5323,15 @@ nitf_ImageIO_getBlockingInfo(nitf_ImageIO *
 {
     _nitf_ImageIO *img;         /* Internal representation of object */
     nitf_BlockingInfo *result;  /* The requested information */
+    NITF_BOOL ok;               /* Set-up result */
 
     img = (_nitf_ImageIO *) image;
 
-    /*      Create the block mask if it has not been done already */
-
-    if (img->blockMask == NULL)
-    {
-        if (!nitf_ImageIO_mkMasks(img, io, 1, error))
-            return NULL;
-    }
+    nitf_Mutex_lock(&(img->lock));
+    ok = nitf_ImageIO_initBlocking(img, io, error);
+    nitf_Mutex_unlock(&(img->lock));
+    if (!ok)
+        return NULL;
 
     /*      Allocate the result */
 
@@ -3706,12 +5341,26 @@ nitf_ImageIO_getBlockingInfo(nitf_ImageIO *
         return NULL;
     }
 
-    if (img->blockInfoFlag)
+    *result = img->blockInfo;     /* Make a copy */
+    return result;
+}
+
+
+NITFPRIV(NITF_BOOL) nitf_ImageIO_initBlocking(_nitf_ImageIO * img,
+                                              nitf_IOInterface* io,
+                                              nitf_Error * error)
+{
+    /*      Create the block mask if it has not been done already */
+
+    if (img->blockMask == NULL)
     {
-        *result = img->blockInfo; /* Make a copy */
-        return result;
+        if (!nitf_ImageIO_mkMasks(img, io, 1, error))
+            return NITF_FAILURE;
     }
 
+    if (img->blockInfoFlag)
+        return NITF_SUCCESS;
+
     img->blockInfo.numBlocksPerRow = img->nBlocksPerRow;
     img->blockInfo.numBlocksPerCol = img->nBlocksPerColumn;
     img->blockInfo.numRowsPerBlock = img->numRowsPerBlock;
@@ -3733,15 +5382,11 @@ nitf_ImageIO_getBlockingInfo(nitf_ImageIO *
                                           &(img->blockInfo), img->blockMask,
                                           error);
         if (img->decompressionControl == NULL)
-        {
-            nitf_BlockingInfo_destruct(&result);
-            return NULL;
-        }
+            return NITF_FAILURE;
     }
 
     img->blockInfoFlag = 1;       /* Only do this once */
-    *result = img->blockInfo;     /* Make a copy */
-    return result;
+    return NITF_SUCCESS;
 }
 
 NITFPROT(int) nitf_ImageIO_setWriteCaching(nitf_ImageIO * nitf, int enable)
@@ -3751,7 +5396,14 @@ NITFPROT(int) nitf_ImageIO_setWriteCaching(nitf_ImageIO * nitf, int enable)
     
     initf = (_nitf_ImageIO *) nitf;
     saved = initf->cachedWriteFlag;
-    if (enable)
+
+    /*
+     * Compressed and packed pixels are only formatted a whole block at a
+     * time, so those images are always written through the block cache
+     */
+    if (enable || (initf->pixel.type == NITF_IMAGE_IO_PIXEL_TYPE_B)
+        || (initf->pixel.type == NITF_IMAGE_IO_PIXEL_TYPE_12)
+        || !(initf->compression & NITF_IMAGE_IO_NO_COMPRESSION))
     {
         initf->vtbl.writer = nitf_ImageIO_cachedWriter;
         initf->cachedWriteFlag = 1;
@@ -3774,16 +5426,181 @@ NITFPROT(void) nitf_ImageIO_setReadCaching(nitf_ImageIO * nitf)
     return;
 }
 
-/*=================== nitf_BlockingInfo_print ================================*/
+NITFPROT(void) nitf_ImageIO_setReadCacheSize(nitf_ImageIO * nitf,
+                                             size_t maxBytes)
+{
+    _nitf_ImageIO *initf;   /* Internal representation of object */
+    nitf_Uint32 i;
 
-NITFPROT(void) nitf_BlockingInfo_print(nitf_BlockingInfo * info,
-                                       FILE * file)
+    initf = (_nitf_ImageIO *) nitf;
+    initf->vtbl.reader = nitf_ImageIO_cachedReader;
+
+    nitf_Mutex_lock(&(initf->lock));
+    initf->blockCache.maxBytes = maxBytes;
+
+    /* Release memory now if the budget shrank */
+    nitf_ImageIO_blockCacheTrim(initf, 0, NULL);
+    nitf_Mutex_unlock(&(initf->lock));
+
+    /* Reduced resolution views get the same budget */
+    for (i = 0; i < initf->numLevels; i++)
+        if (initf->levels[i] != NULL)
+            nitf_ImageIO_setReadCacheSize(initf->levels[i], maxBytes);
+
+    return;
+}
+
+
+NITFPROT(void) nitf_ImageIO_setDecodeThreads(nitf_ImageIO * nitf,
+                                             nitf_Uint32 numThreads)
 {
-#ifdef NITF_DEBUG
-    if (file == NULL)
-        file = stdout;
+    _nitf_ImageIO *initf;   /* Internal representation of object */
+    nitf_Uint32 i;
 
-    fprintf(file, "nitf_ImageIOBlockingInfo structure:\n");
+    initf = (_nitf_ImageIO *) nitf;
+    nitf_Mutex_lock(&(initf->lock));
+    initf->decodeThreads = (numThreads > 0) ? numThreads : 1;
+    nitf_Mutex_unlock(&(initf->lock));
+
+    for (i = 0; i < initf->numLevels; i++)
+        if (initf->levels[i] != NULL)
+            nitf_ImageIO_setDecodeThreads(initf->levels[i], numThreads);
+
+    return;
+}
+
+
+NITFPROT(void) nitf_ImageIO_setReadAhead(nitf_ImageIO * nitf, int mode)
+{
+    _nitf_ImageIO *initf;   /* Internal representation of object */
+    nitf_Uint32 i;
+
+    initf = (_nitf_ImageIO *) nitf;
+    if (mode != NITF_READ_AHEAD_OFF)
+        initf->vtbl.reader = nitf_ImageIO_cachedReader;
+
+    nitf_Mutex_lock(&(initf->lock));
+    initf->readAhead.mode = mode;
+    nitf_Mutex_unlock(&(initf->lock));
+
+    /* Once off, nothing reads the caller's IOInterface in the background */
+    if (mode == NITF_READ_AHEAD_OFF)
+        nitf_ImageIO_readAheadJoin(initf);
+
+    for (i = 0; i < initf->numLevels; i++)
+        if (initf->levels[i] != NULL)
+            nitf_ImageIO_setReadAhead(initf->levels[i], mode);
+
+    return;
+}
+
+
+NITFPROT(const nitf_Uint8 *) nitf_ImageIO_borrowBlock(nitf_ImageIO * nitf,
+                                                      nitf_IOInterface* io,
+                                                      nitf_Uint32 blockNumber,
+                                                      nitf_Uint64 * blockSize,
+                                                      nitf_Error * error)
+{
+    _nitf_ImageIO *initf;   /* Internal representation of object */
+    const char *map;        /* Memory mapped file */
+    nitf_Off mapSize;       /* Size of the mapping */
+    nitf_Uint64 offset;     /* File offset of the block */
+    NITF_BOOL ok;           /* Set-up result */
+
+    initf = (_nitf_ImageIO *) nitf;
+
+    map = nitf_IOInterface_getMapping(io, &mapSize);
+    if (map == NULL)
+    {
+        nitf_Error_init(error, "Block borrowing requires a memory mapped IO",
+                        NITF_CTXT, NITF_ERR_INVALID_PARAMETER);
+        return NULL;
+    }
+
+    /*
+     * The block must be stored exactly as it would be returned by a read:
+     * uncompressed, whole bytes and in native byte order
+     */
+    if (!(initf->compression & NITF_IMAGE_IO_NO_COMPRESSION)
+            || (initf->pixel.type == NITF_IMAGE_IO_PIXEL_TYPE_B)
+            || (initf->pixel.type == NITF_IMAGE_IO_PIXEL_TYPE_12)
+            || (initf->vtbl.unformat != NULL))
+    {
+        nitf_Error_init(error,
+                        "Block borrowing requires uncompressed data that "
+                        "does not need byte swapping or unpacking",
+                        NITF_CTXT, NITF_ERR_INVALID_OBJECT);
+        return NULL;
+    }
+
+    nitf_Mutex_lock(&(initf->lock));
+    ok = nitf_ImageIO_initBlocking(initf, io, error);
+    nitf_Mutex_unlock(&(initf->lock));
+    if (!ok)
+        return NULL;
+
+    if (blockNumber >= initf->nBlocksTotal)
+    {
+        nitf_Error_initf(error, NITF_CTXT, NITF_ERR_INVALID_PARAMETER,
+                         "Block number %lu out of range, the image has %lu",
+                         (unsigned long) blockNumber,
+                         (unsigned long) initf->nBlocksTotal);
+        return NULL;
+    }
+
+    /* Blocks omitted by the block mask are all pad and have no storage */
+    if (initf->blockMask[blockNumber] == NITF_IMAGE_IO_NO_OFFSET)
+    {
+        nitf_Error_initf(error, NITF_CTXT, NITF_ERR_INVALID_OBJECT,
+                         "Block %lu is not stored in the file",
+                         (unsigned long) blockNumber);
+        return NULL;
+    }
+
+    offset = initf->pixelBase + initf->blockMask[blockNumber];
+    if ((offset > (nitf_Uint64) mapSize)
+            || ((nitf_Uint64) initf->blockSize
+                > (nitf_Uint64) mapSize - offset))
+    {
+        nitf_Error_initf(error, NITF_CTXT, NITF_ERR_READING_FROM_FILE,
+                         "Block %lu extends past the end of the file",
+                         (unsigned long) blockNumber);
+        return NULL;
+    }
+
+    if (blockSize != NULL)
+        *blockSize = initf->blockSize;
+    return (const nitf_Uint8 *) (map + offset);
+}
+
+
+NITFPROT(void) nitf_ImageIO_getReadCacheStats(nitf_ImageIO * nitf,
+                                              nitf_Uint64 * hits,
+                                              nitf_Uint64 * misses)
+{
+    _nitf_ImageIO *initf;   /* Internal representation of object */
+
+    initf = (_nitf_ImageIO *) nitf;
+    nitf_Mutex_lock(&(initf->lock));
+    if (hits != NULL)
+        *hits = initf->blockCache.hits;
+    if (misses != NULL)
+        *misses = initf->blockCache.misses;
+    nitf_Mutex_unlock(&(initf->lock));
+
+    return;
+}
+
+/*=================== nitf_BlockingInfo_print ================================*/
+
+NITFPROT(void) nitf_BlockingInfo_print(nitf_BlockingInfo * info,
+                                       FILE * file)
+{
+#ifdef NITF_DEBUG
+    if (file == NULL)
+        file = stdout;
+
+    fprintf(file, "nitf_ImageIOBlockingInfo structure:\n");
     fprintf(file, "  Number of blocks per row: %ld\n",
             info->numBlocksPerRow);
     fprintf(file, "  Number of blocks per column: %ld\n",
@@ -3806,6 +5623,16 @@ NITFPROT(void) nitf_BlockingInfo_print(nitf_BlockingInfo * info,
 /*======================== Internal Functions ================================*/
 /*============================================================================*/
 
+NITFPRIV(NITF_BOOL) nitf_ImageIO_revertsOptimizedModes(_nitf_ImageIO *nitfI,
+                                                       int numBands)
+{
+    if (nitfI->blockingMode == NITF_IMAGE_IO_BLOCKING_MODE_RGB24)
+        return (numBands == 3) || (numBands == 0);
+    if (nitfI->blockingMode == NITF_IMAGE_IO_BLOCKING_MODE_IQ)
+        return (numBands == 2) || (numBands == 0);
+    return 0;
+}
+
 NITFPRIV(void) nitf_ImageIO_revertOptimizedModes(_nitf_ImageIO *nitfI, int numBands)
 {
     if (nitfI->blockingMode == NITF_IMAGE_IO_BLOCKING_MODE_RGB24 &&
@@ -4001,6 +5828,8 @@ NITFPRIV(int) nitf_ImageIO_decodeBlockingMode(_nitf_ImageIO* nitf,
                                          "Invalid number of bytes in complex data %d", nitf->pixel.bytes);
                         return NITF_FAILURE;
                 }
+                nitf->vtbl.unformat =
+                    nitf_ImageIO_vectorKernel(nitf->vtbl.unformat);
             }
         }
         else
@@ -4066,6 +5895,7 @@ NITFPRIV(void) nitf_ImageIO_setIO(_nitf_ImageIO * nitf)
     {
         nitf->vtbl.reader = nitf_ImageIO_cachedReader;
         nitf->vtbl.writer = nitf_ImageIO_cachedWriter;
+        nitf->cachedWriteFlag = 1;
     }
 
     return;
@@ -4409,8 +6239,10 @@ NITFPRIV(int) nitf_ImageIO_setPixelDef(_nitf_ImageIO * nitf,
              * pixel type / # bits / justification combo is sane. */
             if (nitf->compression & NITF_IMAGE_IO_NO_COMPRESSION)
             {
-                nitf->vtbl.unformat = UNFORMAT_TABLE[i].unfmt;
-                nitf->vtbl.format = UNFORMAT_TABLE[i].fmt;
+                nitf->vtbl.unformat =
+                    nitf_ImageIO_vectorKernel(UNFORMAT_TABLE[i].unfmt);
+                nitf->vtbl.format =
+                    nitf_ImageIO_vectorKernel(UNFORMAT_TABLE[i].fmt);
             }
             found = 1;
             break;
@@ -4445,30 +6277,8 @@ NITFPRIV(void) nitf_ImageIO_setUnpack(_nitf_ImageIO * nitf)
 
     if (nitf->blockingMode == NITF_IMAGE_IO_BLOCKING_MODE_P)
     {
-        switch (nitf->pixel.bytes)
-        {
-            case 1:
-                nitf->vtbl.unpack = nitf_ImageIO_unpack_P_1;
-                nitf->vtbl.pack = nitf_ImageIO_pack_P_1;
-                break;
-            case 2:
-                nitf->vtbl.unpack = nitf_ImageIO_unpack_P_2;
-                nitf->vtbl.pack = nitf_ImageIO_pack_P_2;
-                break;
-            case 4:
-                nitf->vtbl.unpack = nitf_ImageIO_unpack_P_4;
-                nitf->vtbl.pack = nitf_ImageIO_pack_P_4;
-                break;
-            case 8:
-                nitf->vtbl.unpack = nitf_ImageIO_unpack_P_8;
-                nitf->vtbl.pack = nitf_ImageIO_pack_P_8;
-                break;
-            default:               /* Should never happen */
-            case 16:
-                nitf->vtbl.unpack = nitf_ImageIO_unpack_P_16;
-                nitf->vtbl.pack = nitf_ImageIO_pack_P_16;
-                break;
-        }
+        nitf->vtbl.unpack = nitf_ImageIO_unpack_P;
+        nitf->vtbl.pack = nitf_ImageIO_pack_P;
     }
     return;
 }
@@ -4734,7 +6544,7 @@ int nitf_ImageIO_setup_SBR(_nitf_ImageIOControl * cntl, nitf_Error * error)
                                  NITF_STRERROR(NITF_ERRNO));
                 return NITF_FAILURE;
             }
-            freeCacheBufferReset = 1; /* Do not allocate after first band */
+            freeCacheBufferReset = 0; /* Do not allocate after first band */
         }
         else
             cacheBuffer = NULL; /* This is meaningless */
@@ -5200,6 +7010,19 @@ int nitf_ImageIO_setup_P(_nitf_ImageIOControl * cntl, nitf_Error * error)
         return NITF_FAILURE;
     }
 
+    cntl->bandBuffers =
+        (nitf_Uint8 **) NITF_MALLOC(nitf->numBands * sizeof(nitf_Uint8 *));
+    if (cntl->bandBuffers == NULL)
+    {
+        nitf_Error_initf(error, NITF_CTXT, NITF_ERR_MEMORY,
+                         "Error allocating band buffer list: %s",
+                         NITF_STRERROR(NITF_ERRNO));
+        NITF_FREE(ioBuffer);
+        if (unpackedBuffer != NULL)
+            NITF_FREE(unpackedBuffer);
+        return NITF_FAILURE;
+    }
+
     /*    Initialize blocks */
     blockIO = &(blockIOs[0][0]);    /* Eliminates spurious warning */
     userOff = 0;
@@ -5355,19 +7178,12 @@ int nitf_ImageIO_setup_P(_nitf_ImageIOControl * cntl, nitf_Error * error)
              * the amount read/written is nitf->numBands times more than
              * is required for any one band due to the interleaving
              *
-             * The bufferOffset field gives the spacing between bands 
-             * in the read case and is set to 0 in the write case.
-             *
-             * For reading, the first read for a given row segment reads 
-             * all of the bands for that segment. The initial offset of 0
-             * for the first band is the correct
-             * buffer offset for the read. The pixel size times band offset
-             * then correctly line-up the start buffer for the unpack 
-             * operations.
-             *
-             * For writing, the buffer offset should be zero since the 
-             * last block IO does the write. The offsets need for the bands
-             * are calculated directly by the pack function.
+             * The buffer offset is zero for every band. For reading, the
+             * first read for a given row segment reads all of the bands for
+             * that segment into the start of the buffer, whichever band is
+             * requested first. For writing, the last block IO does the
+             * write. The offsets of the bands within the buffer are
+             * calculated directly by the pack and unpack functions.
              */
             if (cntl->userBase != NULL)
                 blockIO->user.buffer = cntl->userBase[bandIdx];
@@ -5377,16 +7193,8 @@ int nitf_ImageIO_setup_P(_nitf_ImageIOControl * cntl, nitf_Error * error)
             blockIO->user.offset.mark = userOff;
             blockIO->user.offset.orig = userOff;
             blockIO->rwBuffer.buffer = ioBuffer;
-            if (cntl->reading)
-            {
-                blockIO->rwBuffer.offset.mark = bytes * band;
-                blockIO->rwBuffer.offset.orig = bytes * band;
-            }
-            else
-            {
-                blockIO->rwBuffer.offset.mark = 0;
-                blockIO->rwBuffer.offset.orig = 0;
-            }
+            blockIO->rwBuffer.offset.mark = 0;
+            blockIO->rwBuffer.offset.orig = 0;
             blockIO->userEqBuffer = 0;
 
             /*
@@ -5678,7 +7486,8 @@ nitf_ImageIOControl_construct(_nitf_ImageIO * nitf,
         return NULL;
     }
     
-    if(nitf->compressor != NULL)
+    /* Compression is only started for writes */
+    if((nitf->compressor != NULL) && !reading)
     {
         if(!(*(nitf->compressor->start))(nitf->compressionControl,
                         nitf->pixelBase,
@@ -5751,6 +7560,15 @@ NITFPRIV(void) nitf_ImageIOControl_destruct(_nitf_ImageIOControl ** cntl)
     
     if (cntlActual->columnSave != NULL)
         NITF_FREE(cntlActual->columnSave);
+
+    if (cntlActual->bandBuffers != NULL)
+        NITF_FREE(cntlActual->bandBuffers);
+
+    if (cntlActual->decoded != NULL)
+    {
+        nitf_ImageIO_releaseDecoded(cntlActual);
+        NITF_FREE(cntlActual->decoded);
+    }
     
     NITF_FREE(cntlActual);
     *cntl = NULL;
@@ -6434,16 +8252,10 @@ NITFPRIV(int) nitf_ImageIO_writeMasks(_nitf_ImageIO * nitf,
     else
         padCodeLength = 0;
 
-    if (nitf_ImageIO_bigEndian())
-    {
-        ((nitf_Uint8 *) buffer)[8] = padCodeLength >> 8;
-        ((nitf_Uint8 *) buffer)[9] = padCodeLength & 0xff;
-    }
-    else
-    {
-        ((nitf_Uint8 *) buffer)[9] = padCodeLength >> 8;
-        ((nitf_Uint8 *) buffer)[8] = padCodeLength & 0xff;
-    }
+    /* The length is big endian in the file, like the rest of the header */
+
+    buffer[8] = (nitf_Uint8) (padCodeLength >> 8);
+    buffer[9] = (nitf_Uint8) (padCodeLength & 0xff);
 
     if (!nitf_ImageIO_writeToFile(io, nitf->imageBase,
                                   buffer, NITF_IMAGE_IO_MASK_HEADER_LEN,
@@ -6617,7 +8429,7 @@ NITFPRIV(int) nitf_ImageIO_oneRead(_nitf_ImageIOControl * cntl,
     pixelCount = (size_t)nitf->numRowsActual * (size_t)nitf->numColumnsActual;
     count = pixelCount * nitf->pixel.bytes;
 
-    if (!nitf_ImageIO_readFromFile(io,
+    if (!nitf_ImageIO_readAt(nitf, io,
                                    blockIO->cntl->nitf->pixelBase +
                                    blockIO->blockOffset.orig,
                                    blockIO->user.buffer + 
@@ -6654,6 +8466,12 @@ NITFPRIV(int) nitf_ImageIO_readRequest(_nitf_ImageIOControl * cntl,
     numBands = cntl->numBandSubset;
     nBlockCols = cntl->nBlockIO / numBands;
 
+    /* Reads straight into the user's buffer can be merged */
+    if ((nitf->vtbl.reader == nitf_ImageIO_uncachedReader)
+        && (nitf->vtbl.unpack == NULL)
+        && cntl->blockIO[0][0].userEqBuffer)
+        return nitf_ImageIO_readRequestCoalesced(cntl, io, error);
+
     for (col = 0; col < nBlockCols; col++)
     {
         for (row = 0; row < numRows; row++)
@@ -6665,8 +8483,10 @@ NITFPRIV(int) nitf_ImageIO_readRequest(_nitf_ImageIOControl * cntl,
                     if (!(*(nitf->vtbl.reader)) (blockIO, io, error))
                         return NITF_FAILURE;
                 
-                if (nitf->vtbl.unpack != NULL)
-                    (*(nitf->vtbl.unpack)) (blockIO, error);
+                /* One unpack does all of the bands of the row segment */
+                if ((nitf->vtbl.unpack != NULL) && (band == 0))
+                    (*(nitf->vtbl.unpack)) (cntl->blockIO[col], numBands,
+                                            error);
                 
                 if (nitf->vtbl.unformat != NULL)
                     (*(nitf->vtbl.unformat)) (blockIO->user.buffer +
@@ -6699,6 +8519,275 @@ NITFPRIV(int) nitf_ImageIO_readRequest(_nitf_ImageIOControl * cntl,
     return 1;
 }
 
+NITFPRIV(int) nitf_ImageIO_readRequestCoalesced(_nitf_ImageIOControl * cntl,
+                                                nitf_IOInterface* io,
+                                                nitf_Error * error)
+{
+    _nitf_ImageIO *nitf;       /* Parent _nitf_ImageIO object */
+    nitf_Uint32 nBlockCols;    /* Number of block columns */
+    nitf_Uint32 numRows;       /* Number of rows in the requested sub-window */
+    nitf_Uint32 numBands;      /* Number of bands */
+    nitf_Uint32 col;           /* Block column index */
+    nitf_Uint32 row;           /* Current row in sub-window */
+    nitf_Uint32 band;          /* Current band in sub-window */
+    _nitf_ImageIOBlock *blockIO; /* The current  block IO structure */
+    _nitf_ImageIOExtent *extents; /* Row segments gathered so far */
+    _nitf_ImageIOExtent *extent;  /* The current row segment */
+    _nitf_ImageIOExtent **order;  /* Work space for nitf_ImageIO_readExtents */
+    nitf_IOVec *vec;           /* Work space for nitf_ImageIO_readExtents */
+    nitf_IORequest *requests;  /* Work space for nitf_ImageIO_readExtents */
+    nitf_Uint8 *scratch;       /* Destination of skipped bytes */
+    size_t nExtents;           /* Number of extents gathered */
+    int ret;                   /* Return value */
+
+    nitf = cntl->nitf;
+    numRows = cntl->numRows;
+    numBands = cntl->numBandSubset;
+    nBlockCols = cntl->nBlockIO / numBands;
+
+    extents = (_nitf_ImageIOExtent *)
+        NITF_MALLOC(NITF_IMAGE_IO_MAX_EXTENTS * sizeof(_nitf_ImageIOExtent));
+    order = (_nitf_ImageIOExtent **)
+        NITF_MALLOC(NITF_IMAGE_IO_MAX_EXTENTS * sizeof(_nitf_ImageIOExtent *));
+    vec = (nitf_IOVec *)
+        NITF_MALLOC(2 * NITF_IMAGE_IO_MAX_EXTENTS * sizeof(nitf_IOVec));
+    requests = (nitf_IORequest *)
+        NITF_MALLOC(NITF_IMAGE_IO_MAX_EXTENTS * sizeof(nitf_IORequest));
+    scratch = (nitf_Uint8 *) NITF_MALLOC(NITF_IMAGE_IO_COALESCE_GAP);
+    if ((extents == NULL) || (order == NULL) || (vec == NULL)
+        || (requests == NULL) || (scratch == NULL))
+    {
+        nitf_Error_initf(error, NITF_CTXT, NITF_ERR_MEMORY,
+                         "Error allocating read extents: %s",
+                         NITF_STRERROR(NITF_ERRNO));
+        ret = NITF_FAILURE;
+        goto CLEANUP;
+    }
+
+    ret = NITF_SUCCESS;
+    nExtents = 0;
+    for (col = 0; col < nBlockCols; col++)
+    {
+        for (row = 0; row < numRows; row++)
+        {
+            for (band = 0; band < numBands; band++)
+            {
+                blockIO = &(cntl->blockIO[col][band]);
+
+                /*
+                 * Same as nitf_ImageIO_uncachedReader except that the
+                 * read is recorded rather than done
+                 */
+                extent = &(extents[nExtents++]);
+                extent->buffer = blockIO->rwBuffer.buffer
+                    + blockIO->rwBuffer.offset.mark;
+                extent->count = 0;
+                extent->user = blockIO->user.buffer
+                    + blockIO->user.offset.mark;
+                extent->pixelCount = blockIO->pixelCountDR;
+                if (blockIO->doIO)
+                {
+                    if (blockIO->imageDataOffset == NITF_IMAGE_IO_NO_OFFSET)
+                    {
+                        if (!nitf_ImageIO_readPad(blockIO, error))
+                        {
+                            ret = NITF_FAILURE;
+                            goto CLEANUP;
+                        }
+                        cntl->padded = 1;
+                    }
+                    else
+                    {
+                        extent->fileOffset = nitf->pixelBase
+                            + blockIO->imageDataOffset
+                            + blockIO->blockOffset.mark;
+                        extent->count = blockIO->readCount;
+                        if (blockIO->padMask[blockIO->number]
+                            != NITF_IMAGE_IO_NO_OFFSET)
+                            cntl->padded = 1;
+                    }
+                }
+
+                /* See nitf_ImageIO_readRequest */
+                if (row != numRows - 1)
+                    nitf_ImageIO_nextRow(blockIO, 0);
+
+                if (blockIO->rowsUntil == 0)
+                    blockIO->rowsUntil = nitf->numRowsPerBlock - 1;
+                else
+                    blockIO->rowsUntil -= 1;
+
+                if (nExtents == NITF_IMAGE_IO_MAX_EXTENTS)
+                {
+                    if (!nitf_ImageIO_readExtents(nitf, io, extents,
+                                                  nExtents, order, vec,
+                                                  requests, scratch, error))
+                    {
+                        ret = NITF_FAILURE;
+                        goto CLEANUP;
+                    }
+                    nExtents = 0;
+                }
+            }
+        }
+    }
+
+    if ((nExtents != 0)
+        && !nitf_ImageIO_readExtents(nitf, io, extents, nExtents,
+                                     order, vec, requests, scratch, error))
+        ret = NITF_FAILURE;
+
+CLEANUP:
+    if (extents != NULL)
+        NITF_FREE(extents);
+    if (order != NULL)
+        NITF_FREE(order);
+    if (vec != NULL)
+        NITF_FREE(vec);
+    if (requests != NULL)
+        NITF_FREE(requests);
+    if (scratch != NULL)
+        NITF_FREE(scratch);
+    return ret;
+}
+
+
+NITFPRIV(int) nitf_ImageIO_readExtents(_nitf_ImageIO * nitf,
+                                       nitf_IOInterface* io,
+                                       _nitf_ImageIOExtent * extents,
+                                       size_t count,
+                                       _nitf_ImageIOExtent ** order,
+                                       nitf_IOVec * vec,
+                                       nitf_IORequest * requests,
+                                       nitf_Uint8 * scratch,
+                                       nitf_Error * error)
+{
+    nitf_Off mapSize;           /* Size of the mapping, if any */
+    size_t nOrder;              /* Number of extents with a read */
+    size_t first;               /* First extent of the current run */
+    size_t next;                /* Candidate to join the current run */
+    nitf_Uint64 end;            /* File offset after the current run */
+    nitf_IOVec *runVec;         /* Buffers of the current run */
+    int nVec;                   /* Number of buffers in the current run */
+    int nRuns;                  /* Number of runs */
+    size_t i;
+
+    nOrder = 0;
+    for (i = 0; i < count; i++)
+        if (extents[i].count != 0)
+            order[nOrder++] = &(extents[i]);
+
+    /* A mapping is copied from directly, there are no reads to save */
+    if (nitf_IOInterface_getMapping(io, &mapSize) != NULL)
+    {
+        for (i = 0; i < nOrder; i++)
+            if (!nitf_ImageIO_readAt(nitf, io, order[i]->fileOffset,
+                                     order[i]->buffer, order[i]->count,
+                                     error))
+                return NITF_FAILURE;
+        nOrder = 0;
+    }
+
+    qsort(order, nOrder, sizeof(_nitf_ImageIOExtent *),
+          nitf_ImageIO_compareExtents);
+
+    /* Each run gets its own slice of vec so they can all be in flight */
+
+    nRuns = 0;
+    runVec = vec;
+    for (first = 0; first < nOrder; first = next)
+    {
+        runVec[0].buf = (char *) order[first]->buffer;
+        runVec[0].size = order[first]->count;
+        nVec = 1;
+        end = order[first]->fileOffset + order[first]->count;
+
+        for (next = first + 1; next < nOrder; next++)
+        {
+            nitf_Uint64 gap;    /* Unwanted bytes before this extent */
+
+            if (order[next]->fileOffset < end)
+                break;
+            gap = order[next]->fileOffset - end;
+            if (gap > NITF_IMAGE_IO_COALESCE_GAP)
+                break;
+
+            if (gap != 0)
+            {
+                runVec[nVec].buf = (char *) scratch;
+                runVec[nVec].size = (size_t) gap;
+                nVec++;
+            }
+
+            /* Neighbours in the file are often neighbours in memory */
+            if ((gap == 0) && (runVec[nVec - 1].buf + runVec[nVec - 1].size
+                               == (char *) order[next]->buffer))
+                runVec[nVec - 1].size += order[next]->count;
+            else
+            {
+                runVec[nVec].buf = (char *) order[next]->buffer;
+                runVec[nVec].size = order[next]->count;
+                nVec++;
+            }
+            end = order[next]->fileOffset + order[next]->count;
+        }
+
+        requests[nRuns].offset = (nitf_Off) order[first]->fileOffset;
+        requests[nRuns].vec = runVec;
+        requests[nRuns].count = nVec;
+        requests[nRuns].user = NULL;
+        nRuns++;
+        runVec += nVec;
+    }
+
+    if ((nRuns > 1) && nitf_IOInterface_canReadBatch(io))
+    {
+        if (!nitf_IOInterface_readBatch(io, requests, nRuns, NULL, NULL,
+                                        error))
+            return NITF_FAILURE;
+    }
+    else
+    {
+        for (i = 0; i < (size_t) nRuns; i++)
+        {
+            if (requests[i].count == 1)
+            {
+                if (!nitf_ImageIO_readAt(nitf, io,
+                                         (nitf_Uint64) requests[i].offset,
+                                         (nitf_Uint8 *) requests[i].vec[0].buf,
+                                         requests[i].vec[0].size, error))
+                    return NITF_FAILURE;
+            }
+            else if (!nitf_ImageIO_readvAt(nitf, io,
+                                           (nitf_Uint64) requests[i].offset,
+                                           requests[i].vec,
+                                           requests[i].count, error))
+                return NITF_FAILURE;
+        }
+    }
+
+    if (nitf->vtbl.unformat != NULL)
+        for (i = 0; i < count; i++)
+            (*(nitf->vtbl.unformat)) (extents[i].user,
+                                      extents[i].pixelCount,
+                                      nitf->pixel.shift);
+
+    return NITF_SUCCESS;
+}
+
+
+NITFPRIV(int) nitf_ImageIO_compareExtents(const void *a, const void *b)
+{
+    const _nitf_ImageIOExtent *ea = *(const _nitf_ImageIOExtent * const *) a;
+    const _nitf_ImageIOExtent *eb = *(const _nitf_ImageIOExtent * const *) b;
+
+    if (ea->fileOffset < eb->fileOffset)
+        return -1;
+    if (ea->fileOffset > eb->fileOffset)
+        return 1;
+    return 0;
+}
+
 /* This function is used when FR != DR (down-Sampling) */
 NITFPRIV(int) nitf_ImageIO_readRequestDownSample(_nitf_ImageIOControl *
                                                  cntl,
@@ -6757,8 +8846,10 @@ NITFPRIV(int) nitf_ImageIO_readRequestDownSample(_nitf_ImageIOControl *
                     if (!(*(nitf->vtbl.reader)) (blockIO, io, error))
                         return NITF_FAILURE;
                 
-                if (nitf->vtbl.unpack != NULL)
-                    (*(nitf->vtbl.unpack)) (blockIO, error);
+                /* One unpack does all of the bands of the row segment */
+                if ((nitf->vtbl.unpack != NULL) && (band == 0))
+                    (*(nitf->vtbl.unpack)) (cntl->blockIO[col], numBands,
+                                            error);
                 
                 /*
                  * Copy first neighborhood data from previous block 
@@ -7022,31 +9113,112 @@ NITFPRIV(int) nitf_ImageIO_readFromFile(nitf_IOInterface* io,
     return NITF_SUCCESS;
 }
 
-NITFPRIV(int) nitf_ImageIO_writeToFile(nitf_IOInterface* io,
-                                       nitf_Uint64 fileOffset,
-                                       const nitf_Uint8 * buffer,
-                                       size_t count,
-                                       nitf_Error * error)
-{
-    
-    /* Seek to the offset */
-    if (!NITF_IO_SUCCESS
-        (nitf_IOInterface_seek
-         (io, (nitf_Off) fileOffset, NITF_SEEK_SET, error)))
-        return NITF_FAILURE;
-    
-    /* Write the data */
-    if (! nitf_IOInterface_write(io, (char *) buffer, count, error) )
-        return NITF_FAILURE;
-    
-    return NITF_SUCCESS;
-}
-NITFPRIV(int) nitf_ImageIO_writeToBlock(_nitf_ImageIOBlock * blockIO,
-                                        nitf_IOInterface* io,
-                                        size_t blockOffset,
-                                        const nitf_Uint8 * buffer,
-                                        size_t count,
-                                        nitf_Error * error)
+
+NITFPRIV(int) nitf_ImageIO_readAt(_nitf_ImageIO * nitf,
+                                  nitf_IOInterface* io,
+                                  nitf_Uint64 fileOffset,
+                                  nitf_Uint8 * buffer,
+                                  size_t count,
+                                  nitf_Error * error)
+{
+    const char *map;            /* Memory mapped file, if available */
+    nitf_Off mapSize;           /* Size of the mapping */
+    int ret;                    /* Return value */
+
+    map = nitf_IOInterface_getMapping(io, &mapSize);
+    if (map != NULL)
+    {
+        if ((fileOffset > (nitf_Uint64) mapSize)
+            || ((nitf_Uint64) count > (nitf_Uint64) mapSize - fileOffset))
+        {
+            nitf_Error_initf(error, NITF_CTXT, NITF_ERR_READING_FROM_FILE,
+                             "Read of %llu bytes at offset %llu is past the "
+                             "end of the file",
+                             (unsigned long long) count,
+                             (unsigned long long) fileOffset);
+            return NITF_FAILURE;
+        }
+        memcpy(buffer, map + fileOffset, count);
+        return NITF_SUCCESS;
+    }
+
+    if (nitf_IOInterface_canReadAt(io))
+        return nitf_IOInterface_readAt(io, (nitf_Off) fileOffset,
+                                       (char *) buffer, count, error);
+
+    nitf_Mutex_lock(&(nitf->ioLock));
+    ret = nitf_ImageIO_readFromFile(io, fileOffset, buffer, count, error);
+    nitf_Mutex_unlock(&(nitf->ioLock));
+    return ret;
+}
+
+
+NITFPRIV(int) nitf_ImageIO_readvAt(_nitf_ImageIO * nitf,
+                                   nitf_IOInterface* io,
+                                   nitf_Uint64 fileOffset,
+                                   const nitf_IOVec * vec,
+                                   int count,
+                                   nitf_Error * error)
+{
+    int ret;                    /* Return value */
+
+    if (nitf_IOInterface_canReadAt(io))
+        return nitf_IOInterface_readvAt(io, (nitf_Off) fileOffset,
+                                        vec, count, error);
+
+    nitf_Mutex_lock(&(nitf->ioLock));
+    ret = nitf_IOInterface_readvAt(io, (nitf_Off) fileOffset,
+                                   vec, count, error);
+    nitf_Mutex_unlock(&(nitf->ioLock));
+    return ret;
+}
+
+
+NITFPRIV(int) nitf_ImageIO_writeToFile(nitf_IOInterface* io,
+                                       nitf_Uint64 fileOffset,
+                                       const nitf_Uint8 * buffer,
+                                       size_t count,
+                                       nitf_Error * error)
+{
+    
+    /* Seek to the offset */
+    if (!NITF_IO_SUCCESS
+        (nitf_IOInterface_seek
+         (io, (nitf_Off) fileOffset, NITF_SEEK_SET, error)))
+        return NITF_FAILURE;
+    
+    /* Write the data */
+    if (! nitf_IOInterface_write(io, (char *) buffer, count, error) )
+        return NITF_FAILURE;
+    
+    return NITF_SUCCESS;
+}
+NITFPRIV(int) nitf_ImageIO_writeAt(_nitf_ImageIO * nitf,
+                                   nitf_IOInterface* io,
+                                   nitf_Uint64 fileOffset,
+                                   const nitf_Uint8 * buffer,
+                                   size_t count,
+                                   nitf_Error * error)
+{
+    int ret;                    /* Return value */
+
+    if (nitf_IOInterface_canWriteAt(io))
+        return nitf_IOInterface_writeAt(io, (nitf_Off) fileOffset,
+                                        (const char *) buffer, count, error);
+
+    nitf_Mutex_lock(&(nitf->ioLock));
+    ret = nitf_ImageIO_writeToFile(io, fileOffset, buffer, count, error);
+    nitf_Mutex_unlock(&(nitf->ioLock));
+    return ret;
+}
+
+
+NITFPRIV(int) nitf_ImageIO_writeToBlock(_nitf_ImageIOBlock * blockIO,
+                                        nitf_IOInterface* io,
+                                        size_t blockOffset,
+                                        const nitf_Uint8 * buffer,
+                                        size_t count,
+                                        nitf_Error * error)
 {
     _nitf_ImageIO *nitf;        /* Associated image I/O object */
     /* Associated block control */
@@ -7253,7 +9425,7 @@ int nitf_ImageIO_uncachedReader(_nitf_ImageIOBlock * blockIO,
     }
     else
     {
-        if (!nitf_ImageIO_readFromFile(io,
+        if (!nitf_ImageIO_readAt(blockIO->cntl->nitf, io,
                                        blockIO->cntl->nitf->pixelBase +
                                        blockIO->imageDataOffset +
                                        blockIO->blockOffset.mark,
@@ -7278,6 +9450,9 @@ int nitf_ImageIO_cachedReader(_nitf_ImageIOBlock * blockIO,
 {
     _nitf_ImageIO *nitf;        /* Associated ImageIO object */
     _nitf_ImageIOControl *cntl; /* Associated control object */
+    _nitf_ImageIOCachedBlock *entry; /* Cache entry for this block */
+    _nitf_ImageIODecodedBlock key;   /* Search key for decoded blocks */
+    _nitf_ImageIODecodedBlock *decoded; /* Block decoded ahead */
     
     cntl = blockIO->cntl;
     nitf = cntl->nitf;
@@ -7292,540 +9467,2160 @@ int nitf_ImageIO_cachedReader(_nitf_ImageIOBlock * blockIO,
         cntl->padded = 1;
         return NITF_SUCCESS;
     }
-    else
+
+    /* Blocks decoded ahead belong to this read and need no lock */
+
+    if (cntl->decoded != NULL)
     {
-        if (nitf->blockControl.number != blockIO->number)
+        key.number = (nitf_Uint32) (blockIO->blockMask - nitf->blockMask)
+            + blockIO->number;
+        decoded = (_nitf_ImageIODecodedBlock *)
+            bsearch(&key, cntl->decoded, cntl->nDecoded,
+                    sizeof(_nitf_ImageIODecodedBlock),
+                    nitf_ImageIO_compareDecoded);
+        /* A block of a later batch means the read has moved on */
+        if ((decoded != NULL) && (decoded->batch > cntl->batch)
+            && !nitf_ImageIO_fetchBatch(cntl, io, decoded->batch, error))
+            return NITF_FAILURE;
+
+        if ((decoded != NULL) && (decoded->batch == cntl->batch)
+            && (decoded->block != NULL))
         {
-            if ((nitf->pixel.type != NITF_IMAGE_IO_PIXEL_TYPE_B)
-                  && (nitf->pixel.type != NITF_IMAGE_IO_PIXEL_TYPE_12)
-                     && (nitf->compression & NITF_IMAGE_IO_NO_COMPRESSION))
-            {
-                /* Allocate block buffer if required */
-                if (nitf->blockControl.block == NULL)
-                {
-                    nitf->blockControl.block =
-                        (nitf_Uint8 *) NITF_MALLOC(nitf->blockSize);
-                    if (nitf->blockControl.block == NULL)
-                    {
-                        nitf_Error_initf(error, NITF_CTXT, NITF_ERR_MEMORY,
-                                         "Error allocating block buffer: %s",
-                                         NITF_STRERROR(NITF_ERRNO));
-                        return NITF_FAILURE;
-                    }
-                }
-                /* Read the block */
-
-                if (!nitf_ImageIO_readFromFile(io,
-                                               blockIO->cntl->nitf->
-                                               pixelBase +
-                                               blockIO->imageDataOffset,
-                                               nitf->blockControl.block,
-                                               nitf->blockSize, error))
-                    return NITF_FAILURE;
-            }
-            else
-            {
-                /* Decompression interface structure */
-                nitf_DecompressionInterface *iface;
-                
-                /* No plugin */
-                if (nitf->decompressor == NULL)
-                {
-                    nitf_Error_initf(error, NITF_CTXT,
-                                     NITF_ERR_DECOMPRESSION,
-                                     "No decompression plugin for compressed type");
-                    return NITF_FAILURE;
-                }
-                
-                iface = nitf->decompressor;
-                if (nitf->blockControl.block != NULL)
-                    (*(iface->freeBlock)) (nitf->decompressionControl,
-                                               nitf->blockControl.block,
-                                               error);
-                nitf->blockControl.block =
-                    (*(iface->readBlock)) (nitf->decompressionControl,
-                                               blockIO->number, error);
-                if (nitf->blockControl.block == NULL)
-                    return NITF_FAILURE;
-            }
-            nitf->blockControl.number = blockIO->number;
+            memcpy(blockIO->rwBuffer.buffer + blockIO->rwBuffer.offset.mark,
+                   decoded->block + blockIO->blockOffset.mark,
+                   blockIO->readCount);
+
+            if (blockIO->padMask[blockIO->number] != NITF_IMAGE_IO_NO_OFFSET)
+                cntl->padded = 1;
+
+            return NITF_SUCCESS;
         }
-        
-        /* Get data from block */
-        
-        memcpy(blockIO->rwBuffer.buffer + blockIO->rwBuffer.offset.mark,
-               nitf->blockControl.block + blockIO->blockOffset.mark,
-               blockIO->readCount);
-        
-        if (blockIO->padMask[blockIO->number] != NITF_IMAGE_IO_NO_OFFSET)
-            blockIO->cntl->padded = 1;
-        
-        return NITF_SUCCESS;
     }
-}
 
+    /*
+     * The cache is shared by all reads in progress. The entry is in use
+     * until the data is copied so it cannot be freed by another thread
+     */
 
-int nitf_ImageIO_uncachedWriter(_nitf_ImageIOBlock * blockIO,
-                                nitf_IOInterface* io, 
-                                nitf_Error * error)
-{
-    _nitf_ImageIOControl *cntl; /* Associated image I/O control object */
-    _nitf_ImageIO *nitf;        /* Associated image I/O object */
-    
-    cntl = blockIO->cntl;
-    nitf = cntl->nitf;
-    
-    if (!nitf_ImageIO_writeToFile(io,
-                                  nitf->pixelBase + blockIO->imageDataOffset
-                                  + blockIO->blockOffset.mark,
-                                  blockIO->rwBuffer.buffer + 
-                                  blockIO->rwBuffer.offset.mark,
-                                  blockIO->readCount, error))
+    entry = nitf_ImageIO_cachedBlock(blockIO, io, error);
+    if (entry == NULL)
         return NITF_FAILURE;
+
+    /* Get data from block */
     
-    /*      Write column and row padding if required. This is fill not pad */
-    
-    if (blockIO->padColumnCount != 0)
-    {
-        if (cntl->padBuffer == NULL)
-            if (!nitf_ImageIO_allocatePad(cntl, error))
-                return NITF_FAILURE;
-        
-        if (!nitf_ImageIO_writeToFile(io,
-                                      nitf->pixelBase +
-                                      blockIO->imageDataOffset +
-                                      blockIO->blockOffset.mark + 
-                                      blockIO->readCount,
-                                      cntl->padBuffer,
-                                      (size_t)blockIO->padColumnCount,
-                                      error))
-            return NITF_FAILURE;
-        /* Fill not pad blockIO->padMask[blockIO->number] = blockIO->blockMask[blockIO->number]; */
-    }
-    
-    if ((blockIO->padRowCount != 0)
-        && (blockIO->currentRow >= (nitf->numRows - 1)))
-    {
-        size_t writeCount;      /* Amount to write each row */
-        nitf_Uint64 offset;     /* File offset for each write */
-        size_t increment;       /* Byte increment between writes */
-        nitf_Uint32 rowIdx;     /* Rwo counter */
-        
-        if (cntl->padBuffer == NULL)
-            if (!nitf_ImageIO_allocatePad(cntl, error))
-                return NITF_FAILURE;
-        
-        writeCount = blockIO->readCount + blockIO->padColumnCount;
-        increment = writeCount;
-        offset = nitf->pixelBase + blockIO->imageDataOffset
-                 + blockIO->blockOffset.mark + increment;
+    memcpy(blockIO->rwBuffer.buffer + blockIO->rwBuffer.offset.mark,
+           entry->block + blockIO->blockOffset.mark,
+           blockIO->readCount);
 
-        for (rowIdx = 0; rowIdx < blockIO->padRowCount; rowIdx++)
-        {
-            if (!nitf_ImageIO_writeToFile(io,
-                                          offset, cntl->padBuffer,
-                                          writeCount, error))
-                return NITF_FAILURE;
-            offset += increment;
-        }
-    }
+    nitf_Mutex_lock(&(nitf->lock));
+    nitf_ImageIO_blockCacheRelease(nitf, entry);
+    nitf_Mutex_unlock(&(nitf->lock));
+    
+    if (blockIO->padMask[blockIO->number] != NITF_IMAGE_IO_NO_OFFSET)
+        blockIO->cntl->padded = 1;
     
     return NITF_SUCCESS;
 }
 
-int nitf_ImageIO_cachedWriter(_nitf_ImageIOBlock * blockIO,
-                              nitf_IOInterface* io, 
-                              nitf_Error * error)
+
+NITFPRIV(_nitf_ImageIOCachedBlock *)
+nitf_ImageIO_cachedBlock(_nitf_ImageIOBlock * blockIO,
+                         nitf_IOInterface* io,
+                         nitf_Error * error)
 {
-    _nitf_ImageIOControl *cntl; /* Associated image I/O control object */
-    _nitf_ImageIO *nitf;        /* Associated image I/O object */
-    nitf_Uint32 i;
-    
-    cntl = blockIO->cntl;
-    nitf = cntl->nitf;
-    
-    if (!nitf_ImageIO_writeToBlock(blockIO, io, blockIO->blockOffset.mark,
-                                   blockIO->rwBuffer.buffer + 
-                                   blockIO->rwBuffer.offset.mark,
-                                   blockIO->readCount, error))
-        return NITF_FAILURE;
+    _nitf_ImageIO *nitf;        /* Associated ImageIO object */
+    _nitf_ImageIOBlockCache *cache;  /* The block cache */
+    _nitf_ImageIOCachedBlock *entry; /* Cache entry for this block */
+    _nitf_ImageIOCachedBlock *old;   /* Entry replaced by this one */
+    nitf_Uint32 number;              /* Block number, all bands */
+    nitf_Uint32 row;                 /* First row the read needs */
+    nitf_Uint32 column;              /* First column the read needs */
+    nitf_Uint32 numRows;             /* Number of rows the read needs */
+    nitf_Uint32 numColumns;          /* Number of columns the read needs */
+    NITF_BOOL raw;                   /* Read without a decompressor */
+    NITF_BOOL ok;                    /* Read or decode succeeded */
+    nitf_Mutex *decodeLock;          /* Serializes the decompressor */
+    
+    nitf = blockIO->cntl->nitf;
+    cache = &(nitf->blockCache);
+    nitf_ImageIO_blockRegion(blockIO->cntl, blockIO->number, &row, &column,
+                             &numRows, &numColumns);
+
+    raw = (nitf->pixel.type != NITF_IMAGE_IO_PIXEL_TYPE_B)
+        && (nitf->pixel.type != NITF_IMAGE_IO_PIXEL_TYPE_12)
+        && (nitf->compression & NITF_IMAGE_IO_NO_COMPRESSION);
+
+    /* No plugin */
+    if (!raw && (nitf->decompressor == NULL))
+    {
+        nitf_Error_initf(error, NITF_CTXT,
+                         NITF_ERR_DECOMPRESSION,
+                         "No decompression plugin for compressed type");
+        return NULL;
+    }
 
-    /*      Write column and row padding if required */
+    /*
+     * For blocking mode "S" the block I/O's mask is offset to its band so
+     * the number is relative to the band. Key on the index into the full
+     * block mask
+     */
+    number = (nitf_Uint32) (blockIO->blockMask - nitf->blockMask)
+        + blockIO->number;
 
-    if (blockIO->padColumnCount != 0)
+    nitf_Mutex_lock(&(nitf->lock));
+    if (!nitf_ImageIO_blockCacheAlloc(nitf, error))
     {
-        if (cntl->padBuffer == NULL)
-            if (!nitf_ImageIO_allocatePad(cntl, error))
-                return NITF_FAILURE;
-
-        if (!nitf_ImageIO_writeToBlock(blockIO, io,
-                                       blockIO->blockOffset.mark + 
-                                       blockIO->readCount,
-                                       cntl->padBuffer,
-                                       blockIO->padColumnCount, error))
-            return NITF_FAILURE;
+        nitf_Mutex_unlock(&(nitf->lock));
+        return NULL;
     }
-    
-    if ((blockIO->padRowCount != 0)
-        && (blockIO->currentRow >= (nitf->numRows - 1)))
+
+    entry = cache->lookup[number];
+    if (entry != NULL)
     {
-        size_t writeCount; /* Amount to write each row */
-        size_t offset;     /* Current offset into block buffer */
-        
-        if (cntl->padBuffer == NULL)
-            if (!nitf_ImageIO_allocatePad(cntl, error))
-                return NITF_FAILURE;
-        
-        writeCount = blockIO->readCount + blockIO->padColumnCount;
-        offset = writeCount;
-        
+        cache->hits += 1;
+
+        /* Move to the front of the list */
+
+        if (entry != cache->head)
+        {
+            entry->prev->next = entry->next;
+            if (entry->next != NULL)
+                entry->next->prev = entry->prev;
+            else
+                cache->tail = entry->prev;
+
+            entry->prev = NULL;
+            entry->next = cache->head;
+            cache->head->prev = entry;
+            cache->head = entry;
+        }
+
+        if ((row >= entry->row) && (column >= entry->column)
+                && (row + numRows <= entry->row + entry->numRows)
+                && (column + numColumns
+                    <= entry->column + entry->numColumns))
+        {
+            entry->users += 1;
+            nitf_Mutex_unlock(&(nitf->lock));
+            return entry;
+        }
+
         /*
-         * Because the pad buffer is only one line long, this 
-         * has to be a loop of
-         * smaller writes
+         * A partly decoded block is widened. The new region covers the old
+         * one so the replacement serves the reads the old entry served
          */
-        for (i = 0;i < blockIO->padRowCount;i++)
+
+        if (entry->numRows > 0)
         {
-            if (!nitf_ImageIO_writeToBlock(blockIO, io,
-                                           blockIO->blockOffset.mark + offset,
-                                           cntl->padBuffer, writeCount, error))
-                return NITF_FAILURE;
-            offset += writeCount;
+            if (row + numRows < entry->row + entry->numRows)
+                numRows = entry->row + entry->numRows - row;
+            if (column + numColumns < entry->column + entry->numColumns)
+                numColumns = entry->column + entry->numColumns - column;
+            if (entry->row < row)
+            {
+                numRows += row - entry->row;
+                row = entry->row;
+            }
+            if (entry->column < column)
+            {
+                numColumns += column - entry->column;
+                column = entry->column;
+            }
         }
+        entry = NULL;
     }
+    else
+        cache->misses += 1;
 
-    return NITF_SUCCESS;
-}
+    /* Reuse an evicted buffer if possible */
 
-void nitf_ImageIO_setDefaultParameters(_nitf_ImageIO * object)
-{
-    
-    object->parameters.noCacheThreshold = 0.5;
-    object->parameters.clearCache = 0;;
-    
-    return;
-}
+    if (raw || nitf_ImageIO_decodesInto(nitf))
+        nitf_ImageIO_blockCacheTrim(nitf, nitf->blockSize, &entry);
+    nitf_Mutex_unlock(&(nitf->lock));
 
+    /*
+     * The block is read or decoded into an entry that is not in the cache
+     * yet, without the lock, so reads of other blocks are not held up
+     */
 
-void nitf_ImageIO_unformatExtend_1(nitf_Uint8 * buffer,
-                                   size_t count,
-                                   nitf_Uint32 shiftCount)
-{
-    nitf_Int8 shift;            /* Shift count */
-    nitf_Int8 *bp8;             /* Buffer pointer, 8 bit */
-    nitf_Int16 tmp8;            /* Temp value, 8 bit */
-    size_t i;
-    
-    shift = (nitf_Int8) shiftCount;
-    bp8 = (nitf_Int8 *) buffer;
-    for (i = 0; i < count; i++)
+    if (entry == NULL)
     {
-        tmp8 = *bp8 << shift;
-        *(bp8++) = tmp8 >> shift;
+        entry = (_nitf_ImageIOCachedBlock *)
+            NITF_MALLOC(sizeof(_nitf_ImageIOCachedBlock));
+        if (entry == NULL)
+        {
+            nitf_Error_initf(error, NITF_CTXT, NITF_ERR_MEMORY,
+                             "Error allocating block buffer: %s",
+                             NITF_STRERROR(NITF_ERRNO));
+            return NULL;
+        }
+        entry->block = NULL;
+
+        if (raw || nitf_ImageIO_decodesInto(nitf))
+        {
+            entry->block = (nitf_Uint8 *) NITF_MALLOC(nitf->blockSize);
+            if (entry->block == NULL)
+            {
+                nitf_Error_initf(error, NITF_CTXT, NITF_ERR_MEMORY,
+                                 "Error allocating block buffer: %s",
+                                 NITF_STRERROR(NITF_ERRNO));
+                NITF_FREE(entry);
+                return NULL;
+            }
+        }
     }
-    
-    return;
-}
 
+    entry->number = number;
+    entry->decoded = 0;
+    entry->row = 0;
+    entry->column = 0;
+    entry->numRows = nitf->numRowsPerBlock;
+    entry->numColumns = nitf->numColumnsPerBlock;
+
+    if (raw)
+        ok = nitf_ImageIO_readAt(nitf, io,
+                                 nitf->pixelBase + blockIO->imageDataOffset,
+                                 entry->block, nitf->blockSize, error);
+    else if (nitf_ImageIO_decodesInto(nitf))
+        ok = nitf_ImageIO_decodeCachedRegion(nitf, io, entry,
+                                             blockIO->number, row, column,
+                                             numRows, numColumns, error);
+    else
+    {
+        /* The plugin owns the buffer it returns */
+        entry->decoded = 1;
+        decodeLock = nitf_ImageIO_decodeLock(nitf, io);
+        if (decodeLock != NULL)
+            nitf_Mutex_lock(decodeLock);
+        entry->block = (*(nitf->decompressor->readBlock))
+            (nitf->decompressionControl, blockIO->number, error);
+        if (decodeLock != NULL)
+            nitf_Mutex_unlock(decodeLock);
+        ok = (entry->block != NULL);
+    }
 
-void nitf_ImageIO_unformatExtend_2(nitf_Uint8 * buffer,
-                                   size_t count,
-                                   nitf_Uint32 shiftCount)
-{
-    nitf_Int16 shift;           /* Shift count */
-    nitf_Int16 *bp16;           /* Buffer pointer, 16 bit */
-    nitf_Int16 tmp16;           /* Temp value, 16 bit */
-    size_t i;
-    
-    shift = (nitf_Int16) shiftCount;
-    bp16 = (nitf_Int16 *) buffer;
-    for (i = 0; i < count; i++)
+    if (!ok)
     {
-        tmp16 = *bp16 << shift;
-        *(bp16++) = tmp16 >> shift;
+        if (!(entry->decoded))
+            NITF_FREE(entry->block);
+        NITF_FREE(entry);
+        return NULL;
     }
-    
-    return;
+
+    /* Another read may have cached the block in the mean time */
+
+    nitf_Mutex_lock(&(nitf->lock));
+    old = cache->lookup[number];
+    if (old != NULL)
+        nitf_ImageIO_blockCacheRemove(nitf, old);
+    nitf_ImageIO_blockCacheTrim(nitf, nitf->blockSize, NULL);
+    nitf_ImageIO_blockCacheInsert(nitf, entry);
+    entry->users = 1;
+    nitf_Mutex_unlock(&(nitf->lock));
+
+    return entry;
 }
 
 
-void nitf_ImageIO_unformatExtend_4(nitf_Uint8 * buffer,
-                                   size_t count,
-                                   nitf_Uint32 shiftCount)
+NITFPRIV(NITF_BOOL)
+nitf_ImageIO_decodeCachedRegion(_nitf_ImageIO * nitf,
+                                nitf_IOInterface* io,
+                                _nitf_ImageIOCachedBlock * entry,
+                                nitf_Uint32 blockNumber,
+                                nitf_Uint32 row,
+                                nitf_Uint32 column,
+                                nitf_Uint32 numRows,
+                                nitf_Uint32 numColumns,
+                                nitf_Error * error)
 {
-    nitf_Int32 shift;           /* Shift count */
-    nitf_Int32 *bp32;           /* Buffer pointer, 32 bit */
-    nitf_Int32 tmp32;           /* Temp value, 32 bit */
-    size_t i;
-    
-    shift = (nitf_Int32) shiftCount;
-    bp32 = (nitf_Int32 *) buffer;
-    for (i = 0; i < count; i++)
-    {
-        tmp32 = *bp32 << shift;
-        *(bp32++) = tmp32 >> shift;
-    }
-    
-    return;
-}
+    NITF_BOOL ok;               /* Decode succeeded */
+    nitf_Mutex *decodeLock;     /* Serializes the decompressor */
 
+    decodeLock = nitf_ImageIO_decodeLock(nitf, io);
+    if (decodeLock != NULL)
+        nitf_Mutex_lock(decodeLock);
+    ok = nitf_ImageIO_decodeRegion(nitf, blockNumber, row, column, numRows,
+                                   numColumns, entry->block, error);
+    if (decodeLock != NULL)
+        nitf_Mutex_unlock(decodeLock);
 
-/* Uses 64 bit types */
+    if (!ok)
+        return NITF_FAILURE;
 
-void nitf_ImageIO_unformatExtend_8(nitf_Uint8 * buffer,
-                                   size_t count,
-                                   nitf_Uint32 shiftCount)
-{
-    nitf_Int64 shift;           /* Shift count */
-    nitf_Int64 *bp64;           /* Buffer pointer, 64 bit */
-    nitf_Int64 tmp64;           /* Temp value, 64 bit */
-    size_t i;
-    
-    shift = (nitf_Int64) shiftCount;
-    bp64 = (nitf_Int64 *) buffer;
-    for (i = 0; i < count; i++)
-    {
-        tmp64 = *bp64 << shift;
-        *(bp64++) = tmp64 >> shift;
-    }
-    
-    return;
+    entry->row = row;
+    entry->column = column;
+    entry->numRows = numRows;
+    entry->numColumns = numColumns;
+    return NITF_SUCCESS;
 }
 
 
-/*========================= nitf_ImageIO_unformatShift_* =====================*/
-
-void nitf_ImageIO_unformatShift_1(nitf_Uint8 * buffer,
-                                  size_t count,
-                                  nitf_Uint32 shiftCount)
+NITFPRIV(nitf_Mutex *) nitf_ImageIO_decodeLock(_nitf_ImageIO * nitf,
+                                               nitf_IOInterface* io)
 {
-    nitf_Int8 shift;            /* Shift count */
-    nitf_Int8 *bp8;             /* Buffer pointer, 8 bit */
-    size_t i;
-    
-    shift = (nitf_Int8) shiftCount;
-    bp8 = (nitf_Int8 *) buffer;
-    for (i = 0; i < count; i++)
-        *(bp8++) >>= shift;
-    
-    return;
+    if ((nitf->decompressor->flags & NITF_DECOMPRESSION_CONCURRENT_READ_BLOCK)
+            && nitf_IOInterface_canReadAt(io))
+        return NULL;
+
+    /* Views decode through their parent's control */
+    if (nitf->parent != NULL)
+        return &(nitf->parent->ioLock);
+    return &(nitf->ioLock);
 }
 
 
-void nitf_ImageIO_unformatShift_2(nitf_Uint8 * buffer,
-                                  size_t count,
-                                  nitf_Uint32 shiftCount)
+NITFPRIV(void) nitf_ImageIO_blockCacheRemove(_nitf_ImageIO * nitf,
+                                             _nitf_ImageIOCachedBlock * entry)
 {
-    nitf_Int16 shift;           /* Shift count */
-    nitf_Int16 *bp16;           /* Buffer pointer, 16 bit */
-    size_t i;
-    
-    shift = (nitf_Int16) shiftCount;
-    bp16 = (nitf_Int16 *) buffer;
-    for (i = 0; i < count; i++)
-        *(bp16++) >>= shift;
-    
+    nitf_Error error;           /* For decompressor free block call */
+
+    nitf_ImageIO_blockCacheUnlink(nitf, entry);
+
+    /* An entry in use is freed by its last release */
+    entry->stale = 1;
+    if (entry->users > 0)
+        return;
+
+    if (entry->decoded)
+        (*(nitf->decompressor->freeBlock)) (nitf->decompressionControl,
+                                            entry->block, &error);
+    else
+        NITF_FREE(entry->block);
+    NITF_FREE(entry);
     return;
 }
 
 
-void nitf_ImageIO_unformatShift_4(nitf_Uint8 * buffer,
-                                  size_t count,
-                                  nitf_Uint32 shiftCount)
+NITFPRIV(void) nitf_ImageIO_blockCacheUnlink(_nitf_ImageIO * nitf,
+                                             _nitf_ImageIOCachedBlock * entry)
 {
-    nitf_Int32 shift;           /* Shift count */
-    nitf_Int32 *bp32;           /* Buffer pointer, 32 bit */
-    size_t i;
-    
-    shift = (nitf_Int32) shiftCount;
-    bp32 = (nitf_Int32 *) buffer;
-    for (i = 0; i < count; i++)
-        *(bp32++) >>= shift;
-    
-    return;
-}
+    _nitf_ImageIOBlockCache *cache;  /* The block cache */
 
+    cache = &(nitf->blockCache);
 
-/* Uses 64 bit types */
+    if (entry->prev != NULL)
+        entry->prev->next = entry->next;
+    else
+        cache->head = entry->next;
+    if (entry->next != NULL)
+        entry->next->prev = entry->prev;
+    else
+        cache->tail = entry->prev;
 
-void nitf_ImageIO_unformatShift_8(nitf_Uint8 * buffer,
-                                  size_t count,
-                                  nitf_Uint32 shiftCount)
-{
-    nitf_Int64 shift;           /* Shift count */
-    nitf_Int64 *bp64;           /* Buffer pointer, 64 bit */
-    size_t i;
-    
-    shift = (nitf_Int64) shiftCount;
-    bp64 = (nitf_Int64 *) buffer;
-    for (i = 0; i < count; i++)
-        *(bp64++) >>= shift;
-    
+    cache->lookup[entry->number] = NULL;
+    cache->usedBytes -= nitf->blockSize;
     return;
 }
 
-void nitf_ImageIO_unformatUShift_1(nitf_Uint8 * buffer,
-                                   size_t count,
-                                   nitf_Uint32 shiftCount)
+
+NITFPRIV(void) nitf_ImageIO_blockCacheRelease(_nitf_ImageIO * nitf,
+                                              _nitf_ImageIOCachedBlock * entry)
 {
-    nitf_Uint8 shift;           /* Shift count */
-    nitf_Uint8 *bp8;            /* Buffer pointer, 8 bit */
-    size_t i;
-    
-    shift = (nitf_Uint8) shiftCount;
-    bp8 = (nitf_Uint8 *) buffer;
-    for (i = 0; i < count; i++)
-        *(bp8++) >>= shift;
-    
+    nitf_Error error;           /* For decompressor free block call */
+
+    entry->users -= 1;
+    if (!(entry->stale) || (entry->users > 0))
+        return;
+
+    if (entry->decoded)
+        (*(nitf->decompressor->freeBlock)) (nitf->decompressionControl,
+                                            entry->block, &error);
+    else
+        NITF_FREE(entry->block);
+    NITF_FREE(entry);
     return;
 }
 
 
-void nitf_ImageIO_unformatUShift_2(nitf_Uint8 * buffer,
-                                   size_t count,
-                                   nitf_Uint32 shiftCount)
+NITFPRIV(void) nitf_ImageIO_blockCacheTrim(_nitf_ImageIO * nitf,
+                                           size_t needed,
+                                           _nitf_ImageIOCachedBlock ** reuse)
 {
-    nitf_Uint16 shift;          /* Shift count */
-    nitf_Uint16 *bp16;          /* Buffer pointer, 16 bit */
-    size_t i;
-    
-    shift = (nitf_Uint16) shiftCount;
-    bp16 = (nitf_Uint16 *) buffer;
-    for (i = 0; i < count; i++)
-        *(bp16++) >>= shift;
-    
+    _nitf_ImageIOBlockCache *cache;  /* The block cache */
+    _nitf_ImageIOCachedBlock *victim; /* Entry being evicted */
+    size_t budget;                   /* Effective byte budget */
+
+    cache = &(nitf->blockCache);
+    if (reuse != NULL)
+        *reuse = NULL;
+
+    /* Always allow one block */
+    budget = cache->maxBytes;
+    if (budget < nitf->blockSize)
+        budget = nitf->blockSize;
+
+    while ((cache->tail != NULL) && (cache->usedBytes + needed > budget))
+    {
+        victim = cache->tail;
+
+        if ((reuse != NULL) && (*reuse == NULL) && !(victim->decoded)
+                && (victim->users == 0))
+        {
+            nitf_ImageIO_blockCacheUnlink(nitf, victim);
+            *reuse = victim;
+            continue;
+        }
+
+        nitf_ImageIO_blockCacheRemove(nitf, victim);
+    }
+
     return;
 }
 
 
-void nitf_ImageIO_unformatUShift_4(nitf_Uint8 * buffer,
-                                   size_t count,
-                                   nitf_Uint32 shiftCount)
+NITFPRIV(NITF_BOOL) nitf_ImageIO_decodesInto(_nitf_ImageIO * nitf)
 {
-    nitf_Uint32 shift;          /* Shift count */
-    nitf_Uint32 *bp32;          /* Buffer pointer, 32 bit */
-    size_t i;
-    
-    shift = (nitf_Uint32) shiftCount;
-    bp32 = (nitf_Uint32 *) buffer;
-    for (i = 0; i < count; i++)
-        *(bp32++) >>= shift;
-    
-    return;
+    nitf_DecompressionInterface *iface; /* Decompression interface */
+
+    iface = nitf->decompressor;
+    return (iface != NULL)
+        && (iface->flags & NITF_DECOMPRESSION_READ_BLOCK_INTO)
+        && (iface->readBlockInto != NULL);
 }
 
 
-/* Uses 64 bit types */
-void nitf_ImageIO_unformatUShift_8(nitf_Uint8 * buffer,
-                                   size_t count,
-                                   nitf_Uint32 shiftCount)
+NITFPRIV(NITF_BOOL) nitf_ImageIO_decodeInto(_nitf_ImageIO * nitf,
+                                            nitf_Uint32 blockNumber,
+                                            nitf_Uint8 * buffer,
+                                            nitf_Error * error)
 {
-    nitf_Uint64 shift;          /* Shift count */
-    nitf_Uint64 *bp64;          /* Buffer pointer, 64 bit */
-    size_t i;
-    
-    shift = (nitf_Uint64) shiftCount;
-    bp64 = (nitf_Uint64 *) buffer;
-    for (i = 0; i < count; i++)
-        *(bp64++) >>= shift;
-    
-    return;
+    if (nitf->discardLevels > 0)
+        return (*(nitf->decompressor->readBlockReduced))
+            (nitf->decompressionControl, blockNumber, nitf->discardLevels,
+             buffer, nitf->blockSize, error);
+
+    return (*(nitf->decompressor->readBlockInto))
+        (nitf->decompressionControl, blockNumber, buffer, nitf->blockSize,
+         error);
 }
 
-void nitf_ImageIO_swapOnly_2(nitf_Uint8 * buffer,
-        size_t count, nitf_Uint32 shiftCount)
+
+NITFPRIV(void) nitf_ImageIO_blockRegion(_nitf_ImageIOControl * cntl,
+                                        nitf_Uint32 blockNumber,
+                                        nitf_Uint32 * row,
+                                        nitf_Uint32 * column,
+                                        nitf_Uint32 * numRows,
+                                        nitf_Uint32 * numColumns)
 {
-    nitf_Uint8 *bp8;            /* Buffer pointer, 8 bit */
-    nitf_Uint16 *bp16;          /* Buffer pointer, 16 bit */
-    nitf_Uint8 tmp8;            /* Temp value, 8 bit */
-    size_t i;
-    
-    /* Silence compiler warnings about unused variables */
-    (void)shiftCount;
+    _nitf_ImageIO *nitf;        /* Associated ImageIO object */
+    nitf_DecompressionInterface *iface; /* Decompression interface */
+    nitf_Uint64 blockRow;       /* Block's first row in the image */
+    nitf_Uint64 blockColumn;    /* Block's first column in the image */
+    nitf_Uint64 start;          /* Start of the request in the block */
+    nitf_Uint64 end;            /* End of the request in the block */
 
-    bp16 = (nitf_Uint16 *) buffer;
-    for (i = 0; i < count; i++)
+    nitf = cntl->nitf;
+    iface = nitf->decompressor;
+
+    *row = 0;
+    *column = 0;
+    *numRows = nitf->numRowsPerBlock;
+    *numColumns = nitf->numColumnsPerBlock;
+
+    if (!nitf_ImageIO_decodesInto(nitf) || (nitf->discardLevels > 0)
+            || !(iface->flags & NITF_DECOMPRESSION_READ_BLOCK_REGION)
+            || (iface->readBlockRegion == NULL))
+        return;
+
+    /* Blocking mode "S" numbers continue through the bands */
+
+    blockRow = (nitf_Uint64) ((blockNumber / nitf->nBlocksPerRow)
+                              % nitf->nBlocksPerColumn)
+        * nitf->numRowsPerBlock;
+    blockColumn = (nitf_Uint64) (blockNumber % nitf->nBlocksPerRow)
+        * nitf->numColumnsPerBlock;
+
+    /* The request is at down-sampled resolution */
+
+    start = (cntl->row > blockRow) ? cntl->row : blockRow;
+    end = (nitf_Uint64) cntl->row
+        + ((nitf_Uint64) cntl->numRows) * cntl->rowSkip;
+    if (end > blockRow + nitf->numRowsPerBlock)
+        end = blockRow + nitf->numRowsPerBlock;
+    if (end > start)
     {
-        bp8 = (nitf_Uint8 *) bp16++;
-        tmp8 = bp8[0];
-        bp8[0] = bp8[1];
-        bp8[1] = tmp8;
+        *row = (nitf_Uint32) (start - blockRow);
+        *numRows = (nitf_Uint32) (end - start);
     }
-    
+
+    start = (cntl->column > blockColumn) ? cntl->column : blockColumn;
+    end = (nitf_Uint64) cntl->column
+        + ((nitf_Uint64) cntl->numColumns) * cntl->columnSkip;
+    if (end > blockColumn + nitf->numColumnsPerBlock)
+        end = blockColumn + nitf->numColumnsPerBlock;
+    if (end > start)
+    {
+        *column = (nitf_Uint32) (start - blockColumn);
+        *numColumns = (nitf_Uint32) (end - start);
+    }
+
     return;
 }
 
 
-void nitf_ImageIO_swapOnly_4(nitf_Uint8 * buffer,
-        size_t count, nitf_Uint32 shiftCount)
+NITFPRIV(NITF_BOOL) nitf_ImageIO_decodeRegion(_nitf_ImageIO * nitf,
+                                              nitf_Uint32 blockNumber,
+                                              nitf_Uint32 row,
+                                              nitf_Uint32 column,
+                                              nitf_Uint32 numRows,
+                                              nitf_Uint32 numColumns,
+                                              nitf_Uint8 * buffer,
+                                              nitf_Error * error)
 {
-    nitf_Uint8 *bp8;            /* Buffer pointer, 8 bit */
-    nitf_Uint32 *bp32;          /* Buffer pointer, 32 bit */
-    nitf_Uint8 tmp8;            /* Temp value, 8 bit */
-    size_t i;
-    
-    /* Silence compiler warnings about unused variables */
+    if ((row == 0) && (column == 0) && (numRows == nitf->numRowsPerBlock)
+            && (numColumns == nitf->numColumnsPerBlock))
+        return nitf_ImageIO_decodeInto(nitf, blockNumber, buffer, error);
+
+    return (*(nitf->decompressor->readBlockRegion))
+        (nitf->decompressionControl, blockNumber, row, column, numRows,
+         numColumns, buffer, nitf->blockSize, error);
+}
+
+
+NITFPRIV(void) nitf_ImageIO_freeDecoded(_nitf_ImageIO * nitf,
+                                        nitf_Uint8 * block)
+{
+    nitf_Error error;           /* For decompressor free block call */
+
+    /* Blocks read without a decompressor are library buffers too */
+    if ((nitf->decompressor == NULL) || nitf_ImageIO_decodesInto(nitf))
+        NITF_FREE(block);
+    else
+        (*(nitf->decompressor->freeBlock)) (nitf->decompressionControl,
+                                            block, &error);
+    return;
+}
+
+
+NITFPRIV(void) nitf_ImageIO_blockCacheClear(_nitf_ImageIO * nitf)
+{
+    _nitf_ImageIOBlockCache *cache;  /* The block cache */
+    size_t saved;                    /* Saved budget */
+
+    cache = &(nitf->blockCache);
+
+    /* Asking for more than the minimum budget evicts everything */
+    saved = cache->maxBytes;
+    cache->maxBytes = 0;
+    nitf_ImageIO_blockCacheTrim(nitf, nitf->blockSize + 1, NULL);
+    cache->maxBytes = saved;
+
+    if (cache->lookup != NULL)
+    {
+        NITF_FREE(cache->lookup);
+        cache->lookup = NULL;
+    }
+
+    return;
+}
+
+
+NITFPRIV(int) nitf_ImageIO_blockCacheAlloc(_nitf_ImageIO * nitf,
+                                           nitf_Error * error)
+{
+    _nitf_ImageIOBlockCache *cache;  /* The block cache */
+
+    cache = &(nitf->blockCache);
+    if (cache->lookup != NULL)
+        return NITF_SUCCESS;
+
+    cache->lookup = (_nitf_ImageIOCachedBlock **)
+        NITF_MALLOC(nitf->nBlocksTotal * sizeof(_nitf_ImageIOCachedBlock *));
+    if (cache->lookup == NULL)
+    {
+        nitf_Error_initf(error, NITF_CTXT, NITF_ERR_MEMORY,
+                         "Error allocating block cache: %s",
+                         NITF_STRERROR(NITF_ERRNO));
+        return NITF_FAILURE;
+    }
+    memset(cache->lookup, 0,
+           nitf->nBlocksTotal * sizeof(_nitf_ImageIOCachedBlock *));
+
+    return NITF_SUCCESS;
+}
+
+
+NITFPRIV(void) nitf_ImageIO_blockCacheInsert(_nitf_ImageIO * nitf,
+                                             _nitf_ImageIOCachedBlock * entry)
+{
+    _nitf_ImageIOBlockCache *cache;  /* The block cache */
+
+    cache = &(nitf->blockCache);
+
+    /* Insert at the front of the list */
+
+    entry->prev = NULL;
+    entry->next = cache->head;
+    if (cache->head != NULL)
+        cache->head->prev = entry;
+    else
+        cache->tail = entry;
+    cache->head = entry;
+    cache->lookup[entry->number] = entry;
+    cache->usedBytes += nitf->blockSize;
+    entry->users = 0;
+    entry->stale = 0;
+
+    return;
+}
+
+
+NITFPRIV(void) nitf_ImageIO_waitForReads(_nitf_ImageIO * nitf)
+{
+    nitf_Mutex_unlock(&(nitf->lock));
+#ifdef WIN32
+    Sleep(0);
+#else
+    sched_yield();
+#endif
+    nitf_Mutex_lock(&(nitf->lock));
+    return;
+}
+
+
+NITFPRIV(int) nitf_ImageIO_findBlocks(_nitf_ImageIOControl * cntl,
+                                      nitf_Uint32 minBatch,
+                                      _nitf_ImageIODecodedBlock ** blocksOut,
+                                      nitf_Uint32 * countOut,
+                                      nitf_Error * error)
+{
+    _nitf_ImageIO *nitf;        /* Associated ImageIO object */
+    _nitf_ImageIOBlockCache *cache;     /* The block cache */
+    _nitf_ImageIODecodedBlock *blocks;  /* Blocks to fetch */
+    nitf_Uint64 endRow;         /* Last row plus one, full resolution */
+    nitf_Uint64 endColumn;      /* Last column plus one, full resolution */
+    nitf_Uint32 startBlockRow;  /* First block row */
+    nitf_Uint32 endBlockRow;    /* Last block row */
+    nitf_Uint32 startBlockCol;  /* First block column */
+    nitf_Uint32 endBlockCol;    /* Last block column */
+    nitf_Uint32 bandCount;      /* Number of band planes in the mask */
+    nitf_Uint32 bandOffset;     /* Band offset into the block mask */
+    nitf_Uint32 maxBlocks;      /* Upper bound on the number of blocks */
+    nitf_Uint32 batchSize;      /* Number of blocks in a batch */
+    nitf_Uint32 count;          /* Number of blocks to fetch */
+    nitf_Uint32 number;         /* Block number, all bands */
+    nitf_Uint32 bandIdx;        /* Current band index */
+    nitf_Uint32 row;            /* Current block row */
+    nitf_Uint32 col;            /* Current block column */
+
+    nitf = cntl->nitf;
+    *blocksOut = NULL;
+    *countOut = 0;
+
+    /*
+     * Find the blocks the request touches. The request is at down-sampled
+     * resolution and the last neighborhood may extend past the image
+     */
+
+    endRow = (nitf_Uint64) cntl->row
+        + ((nitf_Uint64) cntl->numRows) * cntl->rowSkip;
+    if (endRow > nitf->numRowsActual)
+        endRow = nitf->numRowsActual;
+    endColumn = (nitf_Uint64) cntl->column
+        + ((nitf_Uint64) cntl->numColumns) * cntl->columnSkip;
+    if (endColumn > nitf->numColumnsActual)
+        endColumn = nitf->numColumnsActual;
+
+    startBlockRow = cntl->row / nitf->numRowsPerBlock;
+    endBlockRow = (nitf_Uint32) ((endRow - 1) / nitf->numRowsPerBlock);
+    startBlockCol = cntl->column / nitf->numColumnsPerBlock;
+    endBlockCol = (nitf_Uint32) ((endColumn - 1) / nitf->numColumnsPerBlock);
+
+    /* Blocking mode "S" has a separate set of blocks for each band */
+    if (nitf->blockingMode == NITF_IMAGE_IO_BLOCKING_MODE_S)
+        bandCount = cntl->numBandSubset;
+    else
+        bandCount = 1;
+
+    maxBlocks = bandCount * (endBlockRow - startBlockRow + 1)
+        * (endBlockCol - startBlockCol + 1);
+    if (maxBlocks < 2)
+        return NITF_SUCCESS;
+
+    blocks = (_nitf_ImageIODecodedBlock *)
+        NITF_MALLOC(maxBlocks * sizeof(_nitf_ImageIODecodedBlock));
+    if (blocks == NULL)
+    {
+        nitf_Error_initf(error, NITF_CTXT, NITF_ERR_MEMORY,
+                         "Error allocating decode list: %s",
+                         NITF_STRERROR(NITF_ERRNO));
+        return NITF_FAILURE;
+    }
+
+    /* Skip pad blocks and blocks that are already cached */
+
+    cache = &(nitf->blockCache);
+    count = 0;
+    nitf_Mutex_lock(&(nitf->lock));
+    batchSize = (nitf_Uint32) (cache->maxBytes / nitf->blockSize / 2);
+    if (batchSize < minBatch)
+        batchSize = minBatch;
+
+    for (row = startBlockRow; row <= endBlockRow; row++)
+        for (bandIdx = 0; bandIdx < bandCount; bandIdx++)
+        {
+            if (nitf->blockingMode == NITF_IMAGE_IO_BLOCKING_MODE_S)
+                bandOffset = cntl->bandSubset[bandIdx]
+                    * nitf->nBlocksPerRow * nitf->nBlocksPerColumn;
+            else
+                bandOffset = 0;
+
+            for (col = startBlockCol; col <= endBlockCol; col++)
+            {
+                number = bandOffset + row * nitf->nBlocksPerRow + col;
+                if (nitf->blockMask[number] == NITF_IMAGE_IO_NO_OFFSET)
+                    continue;
+                if ((cache->lookup != NULL) && (cache->lookup[number] != NULL))
+                    continue;
+
+                blocks[count].number = number;
+                blocks[count].blockNumber = number - bandOffset;
+                blocks[count].block = NULL;
+                blocks[count].batch = count / batchSize;
+                nitf_ImageIO_blockRegion(cntl, blocks[count].blockNumber,
+                                         &(blocks[count].row),
+                                         &(blocks[count].column),
+                                         &(blocks[count].numRows),
+                                         &(blocks[count].numColumns));
+                count += 1;
+            }
+        }
+    /* A single block is left to the reader */
+    if (count > 1)
+        cache->misses += count;
+    nitf_Mutex_unlock(&(nitf->lock));
+
+    if (count < 2)
+    {
+        NITF_FREE(blocks);
+        return NITF_SUCCESS;
+    }
+
+    qsort(blocks, count, sizeof(_nitf_ImageIODecodedBlock),
+          nitf_ImageIO_compareDecoded);
+
+    *blocksOut = blocks;
+    *countOut = count;
+    return NITF_SUCCESS;
+}
+
+
+NITFPRIV(int) nitf_ImageIO_decodeBlocks(_nitf_ImageIOControl * cntl,
+                                        nitf_IOInterface* io,
+                                        nitf_Error * error)
+{
+    _nitf_ImageIO *nitf;        /* Associated ImageIO object */
+    nitf_DecompressionInterface *iface; /* Decompression interface */
+    _nitf_ImageIODecodedBlock *blocks;  /* Blocks to decode */
+    nitf_Uint32 nThreads;       /* Number of decode threads */
+    nitf_Uint32 count;          /* Number of blocks to decode */
+
+    nitf = cntl->nitf;
+    iface = nitf->decompressor;
+
+    nitf_Mutex_lock(&(nitf->lock));
+    nThreads = nitf->decodeThreads;
+    nitf_Mutex_unlock(&(nitf->lock));
+
+    if ((nThreads < 2) || (iface == NULL)
+        || !(iface->flags & NITF_DECOMPRESSION_CONCURRENT_READ_BLOCK)
+        || (nitf->vtbl.reader != nitf_ImageIO_cachedReader)
+        || !nitf_IOInterface_canReadAt(io))
+        return NITF_SUCCESS;
+
+    if ((nitf->pixel.type != NITF_IMAGE_IO_PIXEL_TYPE_B)
+          && (nitf->pixel.type != NITF_IMAGE_IO_PIXEL_TYPE_12)
+             && (nitf->compression & NITF_IMAGE_IO_NO_COMPRESSION))
+        return NITF_SUCCESS;
+
+    /* A batch keeps all of the threads busy */
+    if (!nitf_ImageIO_findBlocks(cntl, nThreads, &blocks, &count, error))
+        return NITF_FAILURE;
+    if (blocks == NULL)
+        return NITF_SUCCESS;
+
+    cntl->decoded = blocks;
+    cntl->nDecoded = count;
+    cntl->batchReads = 0;
+    return nitf_ImageIO_fetchBatch(cntl, io, 0, error);
+}
+
+
+NITFPRIV(int) nitf_ImageIO_readBlocksBatch(_nitf_ImageIOControl * cntl,
+                                           nitf_IOInterface* io,
+                                           nitf_Error * error)
+{
+    _nitf_ImageIO *nitf;        /* Associated ImageIO object */
+    _nitf_ImageIODecodedBlock *blocks;  /* Blocks to read */
+    nitf_Off mapSize;           /* Size of a memory mapped file */
+    nitf_Uint32 count;          /* Number of blocks to read */
+    nitf_Uint32 i;
+
+    nitf = cntl->nitf;
+
+    if ((cntl->decoded != NULL)
+        || (nitf->vtbl.reader != nitf_ImageIO_cachedReader)
+        || !nitf_IOInterface_canReadBatch(io)
+        || (nitf_IOInterface_getMapping(io, &mapSize) != NULL))
+        return NITF_SUCCESS;
+
+    if ((nitf->pixel.type == NITF_IMAGE_IO_PIXEL_TYPE_B)
+          || (nitf->pixel.type == NITF_IMAGE_IO_PIXEL_TYPE_12)
+             || !(nitf->compression & NITF_IMAGE_IO_NO_COMPRESSION))
+        return NITF_SUCCESS;
+
+    if (!nitf_ImageIO_findBlocks(cntl, 2, &blocks, &count, error))
+        return NITF_FAILURE;
+    if (blocks == NULL)
+        return NITF_SUCCESS;
+
+    /* The whole block is read, as the cached reader would */
+    for (i = 0; i < count; i++)
+    {
+        blocks[i].row = 0;
+        blocks[i].column = 0;
+        blocks[i].numRows = nitf->numRowsPerBlock;
+        blocks[i].numColumns = nitf->numColumnsPerBlock;
+    }
+
+    cntl->decoded = blocks;
+    cntl->nDecoded = count;
+    cntl->batchReads = 1;
+    return nitf_ImageIO_fetchBatch(cntl, io, 0, error);
+}
+
+
+NITFPRIV(int) nitf_ImageIO_fetchBatch(_nitf_ImageIOControl * cntl,
+                                      nitf_IOInterface* io,
+                                      nitf_Uint32 batch,
+                                      nitf_Error * error)
+{
+    _nitf_ImageIO *nitf;        /* Associated ImageIO object */
+    nitf_Uint32 count;          /* Number of blocks in the batch */
+    nitf_Uint32 i;
+
+    nitf = cntl->nitf;
+    nitf_ImageIO_releaseDecoded(cntl);
+
+    count = 0;
+    for (i = 0; i < cntl->nDecoded; i++)
+        if (cntl->decoded[i].batch == batch)
+            count += 1;
+
+    nitf_Mutex_lock(&(nitf->lock));
+    nitf_ImageIO_blockCacheTrim(nitf, count * nitf->blockSize, NULL);
+    nitf_Mutex_unlock(&(nitf->lock));
+
+    cntl->batch = batch;
+    if (cntl->batchReads)
+        return nitf_ImageIO_readBlockBatch(cntl, io, error);
+    return nitf_ImageIO_decodeBatch(cntl, error);
+}
+
+
+NITFPRIV(int) nitf_ImageIO_decodeBatch(_nitf_ImageIOControl * cntl,
+                                       nitf_Error * error)
+{
+    _nitf_ImageIO *nitf;        /* Associated ImageIO object */
+    _nitf_ImageIODecodedBlock *blocks;  /* Blocks to decode */
+    _nitf_ImageIODecodeWork work;       /* Shared decode state */
+    nitf_Thread *threads;       /* Decode threads */
+    nitf_Error threadError;     /* Thread creation error, not reported */
+    nitf_Uint32 nThreads;       /* Number of threads to start */
+    nitf_Uint32 nStarted;       /* Number of threads started */
+    nitf_Uint32 count;          /* Number of blocks in the batch */
+    nitf_Uint32 i;
+
+    nitf = cntl->nitf;
+    blocks = cntl->decoded;
+
+    nitf_Mutex_lock(&(nitf->lock));
+    nThreads = nitf->decodeThreads;
+    nitf_Mutex_unlock(&(nitf->lock));
+
+    count = 0;
+    for (i = 0; i < cntl->nDecoded; i++)
+        if (blocks[i].batch == cntl->batch)
+            count += 1;
+
+    /* Decode, this thread does its share of the work */
+
+    work.nitf = nitf;
+    work.blocks = blocks;
+    work.count = cntl->nDecoded;
+    work.batch = cntl->batch;
+    work.next = 0;
+    work.failed = 0;
+    nitf_Mutex_init(&(work.lock));
+
+    if (nThreads > count)
+        nThreads = count;
+    nThreads -= 1;
+
+    nStarted = 0;
+    threads = (nitf_Thread *) NITF_MALLOC(nThreads * sizeof(nitf_Thread));
+    if (threads != NULL)
+    {
+        /* If a thread cannot be started, make do with the ones that were */
+        while ((nStarted < nThreads)
+               && nitf_Thread_create(&(threads[nStarted]),
+                                     nitf_ImageIO_decodeWorker, &work,
+                                     &threadError))
+            nStarted += 1;
+    }
+
+    nitf_ImageIO_decodeWorker(&work);
+
+    for (i = 0; i < nStarted; i++)
+        nitf_Thread_join(&(threads[i]));
+    if (threads != NULL)
+        NITF_FREE(threads);
+    nitf_Mutex_delete(&(work.lock));
+
+    if (work.failed)
+    {
+        *error = work.error;
+        for (i = 0; i < cntl->nDecoded; i++)
+            if (blocks[i].block != NULL)
+            {
+                nitf_ImageIO_freeDecoded(nitf, blocks[i].block);
+                blocks[i].block = NULL;
+            }
+        return NITF_FAILURE;
+    }
+
+    return NITF_SUCCESS;
+}
+
+
+NITFPRIV(int) nitf_ImageIO_readBlockBatch(_nitf_ImageIOControl * cntl,
+                                          nitf_IOInterface* io,
+                                          nitf_Error * error)
+{
+    _nitf_ImageIO *nitf;        /* Associated ImageIO object */
+    _nitf_ImageIODecodedBlock *blocks;  /* Blocks to read */
+    nitf_IORequest *requests;   /* One read per block */
+    nitf_IOVec *vec;            /* The block buffers */
+    nitf_Uint32 count;          /* Number of blocks in the batch */
+    nitf_Uint32 allocated;      /* Number of block buffers allocated */
+    nitf_Uint32 i;
+
+    nitf = cntl->nitf;
+    blocks = cntl->decoded;
+
+    count = 0;
+    for (i = 0; i < cntl->nDecoded; i++)
+        if (blocks[i].batch == cntl->batch)
+            count += 1;
+
+    allocated = 0;
+    requests = (nitf_IORequest *) NITF_MALLOC(count * sizeof(nitf_IORequest));
+    vec = (nitf_IOVec *) NITF_MALLOC(count * sizeof(nitf_IOVec));
+    if ((requests == NULL) || (vec == NULL))
+    {
+        nitf_Error_initf(error, NITF_CTXT, NITF_ERR_MEMORY,
+                         "Error allocating block reads: %s",
+                         NITF_STRERROR(NITF_ERRNO));
+        goto CATCH_ERROR;
+    }
+
+    for (i = 0; i < cntl->nDecoded; i++)
+    {
+        if (blocks[i].batch != cntl->batch)
+            continue;
+
+        vec[allocated].size = nitf->blockSize;
+        vec[allocated].buf = (char *) NITF_MALLOC(nitf->blockSize);
+        if (vec[allocated].buf == NULL)
+        {
+            nitf_Error_initf(error, NITF_CTXT, NITF_ERR_MEMORY,
+                             "Error allocating block buffer: %s",
+                             NITF_STRERROR(NITF_ERRNO));
+            goto CATCH_ERROR;
+        }
+
+        requests[allocated].offset =
+            (nitf_Off) (nitf->pixelBase + nitf->blockMask[blocks[i].number]);
+        requests[allocated].vec = &(vec[allocated]);
+        requests[allocated].count = 1;
+        requests[allocated].user = &(blocks[i]);
+        allocated += 1;
+    }
+
+    if (!nitf_IOInterface_readBatch(io, requests, (int) count,
+                                    nitf_ImageIO_blockReadDone, NULL, error))
+        goto CATCH_ERROR;
+
+    NITF_FREE(requests);
+    NITF_FREE(vec);
+    return NITF_SUCCESS;
+
+CATCH_ERROR:
+    /* Completed blocks share their buffers with vec */
+    for (i = 0; i < allocated; i++)
+    {
+        ((_nitf_ImageIODecodedBlock *) requests[i].user)->block = NULL;
+        NITF_FREE(vec[i].buf);
+    }
+    if (requests != NULL)
+        NITF_FREE(requests);
+    if (vec != NULL)
+        NITF_FREE(vec);
+    return NITF_FAILURE;
+}
+
+
+NITFPRIV(NITF_BOOL) nitf_ImageIO_blockReadDone(void *arg,
+                                               nitf_IORequest * request,
+                                               nitf_Error * error)
+{
+    _nitf_ImageIODecodedBlock *block;   /* The block that was read */
+
+    (void) arg;
+    (void) error;
+
+    block = (_nitf_ImageIODecodedBlock *) request->user;
+    block->block = (nitf_Uint8 *) request->vec[0].buf;
+    return NITF_SUCCESS;
+}
+
+
+NITFPRIV(void) nitf_ImageIO_decodeWorker(void *data)
+{
+    _nitf_ImageIODecodeWork *work;      /* Shared decode state */
+    _nitf_ImageIO *nitf;                /* Associated ImageIO object */
+    _nitf_ImageIODecodedBlock *decoded; /* Current block */
+    nitf_Error error;                   /* Error for this block */
+
+    work = (_nitf_ImageIODecodeWork *) data;
+    nitf = work->nitf;
+
+    for (;;)
+    {
+        nitf_Mutex_lock(&(work->lock));
+        while ((work->next < work->count)
+               && (work->blocks[work->next].batch != work->batch))
+            work->next += 1;
+        if (work->failed || (work->next >= work->count))
+        {
+            nitf_Mutex_unlock(&(work->lock));
+            break;
+        }
+        decoded = &(work->blocks[work->next]);
+        work->next += 1;
+        nitf_Mutex_unlock(&(work->lock));
+
+        if (nitf_ImageIO_decodesInto(nitf))
+        {
+            decoded->block = (nitf_Uint8 *) NITF_MALLOC(nitf->blockSize);
+            if (decoded->block == NULL)
+                nitf_Error_initf(&error, NITF_CTXT, NITF_ERR_MEMORY,
+                                 "Error allocating block buffer: %s",
+                                 NITF_STRERROR(NITF_ERRNO));
+            else if (!nitf_ImageIO_decodeRegion(nitf, decoded->blockNumber,
+                                                decoded->row,
+                                                decoded->column,
+                                                decoded->numRows,
+                                                decoded->numColumns,
+                                                decoded->block, &error))
+            {
+                NITF_FREE(decoded->block);
+                decoded->block = NULL;
+            }
+        }
+        else
+            decoded->block =
+                (*(nitf->decompressor->readBlock))
+                (nitf->decompressionControl, decoded->blockNumber, &error);
+        if (decoded->block == NULL)
+        {
+            nitf_Mutex_lock(&(work->lock));
+            if (!(work->failed))
+            {
+                work->failed = 1;
+                work->error = error;
+            }
+            nitf_Mutex_unlock(&(work->lock));
+        }
+    }
+
+    return;
+}
+
+
+NITFPRIV(void) nitf_ImageIO_releaseDecoded(_nitf_ImageIOControl * cntl)
+{
+    _nitf_ImageIO *nitf;        /* Associated ImageIO object */
+    _nitf_ImageIOCachedBlock *entry;    /* New cache entry */
+    _nitf_ImageIODecodedBlock *decoded; /* Current decoded block */
+    NITF_BOOL cacheOK;          /* The lookup table is available */
+    nitf_Error error;           /* For the cache and free block calls */
+    nitf_Uint32 i;
+
+    nitf = cntl->nitf;
+
+    nitf_Mutex_lock(&(nitf->lock));
+    cacheOK = nitf_ImageIO_blockCacheAlloc(nitf, &error);
+    for (i = 0; i < cntl->nDecoded; i++)
+    {
+        decoded = &(cntl->decoded[i]);
+        if (decoded->block == NULL)
+            continue;
+
+        /* Another read may have cached the block in the mean time */
+        entry = NULL;
+        if (cacheOK && (nitf->blockCache.lookup[decoded->number] == NULL))
+            entry = (_nitf_ImageIOCachedBlock *)
+                NITF_MALLOC(sizeof(_nitf_ImageIOCachedBlock));
+
+        if (entry == NULL)
+        {
+            nitf_ImageIO_freeDecoded(nitf, decoded->block);
+            decoded->block = NULL;
+            continue;
+        }
+
+        nitf_ImageIO_blockCacheTrim(nitf, nitf->blockSize, NULL);
+        entry->number = decoded->number;
+        entry->decoded = (nitf->decompressor != NULL)
+            && !nitf_ImageIO_decodesInto(nitf);
+        entry->block = decoded->block;
+        entry->row = decoded->row;
+        entry->column = decoded->column;
+        entry->numRows = decoded->numRows;
+        entry->numColumns = decoded->numColumns;
+        nitf_ImageIO_blockCacheInsert(nitf, entry);
+        decoded->block = NULL;
+    }
+    nitf_Mutex_unlock(&(nitf->lock));
+    return;
+}
+
+
+NITFPRIV(void) nitf_ImageIO_readAheadStart(_nitf_ImageIO * nitf,
+                                           nitf_IOInterface* io,
+                                           nitf_SubWindow * subWindow)
+{
+    _nitf_ImageIOReadAheadWork *work;   /* Blocks to fetch */
+    _nitf_ImageIOBlockCache *cache;     /* The block cache */
+    nitf_Error error;           /* Thread creation error, not reported */
+    nitf_Off mapSize;           /* Size of a memory mapped file */
+    NITF_BOOL raw;              /* Blocks are read without a decompressor */
+    NITF_BOOL sequential;       /* This read followed the previous one */
+    nitf_Uint32 startRow;       /* First row of the next read */
+    nitf_Uint64 endRow;         /* Last row plus one of the next read */
+    nitf_Uint64 endColumn;      /* Last column plus one */
+    nitf_Uint32 startBlockRow;  /* First block row */
+    nitf_Uint32 endBlockRow;    /* Last block row */
+    nitf_Uint32 startBlockCol;  /* First block column */
+    nitf_Uint32 endBlockCol;    /* Last block column */
+    nitf_Uint32 bandCount;      /* Number of band planes in the mask */
+    nitf_Uint32 bandOffset;     /* Band offset into the block mask */
+    nitf_Uint32 maxBlocks;      /* Upper bound on the number of blocks */
+    nitf_Uint32 number;         /* Block number, all bands */
+    nitf_Uint32 bandIdx;        /* Current band index */
+    nitf_Uint32 row;            /* Current block row */
+    nitf_Uint32 col;            /* Current block column */
+
+    /* Down-sampled reads do not map rows to blocks one to one */
+    if ((subWindow->downsampler != NULL)
+            && ((subWindow->downsampler->rowSkip != 1)
+                || (subWindow->downsampler->colSkip != 1)))
+        return;
+
+    startRow = subWindow->startRow + subWindow->numRows;
+
+    nitf_Mutex_lock(&(nitf->lock));
+    sequential = (subWindow->startRow == nitf->readAhead.nextRow);
+    nitf->readAhead.nextRow = startRow;
+    if ((nitf->readAhead.mode == NITF_READ_AHEAD_OFF)
+            || ((nitf->readAhead.mode == NITF_READ_AHEAD_AUTO) && !sequential)
+            || nitf->readAhead.running
+            || (nitf->vtbl.reader != nitf_ImageIO_cachedReader)
+            || (startRow >= nitf->numRows) || (nitf->blockMask == NULL))
+    {
+        nitf_Mutex_unlock(&(nitf->lock));
+        return;
+    }
+    nitf_Mutex_unlock(&(nitf->lock));
+
+    /*
+     * The caller may use the IOInterface between reads, so the thread must
+     * not move the file position. Decompressors must be able to run
+     * alongside the reads for the same reason
+     */
+    raw = (nitf->pixel.type != NITF_IMAGE_IO_PIXEL_TYPE_B)
+        && (nitf->pixel.type != NITF_IMAGE_IO_PIXEL_TYPE_12)
+        && (nitf->compression & NITF_IMAGE_IO_NO_COMPRESSION);
+    if (!nitf_IOInterface_canReadAt(io)
+            || (!raw && ((nitf->decompressor == NULL)
+                         || !(nitf->decompressor->flags
+                              & NITF_DECOMPRESSION_CONCURRENT_READ_BLOCK))))
+        return;
+
+    /* A memory mapped file is already as close as it gets */
+    if (raw && (nitf_IOInterface_getMapping(io, &mapSize) != NULL))
+        return;
+
+    endRow = (nitf_Uint64) startRow + subWindow->numRows;
+    if (endRow > nitf->numRows)
+        endRow = nitf->numRows;
+    endColumn = (nitf_Uint64) subWindow->startCol + subWindow->numCols;
+    if (endColumn > nitf->numColumnsActual)
+        endColumn = nitf->numColumnsActual;
+
+    startBlockRow = startRow / nitf->numRowsPerBlock;
+    endBlockRow = (nitf_Uint32) ((endRow - 1) / nitf->numRowsPerBlock);
+    startBlockCol = subWindow->startCol / nitf->numColumnsPerBlock;
+    endBlockCol = (nitf_Uint32) ((endColumn - 1) / nitf->numColumnsPerBlock);
+
+    /* Blocking mode "S" has a separate set of blocks for each band */
+    if (nitf->blockingMode == NITF_IMAGE_IO_BLOCKING_MODE_S)
+        bandCount = subWindow->numBands;
+    else
+        bandCount = 1;
+
+    maxBlocks = bandCount * (endBlockRow - startBlockRow + 1)
+        * (endBlockCol - startBlockCol + 1);
+
+    work = (_nitf_ImageIOReadAheadWork *)
+        NITF_MALLOC(sizeof(_nitf_ImageIOReadAheadWork));
+    if (work == NULL)
+        return;
+    work->blocks = (_nitf_ImageIODecodedBlock *)
+        NITF_MALLOC(maxBlocks * sizeof(_nitf_ImageIODecodedBlock));
+    if (work->blocks == NULL)
+    {
+        NITF_FREE(work);
+        return;
+    }
+    work->nitf = nitf;
+    work->io = io;
+    work->count = 0;
+
+    /* Skip pad blocks and blocks that are already cached */
+
+    cache = &(nitf->blockCache);
+    nitf_Mutex_lock(&(nitf->lock));
+    for (bandIdx = 0; bandIdx < bandCount; bandIdx++)
+    {
+        if (nitf->blockingMode == NITF_IMAGE_IO_BLOCKING_MODE_S)
+            bandOffset = subWindow->bandList[bandIdx]
+                * nitf->nBlocksPerRow * nitf->nBlocksPerColumn;
+        else
+            bandOffset = 0;
+
+        for (row = startBlockRow; row <= endBlockRow; row++)
+            for (col = startBlockCol; col <= endBlockCol; col++)
+            {
+                _nitf_ImageIODecodedBlock *block;
+
+                number = bandOffset + row * nitf->nBlocksPerRow + col;
+                if (nitf->blockMask[number] == NITF_IMAGE_IO_NO_OFFSET)
+                    continue;
+                if ((cache->lookup != NULL) && (cache->lookup[number] != NULL))
+                    continue;
+
+                block = &(work->blocks[work->count]);
+                block->number = number;
+                block->blockNumber = number - bandOffset;
+                block->block = NULL;
+                block->row = 0;
+                block->column = 0;
+                block->numRows = nitf->numRowsPerBlock;
+                block->numColumns = nitf->numColumnsPerBlock;
+                work->count += 1;
+
+                if (raw)
+                    nitf_IOInterface_adviseWillNeed(io, (nitf_Off)
+                                                    (nitf->pixelBase
+                                                     + nitf->blockMask[number]),
+                                                    (nitf_Off) nitf->blockSize);
+            }
+    }
+
+    if ((work->count == 0) || nitf->readAhead.running
+            || !nitf_Thread_create(&(nitf->readAhead.thread),
+                                   nitf_ImageIO_readAheadWorker, work,
+                                   &error))
+    {
+        nitf_Mutex_unlock(&(nitf->lock));
+        NITF_FREE(work->blocks);
+        NITF_FREE(work);
+        return;
+    }
+    nitf->readAhead.running = 1;
+    nitf_Mutex_unlock(&(nitf->lock));
+
+    return;
+}
+
+
+NITFPRIV(void) nitf_ImageIO_readAheadJoin(_nitf_ImageIO * nitf)
+{
+    nitf_Thread thread;         /* Thread to join */
+    int running;                /* A thread needs to be joined */
+
+    nitf_Mutex_lock(&(nitf->lock));
+    running = nitf->readAhead.running;
+    thread = nitf->readAhead.thread;
+    nitf->readAhead.running = 0;
+    nitf_Mutex_unlock(&(nitf->lock));
+
+    if (running)
+        nitf_Thread_join(&thread);
+
+    return;
+}
+
+
+NITFPRIV(void) nitf_ImageIO_readAheadWorker(void *data)
+{
+    _nitf_ImageIOReadAheadWork *work;   /* Blocks to fetch */
+    _nitf_ImageIO *nitf;                /* Associated ImageIO object */
+    _nitf_ImageIODecodedBlock *block;   /* Current block */
+    _nitf_ImageIOCachedBlock *entry;    /* New cache entry */
+    NITF_BOOL raw;              /* Blocks are read without a decompressor */
+    NITF_BOOL ok;               /* Block fetched */
+    int decoded;                /* Buffer owned by the decompressor */
+    nitf_Error error;           /* Fetch errors, not reported */
+    nitf_Uint32 i;
+
+    work = (_nitf_ImageIOReadAheadWork *) data;
+    nitf = work->nitf;
+
+    /* The decompressor supports concurrent reads, no I/O lock is needed */
+
+    raw = (nitf->pixel.type != NITF_IMAGE_IO_PIXEL_TYPE_B)
+        && (nitf->pixel.type != NITF_IMAGE_IO_PIXEL_TYPE_12)
+        && (nitf->compression & NITF_IMAGE_IO_NO_COMPRESSION);
+    decoded = !raw && !nitf_ImageIO_decodesInto(nitf);
+
+    for (i = 0; i < work->count; i++)
+    {
+        block = &(work->blocks[i]);
+
+        /* A read may have needed the block first */
+        nitf_Mutex_lock(&(nitf->lock));
+        ok = (nitf->blockCache.lookup == NULL)
+            || (nitf->blockCache.lookup[block->number] == NULL);
+        nitf_Mutex_unlock(&(nitf->lock));
+        if (!ok)
+            continue;
+
+        if (decoded)
+        {
+            block->block = (*(nitf->decompressor->readBlock))
+                (nitf->decompressionControl, block->blockNumber, &error);
+            ok = (block->block != NULL);
+        }
+        else
+        {
+            block->block = (nitf_Uint8 *) NITF_MALLOC(nitf->blockSize);
+            if (block->block == NULL)
+                break;
+
+            if (raw)
+                ok = nitf_ImageIO_readAt(nitf, work->io, nitf->pixelBase
+                                         + nitf->blockMask[block->number],
+                                         block->block, nitf->blockSize,
+                                         &error);
+            else
+                ok = nitf_ImageIO_decodeInto(nitf, block->blockNumber,
+                                             block->block, &error);
+            if (!ok)
+            {
+                NITF_FREE(block->block);
+                block->block = NULL;
+            }
+        }
+        if (!ok)
+            continue;
+
+        /* Another read may have cached the block in the mean time */
+
+        nitf_Mutex_lock(&(nitf->lock));
+        entry = NULL;
+        if (nitf_ImageIO_blockCacheAlloc(nitf, &error)
+                && (nitf->blockCache.lookup[block->number] == NULL))
+            entry = (_nitf_ImageIOCachedBlock *)
+                NITF_MALLOC(sizeof(_nitf_ImageIOCachedBlock));
+
+        if (entry == NULL)
+        {
+            if (decoded)
+                nitf_ImageIO_freeDecoded(nitf, block->block);
+            else
+                NITF_FREE(block->block);
+        }
+        else
+        {
+            nitf_ImageIO_blockCacheTrim(nitf, nitf->blockSize, NULL);
+            entry->number = block->number;
+            entry->decoded = decoded;
+            entry->block = block->block;
+            entry->row = block->row;
+            entry->column = block->column;
+            entry->numRows = block->numRows;
+            entry->numColumns = block->numColumns;
+            nitf_ImageIO_blockCacheInsert(nitf, entry);
+        }
+        nitf_Mutex_unlock(&(nitf->lock));
+    }
+
+    NITF_FREE(work->blocks);
+    NITF_FREE(work);
+    return;
+}
+
+
+NITFPRIV(int) nitf_ImageIO_compareDecoded(const void *a, const void *b)
+{
+    nitf_Uint32 numberA;        /* First block number */
+    nitf_Uint32 numberB;        /* Second block number */
+
+    numberA = ((const _nitf_ImageIODecodedBlock *) a)->number;
+    numberB = ((const _nitf_ImageIODecodedBlock *) b)->number;
+    if (numberA < numberB)
+        return -1;
+    return (numberA > numberB) ? 1 : 0;
+}
+
+
+int nitf_ImageIO_uncachedWriter(_nitf_ImageIOBlock * blockIO,
+                                nitf_IOInterface* io, 
+                                nitf_Error * error)
+{
+    _nitf_ImageIOControl *cntl; /* Associated image I/O control object */
+    _nitf_ImageIO *nitf;        /* Associated image I/O object */
+    
+    cntl = blockIO->cntl;
+    nitf = cntl->nitf;
+    
+    if (!nitf_ImageIO_writeToFile(io,
+                                  nitf->pixelBase + blockIO->imageDataOffset
+                                  + blockIO->blockOffset.mark,
+                                  blockIO->rwBuffer.buffer + 
+                                  blockIO->rwBuffer.offset.mark,
+                                  blockIO->readCount, error))
+        return NITF_FAILURE;
+    
+    /*      Write column and row padding if required. This is fill not pad */
+    
+    if (blockIO->padColumnCount != 0)
+    {
+        if (cntl->padBuffer == NULL)
+            if (!nitf_ImageIO_allocatePad(cntl, error))
+                return NITF_FAILURE;
+        
+        if (!nitf_ImageIO_writeToFile(io,
+                                      nitf->pixelBase +
+                                      blockIO->imageDataOffset +
+                                      blockIO->blockOffset.mark + 
+                                      blockIO->readCount,
+                                      cntl->padBuffer,
+                                      (size_t)blockIO->padColumnCount,
+                                      error))
+            return NITF_FAILURE;
+        /* Fill not pad blockIO->padMask[blockIO->number] = blockIO->blockMask[blockIO->number]; */
+    }
+    
+    if ((blockIO->padRowCount != 0)
+        && (blockIO->currentRow >= (nitf->numRows - 1)))
+    {
+        size_t writeCount;      /* Amount to write each row */
+        nitf_Uint64 offset;     /* File offset for each write */
+        size_t increment;       /* Byte increment between writes */
+        nitf_Uint32 rowIdx;     /* Rwo counter */
+        
+        if (cntl->padBuffer == NULL)
+            if (!nitf_ImageIO_allocatePad(cntl, error))
+                return NITF_FAILURE;
+        
+        writeCount = blockIO->readCount + blockIO->padColumnCount;
+        increment = writeCount;
+        offset = nitf->pixelBase + blockIO->imageDataOffset
+                 + blockIO->blockOffset.mark + increment;
+
+        for (rowIdx = 0; rowIdx < blockIO->padRowCount; rowIdx++)
+        {
+            if (!nitf_ImageIO_writeToFile(io,
+                                          offset, cntl->padBuffer,
+                                          writeCount, error))
+                return NITF_FAILURE;
+            offset += increment;
+        }
+    }
+    
+    return NITF_SUCCESS;
+}
+
+int nitf_ImageIO_cachedWriter(_nitf_ImageIOBlock * blockIO,
+                              nitf_IOInterface* io, 
+                              nitf_Error * error)
+{
+    _nitf_ImageIOControl *cntl; /* Associated image I/O control object */
+    _nitf_ImageIO *nitf;        /* Associated image I/O object */
+    nitf_Uint32 i;
+    
+    cntl = blockIO->cntl;
+    nitf = cntl->nitf;
+    
+    if (!nitf_ImageIO_writeToBlock(blockIO, io, blockIO->blockOffset.mark,
+                                   blockIO->rwBuffer.buffer + 
+                                   blockIO->rwBuffer.offset.mark,
+                                   blockIO->readCount, error))
+        return NITF_FAILURE;
+
+    /*      Write column and row padding if required */
+
+    if (blockIO->padColumnCount != 0)
+    {
+        if (cntl->padBuffer == NULL)
+            if (!nitf_ImageIO_allocatePad(cntl, error))
+                return NITF_FAILURE;
+
+        if (!nitf_ImageIO_writeToBlock(blockIO, io,
+                                       blockIO->blockOffset.mark + 
+                                       blockIO->readCount,
+                                       cntl->padBuffer,
+                                       blockIO->padColumnCount, error))
+            return NITF_FAILURE;
+    }
+    
+    if ((blockIO->padRowCount != 0)
+        && (blockIO->currentRow >= (nitf->numRows - 1)))
+    {
+        size_t writeCount; /* Amount to write each row */
+        size_t offset;     /* Current offset into block buffer */
+        
+        if (cntl->padBuffer == NULL)
+            if (!nitf_ImageIO_allocatePad(cntl, error))
+                return NITF_FAILURE;
+        
+        writeCount = blockIO->readCount + blockIO->padColumnCount;
+        offset = writeCount;
+        
+        /*
+         * Because the pad buffer is only one line long, this 
+         * has to be a loop of
+         * smaller writes
+         */
+        for (i = 0;i < blockIO->padRowCount;i++)
+        {
+            if (!nitf_ImageIO_writeToBlock(blockIO, io,
+                                           blockIO->blockOffset.mark + offset,
+                                           cntl->padBuffer, writeCount, error))
+                return NITF_FAILURE;
+            offset += writeCount;
+        }
+    }
+
+    return NITF_SUCCESS;
+}
+
+void nitf_ImageIO_setDefaultParameters(_nitf_ImageIO * object)
+{
+    
+    object->parameters.noCacheThreshold = 0.5;
+    object->parameters.clearCache = 0;;
+    
+    return;
+}
+
+
+void nitf_ImageIO_unformatExtend_1(nitf_Uint8 * buffer,
+                                   size_t count,
+                                   nitf_Uint32 shiftCount)
+{
+    nitf_Int8 shift;            /* Shift count */
+    nitf_Int8 *bp8;             /* Buffer pointer, 8 bit */
+    nitf_Int16 tmp8;            /* Temp value, 8 bit */
+    size_t i;
+    
+    shift = (nitf_Int8) shiftCount;
+    bp8 = (nitf_Int8 *) buffer;
+    for (i = 0; i < count; i++)
+    {
+        tmp8 = *bp8 << shift;
+        *(bp8++) = tmp8 >> shift;
+    }
+    
+    return;
+}
+
+
+void nitf_ImageIO_unformatExtend_2(nitf_Uint8 * buffer,
+                                   size_t count,
+                                   nitf_Uint32 shiftCount)
+{
+    nitf_Int16 shift;           /* Shift count */
+    nitf_Int16 *bp16;           /* Buffer pointer, 16 bit */
+    nitf_Int16 tmp16;           /* Temp value, 16 bit */
+    size_t i;
+    
+    shift = (nitf_Int16) shiftCount;
+    bp16 = (nitf_Int16 *) buffer;
+    for (i = 0; i < count; i++)
+    {
+        tmp16 = *bp16 << shift;
+        *(bp16++) = tmp16 >> shift;
+    }
+    
+    return;
+}
+
+
+void nitf_ImageIO_unformatExtend_4(nitf_Uint8 * buffer,
+                                   size_t count,
+                                   nitf_Uint32 shiftCount)
+{
+    nitf_Int32 shift;           /* Shift count */
+    nitf_Int32 *bp32;           /* Buffer pointer, 32 bit */
+    nitf_Int32 tmp32;           /* Temp value, 32 bit */
+    size_t i;
+    
+    shift = (nitf_Int32) shiftCount;
+    bp32 = (nitf_Int32 *) buffer;
+    for (i = 0; i < count; i++)
+    {
+        tmp32 = *bp32 << shift;
+        *(bp32++) = tmp32 >> shift;
+    }
+    
+    return;
+}
+
+
+/* Uses 64 bit types */
+
+void nitf_ImageIO_unformatExtend_8(nitf_Uint8 * buffer,
+                                   size_t count,
+                                   nitf_Uint32 shiftCount)
+{
+    nitf_Int64 shift;           /* Shift count */
+    nitf_Int64 *bp64;           /* Buffer pointer, 64 bit */
+    nitf_Int64 tmp64;           /* Temp value, 64 bit */
+    size_t i;
+    
+    shift = (nitf_Int64) shiftCount;
+    bp64 = (nitf_Int64 *) buffer;
+    for (i = 0; i < count; i++)
+    {
+        tmp64 = *bp64 << shift;
+        *(bp64++) = tmp64 >> shift;
+    }
+    
+    return;
+}
+
+
+/*========================= nitf_ImageIO_unformatShift_* =====================*/
+
+void nitf_ImageIO_unformatShift_1(nitf_Uint8 * buffer,
+                                  size_t count,
+                                  nitf_Uint32 shiftCount)
+{
+    nitf_Int8 shift;            /* Shift count */
+    nitf_Int8 *bp8;             /* Buffer pointer, 8 bit */
+    size_t i;
+    
+    shift = (nitf_Int8) shiftCount;
+    bp8 = (nitf_Int8 *) buffer;
+    for (i = 0; i < count; i++)
+        *(bp8++) >>= shift;
+    
+    return;
+}
+
+
+void nitf_ImageIO_unformatShift_2(nitf_Uint8 * buffer,
+                                  size_t count,
+                                  nitf_Uint32 shiftCount)
+{
+    nitf_Int16 shift;           /* Shift count */
+    nitf_Int16 *bp16;           /* Buffer pointer, 16 bit */
+    size_t i;
+    
+    shift = (nitf_Int16) shiftCount;
+    bp16 = (nitf_Int16 *) buffer;
+    for (i = 0; i < count; i++)
+        *(bp16++) >>= shift;
+    
+    return;
+}
+
+
+void nitf_ImageIO_unformatShift_4(nitf_Uint8 * buffer,
+                                  size_t count,
+                                  nitf_Uint32 shiftCount)
+{
+    nitf_Int32 shift;           /* Shift count */
+    nitf_Int32 *bp32;           /* Buffer pointer, 32 bit */
+    size_t i;
+    
+    shift = (nitf_Int32) shiftCount;
+    bp32 = (nitf_Int32 *) buffer;
+    for (i = 0; i < count; i++)
+        *(bp32++) >>= shift;
+    
+    return;
+}
+
+
+/* Uses 64 bit types */
+
+void nitf_ImageIO_unformatShift_8(nitf_Uint8 * buffer,
+                                  size_t count,
+                                  nitf_Uint32 shiftCount)
+{
+    nitf_Int64 shift;           /* Shift count */
+    nitf_Int64 *bp64;           /* Buffer pointer, 64 bit */
+    size_t i;
+    
+    shift = (nitf_Int64) shiftCount;
+    bp64 = (nitf_Int64 *) buffer;
+    for (i = 0; i < count; i++)
+        *(bp64++) >>= shift;
+    
+    return;
+}
+
+void nitf_ImageIO_unformatUShift_1(nitf_Uint8 * buffer,
+                                   size_t count,
+                                   nitf_Uint32 shiftCount)
+{
+    nitf_Uint8 shift;           /* Shift count */
+    nitf_Uint8 *bp8;            /* Buffer pointer, 8 bit */
+    size_t i;
+    
+    shift = (nitf_Uint8) shiftCount;
+    bp8 = (nitf_Uint8 *) buffer;
+    for (i = 0; i < count; i++)
+        *(bp8++) >>= shift;
+    
+    return;
+}
+
+
+void nitf_ImageIO_unformatUShift_2(nitf_Uint8 * buffer,
+                                   size_t count,
+                                   nitf_Uint32 shiftCount)
+{
+    nitf_Uint16 shift;          /* Shift count */
+    nitf_Uint16 *bp16;          /* Buffer pointer, 16 bit */
+    size_t i;
+    
+    shift = (nitf_Uint16) shiftCount;
+    bp16 = (nitf_Uint16 *) buffer;
+    for (i = 0; i < count; i++)
+        *(bp16++) >>= shift;
+    
+    return;
+}
+
+
+void nitf_ImageIO_unformatUShift_4(nitf_Uint8 * buffer,
+                                   size_t count,
+                                   nitf_Uint32 shiftCount)
+{
+    nitf_Uint32 shift;          /* Shift count */
+    nitf_Uint32 *bp32;          /* Buffer pointer, 32 bit */
+    size_t i;
+    
+    shift = (nitf_Uint32) shiftCount;
+    bp32 = (nitf_Uint32 *) buffer;
+    for (i = 0; i < count; i++)
+        *(bp32++) >>= shift;
+    
+    return;
+}
+
+
+/* Uses 64 bit types */
+void nitf_ImageIO_unformatUShift_8(nitf_Uint8 * buffer,
+                                   size_t count,
+                                   nitf_Uint32 shiftCount)
+{
+    nitf_Uint64 shift;          /* Shift count */
+    nitf_Uint64 *bp64;          /* Buffer pointer, 64 bit */
+    size_t i;
+    
+    shift = (nitf_Uint64) shiftCount;
+    bp64 = (nitf_Uint64 *) buffer;
+    for (i = 0; i < count; i++)
+        *(bp64++) >>= shift;
+    
+    return;
+}
+
+void nitf_ImageIO_swapOnly_2(nitf_Uint8 * buffer,
+        size_t count, nitf_Uint32 shiftCount)
+{
+    nitf_Uint8 *bp8;            /* Buffer pointer, 8 bit */
+    nitf_Uint16 *bp16;          /* Buffer pointer, 16 bit */
+    nitf_Uint8 tmp8;            /* Temp value, 8 bit */
+    size_t i;
+    
+    /* Silence compiler warnings about unused variables */
+    (void)shiftCount;
+
+    bp16 = (nitf_Uint16 *) buffer;
+    for (i = 0; i < count; i++)
+    {
+        bp8 = (nitf_Uint8 *) bp16++;
+        tmp8 = bp8[0];
+        bp8[0] = bp8[1];
+        bp8[1] = tmp8;
+    }
+    
+    return;
+}
+
+
+void nitf_ImageIO_swapOnly_4(nitf_Uint8 * buffer,
+        size_t count, nitf_Uint32 shiftCount)
+{
+    nitf_Uint8 *bp8;            /* Buffer pointer, 8 bit */
+    nitf_Uint32 *bp32;          /* Buffer pointer, 32 bit */
+    nitf_Uint8 tmp8;            /* Temp value, 8 bit */
+    size_t i;
+    
+    /* Silence compiler warnings about unused variables */
+    (void)shiftCount;
+
+    bp32 = (nitf_Uint32 *) buffer;
+    for (i = 0; i < count; i++)
+    {
+        bp8 = (nitf_Uint8 *) (bp32++);
+        
+        tmp8 = bp8[0];
+        bp8[0] = bp8[3];
+        bp8[3] = tmp8;
+        tmp8 = bp8[1];
+        bp8[1] = bp8[2];
+        bp8[2] = tmp8;
+    }
+    
+    return;
+}
+
+void nitf_ImageIO_swapOnly_4c(nitf_Uint8 * buffer,
+        size_t count, nitf_Uint32 shiftCount)
+{
+    nitf_Uint8 *bp8;            /* Buffer pointer, 8 bit */
+    nitf_Uint32 *bp32;          /* Buffer pointer, 32 bit */
+    nitf_Uint8 tmp8;            /* Temp value, 8 bit */
+    size_t i;
+
+    /* Silence compiler warnings about unused variables */
     (void)shiftCount;
 
     bp32 = (nitf_Uint32 *) buffer;
     for (i = 0; i < count; i++)
     {
-        bp8 = (nitf_Uint8 *) (bp32++);
-        
+        bp8 = (nitf_Uint8 *) (bp32++);
+
+        tmp8 = bp8[0];
+        bp8[0] = bp8[1];
+        bp8[1] = tmp8;
+        tmp8 = bp8[2];
+        bp8[2] = bp8[3];
+        bp8[3] = tmp8;
+    }
+
+    return;
+}
+
+
+void nitf_ImageIO_swapOnly_8(nitf_Uint8 * buffer,
+        size_t count, nitf_Uint32 shiftCount)
+{
+    nitf_Uint8 *bp8;            /* Buffer pointer, 8 bit */
+    nitf_Uint64 *bp64;          /* Buffer pointer, 64 bit */
+    nitf_Uint8 tmp8;            /* Temp value, 8 bit */
+    size_t i;
+    
+    /* Silence compiler warnings about unused variables */
+    (void)shiftCount;
+
+    bp64 = (nitf_Uint64 *) buffer;
+    for (i = 0; i < count; i++)
+    {
+        bp8 = (nitf_Uint8 *) (bp64++);
+        
+        tmp8 = bp8[0];
+        bp8[0] = bp8[7];
+        bp8[7] = tmp8;
+        tmp8 = bp8[1];
+        bp8[1] = bp8[6];
+        bp8[6] = tmp8;
+        tmp8 = bp8[2];
+        bp8[2] = bp8[5];
+        bp8[5] = tmp8;
+        tmp8 = bp8[3];
+        bp8[3] = bp8[4];
+        bp8[4] = tmp8;
+    }
+    
+    return;
+}
+
+
+void nitf_ImageIO_swapOnly_8c(nitf_Uint8 * buffer,
+        size_t count, nitf_Uint32 shiftCount)
+{
+    nitf_Uint8 *bp8;            /* Buffer pointer, 8 bit */
+    nitf_Uint64 *bp64;          /* Buffer pointer, 64 bit */
+    nitf_Uint8 tmp8;            /* Temp value, 8 bit */
+    size_t i;
+    
+    /* Silence compiler warnings about unused variables */
+    (void)shiftCount;
+
+    bp64 = (nitf_Uint64 *) buffer;
+    for (i = 0; i < count; i++)
+    {
+        bp8 = (nitf_Uint8 *) (bp64++);
+        
+        tmp8 = bp8[4];
+        bp8[4] = bp8[7];
+        bp8[7] = tmp8;
+        tmp8 = bp8[5];
+        bp8[5] = bp8[6];
+        bp8[6] = tmp8;
+        tmp8 = bp8[0];
+        bp8[0] = bp8[3];
+        bp8[3] = tmp8;
+        tmp8 = bp8[1];
+        bp8[1] = bp8[2];
+        bp8[2] = tmp8;
+    }
+    
+    return;
+}
+
+
+void nitf_ImageIO_swapOnly_16c(nitf_Uint8 * buffer,
+        size_t count, nitf_Uint32 shiftCount)
+{
+    nitf_Uint8 *bp8;            /* Buffer pointer, 8 bit */
+    nitf_Uint64 *bp64;          /* Buffer pointer, 64 bit */
+    nitf_Uint8 tmp8;            /* Temp value, 8 bit */
+    size_t i;
+    
+    /* Silence compiler warnings about unused variables */
+    (void)shiftCount;
+
+    bp64 = (nitf_Uint64 *) buffer;
+    for (i = 0; i < count; i++)
+    {
+        bp8 = (nitf_Uint8 *) (bp64++);
+        
+        tmp8 = bp8[0];
+        bp8[0] = bp8[7];
+        bp8[7] = tmp8;
+        tmp8 = bp8[1];
+        bp8[1] = bp8[6];
+        bp8[6] = tmp8;
+        tmp8 = bp8[2];
+        bp8[2] = bp8[5];
+        bp8[5] = tmp8;
+        tmp8 = bp8[3];
+        bp8[3] = bp8[4];
+        bp8[4] = tmp8;
+        
+        bp8 = (nitf_Uint8 *) (bp64++);
+        
+        tmp8 = bp8[0];
+        bp8[0] = bp8[7];
+        bp8[7] = tmp8;
+        tmp8 = bp8[1];
+        bp8[1] = bp8[6];
+        bp8[6] = tmp8;
+        tmp8 = bp8[2];
+        bp8[2] = bp8[5];
+        bp8[5] = tmp8;
+        tmp8 = bp8[3];
+        bp8[3] = bp8[4];
+        bp8[4] = tmp8;
+    }
+    
+    return;
+}
+
+
+void nitf_ImageIO_unformatSwapExtend_2(nitf_Uint8 * buffer,
+                                       size_t count,
+                                       nitf_Uint32 shiftCount)
+{
+    nitf_Int16 shift;           /* Shift count */
+    nitf_Uint8 *bp8;            /* Buffer pointer, 8 bit */
+    nitf_Int16 *bp16;           /* Buffer pointer, 16 bit */
+    nitf_Uint8 tmp8;            /* Temp value, 8 bit */
+    nitf_Int16 tmp16;           /* Temp value, 16 bit */
+    size_t i;
+    
+    shift = (nitf_Int16) shiftCount;
+    bp16 = (nitf_Int16 *) buffer;
+    for (i = 0; i < count; i++)
+    {
+        bp8 = (nitf_Uint8 *) bp16;
+        tmp8 = bp8[0];
+        bp8[0] = bp8[1];
+        bp8[1] = tmp8;
+        
+        tmp16 = *bp16 << shift;
+        *(bp16++) = tmp16 >> shift;
+    }
+    
+    return;
+}
+
+
+void nitf_ImageIO_unformatSwapExtend_4(nitf_Uint8 * buffer,
+                                       size_t count,
+                                       nitf_Uint32 shiftCount)
+{
+    nitf_Int32 shift;           /* Shift count */
+    nitf_Uint8 *bp8;            /* Buffer pointer, 8 bit */
+    nitf_Int32 *bp32;           /* Buffer pointer, 32 bit */
+    nitf_Uint8 tmp8;            /* Temp value, 8 bit */
+    nitf_Int32 tmp32;           /* Temp value, 32 bit */
+    size_t i;
+    
+    shift = (nitf_Int32) shiftCount;
+    bp32 = (nitf_Int32 *) buffer;
+    for (i = 0; i < count; i++)
+    {
+        bp8 = (nitf_Uint8 *) bp32;
+        
+        tmp8 = bp8[0];
+        bp8[0] = bp8[3];
+        bp8[3] = tmp8;
+        tmp8 = bp8[1];
+        bp8[1] = bp8[2];
+        bp8[2] = tmp8;
+        
+        tmp32 = *bp32 << shift;
+        *(bp32++) = tmp32 >> shift;
+    }
+    
+    return;
+}
+
+
+/* Uses 64 bit types */
+void nitf_ImageIO_unformatSwapExtend_8(nitf_Uint8 * buffer,
+                                       size_t count,
+                                       nitf_Uint32 shiftCount)
+{
+    nitf_Int64 shift;           /* Shift count */
+    nitf_Uint8 *bp8;            /* Buffer pointer, 8 bit */
+    nitf_Int64 *bp64;           /* Buffer pointer, 64 bit */
+    nitf_Uint8 tmp8;            /* Temp value, 8 bit */
+    nitf_Int64 tmp64;           /* Temp value, 64 bit */
+    size_t i;
+    
+    shift = (nitf_Int64) shiftCount;
+    bp64 = (nitf_Int64 *) buffer;
+    for (i = 0; i < count; i++)
+    {
+        bp8 = (nitf_Uint8 *) bp64;
+        
+        tmp8 = bp8[0];
+        bp8[0] = bp8[7];
+        bp8[7] = tmp8;
+        tmp8 = bp8[1];
+        bp8[1] = bp8[6];
+        bp8[6] = tmp8;
+        tmp8 = bp8[2];
+        bp8[2] = bp8[5];
+        bp8[5] = tmp8;
+        tmp8 = bp8[3];
+        bp8[3] = bp8[4];
+        bp8[4] = tmp8;
+        
+        tmp64 = *bp64 << shift;
+        *(bp64++) = tmp64 >> shift;
+    }
+    
+    return;
+}
+
+
+void nitf_ImageIO_unformatSwapShift_2(nitf_Uint8 * buffer,
+                                      size_t count,
+                                      nitf_Uint32 shiftCount)
+{
+    nitf_Int16 shift;           /* Shift count */
+    nitf_Uint8 *bp8;            /* Buffer pointer, 8 bit */
+    nitf_Int16 *bp16;           /* Buffer pointer, 16 bit */
+    nitf_Uint8 tmp8;            /* Temp value, 8 bit */
+    size_t i;
+    
+    shift = (nitf_Int16) shiftCount;
+    bp16 = (nitf_Int16 *) buffer;
+    for (i = 0; i < count; i++)
+    {
+        bp8 = (nitf_Uint8 *) bp16;
         tmp8 = bp8[0];
-        bp8[0] = bp8[3];
-        bp8[3] = tmp8;
-        tmp8 = bp8[1];
-        bp8[1] = bp8[2];
-        bp8[2] = tmp8;
+        bp8[0] = bp8[1];
+        bp8[1] = tmp8;
+        
+        *(bp16++) >>= shift;
     }
     
     return;
 }
 
-void nitf_ImageIO_swapOnly_4c(nitf_Uint8 * buffer,
-        size_t count, nitf_Uint32 shiftCount)
+
+void nitf_ImageIO_unformatSwapShift_4(nitf_Uint8 * buffer,
+                                      size_t count,
+                                      nitf_Uint32 shiftCount)
 {
+    nitf_Int32 shift;           /* Shift count */
     nitf_Uint8 *bp8;            /* Buffer pointer, 8 bit */
-    nitf_Uint32 *bp32;          /* Buffer pointer, 32 bit */
+    nitf_Int32 *bp32;           /* Buffer pointer, 32 bit */
     nitf_Uint8 tmp8;            /* Temp value, 8 bit */
     size_t i;
-
-    /* Silence compiler warnings about unused variables */
-    (void)shiftCount;
-
-    bp32 = (nitf_Uint32 *) buffer;
+    
+    shift = (nitf_Int32) shiftCount;
+    bp32 = (nitf_Int32 *) buffer;
     for (i = 0; i < count; i++)
     {
-        bp8 = (nitf_Uint8 *) (bp32++);
-
+        bp8 = (nitf_Uint8 *) bp32;
+        
         tmp8 = bp8[0];
-        bp8[0] = bp8[1];
-        bp8[1] = tmp8;
-        tmp8 = bp8[2];
-        bp8[2] = bp8[3];
+        bp8[0] = bp8[3];
         bp8[3] = tmp8;
-    }
+        tmp8 = bp8[1];
+        bp8[1] = bp8[2];
+        bp8[2] = tmp8;
 
+        *(bp32++) >>= shift;
+    }
+    
     return;
 }
 
 
-void nitf_ImageIO_swapOnly_8(nitf_Uint8 * buffer,
-        size_t count, nitf_Uint32 shiftCount)
+/* Uses 64 bit types */
+void nitf_ImageIO_unformatSwapShift_8(nitf_Uint8 * buffer,
+                                      size_t count,
+                                      nitf_Uint32 shiftCount)
 {
+    nitf_Int64 shift;           /* Shift count */
     nitf_Uint8 *bp8;            /* Buffer pointer, 8 bit */
-    nitf_Uint64 *bp64;          /* Buffer pointer, 64 bit */
+    nitf_Int64 *bp64;           /* Buffer pointer, 64 bit */
     nitf_Uint8 tmp8;            /* Temp value, 8 bit */
     size_t i;
     
-    /* Silence compiler warnings about unused variables */
-    (void)shiftCount;
-
-    bp64 = (nitf_Uint64 *) buffer;
+    shift = (nitf_Int64) shiftCount;
+    bp64 = (nitf_Int64 *) buffer;
     for (i = 0; i < count; i++)
     {
-        bp8 = (nitf_Uint8 *) (bp64++);
+        bp8 = (nitf_Uint8 *) bp64;
         
         tmp8 = bp8[0];
         bp8[0] = bp8[7];
@@ -7839,61 +11634,85 @@ void nitf_ImageIO_swapOnly_8(nitf_Uint8 * buffer,
         tmp8 = bp8[3];
         bp8[3] = bp8[4];
         bp8[4] = tmp8;
+        
+        *(bp64++) >>= shift;
     }
     
     return;
 }
 
 
-void nitf_ImageIO_swapOnly_8c(nitf_Uint8 * buffer,
-        size_t count, nitf_Uint32 shiftCount)
+void nitf_ImageIO_unformatSwapUShift_2(nitf_Uint8 * buffer,
+                                       size_t count,
+                                       nitf_Uint32 shiftCount)
 {
+    nitf_Uint16 shift;          /* Shift count */
     nitf_Uint8 *bp8;            /* Buffer pointer, 8 bit */
-    nitf_Uint64 *bp64;          /* Buffer pointer, 64 bit */
+    nitf_Uint16 *bp16;          /* Buffer pointer, 16 bit */
     nitf_Uint8 tmp8;            /* Temp value, 8 bit */
     size_t i;
     
-    /* Silence compiler warnings about unused variables */
-    (void)shiftCount;
+    shift = (nitf_Uint16) shiftCount;
+    bp16 = (nitf_Uint16 *) buffer;
+    for (i = 0; i < count; i++)
+    {
+        bp8 = (nitf_Uint8 *) bp16;
+        tmp8 = bp8[0];
+        bp8[0] = bp8[1];
+        bp8[1] = tmp8;
+        
+        *(bp16++) >>= shift;
+    }
+    
+    return;
+}
 
-    bp64 = (nitf_Uint64 *) buffer;
+void nitf_ImageIO_unformatSwapUShift_4(nitf_Uint8 * buffer,
+                                       size_t count,
+                                       nitf_Uint32 shiftCount)
+{
+    nitf_Uint32 shift;          /* Shift count */
+    nitf_Uint8 *bp8;            /* Buffer pointer, 8 bit */
+    nitf_Uint32 *bp32;          /* Buffer pointer, 32 bit */
+    nitf_Uint8 tmp8;            /* Temp value, 8 bit */
+    size_t i;
+    
+    shift = (nitf_Uint32) shiftCount;
+    bp32 = (nitf_Uint32 *) buffer;
     for (i = 0; i < count; i++)
     {
-        bp8 = (nitf_Uint8 *) (bp64++);
+        bp8 = (nitf_Uint8 *) bp32;
         
-        tmp8 = bp8[4];
-        bp8[4] = bp8[7];
-        bp8[7] = tmp8;
-        tmp8 = bp8[5];
-        bp8[5] = bp8[6];
-        bp8[6] = tmp8;
         tmp8 = bp8[0];
         bp8[0] = bp8[3];
         bp8[3] = tmp8;
         tmp8 = bp8[1];
         bp8[1] = bp8[2];
         bp8[2] = tmp8;
+        
+        *(bp32++) >>= shift;
     }
     
     return;
 }
 
 
-void nitf_ImageIO_swapOnly_16c(nitf_Uint8 * buffer,
-        size_t count, nitf_Uint32 shiftCount)
+/* Uses 64 bit types */
+void nitf_ImageIO_unformatSwapUShift_8(nitf_Uint8 * buffer,
+                                       size_t count,
+                                       nitf_Uint32 shiftCount)
 {
+    nitf_Uint64 shift;          /* Shift count */
     nitf_Uint8 *bp8;            /* Buffer pointer, 8 bit */
     nitf_Uint64 *bp64;          /* Buffer pointer, 64 bit */
     nitf_Uint8 tmp8;            /* Temp value, 8 bit */
     size_t i;
     
-    /* Silence compiler warnings about unused variables */
-    (void)shiftCount;
-
+    shift = (nitf_Uint64) shiftCount;
     bp64 = (nitf_Uint64 *) buffer;
     for (i = 0; i < count; i++)
     {
-        bp8 = (nitf_Uint8 *) (bp64++);
+        bp8 = (nitf_Uint8 *) bp64;
         
         tmp8 = bp8[0];
         bp8[0] = bp8[7];
@@ -7908,128 +11727,215 @@ void nitf_ImageIO_swapOnly_16c(nitf_Uint8 * buffer,
         bp8[3] = bp8[4];
         bp8[4] = tmp8;
         
-        bp8 = (nitf_Uint8 *) (bp64++);
-        
-        tmp8 = bp8[0];
-        bp8[0] = bp8[7];
-        bp8[7] = tmp8;
-        tmp8 = bp8[1];
-        bp8[1] = bp8[6];
-        bp8[6] = tmp8;
-        tmp8 = bp8[2];
-        bp8[2] = bp8[5];
-        bp8[5] = tmp8;
-        tmp8 = bp8[3];
-        bp8[3] = bp8[4];
-        bp8[4] = tmp8;
+        *(bp64++) >>= shift;
     }
     
     return;
 }
 
 
-void nitf_ImageIO_unformatSwapExtend_2(nitf_Uint8 * buffer,
-                                       size_t count,
-                                       nitf_Uint32 shiftCount)
+void nitf_ImageIO_unpack_P(_nitf_ImageIOBlock * blocks,
+                           nitf_Uint32 numBlocks,
+                           nitf_Error * error)
+{
+    _nitf_ImageIOControl *cntl; /* Associated I/O control structure */
+    nitf_Uint8 **dst;           /* Destination buffers by band */
+    nitf_Uint8 *unpacked;       /* Current block's unpacked data */
+    nitf_Uint32 numBands;       /* Number of bands in the image */
+    nitf_Uint32 bytes;          /* Pixel size in bytes */
+    size_t count;               /* Number of pixels to transfer */
+    nitf_Uint32 i;
+
+    /* Silence compiler warnings about unused variables */
+    (void)error;
+
+    cntl = blocks[0].cntl;
+    numBands = cntl->nitf->numBands;
+    bytes = cntl->nitf->pixel.bytes;
+    count = blocks[0].pixelCountFR;
+
+    dst = cntl->bandBuffers;
+    memset(dst, 0, numBands * sizeof(nitf_Uint8 *));
+    for (i = 0; i < numBlocks; i++)
+        if (dst[blocks[i].band] == NULL)
+            dst[blocks[i].band] =
+                blocks[i].unpacked.buffer + blocks[i].unpacked.offset.mark;
+
+    /* All of the bands share the read buffer */
+    nitf_ImageIO_deinterleave(blocks[0].rwBuffer.buffer
+                              + blocks[0].rwBuffer.offset.mark,
+                              dst, numBands, bytes, count);
+
+    /* Copy bands that are requested more than once */
+    for (i = 0; i < numBlocks; i++)
+    {
+        unpacked = blocks[i].unpacked.buffer + blocks[i].unpacked.offset.mark;
+        if (unpacked != dst[blocks[i].band])
+            memcpy(unpacked, dst[blocks[i].band], count * bytes);
+    }
+    return;
+}
+
+
+void nitf_ImageIO_pack_P(_nitf_ImageIOBlock * blocks,
+                         nitf_Uint32 numBlocks,
+                         nitf_Error * error)
+{
+    _nitf_ImageIOControl *cntl; /* Associated I/O control structure */
+    nitf_Uint8 **src;           /* Source buffers by band */
+    nitf_Uint32 numBands;       /* Number of bands in the image */
+    nitf_Uint32 i;
+
+    /* Silence compiler warnings about unused variables */
+    (void)error;
+
+    cntl = blocks[0].cntl;
+    numBands = cntl->nitf->numBands;
+
+    src = cntl->bandBuffers;
+    memset(src, 0, numBands * sizeof(nitf_Uint8 *));
+    for (i = 0; i < numBlocks; i++)
+        src[blocks[i].band] =
+            blocks[i].user.buffer + blocks[i].user.offset.mark;
+
+    nitf_ImageIO_interleave(src, blocks[0].rwBuffer.buffer, numBands,
+                            cntl->nitf->pixel.bytes, blocks[0].pixelCountFR);
+    return;
+}
+
+void nitf_ImageIO_formatShift_1(nitf_Uint8 * buffer,
+        size_t count, nitf_Uint32 shiftCount)
+{
+    nitf_Int8 shift;            /* Shift count */
+    nitf_Int8 *bp8;             /* Buffer pointer, 8 bit */
+    size_t i;
+    
+    shift = (nitf_Int8) shiftCount;
+    bp8 = (nitf_Int8 *) buffer;
+    for (i = 0; i < count; i++)
+        *(bp8++) <<= shift;
+    
+    return;
+}
+
+
+void nitf_ImageIO_formatShift_2(nitf_Uint8 * buffer,
+        size_t count, nitf_Uint32 shiftCount)
 {
     nitf_Int16 shift;           /* Shift count */
-    nitf_Uint8 *bp8;            /* Buffer pointer, 8 bit */
     nitf_Int16 *bp16;           /* Buffer pointer, 16 bit */
-    nitf_Uint8 tmp8;            /* Temp value, 8 bit */
-    nitf_Uint16 tmp16;          /* Temp value, 16 bit */
     size_t i;
     
     shift = (nitf_Int16) shiftCount;
     bp16 = (nitf_Int16 *) buffer;
     for (i = 0; i < count; i++)
-    {
-        bp8 = (nitf_Uint8 *) bp16;
-        tmp8 = bp8[0];
-        bp8[0] = bp8[1];
-        bp8[1] = tmp8;
-        
-        tmp16 = *bp16 << shift;
-        *(bp16++) = tmp16 >> shift;
-    }
+        *(bp16++) <<= shift;
+    
+    return;
+}
+
+
+void nitf_ImageIO_formatShift_4(nitf_Uint8 * buffer,
+        size_t count, nitf_Uint32 shiftCount)
+{
+    nitf_Int32 shift;           /* Shift count */
+    nitf_Int32 *bp32;           /* Buffer pointer, 32 bit */
+    size_t i;
+    
+    shift = (nitf_Int32) shiftCount;
+    bp32 = (nitf_Int32 *) buffer;
+    for (i = 0; i < count; i++)
+        *(bp32++) <<= shift;
+    
+    return;
+}
+
+
+/* Uses 64 bit types */
+
+void nitf_ImageIO_formatShift_8(nitf_Uint8 * buffer,
+        size_t count, nitf_Uint32 shiftCount)
+{
+    nitf_Int64 shift;           /* Shift count */
+    nitf_Int64 *bp64;           /* Buffer pointer, 64 bit */
+    size_t i;
+    
+    shift = (nitf_Int64) shiftCount;
+    bp64 = (nitf_Int64 *) buffer;
+    for (i = 0; i < count; i++)
+        *(bp64++) <<= shift;
+    
+    return;
+}
+
+void nitf_ImageIO_formatMask_1(nitf_Uint8 * buffer,
+        size_t count, nitf_Uint32 shiftCount)
+{
+    nitf_Uint8 mask;            /* The mask */
+    nitf_Uint8 *bp8;            /* Buffer pointer, 8 bit */
+    size_t i;
+    
+    mask = ((nitf_Uint8) - 1) >> shiftCount;
+    bp8 = (nitf_Uint8 *) buffer;
+    for (i = 0; i < count; i++)
+        *(bp8++) &= mask;
+    
+    return;
+}
+
+void nitf_ImageIO_formatMask_2(nitf_Uint8 * buffer,
+        size_t count, nitf_Uint32 shiftCount)
+{
+    nitf_Uint16 mask;           /* The mask */
+    nitf_Uint16 *bp16;          /* Buffer pointer, 16 bit */
+    size_t i;
+    
+    mask = ((nitf_Uint16) - 1) >> shiftCount;
+    bp16 = (nitf_Uint16 *) buffer;
+    for (i = 0; i < count; i++)
+        *(bp16++) &= mask;
     
     return;
 }
 
 
-void nitf_ImageIO_unformatSwapExtend_4(nitf_Uint8 * buffer,
-                                       size_t count,
-                                       nitf_Uint32 shiftCount)
+void nitf_ImageIO_formatMask_4(nitf_Uint8 * buffer,
+        size_t count, nitf_Uint32 shiftCount)
 {
-    nitf_Int32 shift;           /* Shift count */
-    nitf_Uint8 *bp8;            /* Buffer pointer, 8 bit */
-    nitf_Int32 *bp32;           /* Buffer pointer, 32 bit */
-    nitf_Uint8 tmp8;            /* Temp value, 8 bit */
-    nitf_Uint8 tmp32;           /* Temp value, 32 bit */
+    nitf_Uint32 mask;           /* The mask */
+    nitf_Uint32 *bp32;          /* Buffer pointer, 32 bit */
     size_t i;
     
-    shift = (nitf_Int32) shiftCount;
-    bp32 = (nitf_Int32 *) buffer;
+    mask = ((nitf_Uint32) - 1) >> shiftCount;
+    bp32 = (nitf_Uint32 *) buffer;
     for (i = 0; i < count; i++)
-    {
-        bp8 = (nitf_Uint8 *) (bp32++);
-        
-        tmp8 = bp8[0];
-        bp8[0] = bp8[3];
-        bp8[3] = tmp8;
-        tmp8 = bp8[1];
-        bp8[1] = bp8[2];
-        bp8[2] = tmp8;
-        
-        tmp32 = *bp32 << shift;
-        *(bp32++) = tmp32 >> shift;
-    }
+        *(bp32++) &= mask;
     
     return;
 }
 
 
 /* Uses 64 bit types */
-void nitf_ImageIO_unformatSwapExtend_8(nitf_Uint8 * buffer,
-                                       size_t count,
-                                       nitf_Uint32 shiftCount)
+
+void nitf_ImageIO_formatMask_8(nitf_Uint8 * buffer,
+        size_t count, nitf_Uint32 shiftCount)
 {
-    nitf_Int64 shift;           /* Shift count */
-    nitf_Uint8 *bp8;            /* Buffer pointer, 8 bit */
-    nitf_Int64 *bp64;           /* Buffer pointer, 64 bit */
-    nitf_Uint8 tmp8;            /* Temp value, 8 bit */
-    nitf_Uint64 tmp64;          /* Temp value, 64 bit */
+    nitf_Uint64 mask;           /* The mask */
+    nitf_Uint64 *bp64;          /* Buffer pointer, 64 bit */
     size_t i;
     
-    shift = (nitf_Int64) shiftCount;
-    bp64 = (nitf_Int64 *) buffer;
+    mask = ((nitf_Uint64) - 1) >> shiftCount;
+    bp64 = (nitf_Uint64 *) buffer;
     for (i = 0; i < count; i++)
-    {
-        bp8 = (nitf_Uint8 *) bp64;
-        
-        tmp8 = bp8[0];
-        bp8[0] = bp8[7];
-        bp8[7] = tmp8;
-        tmp8 = bp8[1];
-        bp8[1] = bp8[6];
-        bp8[6] = tmp8;
-        tmp8 = bp8[2];
-        bp8[2] = bp8[5];
-        bp8[5] = tmp8;
-        tmp8 = bp8[3];
-        bp8[3] = bp8[4];
-        bp8[4] = tmp8;
-        
-        tmp64 = *bp64 << shift;
-        *(bp64++) = tmp64 >> shift;
-    }
+        *(bp64++) &= mask;
     
     return;
 }
 
 
-void nitf_ImageIO_unformatSwapShift_2(nitf_Uint8 * buffer,
-                                      size_t count,
-                                      nitf_Uint32 shiftCount)
+void nitf_ImageIO_formatShiftSwap_2(nitf_Uint8 * buffer,
+                                    size_t count,
+                                    nitf_Uint32 shiftCount)
 {
     nitf_Int16 shift;           /* Shift count */
     nitf_Uint8 *bp8;            /* Buffer pointer, 8 bit */
@@ -8041,21 +11947,21 @@ void nitf_ImageIO_unformatSwapShift_2(nitf_Uint8 * buffer,
     bp16 = (nitf_Int16 *) buffer;
     for (i = 0; i < count; i++)
     {
-        bp8 = (nitf_Uint8 *) bp16;
+        *bp16 <<= shift;
+
+        bp8 = (nitf_Uint8 *) (bp16++);
         tmp8 = bp8[0];
         bp8[0] = bp8[1];
         bp8[1] = tmp8;
-        
-        *(bp16++) >>= shift;
     }
     
     return;
 }
 
 
-void nitf_ImageIO_unformatSwapShift_4(nitf_Uint8 * buffer,
-                                      size_t count,
-                                      nitf_Uint32 shiftCount)
+void nitf_ImageIO_formatShiftSwap_4(nitf_Uint8 * buffer,
+                                    size_t count,
+                                    nitf_Uint32 shiftCount)
 {
     nitf_Int32 shift;           /* Shift count */
     nitf_Uint8 *bp8;            /* Buffer pointer, 8 bit */
@@ -8067,16 +11973,15 @@ void nitf_ImageIO_unformatSwapShift_4(nitf_Uint8 * buffer,
     bp32 = (nitf_Int32 *) buffer;
     for (i = 0; i < count; i++)
     {
-        bp8 = (nitf_Uint8 *) bp32;
-        
+        *bp32 <<= shift;
+
+        bp8 = (nitf_Uint8 *) (bp32++);
         tmp8 = bp8[0];
         bp8[0] = bp8[3];
         bp8[3] = tmp8;
         tmp8 = bp8[1];
         bp8[1] = bp8[2];
         bp8[2] = tmp8;
-
-        *(bp32++) >>= shift;
     }
     
     return;
@@ -8084,9 +11989,9 @@ void nitf_ImageIO_unformatSwapShift_4(nitf_Uint8 * buffer,
 
 
 /* Uses 64 bit types */
-void nitf_ImageIO_unformatSwapShift_8(nitf_Uint8 * buffer,
-                                      size_t count,
-                                      nitf_Uint32 shiftCount)
+void nitf_ImageIO_formatShiftSwap_8(nitf_Uint8 * buffer,
+                                    size_t count,
+                                    nitf_Uint32 shiftCount)
 {
     nitf_Int64 shift;           /* Shift count */
     nitf_Uint8 *bp8;            /* Buffer pointer, 8 bit */
@@ -8098,8 +12003,9 @@ void nitf_ImageIO_unformatSwapShift_8(nitf_Uint8 * buffer,
     bp64 = (nitf_Int64 *) buffer;
     for (i = 0; i < count; i++)
     {
-        bp8 = (nitf_Uint8 *) bp64;
-        
+        *bp64 <<= shift;
+
+        bp8 = (nitf_Uint8 *) (bp64++);
         tmp8 = bp8[0];
         bp8[0] = bp8[7];
         bp8[7] = tmp8;
@@ -8112,63 +12018,63 @@ void nitf_ImageIO_unformatSwapShift_8(nitf_Uint8 * buffer,
         tmp8 = bp8[3];
         bp8[3] = bp8[4];
         bp8[4] = tmp8;
-        
-        *(bp64++) >>= shift;
     }
     
     return;
 }
 
 
-void nitf_ImageIO_unformatSwapUShift_2(nitf_Uint8 * buffer,
-                                       size_t count,
-                                       nitf_Uint32 shiftCount)
+void nitf_ImageIO_formatMaskSwap_2(nitf_Uint8 * buffer,
+                                   size_t count,
+                                   nitf_Uint32 shiftCount)
 {
-    nitf_Uint16 shift;          /* Shift count */
+    nitf_Uint16 mask;           /* The mask */
     nitf_Uint8 *bp8;            /* Buffer pointer, 8 bit */
     nitf_Uint16 *bp16;          /* Buffer pointer, 16 bit */
     nitf_Uint8 tmp8;            /* Temp value, 8 bit */
     size_t i;
     
-    shift = (nitf_Uint16) shiftCount;
+    mask = ((nitf_Uint16) - 1) >> shiftCount;
     bp16 = (nitf_Uint16 *) buffer;
     for (i = 0; i < count; i++)
     {
         bp8 = (nitf_Uint8 *) bp16;
+
+        *(bp16++) &= mask;
+        
         tmp8 = bp8[0];
         bp8[0] = bp8[1];
         bp8[1] = tmp8;
-        
-        *(bp16++) >>= shift;
     }
     
     return;
 }
 
-void nitf_ImageIO_unformatSwapUShift_4(nitf_Uint8 * buffer,
-                                       size_t count,
-                                       nitf_Uint32 shiftCount)
+
+void nitf_ImageIO_formatMaskSwap_4(nitf_Uint8 * buffer,
+                                   size_t count,
+                                   nitf_Uint32 shiftCount)
 {
-    nitf_Uint32 shift;          /* Shift count */
+    nitf_Uint32 mask;           /* The mask */
     nitf_Uint8 *bp8;            /* Buffer pointer, 8 bit */
     nitf_Uint32 *bp32;          /* Buffer pointer, 32 bit */
     nitf_Uint8 tmp8;            /* Temp value, 8 bit */
     size_t i;
     
-    shift = (nitf_Uint32) shiftCount;
+    mask = ((nitf_Uint32) - 1) >> shiftCount;
     bp32 = (nitf_Uint32 *) buffer;
     for (i = 0; i < count; i++)
     {
         bp8 = (nitf_Uint8 *) bp32;
         
+        *(bp32++) &= mask;
+        
         tmp8 = bp8[0];
         bp8[0] = bp8[3];
         bp8[3] = tmp8;
         tmp8 = bp8[1];
         bp8[1] = bp8[2];
         bp8[2] = tmp8;
-        
-        *(bp32++) >>= shift;
     }
     
     return;
@@ -8176,22 +12082,24 @@ void nitf_ImageIO_unformatSwapUShift_4(nitf_Uint8 * buffer,
 
 
 /* Uses 64 bit types */
-void nitf_ImageIO_unformatSwapUShift_8(nitf_Uint8 * buffer,
-                                       size_t count,
-                                       nitf_Uint32 shiftCount)
+void nitf_ImageIO_formatMaskSwap_8(nitf_Uint8 * buffer,
+                                   size_t count,
+                                   nitf_Uint32 shiftCount)
 {
-    nitf_Uint64 shift;          /* Shift count */
+    nitf_Uint64 mask;           /* The mask */
     nitf_Uint8 *bp8;            /* Buffer pointer, 8 bit */
     nitf_Uint64 *bp64;          /* Buffer pointer, 64 bit */
     nitf_Uint8 tmp8;            /* Temp value, 8 bit */
     size_t i;
     
-    shift = (nitf_Uint64) shiftCount;
+    mask = ((nitf_Uint64) - 1) >> shiftCount;
     bp64 = (nitf_Uint64 *) buffer;
     for (i = 0; i < count; i++)
     {
         bp8 = (nitf_Uint8 *) bp64;
         
+        *(bp64++) &= mask;
+        
         tmp8 = bp8[0];
         bp8[0] = bp8[7];
         bp8[7] = tmp8;
@@ -8204,606 +12112,881 @@ void nitf_ImageIO_unformatSwapUShift_8(nitf_Uint8 * buffer,
         tmp8 = bp8[3];
         bp8[3] = bp8[4];
         bp8[4] = tmp8;
-        
-        *(bp64++) >>= shift;
     }
     
     return;
 }
 
 
-void nitf_ImageIO_unpack_P_1(_nitf_ImageIOBlock * blockIO,
-                             nitf_Error * error)
-{
-    nitf_Uint8 *src;            /* Source buffer */
-    nitf_Uint8 *dst;            /* Destination buffer */
-    size_t count;               /* Number of pixels to transfer */
-    nitf_Uint32 skip;           /* Source buffer skip count */
-    size_t i;
-    
-    /* Silence compiler warnings about unused variables */
-    (void)error;
+/*============================================================================*/
+/*======================== Vector unformat and format ========================*/
+/*============================================================================*/
 
-    src = (nitf_Uint8 *) (blockIO->rwBuffer.buffer
-                          + blockIO->rwBuffer.offset.mark);
-    dst = (nitf_Uint8 *) (blockIO->unpacked.buffer
-                          + blockIO->unpacked.offset.mark);
-    count = blockIO->pixelCountFR;
-    skip = blockIO->cntl->nitf->numBands;
+/*
+ * Operations done by the vector kernels. Each one includes a byte swap, and
+ * they match the scalar functions named in the comments
+ */
 
-    for (i = 0; i < count; i++)
-    {
-        *(dst++) = *src;
-        src += skip;
-    }
-    return;
-}
+#define NITF_IMAGE_IO_VEC_SWAP        0 /* swapOnly */
+#define NITF_IMAGE_IO_VEC_SWAP_EXTEND 1 /* unformatSwapExtend */
+#define NITF_IMAGE_IO_VEC_SWAP_SHIFT  2 /* unformatSwapShift */
+#define NITF_IMAGE_IO_VEC_SWAP_USHIFT 3 /* unformatSwapUShift */
+#define NITF_IMAGE_IO_VEC_SHIFT_SWAP  4 /* formatShiftSwap */
+#define NITF_IMAGE_IO_VEC_MASK_SWAP   5 /* formatMaskSwap */
 
+/*
+ * Wrapper generator. The kernel does the whole vectors in the buffer and
+ * the scalar function finishes the remaining pixels. "elements" is the
+ * number of swapped values per pixel (two for complex pixels)
+ */
 
-void nitf_ImageIO_unpack_P_2(_nitf_ImageIOBlock * blockIO,
-                             nitf_Error * error)
-{
-    nitf_Uint16 *src;           /* Source buffer */
-    nitf_Uint16 *dst;           /* Destination buffer */
-    size_t count;               /* Number of pixels to transfer */
-    nitf_Uint32 skip;           /* Source buffer skip count */
+#define NITF_IMAGE_IO_VEC_WRAPPER(isa, name, bytes, elements, op)            \
+NITFPRIV(void) nitf_ImageIO_##name##_##isa(nitf_Uint8 * buffer,              \
+        size_t count, nitf_Uint32 shiftCount)                                \
+{                                                                            \
+    size_t done;  /* Bytes done by the kernel */                             \
+                                                                             \
+    done = nitf_ImageIO_##isa##Kernel(buffer,                                \
+            count * (bytes) * (elements), bytes, op, shiftCount);            \
+    nitf_ImageIO_##name(buffer + done,                                       \
+            count - done / ((bytes) * (elements)), shiftCount);              \
+}
+
+#define NITF_IMAGE_IO_VEC_WRAPPERS(isa)                                      \
+NITF_IMAGE_IO_VEC_WRAPPER(isa, swapOnly_2, 2, 1, NITF_IMAGE_IO_VEC_SWAP)     \
+NITF_IMAGE_IO_VEC_WRAPPER(isa, swapOnly_4, 4, 1, NITF_IMAGE_IO_VEC_SWAP)     \
+NITF_IMAGE_IO_VEC_WRAPPER(isa, swapOnly_8, 8, 1, NITF_IMAGE_IO_VEC_SWAP)     \
+NITF_IMAGE_IO_VEC_WRAPPER(isa, swapOnly_4c, 2, 2, NITF_IMAGE_IO_VEC_SWAP)    \
+NITF_IMAGE_IO_VEC_WRAPPER(isa, swapOnly_8c, 4, 2, NITF_IMAGE_IO_VEC_SWAP)    \
+NITF_IMAGE_IO_VEC_WRAPPER(isa, swapOnly_16c, 8, 2, NITF_IMAGE_IO_VEC_SWAP)   \
+NITF_IMAGE_IO_VEC_WRAPPER(isa, unformatSwapExtend_2, 2, 1,                   \
+                          NITF_IMAGE_IO_VEC_SWAP_EXTEND)                     \
+NITF_IMAGE_IO_VEC_WRAPPER(isa, unformatSwapExtend_4, 4, 1,                   \
+                          NITF_IMAGE_IO_VEC_SWAP_EXTEND)                     \
+NITF_IMAGE_IO_VEC_WRAPPER(isa, unformatSwapShift_2, 2, 1,                    \
+                          NITF_IMAGE_IO_VEC_SWAP_SHIFT)                      \
+NITF_IMAGE_IO_VEC_WRAPPER(isa, unformatSwapShift_4, 4, 1,                    \
+                          NITF_IMAGE_IO_VEC_SWAP_SHIFT)                      \
+NITF_IMAGE_IO_VEC_WRAPPER(isa, unformatSwapUShift_2, 2, 1,                   \
+                          NITF_IMAGE_IO_VEC_SWAP_USHIFT)                     \
+NITF_IMAGE_IO_VEC_WRAPPER(isa, unformatSwapUShift_4, 4, 1,                   \
+                          NITF_IMAGE_IO_VEC_SWAP_USHIFT)                     \
+NITF_IMAGE_IO_VEC_WRAPPER(isa, unformatSwapUShift_8, 8, 1,                   \
+                          NITF_IMAGE_IO_VEC_SWAP_USHIFT)                     \
+NITF_IMAGE_IO_VEC_WRAPPER(isa, formatShiftSwap_2, 2, 1,                      \
+                          NITF_IMAGE_IO_VEC_SHIFT_SWAP)                      \
+NITF_IMAGE_IO_VEC_WRAPPER(isa, formatShiftSwap_4, 4, 1,                      \
+                          NITF_IMAGE_IO_VEC_SHIFT_SWAP)                      \
+NITF_IMAGE_IO_VEC_WRAPPER(isa, formatShiftSwap_8, 8, 1,                      \
+                          NITF_IMAGE_IO_VEC_SHIFT_SWAP)                      \
+NITF_IMAGE_IO_VEC_WRAPPER(isa, formatMaskSwap_2, 2, 1,                       \
+                          NITF_IMAGE_IO_VEC_MASK_SWAP)                       \
+NITF_IMAGE_IO_VEC_WRAPPER(isa, formatMaskSwap_4, 4, 1,                       \
+                          NITF_IMAGE_IO_VEC_MASK_SWAP)                       \
+NITF_IMAGE_IO_VEC_WRAPPER(isa, formatMaskSwap_8, 8, 1,                       \
+                          NITF_IMAGE_IO_VEC_MASK_SWAP)
+
+#ifdef NITF_IMAGE_IO_SSE2
+
+NITFPRIV(size_t) nitf_ImageIO_sse2Kernel(nitf_Uint8 * buffer,
+                                         size_t byteCount,
+                                         nitf_Uint32 bytes,
+                                         int op,
+                                         nitf_Uint32 shiftCount)
+{
+    __m128i shift;  /* Shift count */
+    __m128i mask;   /* Mask of the actual bits */
+    __m128i v;      /* Current vector */
+    __m128i *vp;    /* Vector pointer */
     size_t i;
-    
-    /* Silence compiler warnings about unused variables */
-    (void)error;
 
-    src = (nitf_Uint16 *) (blockIO->rwBuffer.buffer
-                           + blockIO->rwBuffer.offset.mark);
-    dst = (nitf_Uint16 *) (blockIO->unpacked.buffer
-                           + blockIO->unpacked.offset.mark);
-    count = blockIO->pixelCountFR;
-    skip = blockIO->cntl->nitf->numBands;
-    
-    for (i = 0; i < count; i++)
+    shift = _mm_cvtsi32_si128((int) shiftCount);
+    if (bytes == 2)
+        mask = _mm_srl_epi16(_mm_set1_epi32(-1), shift);
+    else if (bytes == 4)
+        mask = _mm_srl_epi32(_mm_set1_epi32(-1), shift);
+    else
+        mask = _mm_srl_epi64(_mm_set1_epi32(-1), shift);
+
+    for (i = 0; i + sizeof(__m128i) <= byteCount; i += sizeof(__m128i))
     {
-        *(dst++) = *src;
-        src += skip;
-    }
-    return;
-}
+        vp = (__m128i *) (buffer + i);
+        v = _mm_loadu_si128(vp);
 
+        /* Format operations come before the swap */
+        if (op == NITF_IMAGE_IO_VEC_SHIFT_SWAP)
+        {
+            if (bytes == 2)
+                v = _mm_sll_epi16(v, shift);
+            else if (bytes == 4)
+                v = _mm_sll_epi32(v, shift);
+            else
+                v = _mm_sll_epi64(v, shift);
+        }
+        else if (op == NITF_IMAGE_IO_VEC_MASK_SWAP)
+            v = _mm_and_si128(v, mask);
 
-void nitf_ImageIO_unpack_P_4(_nitf_ImageIOBlock * blockIO,
-                             nitf_Error * error)
-{
-    nitf_Uint32 *src;           /* Source buffer */
-    nitf_Uint32 *dst;           /* Destination buffer */
-    size_t count;               /* Number of pixels to transfer */
-    nitf_Uint32 skip;           /* Source buffer skip count */
-    size_t i;
-    
-    /* Silence compiler warnings about unused variables */
-    (void)error;
+        /* Reverse the 16-bit words of each value, then the bytes of each */
+        if (bytes == 4)
+        {
+            v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+            v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+        }
+        else if (bytes == 8)
+        {
+            v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+            v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+        }
+        v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
 
-    src = (nitf_Uint32 *) (blockIO->rwBuffer.buffer
-                           + blockIO->rwBuffer.offset.mark);
-    dst = (nitf_Uint32 *) (blockIO->unpacked.buffer
-                           + blockIO->unpacked.offset.mark);
-    count = blockIO->pixelCountFR;
-    skip = blockIO->cntl->nitf->numBands;
-    
-    for (i = 0; i < count; i++)
-    {
-        *(dst++) = *src;
-        src += skip;
+        /* Unformat operations come after the swap */
+        if (op == NITF_IMAGE_IO_VEC_SWAP_EXTEND)
+        {
+            if (bytes == 2)
+                v = _mm_sra_epi16(_mm_sll_epi16(v, shift), shift);
+            else
+                v = _mm_sra_epi32(_mm_sll_epi32(v, shift), shift);
+        }
+        else if (op == NITF_IMAGE_IO_VEC_SWAP_SHIFT)
+        {
+            if (bytes == 2)
+                v = _mm_sra_epi16(v, shift);
+            else
+                v = _mm_sra_epi32(v, shift);
+        }
+        else if (op == NITF_IMAGE_IO_VEC_SWAP_USHIFT)
+        {
+            if (bytes == 2)
+                v = _mm_srl_epi16(v, shift);
+            else if (bytes == 4)
+                v = _mm_srl_epi32(v, shift);
+            else
+                v = _mm_srl_epi64(v, shift);
+        }
+
+        _mm_storeu_si128(vp, v);
     }
-    return;
+
+    return i;
 }
 
+NITF_IMAGE_IO_VEC_WRAPPERS(sse2)
 
-void nitf_ImageIO_unpack_P_8(_nitf_ImageIOBlock * blockIO,
-                             nitf_Error * error)
-{
-    nitf_Uint64 *src;           /* Source buffer */
-    nitf_Uint64 *dst;           /* Destination buffer */
-    size_t count;               /* Number of pixels to transfer */
-    nitf_Uint32 skip;           /* Source buffer skip count */
+#endif
+
+#ifdef NITF_IMAGE_IO_AVX2
+
+NITF_IMAGE_IO_TARGET_AVX2
+NITFPRIV(size_t) nitf_ImageIO_avx2Kernel(nitf_Uint8 * buffer,
+                                         size_t byteCount,
+                                         nitf_Uint32 bytes,
+                                         int op,
+                                         nitf_Uint32 shiftCount)
+{
+    nitf_Uint8 order[32]; /* Byte shuffle that reverses each value */
+    __m256i swap;         /* Byte shuffle vector */
+    __m128i shift;        /* Shift count */
+    __m256i mask;         /* Mask of the actual bits */
+    __m256i v;            /* Current vector */
+    __m256i *vp;          /* Vector pointer */
     size_t i;
-    
-    /* Silence compiler warnings about unused variables */
-    (void)error;
 
-    src = (nitf_Uint64 *) (blockIO->rwBuffer.buffer
-                           + blockIO->rwBuffer.offset.mark);
-    dst = (nitf_Uint64 *) (blockIO->unpacked.buffer
-                           + blockIO->unpacked.offset.mark);
-    count = blockIO->pixelCountFR;
-    skip = blockIO->cntl->nitf->numBands;
-    
-    for (i = 0; i < count; i++)
+    for (i = 0; i < sizeof(order); i++)
+        order[i] = (nitf_Uint8) ((i & 15) - (i % bytes)
+                                 + (bytes - 1 - (i % bytes)));
+    swap = _mm256_loadu_si256((const __m256i *) order);
+
+    shift = _mm_cvtsi32_si128((int) shiftCount);
+    if (bytes == 2)
+        mask = _mm256_srl_epi16(_mm256_set1_epi32(-1), shift);
+    else if (bytes == 4)
+        mask = _mm256_srl_epi32(_mm256_set1_epi32(-1), shift);
+    else
+        mask = _mm256_srl_epi64(_mm256_set1_epi32(-1), shift);
+
+    for (i = 0; i + sizeof(__m256i) <= byteCount; i += sizeof(__m256i))
     {
-        *(dst++) = *src;
-        src += skip;
-    }
-    return;
-}
+        vp = (__m256i *) (buffer + i);
+        v = _mm256_loadu_si256(vp);
 
+        if (op == NITF_IMAGE_IO_VEC_SHIFT_SWAP)
+        {
+            if (bytes == 2)
+                v = _mm256_sll_epi16(v, shift);
+            else if (bytes == 4)
+                v = _mm256_sll_epi32(v, shift);
+            else
+                v = _mm256_sll_epi64(v, shift);
+        }
+        else if (op == NITF_IMAGE_IO_VEC_MASK_SWAP)
+            v = _mm256_and_si256(v, mask);
 
-void nitf_ImageIO_unpack_P_16(_nitf_ImageIOBlock * blockIO,
-                              nitf_Error * error)
-{
-    nitf_Uint64 *src1;          /* Source buffer 1 */
-    nitf_Uint64 *dst1;          /* Destination buffer 1 */
-    nitf_Uint64 *src2;          /* Source buffer 2 */
-    nitf_Uint64 *dst2;          /* Destination buffer 2 */
-    size_t count;               /* Number of pixels to transfer */
-    nitf_Uint32 skip;           /* Source buffer skip count */
-    size_t i;
-    
-    /* Silence compiler warnings about unused variables */
-    (void)error;
+        v = _mm256_shuffle_epi8(v, swap);
 
-    src1 = (nitf_Uint64 *) (blockIO->rwBuffer.buffer
-                            + blockIO->rwBuffer.offset.mark);
-    dst1 = (nitf_Uint64 *) (blockIO->unpacked.buffer
-                            + blockIO->unpacked.offset.mark);
-    src2 = src1 + 1;
-    dst2 = dst1 + 1;
-    count = blockIO->pixelCountFR;
-    skip = blockIO->cntl->nitf->numBands * 2;
-    
-    for (i = 0; i < count; i++)
-    {
-        *(dst1++) = *src1;
-        *(dst2++) = *src2;
-        src1 += skip;
-        src2 += skip;
+        if (op == NITF_IMAGE_IO_VEC_SWAP_EXTEND)
+        {
+            if (bytes == 2)
+                v = _mm256_sra_epi16(_mm256_sll_epi16(v, shift), shift);
+            else
+                v = _mm256_sra_epi32(_mm256_sll_epi32(v, shift), shift);
+        }
+        else if (op == NITF_IMAGE_IO_VEC_SWAP_SHIFT)
+        {
+            if (bytes == 2)
+                v = _mm256_sra_epi16(v, shift);
+            else
+                v = _mm256_sra_epi32(v, shift);
+        }
+        else if (op == NITF_IMAGE_IO_VEC_SWAP_USHIFT)
+        {
+            if (bytes == 2)
+                v = _mm256_srl_epi16(v, shift);
+            else if (bytes == 4)
+                v = _mm256_srl_epi32(v, shift);
+            else
+                v = _mm256_srl_epi64(v, shift);
+        }
+
+        _mm256_storeu_si256(vp, v);
     }
-    return;
+
+    return i;
 }
 
-void nitf_ImageIO_pack_P_1(_nitf_ImageIOBlock * blockIO, nitf_Error * error)
+NITF_IMAGE_IO_VEC_WRAPPERS(avx2)
+
+NITFPRIV(int) nitf_ImageIO_cpuHasAVX2(void)
 {
-    nitf_Uint8 *src;            /* Source buffer */
-    nitf_Uint8 *dst;            /* Destination buffer */
-    size_t count;               /* Number of pixels to transfer */
-    nitf_Uint32 skip;           /* Source buffer skip count */
-    size_t i;
-    
-    /* Silence compiler warnings about unused variables */
-    (void)error;
+#if defined(_MSC_VER)
+    int info[4];    /* CPUID registers */
 
-    src = (nitf_Uint8 *) (blockIO->user.buffer + blockIO->user.offset.mark);
-    dst = (nitf_Uint8 *) (blockIO->rwBuffer.buffer);
-    dst += blockIO->band;
-    count = blockIO->pixelCountFR;
-    skip = blockIO->cntl->nitf->numBands;
-    
-    for (i = 0; i < count; i++)
-    {
-        *dst = *(src++);
-        dst += skip;
-    }
-    return;
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return 0;
+
+    /* The OS must save the AVX registers (OSXSAVE, AVX and XCR0) */
+    __cpuid(info, 1);
+    if (((info[2] >> 27) & 1) == 0 || ((info[2] >> 28) & 1) == 0)
+        return 0;
+    if ((_xgetbv(0) & 6) != 6)
+        return 0;
+
+    __cpuidex(info, 7, 0);
+    return (info[1] >> 5) & 1;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+#endif
 }
 
+#endif
 
-void nitf_ImageIO_pack_P_2(_nitf_ImageIOBlock * blockIO, nitf_Error * error)
-{
-    nitf_Uint16 *src;           /* Source buffer */
-    nitf_Uint16 *dst;           /* Destination buffer */
-    size_t count;               /* Number of pixels to transfer */
-    nitf_Uint32 skip;           /* Source buffer skip count */
-    size_t i;
-    
-    /* Silence compiler warnings about unused variables */
-    (void)error;
+/*
+ * Scalar functions with vector versions. Declared as the unformat type but
+ * the format functions have the same signature
+ */
 
-    src = (nitf_Uint16 *) (blockIO->user.buffer + blockIO->user.offset.mark);
-    dst = (nitf_Uint16 *) (blockIO->rwBuffer.buffer);
-    dst += blockIO->band;
-    count = blockIO->pixelCountFR;
-    skip = blockIO->cntl->nitf->numBands;
-    
-    for (i = 0; i < count; i++)
-    {
-        *dst = *(src++);
-        dst += skip;
-    }
-    return;
-}
+#if defined(NITF_IMAGE_IO_SSE2)
 
+#ifdef NITF_IMAGE_IO_AVX2
+#define NITF_IMAGE_IO_VEC_ENTRY(name)                                        \
+    { nitf_ImageIO_##name, nitf_ImageIO_##name##_sse2,                        \
+      nitf_ImageIO_##name##_avx2 }
+#else
+#define NITF_IMAGE_IO_VEC_ENTRY(name)                                        \
+    { nitf_ImageIO_##name, nitf_ImageIO_##name##_sse2, NULL }
+#endif
 
-void nitf_ImageIO_pack_P_4(_nitf_ImageIOBlock * blockIO, nitf_Error * error)
+typedef struct
 {
-    nitf_Uint32 *src;           /* Source buffer */
-    nitf_Uint32 *dst;           /* Destination buffer */
-    size_t count;               /* Number of pixels to transfer */
-    nitf_Uint32 skip;           /* Source buffer skip count */
-    size_t i;
-    
-    /* Silence compiler warnings about unused variables */
-    (void)error;
-
-    src = (nitf_Uint32 *) (blockIO->user.buffer + blockIO->user.offset.mark);
-    dst = (nitf_Uint32 *) (blockIO->rwBuffer.buffer);
-    dst += blockIO->band;
-    count = blockIO->pixelCountFR;
-    skip = blockIO->cntl->nitf->numBands;
-    
-    for (i = 0; i < count; i++)
-    {
-        *dst = *(src++);
-        dst += skip;
-    }
-    return;
-}
+    /* The scalar function */
+    _NITF_IMAGE_IO_UNFORMAT_FUNC scalar;
+
+    /* SSE2 version */
+    _NITF_IMAGE_IO_UNFORMAT_FUNC sse2;
+
+    /* AVX2 version, NULL if not built */
+    _NITF_IMAGE_IO_UNFORMAT_FUNC avx2;
+}
+vectorTable;
+
+static vectorTable VECTOR_TABLE[] =
+{
+    NITF_IMAGE_IO_VEC_ENTRY(swapOnly_2),
+    NITF_IMAGE_IO_VEC_ENTRY(swapOnly_4),
+    NITF_IMAGE_IO_VEC_ENTRY(swapOnly_8),
+    NITF_IMAGE_IO_VEC_ENTRY(swapOnly_4c),
+    NITF_IMAGE_IO_VEC_ENTRY(swapOnly_8c),
+    NITF_IMAGE_IO_VEC_ENTRY(swapOnly_16c),
+    NITF_IMAGE_IO_VEC_ENTRY(unformatSwapExtend_2),
+    NITF_IMAGE_IO_VEC_ENTRY(unformatSwapExtend_4),
+    NITF_IMAGE_IO_VEC_ENTRY(unformatSwapShift_2),
+    NITF_IMAGE_IO_VEC_ENTRY(unformatSwapShift_4),
+    NITF_IMAGE_IO_VEC_ENTRY(unformatSwapUShift_2),
+    NITF_IMAGE_IO_VEC_ENTRY(unformatSwapUShift_4),
+    NITF_IMAGE_IO_VEC_ENTRY(unformatSwapUShift_8),
+    NITF_IMAGE_IO_VEC_ENTRY(formatShiftSwap_2),
+    NITF_IMAGE_IO_VEC_ENTRY(formatShiftSwap_4),
+    NITF_IMAGE_IO_VEC_ENTRY(formatShiftSwap_8),
+    NITF_IMAGE_IO_VEC_ENTRY(formatMaskSwap_2),
+    NITF_IMAGE_IO_VEC_ENTRY(formatMaskSwap_4),
+    NITF_IMAGE_IO_VEC_ENTRY(formatMaskSwap_8)
+};
 
+#endif
 
-void nitf_ImageIO_pack_P_8(_nitf_ImageIOBlock * blockIO, nitf_Error * error)
+NITFPRIV(_NITF_IMAGE_IO_UNFORMAT_FUNC) nitf_ImageIO_vectorKernel
+(_NITF_IMAGE_IO_UNFORMAT_FUNC func)
 {
-    nitf_Uint64 *src;           /* Source buffer */
-    nitf_Uint64 *dst;           /* Destination buffer */
-    size_t count;               /* Number of pixels to transfer */
-    nitf_Uint32 skip;           /* Source buffer skip count */
+#if defined(NITF_IMAGE_IO_SSE2)
     size_t i;
-    
-    /* Silence compiler warnings about unused variables */
-    (void)error;
 
-    src = (nitf_Uint64 *) (blockIO->user.buffer + blockIO->user.offset.mark);
-    dst = (nitf_Uint64 *) (blockIO->rwBuffer.buffer);
-    dst += blockIO->band;
-    count = blockIO->pixelCountFR;
-    skip = blockIO->cntl->nitf->numBands;
-    
-    for (i = 0; i < count; i++)
+    if (func == NULL)
+        return NULL;
+
+    for (i = 0; i < sizeof(VECTOR_TABLE) / sizeof(VECTOR_TABLE[0]); i++)
     {
-        *dst = *(src++);
-        dst += skip;
+        if (VECTOR_TABLE[i].scalar != func)
+            continue;
+
+#ifdef NITF_IMAGE_IO_AVX2
+        if (nitf_ImageIO_cpuHasAVX2())
+            return VECTOR_TABLE[i].avx2;
+#endif
+        return VECTOR_TABLE[i].sse2;
     }
-    return;
+#endif
+
+    return func;
 }
 
 
-void nitf_ImageIO_pack_P_16(_nitf_ImageIOBlock * blockIO, nitf_Error * error)
+/*
+ * Band interleave kernels. The SSE2 kernels handle 2, 4 and 8 bands by
+ * repeatedly splitting the even and odd pixels of a group of vectors until
+ * each vector holds one band. The AVX2 kernels handle 3 bands with one byte
+ * shuffle per band and vector
+ */
+
+#ifdef NITF_IMAGE_IO_SSE2
+
+/* Split the even and odd elements of two vectors */
+NITFPRIV(void) nitf_ImageIO_sse2Split(const __m128i * a, const __m128i * b,
+                                      nitf_Uint32 bytes,
+                                      __m128i * even, __m128i * odd)
 {
-    nitf_Uint64 *src1;          /* Source buffer 1 */
-    nitf_Uint64 *dst1;          /* Destination buffer 1 */
-    nitf_Uint64 *src2;          /* Source buffer 2 */
-    nitf_Uint64 *dst2;          /* Destination buffer 2 */
-    size_t count;               /* Number of pixels to transfer */
-    nitf_Uint32 skip;           /* Source buffer skip count */
-    size_t i;
-    
-    /* Silence compiler warnings about unused variables */
-    (void)error;
+    __m128i mask;   /* Low byte mask */
+    __m128i aa;     /* Elements of a in even, odd order */
+    __m128i bb;     /* Elements of b in even, odd order */
 
-    src1 = (nitf_Uint64 *) (blockIO->user.buffer + blockIO->user.offset.mark);
-    dst1 = (nitf_Uint64 *) (blockIO->rwBuffer.buffer);
-    dst1 += blockIO->band;
-    src2 = src1 + 1;
-    dst2 = dst1 + 1;
-    count = blockIO->pixelCountFR;
-    skip = blockIO->cntl->nitf->numBands * 2;
-    
-    for (i = 0; i < count; i++)
+    switch (bytes)
     {
-        *dst1 = *(src1++);
-        *dst2 = *(src2++);
-        dst1 += skip;
-        dst2 += skip;
+        case 1:
+            mask = _mm_set1_epi16(0x00ff);
+            *even = _mm_packus_epi16(_mm_and_si128(*a, mask),
+                                     _mm_and_si128(*b, mask));
+            *odd = _mm_packus_epi16(_mm_srli_epi16(*a, 8),
+                                    _mm_srli_epi16(*b, 8));
+            break;
+        case 2:
+            /* Sign extend so the signed pack does not saturate */
+            *even = _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(*a, 16), 16),
+                                    _mm_srai_epi32(_mm_slli_epi32(*b, 16), 16));
+            *odd = _mm_packs_epi32(_mm_srai_epi32(*a, 16),
+                                   _mm_srai_epi32(*b, 16));
+            break;
+        case 4:
+            aa = _mm_shuffle_epi32(*a, _MM_SHUFFLE(3, 1, 2, 0));
+            bb = _mm_shuffle_epi32(*b, _MM_SHUFFLE(3, 1, 2, 0));
+            *even = _mm_unpacklo_epi64(aa, bb);
+            *odd = _mm_unpackhi_epi64(aa, bb);
+            break;
+        default:
+            *even = _mm_unpacklo_epi64(*a, *b);
+            *odd = _mm_unpackhi_epi64(*a, *b);
+            break;
     }
-    return;
 }
 
-void nitf_ImageIO_formatShift_1(nitf_Uint8 * buffer,
-        size_t count, nitf_Uint32 shiftCount)
+/* Merge even and odd elements, the inverse of nitf_ImageIO_sse2Split */
+NITFPRIV(void) nitf_ImageIO_sse2Merge(const __m128i * even,
+                                      const __m128i * odd,
+                                      nitf_Uint32 bytes,
+                                      __m128i * a, __m128i * b)
 {
-    nitf_Int8 shift;            /* Shift count */
-    nitf_Int8 *bp8;             /* Buffer pointer, 8 bit */
-    size_t i;
-    
-    shift = (nitf_Int8) shiftCount;
-    bp8 = (nitf_Int8 *) buffer;
-    for (i = 0; i < count; i++)
-        *(bp8++) <<= shift;
-    
-    return;
+    switch (bytes)
+    {
+        case 1:
+            *a = _mm_unpacklo_epi8(*even, *odd);
+            *b = _mm_unpackhi_epi8(*even, *odd);
+            break;
+        case 2:
+            *a = _mm_unpacklo_epi16(*even, *odd);
+            *b = _mm_unpackhi_epi16(*even, *odd);
+            break;
+        case 4:
+            *a = _mm_unpacklo_epi32(*even, *odd);
+            *b = _mm_unpackhi_epi32(*even, *odd);
+            break;
+        default:
+            *a = _mm_unpacklo_epi64(*even, *odd);
+            *b = _mm_unpackhi_epi64(*even, *odd);
+            break;
+    }
 }
 
+/*
+ * Kernel generators, one kernel per band count and pixel size so the split
+ * and merge loops unroll. Each split pass separates the even and odd
+ * elements of the whole group of vectors, after log2(bands) passes vector
+ * j holds band j. The merge passes are the inverse
+ */
 
-void nitf_ImageIO_formatShift_2(nitf_Uint8 * buffer,
-        size_t count, nitf_Uint32 shiftCount)
-{
-    nitf_Int16 shift;           /* Shift count */
-    nitf_Int16 *bp16;           /* Buffer pointer, 16 bit */
-    size_t i;
-    
-    shift = (nitf_Int16) shiftCount;
-    bp16 = (nitf_Int16 *) buffer;
-    for (i = 0; i < count; i++)
-        *(bp16++) <<= shift;
-    
-    return;
-}
-
+#define NITF_IMAGE_IO_SSE2_PASSES(bands)                                     \
+    (((bands) == 2) ? 1 : (((bands) == 4) ? 2 : 3))
+
+#define NITF_IMAGE_IO_SSE2_DEINTERLEAVE(bands, bytes)                        \
+NITFPRIV(size_t) nitf_ImageIO_sse2Deinterleave_##bands##_##bytes             \
+(const nitf_Uint8 * src, nitf_Uint8 ** dst, size_t count)                    \
+{                                                                            \
+    __m128i v[bands];   /* Vectors being split */                            \
+    __m128i t[bands];   /* Split vectors */                                  \
+    int pass;           /* Current split pass */                             \
+    int j;                                                                   \
+    size_t i;                                                                \
+                                                                             \
+    for (i = 0; i + 16 / (bytes) <= count; i += 16 / (bytes))                \
+    {                                                                        \
+        for (j = 0; j < (bands); j++)                                        \
+            v[j] = _mm_loadu_si128((const __m128i *)                         \
+                                   (src + i * (bands) * (bytes) + j * 16));  \
+                                                                             \
+        for (pass = 0; pass < NITF_IMAGE_IO_SSE2_PASSES(bands); pass++)      \
+        {                                                                    \
+            for (j = 0; j < (bands) / 2; j++)                                \
+                nitf_ImageIO_sse2Split(&(v[2 * j]), &(v[2 * j + 1]), bytes,  \
+                                       &(t[j]), &(t[(bands) / 2 + j]));      \
+            for (j = 0; j < (bands); j++)                                    \
+                v[j] = t[j];                                                 \
+        }                                                                    \
+                                                                             \
+        for (j = 0; j < (bands); j++)                                        \
+            if (dst[j] != NULL)                                              \
+                _mm_storeu_si128((__m128i *) (dst[j] + i * (bytes)), v[j]);  \
+    }                                                                        \
+    return i;                                                                \
+}
+
+#define NITF_IMAGE_IO_SSE2_INTERLEAVE(bands, bytes)                          \
+NITFPRIV(size_t) nitf_ImageIO_sse2Interleave_##bands##_##bytes               \
+(nitf_Uint8 ** src, nitf_Uint8 * dst, size_t count)                          \
+{                                                                            \
+    __m128i v[bands];   /* Vectors being merged */                           \
+    __m128i t[bands];   /* Merged vectors */                                 \
+    int pass;           /* Current merge pass */                             \
+    int j;                                                                   \
+    size_t i;                                                                \
+                                                                             \
+    for (i = 0; i + 16 / (bytes) <= count; i += 16 / (bytes))                \
+    {                                                                        \
+        for (j = 0; j < (bands); j++)                                        \
+            v[j] = _mm_loadu_si128((const __m128i *)                         \
+                                   (src[j] + i * (bytes)));                  \
+                                                                             \
+        for (pass = 0; pass < NITF_IMAGE_IO_SSE2_PASSES(bands); pass++)      \
+        {                                                                    \
+            for (j = 0; j < (bands) / 2; j++)                                \
+                nitf_ImageIO_sse2Merge(&(v[j]), &(v[(bands) / 2 + j]),       \
+                                       bytes, &(t[2 * j]), &(t[2 * j + 1])); \
+            for (j = 0; j < (bands); j++)                                    \
+                v[j] = t[j];                                                 \
+        }                                                                    \
+                                                                             \
+        for (j = 0; j < (bands); j++)                                        \
+            _mm_storeu_si128((__m128i *) (dst + i * (bands) * (bytes)        \
+                                          + j * 16), v[j]);                  \
+    }                                                                        \
+    return i;                                                                \
+}
+
+#define NITF_IMAGE_IO_SSE2_INTERLEAVE_KERNELS(bands)                         \
+NITF_IMAGE_IO_SSE2_DEINTERLEAVE(bands, 1)                                    \
+NITF_IMAGE_IO_SSE2_DEINTERLEAVE(bands, 2)                                    \
+NITF_IMAGE_IO_SSE2_DEINTERLEAVE(bands, 4)                                    \
+NITF_IMAGE_IO_SSE2_DEINTERLEAVE(bands, 8)                                    \
+NITF_IMAGE_IO_SSE2_INTERLEAVE(bands, 1)                                      \
+NITF_IMAGE_IO_SSE2_INTERLEAVE(bands, 2)                                      \
+NITF_IMAGE_IO_SSE2_INTERLEAVE(bands, 4)                                      \
+NITF_IMAGE_IO_SSE2_INTERLEAVE(bands, 8)
+
+NITF_IMAGE_IO_SSE2_INTERLEAVE_KERNELS(2)
+NITF_IMAGE_IO_SSE2_INTERLEAVE_KERNELS(4)
+NITF_IMAGE_IO_SSE2_INTERLEAVE_KERNELS(8)
+
+typedef size_t (*_NITF_IMAGE_IO_DEINTERLEAVE_FUNC)
+(const nitf_Uint8 * src, nitf_Uint8 ** dst, size_t count);
+
+typedef size_t (*_NITF_IMAGE_IO_INTERLEAVE_FUNC)
+(nitf_Uint8 ** src, nitf_Uint8 * dst, size_t count);
+
+#define NITF_IMAGE_IO_SSE2_INTERLEAVE_ENTRY(bands)                           \
+    { bands,                                                                 \
+      { nitf_ImageIO_sse2Deinterleave_##bands##_1,                           \
+        nitf_ImageIO_sse2Deinterleave_##bands##_2,                           \
+        nitf_ImageIO_sse2Deinterleave_##bands##_4,                           \
+        nitf_ImageIO_sse2Deinterleave_##bands##_8 },                         \
+      { nitf_ImageIO_sse2Interleave_##bands##_1,                             \
+        nitf_ImageIO_sse2Interleave_##bands##_2,                             \
+        nitf_ImageIO_sse2Interleave_##bands##_4,                             \
+        nitf_ImageIO_sse2Interleave_##bands##_8 } }
 
-void nitf_ImageIO_formatShift_4(nitf_Uint8 * buffer,
-        size_t count, nitf_Uint32 shiftCount)
+typedef struct
 {
-    nitf_Int32 shift;           /* Shift count */
-    nitf_Int32 *bp32;           /* Buffer pointer, 32 bit */
-    size_t i;
-    
-    shift = (nitf_Int32) shiftCount;
-    bp32 = (nitf_Int32 *) buffer;
-    for (i = 0; i < count; i++)
-        *(bp32++) <<= shift;
-    
-    return;
-}
+    /* Number of bands */
+    nitf_Uint32 bands;
 
+    /* Deinterleave kernels for 1, 2, 4 and 8 byte pixels */
+    _NITF_IMAGE_IO_DEINTERLEAVE_FUNC deinterleave[4];
 
-/* Uses 64 bit types */
-
-void nitf_ImageIO_formatShift_8(nitf_Uint8 * buffer,
-        size_t count, nitf_Uint32 shiftCount)
-{
-    nitf_Int64 shift;           /* Shift count */
-    nitf_Int64 *bp64;           /* Buffer pointer, 64 bit */
-    size_t i;
-    
-    shift = (nitf_Int64) shiftCount;
-    bp64 = (nitf_Int64 *) buffer;
-    for (i = 0; i < count; i++)
-        *(bp64++) <<= shift;
-    
-    return;
+    /* Interleave kernels for 1, 2, 4 and 8 byte pixels */
+    _NITF_IMAGE_IO_INTERLEAVE_FUNC interleave[4];
 }
+interleaveTable;
 
-void nitf_ImageIO_formatMask_1(nitf_Uint8 * buffer,
-        size_t count, nitf_Uint32 shiftCount)
+static interleaveTable INTERLEAVE_TABLE[] =
 {
-    nitf_Uint8 mask;            /* The mask */
-    nitf_Uint8 *bp8;            /* Buffer pointer, 8 bit */
-    size_t i;
-    
-    mask = ((nitf_Uint8) - 1) << (8 - shiftCount);
-    bp8 = (nitf_Uint8 *) buffer;
-    for (i = 0; i < count; i++)
-        *(bp8++) &= mask;
-    
-    return;
-}
+    NITF_IMAGE_IO_SSE2_INTERLEAVE_ENTRY(2),
+    NITF_IMAGE_IO_SSE2_INTERLEAVE_ENTRY(4),
+    NITF_IMAGE_IO_SSE2_INTERLEAVE_ENTRY(8)
+};
 
-void nitf_ImageIO_formatMask_2(nitf_Uint8 * buffer,
-        size_t count, nitf_Uint32 shiftCount)
+/* Table entry for a band count and pixel size, returns NULL if none */
+NITFPRIV(interleaveTable *) nitf_ImageIO_sse2Interleaver(nitf_Uint32 numBands,
+                                                         nitf_Uint32 bytes,
+                                                         int *size)
 {
-    nitf_Uint8 mask;            /* The mask */
-    nitf_Uint16 *bp16;          /* Buffer pointer, 16 bit */
     size_t i;
-    
-    mask = ((nitf_Uint16) - 1) << (16 - shiftCount);
-    bp16 = (nitf_Uint16 *) buffer;
-    for (i = 0; i < count; i++)
-        *(bp16++) &= mask;
-    
-    return;
-}
 
+    switch (bytes)
+    {
+        case 1:
+            *size = 0;
+            break;
+        case 2:
+            *size = 1;
+            break;
+        case 4:
+            *size = 2;
+            break;
+        case 8:
+            *size = 3;
+            break;
+        default:
+            return NULL;
+    }
 
-void nitf_ImageIO_formatMask_4(nitf_Uint8 * buffer,
-        size_t count, nitf_Uint32 shiftCount)
-{
-    nitf_Uint8 mask;            /* The mask */
-    nitf_Uint32 *bp32;          /* Buffer pointer, 32 bit */
-    size_t i;
-    
-    mask = ((nitf_Uint32) - 1) << (32 - shiftCount);
-    bp32 = (nitf_Uint32 *) buffer;
-    for (i = 0; i < count; i++)
-        *(bp32++) &= mask;
-    
-    return;
+    for (i = 0; i < sizeof(INTERLEAVE_TABLE) / sizeof(INTERLEAVE_TABLE[0]);
+         i++)
+        if (INTERLEAVE_TABLE[i].bands == numBands)
+            return &(INTERLEAVE_TABLE[i]);
+    return NULL;
 }
 
+NITFPRIV(size_t) nitf_ImageIO_sse2Deinterleave(const nitf_Uint8 * src,
+                                               nitf_Uint8 ** dst,
+                                               nitf_Uint32 numBands,
+                                               nitf_Uint32 bytes,
+                                               size_t count)
+{
+    interleaveTable *entry; /* Kernels for the band count */
+    int size;               /* Pixel size index */
 
-/* Uses 64 bit types */
+    entry = nitf_ImageIO_sse2Interleaver(numBands, bytes, &size);
+    if (entry == NULL)
+        return 0;
+    return (*(entry->deinterleave[size])) (src, dst, count);
+}
 
-void nitf_ImageIO_formatMask_8(nitf_Uint8 * buffer,
-        size_t count, nitf_Uint32 shiftCount)
+NITFPRIV(size_t) nitf_ImageIO_sse2Interleave(nitf_Uint8 ** src,
+                                             nitf_Uint8 * dst,
+                                             nitf_Uint32 numBands,
+                                             nitf_Uint32 bytes,
+                                             size_t count)
 {
-    nitf_Uint8 mask;            /* The mask */
-    nitf_Uint64 *bp64;          /* Buffer pointer, 64 bit */
-    size_t i;
-    
-    mask = ((nitf_Uint64) - 1) << (64 - shiftCount);
-    bp64 = (nitf_Uint64 *) buffer;
-    for (i = 0; i < count; i++)
-        *(bp64++) &= mask;
-    
-    return;
+    interleaveTable *entry; /* Kernels for the band count */
+    int size;               /* Pixel size index */
+
+    entry = nitf_ImageIO_sse2Interleaver(numBands, bytes, &size);
+    if (entry == NULL)
+        return 0;
+    return (*(entry->interleave[size])) (src, dst, count);
 }
 
+#endif
 
-void nitf_ImageIO_formatShiftSwap_2(nitf_Uint8 * buffer,
-                                    size_t count,
-                                    nitf_Uint32 shiftCount)
-{
-    nitf_Int16 shift;           /* Shift count */
-    nitf_Uint8 *bp8;            /* Buffer pointer, 8 bit */
-    nitf_Int16 *bp16;           /* Buffer pointer, 16 bit */
-    nitf_Uint8 tmp8;            /* Temp value, 8 bit */
-    size_t i;
-    
-    shift = (nitf_Int16) shiftCount;
-    bp16 = (nitf_Int16 *) buffer;
-    for (i = 0; i < count; i++)
-    {
-        bp8 = (nitf_Uint8 *) bp16;
-        tmp8 = bp8[0];
-        bp8[0] = bp8[1];
-        bp8[1] = tmp8;
-        
-        *(bp16++) >>= shift;
-    }
-    
-    return;
-}
+#ifdef NITF_IMAGE_IO_AVX2
 
+/*
+ * Each 128 bit lane does 16 bytes of each of the three bands, so the lanes
+ * of the inputs are 48 bytes apart in the interleaved buffer
+ */
 
-void nitf_ImageIO_formatShiftSwap_4(nitf_Uint8 * buffer,
-                                    size_t count,
-                                    nitf_Uint32 shiftCount)
-{
-    nitf_Int32 shift;           /* Shift count */
-    nitf_Uint8 *bp8;            /* Buffer pointer, 8 bit */
-    nitf_Int32 *bp32;           /* Buffer pointer, 32 bit */
-    nitf_Uint8 tmp8;            /* Temp value, 8 bit */
+NITF_IMAGE_IO_TARGET_AVX2
+NITFPRIV(size_t) nitf_ImageIO_avx2Deinterleave3(const nitf_Uint8 * src,
+                                                nitf_Uint8 ** dst,
+                                                nitf_Uint32 bytes,
+                                                size_t count)
+{
+    nitf_Uint8 order[16];   /* Byte shuffle for one band and input */
+    __m256i shuffle[3][3];  /* Shuffles by band and input */
+    __m128i lane;           /* One lane of a shuffle */
+    __m256i in[3];          /* Interleaved input */
+    __m256i out;            /* One band of output */
+    const nitf_Uint8 *base; /* Start of the current input */
+    size_t perVector;       /* Pixels per vector */
+    nitf_Uint32 source;     /* Source byte of a shuffle */
+    nitf_Uint32 band;
+    nitf_Uint32 k;
+    nitf_Uint32 j;
     size_t i;
-    
-    shift = (nitf_Int32) shiftCount;
-    bp32 = (nitf_Int32 *) buffer;
-    for (i = 0; i < count; i++)
+
+    for (band = 0; band < 3; band++)
+        for (k = 0; k < 3; k++)
+        {
+            for (j = 0; j < 16; j++)
+            {
+                source = ((j / bytes) * 3 + band) * bytes + j % bytes;
+                order[j] = (nitf_Uint8) ((source / 16 == k)
+                                         ? source % 16 : 0x80);
+            }
+            lane = _mm_loadu_si128((const __m128i *) order);
+            shuffle[band][k] = _mm256_inserti128_si256(
+                _mm256_castsi128_si256(lane), lane, 1);
+        }
+
+    perVector = sizeof(__m256i) / bytes;
+    for (i = 0; i + perVector <= count; i += perVector)
     {
-        bp8 = (nitf_Uint8 *) bp32;
-        
-        tmp8 = bp8[0];
-        bp8[0] = bp8[3];
-        bp8[3] = tmp8;
-        tmp8 = bp8[1];
-        bp8[1] = bp8[2];
-        bp8[2] = tmp8;
-        
-        *(bp32++) >>= shift;
+        base = src + i * 3 * bytes;
+        for (k = 0; k < 3; k++)
+            in[k] = _mm256_inserti128_si256(
+                _mm256_castsi128_si256(
+                    _mm_loadu_si128((const __m128i *) (base + 16 * k))),
+                _mm_loadu_si128((const __m128i *) (base + 48 + 16 * k)), 1);
+
+        for (band = 0; band < 3; band++)
+        {
+            if (dst[band] == NULL)
+                continue;
+            out = _mm256_or_si256(
+                _mm256_or_si256(_mm256_shuffle_epi8(in[0], shuffle[band][0]),
+                                _mm256_shuffle_epi8(in[1], shuffle[band][1])),
+                _mm256_shuffle_epi8(in[2], shuffle[band][2]));
+            _mm256_storeu_si256((__m256i *) (dst[band] + i * bytes), out);
+        }
     }
-    
-    return;
-}
 
+    return i;
+}
 
-/* Uses 64 bit types */
-void nitf_ImageIO_formatShiftSwap_8(nitf_Uint8 * buffer,
-                                    size_t count,
-                                    nitf_Uint32 shiftCount)
+NITF_IMAGE_IO_TARGET_AVX2
+NITFPRIV(size_t) nitf_ImageIO_avx2Interleave3(nitf_Uint8 ** src,
+                                              nitf_Uint8 * dst,
+                                              nitf_Uint32 bytes,
+                                              size_t count)
 {
-    nitf_Int64 shift;           /* Shift count */
-    nitf_Uint8 *bp8;            /* Buffer pointer, 8 bit */
-    nitf_Int64 *bp64;           /* Buffer pointer, 64 bit */
-    nitf_Uint8 tmp8;            /* Temp value, 8 bit */
+    nitf_Uint8 order[16];   /* Byte shuffle for one output and band */
+    __m256i shuffle[3][3];  /* Shuffles by output and band */
+    __m128i lane;           /* One lane of a shuffle */
+    __m256i in[3];          /* Input by band */
+    __m256i out;            /* One vector of output */
+    nitf_Uint8 *base;       /* Start of the current output */
+    size_t perVector;       /* Pixels per vector */
+    nitf_Uint32 position;   /* Byte position in the output lanes */
+    nitf_Uint32 band;
+    nitf_Uint32 k;
+    nitf_Uint32 j;
     size_t i;
-    
-    shift = (nitf_Int64) shiftCount;
-    bp64 = (nitf_Int64 *) buffer;
-    for (i = 0; i < count; i++)
+
+    for (k = 0; k < 3; k++)
+        for (band = 0; band < 3; band++)
+        {
+            for (j = 0; j < 16; j++)
+            {
+                position = 16 * k + j;
+                order[j] = (nitf_Uint8) (((position / bytes) % 3 == band)
+                    ? (position / (3 * bytes)) * bytes + position % bytes
+                    : 0x80);
+            }
+            lane = _mm_loadu_si128((const __m128i *) order);
+            shuffle[k][band] = _mm256_inserti128_si256(
+                _mm256_castsi128_si256(lane), lane, 1);
+        }
+
+    perVector = sizeof(__m256i) / bytes;
+    for (i = 0; i + perVector <= count; i += perVector)
     {
-        bp8 = (nitf_Uint8 *) bp64;
-        
-        tmp8 = bp8[0];
-        bp8[0] = bp8[7];
-        bp8[7] = tmp8;
-        tmp8 = bp8[1];
-        bp8[1] = bp8[6];
-        bp8[6] = tmp8;
-        tmp8 = bp8[2];
-        bp8[2] = bp8[5];
-        bp8[5] = tmp8;
-        tmp8 = bp8[3];
-        bp8[3] = bp8[4];
-        bp8[4] = tmp8;
+        for (band = 0; band < 3; band++)
+            in[band] = _mm256_loadu_si256((const __m256i *)
+                                          (src[band] + i * bytes));
 
-        *(bp64++) >>= shift;
+        base = dst + i * 3 * bytes;
+        for (k = 0; k < 3; k++)
+        {
+            out = _mm256_or_si256(
+                _mm256_or_si256(_mm256_shuffle_epi8(in[0], shuffle[k][0]),
+                                _mm256_shuffle_epi8(in[1], shuffle[k][1])),
+                _mm256_shuffle_epi8(in[2], shuffle[k][2]));
+            _mm_storeu_si128((__m128i *) (base + 16 * k),
+                             _mm256_castsi256_si128(out));
+            _mm_storeu_si128((__m128i *) (base + 48 + 16 * k),
+                             _mm256_extracti128_si256(out, 1));
+        }
     }
-    
-    return;
+
+    return i;
 }
 
+#endif
 
-void nitf_ImageIO_formatMaskSwap_2(nitf_Uint8 * buffer,
-                                   size_t count,
-                                   nitf_Uint32 shiftCount)
+/*
+ * Strided copy of the pixels from done to count, used for the pixels the
+ * kernels leave
+ */
+
+#define NITF_IMAGE_IO_STRIDED_COPY(type, out, outSkip, in, inSkip)           \
+    {                                                                        \
+        type *o = (type *) (out);                                            \
+        const type *s = (const type *) (in);                                 \
+        for (i = done; i < count; i++)                                       \
+            o[i * (outSkip)] = s[i * (inSkip)];                              \
+    }
+
+NITFPRIV(void) nitf_ImageIO_deinterleave(const nitf_Uint8 * src,
+                                         nitf_Uint8 ** dst,
+                                         nitf_Uint32 numBands,
+                                         nitf_Uint32 bytes,
+                                         size_t count)
 {
-    nitf_Uint8 mask;            /* The mask */
-    nitf_Uint8 *bp8;            /* Buffer pointer, 8 bit */
-    nitf_Uint16 *bp16;          /* Buffer pointer, 16 bit */
-    nitf_Uint8 tmp8;            /* Temp value, 8 bit */
+    const nitf_Uint8 *in;   /* Start of the current band in the input */
+    size_t done;            /* Pixels done by a vector kernel */
+    nitf_Uint32 band;
     size_t i;
-    
-    mask = ((nitf_Uint16) - 1) << (16 - shiftCount);
-    bp16 = (nitf_Uint16 *) buffer;
-    for (i = 0; i < count; i++)
+
+    done = 0;
+#ifdef NITF_IMAGE_IO_SSE2
+    if (numBands == 3)
     {
-        *(bp16++) &= mask;
-        
-        bp8 = (nitf_Uint8 *) bp16;
-        tmp8 = bp8[0];
-        bp8[0] = bp8[1];
-        bp8[1] = tmp8;
+#ifdef NITF_IMAGE_IO_AVX2
+        if (((bytes == 1) || (bytes == 2) || (bytes == 4) || (bytes == 8))
+            && nitf_ImageIO_cpuHasAVX2())
+            done = nitf_ImageIO_avx2Deinterleave3(src, dst, bytes, count);
+#endif
     }
-    
-    return;
-}
-
+    else
+        done = nitf_ImageIO_sse2Deinterleave(src, dst, numBands, bytes,
+                                             count);
+#endif
 
-void nitf_ImageIO_formatMaskSwap_4(nitf_Uint8 * buffer,
-                                   size_t count,
-                                   nitf_Uint32 shiftCount)
-{
-    nitf_Uint8 mask;            /* The mask */
-    nitf_Uint8 *bp8;            /* Buffer pointer, 8 bit */
-    nitf_Uint32 *bp32;          /* Buffer pointer, 32 bit */
-    nitf_Uint8 tmp8;            /* Temp value, 8 bit */
-    size_t i;
-    
-    mask = ((nitf_Uint32) - 1) << (32 - shiftCount);
-    bp32 = (nitf_Uint32 *) buffer;
-    for (i = 0; i < count; i++)
+    for (band = 0; band < numBands; band++)
     {
-        bp8 = (nitf_Uint8 *) bp32;
-        
-        *(bp32++) &= mask;
-        
-        tmp8 = bp8[0];
-        bp8[0] = bp8[3];
-        bp8[3] = tmp8;
-        tmp8 = bp8[1];
-        bp8[1] = bp8[2];
-        bp8[2] = tmp8;
+        if (dst[band] == NULL)
+            continue;
+
+        in = src + band * bytes;
+        switch (bytes)
+        {
+            case 1:
+                NITF_IMAGE_IO_STRIDED_COPY(nitf_Uint8, dst[band], 1,
+                                           in, numBands);
+                break;
+            case 2:
+                NITF_IMAGE_IO_STRIDED_COPY(nitf_Uint16, dst[band], 1,
+                                           in, numBands);
+                break;
+            case 4:
+                NITF_IMAGE_IO_STRIDED_COPY(nitf_Uint32, dst[band], 1,
+                                           in, numBands);
+                break;
+            case 8:
+                NITF_IMAGE_IO_STRIDED_COPY(nitf_Uint64, dst[band], 1,
+                                           in, numBands);
+                break;
+            default:
+                for (i = done; i < count; i++)
+                    memcpy(dst[band] + i * bytes,
+                           in + i * numBands * bytes, bytes);
+                break;
+        }
     }
-    
     return;
 }
 
-
-/* Uses 64 bit types */
-void nitf_ImageIO_formatMaskSwap_8(nitf_Uint8 * buffer,
-                                   size_t count,
-                                   nitf_Uint32 shiftCount)
+NITFPRIV(void) nitf_ImageIO_interleave(nitf_Uint8 ** src,
+                                       nitf_Uint8 * dst,
+                                       nitf_Uint32 numBands,
+                                       nitf_Uint32 bytes,
+                                       size_t count)
 {
-    nitf_Uint8 mask;            /* The mask */
-    nitf_Uint8 *bp8;            /* Buffer pointer, 8 bit */
-    nitf_Uint64 *bp64;          /* Buffer pointer, 64 bit */
-    nitf_Uint8 tmp8;            /* Temp value, 8 bit */
+    nitf_Uint8 *out;        /* Start of the current band in the output */
+    size_t done;            /* Pixels done by a vector kernel */
+    nitf_Uint32 band;
     size_t i;
-    
-    mask = ((nitf_Uint64) - 1) << (64 - shiftCount);
-    bp64 = (nitf_Uint64 *) buffer;
-    for (i = 0; i < count; i++)
+
+    done = 0;
+#ifdef NITF_IMAGE_IO_SSE2
+    for (band = 0; band < numBands; band++)
+        if (src[band] == NULL)
+            break;
+
+    /* The kernels write every band */
+    if (band == numBands)
     {
-        bp8 = (nitf_Uint8 *) bp64;
-        
-        *(bp64++) &= mask;
-        
-        tmp8 = bp8[0];
-        bp8[0] = bp8[7];
-        bp8[7] = tmp8;
-        tmp8 = bp8[1];
-        bp8[1] = bp8[6];
-        bp8[6] = tmp8;
-        tmp8 = bp8[2];
-        bp8[2] = bp8[5];
-        bp8[5] = tmp8;
-        tmp8 = bp8[3];
-        bp8[3] = bp8[4];
-        bp8[4] = tmp8;
+        if (numBands == 3)
+        {
+#ifdef NITF_IMAGE_IO_AVX2
+            if (((bytes == 1) || (bytes == 2) || (bytes == 4) || (bytes == 8))
+                && nitf_ImageIO_cpuHasAVX2())
+                done = nitf_ImageIO_avx2Interleave3(src, dst, bytes, count);
+#endif
+        }
+        else
+            done = nitf_ImageIO_sse2Interleave(src, dst, numBands, bytes,
+                                               count);
+    }
+#endif
+
+    for (band = 0; band < numBands; band++)
+    {
+        if (src[band] == NULL)
+            continue;
+
+        out = dst + band * bytes;
+        switch (bytes)
+        {
+            case 1:
+                NITF_IMAGE_IO_STRIDED_COPY(nitf_Uint8, out, numBands,
+                                           src[band], 1);
+                break;
+            case 2:
+                NITF_IMAGE_IO_STRIDED_COPY(nitf_Uint16, out, numBands,
+                                           src[band], 1);
+                break;
+            case 4:
+                NITF_IMAGE_IO_STRIDED_COPY(nitf_Uint32, out, numBands,
+                                           src[band], 1);
+                break;
+            case 8:
+                NITF_IMAGE_IO_STRIDED_COPY(nitf_Uint64, out, numBands,
+                                           src[band], 1);
+                break;
+            default:
+                for (i = done; i < count; i++)
+                    memcpy(out + i * numBands * bytes,
+                           src[band] + i * bytes, bytes);
+                break;
+        }
     }
-    
     return;
 }
 
@@ -8853,14 +13036,6 @@ nitf_ImageIO_bPixelOpen(nitf_IOInterface* io,
     icntl->blockInfo = blockInfo;
     icntl->blockMask = blockMask;
     icntl->blockSizeCompressed = (blockInfo->length + 7) / 8;
-    icntl->buffer = (nitf_Uint8 *) NITF_MALLOC(icntl->blockSizeCompressed);
-    if (icntl->buffer == NULL)
-    {
-        nitf_Error_init(error, "Error creating control object",
-                        NITF_CTXT, NITF_ERR_DECOMPRESSION);
-        NITF_FREE(icntl);
-        return NULL;
-    }
 
     return (nitf_DecompressionControl *) icntl;
 }
@@ -8872,8 +13047,37 @@ nitf_ImageIO_bPixelReadBlock(nitf_DecompressionControl * control,
 {
     /* Actual control type */
     nitf_ImageIO_BPixelControl *icntl;
-    size_t uncompressedLen;     /* Length of uncompressed block */
     nitf_Uint8 *block;          /* Uncompressed result */
+
+    icntl = (nitf_ImageIO_BPixelControl *) control;
+
+    block = (nitf_Uint8 *) NITF_MALLOC(icntl->blockInfo->length);
+    if (block == NULL)
+    {
+        nitf_Error_init(error, "Error creating block buffer",
+                        NITF_CTXT, NITF_ERR_DECOMPRESSION);
+        return NULL;
+    }
+
+    if (!nitf_ImageIO_bPixelReadBlockInto(control, blockNumber, block,
+                                          icntl->blockInfo->length, error))
+    {
+        NITF_FREE(block);
+        return NULL;
+    }
+    return block;
+}
+
+
+NITFPRIV(NITF_BOOL)
+nitf_ImageIO_bPixelReadBlockInto(nitf_DecompressionControl * control,
+                                 nitf_Uint32 blockNumber,
+                                 nitf_Uint8 * block, size_t size,
+                                 nitf_Error * error)
+{
+    /* Actual control type */
+    nitf_ImageIO_BPixelControl *icntl;
+    size_t uncompressedLen;     /* Length of uncompressed block */
     nitf_Uint8 *blockPtr;       /* Pointer in uncompressed result */
     nitf_Uint8 *compPtr;        /* Pointer in compressed input */
     nitf_Uint8 current;         /* Current byte of compressed data */
@@ -8881,36 +13085,33 @@ nitf_ImageIO_bPixelReadBlock(nitf_DecompressionControl * control,
     
     icntl = (nitf_ImageIO_BPixelControl *) control;
     uncompressedLen = icntl->blockInfo->length;
-    
-    /* Read the data */
-    
-    if (!NITF_IO_SUCCESS(nitf_IOInterface_seek(icntl->io,
-                                               (nitf_Off) (icntl->offset +
-                                                           icntl->
-                                                           blockMask
-                                                           [blockNumber]),
-                                               NITF_SEEK_SET, error)))
-        return NULL;
-    
-    if (!nitf_IOInterface_read(icntl->io,
-                               (char *) (icntl->buffer),
-                               icntl->blockSizeCompressed, error))
-        return NULL;
-    
-    /* Allocate block */
-    
-    block = (nitf_Uint8 *) NITF_MALLOC(uncompressedLen);
-    if (block == NULL)
+    if (size < uncompressedLen)
     {
-        nitf_Error_init(error, "Error creating block buffer",
-                        NITF_CTXT, NITF_ERR_DECOMPRESSION);
-        return NULL;
+        nitf_Error_initf(error, NITF_CTXT, NITF_ERR_DECOMPRESSION,
+                         "Block buffer too small (%lu < %lu)",
+                         (unsigned long) size,
+                         (unsigned long) uncompressedLen);
+        return NITF_FAILURE;
     }
+    
+    /*
+     * Each call reads with a positional read so concurrent calls are safe.
+     * The compressed data is read into the end of the block and expanded
+     * in place, each output byte is written after the input byte under it
+     * has been read
+     */
+
+    compPtr = block + (uncompressedLen - icntl->blockSizeCompressed);
+    if (!nitf_IOInterface_readAt(icntl->io,
+                                 (nitf_Off) (icntl->offset +
+                                             icntl->blockMask[blockNumber]),
+                                 (char *) compPtr,
+                                 icntl->blockSizeCompressed, error))
+        return NITF_FAILURE;
 
     /* Decompress the result */
 
     blockPtr = block;
-    compPtr = icntl->buffer;
     current = 0;                /* Avoids uninitialized variable warning */
     for (i = 0; i < uncompressedLen; i++)
     {
@@ -8920,7 +13121,7 @@ nitf_ImageIO_bPixelReadBlock(nitf_DecompressionControl * control,
         current <<= 1;
     }
 
-    return block;
+    return NITF_SUCCESS;
 }
 
 
@@ -8930,8 +13131,6 @@ nitf_ImageIO_bPixelClose(nitf_DecompressionControl **control)
     nitf_ImageIO_BPixelControl *icntl;
     icntl = (nitf_ImageIO_BPixelControl *) * control;
     
-    if (icntl->buffer != NULL)
-        NITF_FREE((void *) (icntl->buffer));
     NITF_FREE((void *) (icntl));
     *control = NULL;
     return;
@@ -8996,26 +13195,45 @@ nitf_ImageIO_12PixelOpen(nitf_IOInterface* io,
 
     icntl->blockSizeCompressed = 3*(icntl->blockPixelCount/2) + 2*(icntl->odd);
 
-    icntl->buffer = (nitf_Uint8 *) NITF_MALLOC(icntl->blockSizeCompressed);
-    if (icntl->buffer == NULL)
+    return (nitf_DecompressionControl *) icntl;
+}
+
+NITFPRIV(nitf_Uint8 *)
+nitf_ImageIO_12PixelReadBlock(nitf_DecompressionControl * control,
+                             nitf_Uint32 blockNumber, nitf_Error * error)
+{
+    /* Actual control type */
+    nitf_ImageIO_12PixelControl *icntl;
+    nitf_Uint8 *block;             /* Uncompressed result */
+
+    icntl = (nitf_ImageIO_12PixelControl *) control;
+
+    block = (nitf_Uint8 *) NITF_MALLOC(icntl->blockInfo->length);
+    if (block == NULL)
     {
-        nitf_Error_init(error, "Error creating control object",
+        nitf_Error_init(error, "Error creating block buffer",
                         NITF_CTXT, NITF_ERR_DECOMPRESSION);
-        NITF_FREE(icntl);
         return NULL;
     }
 
-    return (nitf_DecompressionControl *) icntl;
+    if (!nitf_ImageIO_12PixelReadBlockInto(control, blockNumber, block,
+                                           icntl->blockInfo->length, error))
+    {
+        NITF_FREE(block);
+        return NULL;
+    }
+    return block;
 }
 
-NITFPRIV(nitf_Uint8 *)
-nitf_ImageIO_12PixelReadBlock(nitf_DecompressionControl * control,
-                             nitf_Uint32 blockNumber, nitf_Error * error)
+NITFPRIV(NITF_BOOL)
+nitf_ImageIO_12PixelReadBlockInto(nitf_DecompressionControl * control,
+                                  nitf_Uint32 blockNumber,
+                                  nitf_Uint8 * block, size_t size,
+                                  nitf_Error * error)
 {
     /* Actual control type */
     nitf_ImageIO_12PixelControl *icntl;
     size_t uncompressedLen;        /* Length of uncompressed block */
-    nitf_Uint8 *block;             /* Uncompressed result */
     nitf_Uint16 *blockPtr;         /* Pointer in uncompressed result */
     nitf_Uint8 *compPtr;           /* Pointer in compressed input */
     nitf_Uint16 a;                 /* Components of compressed pixel */
@@ -9025,33 +13243,32 @@ nitf_ImageIO_12PixelReadBlock(nitf_DecompressionControl * control,
 
     icntl = (nitf_ImageIO_12PixelControl *) control;
     uncompressedLen = icntl->blockInfo->length;
+    if (size < uncompressedLen)
+    {
+        nitf_Error_initf(error, NITF_CTXT, NITF_ERR_DECOMPRESSION,
+                         "Block buffer too small (%lu < %lu)",
+                         (unsigned long) size,
+                         (unsigned long) uncompressedLen);
+        return NITF_FAILURE;
+    }
 
-    /* Read the data */
+    /*
+     * Each call reads with a positional read so concurrent calls are safe.
+     * The compressed data is read into the end of the block and expanded
+     * in place, the four bytes of each pixel pair end before the next
+     * three input bytes begin
+     */
 
-    if (!NITF_IO_SUCCESS(nitf_IOInterface_seek(icntl->io,
+    compPtr = block + (uncompressedLen - icntl->blockSizeCompressed);
+    if (!nitf_IOInterface_readAt(icntl->io,
                  (nitf_Off) (icntl->offset + icntl->blockMask[blockNumber]),
-                                               NITF_SEEK_SET, error)))
-        return NULL;
-
-    if (!nitf_IOInterface_read(icntl->io,
-                               (char *) (icntl->buffer),
-                               icntl->blockSizeCompressed, error))
-        return NULL;
-
-    /* Allocate block */
-
-    block = (nitf_Uint8 *) NITF_MALLOC(uncompressedLen);
-    if (block == NULL)
-    {
-        nitf_Error_init(error, "Error creating block buffer",
-                        NITF_CTXT, NITF_ERR_DECOMPRESSION);
-        return NULL;
-    }
+                                 (char *) compPtr,
+                                 icntl->blockSizeCompressed, error))
+        return NITF_FAILURE;
 
     /* Decompress the result */
 
     blockPtr = (nitf_Uint16 *) block;
-    compPtr = icntl->buffer;
     for (i = 0; i < icntl->blockPixelCount/2; i++)
     {
       a = *(compPtr++);
@@ -9070,7 +13287,7 @@ nitf_ImageIO_12PixelReadBlock(nitf_DecompressionControl * control,
       *(blockPtr++) = (a << 4) + (b >>4);
     }
 
-    return block;
+    return NITF_SUCCESS;
 }
 
 
@@ -9080,8 +13297,6 @@ nitf_ImageIO_12PixelClose(nitf_DecompressionControl **control)
     nitf_ImageIO_12PixelControl *icntl;
     icntl = (nitf_ImageIO_12PixelControl *) * control;
 
-    if (icntl->buffer != NULL)
-        NITF_FREE((void *) (icntl->buffer));
     NITF_FREE((void *) (icntl));
     *control = NULL;
     return;
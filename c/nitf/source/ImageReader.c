@@ -42,6 +42,18 @@ NITFAPI(NITF_BOOL) nitf_ImageReader_read(nitf_ImageReader * imageReader,
 }
 
 
+NITFAPI(NITF_BOOL) nitf_ImageReader_readLevel(nitf_ImageReader * imageReader,
+                                              nitf_Uint32 level,
+                                              nitf_SubWindow * subWindow,
+                                              nitf_Uint8 ** user,
+                                              int *padded, nitf_Error * error)
+{
+    return nitf_ImageIO_readLevel(imageReader->imageDeblocker,
+                                  imageReader->input, level,
+                                  subWindow, user, padded, error);
+}
+
+
 NITFAPI(void) nitf_ImageReader_destruct(nitf_ImageReader ** imageReader)
 {
     if (*imageReader)
@@ -77,3 +89,42 @@ NITFPROT(void) nitf_ImageReader_setReadCaching(nitf_ImageReader * iReader)
     nitf_ImageIO_setReadCaching(iReader->imageDeblocker);
     return;
 }
+
+NITFAPI(void) nitf_ImageReader_setReadCacheSize(nitf_ImageReader * iReader,
+                                                size_t maxBytes)
+{
+    nitf_ImageIO_setReadCacheSize(iReader->imageDeblocker, maxBytes);
+    return;
+}
+
+NITFAPI(void) nitf_ImageReader_getReadCacheStats(nitf_ImageReader * iReader,
+                                                 nitf_Uint64 * hits,
+                                                 nitf_Uint64 * misses)
+{
+    nitf_ImageIO_getReadCacheStats(iReader->imageDeblocker, hits, misses);
+    return;
+}
+
+NITFAPI(void) nitf_ImageReader_setDecodeThreads(nitf_ImageReader * iReader,
+                                                nitf_Uint32 numThreads)
+{
+    nitf_ImageIO_setDecodeThreads(iReader->imageDeblocker, numThreads);
+    return;
+}
+
+NITFAPI(void) nitf_ImageReader_setReadAhead(nitf_ImageReader * iReader,
+                                            int mode)
+{
+    nitf_ImageIO_setReadAhead(iReader->imageDeblocker, mode);
+    return;
+}
+
+NITFAPI(const nitf_Uint8 *)
+nitf_ImageReader_borrowBlock(nitf_ImageReader * iReader,
+                             nitf_Uint32 blockNumber,
+                             nitf_Uint64 * blockSize,
+                             nitf_Error * error)
+{
+    return nitf_ImageIO_borrowBlock(iReader->imageDeblocker, iReader->input,
+                                    blockNumber, blockSize, error);
+}
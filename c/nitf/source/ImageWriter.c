@@ -23,6 +23,14 @@
 #include "nitf/ImageWriter.h"
 #include "nitf/ImageIO.h"
 
+/*
+ *  Upper bound on the strip buffers (all bands) for the default strip of
+ *  one block row.  Images with taller blocks get fewer rows per strip.
+ */
+#define NITF_IMAGE_WRITER_MAX_STRIP_BYTES (64 * 1024 * 1024)
+
+/* Smallest write buffers for a pipelined write */
+#define NITF_IMAGE_WRITER_MIN_PIPE_BYTES (4 * 1024 * 1024)
 
 /*
  *  Private implementation struct
@@ -34,6 +42,14 @@ typedef struct _ImageWriterImpl
     nitf_Uint32 numMultispectralImageBands;
     nitf_Uint32 numRows;
     nitf_Uint32 numCols;
+    nitf_Uint32 numRowsPerBlock;
+    nitf_Uint32 numRowsPerStrip;  /* Rows per source read, 0 for default */
+    int writeCaching;             /* Caching set by the user, -1 if not */
+    int pipelining;               /* Read, format and write in parallel */
+    NITF_BOOL blockWrites;        /* Blocks are written by the user */
+    nitf_IOInterface *output;     /* Output for block writes */
+    NITF_BOOL omitPadBlocks;      /* Pad blocks are left out */
+    nitf_ImageSubheader *subheader;
     nitf_ImageSource *imageSource;
     nitf_ImageIO *imageBlocker;
 
@@ -56,39 +72,214 @@ NITFPRIV(void) ImageWriter_destruct(NITF_DATA * data)
 }
 
 
-NITFPRIV(NITF_BOOL) ImageWriter_write(NITF_DATA * data,
-                                      nitf_IOInterface* output, 
-                                      nitf_Error * error)
+/*
+ *  Choose the number of rows moved per source read and ImageIO write. The
+ *  default is one block row so that each strip completes a row of blocks,
+ *  which are then written whole through the block cache.
+ */
+NITFPRIV(nitf_Uint32) ImageWriter_stripRows(ImageWriterImpl * impl,
+                                            size_t rowSize,
+                                            nitf_Uint32 numImageBands)
 {
-    nitf_Uint8 **user = NULL;
-    nitf_Uint32 row, band;
+    nitf_Uint32 stripRows;
+    size_t maxRows;
+
+    if (impl->numRowsPerStrip != 0)
+        stripRows = impl->numRowsPerStrip;
+    else
+    {
+        stripRows = impl->numRowsPerBlock;
+        if (rowSize * numImageBands != 0)
+        {
+            maxRows = NITF_IMAGE_WRITER_MAX_STRIP_BYTES
+                      / (rowSize * numImageBands);
+            if ((size_t) stripRows > maxRows)
+                stripRows = (nitf_Uint32) maxRows;
+        }
+    }
+
+    if (stripRows == 0)
+        stripRows = 1;
+    if (stripRows > impl->numRows)
+        stripRows = impl->numRows;
+    return stripRows;
+}
+
+
+/*
+ *  One strip of rows of every band, filled by ImageWriter_readStrip
+ */
+typedef struct _ImageWriterStrip
+{
+    ImageWriterImpl *impl;
+    nitf_Uint8 **user;            /* One buffer per band */
+    nitf_Uint32 numBands;
     size_t rowSize;
-    nitf_Uint32 numImageBands = 0;
-    nitf_Off offset;
-    nitf_BandSource *bandSrc = NULL;
-    ImageWriterImpl *impl = (ImageWriterImpl *) data;
-    NITF_BOOL rc = NITF_SUCCESS;
+    nitf_Uint32 numRows;          /* Rows to read */
+    NITF_BOOL status;             /* Result of the read */
+    nitf_Error error;
+} ImageWriterStrip;
 
-    numImageBands = impl->numImageBands + impl->numMultispectralImageBands;
-    rowSize = impl->numCols * NITF_NBPP_TO_BYTES(impl->numBitsPerPixel);
 
-    user = (nitf_Uint8 **) NITF_MALLOC(sizeof(nitf_Uint8*) * numImageBands);
+/*
+ *  Read the next strip from the band sources. This is run on its own
+ *  thread when the write is pipelined, so it reports through the strip.
+ */
+NITFPRIV(void) ImageWriter_readStrip(void *data)
+{
+    ImageWriterStrip *strip = (ImageWriterStrip *) data;
+    nitf_BandSource *bandSrc;
+    nitf_Uint32 band;
+
+    strip->status = NITF_SUCCESS;
+    for (band = 0; band < strip->numBands; ++band)
+    {
+        bandSrc = nitf_ImageSource_getBand(strip->impl->imageSource,
+                                           band, &(strip->error));
+        if (bandSrc == NULL
+            || !(*(bandSrc->iface->read)) (bandSrc->data,
+                                           (char *) strip->user[band],
+                                           strip->rowSize * strip->numRows,
+                                           &(strip->error)))
+        {
+            strip->status = NITF_FAILURE;
+            return;
+        }
+    }
+}
+
+
+NITFPRIV(nitf_Uint8 **) ImageWriter_allocStrip(nitf_Uint32 numBands,
+                                               size_t stripSize,
+                                               nitf_Error * error)
+{
+    nitf_Uint8 **user;
+    nitf_Uint32 band;
+
+    user = (nitf_Uint8 **) NITF_MALLOC(sizeof(nitf_Uint8*) * numBands);
     if (!user)
     {
         nitf_Error_init(error, NITF_STRERROR(NITF_ERRNO), NITF_CTXT,
                 NITF_ERR_MEMORY);
-        goto CATCH_ERROR;
+        return NULL;
     }
-    for (band = 0; band < numImageBands; band++)
+    memset(user, 0, sizeof(nitf_Uint8*) * numBands);
+    for (band = 0; band < numBands; band++)
     {
-        user[band] = (nitf_Uint8 *) NITF_MALLOC(rowSize);
+        user[band] = (nitf_Uint8 *) NITF_MALLOC(stripSize);
         if (!user[band])
         {
             nitf_Error_init(error, NITF_STRERROR(NITF_ERRNO), NITF_CTXT,
                             NITF_ERR_MEMORY);
-            goto CATCH_ERROR;
+            for (band = 0; band < numBands; band++)
+                if (user[band] != NULL)
+                    NITF_FREE(user[band]);
+            NITF_FREE(user);
+            return NULL;
         }
     }
+    return user;
+}
+
+
+NITFPRIV(void) ImageWriter_freeStrip(nitf_Uint8 **user, nitf_Uint32 numBands)
+{
+    nitf_Uint32 band;
+
+    if (user == NULL)
+        return;
+    for (band = 0; band < numBands; band++)
+        NITF_FREE(user[band]);
+    NITF_FREE(user);
+}
+
+
+NITFPRIV(NITF_BOOL) ImageWriter_write(NITF_DATA * data,
+                                      nitf_IOInterface* output, 
+                                      nitf_Error * error)
+{
+    ImageWriterStrip strips[2];
+    int current;
+    nitf_Uint32 row;
+    nitf_Uint32 nextRow;
+    nitf_Uint32 stripRows;
+    size_t rowSize;
+    nitf_Uint32 numImageBands = 0;
+    nitf_Off offset;
+    nitf_IOInterface *io = output;
+    nitf_Thread thread;
+    NITF_BOOL reading;
+    NITF_BOOL written;
+    size_t pipeSize;
+    ImageWriterImpl *impl = (ImageWriterImpl *) data;
+    NITF_BOOL rc = NITF_SUCCESS;
+
+    /*
+     * For block writes only the layout of the data is written here, the
+     * blocks are written later through nitf_ImageWriter_writeBlock
+     */
+    if (impl->blockWrites)
+    {
+        offset = nitf_IOInterface_tell(output, error);
+        if (!NITF_IO_SUCCESS(offset))
+            return NITF_FAILURE;
+
+        if (!nitf_ImageIO_setFileOffset(impl->imageBlocker, offset, error))
+            return NITF_FAILURE;
+
+        if (!nitf_ImageIO_writeBlocksBegin(impl->imageBlocker, output, error))
+            return NITF_FAILURE;
+
+        impl->output = output;
+        return NITF_SUCCESS;
+    }
+
+    numImageBands = impl->numImageBands + impl->numMultispectralImageBands;
+    rowSize = impl->numCols * NITF_NBPP_TO_BYTES(impl->numBitsPerPixel);
+    stripRows = ImageWriter_stripRows(impl, rowSize, numImageBands);
+
+    /*
+     * Strips that end on block boundaries fill whole blocks, so unless the
+     * user has chosen otherwise write them a block at a time
+     */
+    if (impl->writeCaching < 0 && impl->numRowsPerBlock != 0
+        && (stripRows % impl->numRowsPerBlock == 0
+            || stripRows == impl->numRows))
+        nitf_ImageIO_setWriteCaching(impl->imageBlocker, 1);
+
+    memset(strips, 0, sizeof(strips));
+    strips[0].impl = impl;
+    strips[0].numBands = numImageBands;
+    strips[0].rowSize = rowSize;
+    strips[1] = strips[0];
+
+    /*
+     * A pipelined write has a second strip, read while the first is
+     * formatted, and writes the output through a write behind adapter.
+     * Otherwise both strips are the same buffers.
+     */
+    strips[0].user = ImageWriter_allocStrip(numImageBands,
+                                            rowSize * stripRows, error);
+    if (!strips[0].user)
+        goto CATCH_ERROR;
+
+    if (impl->pipelining)
+    {
+        strips[1].user = ImageWriter_allocStrip(numImageBands,
+                                                rowSize * stripRows, error);
+        if (!strips[1].user)
+            goto CATCH_ERROR;
+
+        /* Write buffers of about a strip, but not too small */
+        pipeSize = rowSize * stripRows * numImageBands;
+        if (pipeSize < NITF_IMAGE_WRITER_MIN_PIPE_BYTES)
+            pipeSize = NITF_IMAGE_WRITER_MIN_PIPE_BYTES;
+        io = nitf_WriteBehindAdapter_construct(output, pipeSize, error);
+        if (!io)
+            goto CATCH_ERROR;
+    }
+    else
+        strips[1].user = strips[0].user;
 
     offset = nitf_IOInterface_tell(output, error);
     if (!NITF_IO_SUCCESS(offset))
@@ -97,30 +288,58 @@ NITFPRIV(NITF_BOOL) ImageWriter_write(NITF_DATA * data,
     if (!nitf_ImageIO_setFileOffset(impl->imageBlocker, offset, error))
         goto CATCH_ERROR;
 
-    if (!nitf_ImageIO_writeSequential(impl->imageBlocker, output, error))
+    if (!nitf_ImageIO_writeSequential(impl->imageBlocker, io, error))
         goto CATCH_ERROR;
 
-    for (row = 0; row < impl->numRows; ++row)
+    current = 0;
+    strips[current].numRows = impl->numRows < stripRows ?
+        impl->numRows : stripRows;
+    ImageWriter_readStrip(&strips[current]);
+    if (!strips[current].status)
     {
-        for (band = 0; band < numImageBands; ++band)
-        {
-            bandSrc = nitf_ImageSource_getBand(impl->imageSource,
-                                               band, error);
-            if (bandSrc == NULL)
-                return NITF_FAILURE;
+        *error = strips[current].error;
+        goto CATCH_ERROR;
+    }
+
+    for (row = 0; row < impl->numRows; row = nextRow)
+    {
+        ImageWriterStrip *next = &strips[1 - current];
+
+        nextRow = row + strips[current].numRows;
+        if (nextRow < impl->numRows)
+            next->numRows = impl->numRows - nextRow < stripRows ?
+                impl->numRows - nextRow : stripRows;
+
+        /* Read the next strip while this one is written */
+        reading = impl->pipelining && nextRow < impl->numRows
+            && nitf_Thread_create(&thread, ImageWriter_readStrip, next,
+                                  error);
+
+        written = nitf_ImageIO_writeRows(impl->imageBlocker, io,
+                                         strips[current].numRows,
+                                         strips[current].user, error);
+        if (reading)
+            nitf_Thread_join(&thread);
+        if (!written)
+            goto CATCH_ERROR;
 
-            if (!(*(bandSrc->iface->read)) (bandSrc->data, (char *) user[band],
-                                            (size_t) rowSize, error))
+        if (nextRow < impl->numRows)
+        {
+            if (!reading)
+                ImageWriter_readStrip(next);
+            if (!next->status)
             {
+                *error = next->error;
                 goto CATCH_ERROR;
             }
         }
-
-        if (!nitf_ImageIO_writeRows(impl->imageBlocker, output, 1, user, error))
-            goto CATCH_ERROR;
+        current = 1 - current;
     }
 
-    if (!nitf_ImageIO_writeDone(impl->imageBlocker, output, error))
+    if (!nitf_ImageIO_writeDone(impl->imageBlocker, io, error))
+        goto CATCH_ERROR;
+
+    if (!nitf_WriteBehindAdapter_flush(io, error))
         goto CATCH_ERROR;
 
     goto CLEANUP;
@@ -129,13 +348,42 @@ CATCH_ERROR:
     rc = NITF_FAILURE;
 
 CLEANUP:
-    for (band = 0; band < numImageBands; band++)
+    if (io != output)
+        nitf_IOInterface_destruct(&io);
+    if (strips[1].user != strips[0].user)
+        ImageWriter_freeStrip(strips[1].user, numImageBands);
+    ImageWriter_freeStrip(strips[0].user, numImageBands);
+    return rc;
+}
+
+
+/*
+ *  The data of an uncompressed image can be streamed, written a whole
+ *  block at a time so the blocks go out in file order
+ */
+NITFPRIV(NITF_BOOL) ImageWriter_streamLength(NITF_DATA * data,
+                                             nitf_Off * length,
+                                             nitf_Error * error)
+{
+    ImageWriterImpl *impl = (ImageWriterImpl *) data;
+    nitf_Uint64 dataLength;
+
+    if (impl->blockWrites)
+    {
+        nitf_Error_init(error, "Block writes cannot be streamed",
+                        NITF_CTXT, NITF_ERR_INVALID_PARAMETER);
+        return NITF_FAILURE;
+    }
+
+    if (!nitf_ImageIO_streamLength(impl->imageBlocker, &dataLength))
     {
-        if (user != NULL && user[band] != NULL)
-            NITF_FREE(user[band]);
+        *length = -1;
+        return NITF_SUCCESS;
     }
-    NITF_FREE(user);
-    return rc;
+
+    nitf_ImageIO_setWriteCaching(impl->imageBlocker, 1);
+    *length = (nitf_Off) dataLength;
+    return NITF_SUCCESS;
 }
 
 
@@ -197,7 +445,8 @@ NITFAPI(nitf_ImageWriter *) nitf_ImageWriter_construct(
     static nitf_IWriteHandler iWriteHandler =
     {
         &ImageWriter_write,
-        &ImageWriter_destruct
+        &ImageWriter_destruct,
+        &ImageWriter_streamLength
     };
 
     ImageWriterImpl *impl = NULL;
@@ -220,8 +469,16 @@ NITFAPI(nitf_ImageWriter *) nitf_ImageWriter_construct(
     NITF_TRY_GET_UINT32(subheader->numMultispectralImageBands, &impl->numMultispectralImageBands, error);
     NITF_TRY_GET_UINT32(subheader->numRows, &impl->numRows, error);
     NITF_TRY_GET_UINT32(subheader->numCols, &impl->numCols, error);
+    NITF_TRY_GET_UINT32(subheader->numPixelsPerVertBlock,
+                        &impl->numRowsPerBlock, error);
+
+    /* A zero block height means one block of all of the rows */
+    if (impl->numRowsPerBlock == 0 || impl->numRowsPerBlock > impl->numRows)
+        impl->numRowsPerBlock = impl->numRows;
 
+    impl->writeCaching = -1;
     impl->imageSource = NULL;
+    impl->subheader = subheader;
 
     /* Check for compression and get compression interface */
     /* get the compression string */
@@ -276,6 +533,13 @@ NITFAPI(NITF_BOOL) nitf_ImageWriter_attachSource(nitf_ImageWriter * imageWriter,
                         NITF_CTXT, NITF_ERR_INVALID_PARAMETER);
         return NITF_FAILURE;
     }
+
+    if (impl->blockWrites)
+    {
+        nitf_Error_init(error, "Block writes are enabled for this image",
+                        NITF_CTXT, NITF_ERR_INVALID_PARAMETER);
+        return NITF_FAILURE;
+    }
     
     impl->imageSource = imageSource;
     return NITF_SUCCESS;
@@ -286,9 +550,28 @@ NITFAPI(int) nitf_ImageWriter_setWriteCaching(nitf_ImageWriter *imageWriter,
         int enable)
 {
     ImageWriterImpl *impl = (ImageWriterImpl*)imageWriter->data;
+    impl->writeCaching = enable ? 1 : 0;
     return(nitf_ImageIO_setWriteCaching(impl->imageBlocker, enable));
 }
 
+NITFAPI(int) nitf_ImageWriter_setPipelining(nitf_ImageWriter *imageWriter,
+        int enable)
+{
+    ImageWriterImpl *impl = (ImageWriterImpl*)imageWriter->data;
+    int saved = impl->pipelining;
+    impl->pipelining = enable ? 1 : 0;
+    return saved;
+}
+
+NITFAPI(nitf_Uint32) nitf_ImageWriter_setRowsPerStrip(
+        nitf_ImageWriter *imageWriter, nitf_Uint32 numRows)
+{
+    ImageWriterImpl *impl = (ImageWriterImpl*)imageWriter->data;
+    nitf_Uint32 saved = impl->numRowsPerStrip;
+    impl->numRowsPerStrip = numRows;
+    return saved;
+}
+
 NITFAPI(NITF_BOOL) nitf_ImageWriter_setPadPixel(nitf_ImageWriter* imageWriter,
                                                 nitf_Uint8* value,
                                                 nitf_Uint32 length,
@@ -297,3 +580,103 @@ NITFAPI(NITF_BOOL) nitf_ImageWriter_setPadPixel(nitf_ImageWriter* imageWriter,
     ImageWriterImpl *impl = (ImageWriterImpl*)imageWriter->data;
     return nitf_ImageIO_setPadPixel(impl->imageBlocker, value, length, error); 
 }
+
+NITFAPI(NITF_BOOL) nitf_ImageWriter_enablePadBlockOmission(
+        nitf_ImageWriter* imageWriter, nitf_Error* error)
+{
+    ImageWriterImpl *impl = (ImageWriterImpl*)imageWriter->data;
+    char compBuf[NITF_IC_SZ + 1];       /* holds the compression string */
+
+    if (impl->blockWrites)
+    {
+        nitf_Error_init(error, "Block writes are enabled for this image",
+                        NITF_CTXT, NITF_ERR_INVALID_PARAMETER);
+        return NITF_FAILURE;
+    }
+
+    if (!nitf_ImageIO_setPadBlockOmission(impl->imageBlocker, error))
+        return NITF_FAILURE;
+
+    if (!nitf_Field_get(impl->subheader->NITF_IC, compBuf,
+                        NITF_CONV_STRING, NITF_IC_SZ + 1, error))
+        return NITF_FAILURE;
+
+    if (memcmp(compBuf, "NC", 2) == 0
+        && !nitf_Field_setString(impl->subheader->NITF_IC, "NM", error))
+        return NITF_FAILURE;
+
+    impl->omitPadBlocks = 1;
+    return NITF_SUCCESS;
+}
+
+NITFAPI(NITF_BOOL) nitf_ImageWriter_enableBlockWrites(
+        nitf_ImageWriter* imageWriter, nitf_Error* error)
+{
+    ImageWriterImpl *impl = (ImageWriterImpl*)imageWriter->data;
+
+    if (impl->imageSource != NULL)
+    {
+        nitf_Error_init(error, "Image source already attached",
+                        NITF_CTXT, NITF_ERR_INVALID_PARAMETER);
+        return NITF_FAILURE;
+    }
+
+    if (impl->omitPadBlocks)
+    {
+        nitf_Error_init(error, "Pad block omission is enabled for this image",
+                        NITF_CTXT, NITF_ERR_INVALID_PARAMETER);
+        return NITF_FAILURE;
+    }
+
+    impl->blockWrites = 1;
+    return NITF_SUCCESS;
+}
+
+NITFAPI(NITF_BOOL) nitf_ImageWriter_writeBlock(nitf_ImageWriter* imageWriter,
+                                               nitf_Uint32 blockRow,
+                                               nitf_Uint32 blockCol,
+                                               nitf_Uint32 band,
+                                               const nitf_Uint8* data,
+                                               nitf_Error* error)
+{
+    ImageWriterImpl *impl = (ImageWriterImpl*)imageWriter->data;
+
+    if (impl->output == NULL)
+    {
+        nitf_Error_init(error, "The image has not been laid out, "
+                        "call nitf_Writer_write first",
+                        NITF_CTXT, NITF_ERR_INVALID_PARAMETER);
+        return NITF_FAILURE;
+    }
+
+    return nitf_ImageIO_writeBlock(impl->imageBlocker, impl->output,
+                                   blockRow, blockCol, band, data, error);
+}
+
+NITFPROT(NITF_BOOL) nitf_ImageWriter_writesBlocks(nitf_WriteHandler* handler)
+{
+    /* Other write handlers have some other kind of data */
+    if (handler == NULL || handler->iface->destruct != &ImageWriter_destruct)
+        return NITF_FAILURE;
+
+    return ((ImageWriterImpl*)handler->data)->blockWrites;
+}
+
+NITFAPI(NITF_BOOL) nitf_ImageWriter_blockWritesDone(
+        nitf_ImageWriter* imageWriter, nitf_Error* error)
+{
+    ImageWriterImpl *impl = (ImageWriterImpl*)imageWriter->data;
+    nitf_IOInterface *output;
+
+    if (impl->output == NULL)
+    {
+        nitf_Error_init(error, "The image has not been laid out, "
+                        "call nitf_Writer_write first",
+                        NITF_CTXT, NITF_ERR_INVALID_PARAMETER);
+        return NITF_FAILURE;
+    }
+
+    output = impl->output;
+    impl->output = NULL;
+    return nitf_ImageIO_writeBlocksDone(impl->imageBlocker, output, error);
+}
@@ -0,0 +1,245 @@
+/* =========================================================================
+ * This file is part of NITRO
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2010, General Dynamics - Advanced Information Systems
+ *
+ * NITRO is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "nitf/LazyTRE.h"
+#include "nitf/DefaultTRE.h"
+
+/*!
+ *  \struct LazyTREData
+ *  \brief The private data of a TRE whose parsing is deferred
+ */
+typedef struct _LazyTREData
+{
+    nitf_TREHandler *handler;       /* The handler that parses the data */
+    char *raw;                      /* The raw TRE data */
+    nitf_Uint32 length;             /* The length of the raw data */
+    struct _nitf_Record *record;    /* The record the TRE was read from */
+} LazyTREData;
+
+
+NITFPRIV(void) LazyTREData_destruct(LazyTREData ** data)
+{
+    if (*data)
+    {
+        if ((*data)->raw)
+            NITF_FREE((*data)->raw);
+        NITF_FREE(*data);
+        *data = NULL;
+    }
+}
+
+
+NITFPRIV(NITF_BOOL) lazyInit(nitf_TRE * tre, const char *id,
+                             nitf_Error * error)
+{
+    nitf_Error_init(error, "Lazy TREs can only be created by the reader",
+                    NITF_CTXT, NITF_ERR_INVALID_OBJECT);
+    return NITF_FAILURE;
+}
+
+
+NITFPRIV(const char *) lazyGetID(nitf_TRE * tre)
+{
+    nitf_Error error;
+    if (!nitf_LazyTRE_parse(tre, &error))
+        return NULL;
+    return tre->handler->getID(tre);
+}
+
+
+NITFPRIV(NITF_BOOL) lazyRead(nitf_IOInterface * io, nitf_Uint32 length,
+                             nitf_TRE * tre, struct _nitf_Record *record,
+                             nitf_Error * error)
+{
+    nitf_Error_init(error, "Lazy TREs are read by the reader",
+                    NITF_CTXT, NITF_ERR_INVALID_OBJECT);
+    return NITF_FAILURE;
+}
+
+
+NITFPRIV(NITF_BOOL) lazySetField(nitf_TRE * tre, const char *tag,
+                                 NITF_DATA * data, size_t dataLength,
+                                 nitf_Error * error)
+{
+    if (!nitf_LazyTRE_parse(tre, error))
+        return NITF_FAILURE;
+    return tre->handler->setField(tre, tag, data, dataLength, error);
+}
+
+
+NITFPRIV(nitf_Field *) lazyGetField(nitf_TRE * tre, const char *tag)
+{
+    nitf_Error error;
+    if (!nitf_LazyTRE_parse(tre, &error))
+        return NULL;
+    return tre->handler->getField(tre, tag);
+}
+
+
+NITFPRIV(nitf_List *) lazyFind(nitf_TRE * tre, const char *pattern,
+                               nitf_Error * error)
+{
+    if (!nitf_LazyTRE_parse(tre, error))
+        return NULL;
+    return tre->handler->find(tre, pattern, error);
+}
+
+
+/*  An untouched TRE goes back out exactly as it came in  */
+NITFPRIV(NITF_BOOL) lazyWrite(nitf_IOInterface * io, nitf_TRE * tre,
+                              struct _nitf_Record *record,
+                              nitf_Error * error)
+{
+    LazyTREData *data = (LazyTREData *) tre->priv;
+    return nitf_IOInterface_write(io, data->raw, data->length, error);
+}
+
+
+NITFPRIV(nitf_TREEnumerator *) lazyBegin(nitf_TRE * tre, nitf_Error * error)
+{
+    if (!nitf_LazyTRE_parse(tre, error))
+        return NULL;
+    return tre->handler->begin(tre, error);
+}
+
+
+NITFPRIV(int) lazyGetCurrentSize(nitf_TRE * tre, nitf_Error * error)
+{
+    return (int) ((LazyTREData *) tre->priv)->length;
+}
+
+
+/*
+ *  The clone gets a parsed copy.  Parsing the source first means the clone
+ *  never holds on to a record it may outlive.
+ */
+NITFPRIV(NITF_BOOL) lazyClone(nitf_TRE * source, nitf_TRE * tre,
+                              nitf_Error * error)
+{
+    if (!nitf_LazyTRE_parse(source, error))
+        return NITF_FAILURE;
+
+    tre->handler = source->handler;
+    if (tre->handler->clone)
+        return tre->handler->clone(source, tre, error);
+    return NITF_SUCCESS;
+}
+
+
+NITFPRIV(void) lazyDestruct(nitf_TRE * tre)
+{
+    LazyTREData_destruct((LazyTREData **) & tre->priv);
+}
+
+
+NITFAPI(nitf_TREHandler *) nitf_LazyTRE_handler(nitf_Error * error)
+{
+    static nitf_TREHandler handler =
+    {
+        lazyInit,
+        lazyGetID,
+        lazyRead,
+        lazySetField,
+        lazyGetField,
+        lazyFind,
+        lazyWrite,
+        lazyBegin,
+        lazyGetCurrentSize,
+        lazyClone,
+        lazyDestruct,
+        NULL    /* data - We don't need this! */
+    };
+
+    return &handler;
+}
+
+
+NITFPROT(NITF_BOOL) nitf_LazyTRE_adopt(nitf_TRE * tre,
+                                       nitf_TREHandler * handler,
+                                       char *raw,
+                                       nitf_Uint32 length,
+                                       struct _nitf_Record *record,
+                                       nitf_Error * error)
+{
+    LazyTREData *data = (LazyTREData *) NITF_MALLOC(sizeof(LazyTREData));
+    if (!data)
+    {
+        NITF_FREE(raw);
+        nitf_Error_init(error, NITF_STRERROR(NITF_ERRNO),
+                        NITF_CTXT, NITF_ERR_MEMORY);
+        return NITF_FAILURE;
+    }
+    data->handler = handler;
+    data->raw = raw;
+    data->length = length;
+    data->record = record;
+
+    tre->handler = nitf_LazyTRE_handler(error);
+    tre->priv = data;
+    return NITF_SUCCESS;
+}
+
+
+NITFAPI(NITF_BOOL) nitf_LazyTRE_parse(nitf_TRE * tre, nitf_Error * error)
+{
+    LazyTREData *data;
+    nitf_IOInterface *io;
+    NITF_BOOL ok = NITF_FAILURE;
+
+    if (!tre || tre->handler != nitf_LazyTRE_handler(error))
+        return NITF_SUCCESS;
+
+    data = (LazyTREData *) tre->priv;
+    io = nitf_BufferAdapter_construct(data->raw, data->length, 0, error);
+    if (!io)
+        return NITF_FAILURE;
+
+    /*  Hand the TRE to the real handler before it reads, as the reader does */
+    tre->handler = data->handler;
+    tre->priv = NULL;
+    ok = tre->handler->read(io, data->length, tre, data->record, error);
+
+    /* if we couldn't parse it with the plug-in, use the default handler */
+    if (!ok && tre->handler != nitf_DefaultTRE_handler(error))
+    {
+        tre->priv = NULL;
+        if (nitf_IOInterface_seek(io, 0, NITF_SEEK_SET, error) == 0)
+        {
+            tre->handler = nitf_DefaultTRE_handler(error);
+            ok = tre->handler->read(io, data->length, tre, data->record,
+                                    error);
+        }
+    }
+    nitf_IOInterface_destruct(&io);
+
+    if (!ok)
+    {
+        /* leave the TRE as it was, so it can still be written verbatim */
+        tre->handler = nitf_LazyTRE_handler(error);
+        tre->priv = data;
+        return NITF_FAILURE;
+    }
+
+    LazyTREData_destruct(&data);
+    return NITF_SUCCESS;
+}
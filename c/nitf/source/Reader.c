@@ -125,6 +125,46 @@ NITF_TRY_GET_UINT32|64() -- these are public macros found in nitf/Value.h
 #define TRY_READ_MEMBER_VALUE(reader_, OWNER, ID) \
     if (!readValue(reader_, OWNER->ID, ID##_SZ, error)) goto CATCH_ERROR;
 
+/*  Fetch a whole subheader at once, using the length from the file   */
+/*  header's component info                                           */
+#define TRY_BUFFER_SUBHEADER(reader_, info_) \
+    NITF_TRY_GET_UINT32(info_->lengthSubheader, &length32, error); \
+    if (!bufferRegion(reader_, length32, error)) goto CATCH_ERROR;
+
+/*  Add the segments of one type to an index-only record.  Each        */
+/*  segment's data location follows from the component info lengths,  */
+/*  starting at offset, which is advanced past the segments.           */
+#define TRY_INDEX_SEGMENTS(reader_, type_, Segment_, list_, numValue_, \
+                           info_, start_, end_) \
+    NITF_TRY_GET_UINT32(reader_->record->header->numValue_, &num32, error); \
+    reader_->loaded[type_] = (nitf_Uint8 *) NITF_MALLOC(num32 + 1); \
+    if (!reader_->loaded[type_]) \
+    { \
+        nitf_Error_init(error, NITF_STRERROR(NITF_ERRNO), \
+                        NITF_CTXT, NITF_ERR_MEMORY); \
+        goto CATCH_ERROR; \
+    } \
+    memset(reader_->loaded[type_], 0, num32 + 1); \
+    reader_->numIndexed[type_] = num32; \
+    for (i = 0; i < num32; i++) \
+    { \
+        nitf_##Segment_ *segment_ = nitf_##Segment_##_construct(error); \
+        if (!segment_) goto CATCH_ERROR; \
+        if (!nitf_List_pushBack(reader_->record->list_, \
+                                (NITF_DATA *) segment_, error)) \
+        { \
+            nitf_##Segment_##_destruct(&segment_); \
+            goto CATCH_ERROR; \
+        } \
+        NITF_TRY_GET_UINT32(reader_->record->header->info_[i]-> \
+                            lengthSubheader, &length32, error); \
+        NITF_TRY_GET_UINT64(reader_->record->header->info_[i]->lengthData, \
+                            &length, error); \
+        segment_->start_ = offset + length32; \
+        segment_->end_ = segment_->start_ + length; \
+        offset = segment_->end_; \
+    }
+
 #define TRY_READ_COMPONENT(reader_, infoPtrPtr_, numValue_, \
                            subHdrSz_,  dataSz_) \
 if (!readComponentInfo(reader_, \
@@ -137,6 +177,54 @@ if (!readComponentInfo(reader_, \
 /*  This is the size of each num* (numi, numx, nums, numdes, numres)  */
 #define NITF_IVAL_SZ 3
 
+/*  Size of the reads made when a header field is outside of the      */
+/*  buffered region.  Reads at least this big bypass the buffer.      */
+#define NITF_READER_BUFFER_SZ 16384
+
+/*  Fields up to this size are read into a stack buffer by readValue  */
+#define NITF_READER_VALUE_SZ 256
+
+/*
+ *  The headers are parsed through a buffered view of the input.  The
+ *  reader fetches each header and subheader region with one read once its
+ *  length is known (see bufferRegion), and the fields are then copied out
+ *  of memory.  Offsets given to seek and tell are file offsets, so TRE
+ *  handlers and segment offsets are unaffected.
+ */
+typedef struct _HeaderBufferControl
+{
+    nitf_IOInterface *source;   /* The input being buffered */
+    char *buf;                  /* Buffered bytes */
+    size_t capacity;            /* Allocated size of buf */
+    nitf_Off start;             /* File offset of buf[0] */
+    size_t size;                /* Number of valid bytes in buf */
+    nitf_Off mark;              /* Current file offset */
+    nitf_Off fileSize;          /* Size of the input */
+} HeaderBufferControl;
+
+/*
+ *  Shared state of nitf_Reader_scanFiles.  Each worker takes the next
+ *  file from the list until there are none left.
+ */
+typedef struct _ScanWork
+{
+    const char **fileNames;             /* The files to scan */
+    nitf_Uint32 numFiles;               /* The number of files */
+    nitf_Uint32 next;                   /* The next file to scan */
+    NITF_READER_SCAN_FUNCTION callback; /* Called for each file */
+    NITF_DATA *userData;                /* Passed to the callback */
+    nitf_Mutex lock;                    /* Protects next */
+} ScanWork;
+
+/*  Worker thread of nitf_Reader_scanFiles  */
+NITFPRIV(void) scanWorker(void *data);
+
+NITFPRIV(nitf_IOInterface *) HeaderBuffer_construct(nitf_IOInterface * source,
+                                                    nitf_Error * error);
+
+NITFPRIV(NITF_BOOL) bufferRegion(nitf_Reader * reader, nitf_Uint64 length,
+                                 nitf_Error * error);
+
 NITFPRIV(nitf_BandInfo **) readBandInfo(nitf_Reader * reader,
                                         unsigned int nbands,
                                         nitf_Error * error);
@@ -157,6 +245,10 @@ NITFPRIV(NITF_BOOL) readValue(nitf_Reader * reader,
 NITFPRIV(NITF_BOOL) handleTRE(nitf_Reader * reader, nitf_Uint32 length,
                               nitf_TRE * tre, nitf_Error * error);
 
+/*  This method stores the raw bytes of a TRE for parsing on first access  */
+NITFPRIV(NITF_BOOL) deferTRE(nitf_Reader * reader, nitf_Uint32 length,
+                             nitf_TRE * tre, nitf_Error * error);
+
 /*  This method reads the extra sections from the header, if    */
 /*  there _are_ any.  If not, no big deal.                      */
 NITFPRIV(NITF_BOOL) readExtras(nitf_Reader * reader,
@@ -265,12 +357,18 @@ NITFPRIV(NITF_BOOL) readValue(nitf_Reader * reader,
                               nitf_Field * field,
                               int length, nitf_Error * error)
 {
-    char *buf = (char *) NITF_MALLOC(length);
-    if (!buf)
+    char local[NITF_READER_VALUE_SZ];   /* Buffer for most fields */
+    char *buf = local;
+
+    if (length > NITF_READER_VALUE_SZ)
     {
-        nitf_Error_init(error, NITF_STRERROR(NITF_ERRNO),
-                NITF_CTXT, NITF_ERR_MEMORY);
-        goto CATCH_ERROR;
+        buf = (char *) NITF_MALLOC(length);
+        if (!buf)
+        {
+            nitf_Error_init(error, NITF_STRERROR(NITF_ERRNO),
+                    NITF_CTXT, NITF_ERR_MEMORY);
+            goto CATCH_ERROR;
+        }
     }
 
     if (!readField(reader, buf, length, error))
@@ -308,11 +406,12 @@ NITFPRIV(NITF_BOOL) readValue(nitf_Reader * reader,
             goto CATCH_ERROR;
     }
 
-    NITF_FREE(buf);
+    if (buf != local)
+        NITF_FREE(buf);
     return NITF_SUCCESS;
 
 CATCH_ERROR:
-    if (buf) NITF_FREE(buf);
+    if (buf && buf != local) NITF_FREE(buf);
     return NITF_FAILURE;
 }
 
@@ -410,6 +509,285 @@ CATCH_ERROR:
 }
 
 
+/*  Load length bytes at offset into the header buffer  */
+NITFPRIV(NITF_BOOL) HeaderBuffer_fill(HeaderBufferControl * control,
+                                      nitf_Off offset, size_t length,
+                                      nitf_Error * error)
+{
+    char *buf;
+
+    /* Never read past the end of the input */
+    if (offset >= control->fileSize)
+        length = 0;
+    else if ((nitf_Off) length > control->fileSize - offset)
+        length = (size_t) (control->fileSize - offset);
+
+    if (length > control->capacity)
+    {
+        buf = (char *) NITF_REALLOC(control->buf, length);
+        if (!buf)
+        {
+            nitf_Error_init(error, NITF_STRERROR(NITF_ERRNO),
+                            NITF_CTXT, NITF_ERR_MEMORY);
+            return NITF_FAILURE;
+        }
+        control->buf = buf;
+        control->capacity = length;
+    }
+
+    /* Forget the old contents in case the read fails */
+    control->start = offset;
+    control->size = 0;
+    if (length == 0)
+        return NITF_SUCCESS;
+
+    if (nitf_IOInterface_canReadAt(control->source))
+    {
+        if (!nitf_IOInterface_readAt(control->source, offset,
+                                     control->buf, length, error))
+            return NITF_FAILURE;
+    }
+    else
+    {
+        if (!NITF_IO_SUCCESS(nitf_IOInterface_seek(control->source, offset,
+                                                   NITF_SEEK_SET, error)))
+            return NITF_FAILURE;
+        if (!nitf_IOInterface_read(control->source, control->buf, length,
+                                   error))
+            return NITF_FAILURE;
+    }
+    control->size = length;
+    return NITF_SUCCESS;
+}
+
+
+/*  Is the region [offset, offset + length) in the buffer  */
+NITFPRIV(NITF_BOOL) HeaderBuffer_holds(HeaderBufferControl * control,
+                                       nitf_Off offset, size_t length)
+{
+    return offset >= control->start
+        && offset - control->start <= (nitf_Off) control->size
+        && (nitf_Off) length <=
+               (nitf_Off) control->size - (offset - control->start);
+}
+
+
+NITFPRIV(NITF_BOOL) HeaderBuffer_read(NITF_DATA * data, char *buf,
+                                      size_t size, nitf_Error * error)
+{
+    HeaderBufferControl *control = (HeaderBufferControl *) data;
+
+    if (!HeaderBuffer_holds(control, control->mark, size))
+    {
+        /* Big reads (LUTs, overflow data) go straight to the input */
+        if (size >= NITF_READER_BUFFER_SZ)
+        {
+            if (!NITF_IO_SUCCESS(nitf_IOInterface_seek(control->source,
+                                                       control->mark,
+                                                       NITF_SEEK_SET,
+                                                       error)))
+                return NITF_FAILURE;
+            if (!nitf_IOInterface_read(control->source, buf, size, error))
+                return NITF_FAILURE;
+            control->mark += size;
+            return NITF_SUCCESS;
+        }
+
+        if (!HeaderBuffer_fill(control, control->mark,
+                               NITF_READER_BUFFER_SZ, error))
+            return NITF_FAILURE;
+
+        if (!HeaderBuffer_holds(control, control->mark, size))
+        {
+            nitf_Error_init(error, "Invalid size requested - EOF",
+                            NITF_CTXT, NITF_ERR_READING_FROM_FILE);
+            return NITF_FAILURE;
+        }
+    }
+
+    memcpy(buf, control->buf + (size_t) (control->mark - control->start),
+           size);
+    control->mark += size;
+    return NITF_SUCCESS;
+}
+
+
+NITFPRIV(NITF_BOOL) HeaderBuffer_write(NITF_DATA * data, const char *buf,
+                                       size_t size, nitf_Error * error)
+{
+    /* Silence compiler warnings about unused variables */
+    (void)data;
+    (void)buf;
+    (void)size;
+
+    nitf_Error_init(error, "Header buffers are read only",
+                    NITF_CTXT, NITF_ERR_WRITING_TO_FILE);
+    return NITF_FAILURE;
+}
+
+
+NITFPRIV(NITF_BOOL) HeaderBuffer_canSeek(NITF_DATA * data,
+                                         nitf_Error * error)
+{
+    /* Silence compiler warnings about unused variables */
+    (void)data;
+    (void)error;
+
+    return NITF_SUCCESS;
+}
+
+
+NITFPRIV(nitf_Off) HeaderBuffer_seek(NITF_DATA * data, nitf_Off offset,
+                                     int whence, nitf_Error * error)
+{
+    HeaderBufferControl *control = (HeaderBufferControl *) data;
+    nitf_Off mark;
+
+    if (whence == NITF_SEEK_SET)
+        mark = offset;
+    else if (whence == NITF_SEEK_CUR)
+        mark = control->mark + offset;
+    else if (whence == NITF_SEEK_END)
+        mark = control->fileSize + offset;
+    else
+    {
+        nitf_Error_init(error, "Invalid/unsupported seek directive",
+                        NITF_CTXT, NITF_ERR_READING_FROM_FILE);
+        return -1;
+    }
+
+    if (mark < 0)
+    {
+        nitf_Error_init(error, "Invalid offset requested",
+                        NITF_CTXT, NITF_ERR_READING_FROM_FILE);
+        return -1;
+    }
+    control->mark = mark;
+    return mark;
+}
+
+
+NITFPRIV(nitf_Off) HeaderBuffer_tell(NITF_DATA * data, nitf_Error * error)
+{
+    /* Silence compiler warnings about unused variables */
+    (void)error;
+
+    return ((HeaderBufferControl *) data)->mark;
+}
+
+
+NITFPRIV(nitf_Off) HeaderBuffer_getSize(NITF_DATA * data, nitf_Error * error)
+{
+    /* Silence compiler warnings about unused variables */
+    (void)error;
+
+    return ((HeaderBufferControl *) data)->fileSize;
+}
+
+
+NITFPRIV(int) HeaderBuffer_getMode(NITF_DATA * data, nitf_Error * error)
+{
+    return nitf_IOInterface_getMode(((HeaderBufferControl *) data)->source,
+                                    error);
+}
+
+
+NITFPRIV(NITF_BOOL) HeaderBuffer_close(NITF_DATA * data, nitf_Error * error)
+{
+    /* Silence compiler warnings about unused variables */
+    (void)data;
+    (void)error;
+
+    /* The source belongs to the caller */
+    return NITF_SUCCESS;
+}
+
+
+NITFPRIV(void) HeaderBuffer_destruct(NITF_DATA * data)
+{
+    HeaderBufferControl *control = (HeaderBufferControl *) data;
+    if (control && control->buf)
+    {
+        NITF_FREE(control->buf);
+        control->buf = NULL;
+    }
+}
+
+
+static nitf_IIOInterface headerBufferInterface = {
+    &HeaderBuffer_read,
+    &HeaderBuffer_write,
+    &HeaderBuffer_canSeek,
+    &HeaderBuffer_seek,
+    &HeaderBuffer_tell,
+    &HeaderBuffer_getSize,
+    &HeaderBuffer_getMode,
+    &HeaderBuffer_close,
+    &HeaderBuffer_destruct
+};
+
+
+NITFPRIV(nitf_IOInterface *) HeaderBuffer_construct(nitf_IOInterface * source,
+                                                    nitf_Error * error)
+{
+    nitf_IOInterface *impl = NULL;
+    HeaderBufferControl *control = NULL;
+
+    impl = (nitf_IOInterface *) NITF_MALLOC(sizeof(nitf_IOInterface));
+    if (!impl)
+    {
+        nitf_Error_init(error, NITF_STRERROR(NITF_ERRNO),
+                        NITF_CTXT, NITF_ERR_MEMORY);
+        return NULL;
+    }
+    memset(impl, 0, sizeof(nitf_IOInterface));
+
+    control = (HeaderBufferControl *)
+              NITF_MALLOC(sizeof(HeaderBufferControl));
+    if (!control)
+    {
+        nitf_Error_init(error, NITF_STRERROR(NITF_ERRNO),
+                        NITF_CTXT, NITF_ERR_MEMORY);
+        NITF_FREE(impl);
+        return NULL;
+    }
+    memset(control, 0, sizeof(HeaderBufferControl));
+    control->source = source;
+
+    impl->data = (NITF_DATA *) control;
+    impl->iface = &headerBufferInterface;
+
+    control->mark = nitf_IOInterface_tell(source, error);
+    control->fileSize = nitf_IOInterface_getSize(source, error);
+    if (!NITF_IO_SUCCESS(control->mark)
+        || !NITF_IO_SUCCESS(control->fileSize))
+    {
+        nitf_IOInterface_destruct(&impl);
+        return NULL;
+    }
+    return impl;
+}
+
+
+/*  Fetch the next length bytes of the input with one read, if the   */
+/*  headers are being read through a header buffer                   */
+NITFPRIV(NITF_BOOL) bufferRegion(nitf_Reader * reader, nitf_Uint64 length,
+                                 nitf_Error * error)
+{
+    HeaderBufferControl *control;
+
+    if (reader->input->iface != &headerBufferInterface)
+        return NITF_SUCCESS;
+
+    control = (HeaderBufferControl *) reader->input->data;
+    if ((nitf_Off) length > control->fileSize
+        || HeaderBuffer_holds(control, control->mark, (size_t) length))
+        return NITF_SUCCESS;
+
+    return HeaderBuffer_fill(control, control->mark, (size_t) length, error);
+}
+
+
 NITFPRIV(void) resetIOInterface(nitf_Reader * reader)
 {
     if (reader->input && reader->ownInput)
@@ -419,6 +797,24 @@ NITFPRIV(void) resetIOInterface(nitf_Reader * reader)
 }
 
 
+/*
+ *  Forget which subheaders of the last index record were loaded. With no
+ *  flags, every subheader of the record counts as loaded.
+ */
+NITFPRIV(void) resetLoaded(nitf_Reader * reader)
+{
+    int type;
+
+    for (type = NITF_SEGMENT_IMAGE; type <= NITF_SEGMENT_RE; type++)
+    {
+        if (reader->loaded[type])
+            NITF_FREE(reader->loaded[type]);
+        reader->loaded[type] = NULL;
+        reader->numIndexed[type] = 0;
+    }
+}
+
+
 NITFAPI(nitf_Reader *) nitf_Reader_construct(nitf_Error * error)
 {
     /*  Create the reader */
@@ -443,6 +839,11 @@ NITFAPI(nitf_Reader *) nitf_Reader_construct(nitf_Error * error)
     reader->record = NULL;
     reader->input = NULL;
     reader->ownInput = 0;
+    reader->lazyTREs = 0;
+    reader->useArena = 0;
+    reader->arena = NULL;
+    memset(reader->loaded, 0, sizeof(reader->loaded));
+    resetLoaded(reader);
     resetIOInterface(reader);
 
     /*  Return our results  */
@@ -494,6 +895,10 @@ NITFAPI(void) nitf_Reader_destruct(nitf_Reader ** reader)
 
         /* this will delete the input if we own it */
         resetIOInterface(*reader);
+        resetLoaded(*reader);
+
+        /* The record holds the arena for as long as it needs it */
+        nitf_Arena_release(&(*reader)->arena);
 
         (*reader)->warningList = NULL;
         (*reader)->record = NULL;
@@ -504,6 +909,50 @@ NITFAPI(void) nitf_Reader_destruct(nitf_Reader ** reader)
 }
 
 
+NITFAPI(void) nitf_Reader_setLazyTREs(nitf_Reader * reader, NITF_BOOL lazy)
+{
+    reader->lazyTREs = lazy;
+}
+
+
+NITFAPI(void) nitf_Reader_setUseArena(nitf_Reader * reader, NITF_BOOL use)
+{
+    reader->useArena = use;
+}
+
+
+/*
+ *  Make the reader's arena current on this thread while it parses.  A new
+ *  record gets a new arena, and the reader gives up its reference to the
+ *  old one, which lives on until the old record is destroyed.  The arena
+ *  that was current before is returned in previous, for leaveArena.
+ */
+NITFPRIV(NITF_BOOL) enterArena(nitf_Reader * reader, NITF_BOOL newRecord,
+                               nitf_Arena ** previous, nitf_Error * error)
+{
+    *previous = nitf_Arena_setCurrent(NULL);
+    nitf_Arena_setCurrent(*previous);
+    if (!reader->useArena)
+        return NITF_SUCCESS;
+
+    if (newRecord || !reader->arena)
+    {
+        nitf_Arena_release(&reader->arena);
+        reader->arena = nitf_Arena_construct(0, error);
+        if (!reader->arena)
+            return NITF_FAILURE;
+    }
+    nitf_Arena_setCurrent(reader->arena);
+    return NITF_SUCCESS;
+}
+
+
+NITFPRIV(void) leaveArena(nitf_Arena * previous)
+{
+    nitf_Arena_setCurrent(previous);
+}
+
+
 NITFPRIV(NITF_BOOL) readImageSubheader(nitf_Reader * reader,
                                        unsigned int imageIndex,
                                        nitf_Version fver,
@@ -954,6 +1403,7 @@ NITFPRIV(NITF_BOOL) readHeader(nitf_Reader * reader, nitf_Error * error)
 
     char fileLenBuf[NITF_FL_SZ + 1];    /* File length buffer */
     char streamingBuf[NITF_FL_SZ];
+    nitf_Off headerOffset;              /* Offset just past HL */
 
     /* FHDR */
     TRY_READ_MEMBER_VALUE(reader, fileHeader, NITF_FHDR);
@@ -1028,6 +1478,14 @@ NITFPRIV(NITF_BOOL) readHeader(nitf_Reader * reader, nitf_Error * error)
     TRY_READ_MEMBER_VALUE(reader, fileHeader, NITF_HL);
     NITF_TRY_GET_UINT32(fileHeader->NITF_HL, &num32, error);
 
+    /* Fetch the rest of the header at once */
+    headerOffset = nitf_IOInterface_tell(reader->input, error);
+    if (!NITF_IO_SUCCESS(headerOffset))
+        goto CATCH_ERROR;
+    if ((nitf_Off) num32 > headerOffset)
+        if (!bufferRegion(reader, num32 - headerOffset, error))
+            goto CATCH_ERROR;
+
     /* Read the image info section */
     TRY_READ_COMPONENT(reader,
                        &fileHeader->imageInfo,
@@ -1206,7 +1664,12 @@ NITFPRIV(NITF_BOOL) readTRE(nitf_Reader * reader,
     if (!tre)
         goto CATCH_ERROR;
 
-    if (!handleTRE(reader, length, tre, error))
+    if (reader->lazyTREs)
+    {
+        if (!deferTRE(reader, length, tre, error))
+            goto CATCH_ERROR;
+    }
+    else if (!handleTRE(reader, length, tre, error))
         goto CATCH_ERROR;
 
     /*  Insert the tre into the data store  */
@@ -1278,6 +1741,45 @@ CATCH_ERROR:
 }
 
 
+NITFPRIV(NITF_BOOL) deferTRE(nitf_Reader * reader, nitf_Uint32 length,
+                             nitf_TRE * tre, nitf_Error * error)
+{
+    int bad = 0;
+    char *raw = NULL;
+    nitf_TREHandler* handler = NULL;
+
+    nitf_PluginRegistry *reg = nitf_PluginRegistry_getInstance(error);
+    if (reg)
+    {
+        handler = nitf_PluginRegistry_retrieveTREHandler(reg, tre->tag,
+                                                         &bad, error);
+        if (bad)
+            goto CATCH_ERROR;
+    }
+    if (!handler)
+        handler = nitf_DefaultTRE_handler(error);
+
+    /* one extra byte so a zero length TRE still gets a buffer */
+    raw = (char *) NITF_MALLOC(length + 1);
+    if (!raw)
+    {
+        nitf_Error_init(error, NITF_STRERROR(NITF_ERRNO),
+                        NITF_CTXT, NITF_ERR_MEMORY);
+        goto CATCH_ERROR;
+    }
+    if (!nitf_IOInterface_read(reader->input, raw, length, error))
+        goto CATCH_ERROR;
+
+    /* the TRE owns the buffer from here on */
+    return nitf_LazyTRE_adopt(tre, handler, raw, length,
+                              reader->record, error);
+
+CATCH_ERROR:
+    if (raw) NITF_FREE(raw);
+    return NITF_FAILURE;
+}
+
+
 NITFPRIV(NITF_BOOL) readCorners(nitf_Reader * reader,
                                 nitf_ImageSubheader * subhdr,
                                 nitf_Version fver, nitf_Error * error)
@@ -1391,9 +1893,9 @@ NITFAPI(nitf_Record *) nitf_Reader_read(nitf_Reader * reader,
 }
 
 
-NITFAPI(nitf_Record *) nitf_Reader_readIO(nitf_Reader* reader,
-                                          nitf_IOInterface* io,
-                                          nitf_Error* error)
+NITFPRIV(nitf_Record *) readRecord(nitf_Reader * reader,
+                                   nitf_IOInterface * io,
+                                   nitf_Error * error)
 {
     nitf_Uint32 i = 0;          /* iterator */
     nitf_ListIterator listIter; /* list iterator */
@@ -1402,6 +1904,7 @@ NITFAPI(nitf_Record *) nitf_Reader_readIO(nitf_Reader* reader,
     nitf_Uint64 length;
     nitf_Version fver;
 
+    resetLoaded(reader);
     reader->record = nitf_Record_construct(NITF_VER_21, error);
     if (!reader->record)
     {
@@ -1414,6 +1917,14 @@ NITFAPI(nitf_Record *) nitf_Reader_readIO(nitf_Reader* reader,
     if (!reader->input)
         goto CATCH_ERROR;
 
+    /* Parse the headers through a buffer, restored before returning */
+    reader->input = HeaderBuffer_construct(io, error);
+    if (!reader->input)
+    {
+        reader->input = io;
+        goto CATCH_ERROR;
+    }
+
     /*  This part is trivial thanks to our readHeader accessor  */
     if (!readHeader(reader, error))
         goto CATCH_ERROR;
@@ -1439,6 +1950,9 @@ NITFAPI(nitf_Record *) nitf_Reader_readIO(nitf_Reader* reader,
             goto CATCH_ERROR;
         }
 
+        TRY_BUFFER_SUBHEADER(reader,
+                             reader->record->header->imageInfo[i]);
+
         /* Read the sub-header */
         if (!readImageSubheader(reader, i, fver, error))
             goto CATCH_ERROR;
@@ -1483,6 +1997,9 @@ NITFAPI(nitf_Record *) nitf_Reader_readIO(nitf_Reader* reader,
             goto CATCH_ERROR;
         }
 
+        TRY_BUFFER_SUBHEADER(reader,
+                             reader->record->header->graphicInfo[i]);
+
         if (!readGraphicSubheader(reader, i, fver, error))
             goto CATCH_ERROR;
         graphicSegment->offset = nitf_IOInterface_tell(reader->input,
@@ -1521,6 +2038,9 @@ NITFAPI(nitf_Record *) nitf_Reader_readIO(nitf_Reader* reader,
             goto CATCH_ERROR;
         }
 
+        TRY_BUFFER_SUBHEADER(reader,
+                             reader->record->header->labelInfo[i]);
+
         if (!readLabelSubheader(reader, i, fver, error))
             goto CATCH_ERROR;
         labelSegment->offset = nitf_IOInterface_tell(reader->input,
@@ -1557,6 +2077,9 @@ NITFAPI(nitf_Record *) nitf_Reader_readIO(nitf_Reader* reader,
             goto CATCH_ERROR;
         }
 
+        TRY_BUFFER_SUBHEADER(reader,
+                             reader->record->header->textInfo[i]);
+
         if (!readTextSubheader(reader, i, fver, error))
             goto CATCH_ERROR;
         textSegment->offset = nitf_IOInterface_tell(reader->input,
@@ -1595,6 +2118,9 @@ NITFAPI(nitf_Record *) nitf_Reader_readIO(nitf_Reader* reader,
             goto CATCH_ERROR;
         }
 
+        TRY_BUFFER_SUBHEADER(reader,
+                             reader->record->header->dataExtensionInfo[i]);
+
         if (!readDESubheader(reader, i, fver, error))
             goto CATCH_ERROR;
 
@@ -1619,6 +2145,9 @@ NITFAPI(nitf_Record *) nitf_Reader_readIO(nitf_Reader* reader,
             goto CATCH_ERROR;
         }
 
+        TRY_BUFFER_SUBHEADER(reader,
+                             reader->record->header->reservedExtensionInfo[i]);
+
         if (!readRESubheader(reader, i, fver, error))
             goto CATCH_ERROR;
 
@@ -1633,15 +2162,467 @@ NITFAPI(nitf_Record *) nitf_Reader_readIO(nitf_Reader* reader,
         }
     }
 
+    nitf_IOInterface_destruct(&reader->input);
+    reader->input = io;
+    return reader->record;
+
+CATCH_ERROR:
+    if (reader->input && reader->input != io)
+        nitf_IOInterface_destruct(&reader->input);
+    reader->input = io;
+    nitf_Record_destruct(&reader->record);
+    resetIOInterface(reader);
+    return NULL;
+}
+
+
+NITFAPI(nitf_Record *) nitf_Reader_readIO(nitf_Reader* reader,
+                                          nitf_IOInterface* io,
+                                          nitf_Error* error)
+{
+    nitf_Record *record;
+    nitf_Arena *previous;
+
+    if (!enterArena(reader, 1, &previous, error))
+        return NULL;
+    record = readRecord(reader, io, error);
+    leaveArena(previous);
+    return record;
+}
+
+
+NITFAPI(nitf_Record *) nitf_Reader_readIndex(nitf_Reader * reader,
+                                             nitf_IOHandle ioHandle,
+                                             nitf_Error * error)
+{
+    nitf_Record *record = NULL;
+    nitf_IOInterface *io = NULL;
+
+    io = nitf_IOHandleAdapter_construct(ioHandle, NRT_ACCESS_READONLY, error);
+    if (!io)
+        return NULL;
+
+    record = nitf_Reader_readIndexIO(reader, io, error);
+    if (!record)
+    {
+        nitf_IOInterface_destruct(&io);
+        return NULL;
+    }
+    reader->ownInput = 1; /* we own the IOInterface */
+    return record;
+}
+
+
+NITFPRIV(nitf_Record *) readIndexRecord(nitf_Reader * reader,
+                                        nitf_IOInterface * io,
+                                        nitf_Error * error)
+{
+    nitf_Uint32 i = 0;          /* iterator */
+    nitf_Uint32 num32;          /* generic uint32 */
+    nitf_Uint32 length32;
+    nitf_Uint64 length;
+    nitf_Off offset;            /* Offset of the next segment */
+    NITF_BOOL lazyTREs = reader->lazyTREs;
+
+    resetLoaded(reader);
+    reader->record = nitf_Record_construct(NITF_VER_21, error);
+    if (!reader->record)
+        return NULL;
+
+    resetIOInterface(reader);
+    reader->input = io;
+    if (!reader->input)
+        goto CATCH_ERROR;
+
+    reader->input = HeaderBuffer_construct(io, error);
+    if (!reader->input)
+    {
+        reader->input = io;
+        goto CATCH_ERROR;
+    }
+
+    /* Only the TREs that get looked at are parsed */
+    reader->lazyTREs = 1;
+    if (!readHeader(reader, error))
+        goto CATCH_ERROR;
+    reader->lazyTREs = lazyTREs;
+
+    /* The first segment starts right after the header */
+    offset = nitf_IOInterface_tell(reader->input, error);
+    if (!NITF_IO_SUCCESS(offset))
+        goto CATCH_ERROR;
+
+    TRY_INDEX_SEGMENTS(reader, NITF_SEGMENT_IMAGE, ImageSegment, images,
+                       numImages, imageInfo, imageOffset, imageEnd);
+    TRY_INDEX_SEGMENTS(reader, NITF_SEGMENT_GRAPHIC, GraphicSegment,
+                       graphics, numGraphics, graphicInfo, offset, end);
+    TRY_INDEX_SEGMENTS(reader, NITF_SEGMENT_LABEL, LabelSegment, labels,
+                       numLabels, labelInfo, offset, end);
+    TRY_INDEX_SEGMENTS(reader, NITF_SEGMENT_TEXT, TextSegment, texts,
+                       numTexts, textInfo, offset, end);
+    TRY_INDEX_SEGMENTS(reader, NITF_SEGMENT_DE, DESegment, dataExtensions,
+                       numDataExtensions, dataExtensionInfo, offset, end);
+    TRY_INDEX_SEGMENTS(reader, NITF_SEGMENT_RE, RESegment,
+                       reservedExtensions, numReservedExtensions,
+                       reservedExtensionInfo, offset, end);
+
+    nitf_IOInterface_destruct(&reader->input);
+    reader->input = io;
     return reader->record;
 
 CATCH_ERROR:
+    reader->lazyTREs = lazyTREs;
+    if (reader->input && reader->input != io)
+        nitf_IOInterface_destruct(&reader->input);
+    reader->input = io;
     nitf_Record_destruct(&reader->record);
     resetIOInterface(reader);
+    resetLoaded(reader);
     return NULL;
 }
 
 
+NITFAPI(nitf_Record *) nitf_Reader_readIndexIO(nitf_Reader * reader,
+                                               nitf_IOInterface * io,
+                                               nitf_Error * error)
+{
+    nitf_Record *record;
+    nitf_Arena *previous;
+
+    if (!enterArena(reader, 1, &previous, error))
+        return NULL;
+    record = readIndexRecord(reader, io, error);
+    leaveArena(previous);
+    return record;
+}
+
+
+#define RESET_SUBHEADER(Segment_, Subheader_) \
+    { \
+        nitf_##Subheader_ *fresh_ = nitf_##Subheader_##_construct(&error); \
+        if (fresh_) \
+        { \
+            nitf_##Subheader_##_destruct( \
+                &(((nitf_##Segment_ *) segment)->subheader)); \
+            ((nitf_##Segment_ *) segment)->subheader = fresh_; \
+        } \
+    }
+
+/*
+ *  Replace a partly read subheader with an empty one.  If that cannot be
+ *  made, the partly read one is kept.
+ */
+NITFPRIV(void) resetSubheader(NITF_DATA * segment, nitf_SegmentType type)
+{
+    nitf_Error error;           /* Not reported, the read error is */
+
+    switch (type)
+    {
+        case NITF_SEGMENT_IMAGE:
+            RESET_SUBHEADER(ImageSegment, ImageSubheader);
+            break;
+        case NITF_SEGMENT_GRAPHIC:
+            RESET_SUBHEADER(GraphicSegment, GraphicSubheader);
+            break;
+        case NITF_SEGMENT_LABEL:
+            RESET_SUBHEADER(LabelSegment, LabelSubheader);
+            break;
+        case NITF_SEGMENT_TEXT:
+            RESET_SUBHEADER(TextSegment, TextSubheader);
+            break;
+        case NITF_SEGMENT_DE:
+            RESET_SUBHEADER(DESegment, DESubheader);
+            break;
+        default:
+            RESET_SUBHEADER(RESegment, RESubheader);
+            break;
+    }
+}
+
+
+NITFPRIV(NITF_BOOL) loadSubheader(nitf_Reader * reader,
+                                  nitf_SegmentType type,
+                                  nitf_Uint32 index,
+                                  nitf_Error * error)
+{
+    nitf_Uint32 i;
+    nitf_Uint32 num32;
+    nitf_Uint32 length32;
+    nitf_FileHeader *header;
+    nitf_Field *numField;       /* Number of segments of this type */
+    nitf_ComponentInfo **info;  /* Component info of this type */
+    nitf_List *list;            /* Segments of this type */
+    nitf_ListIterator listIter;
+    NITF_DATA *segment;
+    nitf_Off offset;            /* Offset of the segment data */
+    nitf_Version fver;
+    NITF_BOOL ok = NITF_FAILURE;
+    NITF_BOOL lazyTREs = reader->lazyTREs;
+    nitf_IOInterface *io = reader->input;
+
+    if (!reader->record || !io)
+    {
+        nitf_Error_init(error, "The reader has not read a record",
+                        NITF_CTXT, NITF_ERR_INVALID_OBJECT);
+        return NITF_FAILURE;
+    }
+    header = reader->record->header;
+    fver = nitf_Record_getVersion(reader->record);
+
+    switch (type)
+    {
+        case NITF_SEGMENT_IMAGE:
+            numField = header->numImages;
+            info = header->imageInfo;
+            list = reader->record->images;
+            break;
+        case NITF_SEGMENT_GRAPHIC:
+            numField = header->numGraphics;
+            info = header->graphicInfo;
+            list = reader->record->graphics;
+            break;
+        case NITF_SEGMENT_LABEL:
+            numField = header->numLabels;
+            info = header->labelInfo;
+            list = reader->record->labels;
+            break;
+        case NITF_SEGMENT_TEXT:
+            numField = header->numTexts;
+            info = header->textInfo;
+            list = reader->record->texts;
+            break;
+        case NITF_SEGMENT_DE:
+            numField = header->numDataExtensions;
+            info = header->dataExtensionInfo;
+            list = reader->record->dataExtensions;
+            break;
+        case NITF_SEGMENT_RE:
+            numField = header->numReservedExtensions;
+            info = header->reservedExtensionInfo;
+            list = reader->record->reservedExtensions;
+            break;
+        default:
+            nitf_Error_initf(error, NITF_CTXT, NITF_ERR_INVALID_PARAMETER,
+                             "Invalid segment type [%d]", (int) type);
+            return NITF_FAILURE;
+    }
+
+    NITF_TRY_GET_UINT32(numField, &num32, error);
+    if (index >= num32 || index >= nitf_List_size(list))
+    {
+        nitf_Error_initf(error, NITF_CTXT, NITF_ERR_INVALID_PARAMETER,
+                         "Segment index [%u] out of range", index);
+        return NITF_FAILURE;
+    }
+
+    listIter = nitf_List_begin(list);
+    for (i = 0; i < index; i++)
+        nitf_ListIterator_increment(&listIter);
+    segment = nitf_ListIterator_get(&listIter);
+
+    /*
+     * Only the segments of an index record have load flags, and a flag is
+     * only set once its subheader has been read
+     */
+    if (!reader->loaded[type] || index >= reader->numIndexed[type]
+        || reader->loaded[type][index])
+        return NITF_SUCCESS;
+
+    switch (type)
+    {
+        case NITF_SEGMENT_IMAGE:
+            offset = ((nitf_ImageSegment *) segment)->imageOffset;
+            break;
+        case NITF_SEGMENT_GRAPHIC:
+            offset = ((nitf_GraphicSegment *) segment)->offset;
+            break;
+        case NITF_SEGMENT_LABEL:
+            offset = ((nitf_LabelSegment *) segment)->offset;
+            break;
+        case NITF_SEGMENT_TEXT:
+            offset = ((nitf_TextSegment *) segment)->offset;
+            break;
+        case NITF_SEGMENT_DE:
+            offset = ((nitf_DESegment *) segment)->offset;
+            break;
+        default:
+            offset = ((nitf_RESegment *) segment)->offset;
+            break;
+    }
+
+    NITF_TRY_GET_UINT32(info[index]->lengthSubheader, &length32, error);
+    if (!NITF_IO_SUCCESS(nitf_IOInterface_seek(io, offset - length32,
+                                               NITF_SEEK_SET, error)))
+        goto CATCH_ERROR;
+
+    reader->input = HeaderBuffer_construct(io, error);
+    if (!reader->input)
+    {
+        reader->input = io;
+        goto CATCH_ERROR;
+    }
+    reader->lazyTREs = 1;
+    if (!bufferRegion(reader, length32, error))
+        goto CATCH_ERROR;
+
+    switch (type)
+    {
+        case NITF_SEGMENT_IMAGE:
+            ok = readImageSubheader(reader, index, fver, error);
+            break;
+        case NITF_SEGMENT_GRAPHIC:
+            ok = readGraphicSubheader(reader, index, fver, error);
+            break;
+        case NITF_SEGMENT_LABEL:
+            ok = readLabelSubheader(reader, index, fver, error);
+            break;
+        case NITF_SEGMENT_TEXT:
+            ok = readTextSubheader(reader, index, fver, error);
+            break;
+        case NITF_SEGMENT_DE:
+            ok = readDESubheader(reader, index, fver, error);
+            break;
+        default:
+            ok = readRESubheader(reader, index, fver, error);
+            break;
+    }
+    if (!ok)
+    {
+        /* Drop what was read, so the load can be tried again */
+        resetSubheader(segment, type);
+        goto CATCH_ERROR;
+    }
+
+    reader->loaded[type][index] = 1;
+    reader->lazyTREs = lazyTREs;
+    nitf_IOInterface_destruct(&reader->input);
+    reader->input = io;
+    return NITF_SUCCESS;
+
+CATCH_ERROR:
+    reader->lazyTREs = lazyTREs;
+    if (reader->input != io)
+        nitf_IOInterface_destruct(&reader->input);
+    reader->input = io;
+    return NITF_FAILURE;
+}
+
+
+NITFAPI(NITF_BOOL) nitf_Reader_loadSubheader(nitf_Reader * reader,
+                                             nitf_SegmentType type,
+                                             nitf_Uint32 index,
+                                             nitf_Error * error)
+{
+    NITF_BOOL ok;
+    nitf_Arena *previous;
+
+    if (!enterArena(reader, 0, &previous, error))
+        return NITF_FAILURE;
+    ok = loadSubheader(reader, type, index, error);
+    leaveArena(previous);
+    return ok;
+}
+
+
+NITFAPI(NITF_BOOL) nitf_Reader_scanFiles(const char **fileNames,
+                                         nitf_Uint32 numFiles,
+                                         nitf_Uint32 numThreads,
+                                         NITF_READER_SCAN_FUNCTION callback,
+                                         NITF_DATA * userData,
+                                         nitf_Error * error)
+{
+    ScanWork work;              /* Shared scan state */
+    nitf_Thread *threads;       /* Scan threads */
+    nitf_Error threadError;     /* Thread creation error, not reported */
+    nitf_Uint32 nStarted;       /* Number of threads started */
+    nitf_Uint32 i;
+
+    /* Load the plug-ins before any thread needs them */
+    if (!nitf_PluginRegistry_getInstance(error))
+        return NITF_FAILURE;
+
+    work.fileNames = fileNames;
+    work.numFiles = numFiles;
+    work.next = 0;
+    work.callback = callback;
+    work.userData = userData;
+    nitf_Mutex_init(&(work.lock));
+
+    if (numThreads > numFiles)
+        numThreads = numFiles;
+    numThreads = (numThreads > 1) ? numThreads - 1 : 0;
+
+    nStarted = 0;
+    threads = NULL;
+    if (numThreads > 0)
+        threads = (nitf_Thread *) NITF_MALLOC(numThreads * sizeof(nitf_Thread));
+    if (threads != NULL)
+    {
+        /* If a thread cannot be started, make do with the ones that were */
+        while ((nStarted < numThreads)
+               && nitf_Thread_create(&(threads[nStarted]), scanWorker,
+                                     &work, &threadError))
+            nStarted += 1;
+    }
+
+    /* This thread does its share of the work */
+    scanWorker(&work);
+
+    for (i = 0; i < nStarted; i++)
+        nitf_Thread_join(&(threads[i]));
+    if (threads != NULL)
+        NITF_FREE(threads);
+    nitf_Mutex_delete(&(work.lock));
+    return NITF_SUCCESS;
+}
+
+
+NITFPRIV(void) scanWorker(void *data)
+{
+    ScanWork *work = (ScanWork *) data;
+    nitf_Uint32 fileIndex;
+    const char *fileName;
+    nitf_IOInterface *io;
+    nitf_Reader *reader;
+    nitf_Record *record;
+    nitf_Error error;
+
+    for (;;)
+    {
+        nitf_Mutex_lock(&(work->lock));
+        fileIndex = work->next;
+        if (fileIndex < work->numFiles)
+            work->next += 1;
+        nitf_Mutex_unlock(&(work->lock));
+        if (fileIndex >= work->numFiles)
+            break;
+
+        fileName = work->fileNames[fileIndex];
+        reader = NULL;
+        record = NULL;
+        io = nitf_IOHandleAdapter_open(fileName, NITF_ACCESS_READONLY,
+                                       NITF_OPEN_EXISTING, &error);
+        if (io)
+            reader = nitf_Reader_construct(&error);
+        if (reader)
+            record = nitf_Reader_readIndexIO(reader, io, &error);
+
+        (*(work->callback)) (work->userData, fileIndex, fileName,
+                             record ? reader : NULL, record, &error);
+
+        if (record)
+            nitf_Record_destruct(&record);
+        if (reader)
+            nitf_Reader_destruct(&reader);
+        if (io)
+        {
+            nitf_IOInterface_close(io, &error);
+            nitf_IOInterface_destruct(&io);
+        }
+    }
+}
+
+
 NITFPRIV(nitf_DecompressionInterface *) getDecompIface(const char *comp,
         int *bad,
         nitf_Error * error)
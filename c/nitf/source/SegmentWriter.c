@@ -100,12 +100,33 @@ CATCH_ERROR:
 
 
 
+NITFPRIV(NITF_BOOL) SegmentWriter_streamLength(NITF_DATA * data,
+                                               nitf_Off * length,
+                                               nitf_Error * error)
+{
+    SegmentWriterImpl *impl = (SegmentWriterImpl *) data;
+
+    if (!impl->segmentSource)
+    {
+        nitf_Error_init(error, "No segment source attached",
+                        NITF_CTXT, NITF_ERR_INVALID_OBJECT);
+        return NITF_FAILURE;
+    }
+
+    *length = (*impl->segmentSource->iface->getSize)
+        (impl->segmentSource->data, error);
+    return NITF_IO_SUCCESS(*length);
+}
+
+
+
 NITFAPI(nitf_SegmentWriter *) nitf_SegmentWriter_construct(nitf_Error *error)
 {
     static nitf_IWriteHandler iWriteHandler =
     {
         &SegmentWriter_write,
-        &SegmentWriter_destruct
+        &SegmentWriter_destruct,
+        &SegmentWriter_streamLength
     };
 
     SegmentWriterImpl *impl = NULL;
@@ -105,6 +105,19 @@ NITFPRIV(void) WriteHandler_destruct(NITF_DATA * data)
 }
 
 
+NITFPRIV(NITF_BOOL) WriteHandler_streamLength
+    (NITF_DATA * data, nitf_Off * length, nitf_Error * error)
+{
+    WriteHandlerImpl *impl = (WriteHandlerImpl *) data;
+
+    /* Silence compiler warnings about unused variables */
+    (void)error;
+
+    *length = (nitf_Off) impl->bytes;
+    return NITF_SUCCESS;
+}
+
+
 NITFAPI(nitf_WriteHandler*)
 nitf_StreamIOWriteHandler_construct(nitf_IOInterface *ioHandle,
                                     nitf_Uint64 offset,
@@ -117,7 +130,8 @@ nitf_StreamIOWriteHandler_construct(nitf_IOInterface *ioHandle,
     /* make the interface */
     static nitf_IWriteHandler iWriteHandler = {
         &WriteHandler_write,
-        &WriteHandler_destruct
+        &WriteHandler_destruct,
+        &WriteHandler_streamLength
     };
 
     /* construct the persisent one */
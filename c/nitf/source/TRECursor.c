@@ -22,6 +22,7 @@
 
 #include "nitf/TRECursor.h"
 #include "nitf/TREPrivateData.h"
+#include "nitf/LazyTRE.h"
 
 
 #define TAG_BUF_LEN 256
@@ -99,6 +100,10 @@ NITFAPI(nitf_TRECursor) nitf_TRECursor_begin(nitf_TRE * tre)
     tre_cursor.prev_ptr = NULL;
     tre_cursor.desc_ptr = NULL;
 
+    /* a TRE the reader left unparsed has no description yet */
+    if (tre && !nitf_LazyTRE_parse(tre, &error))
+        tre = NULL;
+
     if (tre)
     {
         /* set the start index */
@@ -44,6 +44,9 @@
 /*  This is the size of each num* (numi, numx, nums, numdes, numres)  */
 #define NITF_IVAL_SZ 3
 
+/* Size of the copies from memory to the output of a streamed write */
+#define NITF_STREAM_COPY_SIZE 8192
+
 /* This MACRO writes the given value, and pads it as specified */
 /* Example: NITF_WRITE_VALUE(io, securityGroup, NITF_CLSY, SPACE, FILL_RIGHT); */
 /* It jumps to the CATCH_ERROR label if an error occurs. */
@@ -1530,16 +1533,14 @@ CATCH_ERROR:
     return NITF_FAILURE;
 }
 
-NITFPRIV(NITF_BOOL) writeDE(nitf_Writer* writer,
-                            nitf_WriteHandler * deWriter,
-                            nitf_DESubheader *subheader,
-                            nitf_IOInterface* output,
-                            nitf_Error *error)
+/* Checks for a DE segment holding TREs that overflowed a subheader */
+NITFPRIV(NITF_BOOL) isOverflowDE(nitf_DESubheader *subheader,
+                                 NITF_BOOL *overflow,
+                                 nitf_Error *error)
 {
     /* DESID for overflow check */
     char desid[NITF_DESTAG_SZ+1];
 
-    /*  Check for overflow segment */
     if(!nitf_Field_get(subheader->NITF_DESTAG,(NITF_DATA *) desid,
                     NITF_CONV_STRING,NITF_DESTAG_SZ+1, error))
     {
@@ -1550,9 +1551,25 @@ NITFPRIV(NITF_BOOL) writeDE(nitf_Writer* writer,
     }
 
     nitf_Field_trimString(desid);
-    if ((strcmp(desid, "TRE_OVERFLOW") == 0) ||
+    *overflow = (strcmp(desid, "TRE_OVERFLOW") == 0) ||
         (strcmp(desid, "Registered Extensions") == 0) ||
-        (strcmp(desid, "Controlled Extensions") == 0))
+        (strcmp(desid, "Controlled Extensions") == 0);
+    return NITF_SUCCESS;
+}
+
+NITFPRIV(NITF_BOOL) writeDE(nitf_Writer* writer,
+                            nitf_WriteHandler * deWriter,
+                            nitf_DESubheader *subheader,
+                            nitf_IOInterface* output,
+                            nitf_Error *error)
+{
+    NITF_BOOL overflow;
+
+    /*  Check for overflow segment */
+    if (!isOverflowDE(subheader, &overflow, error))
+        return NITF_FAILURE;
+
+    if (overflow)
     {
         /* TRE iterator */
         nitf_ExtensionsIterator iter;
@@ -1608,6 +1625,9 @@ NITFAPI(NITF_BOOL) nitf_Writer_write(nitf_Writer * writer,
     int skipBytes = 0;
     nitf_Version fver;
 
+    /* Blocks are written to an image after the write returns */
+    NITF_BOOL blockWrites = 0;
+
     /* Number of images */
     nitf_Uint32 numImgs = 0;
 
@@ -2201,7 +2221,17 @@ NITFAPI(NITF_BOOL) nitf_Writer_write(nitf_Writer * writer,
             goto CATCH_ERROR;
     }
 
-    nitf_Writer_destructWriters(writer);
+    /*
+     * If an image is still to receive blocks through
+     * nitf_ImageWriter_writeBlock, the write handlers are kept until the
+     * Writer is destructed or prepared again
+     */
+    for (i = 0; i < (nitf_Uint32) writer->numImageWriters
+             && writer->imageWriters; i++)
+        if (nitf_ImageWriter_writesBlocks(writer->imageWriters[i]))
+            blockWrites = 1;
+    if (!blockWrites)
+        nitf_Writer_destructWriters(writer);
 
     /*  We dont handle anything cool yet  */
     return NITF_SUCCESS;
@@ -2235,6 +2265,581 @@ CATCH_ERROR:
 }
 
 
+/*
+ *  Output of a streamed write. The writes go straight to the user's
+ *  interface, which need not be able to seek. The position is kept here
+ *  so that seeking to where the output already is (as the image writers
+ *  do before each block) succeeds without touching the interface.
+ */
+typedef struct _StreamOutputControl
+{
+    nitf_IOInterface *io;
+    nitf_Off position;
+} StreamOutputControl;
+
+
+NITFPRIV(NITF_BOOL) StreamOutput_read(NITF_DATA * data, char *buf,
+                                      size_t size, nitf_Error * error)
+{
+    /* Silence compiler warnings about unused variables */
+    (void)data;
+    (void)buf;
+    (void)size;
+
+    nitf_Error_init(error, "A streamed output cannot be read",
+                    NITF_CTXT, NITF_ERR_INVALID_OBJECT);
+    return NITF_FAILURE;
+}
+
+
+NITFPRIV(NITF_BOOL) StreamOutput_write(NITF_DATA * data, const char *buf,
+                                       size_t size, nitf_Error * error)
+{
+    StreamOutputControl *control = (StreamOutputControl *) data;
+
+    if (!nitf_IOInterface_write(control->io, buf, size, error))
+        return NITF_FAILURE;
+    control->position += (nitf_Off) size;
+    return NITF_SUCCESS;
+}
+
+
+NITFPRIV(NITF_BOOL) StreamOutput_canSeek(NITF_DATA * data,
+                                         nitf_Error * error)
+{
+    /* Silence compiler warnings about unused variables */
+    (void)data;
+    (void)error;
+
+    return NITF_SUCCESS;
+}
+
+
+NITFPRIV(nitf_Off) StreamOutput_seek(NITF_DATA * data, nitf_Off offset,
+                                     int whence, nitf_Error * error)
+{
+    StreamOutputControl *control = (StreamOutputControl *) data;
+
+    if (whence != NITF_SEEK_SET)
+        offset += control->position;
+
+    if (offset != control->position)
+    {
+        nitf_Error_init(error, "A streamed output can only be written "
+                        "in order", NITF_CTXT, NITF_ERR_INVALID_OBJECT);
+        return (nitf_Off) -1;
+    }
+    return control->position;
+}
+
+
+NITFPRIV(nitf_Off) StreamOutput_tell(NITF_DATA * data, nitf_Error * error)
+{
+    StreamOutputControl *control = (StreamOutputControl *) data;
+
+    /* Silence compiler warnings about unused variables */
+    (void)error;
+
+    return control->position;
+}
+
+
+NITFPRIV(int) StreamOutput_getMode(NITF_DATA * data, nitf_Error * error)
+{
+    /* Silence compiler warnings about unused variables */
+    (void)data;
+    (void)error;
+
+    return NITF_ACCESS_WRITEONLY;
+}
+
+
+NITFPRIV(NITF_BOOL) StreamOutput_close(NITF_DATA * data, nitf_Error * error)
+{
+    /* Silence compiler warnings about unused variables */
+    (void)data;
+    (void)error;
+
+    /* The user's interface is left open */
+    return NITF_SUCCESS;
+}
+
+
+NITFPRIV(void) StreamOutput_destruct(NITF_DATA * data)
+{
+    /* Silence compiler warnings about unused variables */
+    (void)data;
+}
+
+
+NITFPRIV(nitf_IOInterface *) StreamOutput_construct(nitf_IOInterface * io,
+                                                    nitf_Error * error)
+{
+    static nitf_IIOInterface streamInterface = {
+        &StreamOutput_read,
+        &StreamOutput_write,
+        &StreamOutput_canSeek,
+        &StreamOutput_seek,
+        &StreamOutput_tell,
+        &StreamOutput_tell,
+        &StreamOutput_getMode,
+        &StreamOutput_close,
+        &StreamOutput_destruct
+    };
+    nitf_IOInterface *impl;
+    StreamOutputControl *control;
+
+    impl = (nitf_IOInterface *) NITF_MALLOC(sizeof(nitf_IOInterface));
+    control = (StreamOutputControl *) NITF_MALLOC(sizeof(StreamOutputControl));
+    if (!impl || !control)
+    {
+        nitf_Error_init(error, NITF_STRERROR(NITF_ERRNO),
+                        NITF_CTXT, NITF_ERR_MEMORY);
+        if (impl)
+            NITF_FREE(impl);
+        if (control)
+            NITF_FREE(control);
+        return NULL;
+    }
+
+    control->io = io;
+    control->position = 0;
+    impl->data = (NITF_DATA *) control;
+    impl->iface = &streamInterface;
+    return impl;
+}
+
+
+/*
+ *  A segment of a streamed write. The subheader is written to memory, and
+ *  so is the data unless its handler gives its length up front, in which
+ *  case it is written straight to the output.
+ */
+typedef struct _StreamSegment
+{
+    nitf_IOInterface *subheader;  /* The subheader in memory */
+    nitf_IOInterface *data;       /* The data in memory, or NULL */
+    nitf_Off dataLength;          /* Length of the data */
+    nitf_WriteHandler *handler;   /* Writes the data */
+    /* Writes the data, for all but data extensions */
+    NITF_BOOL (*write)(nitf_WriteHandler *, nitf_IOInterface *,
+                       nitf_Error *);
+    nitf_DESubheader *deSubheader; /* Subheader of a data extension */
+} StreamSegment;
+
+
+/* Write the data of a segment of a streamed write to the writer's output */
+NITFPRIV(NITF_BOOL) streamWriteData(nitf_Writer * writer,
+                                    StreamSegment * segment,
+                                    nitf_Error * error)
+{
+    if (segment->deSubheader)
+        return writeDE(writer, segment->handler, segment->deSubheader,
+                       writer->output, error);
+    return (*segment->write)(segment->handler, writer->output, error);
+}
+
+
+/*
+ *  Find the length of the data of a segment of a streamed write. If the
+ *  handler cannot give it the data is written to memory, which for a
+ *  compressed image is the only way to find it.
+ */
+NITFPRIV(NITF_BOOL) streamPrepareData(nitf_Writer * writer,
+                                      StreamSegment * segment,
+                                      nitf_Error * error)
+{
+    nitf_IOInterface *output = writer->output;
+    NITF_BOOL overflow = 0;
+    NITF_BOOL ok;
+
+    segment->dataLength = -1;
+    if (segment->deSubheader
+        && !isOverflowDE(segment->deSubheader, &overflow, error))
+        return NITF_FAILURE;
+
+    /* TRE overflow segments are written from the TREs, not a handler */
+    if (!overflow && segment->handler
+        && segment->handler->iface->streamLength
+        && !(*segment->handler->iface->streamLength)(segment->handler->data,
+                                                     &segment->dataLength,
+                                                     error))
+        return NITF_FAILURE;
+
+    if (segment->dataLength >= 0)
+        return NITF_SUCCESS;
+
+    segment->data = nitf_BufferAdapter_construct(NULL, 0, 1, error);
+    if (!segment->data)
+        return NITF_FAILURE;
+
+    writer->output = segment->data;
+    ok = streamWriteData(writer, segment, error);
+    writer->output = output;
+    if (!ok)
+        return NITF_FAILURE;
+
+    segment->dataLength = nitf_IOInterface_getSize(segment->data, error);
+    return NITF_IO_SUCCESS(segment->dataLength);
+}
+
+
+/* Copy the contents of a memory buffer of a streamed write */
+NITFPRIV(NITF_BOOL) streamCopy(nitf_IOInterface * from,
+                               nitf_IOInterface * to,
+                               nitf_Error * error)
+{
+    char buf[NITF_STREAM_COPY_SIZE];
+    nitf_Off size;
+    nitf_Off offset;
+    size_t count;
+
+    size = nitf_IOInterface_getSize(from, error);
+    if (!NITF_IO_SUCCESS(size))
+        return NITF_FAILURE;
+
+    for (offset = 0; offset < size; offset += (nitf_Off) count)
+    {
+        count = size - offset < NITF_STREAM_COPY_SIZE ?
+            (size_t) (size - offset) : NITF_STREAM_COPY_SIZE;
+        if (!nitf_IOInterface_readAt(from, offset, buf, count, error)
+            || !nitf_IOInterface_write(to, buf, count, error))
+            return NITF_FAILURE;
+    }
+    return NITF_SUCCESS;
+}
+
+
+NITFAPI(NITF_BOOL) nitf_Writer_writeStreamed(nitf_Writer * writer,
+                                             nitf_Error * error)
+{
+    nitf_FileHeader *header = writer->record->header;
+    nitf_IOInterface *output = writer->output;  /* The user's output */
+    nitf_IOInterface *stream = NULL;            /* Tracks the output */
+    nitf_IOInterface *headerBuffer = NULL;      /* Header, to size it */
+    StreamSegment *segments = NULL;
+    StreamSegment *segment;
+    nitf_Uint32 numImgs = 0;
+    nitf_Uint32 numGraphics = 0;
+    nitf_Uint32 numTexts = 0;
+    nitf_Uint32 numDEs = 0;
+    nitf_Uint32 numSegments;
+    nitf_Uint32 i;
+    nitf_Uint32 userSublen;
+    nitf_Uint32 hdrLen;
+    nitf_Off fileLenOff;
+    nitf_Off comratOff;
+    nitf_Off subLen;
+    nitf_Off start;
+    nitf_Off end;
+    nitf_Uint64 fileLen;
+    nitf_Version fver;
+    nitf_ListIterator iter;
+    nitf_ListIterator listEnd;
+    NITF_BOOL ok;
+
+    fver = nitf_Record_getVersion(writer->record);
+
+    if (!nitf_Field_get(header->numImages, &numImgs,
+                        NITF_CONV_INT, NITF_INT32_SZ, error)
+        || !nitf_Field_get(header->numGraphics, &numGraphics,
+                           NITF_CONV_INT, NITF_INT32_SZ, error)
+        || !nitf_Field_get(header->numTexts, &numTexts,
+                           NITF_CONV_INT, NITF_INT32_SZ, error)
+        || !nitf_Field_get(header->numDataExtensions, &numDEs,
+                           NITF_CONV_INT, NITF_INT32_SZ, error))
+    {
+        nitf_Error_init(error, "Could not retrieve number of segments",
+                        NITF_CTXT, NITF_ERR_INVALID_OBJECT);
+        return NITF_FAILURE;
+    }
+
+    numSegments = numImgs + numGraphics + numTexts + numDEs;
+    if (numSegments != 0)
+    {
+        segments = (StreamSegment *) NITF_MALLOC(numSegments
+                                                 * sizeof(StreamSegment));
+        if (!segments)
+        {
+            nitf_Error_init(error, NITF_STRERROR(NITF_ERRNO),
+                            NITF_CTXT, NITF_ERR_MEMORY);
+            return NITF_FAILURE;
+        }
+        memset(segments, 0, numSegments * sizeof(StreamSegment));
+    }
+
+    /* The date is written with the header, so it must be set first */
+    if (nitf_Utils_isBlank(header->NITF_FDT->raw))
+    {
+        char *dateFormat = (fver == NITF_VER_20 ?
+                NITF_DATE_FORMAT_20 : NITF_DATE_FORMAT_21);
+
+        if (!nitf_Field_setDateTime(header->NITF_FDT, NULL, dateFormat, error))
+            goto CATCH_ERROR;
+    }
+
+    /*
+     * First pass: find the length of the data of every segment, writing
+     * it to memory where it is only known by writing, and write every
+     * subheader to memory. An image's subheader is written after its data
+     * since compression may change its COMRAT.
+     */
+    segment = segments;
+    iter = nitf_List_begin(writer->record->images);
+    listEnd = nitf_List_end(writer->record->images);
+    for (i = 0; i < numImgs && nitf_ListIterator_notEqualTo(&iter, &listEnd);
+         i++, segment++)
+    {
+        nitf_ImageSegment *imageSegment =
+            (nitf_ImageSegment *) nitf_ListIterator_get(&iter);
+
+        segment->handler = writer->imageWriters[i];
+        segment->write = writeImage;
+        if (!streamPrepareData(writer, segment, error))
+            goto CATCH_ERROR;
+
+        segment->subheader = nitf_BufferAdapter_construct(NULL, 0, 1, error);
+        if (!segment->subheader)
+            goto CATCH_ERROR;
+        writer->output = segment->subheader;
+        ok = nitf_Writer_writeImageSubheader(writer, imageSegment->subheader,
+                                             fver, &comratOff, error);
+        writer->output = output;
+        if (!ok)
+            goto CATCH_ERROR;
+
+        nitf_ListIterator_increment(&iter);
+    }
+
+    iter = nitf_List_begin(writer->record->graphics);
+    listEnd = nitf_List_end(writer->record->graphics);
+    for (i = 0; i < numGraphics
+             && nitf_ListIterator_notEqualTo(&iter, &listEnd);
+         i++, segment++)
+    {
+        nitf_GraphicSegment *graphicSegment =
+            (nitf_GraphicSegment *) nitf_ListIterator_get(&iter);
+
+        segment->handler = writer->graphicWriters[i];
+        segment->write = writeGraphic;
+        if (!streamPrepareData(writer, segment, error))
+            goto CATCH_ERROR;
+
+        segment->subheader = nitf_BufferAdapter_construct(NULL, 0, 1, error);
+        if (!segment->subheader)
+            goto CATCH_ERROR;
+        writer->output = segment->subheader;
+        ok = writeGraphicSubheader(writer, graphicSegment->subheader, fver,
+                                   error);
+        writer->output = output;
+        if (!ok)
+            goto CATCH_ERROR;
+
+        nitf_ListIterator_increment(&iter);
+    }
+
+    iter = nitf_List_begin(writer->record->texts);
+    listEnd = nitf_List_end(writer->record->texts);
+    for (i = 0; i < numTexts && nitf_ListIterator_notEqualTo(&iter, &listEnd);
+         i++, segment++)
+    {
+        nitf_TextSegment *textSegment =
+            (nitf_TextSegment *) nitf_ListIterator_get(&iter);
+
+        segment->handler = writer->textWriters[i];
+        segment->write = writeText;
+        if (!streamPrepareData(writer, segment, error))
+            goto CATCH_ERROR;
+
+        segment->subheader = nitf_BufferAdapter_construct(NULL, 0, 1, error);
+        if (!segment->subheader)
+            goto CATCH_ERROR;
+        writer->output = segment->subheader;
+        ok = writeTextSubheader(writer, textSegment->subheader, fver, error);
+        writer->output = output;
+        if (!ok)
+            goto CATCH_ERROR;
+
+        nitf_ListIterator_increment(&iter);
+    }
+
+    iter = nitf_List_begin(writer->record->dataExtensions);
+    listEnd = nitf_List_end(writer->record->dataExtensions);
+    for (i = 0; i < numDEs && nitf_ListIterator_notEqualTo(&iter, &listEnd);
+         i++, segment++)
+    {
+        nitf_DESegment *deSegment =
+            (nitf_DESegment *) nitf_ListIterator_get(&iter);
+
+        segment->handler = writer->dataExtensionWriters[i];
+        segment->deSubheader = deSegment->subheader;
+        if (!streamPrepareData(writer, segment, error))
+            goto CATCH_ERROR;
+
+        segment->subheader = nitf_BufferAdapter_construct(NULL, 0, 1, error);
+        if (!segment->subheader)
+            goto CATCH_ERROR;
+        writer->output = segment->subheader;
+        ok = writeDESubheader(writer, deSegment->subheader, &userSublen,
+                              fver, error);
+        writer->output = output;
+        if (!ok)
+            goto CATCH_ERROR;
+
+        nitf_ListIterator_increment(&iter);
+    }
+
+    if (segment != segments + numSegments)
+    {
+        nitf_Error_init(error, "The record has fewer segments than its "
+                        "header lists", NITF_CTXT, NITF_ERR_INVALID_OBJECT);
+        goto CATCH_ERROR;
+    }
+
+    /* Set the segment counts and lengths in the header */
+    if (!nitf_Field_setUint32(header->NITF_NUMI, numImgs, error)
+        || !nitf_Field_setUint32(header->NITF_NUMS, numGraphics, error)
+        || !nitf_Field_setUint32(header->NITF_NUMT, numTexts, error)
+        || !nitf_Field_setUint32(header->NITF_NUMDES, numDEs, error))
+        goto CATCH_ERROR;
+
+    fileLen = 0;
+    for (i = 0, segment = segments; i < numSegments; i++, segment++)
+    {
+        nitf_Field *subLenField;
+        nitf_Field *dataLenField;
+        nitf_Uint32 index;
+
+        if (i < numImgs)
+        {
+            index = i;
+            subLenField = header->NITF_LISH(index);
+            dataLenField = header->NITF_LI(index);
+        }
+        else if (i < numImgs + numGraphics)
+        {
+            index = i - numImgs;
+            subLenField = header->NITF_LSSH(index);
+            dataLenField = header->NITF_LS(index);
+        }
+        else if (i < numImgs + numGraphics + numTexts)
+        {
+            index = i - numImgs - numGraphics;
+            subLenField = header->NITF_LTSH(index);
+            dataLenField = header->NITF_LT(index);
+        }
+        else
+        {
+            index = i - numImgs - numGraphics - numTexts;
+            subLenField = header->NITF_LDSH(index);
+            dataLenField = header->NITF_LD(index);
+        }
+
+        subLen = nitf_IOInterface_getSize(segment->subheader, error);
+        if (!NITF_IO_SUCCESS(subLen))
+            goto CATCH_ERROR;
+
+        if (!nitf_Field_setUint64(subLenField, (nitf_Uint64) subLen, error)
+            || !nitf_Field_setUint64(dataLenField,
+                                     (nitf_Uint64) segment->dataLength,
+                                     error))
+            goto CATCH_ERROR;
+        fileLen += (nitf_Uint64) subLen + (nitf_Uint64) segment->dataLength;
+    }
+
+    /*
+     * The header length does not depend on the values of the length
+     * fields, so it is found by writing the header to memory
+     */
+    headerBuffer = nitf_BufferAdapter_construct(NULL, 0, 1, error);
+    if (!headerBuffer)
+        goto CATCH_ERROR;
+    writer->output = headerBuffer;
+    ok = writeHeader(writer, &fileLenOff, &hdrLen, error);
+    writer->output = output;
+    nitf_IOInterface_destruct(&headerBuffer);
+    if (!ok)
+        goto CATCH_ERROR;
+
+    fileLen += hdrLen;
+    if (!nitf_Field_setUint64(header->NITF_FL, fileLen, error)
+        || !nitf_Field_setUint64(header->NITF_HL, hdrLen, error))
+        goto CATCH_ERROR;
+
+    /* Measure the CLEVEL now that the file length is known */
+    if (strncmp(header->NITF_CLEVEL->raw, "00", 2) == 0)
+    {
+        NITF_CLEVEL clevel =
+            nitf_ComplexityLevel_measure(writer->record, error);
+
+        if (clevel == NITF_CLEVEL_CHECK_FAILED)
+            goto CATCH_ERROR;
+
+        nitf_ComplexityLevel_toString(clevel,
+                                      header->NITF_CLEVEL->raw);
+    }
+
+    /* Second pass: write the file in order */
+    stream = StreamOutput_construct(output, error);
+    if (!stream)
+        goto CATCH_ERROR;
+    writer->output = stream;
+
+    if (!writeHeader(writer, &fileLenOff, &hdrLen, error))
+        goto CATCH_ERROR;
+
+    for (i = 0, segment = segments; i < numSegments; i++, segment++)
+    {
+        if (!streamCopy(segment->subheader, stream, error))
+            goto CATCH_ERROR;
+
+        if (segment->data)
+        {
+            if (!streamCopy(segment->data, stream, error))
+                goto CATCH_ERROR;
+            continue;
+        }
+
+        start = nitf_IOInterface_tell(stream, error);
+        if (!streamWriteData(writer, segment, error))
+            goto CATCH_ERROR;
+        end = nitf_IOInterface_tell(stream, error);
+        if (end - start != segment->dataLength)
+        {
+            nitf_Error_initf(error, NITF_CTXT, NITF_ERR_INVALID_OBJECT,
+                             "Segment %d wrote %lld bytes, not the %lld "
+                             "given for its length", (int) i,
+                             (long long) (end - start),
+                             (long long) segment->dataLength);
+            goto CATCH_ERROR;
+        }
+    }
+
+    writer->output = output;
+    nitf_IOInterface_destruct(&stream);
+    for (i = 0; i < numSegments; i++)
+    {
+        nitf_IOInterface_destruct(&segments[i].subheader);
+        nitf_IOInterface_destruct(&segments[i].data);
+    }
+    if (segments)
+        NITF_FREE(segments);
+    return NITF_SUCCESS;
+
+CATCH_ERROR:
+    writer->output = output;
+    nitf_IOInterface_destruct(&stream);
+    for (i = 0; i < numSegments; i++)
+    {
+        nitf_IOInterface_destruct(&segments[i].subheader);
+        nitf_IOInterface_destruct(&segments[i].data);
+    }
+    if (segments)
+        NITF_FREE(segments);
+    return NITF_FAILURE;
+}
+
+
 NITFAPI(NITF_BOOL) nitf_Writer_setImageWriteHandler(nitf_Writer *writer,
         int index, nitf_WriteHandler *writeHandler, nitf_Error * error)
 {
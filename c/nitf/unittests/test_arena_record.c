@@ -0,0 +1,325 @@
+/* =========================================================================
+ * This file is part of NITRO
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2010, General Dynamics - Advanced Information Systems
+ *
+ * NITRO is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <import/nitf.h>
+#include "Test.h"
+
+#define TEST_FILE_NAME "test_arena_record.ntf"
+#define COPY_FILE_NAME "test_arena_record_copy.ntf"
+#define FILE_TITLE "Arena record test"
+#define NEW_TITLE "Arena record test, modified after the read"
+#define TEXT "Text segment data, which follows the image data in the file."
+#define NUM_ROWS 150
+#define NUM_COLS 130
+
+static nitf_Uint8 pixel(nitf_Uint32 row, nitf_Uint32 col)
+{
+    return (nitf_Uint8) (row * 7 + col * 3 + (row * col) % 13);
+}
+
+static char treByte(const char *tag, size_t i)
+{
+    return (char) ('A' + (i * 7 + (unsigned char) tag[3]) % 26);
+}
+
+static nitf_ImageSubheader *getSubheader(nitf_Record *record)
+{
+    return ((nitf_ImageSegment *) record->images->first->data)->subheader;
+}
+
+/*
+ *  Append a TRE with no handler, which is written and read back as raw
+ *  data
+ */
+static void appendTRE(const char *testName, nitf_Extensions *ext,
+                      const char *tag, size_t length)
+{
+    nitf_Error error;
+    nitf_TRE *tre;
+    char *data;
+    size_t i;
+
+    data = (char *) NITF_MALLOC(length);
+    TEST_ASSERT(data);
+    for (i = 0; i < length; i++)
+        data[i] = treByte(tag, i);
+    tre = nitf_TRE_construct(tag, NITF_TRE_RAW, &error);
+    TEST_ASSERT(tre);
+    TEST_ASSERT(nitf_TRE_setField(tre, NITF_TRE_RAW, data, length, &error));
+    TEST_ASSERT(nitf_Extensions_appendTRE(ext, tre, &error));
+    NITF_FREE(data);
+}
+
+static void checkTRE(const char *testName, nitf_Extensions *ext,
+                     const char *tag, size_t length)
+{
+    nitf_List *list = nitf_Extensions_getTREsByName(ext, tag);
+    nitf_Field *field;
+    size_t i;
+
+    TEST_ASSERT(list && !nitf_List_isEmpty(list));
+    field = nitf_TRE_getField((nitf_TRE *) list->first->data, NITF_TRE_RAW);
+    TEST_ASSERT(field);
+    TEST_ASSERT_EQ_INT(field->length, length);
+    for (i = 0; i < length; i++)
+        TEST_ASSERT_EQ_INT(field->raw[i], treByte(tag, i));
+}
+
+static void checkRecord(const char *testName, nitf_Record *record)
+{
+    TEST_ASSERT(memcmp(record->header->fileTitle->raw, FILE_TITLE,
+                       strlen(FILE_TITLE)) == 0);
+    TEST_ASSERT_EQ_INT(nitf_List_size(record->texts), 1);
+    checkTRE(testName, record->header->userDefinedSection, "TSTBIG", 20000);
+    checkTRE(testName, record->header->extendedSection, "TSTHDR", 300);
+    checkTRE(testName, getSubheader(record)->extendedSection, "TSTIMG", 100);
+}
+
+/*
+ *  Write a record of a one band, 8-bit image of 64 by 48 blocks and a
+ *  text segment
+ */
+static void writeRecord(const char *testName, nitf_Record *record,
+                        const char *fileName)
+{
+    nitf_Error error;
+    nitf_Writer *writer;
+    nitf_ImageWriter *imageWriter;
+    nitf_ImageSource *source;
+    nitf_BandSource *bandSource;
+    nitf_SegmentWriter *textWriter;
+    nitf_SegmentSource *textSource;
+    nitf_IOHandle out;
+    static nitf_Uint8 data[NUM_ROWS * NUM_COLS];
+    nitf_Uint32 row, col;
+
+    for (row = 0; row < NUM_ROWS; row++)
+        for (col = 0; col < NUM_COLS; col++)
+            data[row * NUM_COLS + col] = pixel(row, col);
+
+    out = nitf_IOHandle_create(fileName, NITF_ACCESS_WRITEONLY,
+                               NITF_CREATE, &error);
+    TEST_ASSERT(!NITF_INVALID_HANDLE(out));
+    writer = nitf_Writer_construct(&error);
+    TEST_ASSERT(writer);
+    TEST_ASSERT(nitf_Writer_prepare(writer, record, out, &error));
+    imageWriter = nitf_Writer_newImageWriter(writer, 0, &error);
+    TEST_ASSERT(imageWriter);
+    source = nitf_ImageSource_construct(&error);
+    TEST_ASSERT(source);
+    bandSource = nitf_MemorySource_construct((char *) data,
+                                             NUM_ROWS * NUM_COLS, 0, 1, 0,
+                                             &error);
+    TEST_ASSERT(bandSource);
+    TEST_ASSERT(nitf_ImageSource_addBand(source, bandSource, &error));
+    TEST_ASSERT(nitf_ImageWriter_attachSource(imageWriter, source, &error));
+    textWriter = nitf_Writer_newTextWriter(writer, 0, &error);
+    TEST_ASSERT(textWriter);
+    textSource = nitf_SegmentMemorySource_construct(TEXT, strlen(TEXT),
+                                                    0, 0, 0, &error);
+    TEST_ASSERT(textSource);
+    TEST_ASSERT(nitf_SegmentWriter_attachSource(textWriter, textSource,
+                                                &error));
+    TEST_ASSERT(nitf_Writer_write(writer, &error));
+
+    nitf_IOHandle_close(out);
+    nitf_Writer_destruct(&writer);
+}
+
+static void writeFile(const char *testName)
+{
+    nitf_Error error;
+    nitf_Record *record;
+    nitf_ImageSegment *segment;
+    nitf_BandInfo **bands;
+
+    record = nitf_Record_construct(NITF_VER_21, &error);
+    TEST_ASSERT(record);
+    TEST_ASSERT(nitf_Field_setString(record->header->fileTitle, FILE_TITLE,
+                                     &error));
+    segment = nitf_Record_newImageSegment(record, &error);
+    TEST_ASSERT(segment);
+    bands = (nitf_BandInfo **) NITF_MALLOC(sizeof(nitf_BandInfo *));
+    TEST_ASSERT(bands);
+    bands[0] = nitf_BandInfo_construct(&error);
+    TEST_ASSERT(bands[0]);
+    TEST_ASSERT(nitf_BandInfo_init(bands[0], "M", " ", "N", "   ",
+                                   0, 0, NULL, &error));
+    TEST_ASSERT(nitf_ImageSubheader_setPixelInformation(segment->subheader,
+                                                        "INT", 8, 8, "R",
+                                                        "MONO", "VIS", 1,
+                                                        bands, &error));
+    TEST_ASSERT(nitf_ImageSubheader_setBlocking(segment->subheader,
+                                                NUM_ROWS, NUM_COLS, 64, 48,
+                                                "B", &error));
+    TEST_ASSERT(nitf_Record_newTextSegment(record, &error));
+
+    appendTRE(testName, record->header->userDefinedSection, "TSTBIG", 20000);
+    appendTRE(testName, record->header->extendedSection, "TSTHDR", 300);
+    appendTRE(testName, segment->subheader->extendedSection, "TSTIMG", 100);
+
+    writeRecord(testName, record, TEST_FILE_NAME);
+    nitf_Record_destruct(&record);
+}
+
+/*
+ *  Check the pixels and the text through the reader of a record
+ */
+static void checkData(const char *testName, nitf_Reader *reader)
+{
+    nitf_Error error;
+    nitf_ImageReader *image;
+    nitf_SegmentReader *text;
+    nitf_SubWindow window;
+    nitf_Uint32 bandList = 0;
+    static nitf_Uint8 data[NUM_ROWS * NUM_COLS];
+    nitf_Uint8 *buffers[1];
+    char buffer[sizeof(TEXT)];
+    nitf_Uint32 row, col;
+    int padded;
+
+    image = nitf_Reader_newImageReader(reader, 0, &error);
+    TEST_ASSERT(image);
+    memset(&window, 0, sizeof(window));
+    window.numRows = NUM_ROWS;
+    window.numCols = NUM_COLS;
+    window.bandList = &bandList;
+    window.numBands = 1;
+    buffers[0] = data;
+    TEST_ASSERT(nitf_ImageReader_read(image, &window, buffers, &padded,
+                                      &error));
+    for (row = 0; row < NUM_ROWS; row++)
+        for (col = 0; col < NUM_COLS; col++)
+            TEST_ASSERT(data[row * NUM_COLS + col] == pixel(row, col));
+    nitf_ImageReader_destruct(&image);
+
+    text = nitf_Reader_newTextReader(reader, 0, &error);
+    TEST_ASSERT(text);
+    TEST_ASSERT(nitf_SegmentReader_read(text, buffer, strlen(TEXT), &error));
+    TEST_ASSERT(memcmp(buffer, TEXT, strlen(TEXT)) == 0);
+    nitf_SegmentReader_destruct(&text);
+}
+
+/*
+ *  Modify, clone and destroy a record in an arena, then write the clone
+ *  and read it back
+ */
+static void modifyAndWrite(const char *testName, nitf_Record *record)
+{
+    nitf_Error error;
+    nitf_Record *clone;
+    nitf_IOHandle in;
+    nitf_Reader *reader;
+    nitf_List *list;
+
+    TEST_ASSERT(nitf_Field_setString(record->header->fileTitle, NEW_TITLE,
+                                     &error));
+    appendTRE(testName, record->header->userDefinedSection, "TSTNEW", 500);
+    nitf_Extensions_removeTREsByName(record->header->extendedSection,
+                                     "TSTHDR");
+    clone = nitf_Record_clone(record, &error);
+    TEST_ASSERT(clone);
+    nitf_Record_destruct(&record);
+    writeRecord(testName, clone, COPY_FILE_NAME);
+    nitf_Record_destruct(&clone);
+
+    in = nitf_IOHandle_create(COPY_FILE_NAME, NITF_ACCESS_READONLY,
+                              NITF_OPEN_EXISTING, &error);
+    TEST_ASSERT(!NITF_INVALID_HANDLE(in));
+    reader = nitf_Reader_construct(&error);
+    TEST_ASSERT(reader);
+    record = nitf_Reader_read(reader, in, &error);
+    TEST_ASSERT(record);
+    TEST_ASSERT(memcmp(record->header->fileTitle->raw, NEW_TITLE,
+                       strlen(NEW_TITLE)) == 0);
+    checkTRE(testName, record->header->userDefinedSection, "TSTBIG", 20000);
+    checkTRE(testName, record->header->userDefinedSection, "TSTNEW", 500);
+    list = nitf_Extensions_getTREsByName(record->header->extendedSection,
+                                         "TSTHDR");
+    TEST_ASSERT(!list || nitf_List_isEmpty(list));
+    checkData(testName, reader);
+    nitf_Record_destruct(&record);
+    nitf_Reader_destruct(&reader);
+    nitf_IOHandle_close(in);
+}
+
+TEST_CASE(testFull)
+{
+    nitf_Error error;
+    nitf_IOHandle in;
+    nitf_Reader *reader;
+    nitf_Record *record;
+
+    writeFile(testName);
+    in = nitf_IOHandle_create(TEST_FILE_NAME, NITF_ACCESS_READONLY,
+                              NITF_OPEN_EXISTING, &error);
+    TEST_ASSERT(!NITF_INVALID_HANDLE(in));
+    reader = nitf_Reader_construct(&error);
+    TEST_ASSERT(reader);
+    nitf_Reader_setUseArena(reader, 1);
+    record = nitf_Reader_read(reader, in, &error);
+    TEST_ASSERT(record);
+    checkData(testName, reader);
+
+    /* The record outlives its reader */
+    nitf_Reader_destruct(&reader);
+    nitf_IOHandle_close(in);
+    checkRecord(testName, record);
+    modifyAndWrite(testName, record);
+}
+
+TEST_CASE(testIndex)
+{
+    nitf_Error error;
+    nitf_IOHandle in;
+    nitf_Reader *reader;
+    nitf_Record *record;
+
+    /* Subheaders loaded later go into the arena of the record */
+    in = nitf_IOHandle_create(TEST_FILE_NAME, NITF_ACCESS_READONLY,
+                              NITF_OPEN_EXISTING, &error);
+    TEST_ASSERT(!NITF_INVALID_HANDLE(in));
+    reader = nitf_Reader_construct(&error);
+    TEST_ASSERT(reader);
+    nitf_Reader_setUseArena(reader, 1);
+    record = nitf_Reader_readIndex(reader, in, &error);
+    TEST_ASSERT(record);
+    TEST_ASSERT(nitf_Reader_loadSubheader(reader, NITF_SEGMENT_IMAGE, 0,
+                                          &error));
+    TEST_ASSERT(nitf_Reader_loadSubheader(reader, NITF_SEGMENT_TEXT, 0,
+                                          &error));
+    checkData(testName, reader);
+
+    nitf_Reader_destruct(&reader);
+    nitf_IOHandle_close(in);
+    checkRecord(testName, record);
+    modifyAndWrite(testName, record);
+}
+
+int main(int argc, char **argv)
+{
+    CHECK(testFull);
+    CHECK(testIndex);
+    remove(TEST_FILE_NAME);
+    remove(COPY_FILE_NAME);
+    return 0;
+}
@@ -0,0 +1,406 @@
+/* =========================================================================
+ * This file is part of NITRO
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2010, General Dynamics - Advanced Information Systems
+ *
+ * NITRO is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <import/nitf.h>
+#include "Test.h"
+
+#define TEST_FILE_NAME "test_block_cache.ntf"
+#define NUM_BANDS 3
+#define NUM_ROWS 300
+#define NUM_COLS 260
+#define BLOCK_SIZE 64
+
+/*
+ *  The test decompressor reads regions of uncompressed blocks, so an
+ *  image written as "NC" is read through the partial decode path. A B
+ *  mode block holds a plane per band, and the region is read from each.
+ */
+typedef struct _TestDecoder
+{
+    nitf_IOInterface *io;
+    nitf_Uint64 offset;
+    nitf_BlockingInfo *blockInfo;
+    nitf_Uint64 *blockMask;
+} TestDecoder;
+
+/* Regions decoded, and the pixels in them */
+static nitf_Uint32 numRegions;
+static nitf_Uint64 numDecoded;
+
+static nitf_Uint8 pixel(nitf_Uint32 band, nitf_Uint32 row, nitf_Uint32 col)
+{
+    return (nitf_Uint8) (band * 97 + row * 7 + col * 3 + (row * col) % 13);
+}
+
+static nitf_DecompressionControl *decoderOpen(nitf_IOInterface *io,
+                                              nitf_Uint64 offset,
+                                              nitf_Uint64 fileLength,
+                                              nitf_BlockingInfo *blockInfo,
+                                              nitf_Uint64 *blockMask,
+                                              nitf_Error *error)
+{
+    TestDecoder *decoder;
+
+    (void) fileLength;
+    decoder = (TestDecoder *) NITF_MALLOC(sizeof(TestDecoder));
+    if (!decoder)
+    {
+        nitf_Error_init(error, NITF_STRERROR(NITF_ERRNO), NITF_CTXT,
+                        NITF_ERR_MEMORY);
+        return NULL;
+    }
+    decoder->io = io;
+    decoder->offset = offset;
+    decoder->blockInfo = blockInfo;
+    decoder->blockMask = blockMask;
+    return (nitf_DecompressionControl *) decoder;
+}
+
+static NITF_BOOL decoderReadBlockRegion(nitf_DecompressionControl *control,
+                                        nitf_Uint32 blockNumber,
+                                        nitf_Uint32 row, nitf_Uint32 column,
+                                        nitf_Uint32 numRows,
+                                        nitf_Uint32 numColumns,
+                                        nitf_Uint8 *buffer, size_t size,
+                                        nitf_Error *error)
+{
+    TestDecoder *decoder = (TestDecoder *) control;
+    nitf_BlockingInfo *info = decoder->blockInfo;
+    size_t planeSize = (size_t) info->numRowsPerBlock *
+        info->numColsPerBlock;
+    size_t plane;
+    nitf_Uint32 i;
+
+    if (size < info->length || row + numRows > info->numRowsPerBlock ||
+        column + numColumns > info->numColsPerBlock)
+    {
+        nitf_Error_init(error, "Invalid block region", NITF_CTXT,
+                        NITF_ERR_DECOMPRESSION);
+        return NITF_FAILURE;
+    }
+    for (plane = 0; plane < info->length / planeSize; plane++)
+        for (i = row; i < row + numRows; i++)
+        {
+            size_t start = plane * planeSize
+                + (size_t) i * info->numColsPerBlock + column;
+
+            if (!nitf_IOInterface_readAt(decoder->io,
+                                         (nitf_Off) (decoder->offset +
+                                                     decoder->blockMask
+                                                     [blockNumber] + start),
+                                         (char *) buffer + start, numColumns,
+                                         error))
+                return NITF_FAILURE;
+        }
+    numRegions++;
+    numDecoded += (nitf_Uint64) numRows * numColumns;
+    return NITF_SUCCESS;
+}
+
+static NITF_BOOL decoderReadBlockInto(nitf_DecompressionControl *control,
+                                      nitf_Uint32 blockNumber,
+                                      nitf_Uint8 *buffer, size_t size,
+                                      nitf_Error *error)
+{
+    TestDecoder *decoder = (TestDecoder *) control;
+
+    return decoderReadBlockRegion(control, blockNumber, 0, 0,
+                                  decoder->blockInfo->numRowsPerBlock,
+                                  decoder->blockInfo->numColsPerBlock,
+                                  buffer, size, error);
+}
+
+static void decoderDestroy(nitf_DecompressionControl **control)
+{
+    NITF_FREE(*control);
+    *control = NULL;
+}
+
+/*
+ *  Write a three band, 8-bit B mode image of 64 by 64 blocks
+ */
+static void writeImage(const char *testName)
+{
+    nitf_Error error;
+    nitf_Record *record;
+    nitf_ImageSegment *segment;
+    nitf_BandInfo **bands;
+    nitf_Writer *writer;
+    nitf_ImageWriter *imageWriter;
+    nitf_ImageSource *source;
+    nitf_IOHandle out;
+    static nitf_Uint8 data[NUM_BANDS][NUM_ROWS * NUM_COLS];
+    nitf_Uint32 band, row, col;
+
+    record = nitf_Record_construct(NITF_VER_21, &error);
+    TEST_ASSERT(record);
+    segment = nitf_Record_newImageSegment(record, &error);
+    TEST_ASSERT(segment);
+
+    bands = (nitf_BandInfo **) NITF_MALLOC(sizeof(nitf_BandInfo *)
+                                           * NUM_BANDS);
+    TEST_ASSERT(bands);
+    for (band = 0; band < NUM_BANDS; band++)
+    {
+        bands[band] = nitf_BandInfo_construct(&error);
+        TEST_ASSERT(bands[band]);
+        TEST_ASSERT(nitf_BandInfo_init(bands[band], "M", " ", "N", "   ",
+                                       0, 0, NULL, &error));
+    }
+    TEST_ASSERT(nitf_ImageSubheader_setPixelInformation(segment->subheader,
+                                                        "INT", 8, 8, "R",
+                                                        "MULTI", "VIS",
+                                                        NUM_BANDS, bands,
+                                                        &error));
+    TEST_ASSERT(nitf_ImageSubheader_setBlocking(segment->subheader,
+                                                NUM_ROWS, NUM_COLS,
+                                                BLOCK_SIZE, BLOCK_SIZE, "B",
+                                                &error));
+
+    out = nitf_IOHandle_create(TEST_FILE_NAME, NITF_ACCESS_WRITEONLY,
+                               NITF_CREATE, &error);
+    TEST_ASSERT(!NITF_INVALID_HANDLE(out));
+    writer = nitf_Writer_construct(&error);
+    TEST_ASSERT(writer);
+    TEST_ASSERT(nitf_Writer_prepare(writer, record, out, &error));
+    imageWriter = nitf_Writer_newImageWriter(writer, 0, &error);
+    TEST_ASSERT(imageWriter);
+
+    source = nitf_ImageSource_construct(&error);
+    TEST_ASSERT(source);
+    for (band = 0; band < NUM_BANDS; band++)
+    {
+        nitf_BandSource *bandSource;
+
+        for (row = 0; row < NUM_ROWS; row++)
+            for (col = 0; col < NUM_COLS; col++)
+                data[band][row * NUM_COLS + col] = pixel(band, row, col);
+        bandSource = nitf_MemorySource_construct((char *) data[band],
+                                                 NUM_ROWS * NUM_COLS, 0, 1,
+                                                 0, &error);
+        TEST_ASSERT(bandSource);
+        TEST_ASSERT(nitf_ImageSource_addBand(source, bandSource, &error));
+    }
+    TEST_ASSERT(nitf_ImageWriter_attachSource(imageWriter, source, &error));
+    TEST_ASSERT(nitf_Writer_write(writer, &error));
+
+    nitf_IOHandle_close(out);
+    nitf_Writer_destruct(&writer);
+    nitf_Record_destruct(&record);
+}
+
+/*
+ *  Read a window of all bands and compare it with the pattern
+ */
+static void checkWindowIO(const char *testName, nitf_ImageIO *image,
+                          nitf_IOInterface *io, nitf_Uint32 startRow,
+                          nitf_Uint32 startCol, nitf_Uint32 numRows,
+                          nitf_Uint32 numCols)
+{
+    nitf_Error error;
+    nitf_SubWindow window;
+    nitf_Uint32 bandList[NUM_BANDS] = { 0, 1, 2 };
+    nitf_Uint8 *buffers[NUM_BANDS];
+    nitf_Uint32 band, row, col;
+    int padded;
+
+    memset(&window, 0, sizeof(window));
+    window.startRow = startRow;
+    window.startCol = startCol;
+    window.numRows = numRows;
+    window.numCols = numCols;
+    window.bandList = bandList;
+    window.numBands = NUM_BANDS;
+
+    for (band = 0; band < NUM_BANDS; band++)
+    {
+        buffers[band] = (nitf_Uint8 *) NITF_MALLOC(numRows * numCols);
+        TEST_ASSERT(buffers[band]);
+    }
+    TEST_ASSERT(nitf_ImageIO_read(image, io, &window, buffers, &padded,
+                                  &error));
+    for (band = 0; band < NUM_BANDS; band++)
+    {
+        for (row = 0; row < numRows; row++)
+            for (col = 0; col < numCols; col++)
+                TEST_ASSERT_EQ_INT(buffers[band][row * numCols + col],
+                                   pixel(band, startRow + row,
+                                         startCol + col));
+        NITF_FREE(buffers[band]);
+    }
+}
+
+static void checkWindow(const char *testName, nitf_ImageReader *image,
+                        nitf_Uint32 startRow, nitf_Uint32 startCol,
+                        nitf_Uint32 numRows, nitf_Uint32 numCols)
+{
+    checkWindowIO(testName, image->imageDeblocker, image->input, startRow,
+                  startCol, numRows, numCols);
+}
+
+TEST_CASE(testEviction)
+{
+    nitf_Error error;
+    nitf_IOHandle in;
+    nitf_Reader *reader;
+    nitf_Record *record;
+    nitf_ImageReader *image;
+    nitf_Uint64 hits, misses, hitsBefore, missesBefore;
+
+    writeImage(testName);
+    in = nitf_IOHandle_create(TEST_FILE_NAME, NITF_ACCESS_READONLY,
+                              NITF_OPEN_EXISTING, &error);
+    TEST_ASSERT(!NITF_INVALID_HANDLE(in));
+    reader = nitf_Reader_construct(&error);
+    TEST_ASSERT(reader);
+    record = nitf_Reader_read(reader, in, &error);
+    TEST_ASSERT(record);
+    image = nitf_Reader_newImageReader(reader, 0, &error);
+    TEST_ASSERT(image);
+
+    /* Room for four blocks, a read of the whole image needs sixty */
+    nitf_ImageReader_setReadCacheSize(image, 4 * BLOCK_SIZE * BLOCK_SIZE);
+    checkWindow(testName, image, 0, 0, NUM_ROWS, NUM_COLS);
+    checkWindow(testName, image, 50, 30, 150, 170);
+    checkWindow(testName, image, NUM_ROWS - 5, NUM_COLS - 7, 5, 7);
+    nitf_ImageReader_getReadCacheStats(image, &hits, &misses);
+    TEST_ASSERT(misses > 0);
+
+    /* A window inside one block of each band hits on the second read */
+    checkWindow(testName, image, 70, 70, 20, 20);
+    nitf_ImageReader_getReadCacheStats(image, &hitsBefore, &missesBefore);
+    checkWindow(testName, image, 75, 72, 10, 30);
+    nitf_ImageReader_getReadCacheStats(image, &hits, &misses);
+    TEST_ASSERT(hits > hitsBefore);
+    TEST_ASSERT(misses == missesBefore);
+
+    /* Evicted blocks are read again */
+    checkWindow(testName, image, 0, 0, NUM_ROWS, NUM_COLS);
+    nitf_ImageReader_getReadCacheStats(image, &hitsBefore, &missesBefore);
+    TEST_ASSERT(missesBefore > misses);
+
+    nitf_ImageReader_destruct(&image);
+    nitf_Record_destruct(&record);
+    nitf_Reader_destruct(&reader);
+    nitf_IOHandle_close(in);
+}
+
+TEST_CASE(testDefaultCache)
+{
+    nitf_Error error;
+    nitf_IOHandle in;
+    nitf_Reader *reader;
+    nitf_Record *record;
+    nitf_ImageReader *image;
+
+    writeImage(testName);
+    in = nitf_IOHandle_create(TEST_FILE_NAME, NITF_ACCESS_READONLY,
+                              NITF_OPEN_EXISTING, &error);
+    TEST_ASSERT(!NITF_INVALID_HANDLE(in));
+    reader = nitf_Reader_construct(&error);
+    TEST_ASSERT(reader);
+    record = nitf_Reader_read(reader, in, &error);
+    TEST_ASSERT(record);
+    image = nitf_Reader_newImageReader(reader, 0, &error);
+    TEST_ASSERT(image);
+
+    /* Without a budget the reader keeps one block, as it always did */
+    checkWindow(testName, image, 0, 0, NUM_ROWS, NUM_COLS);
+    checkWindow(testName, image, 61, 59, 10, 10);
+
+    nitf_ImageReader_destruct(&image);
+    nitf_Record_destruct(&record);
+    nitf_Reader_destruct(&reader);
+    nitf_IOHandle_close(in);
+}
+
+TEST_CASE(testValidRectangle)
+{
+    nitf_Error error;
+    nitf_IOInterface *io;
+    nitf_Reader *reader;
+    nitf_Record *record;
+    nitf_ImageSegment *segment;
+    nitf_DecompressionInterface iface;
+    nitf_ImageIO *image;
+    nitf_Uint64 decoded;
+
+    writeImage(testName);
+    io = nitf_IOHandleAdapter_open(TEST_FILE_NAME, NITF_ACCESS_READONLY,
+                                   NITF_OPEN_EXISTING, &error);
+    TEST_ASSERT(io);
+    reader = nitf_Reader_construct(&error);
+    TEST_ASSERT(reader);
+    record = nitf_Reader_readIO(reader, io, &error);
+    TEST_ASSERT(record);
+
+    /* Marked compressed so the decompressor is used */
+    segment = (nitf_ImageSegment *) record->images->first->data;
+    TEST_ASSERT(nitf_Field_setString(segment->subheader->imageCompression,
+                                     "C8", &error));
+    memset(&iface, 0, sizeof(iface));
+    iface.open = decoderOpen;
+    iface.destroyControl = decoderDestroy;
+    iface.readBlockInto = decoderReadBlockInto;
+    iface.readBlockRegion = decoderReadBlockRegion;
+    iface.flags = NITF_DECOMPRESSION_READ_BLOCK_INTO |
+        NITF_DECOMPRESSION_READ_BLOCK_REGION;
+    image = nitf_ImageIO_construct(segment->subheader, segment->imageOffset,
+                                   segment->imageEnd - segment->imageOffset,
+                                   NULL, &iface, &error);
+    TEST_ASSERT(image);
+    nitf_ImageIO_setReadCacheSize(image, 60 * BLOCK_SIZE * BLOCK_SIZE);
+    numRegions = 0;
+    numDecoded = 0;
+
+    /* Only the part of the block that is read is decoded */
+    checkWindowIO(testName, image, io, 10, 20, 8, 8);
+    TEST_ASSERT_EQ_INT(numRegions, 1);
+    TEST_ASSERT(numDecoded < BLOCK_SIZE * BLOCK_SIZE);
+
+    /* A window inside the cached rectangle is copied without decoding */
+    decoded = numDecoded;
+    checkWindowIO(testName, image, io, 12, 22, 4, 4);
+    TEST_ASSERT(numDecoded == decoded);
+
+    /* Windows that grow past the rectangle in each direction */
+    checkWindowIO(testName, image, io, 5, 20, 8, 8);
+    TEST_ASSERT(numDecoded > decoded);
+    checkWindowIO(testName, image, io, 10, 15, 20, 30);
+    checkWindowIO(testName, image, io, 0, 0, NUM_ROWS, NUM_COLS);
+    checkWindowIO(testName, image, io, NUM_ROWS - 5, NUM_COLS - 7, 5, 7);
+
+    nitf_ImageIO_destruct(&image);
+    nitf_Record_destruct(&record);
+    nitf_Reader_destruct(&reader);
+    nitf_IOInterface_close(io, &error);
+    nitf_IOInterface_destruct(&io);
+}
+
+int main(int argc, char **argv)
+{
+    CHECK(testEviction);
+    CHECK(testDefaultCache);
+    CHECK(testValidRectangle);
+    remove(TEST_FILE_NAME);
+    return 0;
+}
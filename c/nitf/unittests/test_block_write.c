@@ -0,0 +1,474 @@
+/* =========================================================================
+ * This file is part of NITRO
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2010, General Dynamics - Advanced Information Systems
+ *
+ * NITRO is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <import/nitf.h>
+#include "Test.h"
+
+#define TEST_FILE_NAME "test_block_write.ntf"
+#define MAX_BANDS 3
+#define NUM_THREADS 6
+
+typedef struct
+{
+    const char *mode;
+    nitf_Uint32 numBands;
+    nitf_Uint32 numBits;
+    nitf_Uint32 numRows;
+    nitf_Uint32 numCols;
+    nitf_Uint32 numRowsPerBlock;
+    nitf_Uint32 numColsPerBlock;
+    const char *compression;
+}
+Layout;
+
+/* The writes shared by the threads */
+typedef struct
+{
+    const Layout *layout;
+    nitf_ImageWriter *imageWriter;
+    nitf_Uint32 blocksPerRow;
+    nitf_Uint32 numWrites;        /*!< Blocks times bands */
+    nitf_Uint32 stride;           /*!< Step through the writes */
+}
+BlockWrites;
+
+typedef struct
+{
+    const BlockWrites *writes;
+    nitf_Uint32 first;            /*!< First write of this thread */
+}
+WriteJob;
+
+static nitf_Uint32 pixel(const Layout *layout, nitf_Uint32 band,
+                         nitf_Uint32 row, nitf_Uint32 col)
+{
+    nitf_Uint32 value = (band * 97 + row * 7 + col * 3 + (row * col) % 13)
+        ^ ((row * 40503 + col * 9973) << 8);
+
+    return layout->numBits == 32 ? value :
+        value & ((((nitf_Uint32) 1) << layout->numBits) - 1);
+}
+
+static nitf_Uint32 load(const nitf_Uint8 *buffer, nitf_Uint32 bytes,
+                        size_t index)
+{
+    if (bytes == 1)
+        return buffer[index];
+    if (bytes == 2)
+        return ((const nitf_Uint16 *) buffer)[index];
+    return ((const nitf_Uint32 *) buffer)[index];
+}
+
+static void store(nitf_Uint8 *buffer, nitf_Uint32 bytes, size_t index,
+                  nitf_Uint32 value)
+{
+    if (bytes == 1)
+        buffer[index] = (nitf_Uint8) value;
+    else if (bytes == 2)
+        ((nitf_Uint16 *) buffer)[index] = (nitf_Uint16) value;
+    else
+        ((nitf_Uint32 *) buffer)[index] = value;
+}
+
+/* One band of one block of the pattern, pixels outside the image are 0 */
+static void fillBlock(const Layout *layout, nitf_Uint32 blockRow,
+                      nitf_Uint32 blockCol, nitf_Uint32 band,
+                      nitf_Uint8 *buffer)
+{
+    nitf_Uint32 bytes = layout->numBits / 8;
+    nitf_Uint32 row, col;
+
+    for (row = 0; row < layout->numRowsPerBlock; row++)
+        for (col = 0; col < layout->numColsPerBlock; col++)
+        {
+            nitf_Uint32 imageRow = blockRow * layout->numRowsPerBlock + row;
+            nitf_Uint32 imageCol = blockCol * layout->numColsPerBlock + col;
+            nitf_Uint32 value = 0;
+
+            if (imageRow < layout->numRows && imageCol < layout->numCols)
+                value = pixel(layout, band, imageRow, imageCol);
+            store(buffer, bytes,
+                  (size_t) row * layout->numColsPerBlock + col, value);
+        }
+}
+
+/*
+ *  Make a record with one image segment of the layout
+ */
+static nitf_Record *makeRecord(const char *testName, const Layout *layout)
+{
+    nitf_Error error;
+    nitf_Record *record;
+    nitf_ImageSegment *segment;
+    nitf_BandInfo **bands;
+    nitf_Uint32 band;
+
+    record = nitf_Record_construct(NITF_VER_21, &error);
+    TEST_ASSERT(record);
+    segment = nitf_Record_newImageSegment(record, &error);
+    TEST_ASSERT(segment);
+    bands = (nitf_BandInfo **) NITF_MALLOC(sizeof(nitf_BandInfo *)
+                                           * layout->numBands);
+    TEST_ASSERT(bands);
+    for (band = 0; band < layout->numBands; band++)
+    {
+        bands[band] = nitf_BandInfo_construct(&error);
+        TEST_ASSERT(bands[band]);
+        TEST_ASSERT(nitf_BandInfo_init(bands[band], "M", " ", "N", "   ",
+                                       0, 0, NULL, &error));
+    }
+    TEST_ASSERT(nitf_ImageSubheader_setPixelInformation(segment->subheader,
+                                                        "INT",
+                                                        layout->numBits,
+                                                        layout->numBits, "R",
+                                                        layout->numBands == 1 ?
+                                                        "MONO" : "MULTI",
+                                                        "VIS",
+                                                        layout->numBands,
+                                                        bands, &error));
+    TEST_ASSERT(nitf_ImageSubheader_setBlocking(segment->subheader,
+                                                layout->numRows,
+                                                layout->numCols,
+                                                layout->numRowsPerBlock,
+                                                layout->numColsPerBlock,
+                                                layout->mode, &error));
+    if (layout->compression)
+        TEST_ASSERT(nitf_Field_setString(segment->subheader->
+                                         imageCompression,
+                                         layout->compression, &error));
+    return record;
+}
+
+/*
+ *  Write the image from an image source, the reference for block writes
+ */
+static void writeImage(const char *testName, const Layout *layout)
+{
+    nitf_Error error;
+    nitf_Record *record = makeRecord(testName, layout);
+    nitf_Writer *writer;
+    nitf_ImageWriter *imageWriter;
+    nitf_ImageSource *source;
+    nitf_IOHandle out;
+    nitf_Uint32 bytes = layout->numBits / 8;
+    size_t size = (size_t) layout->numRows * layout->numCols * bytes;
+    nitf_Uint8 *data[MAX_BANDS];
+    nitf_Uint32 band, row, col;
+
+    out = nitf_IOHandle_create(TEST_FILE_NAME, NITF_ACCESS_WRITEONLY,
+                               NITF_CREATE, &error);
+    TEST_ASSERT(!NITF_INVALID_HANDLE(out));
+    writer = nitf_Writer_construct(&error);
+    TEST_ASSERT(writer);
+    TEST_ASSERT(nitf_Writer_prepare(writer, record, out, &error));
+    imageWriter = nitf_Writer_newImageWriter(writer, 0, &error);
+    TEST_ASSERT(imageWriter);
+
+    source = nitf_ImageSource_construct(&error);
+    TEST_ASSERT(source);
+    for (band = 0; band < layout->numBands; band++)
+    {
+        nitf_BandSource *bandSource;
+
+        data[band] = (nitf_Uint8 *) NITF_MALLOC(size);
+        TEST_ASSERT(data[band]);
+        for (row = 0; row < layout->numRows; row++)
+            for (col = 0; col < layout->numCols; col++)
+                store(data[band], bytes, (size_t) row * layout->numCols + col,
+                      pixel(layout, band, row, col));
+        bandSource = nitf_MemorySource_construct((char *) data[band], size,
+                                                 0, bytes, 0, &error);
+        TEST_ASSERT(bandSource);
+        TEST_ASSERT(nitf_ImageSource_addBand(source, bandSource, &error));
+    }
+    TEST_ASSERT(nitf_ImageWriter_attachSource(imageWriter, source, &error));
+    TEST_ASSERT(nitf_Writer_write(writer, &error));
+
+    nitf_IOHandle_close(out);
+    nitf_Writer_destruct(&writer);
+    nitf_Record_destruct(&record);
+    for (band = 0; band < layout->numBands; band++)
+        NITF_FREE(data[band]);
+}
+
+/*
+ *  Write every NUM_THREADS'th write from the first. Write k of the
+ *  sequence is write (k * stride) % numWrites of the image, which is band
+ *  w % numBands of block w / numBands, so the bands of a block arrive out
+ *  of order and far apart.
+ */
+static void writeBlocks(void *data)
+{
+    const char *testName = "writeBlocks";
+    WriteJob *job = (WriteJob *) data;
+    const BlockWrites *writes = job->writes;
+    const Layout *layout = writes->layout;
+    nitf_Error error;
+    nitf_Uint8 *buffer;
+    nitf_Uint32 k;
+
+    buffer = (nitf_Uint8 *) NITF_MALLOC((size_t) layout->numRowsPerBlock
+                                        * layout->numColsPerBlock
+                                        * (layout->numBits / 8));
+    TEST_ASSERT(buffer);
+    for (k = job->first; k < writes->numWrites; k += NUM_THREADS)
+    {
+        nitf_Uint32 w = (nitf_Uint32) (((nitf_Uint64) k * writes->stride)
+                                       % writes->numWrites);
+        nitf_Uint32 block = w / layout->numBands;
+        nitf_Uint32 band = w % layout->numBands;
+        nitf_Uint32 blockRow = block / writes->blocksPerRow;
+        nitf_Uint32 blockCol = block % writes->blocksPerRow;
+
+        fillBlock(layout, blockRow, blockCol, band, buffer);
+        TEST_ASSERT(nitf_ImageWriter_writeBlock(writes->imageWriter,
+                                                blockRow, blockCol, band,
+                                                buffer, &error));
+    }
+    NITF_FREE(buffer);
+}
+
+static nitf_Uint32 gcd(nitf_Uint32 a, nitf_Uint32 b)
+{
+    while (b != 0)
+    {
+        nitf_Uint32 t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+/*
+ *  Write the image a block at a time from several threads. A block
+ *  written before nitf_Writer_write has laid out the image, and a block
+ *  outside the image, are rejected.
+ */
+static void writeByBlocks(const char *testName, const Layout *layout)
+{
+    nitf_Error error;
+    nitf_Record *record = makeRecord(testName, layout);
+    nitf_Writer *writer;
+    nitf_IOHandle out;
+    BlockWrites writes;
+    WriteJob jobs[NUM_THREADS];
+    nitf_Thread threads[NUM_THREADS];
+    nitf_Uint32 blocksPerCol = (layout->numRows + layout->numRowsPerBlock - 1)
+        / layout->numRowsPerBlock;
+    nitf_Uint8 *buffer;
+    int i;
+
+    writes.layout = layout;
+    writes.blocksPerRow = (layout->numCols + layout->numColsPerBlock - 1)
+        / layout->numColsPerBlock;
+    writes.numWrites = writes.blocksPerRow * blocksPerCol * layout->numBands;
+    for (writes.stride = 7919; gcd(writes.stride, writes.numWrites) != 1;
+         writes.stride += 2)
+        ;
+
+    buffer = (nitf_Uint8 *) NITF_MALLOC((size_t) layout->numRowsPerBlock
+                                        * layout->numColsPerBlock
+                                        * (layout->numBits / 8));
+    TEST_ASSERT(buffer);
+    fillBlock(layout, 0, 0, 0, buffer);
+
+    out = nitf_IOHandle_create(TEST_FILE_NAME, NITF_ACCESS_WRITEONLY,
+                               NITF_CREATE, &error);
+    TEST_ASSERT(!NITF_INVALID_HANDLE(out));
+    writer = nitf_Writer_construct(&error);
+    TEST_ASSERT(writer);
+    TEST_ASSERT(nitf_Writer_prepare(writer, record, out, &error));
+    writes.imageWriter = nitf_Writer_newImageWriter(writer, 0, &error);
+    TEST_ASSERT(writes.imageWriter);
+    TEST_ASSERT(nitf_ImageWriter_enableBlockWrites(writes.imageWriter,
+                                                   &error));
+    TEST_ASSERT(!nitf_ImageWriter_writeBlock(writes.imageWriter, 0, 0, 0,
+                                             buffer, &error));
+    TEST_ASSERT(nitf_Writer_write(writer, &error));
+
+    for (i = 0; i < NUM_THREADS; i++)
+    {
+        jobs[i].writes = &writes;
+        jobs[i].first = (nitf_Uint32) i;
+        TEST_ASSERT(nitf_Thread_create(&threads[i], writeBlocks, &jobs[i],
+                                       &error));
+    }
+    for (i = 0; i < NUM_THREADS; i++)
+        nitf_Thread_join(&threads[i]);
+
+    TEST_ASSERT(!nitf_ImageWriter_writeBlock(writes.imageWriter,
+                                             blocksPerCol, 0, 0, buffer,
+                                             &error));
+    TEST_ASSERT(nitf_ImageWriter_blockWritesDone(writes.imageWriter,
+                                                 &error));
+
+    nitf_IOHandle_close(out);
+    nitf_Writer_destruct(&writer);
+    nitf_Record_destruct(&record);
+    NITF_FREE(buffer);
+}
+
+static void checkWindow(const char *testName, const Layout *layout,
+                        nitf_ImageReader *image, nitf_Uint32 startRow,
+                        nitf_Uint32 startCol, nitf_Uint32 numRows,
+                        nitf_Uint32 numCols)
+{
+    nitf_Error error;
+    nitf_SubWindow window;
+    nitf_Uint32 bandList[MAX_BANDS] = { 0, 1, 2 };
+    nitf_Uint8 *buffers[MAX_BANDS];
+    nitf_Uint32 bytes = layout->numBits / 8;
+    nitf_Uint32 band, row, col;
+    int padded;
+
+    memset(&window, 0, sizeof(window));
+    window.startRow = startRow;
+    window.startCol = startCol;
+    window.numRows = numRows;
+    window.numCols = numCols;
+    window.bandList = bandList;
+    window.numBands = layout->numBands;
+    for (band = 0; band < layout->numBands; band++)
+    {
+        buffers[band] = (nitf_Uint8 *) NITF_MALLOC((size_t) numRows
+                                                   * numCols * bytes);
+        TEST_ASSERT(buffers[band]);
+    }
+    TEST_ASSERT(nitf_ImageReader_read(image, &window, buffers, &padded,
+                                      &error));
+    for (band = 0; band < layout->numBands; band++)
+    {
+        for (row = 0; row < numRows; row++)
+            for (col = 0; col < numCols; col++)
+                TEST_ASSERT(load(buffers[band], bytes,
+                                 (size_t) row * numCols + col) ==
+                            pixel(layout, band, startRow + row,
+                                  startCol + col));
+        NITF_FREE(buffers[band]);
+    }
+}
+
+/*
+ *  Read the image data of the file, and check the pixels
+ */
+static nitf_Uint8 *readImage(const char *testName, const Layout *layout,
+                             size_t *length)
+{
+    nitf_Error error;
+    nitf_IOInterface *io;
+    nitf_Reader *reader;
+    nitf_Record *record;
+    nitf_ImageSegment *segment;
+    nitf_ImageReader *image;
+    nitf_Uint8 *data;
+
+    io = nitf_IOHandleAdapter_open(TEST_FILE_NAME, NITF_ACCESS_READONLY,
+                                   NITF_OPEN_EXISTING, &error);
+    TEST_ASSERT(io);
+    reader = nitf_Reader_construct(&error);
+    TEST_ASSERT(reader);
+    record = nitf_Reader_readIO(reader, io, &error);
+    TEST_ASSERT(record);
+
+    segment = (nitf_ImageSegment *) record->images->first->data;
+    *length = (size_t) (segment->imageEnd - segment->imageOffset);
+    data = (nitf_Uint8 *) NITF_MALLOC(*length);
+    TEST_ASSERT(data);
+    TEST_ASSERT(nitf_IOInterface_readAt(io, (nitf_Off) segment->imageOffset,
+                                        (char *) data, *length, &error));
+
+    image = nitf_Reader_newImageReader(reader, 0, &error);
+    TEST_ASSERT(image);
+    checkWindow(testName, layout, image, 0, 0, layout->numRows,
+                layout->numCols);
+    checkWindow(testName, layout, image, layout->numRows / 7,
+                layout->numCols / 9, layout->numRows / 2,
+                layout->numCols * 2 / 3);
+    checkWindow(testName, layout, image, layout->numRows - 3,
+                layout->numCols - 4, 3, 4);
+
+    nitf_ImageReader_destruct(&image);
+    nitf_Record_destruct(&record);
+    nitf_Reader_destruct(&reader);
+    nitf_IOInterface_close(io, &error);
+    nitf_IOInterface_destruct(&io);
+    return data;
+}
+
+/*
+ *  The image data written a block at a time, masks included, must be the
+ *  same as the image data written from an image source
+ */
+static void compareWrites(const char *testName, const Layout *layout)
+{
+    nitf_Uint8 *reference;
+    nitf_Uint8 *data;
+    size_t referenceLength;
+    size_t length;
+
+    writeImage(testName, layout);
+    reference = readImage(testName, layout, &referenceLength);
+    writeByBlocks(testName, layout);
+    data = readImage(testName, layout, &length);
+    TEST_ASSERT(length == referenceLength);
+    TEST_ASSERT(memcmp(data, reference, length) == 0);
+    NITF_FREE(data);
+    NITF_FREE(reference);
+}
+
+TEST_CASE(testUncompressed)
+{
+    Layout blocked = { "B", 3, 8, 300, 260, 32, 48, NULL };
+    Layout sequential = { "S", 2, 8, 250, 200, 40, 64, NULL };
+    Layout pixels = { "P", 3, 16, 220, 190, 48, 32, NULL };
+    Layout rows = { "R", 3, 8, 160, 230, 64, 64, NULL };
+    Layout wide = { "B", 1, 32, 150, 120, 64, 40, NULL };
+
+    compareWrites(testName, &blocked);
+    compareWrites(testName, &sequential);
+    compareWrites(testName, &pixels);
+    compareWrites(testName, &rows);
+    compareWrites(testName, &wide);
+}
+
+/*
+ *  The edge blocks hold pad pixels, which must be recorded in the pad
+ *  mask as they are for a write from an image source
+ */
+TEST_CASE(testMasked)
+{
+    Layout blocked = { "B", 2, 8, 200, 230, 32, 48, "NM" };
+    Layout pixels = { "P", 2, 16, 170, 140, 64, 48, "NM" };
+    Layout rows = { "R", 3, 8, 140, 110, 32, 32, "NM" };
+
+    compareWrites(testName, &blocked);
+    compareWrites(testName, &pixels);
+    compareWrites(testName, &rows);
+}
+
+int main(int argc, char **argv)
+{
+    CHECK(testUncompressed);
+    CHECK(testMasked);
+    remove(TEST_FILE_NAME);
+    return 0;
+}
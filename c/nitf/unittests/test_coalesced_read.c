@@ -0,0 +1,469 @@
+/* =========================================================================
+ * This file is part of NITRO
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2010, General Dynamics - Advanced Information Systems
+ *
+ * NITRO is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <import/nitf.h>
+#include "Test.h"
+
+#define TEST_FILE_NAME "test_coalesced_read.ntf"
+#define MAX_BANDS 3
+
+typedef struct
+{
+    const char *mode;
+    nitf_Uint32 numBands;
+    nitf_Uint32 numBits;
+    nitf_Uint32 numRows;
+    nitf_Uint32 numCols;
+    nitf_Uint32 numRowsPerBlock;
+    nitf_Uint32 numColsPerBlock;
+}
+Layout;
+
+/* A counting interface, the interface table is in the control object */
+typedef struct
+{
+    nitf_IIOInterface iface;
+    nitf_IOInterface *io;
+    nitf_Mutex lock;
+    nitf_Uint32 readAt;
+    nitf_Uint32 readvAt;
+}
+Counter;
+
+typedef enum
+{
+    IO_FILE,
+    IO_BUFFER,
+    IO_MMAP,
+    IO_COUNT_VECTOR,
+    IO_COUNT_READ_AT
+}
+IOKind;
+
+static nitf_Uint32 pixel(const Layout *layout, nitf_Uint32 band,
+                         nitf_Uint32 row, nitf_Uint32 col)
+{
+    nitf_Uint32 value = (band * 97 + row * 7 + col * 3 + (row * col) % 13)
+        ^ ((row * 40503 + col * 9973) << 8);
+
+    return layout->numBits == 32 ? value :
+        value & ((((nitf_Uint32) 1) << layout->numBits) - 1);
+}
+
+static nitf_Uint32 load(const nitf_Uint8 *buffer, nitf_Uint32 bytes,
+                        size_t index)
+{
+    if (bytes == 1)
+        return buffer[index];
+    if (bytes == 2)
+        return ((const nitf_Uint16 *) buffer)[index];
+    return ((const nitf_Uint32 *) buffer)[index];
+}
+
+static void count(NITF_DATA *data, nitf_Uint32 *calls)
+{
+    Counter *counter = (Counter *) data;
+
+    nitf_Mutex_lock(&(counter->lock));
+    (*calls)++;
+    nitf_Mutex_unlock(&(counter->lock));
+}
+
+static NITF_BOOL counterRead(NITF_DATA *data, char *buf, size_t size,
+                             nitf_Error *error)
+{
+    return nitf_IOInterface_read(((Counter *) data)->io, buf, size, error);
+}
+
+static NITF_BOOL counterWrite(NITF_DATA *data, const char *buf, size_t size,
+                              nitf_Error *error)
+{
+    return nitf_IOInterface_write(((Counter *) data)->io, buf, size, error);
+}
+
+static NITF_BOOL counterCanSeek(NITF_DATA *data, nitf_Error *error)
+{
+    return nitf_IOInterface_canSeek(((Counter *) data)->io, error);
+}
+
+static nitf_Off counterSeek(NITF_DATA *data, nitf_Off offset, int whence,
+                            nitf_Error *error)
+{
+    return nitf_IOInterface_seek(((Counter *) data)->io, offset, whence,
+                                 error);
+}
+
+static nitf_Off counterTell(NITF_DATA *data, nitf_Error *error)
+{
+    return nitf_IOInterface_tell(((Counter *) data)->io, error);
+}
+
+static nitf_Off counterGetSize(NITF_DATA *data, nitf_Error *error)
+{
+    return nitf_IOInterface_getSize(((Counter *) data)->io, error);
+}
+
+static int counterGetMode(NITF_DATA *data, nitf_Error *error)
+{
+    return nitf_IOInterface_getMode(((Counter *) data)->io, error);
+}
+
+static NITF_BOOL counterClose(NITF_DATA *data, nitf_Error *error)
+{
+    return nitf_IOInterface_close(((Counter *) data)->io, error);
+}
+
+static void counterDestruct(NITF_DATA *data)
+{
+    Counter *counter = (Counter *) data;
+
+    nitf_IOInterface_destruct(&(counter->io));
+    nitf_Mutex_delete(&(counter->lock));
+}
+
+static NITF_BOOL counterReadAt(NITF_DATA *data, nitf_Off offset, char *buf,
+                               size_t size, nitf_Error *error)
+{
+    count(data, &(((Counter *) data)->readAt));
+    return nitf_IOInterface_readAt(((Counter *) data)->io, offset, buf, size,
+                                   error);
+}
+
+static NITF_BOOL counterReadvAt(NITF_DATA *data, nitf_Off offset,
+                                const nitf_IOVec *vec, int numVecs,
+                                nitf_Error *error)
+{
+    count(data, &(((Counter *) data)->readvAt));
+    return nitf_IOInterface_readvAt(((Counter *) data)->io, offset, vec,
+                                    numVecs, error);
+}
+
+/*
+ *  Wrap a file in a counting interface, which offers readvAt unless kind
+ *  is IO_COUNT_READ_AT
+ */
+static nitf_IOInterface *countCalls(const char *testName, IOKind kind)
+{
+    nitf_Error error;
+    nitf_IOInterface *counted;
+    Counter *counter;
+
+    counted = (nitf_IOInterface *) NITF_MALLOC(sizeof(nitf_IOInterface));
+    TEST_ASSERT(counted);
+    counter = (Counter *) NITF_MALLOC(sizeof(Counter));
+    TEST_ASSERT(counter);
+    memset(counter, 0, sizeof(Counter));
+    counter->iface.read = counterRead;
+    counter->iface.write = counterWrite;
+    counter->iface.canSeek = counterCanSeek;
+    counter->iface.seek = counterSeek;
+    counter->iface.tell = counterTell;
+    counter->iface.getSize = counterGetSize;
+    counter->iface.getMode = counterGetMode;
+    counter->iface.close = counterClose;
+    counter->iface.destruct = counterDestruct;
+    counter->iface.readAt = counterReadAt;
+    if (kind == IO_COUNT_VECTOR)
+        counter->iface.readvAt = counterReadvAt;
+    counter->io = nitf_IOHandleAdapter_open(TEST_FILE_NAME,
+                                            NITF_ACCESS_READONLY,
+                                            NITF_OPEN_EXISTING, &error);
+    TEST_ASSERT(counter->io);
+    nitf_Mutex_init(&(counter->lock));
+
+    counted->data = counter;
+    counted->iface = &(counter->iface);
+    return counted;
+}
+
+static nitf_IOInterface *openIO(const char *testName, IOKind kind)
+{
+    nitf_Error error;
+    nitf_IOInterface *io = NULL;
+
+    if (kind == IO_FILE)
+        io = nitf_IOHandleAdapter_open(TEST_FILE_NAME, NITF_ACCESS_READONLY,
+                                       NITF_OPEN_EXISTING, &error);
+    else if (kind == IO_MMAP)
+        io = nitf_MMapAdapter_open(TEST_FILE_NAME, &error);
+    else if (kind == IO_BUFFER)
+    {
+        nitf_IOHandle handle;
+        nitf_Off size;
+        char *buf;
+
+        handle = nitf_IOHandle_create(TEST_FILE_NAME, NITF_ACCESS_READONLY,
+                                      NITF_OPEN_EXISTING, &error);
+        TEST_ASSERT(!NITF_INVALID_HANDLE(handle));
+        size = nitf_IOHandle_getSize(handle, &error);
+        buf = (char *) NITF_MALLOC((size_t) size);
+        TEST_ASSERT(buf);
+        TEST_ASSERT(nitf_IOHandle_read(handle, buf, (size_t) size, &error));
+        nitf_IOHandle_close(handle);
+        io = nitf_BufferAdapter_construct(buf, (size_t) size, 1, &error);
+    }
+    else
+        io = countCalls(testName, kind);
+    TEST_ASSERT(io);
+    return io;
+}
+
+static void writeImage(const char *testName, const Layout *layout)
+{
+    nitf_Error error;
+    nitf_Record *record;
+    nitf_ImageSegment *segment;
+    nitf_BandInfo **bands;
+    nitf_Writer *writer;
+    nitf_ImageWriter *imageWriter;
+    nitf_ImageSource *source;
+    nitf_IOHandle out;
+    nitf_Uint32 bytes = layout->numBits / 8;
+    size_t size = (size_t) layout->numRows * layout->numCols * bytes;
+    nitf_Uint8 *data[MAX_BANDS];
+    nitf_Uint32 band, row, col;
+
+    record = nitf_Record_construct(NITF_VER_21, &error);
+    TEST_ASSERT(record);
+    segment = nitf_Record_newImageSegment(record, &error);
+    TEST_ASSERT(segment);
+    bands = (nitf_BandInfo **) NITF_MALLOC(sizeof(nitf_BandInfo *)
+                                           * layout->numBands);
+    TEST_ASSERT(bands);
+    for (band = 0; band < layout->numBands; band++)
+    {
+        bands[band] = nitf_BandInfo_construct(&error);
+        TEST_ASSERT(bands[band]);
+        TEST_ASSERT(nitf_BandInfo_init(bands[band], "M", " ", "N", "   ",
+                                       0, 0, NULL, &error));
+    }
+    TEST_ASSERT(nitf_ImageSubheader_setPixelInformation(segment->subheader,
+                                                        "INT",
+                                                        layout->numBits,
+                                                        layout->numBits, "R",
+                                                        layout->numBands == 1 ?
+                                                        "MONO" : "MULTI",
+                                                        "VIS",
+                                                        layout->numBands,
+                                                        bands, &error));
+    TEST_ASSERT(nitf_ImageSubheader_setBlocking(segment->subheader,
+                                                layout->numRows,
+                                                layout->numCols,
+                                                layout->numRowsPerBlock,
+                                                layout->numColsPerBlock,
+                                                layout->mode, &error));
+
+    out = nitf_IOHandle_create(TEST_FILE_NAME, NITF_ACCESS_WRITEONLY,
+                               NITF_CREATE, &error);
+    TEST_ASSERT(!NITF_INVALID_HANDLE(out));
+    writer = nitf_Writer_construct(&error);
+    TEST_ASSERT(writer);
+    TEST_ASSERT(nitf_Writer_prepare(writer, record, out, &error));
+    imageWriter = nitf_Writer_newImageWriter(writer, 0, &error);
+    TEST_ASSERT(imageWriter);
+
+    source = nitf_ImageSource_construct(&error);
+    TEST_ASSERT(source);
+    for (band = 0; band < layout->numBands; band++)
+    {
+        nitf_BandSource *bandSource;
+
+        data[band] = (nitf_Uint8 *) NITF_MALLOC(size);
+        TEST_ASSERT(data[band]);
+        for (row = 0; row < layout->numRows; row++)
+            for (col = 0; col < layout->numCols; col++)
+            {
+                nitf_Uint32 value = pixel(layout, band, row, col);
+                size_t n = (size_t) row * layout->numCols + col;
+
+                if (bytes == 1)
+                    data[band][n] = (nitf_Uint8) value;
+                else if (bytes == 2)
+                    ((nitf_Uint16 *) data[band])[n] = (nitf_Uint16) value;
+                else
+                    ((nitf_Uint32 *) data[band])[n] = value;
+            }
+        bandSource = nitf_MemorySource_construct((char *) data[band], size,
+                                                 0, bytes, 0, &error);
+        TEST_ASSERT(bandSource);
+        TEST_ASSERT(nitf_ImageSource_addBand(source, bandSource, &error));
+    }
+    TEST_ASSERT(nitf_ImageWriter_attachSource(imageWriter, source, &error));
+    TEST_ASSERT(nitf_Writer_write(writer, &error));
+
+    nitf_IOHandle_close(out);
+    nitf_Writer_destruct(&writer);
+    nitf_Record_destruct(&record);
+    for (band = 0; band < layout->numBands; band++)
+        NITF_FREE(data[band]);
+}
+
+static void checkWindow(const char *testName, const Layout *layout,
+                        nitf_ImageReader *image, nitf_Uint32 startRow,
+                        nitf_Uint32 startCol, nitf_Uint32 numRows,
+                        nitf_Uint32 numCols)
+{
+    nitf_Error error;
+    nitf_SubWindow window;
+    nitf_Uint32 bandList[MAX_BANDS] = { 0, 1, 2 };
+    nitf_Uint8 *buffers[MAX_BANDS];
+    nitf_Uint32 bytes = layout->numBits / 8;
+    nitf_Uint32 band, row, col;
+    int padded;
+
+    memset(&window, 0, sizeof(window));
+    window.startRow = startRow;
+    window.startCol = startCol;
+    window.numRows = numRows;
+    window.numCols = numCols;
+    window.bandList = bandList;
+    window.numBands = layout->numBands;
+    for (band = 0; band < layout->numBands; band++)
+    {
+        buffers[band] = (nitf_Uint8 *) NITF_MALLOC((size_t) numRows
+                                                   * numCols * bytes);
+        TEST_ASSERT(buffers[band]);
+    }
+    TEST_ASSERT(nitf_ImageReader_read(image, &window, buffers, &padded,
+                                      &error));
+    for (band = 0; band < layout->numBands; band++)
+    {
+        for (row = 0; row < numRows; row++)
+            for (col = 0; col < numCols; col++)
+                TEST_ASSERT(load(buffers[band], bytes,
+                                 (size_t) row * numCols + col) ==
+                            pixel(layout, band, startRow + row,
+                                  startCol + col));
+        NITF_FREE(buffers[band]);
+    }
+}
+
+/*
+ *  Read the whole image, a window inside it and one at its corner,
+ *  uncached, so row segments are merged, and cached. A whole image read
+ *  through a counting interface that offers readvAt must use it, with
+ *  far fewer calls than there are row segments. P mode reads are
+ *  deinterleaved after the read, so they are not merged.
+ */
+static void readAll(const char *testName, const Layout *layout)
+{
+    nitf_Uint32 blocksPerRow = (layout->numCols + layout->numColsPerBlock - 1)
+        / layout->numColsPerBlock;
+    nitf_Uint32 segments = layout->numRows * blocksPerRow
+        * layout->numBands;
+    int kind;
+    int cached;
+
+    writeImage(testName, layout);
+    for (kind = IO_FILE; kind <= IO_COUNT_READ_AT; kind++)
+        for (cached = 0; cached < 2; cached++)
+        {
+            nitf_Error error;
+            nitf_IOInterface *io = openIO(testName, (IOKind) kind);
+            nitf_Reader *reader;
+            nitf_Record *record;
+            nitf_ImageReader *image;
+
+            reader = nitf_Reader_construct(&error);
+            TEST_ASSERT(reader);
+            record = nitf_Reader_readIO(reader, io, &error);
+            TEST_ASSERT(record);
+            image = nitf_Reader_newImageReader(reader, 0, &error);
+            TEST_ASSERT(image);
+            if (cached)
+                nitf_ImageReader_setReadCacheSize(image,
+                                                  8 * (size_t) layout->
+                                                  numRowsPerBlock
+                                                  * layout->numColsPerBlock
+                                                  * layout->numBands
+                                                  * (layout->numBits / 8));
+
+            if (kind == IO_COUNT_VECTOR && !cached &&
+                strcmp(layout->mode, "P") != 0)
+            {
+                Counter *counter = (Counter *) io->data;
+
+                counter->readAt = 0;
+                counter->readvAt = 0;
+                checkWindow(testName, layout, image, 0, 0, layout->numRows,
+                            layout->numCols);
+                TEST_ASSERT_EQ_INT(counter->readAt, 0);
+                TEST_ASSERT(counter->readvAt * 4 <= segments);
+            }
+            else
+                checkWindow(testName, layout, image, 0, 0, layout->numRows,
+                            layout->numCols);
+            checkWindow(testName, layout, image, layout->numRows / 7,
+                        layout->numCols / 9, layout->numRows / 2,
+                        layout->numCols * 2 / 3);
+            checkWindow(testName, layout, image, layout->numRows - 3,
+                        layout->numCols - 4, 3, 4);
+
+            nitf_ImageReader_destruct(&image);
+            nitf_Record_destruct(&record);
+            nitf_Reader_destruct(&reader);
+            nitf_IOInterface_close(io, &error);
+            nitf_IOInterface_destruct(&io);
+        }
+}
+
+/* Narrow blocks leave small gaps between row segments */
+
+TEST_CASE(testBandSequential)
+{
+    Layout layout = { "S", 3, 8, 200, 230, 32, 48 };
+
+    readAll(testName, &layout);
+}
+
+TEST_CASE(testBandInterleavedByRow)
+{
+    Layout layout = { "R", 2, 16, 150, 170, 64, 40 };
+
+    readAll(testName, &layout);
+}
+
+TEST_CASE(testBandInterleavedByBlock)
+{
+    Layout layout = { "B", 3, 8, 180, 260, 48, 32 };
+    Layout wide = { "B", 1, 32, 120, 600, 40, 512 };
+
+    readAll(testName, &layout);
+    readAll(testName, &wide);
+}
+
+TEST_CASE(testPixelInterleaved)
+{
+    Layout layout = { "P", 2, 16, 160, 150, 32, 64 };
+
+    readAll(testName, &layout);
+}
+
+int main(int argc, char **argv)
+{
+    CHECK(testBandSequential);
+    CHECK(testBandInterleavedByRow);
+    CHECK(testBandInterleavedByBlock);
+    CHECK(testPixelInterleaved);
+    remove(TEST_FILE_NAME);
+    return 0;
+}
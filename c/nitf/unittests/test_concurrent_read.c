@@ -0,0 +1,324 @@
+/* =========================================================================
+ * This file is part of NITRO
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2010, General Dynamics - Advanced Information Systems
+ *
+ * NITRO is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <import/nitf.h>
+#include "Test.h"
+
+#define TEST_FILE_NAME "test_concurrent_read.ntf"
+#define NUM_ROWS 300
+#define NUM_COLS 260
+#define MAX_BANDS 3
+#define NUM_THREADS 8
+#define NUM_READS 100
+
+typedef struct _ReadJob
+{
+    const char *testName;
+    nitf_ImageReader *image;
+    nitf_Uint32 numBands;
+    nitf_Uint32 numBits;
+    int rgb;
+    nitf_Uint32 seed;
+} ReadJob;
+
+static nitf_Uint32 pixel(nitf_Uint32 numBits, nitf_Uint32 band,
+                         nitf_Uint32 row, nitf_Uint32 col)
+{
+    nitf_Uint32 value = band * 97 + row * 7 + col * 3 + (row * col) % 13;
+    return numBits == 8 ? value & 0xff : (value ^ (row << 10)) & 0xffff;
+}
+
+static nitf_Uint32 nextRandom(nitf_Uint32 *seed, nitf_Uint32 range)
+{
+    *seed = *seed * 1103515245 + 12345;
+    return ((*seed >> 16) & 0x7fff) % range;
+}
+
+/*
+ *  Write a 300 by 260 image of 64 by 48 blocks in the given mode
+ */
+static void writeImage(const char *testName, const char *mode,
+                       nitf_Uint32 numBands, nitf_Uint32 numBits, int rgb)
+{
+    nitf_Error error;
+    nitf_Record *record;
+    nitf_ImageSegment *segment;
+    nitf_BandInfo **bands;
+    nitf_Writer *writer;
+    nitf_ImageWriter *imageWriter;
+    nitf_ImageSource *source;
+    nitf_IOHandle out;
+    nitf_Uint32 bytes = numBits / 8;
+    nitf_Uint8 *data[MAX_BANDS];
+    nitf_Uint32 band, row, col;
+
+    record = nitf_Record_construct(NITF_VER_21, &error);
+    TEST_ASSERT(record);
+    segment = nitf_Record_newImageSegment(record, &error);
+    TEST_ASSERT(segment);
+
+    bands = (nitf_BandInfo **) NITF_MALLOC(sizeof(nitf_BandInfo *)
+                                           * numBands);
+    TEST_ASSERT(bands);
+    for (band = 0; band < numBands; band++)
+    {
+        bands[band] = nitf_BandInfo_construct(&error);
+        TEST_ASSERT(bands[band]);
+        TEST_ASSERT(nitf_BandInfo_init(bands[band],
+                                       rgb ? (band == 0 ? "R" :
+                                              band == 1 ? "G" : "B") : "M",
+                                       " ", "N", "   ", 0, 0, NULL,
+                                       &error));
+    }
+    TEST_ASSERT(nitf_ImageSubheader_setPixelInformation(segment->subheader,
+                                                        "INT", numBits,
+                                                        numBits, "R",
+                                                        rgb ? "RGB" :
+                                                        "MULTI", "VIS",
+                                                        numBands, bands,
+                                                        &error));
+    TEST_ASSERT(nitf_ImageSubheader_setBlocking(segment->subheader,
+                                                NUM_ROWS, NUM_COLS, 64, 48,
+                                                mode, &error));
+
+    out = nitf_IOHandle_create(TEST_FILE_NAME, NITF_ACCESS_WRITEONLY,
+                               NITF_CREATE, &error);
+    TEST_ASSERT(!NITF_INVALID_HANDLE(out));
+    writer = nitf_Writer_construct(&error);
+    TEST_ASSERT(writer);
+    TEST_ASSERT(nitf_Writer_prepare(writer, record, out, &error));
+    imageWriter = nitf_Writer_newImageWriter(writer, 0, &error);
+    TEST_ASSERT(imageWriter);
+
+    source = nitf_ImageSource_construct(&error);
+    TEST_ASSERT(source);
+    for (band = 0; band < numBands; band++)
+    {
+        nitf_BandSource *bandSource;
+
+        data[band] = (nitf_Uint8 *) NITF_MALLOC(NUM_ROWS * NUM_COLS * bytes);
+        TEST_ASSERT(data[band]);
+        for (row = 0; row < NUM_ROWS; row++)
+            for (col = 0; col < NUM_COLS; col++)
+            {
+                nitf_Uint32 value = pixel(numBits, band, row, col);
+
+                if (bytes == 1)
+                    data[band][row * NUM_COLS + col] = (nitf_Uint8) value;
+                else
+                    ((nitf_Uint16 *) data[band])[row * NUM_COLS + col] =
+                        (nitf_Uint16) value;
+            }
+        bandSource = nitf_MemorySource_construct((char *) data[band],
+                                                 NUM_ROWS * NUM_COLS * bytes,
+                                                 0, bytes, 0, &error);
+        TEST_ASSERT(bandSource);
+        TEST_ASSERT(nitf_ImageSource_addBand(source, bandSource, &error));
+    }
+    TEST_ASSERT(nitf_ImageWriter_attachSource(imageWriter, source, &error));
+    TEST_ASSERT(nitf_Writer_write(writer, &error));
+
+    nitf_IOHandle_close(out);
+    nitf_Writer_destruct(&writer);
+    nitf_Record_destruct(&record);
+    for (band = 0; band < numBands; band++)
+        NITF_FREE(data[band]);
+}
+
+/*
+ *  Check whether a buffer holds band 0 of an RGB window as packed RGB
+ *  pixels
+ */
+static int isPacked(const nitf_Uint8 *buffer, nitf_Uint32 startRow,
+                    nitf_Uint32 startCol, nitf_Uint32 numRows,
+                    nitf_Uint32 numCols)
+{
+    nitf_Uint32 row, col, band;
+
+    for (row = 0; row < numRows; row++)
+        for (col = 0; col < numCols; col++)
+            for (band = 0; band < 3; band++)
+                if (*(buffer++) != pixel(8, band, startRow + row,
+                                         startCol + col))
+                    return 0;
+    return 1;
+}
+
+/*
+ *  Read a window of the first numBands bands and compare it with the
+ *  pattern. A read of band 0 of an RGB image returns packed RGB pixels
+ *  until the reader switches to separate bands, so it may match either.
+ */
+static void checkWindow(const ReadJob *job, nitf_Uint32 startRow,
+                        nitf_Uint32 startCol, nitf_Uint32 numRows,
+                        nitf_Uint32 numCols, nitf_Uint32 numBands)
+{
+    const char *testName = job->testName;
+    nitf_Error error;
+    nitf_SubWindow window;
+    nitf_Uint32 bandList[MAX_BANDS];
+    nitf_Uint8 *buffers[MAX_BANDS];
+    size_t numPixels = (size_t) numRows * numCols;
+    nitf_Uint32 i, row, col;
+    int padded;
+
+    memset(&window, 0, sizeof(window));
+    window.startRow = startRow;
+    window.startCol = startCol;
+    window.numRows = numRows;
+    window.numCols = numCols;
+    window.bandList = bandList;
+    window.numBands = numBands;
+
+    for (i = 0; i < numBands; i++)
+    {
+        bandList[i] = i;
+        buffers[i] = (nitf_Uint8 *) NITF_MALLOC(numPixels * 3 * 2);
+        TEST_ASSERT(buffers[i]);
+    }
+    TEST_ASSERT(nitf_ImageReader_read(job->image, &window, buffers, &padded,
+                                      &error));
+
+    for (i = 0; i < numBands; i++)
+    {
+        if (!job->rgb || numBands != 1 ||
+            !isPacked(buffers[i], startRow, startCol, numRows, numCols))
+            for (row = 0; row < numRows; row++)
+                for (col = 0; col < numCols; col++)
+                {
+                    size_t n = (size_t) row * numCols + col;
+                    nitf_Uint32 got = job->numBits == 8 ? buffers[i][n] :
+                        ((nitf_Uint16 *) buffers[i])[n];
+
+                    TEST_ASSERT_EQ_INT(got,
+                                       pixel(job->numBits, bandList[i],
+                                             startRow + row,
+                                             startCol + col));
+                }
+        NITF_FREE(buffers[i]);
+    }
+}
+
+static void readWindows(void *data)
+{
+    ReadJob *job = (ReadJob *) data;
+    int i;
+
+    for (i = 0; i < NUM_READS; i++)
+    {
+        nitf_Uint32 numRows = 1 + nextRandom(&(job->seed), 120);
+        nitf_Uint32 numCols = 1 + nextRandom(&(job->seed), 120);
+        nitf_Uint32 startRow =
+            nextRandom(&(job->seed), NUM_ROWS - numRows + 1);
+        nitf_Uint32 startCol =
+            nextRandom(&(job->seed), NUM_COLS - numCols + 1);
+        nitf_Uint32 numBands = 1 + nextRandom(&(job->seed), job->numBands);
+
+        /* Mostly packed reads, so some are in progress at the switch */
+        if (job->rgb)
+            numBands = nextRandom(&(job->seed), 10) == 0 ? 3 : 1;
+        checkWindow(job, startRow, startCol, numRows, numCols, numBands);
+    }
+}
+
+/*
+ *  Read random windows of one image reader from several threads, with and
+ *  without the block cache. Every read must succeed with the right pixels.
+ */
+static void readConcurrently(const char *testName, const char *mode,
+                             nitf_Uint32 numBands, nitf_Uint32 numBits,
+                             int rgb)
+{
+    nitf_Error error;
+    nitf_IOHandle in;
+    nitf_Reader *reader;
+    nitf_Record *record;
+    ReadJob jobs[NUM_THREADS];
+    nitf_Thread threads[NUM_THREADS];
+    int pass;
+    int i;
+
+    writeImage(testName, mode, numBands, numBits, rgb);
+    for (pass = 0; pass < 2; pass++)
+    {
+        in = nitf_IOHandle_create(TEST_FILE_NAME, NITF_ACCESS_READONLY,
+                                  NITF_OPEN_EXISTING, &error);
+        TEST_ASSERT(!NITF_INVALID_HANDLE(in));
+        reader = nitf_Reader_construct(&error);
+        TEST_ASSERT(reader);
+        record = nitf_Reader_read(reader, in, &error);
+        TEST_ASSERT(record);
+
+        for (i = 0; i < NUM_THREADS; i++)
+        {
+            jobs[i].testName = testName;
+            jobs[i].image = i == 0 ?
+                nitf_Reader_newImageReader(reader, 0, &error) :
+                jobs[0].image;
+            TEST_ASSERT(jobs[i].image);
+            jobs[i].numBands = numBands;
+            jobs[i].numBits = numBits;
+            jobs[i].rgb = rgb;
+            jobs[i].seed = i + 1;
+        }
+        if (pass == 1)
+            nitf_ImageReader_setReadCacheSize(jobs[0].image, 1 << 18);
+
+        for (i = 0; i < NUM_THREADS; i++)
+            TEST_ASSERT(nitf_Thread_create(&threads[i], readWindows,
+                                           &jobs[i], &error));
+        for (i = 0; i < NUM_THREADS; i++)
+            nitf_Thread_join(&threads[i]);
+
+        /* Whatever mode the reads left the reader in, all bands read */
+        checkWindow(&jobs[0], 0, 0, NUM_ROWS, NUM_COLS, numBands);
+
+        nitf_ImageReader_destruct(&(jobs[0].image));
+        nitf_Record_destruct(&record);
+        nitf_Reader_destruct(&reader);
+        nitf_IOHandle_close(in);
+    }
+}
+
+TEST_CASE(testBlockInterleaved)
+{
+    readConcurrently(testName, "B", 3, 8, 0);
+}
+
+TEST_CASE(testBandSequential)
+{
+    readConcurrently(testName, "S", 2, 16, 0);
+}
+
+TEST_CASE(testPackedRGB)
+{
+    readConcurrently(testName, "P", 3, 8, 1);
+}
+
+int main(int argc, char **argv)
+{
+    CHECK(testBlockInterleaved);
+    CHECK(testBandSequential);
+    CHECK(testPackedRGB);
+    remove(TEST_FILE_NAME);
+    return 0;
+}
@@ -0,0 +1,418 @@
+/* =========================================================================
+ * This file is part of NITRO
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2010, General Dynamics - Advanced Information Systems
+ *
+ * NITRO is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <import/nitf.h>
+#include "Test.h"
+
+#define TEST_FILE_NAME "test_decode_into.ntf"
+#define MAX_BANDS 3
+#define POISON 0xA5
+
+/*
+ *  The test decompressor reads uncompressed blocks, so an image written
+ *  as "NC" is read through the decompression path
+ */
+typedef struct _TestDecoder
+{
+    nitf_IOInterface *io;
+    nitf_Uint64 offset;
+    nitf_BlockingInfo *blockInfo;
+    nitf_Uint64 *blockMask;
+} TestDecoder;
+
+/* Calls made by the library */
+static struct
+{
+    nitf_Mutex lock;
+    nitf_Uint32 readBlock;
+    nitf_Uint32 readBlockInto;
+    nitf_Uint32 freeBlock;
+}
+calls;
+
+/* Read modes */
+typedef enum
+{
+    READ_PLAIN,
+    READ_CACHED,
+    READ_THREADS
+}
+ReadMode;
+
+static nitf_Uint8 pixel(nitf_Uint32 band, nitf_Uint32 row, nitf_Uint32 col)
+{
+    return (nitf_Uint8) (band * 97 + row * 7 + col * 3 + (row * col) % 13);
+}
+
+static void countCall(nitf_Uint32 *counter)
+{
+    nitf_Mutex_lock(&calls.lock);
+    (*counter)++;
+    nitf_Mutex_unlock(&calls.lock);
+}
+
+static nitf_DecompressionControl *decoderOpen(nitf_IOInterface *io,
+                                              nitf_Uint64 offset,
+                                              nitf_Uint64 fileLength,
+                                              nitf_BlockingInfo *blockInfo,
+                                              nitf_Uint64 *blockMask,
+                                              nitf_Error *error)
+{
+    TestDecoder *decoder;
+
+    (void) fileLength;
+    decoder = (TestDecoder *) NITF_MALLOC(sizeof(TestDecoder));
+    if (!decoder)
+    {
+        nitf_Error_init(error, NITF_STRERROR(NITF_ERRNO), NITF_CTXT,
+                        NITF_ERR_MEMORY);
+        return NULL;
+    }
+    decoder->io = io;
+    decoder->offset = offset;
+    decoder->blockInfo = blockInfo;
+    decoder->blockMask = blockMask;
+    return (nitf_DecompressionControl *) decoder;
+}
+
+/*
+ *  Every buffer is filled with garbage over its full size before the
+ *  block is decoded, so stale contents and short sizes show up
+ */
+static NITF_BOOL decoderReadBlockInto(nitf_DecompressionControl *control,
+                                      nitf_Uint32 blockNumber,
+                                      nitf_Uint8 *buffer, size_t size,
+                                      nitf_Error *error)
+{
+    TestDecoder *decoder = (TestDecoder *) control;
+
+    countCall(&calls.readBlockInto);
+    memset(buffer, POISON, size);
+    if (size < decoder->blockInfo->length)
+    {
+        nitf_Error_init(error, "Block buffer too small", NITF_CTXT,
+                        NITF_ERR_INVALID_PARAMETER);
+        return NITF_FAILURE;
+    }
+    return nitf_IOInterface_readAt(decoder->io,
+                                   (nitf_Off) (decoder->offset +
+                                               decoder->blockMask
+                                               [blockNumber]),
+                                   (char *) buffer,
+                                   decoder->blockInfo->length, error);
+}
+
+static nitf_Uint8 *decoderReadBlock(nitf_DecompressionControl *control,
+                                    nitf_Uint32 blockNumber,
+                                    nitf_Error *error)
+{
+    TestDecoder *decoder = (TestDecoder *) control;
+    size_t length = decoder->blockInfo->length;
+    nitf_Uint8 *block;
+
+    countCall(&calls.readBlock);
+    block = (nitf_Uint8 *) NITF_MALLOC(length);
+    if (!block)
+    {
+        nitf_Error_init(error, NITF_STRERROR(NITF_ERRNO), NITF_CTXT,
+                        NITF_ERR_MEMORY);
+        return NULL;
+    }
+    if (!nitf_IOInterface_readAt(decoder->io,
+                                 (nitf_Off) (decoder->offset +
+                                             decoder->blockMask[blockNumber]),
+                                 (char *) block, length, error))
+    {
+        NITF_FREE(block);
+        return NULL;
+    }
+    return block;
+}
+
+static NITF_BOOL decoderFreeBlock(nitf_DecompressionControl *control,
+                                  nitf_Uint8 *block, nitf_Error *error)
+{
+    (void) control;
+    (void) error;
+    countCall(&calls.freeBlock);
+    NITF_FREE(block);
+    return NITF_SUCCESS;
+}
+
+static void decoderDestroy(nitf_DecompressionControl **control)
+{
+    NITF_FREE(*control);
+    *control = NULL;
+}
+
+/*
+ *  Write a B mode, 8-bit image. Edge blocks are partial, so the pad
+ *  pixels are decoded as well.
+ */
+static void writeImage(const char *testName, nitf_Uint32 numBands,
+                       nitf_Uint32 numRows, nitf_Uint32 numCols,
+                       nitf_Uint32 numRowsPerBlock,
+                       nitf_Uint32 numColsPerBlock)
+{
+    nitf_Error error;
+    nitf_Record *record;
+    nitf_ImageSegment *segment;
+    nitf_BandInfo **bands;
+    nitf_Writer *writer;
+    nitf_ImageWriter *imageWriter;
+    nitf_ImageSource *source;
+    nitf_IOHandle out;
+    nitf_Uint8 *data[MAX_BANDS];
+    nitf_Uint32 band, row, col;
+
+    record = nitf_Record_construct(NITF_VER_21, &error);
+    TEST_ASSERT(record);
+    segment = nitf_Record_newImageSegment(record, &error);
+    TEST_ASSERT(segment);
+    bands = (nitf_BandInfo **) NITF_MALLOC(sizeof(nitf_BandInfo *)
+                                           * numBands);
+    TEST_ASSERT(bands);
+    for (band = 0; band < numBands; band++)
+    {
+        bands[band] = nitf_BandInfo_construct(&error);
+        TEST_ASSERT(bands[band]);
+        TEST_ASSERT(nitf_BandInfo_init(bands[band], "M", " ", "N", "   ",
+                                       0, 0, NULL, &error));
+    }
+    TEST_ASSERT(nitf_ImageSubheader_setPixelInformation(segment->subheader,
+                                                        "INT", 8, 8, "R",
+                                                        numBands == 1 ?
+                                                        "MONO" : "MULTI",
+                                                        "VIS", numBands,
+                                                        bands, &error));
+    TEST_ASSERT(nitf_ImageSubheader_setBlocking(segment->subheader,
+                                                numRows, numCols,
+                                                numRowsPerBlock,
+                                                numColsPerBlock, "B",
+                                                &error));
+
+    out = nitf_IOHandle_create(TEST_FILE_NAME, NITF_ACCESS_WRITEONLY,
+                               NITF_CREATE, &error);
+    TEST_ASSERT(!NITF_INVALID_HANDLE(out));
+    writer = nitf_Writer_construct(&error);
+    TEST_ASSERT(writer);
+    TEST_ASSERT(nitf_Writer_prepare(writer, record, out, &error));
+    imageWriter = nitf_Writer_newImageWriter(writer, 0, &error);
+    TEST_ASSERT(imageWriter);
+
+    source = nitf_ImageSource_construct(&error);
+    TEST_ASSERT(source);
+    for (band = 0; band < numBands; band++)
+    {
+        nitf_BandSource *bandSource;
+
+        data[band] = (nitf_Uint8 *) NITF_MALLOC(numRows * numCols);
+        TEST_ASSERT(data[band]);
+        for (row = 0; row < numRows; row++)
+            for (col = 0; col < numCols; col++)
+                data[band][row * numCols + col] = pixel(band, row, col);
+        bandSource = nitf_MemorySource_construct((char *) data[band],
+                                                 numRows * numCols, 0, 1, 0,
+                                                 &error);
+        TEST_ASSERT(bandSource);
+        TEST_ASSERT(nitf_ImageSource_addBand(source, bandSource, &error));
+    }
+    TEST_ASSERT(nitf_ImageWriter_attachSource(imageWriter, source, &error));
+    TEST_ASSERT(nitf_Writer_write(writer, &error));
+
+    nitf_IOHandle_close(out);
+    nitf_Writer_destruct(&writer);
+    nitf_Record_destruct(&record);
+    for (band = 0; band < numBands; band++)
+        NITF_FREE(data[band]);
+}
+
+static void checkWindow(const char *testName, nitf_ImageIO *image,
+                        nitf_IOInterface *io, nitf_Uint32 numBands,
+                        nitf_Uint32 startRow, nitf_Uint32 startCol,
+                        nitf_Uint32 numRows, nitf_Uint32 numCols)
+{
+    nitf_Error error;
+    nitf_SubWindow window;
+    nitf_Uint32 bandList[MAX_BANDS] = { 0, 1, 2 };
+    nitf_Uint8 *buffers[MAX_BANDS];
+    nitf_Uint32 band, row, col;
+    int padded;
+
+    memset(&window, 0, sizeof(window));
+    window.startRow = startRow;
+    window.startCol = startCol;
+    window.numRows = numRows;
+    window.numCols = numCols;
+    window.bandList = bandList;
+    window.numBands = numBands;
+
+    for (band = 0; band < numBands; band++)
+    {
+        buffers[band] = (nitf_Uint8 *) NITF_MALLOC(numRows * numCols);
+        TEST_ASSERT(buffers[band]);
+    }
+    TEST_ASSERT(nitf_ImageIO_read(image, io, &window, buffers, &padded,
+                                  &error));
+    for (band = 0; band < numBands; band++)
+    {
+        for (row = 0; row < numRows; row++)
+            for (col = 0; col < numCols; col++)
+                TEST_ASSERT_EQ_INT(buffers[band][row * numCols + col],
+                                   pixel(band, startRow + row,
+                                         startCol + col));
+        NITF_FREE(buffers[band]);
+    }
+}
+
+/*
+ *  Read the image through the test decompressor with the given flags and
+ *  count the calls. With NITF_DECOMPRESSION_READ_BLOCK_INTO only
+ *  readBlockInto may be used, without it only readBlock and freeBlock.
+ */
+static void readImage(const char *testName, nitf_Uint32 numBands,
+                      nitf_Uint32 numRows, nitf_Uint32 numCols,
+                      size_t blockBytes, nitf_Uint32 flags, ReadMode mode)
+{
+    nitf_Error error;
+    nitf_IOInterface *io;
+    nitf_Reader *reader;
+    nitf_Record *record;
+    nitf_ImageSegment *segment;
+    nitf_DecompressionInterface iface;
+    nitf_ImageIO *image;
+    int pass;
+
+    io = nitf_IOHandleAdapter_open(TEST_FILE_NAME, NITF_ACCESS_READONLY,
+                                   NITF_OPEN_EXISTING, &error);
+    TEST_ASSERT(io);
+    reader = nitf_Reader_construct(&error);
+    TEST_ASSERT(reader);
+    record = nitf_Reader_readIO(reader, io, &error);
+    TEST_ASSERT(record);
+
+    /* Marked compressed so the decompressor is used */
+    segment = (nitf_ImageSegment *) record->images->first->data;
+    TEST_ASSERT(nitf_Field_setString(segment->subheader->imageCompression,
+                                     "C8", &error));
+    memset(&iface, 0, sizeof(iface));
+    iface.open = decoderOpen;
+    iface.readBlock = decoderReadBlock;
+    iface.freeBlock = decoderFreeBlock;
+    iface.destroyControl = decoderDestroy;
+    iface.readBlockInto = decoderReadBlockInto;
+    iface.flags = flags;
+    image = nitf_ImageIO_construct(segment->subheader, segment->imageOffset,
+                                   segment->imageEnd - segment->imageOffset,
+                                   NULL, &iface, &error);
+    TEST_ASSERT(image);
+    if (mode != READ_PLAIN)
+        nitf_ImageIO_setReadCacheSize(image, 4 * blockBytes);
+    if (mode == READ_THREADS)
+        nitf_ImageIO_setDecodeThreads(image, 4);
+
+    calls.readBlock = 0;
+    calls.readBlockInto = 0;
+    calls.freeBlock = 0;
+
+    /* Twice, so cached reads reuse evicted buffers */
+    for (pass = 0; pass < 2; pass++)
+    {
+        checkWindow(testName, image, io, numBands, 0, 0, numRows, numCols);
+        checkWindow(testName, image, io, numBands, numRows / 3,
+                    numCols / 3, numRows / 3, numCols / 3);
+        checkWindow(testName, image, io, numBands, numRows - 5,
+                    numCols - 7, 5, 7);
+    }
+    nitf_ImageIO_destruct(&image);
+
+    if (flags & NITF_DECOMPRESSION_READ_BLOCK_INTO)
+    {
+        TEST_ASSERT(calls.readBlockInto > 0);
+        TEST_ASSERT_EQ_INT(calls.readBlock, 0);
+        TEST_ASSERT_EQ_INT(calls.freeBlock, 0);
+    }
+    else
+    {
+        TEST_ASSERT_EQ_INT(calls.readBlockInto, 0);
+        TEST_ASSERT(calls.readBlock > 0);
+        TEST_ASSERT_EQ_INT(calls.freeBlock, calls.readBlock);
+    }
+
+    nitf_Record_destruct(&record);
+    nitf_Reader_destruct(&reader);
+    nitf_IOInterface_close(io, &error);
+    nitf_IOInterface_destruct(&io);
+}
+
+static void readAllModes(const char *testName, nitf_Uint32 numBands,
+                         nitf_Uint32 numRows, nitf_Uint32 numCols,
+                         size_t blockBytes, nitf_Uint32 flags)
+{
+    readImage(testName, numBands, numRows, numCols, blockBytes, flags,
+              READ_PLAIN);
+    readImage(testName, numBands, numRows, numCols, blockBytes, flags,
+              READ_CACHED);
+    readImage(testName, numBands, numRows, numCols, blockBytes, flags,
+              READ_THREADS);
+}
+
+TEST_CASE(testReadBlockInto)
+{
+    writeImage(testName, 3, 300, 260, 32, 48);
+    readAllModes(testName, 3, 300, 260, 3 * 32 * 48,
+                 NITF_DECOMPRESSION_READ_BLOCK_INTO |
+                 NITF_DECOMPRESSION_CONCURRENT_READ_BLOCK);
+    readAllModes(testName, 3, 300, 260, 3 * 32 * 48,
+                 NITF_DECOMPRESSION_READ_BLOCK_INTO);
+
+    writeImage(testName, 1, 150, 170, 64, 64);
+    readAllModes(testName, 1, 150, 170, 64 * 64,
+                 NITF_DECOMPRESSION_READ_BLOCK_INTO |
+                 NITF_DECOMPRESSION_CONCURRENT_READ_BLOCK);
+    readAllModes(testName, 1, 150, 170, 64 * 64,
+                 NITF_DECOMPRESSION_READ_BLOCK_INTO);
+}
+
+TEST_CASE(testReadBlock)
+{
+    /* Without the flag, the readBlockInto entry is never used */
+    writeImage(testName, 3, 300, 260, 32, 48);
+    readAllModes(testName, 3, 300, 260, 3 * 32 * 48,
+                 NITF_DECOMPRESSION_CONCURRENT_READ_BLOCK);
+    readAllModes(testName, 3, 300, 260, 3 * 32 * 48, 0);
+
+    writeImage(testName, 1, 150, 170, 64, 64);
+    readAllModes(testName, 1, 150, 170, 64 * 64,
+                 NITF_DECOMPRESSION_CONCURRENT_READ_BLOCK);
+    readAllModes(testName, 1, 150, 170, 64 * 64, 0);
+}
+
+int main(int argc, char **argv)
+{
+    nitf_Mutex_init(&calls.lock);
+    CHECK(testReadBlockInto);
+    CHECK(testReadBlock);
+    nitf_Mutex_delete(&calls.lock);
+    remove(TEST_FILE_NAME);
+    return 0;
+}
@@ -0,0 +1,470 @@
+/* =========================================================================
+ * This file is part of NITRO
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2010, General Dynamics - Advanced Information Systems
+ *
+ * NITRO is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <import/nitf.h>
+#include "Test.h"
+
+#define TEST_FILE_NAME "test_decode_threads.ntf"
+#define NUM_ROWS 300
+#define NUM_COLS 260
+#define MAX_BANDS 3
+
+/*
+ *  The test decompressor reads uncompressed blocks, so an image written
+ *  as "NC" is read through the decompression path
+ */
+typedef struct _TestDecoder
+{
+    nitf_IOInterface *io;
+    nitf_Uint64 offset;
+    nitf_BlockingInfo *blockInfo;
+    nitf_Uint64 *blockMask;
+} TestDecoder;
+
+static nitf_Mutex decodeLock;
+static nitf_Uint32 numDecoded;
+
+static nitf_Uint32 pixel(nitf_Uint32 numBits, nitf_Uint32 band,
+                         nitf_Uint32 row, nitf_Uint32 col)
+{
+    nitf_Uint32 value = band * 97 + row * 7 + col * 3 + (row * col) % 13;
+
+    if (numBits == 1)
+        return (row / 3 + col / 5 + (row * col) % 7) & 1;
+    return (value ^ (row << 6)) & ((1 << numBits) - 1);
+}
+
+static nitf_DecompressionControl *decoderOpen(nitf_IOInterface *io,
+                                              nitf_Uint64 offset,
+                                              nitf_Uint64 fileLength,
+                                              nitf_BlockingInfo *blockInfo,
+                                              nitf_Uint64 *blockMask,
+                                              nitf_Error *error)
+{
+    TestDecoder *decoder;
+
+    (void) fileLength;
+    decoder = (TestDecoder *) NITF_MALLOC(sizeof(TestDecoder));
+    if (!decoder)
+    {
+        nitf_Error_init(error, NITF_STRERROR(NITF_ERRNO), NITF_CTXT,
+                        NITF_ERR_MEMORY);
+        return NULL;
+    }
+    decoder->io = io;
+    decoder->offset = offset;
+    decoder->blockInfo = blockInfo;
+    decoder->blockMask = blockMask;
+    return (nitf_DecompressionControl *) decoder;
+}
+
+static nitf_Uint8 *decoderReadBlock(nitf_DecompressionControl *control,
+                                    nitf_Uint32 blockNumber,
+                                    nitf_Error *error)
+{
+    TestDecoder *decoder = (TestDecoder *) control;
+    size_t length = decoder->blockInfo->length;
+    nitf_Uint8 *block;
+
+    block = (nitf_Uint8 *) NITF_MALLOC(length);
+    if (!block)
+    {
+        nitf_Error_init(error, NITF_STRERROR(NITF_ERRNO), NITF_CTXT,
+                        NITF_ERR_MEMORY);
+        return NULL;
+    }
+    if (!nitf_IOInterface_readAt(decoder->io,
+                                 (nitf_Off) (decoder->offset +
+                                             decoder->blockMask[blockNumber]),
+                                 (char *) block, length, error))
+    {
+        NITF_FREE(block);
+        return NULL;
+    }
+
+    nitf_Mutex_lock(&decodeLock);
+    numDecoded++;
+    nitf_Mutex_unlock(&decodeLock);
+    return block;
+}
+
+static NITF_BOOL decoderFreeBlock(nitf_DecompressionControl *control,
+                                  nitf_Uint8 *block, nitf_Error *error)
+{
+    (void) control;
+    (void) error;
+    NITF_FREE(block);
+    return NITF_SUCCESS;
+}
+
+static void decoderDestroy(nitf_DecompressionControl **control)
+{
+    NITF_FREE(*control);
+    *control = NULL;
+}
+
+/*
+ *  Make the subheader of a B mode image of 32 by 48 blocks
+ */
+static void setImage(const char *testName, nitf_ImageSubheader *subheader,
+                     nitf_Uint32 numBands, nitf_Uint32 numBits,
+                     nitf_Uint32 numRowsPerBlock,
+                     nitf_Uint32 numColsPerBlock)
+{
+    nitf_Error error;
+    nitf_BandInfo **bands;
+    nitf_Uint32 band;
+
+    bands = (nitf_BandInfo **) NITF_MALLOC(sizeof(nitf_BandInfo *)
+                                           * numBands);
+    TEST_ASSERT(bands);
+    for (band = 0; band < numBands; band++)
+    {
+        bands[band] = nitf_BandInfo_construct(&error);
+        TEST_ASSERT(bands[band]);
+        TEST_ASSERT(nitf_BandInfo_init(bands[band], "M", " ", "N", "   ",
+                                       0, 0, NULL, &error));
+    }
+    TEST_ASSERT(nitf_ImageSubheader_setPixelInformation(subheader,
+                                                        numBits == 1 ?
+                                                        "B" : "INT",
+                                                        numBits, numBits,
+                                                        "R", numBands == 1 ?
+                                                        "MONO" : "MULTI",
+                                                        "VIS", numBands,
+                                                        bands, &error));
+    TEST_ASSERT(nitf_ImageSubheader_setBlocking(subheader, NUM_ROWS,
+                                                NUM_COLS, numRowsPerBlock,
+                                                numColsPerBlock, "B",
+                                                &error));
+}
+
+/*
+ *  Write an 8-bit image of 32 by 48 blocks
+ */
+static void writeImage(const char *testName, nitf_Uint32 numBands)
+{
+    nitf_Error error;
+    nitf_Record *record;
+    nitf_ImageSegment *segment;
+    nitf_Writer *writer;
+    nitf_ImageWriter *imageWriter;
+    nitf_ImageSource *source;
+    nitf_IOHandle out;
+    nitf_Uint8 *data[MAX_BANDS];
+    nitf_Uint32 band, row, col;
+
+    record = nitf_Record_construct(NITF_VER_21, &error);
+    TEST_ASSERT(record);
+    segment = nitf_Record_newImageSegment(record, &error);
+    TEST_ASSERT(segment);
+    setImage(testName, segment->subheader, numBands, 8, 32, 48);
+
+    out = nitf_IOHandle_create(TEST_FILE_NAME, NITF_ACCESS_WRITEONLY,
+                               NITF_CREATE, &error);
+    TEST_ASSERT(!NITF_INVALID_HANDLE(out));
+    writer = nitf_Writer_construct(&error);
+    TEST_ASSERT(writer);
+    TEST_ASSERT(nitf_Writer_prepare(writer, record, out, &error));
+    imageWriter = nitf_Writer_newImageWriter(writer, 0, &error);
+    TEST_ASSERT(imageWriter);
+
+    source = nitf_ImageSource_construct(&error);
+    TEST_ASSERT(source);
+    for (band = 0; band < numBands; band++)
+    {
+        nitf_BandSource *bandSource;
+
+        data[band] = (nitf_Uint8 *) NITF_MALLOC(NUM_ROWS * NUM_COLS);
+        TEST_ASSERT(data[band]);
+        for (row = 0; row < NUM_ROWS; row++)
+            for (col = 0; col < NUM_COLS; col++)
+                data[band][row * NUM_COLS + col] =
+                    (nitf_Uint8) pixel(8, band, row, col);
+        bandSource = nitf_MemorySource_construct((char *) data[band],
+                                                 NUM_ROWS * NUM_COLS,
+                                                 0, 1, 0, &error);
+        TEST_ASSERT(bandSource);
+        TEST_ASSERT(nitf_ImageSource_addBand(source, bandSource, &error));
+    }
+    TEST_ASSERT(nitf_ImageWriter_attachSource(imageWriter, source, &error));
+    TEST_ASSERT(nitf_Writer_write(writer, &error));
+
+    nitf_IOHandle_close(out);
+    nitf_Writer_destruct(&writer);
+    nitf_Record_destruct(&record);
+    for (band = 0; band < numBands; band++)
+        NITF_FREE(data[band]);
+}
+
+/*
+ *  Read a window of all bands and compare it with the pattern
+ */
+static void checkWindow(const char *testName, nitf_ImageIO *image,
+                        nitf_IOInterface *io, nitf_Uint32 numBands,
+                        nitf_Uint32 numBits, nitf_Uint32 startRow,
+                        nitf_Uint32 startCol, nitf_Uint32 numRows,
+                        nitf_Uint32 numCols)
+{
+    nitf_Error error;
+    nitf_SubWindow window;
+    nitf_Uint32 bandList[MAX_BANDS] = { 0, 1, 2 };
+    nitf_Uint8 *buffers[MAX_BANDS];
+    nitf_Uint32 bytes = (numBits + 7) / 8;
+    nitf_Uint32 band, row, col;
+    int padded;
+
+    memset(&window, 0, sizeof(window));
+    window.startRow = startRow;
+    window.startCol = startCol;
+    window.numRows = numRows;
+    window.numCols = numCols;
+    window.bandList = bandList;
+    window.numBands = numBands;
+
+    for (band = 0; band < numBands; band++)
+    {
+        buffers[band] = (nitf_Uint8 *) NITF_MALLOC(numRows * numCols * bytes);
+        TEST_ASSERT(buffers[band]);
+    }
+    TEST_ASSERT(nitf_ImageIO_read(image, io, &window, buffers, &padded,
+                                  &error));
+    for (band = 0; band < numBands; band++)
+    {
+        for (row = 0; row < numRows; row++)
+            for (col = 0; col < numCols; col++)
+            {
+                size_t n = (size_t) row * numCols + col;
+                nitf_Uint32 got = bytes == 1 ? buffers[band][n] :
+                    ((nitf_Uint16 *) buffers[band])[n];
+
+                TEST_ASSERT_EQ_INT(got, pixel(numBits, band, startRow + row,
+                                              startCol + col));
+            }
+        NITF_FREE(buffers[band]);
+    }
+}
+
+/*
+ *  Read the whole image and windows that start and end inside blocks with
+ *  four decode threads and room for six blocks, so reads are decoded in
+ *  several batches
+ */
+static void checkImage(const char *testName, nitf_ImageIO *image,
+                       nitf_IOInterface *io, nitf_Uint32 numBands,
+                       nitf_Uint32 numBits, size_t blockBytes)
+{
+    nitf_ImageIO_setReadCacheSize(image, 6 * blockBytes);
+    nitf_ImageIO_setDecodeThreads(image, 4);
+
+    checkWindow(testName, image, io, numBands, numBits,
+                0, 0, NUM_ROWS, NUM_COLS);
+    checkWindow(testName, image, io, numBands, numBits, 40, 30, 150, 170);
+    checkWindow(testName, image, io, numBands, numBits,
+                NUM_ROWS - 5, NUM_COLS - 7, 5, 7);
+    checkWindow(testName, image, io, numBands, numBits, 29, 45, 6, 6);
+}
+
+TEST_CASE(testDecompressor)
+{
+    nitf_Error error;
+    nitf_IOInterface *io;
+    nitf_Reader *reader;
+    nitf_Record *record;
+    nitf_ImageSegment *segment;
+    nitf_DecompressionInterface iface;
+    nitf_ImageIO *image;
+
+    writeImage(testName, 3);
+    io = nitf_IOHandleAdapter_open(TEST_FILE_NAME, NITF_ACCESS_READONLY,
+                                   NITF_OPEN_EXISTING, &error);
+    TEST_ASSERT(io);
+    reader = nitf_Reader_construct(&error);
+    TEST_ASSERT(reader);
+    record = nitf_Reader_readIO(reader, io, &error);
+    TEST_ASSERT(record);
+
+    /* Marked compressed so the decompressor is used */
+    segment = (nitf_ImageSegment *) record->images->first->data;
+    TEST_ASSERT(nitf_Field_setString(segment->subheader->imageCompression,
+                                     "C8", &error));
+
+    memset(&iface, 0, sizeof(iface));
+    iface.open = decoderOpen;
+    iface.readBlock = decoderReadBlock;
+    iface.freeBlock = decoderFreeBlock;
+    iface.destroyControl = decoderDestroy;
+    iface.flags = NITF_DECOMPRESSION_CONCURRENT_READ_BLOCK;
+    image = nitf_ImageIO_construct(segment->subheader, segment->imageOffset,
+                                   segment->imageEnd - segment->imageOffset,
+                                   NULL, &iface, &error);
+    TEST_ASSERT(image);
+
+    nitf_Mutex_init(&decodeLock);
+    numDecoded = 0;
+    checkImage(testName, image, io, 3, 8, 32 * 48);
+    TEST_ASSERT(numDecoded > 0);
+    nitf_Mutex_delete(&decodeLock);
+
+    nitf_ImageIO_destruct(&image);
+    nitf_Record_destruct(&record);
+    nitf_Reader_destruct(&reader);
+    nitf_IOInterface_close(io, &error);
+    nitf_IOInterface_destruct(&io);
+}
+
+TEST_CASE(test12Bit)
+{
+    nitf_Error error;
+    nitf_ImageSubheader *subheader;
+    nitf_IOHandle out;
+    nitf_IOInterface *io;
+    nitf_ImageIO *image;
+    nitf_Uint8 block[32 * 48 * 3 / 2];
+    nitf_Uint32 band, blockRow, blockCol, row, col;
+
+    /*
+     *  The 12-bit pixel decoder expands blocks in place. The blocks are
+     *  written raw, two pixels in three bytes and the bands of a block one
+     *  after the other, so the test does not depend on the 12-bit write
+     *  path.
+     */
+    subheader = nitf_ImageSubheader_construct(&error);
+    TEST_ASSERT(subheader);
+    setImage(testName, subheader, 2, 12, 32, 48);
+    TEST_ASSERT(nitf_Field_setString(subheader->imageCompression, "NC",
+                                     &error));
+
+    out = nitf_IOHandle_create(TEST_FILE_NAME, NITF_ACCESS_WRITEONLY,
+                               NITF_CREATE, &error);
+    TEST_ASSERT(!NITF_INVALID_HANDLE(out));
+    for (blockRow = 0; blockRow < (NUM_ROWS + 31) / 32; blockRow++)
+        for (blockCol = 0; blockCol < (NUM_COLS + 47) / 48; blockCol++)
+            for (band = 0; band < 2; band++)
+            {
+                for (row = 0; row < 32; row++)
+                    for (col = 0; col < 48; col += 2)
+                    {
+                        nitf_Uint32 imageRow = blockRow * 32 + row;
+                        nitf_Uint32 imageCol = blockCol * 48 + col;
+                        nitf_Uint8 *packed = block + (row * 48 + col) * 3 / 2;
+                        nitf_Uint32 first = 0;
+                        nitf_Uint32 second = 0;
+
+                        if (imageRow < NUM_ROWS && imageCol < NUM_COLS)
+                            first = pixel(12, band, imageRow, imageCol);
+                        if (imageRow < NUM_ROWS && imageCol + 1 < NUM_COLS)
+                            second = pixel(12, band, imageRow, imageCol + 1);
+                        packed[0] = (nitf_Uint8) (first >> 4);
+                        packed[1] = (nitf_Uint8) (((first & 0xf) << 4)
+                                                  | (second >> 8));
+                        packed[2] = (nitf_Uint8) (second & 0xff);
+                    }
+                TEST_ASSERT(nitf_IOHandle_write(out, (const char *) block,
+                                                sizeof(block), &error));
+            }
+    nitf_IOHandle_close(out);
+
+    io = nitf_IOHandleAdapter_open(TEST_FILE_NAME, NITF_ACCESS_READONLY,
+                                   NITF_OPEN_EXISTING, &error);
+    TEST_ASSERT(io);
+    image = nitf_ImageIO_construct(subheader, 0,
+                                   (nitf_Uint64) nitf_IOInterface_getSize(io,
+                                                                          &error),
+                                   NULL, NULL, &error);
+    TEST_ASSERT(image);
+    checkImage(testName, image, io, 2, 12, 32 * 48 * 2);
+
+    nitf_ImageIO_destruct(&image);
+    nitf_ImageSubheader_destruct(&subheader);
+    nitf_IOInterface_close(io, &error);
+    nitf_IOInterface_destruct(&io);
+}
+
+TEST_CASE(test1Bit)
+{
+    nitf_Error error;
+    nitf_ImageSubheader *subheader;
+    nitf_IOHandle out;
+    nitf_IOInterface *io;
+    nitf_ImageIO *image;
+    nitf_Uint8 block[(37 * 45 + 7) / 8];
+    nitf_Uint32 blockRow, blockCol, row, col;
+
+    /*
+     *  ImageWriter does not pack 1-bit pixels, so the image data is
+     *  written as raw blocks, most significant bit first. The block sizes
+     *  are odd so blocks do not end on byte boundaries.
+     */
+    subheader = nitf_ImageSubheader_construct(&error);
+    TEST_ASSERT(subheader);
+    setImage(testName, subheader, 1, 1, 37, 45);
+    TEST_ASSERT(nitf_Field_setString(subheader->imageCompression, "NC",
+                                     &error));
+
+    out = nitf_IOHandle_create(TEST_FILE_NAME, NITF_ACCESS_WRITEONLY,
+                               NITF_CREATE, &error);
+    TEST_ASSERT(!NITF_INVALID_HANDLE(out));
+    for (blockRow = 0; blockRow < (NUM_ROWS + 36) / 37; blockRow++)
+        for (blockCol = 0; blockCol < (NUM_COLS + 44) / 45; blockCol++)
+        {
+            memset(block, 0, sizeof(block));
+            for (row = 0; row < 37; row++)
+                for (col = 0; col < 45; col++)
+                {
+                    nitf_Uint32 i = row * 45 + col;
+                    nitf_Uint32 imageRow = blockRow * 37 + row;
+                    nitf_Uint32 imageCol = blockCol * 45 + col;
+
+                    if (imageRow < NUM_ROWS && imageCol < NUM_COLS &&
+                        pixel(1, 0, imageRow, imageCol))
+                        block[i / 8] |= (nitf_Uint8) (0x80 >> (i % 8));
+                }
+            TEST_ASSERT(nitf_IOHandle_write(out, (const char *) block,
+                                            sizeof(block), &error));
+        }
+    nitf_IOHandle_close(out);
+
+    io = nitf_IOHandleAdapter_open(TEST_FILE_NAME, NITF_ACCESS_READONLY,
+                                   NITF_OPEN_EXISTING, &error);
+    TEST_ASSERT(io);
+    image = nitf_ImageIO_construct(subheader, 0,
+                                   (nitf_Uint64) nitf_IOInterface_getSize(io,
+                                                                          &error),
+                                   NULL, NULL, &error);
+    TEST_ASSERT(image);
+    checkImage(testName, image, io, 1, 1, 37 * 45);
+
+    nitf_ImageIO_destruct(&image);
+    nitf_ImageSubheader_destruct(&subheader);
+    nitf_IOInterface_close(io, &error);
+    nitf_IOInterface_destruct(&io);
+}
+
+int main(int argc, char **argv)
+{
+    CHECK(testDecompressor);
+    CHECK(test12Bit);
+    CHECK(test1Bit);
+    remove(TEST_FILE_NAME);
+    return 0;
+}
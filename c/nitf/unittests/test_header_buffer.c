@@ -0,0 +1,336 @@
+/* =========================================================================
+ * This file is part of NITRO
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2010, General Dynamics - Advanced Information Systems
+ *
+ * NITRO is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <import/nitf.h>
+#include "Test.h"
+
+#define TEST_FILE_NAME "test_header_buffer.ntf"
+#define FILE_TITLE "Buffered header test"
+#define TEXT "Text segment data, which follows the image data in the file."
+#define NUM_ROWS 150
+#define NUM_COLS 130
+
+/*
+ *  TREs written and their sizes. The ones bigger than the header buffer
+ *  are read around it.
+ */
+static const struct
+{
+    const char *tag;
+    size_t length;
+}
+tres[] =
+{
+    { "TSTBIG", 20000 },    /* File header user defined data */
+    { "TSTHDR", 300 },      /* File header extended data */
+    { "TSTIMG", 100 },      /* Image 0 user defined data */
+    { "TSTTWO", 17000 }     /* Image 1 extended data */
+};
+
+static nitf_Uint8 pixel(nitf_Uint32 image, nitf_Uint32 row, nitf_Uint32 col)
+{
+    return (nitf_Uint8) (image * 97 + row * 7 + col * 3 + (row * col) % 13);
+}
+
+static char treByte(const char *tag, size_t i)
+{
+    return (char) ('A' + (i * 7 + (unsigned char) tag[0]) % 26);
+}
+
+/*
+ *  Append a TRE with no handler, which is written and read back as raw
+ *  data
+ */
+static void appendTRE(const char *testName, nitf_Extensions *ext,
+                      const char *tag, size_t length)
+{
+    nitf_Error error;
+    nitf_TRE *tre;
+    char *data;
+    size_t i;
+
+    data = (char *) NITF_MALLOC(length);
+    TEST_ASSERT(data);
+    for (i = 0; i < length; i++)
+        data[i] = treByte(tag, i);
+    tre = nitf_TRE_construct(tag, NITF_TRE_RAW, &error);
+    TEST_ASSERT(tre);
+    TEST_ASSERT(nitf_TRE_setField(tre, NITF_TRE_RAW, data, length, &error));
+    TEST_ASSERT(nitf_Extensions_appendTRE(ext, tre, &error));
+    NITF_FREE(data);
+}
+
+static void checkTRE(const char *testName, nitf_Extensions *ext,
+                     const char *tag, size_t length)
+{
+    nitf_List *list = nitf_Extensions_getTREsByName(ext, tag);
+    nitf_Field *field;
+    size_t i;
+
+    TEST_ASSERT(list && !nitf_List_isEmpty(list));
+    field = nitf_TRE_getField((nitf_TRE *) list->first->data, NITF_TRE_RAW);
+    TEST_ASSERT(field);
+    TEST_ASSERT_EQ_INT(field->length, length);
+    for (i = 0; i < length; i++)
+        TEST_ASSERT_EQ_INT(field->raw[i], treByte(tag, i));
+}
+
+static nitf_ImageSegment *getImage(nitf_Record *record, int index)
+{
+    nitf_ListIterator iter = nitf_List_begin(record->images);
+
+    while (index-- > 0)
+        nitf_ListIterator_increment(&iter);
+    return (nitf_ImageSegment *) nitf_ListIterator_get(&iter);
+}
+
+/*
+ *  Add a one band, 8-bit image segment of 64 by 48 blocks
+ */
+static void addImage(const char *testName, nitf_Record *record,
+                     const char *imageId)
+{
+    nitf_Error error;
+    nitf_ImageSegment *segment;
+    nitf_BandInfo **bands;
+
+    segment = nitf_Record_newImageSegment(record, &error);
+    TEST_ASSERT(segment);
+    bands = (nitf_BandInfo **) NITF_MALLOC(sizeof(nitf_BandInfo *));
+    TEST_ASSERT(bands);
+    bands[0] = nitf_BandInfo_construct(&error);
+    TEST_ASSERT(bands[0]);
+    TEST_ASSERT(nitf_BandInfo_init(bands[0], "M", " ", "N", "   ",
+                                   0, 0, NULL, &error));
+    TEST_ASSERT(nitf_ImageSubheader_setPixelInformation(segment->subheader,
+                                                        "INT", 8, 8, "R",
+                                                        "MONO", "VIS", 1,
+                                                        bands, &error));
+    TEST_ASSERT(nitf_ImageSubheader_setBlocking(segment->subheader,
+                                                NUM_ROWS, NUM_COLS, 64, 48,
+                                                "B", &error));
+    TEST_ASSERT(nitf_Field_setString(segment->subheader->imageId, imageId,
+                                     &error));
+}
+
+/*
+ *  Write two images and a text segment, with TREs in the file header and
+ *  the image subheaders
+ */
+static void writeFile(const char *testName)
+{
+    nitf_Error error;
+    nitf_Record *record;
+    nitf_Writer *writer;
+    nitf_IOHandle out;
+    static nitf_Uint8 data[2][NUM_ROWS * NUM_COLS];
+    nitf_Uint32 image, row, col;
+
+    record = nitf_Record_construct(NITF_VER_21, &error);
+    TEST_ASSERT(record);
+    TEST_ASSERT(nitf_Field_setString(record->header->fileTitle, FILE_TITLE,
+                                     &error));
+    addImage(testName, record, "FIRST");
+    addImage(testName, record, "SECOND");
+    TEST_ASSERT(nitf_Record_newTextSegment(record, &error));
+
+    appendTRE(testName, record->header->userDefinedSection,
+              tres[0].tag, tres[0].length);
+    appendTRE(testName, record->header->extendedSection,
+              tres[1].tag, tres[1].length);
+    appendTRE(testName, getImage(record, 0)->subheader->userDefinedSection,
+              tres[2].tag, tres[2].length);
+    appendTRE(testName, getImage(record, 1)->subheader->extendedSection,
+              tres[3].tag, tres[3].length);
+
+    out = nitf_IOHandle_create(TEST_FILE_NAME, NITF_ACCESS_WRITEONLY,
+                               NITF_CREATE, &error);
+    TEST_ASSERT(!NITF_INVALID_HANDLE(out));
+    writer = nitf_Writer_construct(&error);
+    TEST_ASSERT(writer);
+    TEST_ASSERT(nitf_Writer_prepare(writer, record, out, &error));
+
+    for (image = 0; image < 2; image++)
+    {
+        nitf_ImageWriter *imageWriter;
+        nitf_ImageSource *source;
+        nitf_BandSource *bandSource;
+
+        for (row = 0; row < NUM_ROWS; row++)
+            for (col = 0; col < NUM_COLS; col++)
+                data[image][row * NUM_COLS + col] = pixel(image, row, col);
+        imageWriter = nitf_Writer_newImageWriter(writer, image, &error);
+        TEST_ASSERT(imageWriter);
+        source = nitf_ImageSource_construct(&error);
+        TEST_ASSERT(source);
+        bandSource = nitf_MemorySource_construct((char *) data[image],
+                                                 NUM_ROWS * NUM_COLS, 0, 1,
+                                                 0, &error);
+        TEST_ASSERT(bandSource);
+        TEST_ASSERT(nitf_ImageSource_addBand(source, bandSource, &error));
+        TEST_ASSERT(nitf_ImageWriter_attachSource(imageWriter, source,
+                                                  &error));
+    }
+    {
+        nitf_SegmentWriter *textWriter;
+        nitf_SegmentSource *source;
+
+        textWriter = nitf_Writer_newTextWriter(writer, 0, &error);
+        TEST_ASSERT(textWriter);
+        source = nitf_SegmentMemorySource_construct(TEXT, strlen(TEXT),
+                                                    0, 0, 0, &error);
+        TEST_ASSERT(source);
+        TEST_ASSERT(nitf_SegmentWriter_attachSource(textWriter, source,
+                                                    &error));
+    }
+    TEST_ASSERT(nitf_Writer_write(writer, &error));
+
+    nitf_IOHandle_close(out);
+    nitf_Writer_destruct(&writer);
+    nitf_Record_destruct(&record);
+}
+
+/*
+ *  Read the file through an interface and check the header fields, the
+ *  TREs, the text and the pixels of both images
+ */
+static void checkFile(const char *testName, nitf_IOInterface *io)
+{
+    nitf_Error error;
+    nitf_Reader *reader;
+    nitf_Record *record;
+    nitf_SegmentReader *text;
+    char buffer[sizeof(TEXT)];
+    nitf_Uint8 *pixels;
+    nitf_SubWindow window;
+    nitf_Uint32 bandList = 0;
+    nitf_Uint32 image, row, col;
+    int padded;
+
+    TEST_ASSERT(io);
+    reader = nitf_Reader_construct(&error);
+    TEST_ASSERT(reader);
+    record = nitf_Reader_readIO(reader, io, &error);
+    TEST_ASSERT(record);
+
+    TEST_ASSERT(memcmp(record->header->fileTitle->raw, FILE_TITLE,
+                       strlen(FILE_TITLE)) == 0);
+    TEST_ASSERT(memcmp(getImage(record, 0)->subheader->imageId->raw,
+                       "FIRST", 5) == 0);
+    TEST_ASSERT(memcmp(getImage(record, 1)->subheader->imageId->raw,
+                       "SECOND", 6) == 0);
+    checkTRE(testName, record->header->userDefinedSection,
+             tres[0].tag, tres[0].length);
+    checkTRE(testName, record->header->extendedSection,
+             tres[1].tag, tres[1].length);
+    checkTRE(testName, getImage(record, 0)->subheader->userDefinedSection,
+             tres[2].tag, tres[2].length);
+    checkTRE(testName, getImage(record, 1)->subheader->extendedSection,
+             tres[3].tag, tres[3].length);
+
+    text = nitf_Reader_newTextReader(reader, 0, &error);
+    TEST_ASSERT(text);
+    TEST_ASSERT_EQ_INT(nitf_SegmentReader_getSize(text, &error),
+                       strlen(TEXT));
+    TEST_ASSERT(nitf_SegmentReader_read(text, buffer, strlen(TEXT), &error));
+    TEST_ASSERT(memcmp(buffer, TEXT, strlen(TEXT)) == 0);
+    nitf_SegmentReader_destruct(&text);
+
+    pixels = (nitf_Uint8 *) NITF_MALLOC(NUM_ROWS * NUM_COLS);
+    TEST_ASSERT(pixels);
+    memset(&window, 0, sizeof(window));
+    window.numRows = NUM_ROWS;
+    window.numCols = NUM_COLS;
+    window.bandList = &bandList;
+    window.numBands = 1;
+    for (image = 0; image < 2; image++)
+    {
+        nitf_ImageReader *imageReader;
+
+        imageReader = nitf_Reader_newImageReader(reader, image, &error);
+        TEST_ASSERT(imageReader);
+        TEST_ASSERT(nitf_ImageReader_read(imageReader, &window, &pixels,
+                                          &padded, &error));
+        for (row = 0; row < NUM_ROWS; row++)
+            for (col = 0; col < NUM_COLS; col++)
+                TEST_ASSERT_EQ_INT(pixels[row * NUM_COLS + col],
+                                   pixel(image, row, col));
+        nitf_ImageReader_destruct(&imageReader);
+    }
+    NITF_FREE(pixels);
+
+    nitf_Record_destruct(&record);
+    nitf_Reader_destruct(&reader);
+    nitf_IOInterface_close(io, &error);
+    nitf_IOInterface_destruct(&io);
+}
+
+TEST_CASE(testFile)
+{
+    nitf_Error error;
+
+    writeFile(testName);
+    checkFile(testName, nitf_IOHandleAdapter_open(TEST_FILE_NAME,
+                                                  NITF_ACCESS_READONLY,
+                                                  NITF_OPEN_EXISTING,
+                                                  &error));
+}
+
+TEST_CASE(testBuffer)
+{
+    nitf_Error error;
+    nitf_IOHandle handle;
+    nitf_Off size;
+    char *buf;
+
+    /* The adapter owns the buffer */
+    writeFile(testName);
+    handle = nitf_IOHandle_create(TEST_FILE_NAME, NITF_ACCESS_READONLY,
+                                  NITF_OPEN_EXISTING, &error);
+    TEST_ASSERT(!NITF_INVALID_HANDLE(handle));
+    size = nitf_IOHandle_getSize(handle, &error);
+    TEST_ASSERT(size > 0);
+    buf = (char *) NITF_MALLOC((size_t) size);
+    TEST_ASSERT(buf);
+    TEST_ASSERT(nitf_IOHandle_read(handle, buf, (size_t) size, &error));
+    nitf_IOHandle_close(handle);
+
+    checkFile(testName, nitf_BufferAdapter_construct(buf, (size_t) size, 1,
+                                                     &error));
+}
+
+TEST_CASE(testMapped)
+{
+    nitf_Error error;
+
+    writeFile(testName);
+    checkFile(testName, nitf_MMapAdapter_open(TEST_FILE_NAME, &error));
+}
+
+int main(int argc, char **argv)
+{
+    CHECK(testFile);
+    CHECK(testBuffer);
+    CHECK(testMapped);
+    remove(TEST_FILE_NAME);
+    return 0;
+}
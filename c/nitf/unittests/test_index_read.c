@@ -0,0 +1,478 @@
+/* =========================================================================
+ * This file is part of NITRO
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2010, General Dynamics - Advanced Information Systems
+ *
+ * NITRO is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <import/nitf.h>
+#include "Test.h"
+
+#define TEST_FILE_NAME "test_index_read.ntf"
+#define COPY_FILE_NAME "test_index_read_copy.ntf"
+#define MISSING_FILE_NAME "test_index_read_missing.ntf"
+#define TEXT "Text segment data, which follows the image data in the file."
+#define NUM_FILES 3
+
+static const char *fileNames[NUM_FILES] =
+{
+    TEST_FILE_NAME, "test_index_read_1.ntf", "test_index_read_2.ntf"
+};
+
+/* Sizes of the two images of each file */
+static const nitf_Uint32 numRows[2] = { 150, 70 };
+static const nitf_Uint32 numCols[2] = { 130, 200 };
+
+/* Result of scanning one file */
+typedef struct
+{
+    int called;
+    int read;
+    int checked;
+}
+ScanResult;
+
+static nitf_Uint8 pixel(nitf_Uint32 file, nitf_Uint32 image,
+                        nitf_Uint32 row, nitf_Uint32 col)
+{
+    return (nitf_Uint8) (file * 31 + image * 97 + row * 7 + col * 3
+                         + (row * col) % 13);
+}
+
+static char treByte(nitf_Uint32 image, size_t i)
+{
+    return (char) ('A' + (i * 7 + image) % 26);
+}
+
+static size_t treLength(nitf_Uint32 image)
+{
+    return 200 + 100 * image;
+}
+
+static void makeImageId(char *imageId, nitf_Uint32 file, nitf_Uint32 image)
+{
+    sprintf(imageId, "IMAGE%u%u", (unsigned int) file, (unsigned int) image);
+}
+
+static nitf_ImageSegment *getImage(nitf_Record *record, int index)
+{
+    nitf_ListIterator iter = nitf_List_begin(record->images);
+
+    while (index-- > 0)
+        nitf_ListIterator_increment(&iter);
+    return (nitf_ImageSegment *) nitf_ListIterator_get(&iter);
+}
+
+/*
+ *  Add a one band, 8-bit image segment of 64 by 48 blocks, with an image
+ *  id and a TRE
+ */
+static void addImage(const char *testName, nitf_Record *record,
+                     nitf_Uint32 file, nitf_Uint32 image)
+{
+    nitf_Error error;
+    nitf_ImageSegment *segment;
+    nitf_BandInfo **bands;
+    nitf_TRE *tre;
+    char imageId[16];
+    char data[300];
+    size_t i;
+
+    segment = nitf_Record_newImageSegment(record, &error);
+    TEST_ASSERT(segment);
+    bands = (nitf_BandInfo **) NITF_MALLOC(sizeof(nitf_BandInfo *));
+    TEST_ASSERT(bands);
+    bands[0] = nitf_BandInfo_construct(&error);
+    TEST_ASSERT(bands[0]);
+    TEST_ASSERT(nitf_BandInfo_init(bands[0], "M", " ", "N", "   ",
+                                   0, 0, NULL, &error));
+    TEST_ASSERT(nitf_ImageSubheader_setPixelInformation(segment->subheader,
+                                                        "INT", 8, 8, "R",
+                                                        "MONO", "VIS", 1,
+                                                        bands, &error));
+    TEST_ASSERT(nitf_ImageSubheader_setBlocking(segment->subheader,
+                                                numRows[image],
+                                                numCols[image], 64, 48,
+                                                "B", &error));
+    makeImageId(imageId, file, image);
+    TEST_ASSERT(nitf_Field_setString(segment->subheader->imageId, imageId,
+                                     &error));
+
+    for (i = 0; i < treLength(image); i++)
+        data[i] = treByte(image, i);
+    tre = nitf_TRE_construct("TSTIMG", NITF_TRE_RAW, &error);
+    TEST_ASSERT(tre);
+    TEST_ASSERT(nitf_TRE_setField(tre, NITF_TRE_RAW, data,
+                                  treLength(image), &error));
+    TEST_ASSERT(nitf_Extensions_appendTRE(segment->subheader->extendedSection,
+                                          tre, &error));
+}
+
+/*
+ *  Write a record of two images and a text segment with the data of file
+ */
+static void writeRecord(const char *testName, nitf_Record *record,
+                        nitf_Uint32 file, const char *fileName)
+{
+    nitf_Error error;
+    nitf_Writer *writer;
+    nitf_SegmentWriter *textWriter;
+    nitf_SegmentSource *textSource;
+    nitf_IOHandle out;
+    nitf_Uint8 *data[2];
+    nitf_Uint32 image, row, col;
+
+    out = nitf_IOHandle_create(fileName, NITF_ACCESS_WRITEONLY,
+                               NITF_CREATE, &error);
+    TEST_ASSERT(!NITF_INVALID_HANDLE(out));
+    writer = nitf_Writer_construct(&error);
+    TEST_ASSERT(writer);
+    TEST_ASSERT(nitf_Writer_prepare(writer, record, out, &error));
+
+    for (image = 0; image < 2; image++)
+    {
+        nitf_ImageWriter *imageWriter;
+        nitf_ImageSource *source;
+        nitf_BandSource *bandSource;
+        size_t size = numRows[image] * numCols[image];
+
+        data[image] = (nitf_Uint8 *) NITF_MALLOC(size);
+        TEST_ASSERT(data[image]);
+        for (row = 0; row < numRows[image]; row++)
+            for (col = 0; col < numCols[image]; col++)
+                data[image][row * numCols[image] + col] =
+                    pixel(file, image, row, col);
+        imageWriter = nitf_Writer_newImageWriter(writer, image, &error);
+        TEST_ASSERT(imageWriter);
+        source = nitf_ImageSource_construct(&error);
+        TEST_ASSERT(source);
+        bandSource = nitf_MemorySource_construct((char *) data[image], size,
+                                                 0, 1, 0, &error);
+        TEST_ASSERT(bandSource);
+        TEST_ASSERT(nitf_ImageSource_addBand(source, bandSource, &error));
+        TEST_ASSERT(nitf_ImageWriter_attachSource(imageWriter, source,
+                                                  &error));
+    }
+    textWriter = nitf_Writer_newTextWriter(writer, 0, &error);
+    TEST_ASSERT(textWriter);
+    textSource = nitf_SegmentMemorySource_construct(TEXT, strlen(TEXT),
+                                                    0, 0, 0, &error);
+    TEST_ASSERT(textSource);
+    TEST_ASSERT(nitf_SegmentWriter_attachSource(textWriter, textSource,
+                                                &error));
+    TEST_ASSERT(nitf_Writer_write(writer, &error));
+
+    nitf_IOHandle_close(out);
+    nitf_Writer_destruct(&writer);
+    NITF_FREE(data[0]);
+    NITF_FREE(data[1]);
+}
+
+static void writeFiles(const char *testName)
+{
+    nitf_Error error;
+    nitf_Uint32 file;
+
+    for (file = 0; file < NUM_FILES; file++)
+    {
+        nitf_Record *record = nitf_Record_construct(NITF_VER_21, &error);
+
+        TEST_ASSERT(record);
+        addImage(testName, record, file, 0);
+        addImage(testName, record, file, 1);
+        TEST_ASSERT(nitf_Record_newTextSegment(record, &error));
+        writeRecord(testName, record, file, fileNames[file]);
+        nitf_Record_destruct(&record);
+    }
+}
+
+/*
+ *  Check a loaded image subheader, its TRE and its pixels
+ */
+static void checkImage(const char *testName, nitf_Reader *reader,
+                       nitf_Record *record, nitf_Uint32 file,
+                       nitf_Uint32 image)
+{
+    nitf_Error error;
+    nitf_ImageSubheader *subheader = getImage(record, image)->subheader;
+    nitf_ImageReader *imageReader;
+    nitf_List *list;
+    nitf_Field *field;
+    nitf_SubWindow window;
+    nitf_Uint32 bandList = 0;
+    nitf_Uint8 *pixels;
+    nitf_Uint32 row, col;
+    char imageId[16];
+    size_t i;
+    int padded;
+
+    makeImageId(imageId, file, image);
+    TEST_ASSERT(memcmp(subheader->imageId->raw, imageId,
+                       strlen(imageId)) == 0);
+    list = nitf_Extensions_getTREsByName(subheader->extendedSection,
+                                         "TSTIMG");
+    TEST_ASSERT(list && !nitf_List_isEmpty(list));
+    field = nitf_TRE_getField((nitf_TRE *) list->first->data, NITF_TRE_RAW);
+    TEST_ASSERT(field);
+    TEST_ASSERT_EQ_INT(field->length, treLength(image));
+    for (i = 0; i < treLength(image); i++)
+        TEST_ASSERT_EQ_INT(field->raw[i], treByte(image, i));
+
+    pixels = (nitf_Uint8 *) NITF_MALLOC(numRows[image] * numCols[image]);
+    TEST_ASSERT(pixels);
+    memset(&window, 0, sizeof(window));
+    window.numRows = numRows[image];
+    window.numCols = numCols[image];
+    window.bandList = &bandList;
+    window.numBands = 1;
+    imageReader = nitf_Reader_newImageReader(reader, image, &error);
+    TEST_ASSERT(imageReader);
+    TEST_ASSERT(nitf_ImageReader_read(imageReader, &window, &pixels,
+                                      &padded, &error));
+    for (row = 0; row < numRows[image]; row++)
+        for (col = 0; col < numCols[image]; col++)
+            TEST_ASSERT_EQ_INT(pixels[row * numCols[image] + col],
+                               pixel(file, image, row, col));
+    nitf_ImageReader_destruct(&imageReader);
+    NITF_FREE(pixels);
+}
+
+static void checkText(const char *testName, nitf_Reader *reader)
+{
+    nitf_Error error;
+    nitf_SegmentReader *text;
+    char buffer[sizeof(TEXT)];
+
+    text = nitf_Reader_newTextReader(reader, 0, &error);
+    TEST_ASSERT(text);
+    TEST_ASSERT_EQ_INT(nitf_SegmentReader_getSize(text, &error),
+                       strlen(TEXT));
+    TEST_ASSERT(nitf_SegmentReader_read(text, buffer, strlen(TEXT), &error));
+    TEST_ASSERT(memcmp(buffer, TEXT, strlen(TEXT)) == 0);
+    nitf_SegmentReader_destruct(&text);
+}
+
+static nitf_Record *readIndex(const char *testName, const char *fileName,
+                              nitf_Reader **reader, nitf_IOHandle *in)
+{
+    nitf_Error error;
+    nitf_Record *record;
+
+    *in = nitf_IOHandle_create(fileName, NITF_ACCESS_READONLY,
+                               NITF_OPEN_EXISTING, &error);
+    TEST_ASSERT(!NITF_INVALID_HANDLE(*in));
+    *reader = nitf_Reader_construct(&error);
+    TEST_ASSERT(*reader);
+    record = nitf_Reader_readIndex(*reader, *in, &error);
+    TEST_ASSERT(record);
+    return record;
+}
+
+static void closeRecord(nitf_Record **record, nitf_Reader **reader,
+                        nitf_IOHandle in)
+{
+    nitf_Record_destruct(record);
+    nitf_Reader_destruct(reader);
+    nitf_IOHandle_close(in);
+}
+
+TEST_CASE(testOffsets)
+{
+    nitf_Error error;
+    nitf_IOHandle fullIn, in;
+    nitf_Reader *fullReader, *reader;
+    nitf_Record *full, *record;
+    int image;
+
+    writeFiles(testName);
+    fullIn = nitf_IOHandle_create(TEST_FILE_NAME, NITF_ACCESS_READONLY,
+                                  NITF_OPEN_EXISTING, &error);
+    TEST_ASSERT(!NITF_INVALID_HANDLE(fullIn));
+    fullReader = nitf_Reader_construct(&error);
+    TEST_ASSERT(fullReader);
+    full = nitf_Reader_read(fullReader, fullIn, &error);
+    TEST_ASSERT(full);
+    record = readIndex(testName, TEST_FILE_NAME, &reader, &in);
+
+    TEST_ASSERT_EQ_INT(nitf_List_size(record->images), 2);
+    TEST_ASSERT_EQ_INT(nitf_List_size(record->texts), 1);
+    for (image = 0; image < 2; image++)
+    {
+        nitf_ImageSegment *expected = getImage(full, image);
+        nitf_ImageSegment *segment = getImage(record, image);
+
+        TEST_ASSERT(segment->imageOffset == expected->imageOffset);
+        TEST_ASSERT(segment->imageEnd == expected->imageEnd);
+
+        /* The subheader is not read yet */
+        TEST_ASSERT(segment->subheader->filePartType->raw[0] == ' ');
+    }
+
+    closeRecord(&record, &reader, in);
+    closeRecord(&full, &fullReader, fullIn);
+}
+
+TEST_CASE(testLoad)
+{
+    nitf_Error error;
+    nitf_IOHandle in;
+    nitf_Reader *reader;
+    nitf_Record *record;
+    int image;
+
+    record = readIndex(testName, TEST_FILE_NAME, &reader, &in);
+
+    /* Load out of order, and twice */
+    for (image = 1; image >= 0; image--)
+    {
+        TEST_ASSERT(nitf_Reader_loadSubheader(reader, NITF_SEGMENT_IMAGE,
+                                              image, &error));
+        TEST_ASSERT(nitf_Reader_loadSubheader(reader, NITF_SEGMENT_IMAGE,
+                                              image, &error));
+        checkImage(testName, reader, record, 0, image);
+    }
+    TEST_ASSERT(nitf_Reader_loadSubheader(reader, NITF_SEGMENT_TEXT, 0,
+                                          &error));
+    checkText(testName, reader);
+
+    /* A fully loaded index record writes like a full one */
+    writeRecord(testName, record, 0, COPY_FILE_NAME);
+    closeRecord(&record, &reader, in);
+
+    record = readIndex(testName, COPY_FILE_NAME, &reader, &in);
+    for (image = 0; image < 2; image++)
+    {
+        TEST_ASSERT(nitf_Reader_loadSubheader(reader, NITF_SEGMENT_IMAGE,
+                                              image, &error));
+        checkImage(testName, reader, record, 0, image);
+    }
+    closeRecord(&record, &reader, in);
+}
+
+TEST_CASE(testRetry)
+{
+    nitf_Error error;
+    nitf_IOHandle handle;
+    nitf_IOInterface *io;
+    nitf_IOInterface *truncated;
+    nitf_Reader *reader;
+    nitf_Record *record;
+    nitf_ImageSegment *segment;
+    nitf_Uint32 subheaderLength;
+    nitf_Off size;
+    char *buf;
+
+    handle = nitf_IOHandle_create(TEST_FILE_NAME, NITF_ACCESS_READONLY,
+                                  NITF_OPEN_EXISTING, &error);
+    TEST_ASSERT(!NITF_INVALID_HANDLE(handle));
+    size = nitf_IOHandle_getSize(handle, &error);
+    TEST_ASSERT(size > 0);
+    buf = (char *) NITF_MALLOC((size_t) size);
+    TEST_ASSERT(buf);
+    TEST_ASSERT(nitf_IOHandle_read(handle, buf, (size_t) size, &error));
+    nitf_IOHandle_close(handle);
+
+    io = nitf_BufferAdapter_construct(buf, (size_t) size, 1, &error);
+    TEST_ASSERT(io);
+    reader = nitf_Reader_construct(&error);
+    TEST_ASSERT(reader);
+    record = nitf_Reader_readIndexIO(reader, io, &error);
+    TEST_ASSERT(record);
+    segment = getImage(record, 0);
+    TEST_ASSERT(nitf_Field_get(record->header->imageInfo[0]->lengthSubheader,
+                               &subheaderLength, NITF_CONV_UINT,
+                               sizeof(subheaderLength), &error));
+
+    /* Fail part way through the subheader, then load it from the file */
+    truncated = nitf_BufferAdapter_construct(buf, (size_t)
+                                             (segment->imageOffset -
+                                              subheaderLength + 200), 0,
+                                             &error);
+    TEST_ASSERT(truncated);
+    reader->input = truncated;
+    TEST_ASSERT(!nitf_Reader_loadSubheader(reader, NITF_SEGMENT_IMAGE, 0,
+                                           &error));
+    reader->input = io;
+    nitf_IOInterface_destruct(&truncated);
+
+    TEST_ASSERT(nitf_Reader_loadSubheader(reader, NITF_SEGMENT_IMAGE, 0,
+                                          &error));
+    checkImage(testName, reader, record, 0, 0);
+
+    nitf_Record_destruct(&record);
+    nitf_Reader_destruct(&reader);
+    nitf_IOInterface_destruct(&io);
+}
+
+/*
+ *  Load the second image of each file and check it
+ */
+static void scanFile(NITF_DATA *userData, nitf_Uint32 fileIndex,
+                     const char *fileName, nitf_Reader *reader,
+                     nitf_Record *record, nitf_Error *error)
+{
+    const char *testName = "testScan";
+    ScanResult *result = (ScanResult *) userData + fileIndex;
+    nitf_Error loadError;
+
+    result->called++;
+    if (!record)
+        return;
+    result->read = 1;
+    TEST_ASSERT(nitf_Reader_loadSubheader(reader, NITF_SEGMENT_IMAGE, 1,
+                                          &loadError));
+    checkImage(testName, reader, record, fileIndex, 1);
+    result->checked = 1;
+}
+
+TEST_CASE(testScan)
+{
+    nitf_Error error;
+    const char *names[NUM_FILES + 1];
+    ScanResult results[NUM_FILES + 1];
+    int i;
+
+    for (i = 0; i < NUM_FILES; i++)
+        names[i] = fileNames[i];
+    names[NUM_FILES] = MISSING_FILE_NAME;
+    memset(results, 0, sizeof(results));
+
+    /* A file that cannot be read is reported and does not stop the scan */
+    TEST_ASSERT(nitf_Reader_scanFiles(names, NUM_FILES + 1, 3, scanFile,
+                                      results, &error));
+    for (i = 0; i <= NUM_FILES; i++)
+    {
+        TEST_ASSERT_EQ_INT(results[i].called, 1);
+        TEST_ASSERT_EQ_INT(results[i].read, i < NUM_FILES);
+        TEST_ASSERT_EQ_INT(results[i].checked, i < NUM_FILES);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int i;
+
+    CHECK(testOffsets);
+    CHECK(testLoad);
+    CHECK(testRetry);
+    CHECK(testScan);
+    for (i = 0; i < NUM_FILES; i++)
+        remove(fileNames[i]);
+    remove(COPY_FILE_NAME);
+    return 0;
+}
@@ -0,0 +1,345 @@
+/* =========================================================================
+ * This file is part of NITRO
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2010, General Dynamics - Advanced Information Systems
+ *
+ * NITRO is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ *  The J2K compression and decompression plug-ins must be on
+ *  NITF_PLUGIN_PATH, otherwise the test is skipped.
+ */
+
+#include <import/nitf.h>
+#include "Test.h"
+
+#define TEST_FILE_NAME "test_j2k_encode.ntf"
+#define MAX_BANDS 3
+
+typedef struct
+{
+    nitf_Uint32 numBands;
+    nitf_Uint32 numBits;
+    nitf_Uint32 numBitsActual;
+    nitf_Uint32 numRows;
+    nitf_Uint32 numCols;
+    nitf_Uint32 numRowsPerBlock;
+    nitf_Uint32 numColsPerBlock;
+}
+Layout;
+
+/* Encoder settings, read by the plug-in when a write starts */
+static char *settings[][2] =
+{
+    { "NITF_J2K_ENCODE_THREADS=0", "NITF_J2K_MAX_PENDING_BYTES=0" },
+    { "NITF_J2K_ENCODE_THREADS=4", "NITF_J2K_MAX_PENDING_BYTES=0" },
+    { "NITF_J2K_ENCODE_THREADS=3", "NITF_J2K_MAX_PENDING_BYTES=20000" }
+};
+
+static NITF_BOOL havePlugins(void)
+{
+    nitf_Error error;
+    nitf_PluginRegistry *registry;
+    int hadError = 0;
+
+    registry = nitf_PluginRegistry_getInstance(&error);
+    return registry &&
+        nitf_PluginRegistry_retrieveCompConstructor(registry, "C8",
+                                                    &hadError, &error) &&
+        nitf_PluginRegistry_retrieveDecompConstructor(registry, "C8",
+                                                      &hadError, &error);
+}
+
+static nitf_Uint32 pixel(const Layout *layout, nitf_Uint32 band,
+                         nitf_Uint32 row, nitf_Uint32 col)
+{
+    nitf_Uint32 value = (band * 97 + row * 7 + col * 3 + (row * col) % 13)
+        ^ ((row * 40503 + col * 9973) << 8);
+
+    return value & ((((nitf_Uint32) 1) << layout->numBitsActual) - 1);
+}
+
+/*
+ *  Write an image as "C8" through the J2K compression plug-in
+ */
+static void writeImage(const char *testName, const Layout *layout)
+{
+    nitf_Error error;
+    nitf_Record *record;
+    nitf_ImageSegment *segment;
+    nitf_BandInfo **bands;
+    nitf_Writer *writer;
+    nitf_ImageWriter *imageWriter;
+    nitf_ImageSource *source;
+    nitf_IOHandle out;
+    nitf_Uint32 bytes = layout->numBits / 8;
+    size_t size = (size_t) layout->numRows * layout->numCols * bytes;
+    nitf_Uint8 *data[MAX_BANDS];
+    nitf_Uint32 band, row, col;
+
+    record = nitf_Record_construct(NITF_VER_21, &error);
+    TEST_ASSERT(record);
+    segment = nitf_Record_newImageSegment(record, &error);
+    TEST_ASSERT(segment);
+    bands = (nitf_BandInfo **) NITF_MALLOC(sizeof(nitf_BandInfo *)
+                                           * layout->numBands);
+    TEST_ASSERT(bands);
+    for (band = 0; band < layout->numBands; band++)
+    {
+        bands[band] = nitf_BandInfo_construct(&error);
+        TEST_ASSERT(bands[band]);
+        TEST_ASSERT(nitf_BandInfo_init(bands[band], "M", " ", "N", "   ",
+                                       0, 0, NULL, &error));
+    }
+    TEST_ASSERT(nitf_ImageSubheader_setPixelInformation(segment->subheader,
+                                                        "INT",
+                                                        layout->numBits,
+                                                        layout->numBitsActual,
+                                                        "R",
+                                                        layout->numBands == 1 ?
+                                                        "MONO" : "MULTI",
+                                                        "VIS",
+                                                        layout->numBands,
+                                                        bands, &error));
+    TEST_ASSERT(nitf_ImageSubheader_setBlocking(segment->subheader,
+                                                layout->numRows,
+                                                layout->numCols,
+                                                layout->numRowsPerBlock,
+                                                layout->numColsPerBlock,
+                                                "B", &error));
+    TEST_ASSERT(nitf_Field_setString(segment->subheader->imageCompression,
+                                     "C8", &error));
+
+    out = nitf_IOHandle_create(TEST_FILE_NAME, NITF_ACCESS_WRITEONLY,
+                               NITF_CREATE, &error);
+    TEST_ASSERT(!NITF_INVALID_HANDLE(out));
+    writer = nitf_Writer_construct(&error);
+    TEST_ASSERT(writer);
+    TEST_ASSERT(nitf_Writer_prepare(writer, record, out, &error));
+    imageWriter = nitf_Writer_newImageWriter(writer, 0, &error);
+    TEST_ASSERT(imageWriter);
+
+    source = nitf_ImageSource_construct(&error);
+    TEST_ASSERT(source);
+    for (band = 0; band < layout->numBands; band++)
+    {
+        nitf_BandSource *bandSource;
+
+        data[band] = (nitf_Uint8 *) NITF_MALLOC(size);
+        TEST_ASSERT(data[band]);
+        for (row = 0; row < layout->numRows; row++)
+            for (col = 0; col < layout->numCols; col++)
+            {
+                size_t n = (size_t) row * layout->numCols + col;
+
+                if (bytes == 1)
+                    data[band][n] = (nitf_Uint8) pixel(layout, band, row,
+                                                       col);
+                else
+                    ((nitf_Uint16 *) data[band])[n] =
+                        (nitf_Uint16) pixel(layout, band, row, col);
+            }
+        bandSource = nitf_MemorySource_construct((char *) data[band], size,
+                                                 0, bytes, 0, &error);
+        TEST_ASSERT(bandSource);
+        TEST_ASSERT(nitf_ImageSource_addBand(source, bandSource, &error));
+    }
+    TEST_ASSERT(nitf_ImageWriter_attachSource(imageWriter, source, &error));
+    TEST_ASSERT(nitf_Writer_write(writer, &error));
+
+    nitf_IOHandle_close(out);
+    nitf_Writer_destruct(&writer);
+    nitf_Record_destruct(&record);
+    for (band = 0; band < layout->numBands; band++)
+        NITF_FREE(data[band]);
+}
+
+/*
+ *  Read the codestream of the file, and check the pixels losslessly
+ *  through the J2K decompression plug-in
+ */
+static nitf_Uint8 *readImage(const char *testName, const Layout *layout,
+                             size_t *length)
+{
+    nitf_Error error;
+    nitf_IOHandle in;
+    nitf_Reader *reader;
+    nitf_Record *record;
+    nitf_ImageSegment *segment;
+    nitf_ImageReader *image;
+    nitf_SubWindow window;
+    nitf_Uint32 bandList[MAX_BANDS] = { 0, 1, 2 };
+    nitf_Uint8 *buffers[MAX_BANDS];
+    nitf_Uint32 bytes = layout->numBits / 8;
+    nitf_Uint8 *data;
+    nitf_Uint32 band, row, col;
+    int padded;
+
+    in = nitf_IOHandle_create(TEST_FILE_NAME, NITF_ACCESS_READONLY,
+                              NITF_OPEN_EXISTING, &error);
+    TEST_ASSERT(!NITF_INVALID_HANDLE(in));
+    reader = nitf_Reader_construct(&error);
+    TEST_ASSERT(reader);
+    record = nitf_Reader_read(reader, in, &error);
+    TEST_ASSERT(record);
+
+    segment = (nitf_ImageSegment *) record->images->first->data;
+    *length = (size_t) (segment->imageEnd - segment->imageOffset);
+    data = (nitf_Uint8 *) NITF_MALLOC(*length);
+    TEST_ASSERT(data);
+    TEST_ASSERT(NITF_IO_SUCCESS(nitf_IOHandle_seek(in,
+                                                   (nitf_Off) segment->
+                                                   imageOffset,
+                                                   NITF_SEEK_SET, &error)));
+    TEST_ASSERT(nitf_IOHandle_read(in, (char *) data, *length, &error));
+
+    image = nitf_Reader_newImageReader(reader, 0, &error);
+    TEST_ASSERT(image);
+    memset(&window, 0, sizeof(window));
+    window.numRows = layout->numRows;
+    window.numCols = layout->numCols;
+    window.bandList = bandList;
+    window.numBands = layout->numBands;
+    for (band = 0; band < layout->numBands; band++)
+    {
+        buffers[band] = (nitf_Uint8 *) NITF_MALLOC((size_t) layout->numRows
+                                                   * layout->numCols
+                                                   * bytes);
+        TEST_ASSERT(buffers[band]);
+    }
+    TEST_ASSERT(nitf_ImageReader_read(image, &window, buffers, &padded,
+                                      &error));
+    for (band = 0; band < layout->numBands; band++)
+    {
+        for (row = 0; row < layout->numRows; row++)
+            for (col = 0; col < layout->numCols; col++)
+            {
+                size_t n = (size_t) row * layout->numCols + col;
+                nitf_Uint32 got = bytes == 1 ? buffers[band][n] :
+                    ((nitf_Uint16 *) buffers[band])[n];
+
+                TEST_ASSERT_EQ_INT(got, pixel(layout, band, row, col));
+            }
+        NITF_FREE(buffers[band]);
+    }
+
+    nitf_ImageReader_destruct(&image);
+    nitf_Record_destruct(&record);
+    nitf_Reader_destruct(&reader);
+    nitf_IOHandle_close(in);
+    return data;
+}
+
+static nitf_Uint32 getUint32(const nitf_Uint8 *data)
+{
+    return ((nitf_Uint32) data[0] << 24) | ((nitf_Uint32) data[1] << 16)
+        | ((nitf_Uint32) data[2] << 8) | data[3];
+}
+
+/*
+ *  Encode with each setting. The codestreams spliced from tiles encoded
+ *  on a thread pool must not depend on the number of threads or batches.
+ *  The serial writer codes the whole image as one tile, so its
+ *  codestream is only checked through its pixels, and it cannot write
+ *  partial edge tiles.
+ */
+static void encode(const char *testName, const Layout *layout)
+{
+    nitf_Uint8 *first = NULL;
+    size_t firstLength = 0;
+    size_t i = 0;
+
+    if (layout->numRows % layout->numRowsPerBlock != 0 ||
+        layout->numCols % layout->numColsPerBlock != 0)
+        i = 1;
+    for (; i < sizeof(settings) / sizeof(settings[0]); i++)
+    {
+        nitf_Uint8 *data;
+        size_t length;
+
+        putenv(settings[i][0]);
+        putenv(settings[i][1]);
+        writeImage(testName, layout);
+        data = readImage(testName, layout, &length);
+        if (i == 0)
+        {
+            NITF_FREE(data);
+            continue;
+        }
+
+        /* The SIZ marker segment has the tile size */
+        TEST_ASSERT(length >= 32 && data[2] == 0xFF && data[3] == 0x51);
+        TEST_ASSERT_EQ_INT(getUint32(data + 24), layout->numColsPerBlock);
+        TEST_ASSERT_EQ_INT(getUint32(data + 28), layout->numRowsPerBlock);
+        if (!first)
+        {
+            first = data;
+            firstLength = length;
+        }
+        else
+        {
+            TEST_ASSERT(length == firstLength);
+            TEST_ASSERT(memcmp(data, first, length) == 0);
+            NITF_FREE(data);
+        }
+    }
+    NITF_FREE(first);
+}
+
+TEST_CASE(testOneBand)
+{
+    Layout layout = { 1, 8, 8, 256, 240, 64, 48 };
+
+    encode(testName, &layout);
+}
+
+TEST_CASE(testThreeBands)
+{
+    Layout layout = { 3, 8, 8, 128, 160, 32, 32 };
+
+    encode(testName, &layout);
+}
+
+TEST_CASE(test12Bit)
+{
+    Layout layout = { 1, 16, 12, 128, 192, 64, 64 };
+
+    encode(testName, &layout);
+}
+
+TEST_CASE(testPartialTiles)
+{
+    Layout layout = { 1, 8, 8, 300, 250, 64, 48 };
+
+    encode(testName, &layout);
+}
+
+int main(int argc, char **argv)
+{
+    if (!havePlugins())
+    {
+        fprintf(stderr, "%s : SKIPPED, needs the J2K plug-ins\n", argv[0]);
+        return 0;
+    }
+    CHECK(testOneBand);
+    CHECK(testThreeBands);
+    CHECK(test12Bit);
+    CHECK(testPartialTiles);
+    remove(TEST_FILE_NAME);
+    return 0;
+}
@@ -0,0 +1,397 @@
+/* =========================================================================
+ * This file is part of NITRO
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2010, General Dynamics - Advanced Information Systems
+ *
+ * NITRO is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ *  The J2K compression and decompression plug-ins must be on
+ *  NITF_PLUGIN_PATH, otherwise the test is skipped.
+ */
+
+#include <import/nitf.h>
+#include "Test.h"
+
+#define TEST_FILE_NAME "test_j2k_levels.ntf"
+#define MAX_BANDS 3
+
+/* Mean absolute difference allowed from the box average, in 1/16ths */
+#define MAX_MEAN_ERROR 16
+
+typedef struct
+{
+    nitf_Uint32 numBands;
+    nitf_Uint32 numRows;
+    nitf_Uint32 numCols;
+    nitf_Uint32 numRowsPerBlock;
+    nitf_Uint32 numColsPerBlock;
+}
+Layout;
+
+/* A level read whole */
+typedef struct
+{
+    nitf_Uint32 level;
+    nitf_Uint32 numRows;
+    nitf_Uint32 numCols;
+    nitf_Uint8 *bands[MAX_BANDS];
+}
+Level;
+
+static NITF_BOOL havePlugins(void)
+{
+    nitf_Error error;
+    nitf_PluginRegistry *registry;
+    int hadError = 0;
+
+    registry = nitf_PluginRegistry_getInstance(&error);
+    return registry &&
+        nitf_PluginRegistry_retrieveCompConstructor(registry, "C8",
+                                                    &hadError, &error) &&
+        nitf_PluginRegistry_retrieveDecompConstructor(registry, "C8",
+                                                      &hadError, &error);
+}
+
+static nitf_Uint8 pixel(nitf_Uint32 band, nitf_Uint32 row, nitf_Uint32 col)
+{
+    return (nitf_Uint8) (band * 97 + row * 7 + col * 3 + (row * col) % 13);
+}
+
+/*
+ *  Write an 8-bit image as "C8" through the J2K compression plug-in
+ */
+static void writeImage(const char *testName, const Layout *layout)
+{
+    nitf_Error error;
+    nitf_Record *record;
+    nitf_ImageSegment *segment;
+    nitf_BandInfo **bands;
+    nitf_Writer *writer;
+    nitf_ImageWriter *imageWriter;
+    nitf_ImageSource *source;
+    nitf_IOHandle out;
+    size_t size = (size_t) layout->numRows * layout->numCols;
+    nitf_Uint8 *data[MAX_BANDS];
+    nitf_Uint32 band, row, col;
+
+    record = nitf_Record_construct(NITF_VER_21, &error);
+    TEST_ASSERT(record);
+    segment = nitf_Record_newImageSegment(record, &error);
+    TEST_ASSERT(segment);
+    bands = (nitf_BandInfo **) NITF_MALLOC(sizeof(nitf_BandInfo *)
+                                           * layout->numBands);
+    TEST_ASSERT(bands);
+    for (band = 0; band < layout->numBands; band++)
+    {
+        bands[band] = nitf_BandInfo_construct(&error);
+        TEST_ASSERT(bands[band]);
+        TEST_ASSERT(nitf_BandInfo_init(bands[band], "M", " ", "N", "   ",
+                                       0, 0, NULL, &error));
+    }
+    TEST_ASSERT(nitf_ImageSubheader_setPixelInformation(segment->subheader,
+                                                        "INT", 8, 8, "R",
+                                                        layout->numBands == 1 ?
+                                                        "MONO" : "MULTI",
+                                                        "VIS",
+                                                        layout->numBands,
+                                                        bands, &error));
+    TEST_ASSERT(nitf_ImageSubheader_setBlocking(segment->subheader,
+                                                layout->numRows,
+                                                layout->numCols,
+                                                layout->numRowsPerBlock,
+                                                layout->numColsPerBlock,
+                                                "B", &error));
+    TEST_ASSERT(nitf_Field_setString(segment->subheader->imageCompression,
+                                     "C8", &error));
+
+    out = nitf_IOHandle_create(TEST_FILE_NAME, NITF_ACCESS_WRITEONLY,
+                               NITF_CREATE, &error);
+    TEST_ASSERT(!NITF_INVALID_HANDLE(out));
+    writer = nitf_Writer_construct(&error);
+    TEST_ASSERT(writer);
+    TEST_ASSERT(nitf_Writer_prepare(writer, record, out, &error));
+    imageWriter = nitf_Writer_newImageWriter(writer, 0, &error);
+    TEST_ASSERT(imageWriter);
+
+    source = nitf_ImageSource_construct(&error);
+    TEST_ASSERT(source);
+    for (band = 0; band < layout->numBands; band++)
+    {
+        nitf_BandSource *bandSource;
+
+        data[band] = (nitf_Uint8 *) NITF_MALLOC(size);
+        TEST_ASSERT(data[band]);
+        for (row = 0; row < layout->numRows; row++)
+            for (col = 0; col < layout->numCols; col++)
+                data[band][(size_t) row * layout->numCols + col] =
+                    pixel(band, row, col);
+        bandSource = nitf_MemorySource_construct((char *) data[band], size,
+                                                 0, 1, 0, &error);
+        TEST_ASSERT(bandSource);
+        TEST_ASSERT(nitf_ImageSource_addBand(source, bandSource, &error));
+    }
+    TEST_ASSERT(nitf_ImageWriter_attachSource(imageWriter, source, &error));
+    TEST_ASSERT(nitf_Writer_write(writer, &error));
+
+    nitf_IOHandle_close(out);
+    nitf_Writer_destruct(&writer);
+    nitf_Record_destruct(&record);
+    for (band = 0; band < layout->numBands; band++)
+        NITF_FREE(data[band]);
+}
+
+/* Read a window of a level into newly allocated band buffers */
+static void readWindow(const char *testName, const Layout *layout,
+                       nitf_ImageReader *image, nitf_Uint32 level,
+                       nitf_Uint32 startRow, nitf_Uint32 startCol,
+                       nitf_Uint32 numRows, nitf_Uint32 numCols,
+                       nitf_Uint8 **buffers)
+{
+    nitf_Error error;
+    nitf_SubWindow window;
+    nitf_Uint32 bandList[MAX_BANDS] = { 0, 1, 2 };
+    nitf_Uint32 band;
+    int padded;
+
+    memset(&window, 0, sizeof(window));
+    window.startRow = startRow;
+    window.startCol = startCol;
+    window.numRows = numRows;
+    window.numCols = numCols;
+    window.bandList = bandList;
+    window.numBands = layout->numBands;
+    for (band = 0; band < layout->numBands; band++)
+    {
+        buffers[band] = (nitf_Uint8 *) NITF_MALLOC((size_t) numRows
+                                                   * numCols);
+        TEST_ASSERT(buffers[band]);
+    }
+    TEST_ASSERT(nitf_ImageReader_readLevel(image, level, &window, buffers,
+                                           &padded, &error));
+}
+
+/* Box average of the pattern over the pixels a level pixel covers */
+static nitf_Uint32 boxAverage(const Layout *layout, nitf_Uint32 level,
+                              nitf_Uint32 band, nitf_Uint32 row,
+                              nitf_Uint32 col)
+{
+    nitf_Uint32 factor = ((nitf_Uint32) 1) << level;
+    nitf_Uint32 sum = 0;
+    nitf_Uint32 count = 0;
+    nitf_Uint32 r, c;
+
+    for (r = row * factor; r < (row + 1) * factor && r < layout->numRows;
+         r++)
+        for (c = col * factor; c < (col + 1) * factor && c < layout->numCols;
+             c++)
+        {
+            sum += pixel(band, r, c);
+            count++;
+        }
+    return (sum + count / 2) / count;
+}
+
+/*
+ *  Read a whole level, which must be close to the box average of the
+ *  image (JasPer averages, OpenJPEG keeps the wavelet low pass)
+ */
+static void readLevel(const char *testName, const Layout *layout,
+                      nitf_ImageReader *image, nitf_Uint32 number,
+                      Level *level)
+{
+    nitf_Uint32 factor = ((nitf_Uint32) 1) << number;
+    nitf_Uint64 totalError = 0;
+    nitf_Uint64 numPixels;
+    nitf_Uint32 band, row, col;
+
+    memset(level, 0, sizeof(Level));
+    level->level = number;
+    level->numRows = (layout->numRows + factor - 1) / factor;
+    level->numCols = (layout->numCols + factor - 1) / factor;
+    readWindow(testName, layout, image, number, 0, 0, level->numRows,
+               level->numCols, level->bands);
+
+    for (band = 0; band < layout->numBands; band++)
+        for (row = 0; row < level->numRows; row++)
+            for (col = 0; col < level->numCols; col++)
+            {
+                nitf_Uint32 want = boxAverage(layout, number, band, row, col);
+                nitf_Uint32 got =
+                    level->bands[band][(size_t) row * level->numCols + col];
+
+                totalError += want > got ? want - got : got - want;
+            }
+    numPixels = (nitf_Uint64) layout->numBands * level->numRows
+        * level->numCols;
+    TEST_ASSERT(totalError * 16 <= numPixels * MAX_MEAN_ERROR);
+}
+
+/* Read a window of a level and compare it with the whole level */
+static void checkWindow(const char *testName, const Layout *layout,
+                        nitf_ImageReader *image, const Level *level,
+                        nitf_Uint32 startRow, nitf_Uint32 startCol,
+                        nitf_Uint32 numRows, nitf_Uint32 numCols)
+{
+    nitf_Uint8 *buffers[MAX_BANDS];
+    nitf_Uint32 band, row, col;
+
+    readWindow(testName, layout, image, level->level, startRow, startCol,
+               numRows, numCols, buffers);
+    for (band = 0; band < layout->numBands; band++)
+    {
+        for (row = 0; row < numRows; row++)
+            for (col = 0; col < numCols; col++)
+                TEST_ASSERT_EQ_INT(buffers[band][(size_t) row * numCols
+                                                 + col],
+                                   level->bands[band][(size_t) (startRow
+                                                                + row)
+                                                      * level->numCols
+                                                      + startCol + col]);
+        NITF_FREE(buffers[band]);
+    }
+}
+
+/* Windows inside, at the edge and across the blocks of a level */
+static void checkWindows(const char *testName, const Layout *layout,
+                         nitf_ImageReader *image, const Level *level)
+{
+    nitf_Uint32 blockRows = layout->numRowsPerBlock >> level->level;
+    nitf_Uint32 blockCols = layout->numColsPerBlock >> level->level;
+
+    checkWindow(testName, layout, image, level, level->numRows / 7,
+                level->numCols / 9, level->numRows / 2,
+                level->numCols * 2 / 3);
+    checkWindow(testName, layout, image, level, level->numRows - 3,
+                level->numCols - 4, 3, 4);
+    checkWindow(testName, layout, image, level, blockRows - 2,
+                blockCols - 2, blockRows, blockCols + 3);
+}
+
+/*
+ *  Level 0 must match the image. Each reduced level is read whole, and
+ *  windows read plainly and through a small cache with decode threads
+ *  must match it. A level whose scale does not divide the block size is
+ *  rejected.
+ */
+static void readLevels(const char *testName, const Layout *layout,
+                       nitf_Uint32 maxLevel)
+{
+    nitf_Error error;
+    nitf_IOHandle in;
+    nitf_Reader *reader;
+    nitf_Record *record;
+    nitf_ImageReader *plain;
+    nitf_ImageReader *threaded;
+    nitf_SubWindow window;
+    nitf_Uint32 bandList[1] = { 0 };
+    nitf_Uint8 *buffers[MAX_BANDS];
+    nitf_Uint32 number, band, row, col;
+    int padded;
+
+    writeImage(testName, layout);
+    in = nitf_IOHandle_create(TEST_FILE_NAME, NITF_ACCESS_READONLY,
+                              NITF_OPEN_EXISTING, &error);
+    TEST_ASSERT(!NITF_INVALID_HANDLE(in));
+    reader = nitf_Reader_construct(&error);
+    TEST_ASSERT(reader);
+    record = nitf_Reader_read(reader, in, &error);
+    TEST_ASSERT(record);
+    plain = nitf_Reader_newImageReader(reader, 0, &error);
+    TEST_ASSERT(plain);
+    threaded = nitf_Reader_newImageReader(reader, 0, &error);
+    TEST_ASSERT(threaded);
+    nitf_ImageReader_setReadCacheSize(threaded,
+                                      3 * (size_t) layout->numRowsPerBlock
+                                      * layout->numColsPerBlock
+                                      * layout->numBands);
+    nitf_ImageReader_setDecodeThreads(threaded, 3);
+
+    readWindow(testName, layout, plain, 0, 0, 0, layout->numRows,
+               layout->numCols, buffers);
+    for (band = 0; band < layout->numBands; band++)
+    {
+        for (row = 0; row < layout->numRows; row++)
+            for (col = 0; col < layout->numCols; col++)
+                TEST_ASSERT_EQ_INT(buffers[band][(size_t) row
+                                                 * layout->numCols + col],
+                                   pixel(band, row, col));
+        NITF_FREE(buffers[band]);
+    }
+
+    for (number = 1; number <= maxLevel; number++)
+    {
+        Level level;
+
+        readLevel(testName, layout, plain, number, &level);
+        checkWindows(testName, layout, plain, &level);
+        checkWindows(testName, layout, threaded, &level);
+        for (band = 0; band < layout->numBands; band++)
+            NITF_FREE(level.bands[band]);
+    }
+
+    /* The scale of the next level does not divide the blocks */
+    number = maxLevel + 1;
+    while (layout->numRowsPerBlock % (((nitf_Uint32) 1) << number) == 0 &&
+           layout->numColsPerBlock % (((nitf_Uint32) 1) << number) == 0)
+        number++;
+    memset(&window, 0, sizeof(window));
+    window.numRows = 1;
+    window.numCols = 1;
+    window.bandList = bandList;
+    window.numBands = 1;
+    TEST_ASSERT(!nitf_ImageReader_readLevel(plain, number, &window,
+                                            buffers, &padded, &error));
+
+    nitf_ImageReader_destruct(&threaded);
+    nitf_ImageReader_destruct(&plain);
+    nitf_Record_destruct(&record);
+    nitf_Reader_destruct(&reader);
+    nitf_IOHandle_close(in);
+}
+
+TEST_CASE(testOneBand)
+{
+    /* Edge blocks are partial, so reduced blocks are clipped */
+    Layout layout = { 1, 300, 250, 64, 64 };
+
+    readLevels(testName, &layout, 3);
+}
+
+TEST_CASE(testThreeBands)
+{
+    Layout layout = { 3, 130, 170, 32, 32 };
+
+    readLevels(testName, &layout, 2);
+}
+
+int main(int argc, char **argv)
+{
+    if (!havePlugins())
+    {
+        fprintf(stderr, "%s : SKIPPED, needs the J2K plug-ins\n", argv[0]);
+        return 0;
+    }
+
+    /* Encode on a thread pool, the serial writer needs whole tiles */
+    putenv("NITF_J2K_ENCODE_THREADS=2");
+    CHECK(testOneBand);
+    CHECK(testThreeBands);
+    remove(TEST_FILE_NAME);
+    return 0;
+}
@@ -0,0 +1,352 @@
+/* =========================================================================
+ * This file is part of NITRO
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2010, General Dynamics - Advanced Information Systems
+ *
+ * NITRO is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ *  The J2K compression and decompression plug-ins must be on
+ *  NITF_PLUGIN_PATH, otherwise the test is skipped.
+ */
+
+#include <import/nitf.h>
+#include "Test.h"
+
+#define TEST_FILE_NAME "test_j2k_region.ntf"
+#define MAX_BANDS 3
+#define NUM_CHIPS 7
+
+/* Read modes */
+typedef enum
+{
+    READ_PLAIN,
+    READ_CACHED,
+    READ_THREADS
+}
+ReadMode;
+
+typedef struct
+{
+    nitf_Uint32 numBands;
+    nitf_Uint32 numBits;
+    nitf_Uint32 numBitsActual;
+    nitf_Uint32 numRows;
+    nitf_Uint32 numCols;
+    nitf_Uint32 numRowsPerBlock;
+    nitf_Uint32 numColsPerBlock;
+}
+Layout;
+
+static NITF_BOOL havePlugins(void)
+{
+    nitf_Error error;
+    nitf_PluginRegistry *registry;
+    int hadError = 0;
+
+    registry = nitf_PluginRegistry_getInstance(&error);
+    return registry &&
+        nitf_PluginRegistry_retrieveCompConstructor(registry, "C8",
+                                                    &hadError, &error) &&
+        nitf_PluginRegistry_retrieveDecompConstructor(registry, "C8",
+                                                      &hadError, &error);
+}
+
+static nitf_Uint32 pixel(const Layout *layout, nitf_Uint32 band,
+                         nitf_Uint32 row, nitf_Uint32 col)
+{
+    nitf_Uint32 value = (band * 97 + row * 7 + col * 3 + (row * col) % 13)
+        ^ ((row * 40503 + col * 9973) << 8);
+
+    return value & ((((nitf_Uint32) 1) << layout->numBitsActual) - 1);
+}
+
+/*
+ *  Write an image as "C8" through the J2K compression plug-in
+ */
+static void writeImage(const char *testName, const Layout *layout)
+{
+    nitf_Error error;
+    nitf_Record *record;
+    nitf_ImageSegment *segment;
+    nitf_BandInfo **bands;
+    nitf_Writer *writer;
+    nitf_ImageWriter *imageWriter;
+    nitf_ImageSource *source;
+    nitf_IOHandle out;
+    nitf_Uint32 bytes = layout->numBits / 8;
+    size_t size = (size_t) layout->numRows * layout->numCols * bytes;
+    nitf_Uint8 *data[MAX_BANDS];
+    nitf_Uint32 band, row, col;
+
+    record = nitf_Record_construct(NITF_VER_21, &error);
+    TEST_ASSERT(record);
+    segment = nitf_Record_newImageSegment(record, &error);
+    TEST_ASSERT(segment);
+    bands = (nitf_BandInfo **) NITF_MALLOC(sizeof(nitf_BandInfo *)
+                                           * layout->numBands);
+    TEST_ASSERT(bands);
+    for (band = 0; band < layout->numBands; band++)
+    {
+        bands[band] = nitf_BandInfo_construct(&error);
+        TEST_ASSERT(bands[band]);
+        TEST_ASSERT(nitf_BandInfo_init(bands[band], "M", " ", "N", "   ",
+                                       0, 0, NULL, &error));
+    }
+    TEST_ASSERT(nitf_ImageSubheader_setPixelInformation(segment->subheader,
+                                                        "INT",
+                                                        layout->numBits,
+                                                        layout->numBitsActual,
+                                                        "R",
+                                                        layout->numBands == 1 ?
+                                                        "MONO" : "MULTI",
+                                                        "VIS",
+                                                        layout->numBands,
+                                                        bands, &error));
+    TEST_ASSERT(nitf_ImageSubheader_setBlocking(segment->subheader,
+                                                layout->numRows,
+                                                layout->numCols,
+                                                layout->numRowsPerBlock,
+                                                layout->numColsPerBlock,
+                                                "B", &error));
+    TEST_ASSERT(nitf_Field_setString(segment->subheader->imageCompression,
+                                     "C8", &error));
+
+    out = nitf_IOHandle_create(TEST_FILE_NAME, NITF_ACCESS_WRITEONLY,
+                               NITF_CREATE, &error);
+    TEST_ASSERT(!NITF_INVALID_HANDLE(out));
+    writer = nitf_Writer_construct(&error);
+    TEST_ASSERT(writer);
+    TEST_ASSERT(nitf_Writer_prepare(writer, record, out, &error));
+    imageWriter = nitf_Writer_newImageWriter(writer, 0, &error);
+    TEST_ASSERT(imageWriter);
+
+    source = nitf_ImageSource_construct(&error);
+    TEST_ASSERT(source);
+    for (band = 0; band < layout->numBands; band++)
+    {
+        nitf_BandSource *bandSource;
+
+        data[band] = (nitf_Uint8 *) NITF_MALLOC(size);
+        TEST_ASSERT(data[band]);
+        for (row = 0; row < layout->numRows; row++)
+            for (col = 0; col < layout->numCols; col++)
+            {
+                size_t n = (size_t) row * layout->numCols + col;
+
+                if (bytes == 1)
+                    data[band][n] = (nitf_Uint8) pixel(layout, band, row,
+                                                       col);
+                else
+                    ((nitf_Uint16 *) data[band])[n] =
+                        (nitf_Uint16) pixel(layout, band, row, col);
+            }
+        bandSource = nitf_MemorySource_construct((char *) data[band], size,
+                                                 0, bytes, 0, &error);
+        TEST_ASSERT(bandSource);
+        TEST_ASSERT(nitf_ImageSource_addBand(source, bandSource, &error));
+    }
+    TEST_ASSERT(nitf_ImageWriter_attachSource(imageWriter, source, &error));
+    TEST_ASSERT(nitf_Writer_write(writer, &error));
+
+    nitf_IOHandle_close(out);
+    nitf_Writer_destruct(&writer);
+    nitf_Record_destruct(&record);
+    for (band = 0; band < layout->numBands; band++)
+        NITF_FREE(data[band]);
+}
+
+/*
+ *  Read a window of the given bands and check it against the pattern
+ */
+static void checkWindow(const char *testName, const Layout *layout,
+                        nitf_ImageReader *image, nitf_Uint32 startRow,
+                        nitf_Uint32 startCol, nitf_Uint32 numRows,
+                        nitf_Uint32 numCols, nitf_Uint32 numBands)
+{
+    nitf_Error error;
+    nitf_SubWindow window;
+    nitf_Uint32 bandList[MAX_BANDS] = { 0, 1, 2 };
+    nitf_Uint8 *buffers[MAX_BANDS];
+    nitf_Uint32 bytes = layout->numBits / 8;
+    nitf_Uint32 band, row, col;
+    int padded;
+
+    memset(&window, 0, sizeof(window));
+    window.startRow = startRow;
+    window.startCol = startCol;
+    window.numRows = numRows;
+    window.numCols = numCols;
+    window.bandList = bandList + layout->numBands - numBands;
+    window.numBands = numBands;
+    for (band = 0; band < numBands; band++)
+    {
+        buffers[band] = (nitf_Uint8 *) NITF_MALLOC((size_t) numRows
+                                                   * numCols * bytes);
+        TEST_ASSERT(buffers[band]);
+    }
+    TEST_ASSERT(nitf_ImageReader_read(image, &window, buffers, &padded,
+                                      &error));
+    for (band = 0; band < numBands; band++)
+    {
+        for (row = 0; row < numRows; row++)
+            for (col = 0; col < numCols; col++)
+            {
+                size_t n = (size_t) row * numCols + col;
+                nitf_Uint32 got = bytes == 1 ? buffers[band][n] :
+                    ((nitf_Uint16 *) buffers[band])[n];
+
+                TEST_ASSERT_EQ_INT(got, pixel(layout,
+                                              window.bandList[band],
+                                              startRow + row,
+                                              startCol + col));
+            }
+        NITF_FREE(buffers[band]);
+    }
+}
+
+/*
+ *  Read chips in an order that makes the read cache widen the valid
+ *  rectangle of a block: a chip, chips beside, above and across it, and
+ *  finally the whole image, then the last band of the first chips.
+ *  Every chip must match the pattern, uncached, cached and with decode
+ *  threads.
+ */
+static void readChips(const char *testName, const Layout *layout)
+{
+    nitf_Uint32 rows = layout->numRowsPerBlock;
+    nitf_Uint32 cols = layout->numColsPerBlock;
+    nitf_Uint32 chips[NUM_CHIPS][4];
+    int mode;
+    int i;
+
+    chips[0][0] = rows / 3;
+    chips[0][1] = cols / 4;
+    chips[0][2] = 9;
+    chips[0][3] = 11;
+
+    chips[1][0] = rows / 3;
+    chips[1][1] = cols / 2;
+    chips[1][2] = 9;
+    chips[1][3] = 20;
+
+    chips[2][0] = 2;
+    chips[2][1] = cols / 4 + 5;
+    chips[2][2] = 7;
+    chips[2][3] = 6;
+
+    chips[3][0] = rows / 2;
+    chips[3][1] = cols / 5;
+    chips[3][2] = rows / 3;
+    chips[3][3] = cols / 3;
+
+    /* Across the blocks (if there are several), and the edge block */
+    chips[4][0] = rows + 6 <= layout->numRows ? rows - 4 :
+        layout->numRows - 10;
+    chips[4][1] = cols + 6 <= layout->numCols ? cols - 6 :
+        layout->numCols - 12;
+    chips[4][2] = 10;
+    chips[4][3] = 12;
+
+    chips[5][0] = layout->numRows - 5;
+    chips[5][1] = layout->numCols - 7;
+    chips[5][2] = 5;
+    chips[5][3] = 7;
+
+    chips[6][0] = 0;
+    chips[6][1] = 0;
+    chips[6][2] = layout->numRows;
+    chips[6][3] = layout->numCols;
+
+    writeImage(testName, layout);
+    for (mode = READ_PLAIN; mode <= READ_THREADS; mode++)
+    {
+        nitf_Error error;
+        nitf_IOHandle in;
+        nitf_Reader *reader;
+        nitf_Record *record;
+        nitf_ImageReader *image;
+
+        in = nitf_IOHandle_create(TEST_FILE_NAME, NITF_ACCESS_READONLY,
+                                  NITF_OPEN_EXISTING, &error);
+        TEST_ASSERT(!NITF_INVALID_HANDLE(in));
+        reader = nitf_Reader_construct(&error);
+        TEST_ASSERT(reader);
+        record = nitf_Reader_read(reader, in, &error);
+        TEST_ASSERT(record);
+        image = nitf_Reader_newImageReader(reader, 0, &error);
+        TEST_ASSERT(image);
+        if (mode != READ_PLAIN)
+            nitf_ImageReader_setReadCacheSize(image,
+                                              4 * (size_t) rows * cols
+                                              * layout->numBands
+                                              * (layout->numBits / 8));
+        if (mode == READ_THREADS)
+            nitf_ImageReader_setDecodeThreads(image, 3);
+
+        for (i = 0; i < NUM_CHIPS; i++)
+            checkWindow(testName, layout, image, chips[i][0], chips[i][1],
+                        chips[i][2], chips[i][3], layout->numBands);
+        for (i = 0; i < 2; i++)
+            checkWindow(testName, layout, image, chips[i][0], chips[i][1],
+                        chips[i][2], chips[i][3], 1);
+
+        nitf_ImageReader_destruct(&image);
+        nitf_Record_destruct(&record);
+        nitf_Reader_destruct(&reader);
+        nitf_IOHandle_close(in);
+    }
+}
+
+TEST_CASE(testSingleTile)
+{
+    Layout layout = { 1, 8, 8, 256, 256, 256, 256 };
+
+    readChips(testName, &layout);
+}
+
+TEST_CASE(testPartialTiles)
+{
+    Layout layout = { 3, 8, 8, 300, 250, 128, 160 };
+
+    readChips(testName, &layout);
+}
+
+TEST_CASE(test12Bit)
+{
+    Layout layout = { 1, 16, 12, 200, 180, 128, 128 };
+
+    readChips(testName, &layout);
+}
+
+int main(int argc, char **argv)
+{
+    if (!havePlugins())
+    {
+        fprintf(stderr, "%s : SKIPPED, needs the J2K plug-ins\n", argv[0]);
+        return 0;
+    }
+
+    /* Encode on a thread pool, the serial writer needs whole tiles */
+    putenv("NITF_J2K_ENCODE_THREADS=2");
+    CHECK(testSingleTile);
+    CHECK(testPartialTiles);
+    CHECK(test12Bit);
+    remove(TEST_FILE_NAME);
+    return 0;
+}
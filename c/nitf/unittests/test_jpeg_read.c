@@ -0,0 +1,469 @@
+/* =========================================================================
+ * This file is part of NITRO
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2010, General Dynamics - Advanced Information Systems
+ *
+ * NITRO is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ *  The library has no JPEG compressor, so the JPEG (C3 or M3) files are
+ *  given on the command line, and read through the libjpeg plug-in on
+ *  NITF_PLUGIN_PATH. Without either, the test is skipped.
+ *
+ *  Usage: test_jpeg_read <JPEG NITF> [JPEG NITF...]
+ */
+
+#include <import/nitf.h>
+#include "Test.h"
+
+#define COPY_FILE_NAME "test_jpeg_read_copy.ntf"
+#define MAX_BANDS 3
+#define NUM_THREADS 6
+#define NUM_READS 40
+
+/* The image of a file, read whole, which every other read must match */
+typedef struct
+{
+    nitf_Uint32 numRows;
+    nitf_Uint32 numCols;
+    nitf_Uint32 numBands;
+    nitf_Uint32 numRowsPerBlock;
+    nitf_Uint32 numColsPerBlock;
+    nitf_Uint32 bytes;
+    nitf_Uint8 *bands[MAX_BANDS];
+}
+Reference;
+
+typedef struct
+{
+    const Reference *reference;
+    nitf_ImageReader *image;
+    nitf_Uint32 seed;
+    int mismatches;
+    int failed;
+}
+ReadJob;
+
+static NITF_BOOL haveDecompressor(void)
+{
+    nitf_Error error;
+    nitf_PluginRegistry *registry;
+    int hadError = 0;
+
+    registry = nitf_PluginRegistry_getInstance(&error);
+    return registry &&
+        nitf_PluginRegistry_retrieveDecompConstructor(registry, "C3",
+                                                      &hadError, &error);
+}
+
+static nitf_Uint32 getUint32(nitf_Field *field)
+{
+    nitf_Error error;
+    nitf_Uint32 value = 0;
+
+    nitf_Field_get(field, &value, NITF_CONV_UINT, sizeof(value), &error);
+    return value;
+}
+
+static nitf_Record *openFile(const char *testName, const char *fileName,
+                             nitf_Reader **reader, nitf_IOHandle *in,
+                             nitf_ImageReader **image)
+{
+    nitf_Error error;
+    nitf_Record *record;
+
+    *in = nitf_IOHandle_create(fileName, NITF_ACCESS_READONLY,
+                               NITF_OPEN_EXISTING, &error);
+    TEST_ASSERT(!NITF_INVALID_HANDLE(*in));
+    *reader = nitf_Reader_construct(&error);
+    TEST_ASSERT(*reader);
+    record = nitf_Reader_read(*reader, *in, &error);
+    TEST_ASSERT(record);
+    *image = nitf_Reader_newImageReader(*reader, 0, &error);
+    TEST_ASSERT(*image);
+    return record;
+}
+
+static void closeFile(nitf_Record **record, nitf_Reader **reader,
+                      nitf_IOHandle in, nitf_ImageReader **image)
+{
+    nitf_ImageReader_destruct(image);
+    nitf_Record_destruct(record);
+    nitf_Reader_destruct(reader);
+    nitf_IOHandle_close(in);
+}
+
+/*
+ *  Read a window of all bands and count the rows that differ from the
+ *  reference, or return -1 if the read fails
+ */
+static int readWindow(const Reference *reference, nitf_ImageReader *image,
+                      nitf_Uint32 startRow, nitf_Uint32 startCol,
+                      nitf_Uint32 numRows, nitf_Uint32 numCols)
+{
+    nitf_Error error;
+    nitf_SubWindow window;
+    nitf_Uint32 bandList[MAX_BANDS];
+    nitf_Uint8 *buffers[MAX_BANDS];
+    size_t rowBytes = (size_t) numCols * reference->bytes;
+    size_t fullRowBytes = (size_t) reference->numCols * reference->bytes;
+    nitf_Uint32 band, row;
+    int mismatches = 0;
+    int padded;
+
+    memset(&window, 0, sizeof(window));
+    window.startRow = startRow;
+    window.startCol = startCol;
+    window.numRows = numRows;
+    window.numCols = numCols;
+    window.bandList = bandList;
+    window.numBands = reference->numBands;
+    for (band = 0; band < reference->numBands; band++)
+    {
+        bandList[band] = band;
+        buffers[band] = (nitf_Uint8 *) NITF_MALLOC(rowBytes * numRows);
+        if (!buffers[band])
+            return -1;
+    }
+
+    if (!nitf_ImageReader_read(image, &window, buffers, &padded, &error))
+        mismatches = -1;
+    for (band = 0; band < reference->numBands; band++)
+    {
+        for (row = 0; mismatches >= 0 && row < numRows; row++)
+            if (memcmp(buffers[band] + row * rowBytes,
+                       reference->bands[band] + (startRow + row) *
+                       fullRowBytes + startCol * reference->bytes,
+                       rowBytes) != 0)
+                mismatches++;
+        NITF_FREE(buffers[band]);
+    }
+    return mismatches;
+}
+
+/*
+ *  Windows that cover the image, the middle, a corner and block edges
+ */
+static void checkWindows(const char *testName, const Reference *reference,
+                         nitf_ImageReader *image)
+{
+    nitf_Uint32 rowEdge = reference->numRowsPerBlock < reference->numRows ?
+        reference->numRowsPerBlock : 0;
+    nitf_Uint32 colEdge = reference->numColsPerBlock < reference->numCols ?
+        reference->numColsPerBlock : 0;
+
+    TEST_ASSERT_EQ_INT(readWindow(reference, image, 0, 0,
+                                  reference->numRows, reference->numCols),
+                       0);
+    TEST_ASSERT_EQ_INT(readWindow(reference, image, reference->numRows / 3,
+                                  reference->numCols / 3,
+                                  reference->numRows / 3 + 1,
+                                  reference->numCols / 3 + 1), 0);
+    TEST_ASSERT_EQ_INT(readWindow(reference, image, reference->numRows - 1,
+                                  reference->numCols - 1, 1, 1), 0);
+    TEST_ASSERT_EQ_INT(readWindow(reference, image,
+                                  rowEdge ? rowEdge - 3 : 0,
+                                  colEdge ? colEdge - 3 : 0,
+                                  rowEdge ? 6 : reference->numRows,
+                                  colEdge ? 6 : reference->numCols), 0);
+}
+
+/*
+ *  Read the whole image of a file as the reference, and check that it
+ *  reads the same a second time
+ */
+static void readReference(const char *testName, const char *fileName,
+                          Reference *reference)
+{
+    nitf_Error error;
+    nitf_IOHandle in;
+    nitf_Reader *reader;
+    nitf_Record *record;
+    nitf_ImageReader *image;
+    nitf_ImageSubheader *subheader;
+    nitf_SubWindow window;
+    nitf_Uint32 bandList[MAX_BANDS];
+    nitf_Uint32 band;
+    int padded;
+
+    memset(reference, 0, sizeof(Reference));
+    record = openFile(testName, fileName, &reader, &in, &image);
+    subheader =
+        ((nitf_ImageSegment *) record->images->first->data)->subheader;
+    reference->numRows = getUint32(subheader->numRows);
+    reference->numCols = getUint32(subheader->numCols);
+    reference->numBands = getUint32(subheader->numImageBands);
+    reference->numRowsPerBlock = getUint32(subheader->numPixelsPerVertBlock);
+    reference->numColsPerBlock =
+        getUint32(subheader->numPixelsPerHorizBlock);
+    reference->bytes =
+        NITF_NBPP_TO_BYTES(getUint32(subheader->numBitsPerPixel));
+    TEST_ASSERT(reference->numBands > 0 && reference->numBands <= MAX_BANDS);
+
+    memset(&window, 0, sizeof(window));
+    window.numRows = reference->numRows;
+    window.numCols = reference->numCols;
+    window.bandList = bandList;
+    window.numBands = reference->numBands;
+    for (band = 0; band < reference->numBands; band++)
+    {
+        bandList[band] = band;
+        reference->bands[band] = (nitf_Uint8 *)
+            NITF_MALLOC((size_t) reference->numRows * reference->numCols *
+                        reference->bytes);
+        TEST_ASSERT(reference->bands[band]);
+    }
+    TEST_ASSERT(nitf_ImageReader_read(image, &window, reference->bands,
+                                      &padded, &error));
+    checkWindows(testName, reference, image);
+    closeFile(&record, &reader, in, &image);
+}
+
+static void freeReference(Reference *reference)
+{
+    nitf_Uint32 band;
+
+    for (band = 0; band < reference->numBands; band++)
+        NITF_FREE(reference->bands[band]);
+}
+
+/*
+ *  Reopen the file a few times, each open builds its own block table
+ */
+static void checkReopen(const char *testName, const char *fileName,
+                        const Reference *reference)
+{
+    nitf_IOHandle in;
+    nitf_Reader *reader;
+    nitf_Record *record;
+    nitf_ImageReader *image;
+    int pass;
+
+    for (pass = 0; pass < 3; pass++)
+    {
+        record = openFile(testName, fileName, &reader, &in, &image);
+        checkWindows(testName, reference, image);
+        closeFile(&record, &reader, in, &image);
+    }
+}
+
+/*
+ *  Copy a file with the SOI marker of the next to last block stream
+ *  overwritten. The copy starts like the original, but its block table
+ *  is missing a stream, so it must not read like the original.
+ */
+static void checkDamaged(const char *testName, const char *fileName,
+                         const Reference *reference)
+{
+    nitf_Error error;
+    nitf_IOHandle in;
+    nitf_IOHandle out;
+    nitf_Reader *reader;
+    nitf_Record *record;
+    nitf_ImageReader *image;
+    nitf_ImageSegment *segment;
+    nitf_Off size;
+    nitf_Uint64 i;
+    nitf_Off last = -1;
+    nitf_Off previous = -1;
+    char *data;
+
+    record = openFile(testName, fileName, &reader, &in, &image);
+    segment = (nitf_ImageSegment *) record->images->first->data;
+    size = nitf_IOHandle_getSize(in, &error);
+    TEST_ASSERT(size > 0);
+    data = (char *) NITF_MALLOC((size_t) size);
+    TEST_ASSERT(data);
+    TEST_ASSERT(NITF_IO_SUCCESS(nitf_IOHandle_seek(in, 0, NITF_SEEK_SET,
+                                                   &error)));
+    TEST_ASSERT(nitf_IOHandle_read(in, data, (size_t) size, &error));
+    for (i = segment->imageOffset; i + 1 < segment->imageEnd; i++)
+        if ((nitf_Uint8) data[i] == 0xFF && (nitf_Uint8) data[i + 1] == 0xD8)
+        {
+            previous = last;
+            last = (nitf_Off) i;
+        }
+    closeFile(&record, &reader, in, &image);
+
+    /* A single stream image has no next to last stream */
+    if (previous >= 0)
+    {
+        data[previous] = 0;
+        data[previous + 1] = 0;
+        out = nitf_IOHandle_create(COPY_FILE_NAME, NITF_ACCESS_WRITEONLY,
+                                   NITF_CREATE, &error);
+        TEST_ASSERT(!NITF_INVALID_HANDLE(out));
+        TEST_ASSERT(nitf_IOHandle_write(out, data, (size_t) size, &error));
+        nitf_IOHandle_close(out);
+
+        record = openFile(testName, COPY_FILE_NAME, &reader, &in, &image);
+        TEST_ASSERT(readWindow(reference, image, 0, 0, reference->numRows,
+                               reference->numCols) != 0);
+        closeFile(&record, &reader, in, &image);
+    }
+    NITF_FREE(data);
+}
+
+TEST_CASE_ARGS(testReopen)
+{
+    Reference reference;
+    int i;
+
+    for (i = 1; i < argc; i++)
+    {
+        readReference(testName, argv[i], &reference);
+        checkReopen(testName, argv[i], &reference);
+        freeReference(&reference);
+    }
+}
+
+TEST_CASE_ARGS(testDamaged)
+{
+    Reference reference;
+    int i;
+
+    for (i = 1; i < argc; i++)
+    {
+        readReference(testName, argv[i], &reference);
+        checkDamaged(testName, argv[i], &reference);
+
+        /* And the original still reads */
+        checkReopen(testName, argv[i], &reference);
+        freeReference(&reference);
+    }
+}
+
+static nitf_Uint32 nextRandom(nitf_Uint32 *seed, nitf_Uint32 range)
+{
+    *seed = *seed * 1103515245 + 12345;
+    return ((*seed >> 16) & 0x7fff) % range;
+}
+
+static void readWindows(void *data)
+{
+    ReadJob *job = (ReadJob *) data;
+    const Reference *reference = job->reference;
+    int i;
+
+    for (i = 0; i < NUM_READS && !job->failed; i++)
+    {
+        nitf_Uint32 numRows = 1 + nextRandom(&job->seed,
+                                             reference->numRows);
+        nitf_Uint32 numCols = 1 + nextRandom(&job->seed,
+                                             reference->numCols);
+        nitf_Uint32 startRow =
+            nextRandom(&job->seed, reference->numRows - numRows + 1);
+        nitf_Uint32 startCol =
+            nextRandom(&job->seed, reference->numCols - numCols + 1);
+        int found = readWindow(reference, job->image, startRow, startCol,
+                               numRows, numCols);
+
+        if (found < 0)
+            job->failed = 1;
+        else
+            job->mismatches += found;
+    }
+}
+
+/*
+ *  Read with decode threads and a cache of four blocks, first window by
+ *  window and then from several threads at once
+ */
+static void checkThreads(const char *testName, nitf_IOInterface *io,
+                         const Reference *reference)
+{
+    nitf_Error error;
+    nitf_Reader *reader;
+    nitf_Record *record;
+    nitf_ImageReader *image;
+    nitf_Thread threads[NUM_THREADS];
+    ReadJob jobs[NUM_THREADS];
+    int i;
+
+    TEST_ASSERT(io);
+    reader = nitf_Reader_construct(&error);
+    TEST_ASSERT(reader);
+    record = nitf_Reader_readIO(reader, io, &error);
+    TEST_ASSERT(record);
+    image = nitf_Reader_newImageReader(reader, 0, &error);
+    TEST_ASSERT(image);
+    nitf_ImageReader_setDecodeThreads(image, 4);
+    nitf_ImageReader_setReadCacheSize(image, 4 * reference->numBands *
+                                      reference->numRowsPerBlock *
+                                      reference->numColsPerBlock *
+                                      reference->bytes);
+    checkWindows(testName, reference, image);
+
+    for (i = 0; i < NUM_THREADS; i++)
+    {
+        jobs[i].reference = reference;
+        jobs[i].image = image;
+        jobs[i].seed = i + 1;
+        jobs[i].mismatches = 0;
+        jobs[i].failed = 0;
+        TEST_ASSERT(nitf_Thread_create(&threads[i], readWindows, &jobs[i],
+                                       &error));
+    }
+    for (i = 0; i < NUM_THREADS; i++)
+    {
+        nitf_Thread_join(&threads[i]);
+        TEST_ASSERT(!jobs[i].failed);
+        TEST_ASSERT_EQ_INT(jobs[i].mismatches, 0);
+    }
+
+    nitf_ImageReader_destruct(&image);
+    nitf_Record_destruct(&record);
+    nitf_Reader_destruct(&reader);
+    nitf_IOInterface_close(io, &error);
+    nitf_IOInterface_destruct(&io);
+}
+
+TEST_CASE_ARGS(testThreads)
+{
+    nitf_Error error;
+    Reference reference;
+    int i;
+
+    for (i = 1; i < argc; i++)
+    {
+        readReference(testName, argv[i], &reference);
+        checkThreads(testName,
+                     nitf_IOHandleAdapter_open(argv[i],
+                                               NITF_ACCESS_READONLY,
+                                               NITF_OPEN_EXISTING, &error),
+                     &reference);
+        checkThreads(testName, nitf_MMapAdapter_open(argv[i], &error),
+                     &reference);
+        freeReference(&reference);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2 || !haveDecompressor())
+    {
+        fprintf(stderr, "%s : SKIPPED, needs JPEG NITF files and the "
+                "libjpeg plug-in\n", argv[0]);
+        return 0;
+    }
+    CHECK_ARGS(testReopen);
+    CHECK_ARGS(testDamaged);
+    CHECK_ARGS(testThreads);
+    remove(COPY_FILE_NAME);
+    return 0;
+}
@@ -0,0 +1,373 @@
+/* =========================================================================
+ * This file is part of NITRO
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2010, General Dynamics - Advanced Information Systems
+ *
+ * NITRO is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <import/nitf.h>
+#include "Test.h"
+
+#define TEST_FILE_NAME "test_lazy_tres.ntf"
+#define COPY_FILE_NAME "test_lazy_tres_copy.ntf"
+#define NUM_ROWS 150
+#define NUM_COLS 130
+#define NUM_TRES 5
+
+static nitf_Uint8 pixel(nitf_Uint32 row, nitf_Uint32 col)
+{
+    return (nitf_Uint8) (row * 7 + col * 3 + (row * col) % 13);
+}
+
+static char treByte(const char *tag, size_t i)
+{
+    return (char) ('A' + (i * 7 + (unsigned char) tag[3]) % 26);
+}
+
+static nitf_ImageSubheader *getSubheader(nitf_Record *record)
+{
+    return ((nitf_ImageSegment *) record->images->first->data)->subheader;
+}
+
+/*
+ *  Append a TRE with no handler, which is written and read back as raw
+ *  data
+ */
+static void appendTRE(const char *testName, nitf_Extensions *ext,
+                      const char *tag, size_t length)
+{
+    nitf_Error error;
+    nitf_TRE *tre;
+    char *data;
+    size_t i;
+
+    data = (char *) NITF_MALLOC(length);
+    TEST_ASSERT(data);
+    for (i = 0; i < length; i++)
+        data[i] = treByte(tag, i);
+    tre = nitf_TRE_construct(tag, NITF_TRE_RAW, &error);
+    TEST_ASSERT(tre);
+    TEST_ASSERT(nitf_TRE_setField(tre, NITF_TRE_RAW, data, length, &error));
+    TEST_ASSERT(nitf_Extensions_appendTRE(ext, tre, &error));
+    NITF_FREE(data);
+}
+
+static nitf_TRE *findTRE(nitf_Extensions *ext, const char *tag)
+{
+    nitf_List *list = nitf_Extensions_getTREsByName(ext, tag);
+
+    return list && !nitf_List_isEmpty(list) ?
+        (nitf_TRE *) list->first->data : NULL;
+}
+
+static void checkTRE(const char *testName, nitf_Extensions *ext,
+                     const char *tag, size_t length)
+{
+    nitf_TRE *tre = findTRE(ext, tag);
+    nitf_Field *field;
+    size_t i;
+
+    TEST_ASSERT(tre);
+    field = nitf_TRE_getField(tre, NITF_TRE_RAW);
+    TEST_ASSERT(field);
+    TEST_ASSERT_EQ_INT(field->length, length);
+    for (i = 0; i < length; i++)
+        TEST_ASSERT_EQ_INT(field->raw[i], treByte(tag, i));
+}
+
+/*
+ *  Check every TRE of the file. Looking up the raw field parses a lazy
+ *  TRE.
+ */
+static void checkTREs(const char *testName, nitf_Record *record)
+{
+    checkTRE(testName, record->header->userDefinedSection, "TSTBIG", 20000);
+    checkTRE(testName, record->header->extendedSection, "TSTHDR", 300);
+    checkTRE(testName, getSubheader(record)->userDefinedSection,
+             "TSTIMG", 100);
+    checkTRE(testName, getSubheader(record)->extendedSection,
+             "TSTTWO", 3000);
+    checkTRE(testName, getSubheader(record)->extendedSection,
+             "TSTTHR", 50);
+}
+
+static int countLazy(nitf_Extensions *ext)
+{
+    nitf_ExtensionsIterator iter = nitf_Extensions_begin(ext);
+    nitf_ExtensionsIterator end = nitf_Extensions_end(ext);
+    nitf_Error error;
+    int lazy = 0;
+
+    while (nitf_ExtensionsIterator_notEqualTo(&iter, &end))
+    {
+        nitf_TRE *tre = nitf_ExtensionsIterator_get(&iter);
+
+        if (tre->handler == nitf_LazyTRE_handler(&error))
+            lazy++;
+        nitf_ExtensionsIterator_increment(&iter);
+    }
+    return lazy;
+}
+
+/*
+ *  The number of TREs in the record whose parsing is still deferred
+ */
+static int countLazyTREs(nitf_Record *record)
+{
+    return countLazy(record->header->userDefinedSection) +
+        countLazy(record->header->extendedSection) +
+        countLazy(getSubheader(record)->userDefinedSection) +
+        countLazy(getSubheader(record)->extendedSection);
+}
+
+/*
+ *  Write a record of a one band, 8-bit image of 64 by 48 blocks
+ */
+static void writeRecord(const char *testName, nitf_Record *record,
+                        const char *fileName)
+{
+    nitf_Error error;
+    nitf_Writer *writer;
+    nitf_ImageWriter *imageWriter;
+    nitf_ImageSource *source;
+    nitf_BandSource *bandSource;
+    nitf_IOHandle out;
+    static nitf_Uint8 data[NUM_ROWS * NUM_COLS];
+    nitf_Uint32 row, col;
+
+    for (row = 0; row < NUM_ROWS; row++)
+        for (col = 0; col < NUM_COLS; col++)
+            data[row * NUM_COLS + col] = pixel(row, col);
+
+    out = nitf_IOHandle_create(fileName, NITF_ACCESS_WRITEONLY,
+                               NITF_CREATE, &error);
+    TEST_ASSERT(!NITF_INVALID_HANDLE(out));
+    writer = nitf_Writer_construct(&error);
+    TEST_ASSERT(writer);
+    TEST_ASSERT(nitf_Writer_prepare(writer, record, out, &error));
+    imageWriter = nitf_Writer_newImageWriter(writer, 0, &error);
+    TEST_ASSERT(imageWriter);
+    source = nitf_ImageSource_construct(&error);
+    TEST_ASSERT(source);
+    bandSource = nitf_MemorySource_construct((char *) data,
+                                             NUM_ROWS * NUM_COLS, 0, 1, 0,
+                                             &error);
+    TEST_ASSERT(bandSource);
+    TEST_ASSERT(nitf_ImageSource_addBand(source, bandSource, &error));
+    TEST_ASSERT(nitf_ImageWriter_attachSource(imageWriter, source, &error));
+    TEST_ASSERT(nitf_Writer_write(writer, &error));
+
+    nitf_IOHandle_close(out);
+    nitf_Writer_destruct(&writer);
+}
+
+/*
+ *  Write the test file, with TREs in the file header and the image
+ *  subheader
+ */
+static void writeFile(const char *testName)
+{
+    nitf_Error error;
+    nitf_Record *record;
+    nitf_ImageSegment *segment;
+    nitf_BandInfo **bands;
+
+    record = nitf_Record_construct(NITF_VER_21, &error);
+    TEST_ASSERT(record);
+    segment = nitf_Record_newImageSegment(record, &error);
+    TEST_ASSERT(segment);
+    bands = (nitf_BandInfo **) NITF_MALLOC(sizeof(nitf_BandInfo *));
+    TEST_ASSERT(bands);
+    bands[0] = nitf_BandInfo_construct(&error);
+    TEST_ASSERT(bands[0]);
+    TEST_ASSERT(nitf_BandInfo_init(bands[0], "M", " ", "N", "   ",
+                                   0, 0, NULL, &error));
+    TEST_ASSERT(nitf_ImageSubheader_setPixelInformation(segment->subheader,
+                                                        "INT", 8, 8, "R",
+                                                        "MONO", "VIS", 1,
+                                                        bands, &error));
+    TEST_ASSERT(nitf_ImageSubheader_setBlocking(segment->subheader,
+                                                NUM_ROWS, NUM_COLS, 64, 48,
+                                                "B", &error));
+
+    appendTRE(testName, record->header->userDefinedSection, "TSTBIG", 20000);
+    appendTRE(testName, record->header->extendedSection, "TSTHDR", 300);
+    appendTRE(testName, segment->subheader->userDefinedSection,
+              "TSTIMG", 100);
+    appendTRE(testName, segment->subheader->extendedSection, "TSTTWO", 3000);
+    appendTRE(testName, segment->subheader->extendedSection, "TSTTHR", 50);
+
+    writeRecord(testName, record, TEST_FILE_NAME);
+    nitf_Record_destruct(&record);
+}
+
+static nitf_Record *readRecord(const char *testName, const char *fileName,
+                               NITF_BOOL lazy, nitf_Reader **reader,
+                               nitf_IOHandle *in)
+{
+    nitf_Error error;
+    nitf_Record *record;
+
+    *in = nitf_IOHandle_create(fileName, NITF_ACCESS_READONLY,
+                               NITF_OPEN_EXISTING, &error);
+    TEST_ASSERT(!NITF_INVALID_HANDLE(*in));
+    *reader = nitf_Reader_construct(&error);
+    TEST_ASSERT(*reader);
+    nitf_Reader_setLazyTREs(*reader, lazy);
+    record = nitf_Reader_read(*reader, *in, &error);
+    TEST_ASSERT(record);
+    return record;
+}
+
+static void closeRecord(nitf_Record **record, nitf_Reader **reader,
+                        nitf_IOHandle in)
+{
+    nitf_Record_destruct(record);
+    nitf_Reader_destruct(reader);
+    nitf_IOHandle_close(in);
+}
+
+static void checkPixels(const char *testName, nitf_Reader *reader)
+{
+    nitf_Error error;
+    nitf_ImageReader *image;
+    nitf_SubWindow window;
+    nitf_Uint32 bandList[1] = { 0 };
+    static nitf_Uint8 data[NUM_ROWS * NUM_COLS];
+    nitf_Uint8 *buffers[1];
+    nitf_Uint32 row, col;
+    int padded;
+
+    image = nitf_Reader_newImageReader(reader, 0, &error);
+    TEST_ASSERT(image);
+    memset(&window, 0, sizeof(window));
+    window.numRows = NUM_ROWS;
+    window.numCols = NUM_COLS;
+    window.bandList = bandList;
+    window.numBands = 1;
+    buffers[0] = data;
+    TEST_ASSERT(nitf_ImageReader_read(image, &window, buffers, &padded,
+                                      &error));
+    for (row = 0; row < NUM_ROWS; row++)
+        for (col = 0; col < NUM_COLS; col++)
+            TEST_ASSERT(data[row * NUM_COLS + col] == pixel(row, col));
+    nitf_ImageReader_destruct(&image);
+}
+
+TEST_CASE(testEager)
+{
+    nitf_IOHandle in;
+    nitf_Reader *reader;
+    nitf_Record *record;
+
+    writeFile(testName);
+    record = readRecord(testName, TEST_FILE_NAME, 0, &reader, &in);
+    TEST_ASSERT_EQ_INT(countLazyTREs(record), 0);
+    checkTREs(testName, record);
+    closeRecord(&record, &reader, in);
+}
+
+TEST_CASE(testUnparsed)
+{
+    nitf_IOHandle in;
+    nitf_Reader *reader;
+    nitf_Record *record;
+
+    record = readRecord(testName, TEST_FILE_NAME, 1, &reader, &in);
+    TEST_ASSERT_EQ_INT(countLazyTREs(record), NUM_TRES);
+
+    /* Reading the pixels does not touch the TREs */
+    checkPixels(testName, reader);
+    TEST_ASSERT_EQ_INT(countLazyTREs(record), NUM_TRES);
+
+    checkTREs(testName, record);
+    TEST_ASSERT_EQ_INT(countLazyTREs(record), 0);
+    closeRecord(&record, &reader, in);
+}
+
+TEST_CASE(testParseOne)
+{
+    nitf_Error error;
+    nitf_IOHandle in;
+    nitf_Reader *reader;
+    nitf_Record *record;
+    nitf_TRE *tre;
+
+    record = readRecord(testName, TEST_FILE_NAME, 1, &reader, &in);
+    tre = findTRE(getSubheader(record)->extendedSection, "TSTTWO");
+    TEST_ASSERT(tre);
+    TEST_ASSERT(nitf_LazyTRE_parse(tre, &error));
+    TEST_ASSERT(tre->handler != nitf_LazyTRE_handler(&error));
+    TEST_ASSERT_EQ_INT(countLazyTREs(record), NUM_TRES - 1);
+
+    /* A second parse does nothing */
+    TEST_ASSERT(nitf_LazyTRE_parse(tre, &error));
+    checkTRE(testName, getSubheader(record)->extendedSection,
+             "TSTTWO", 3000);
+    TEST_ASSERT_EQ_INT(countLazyTREs(record), NUM_TRES - 1);
+    closeRecord(&record, &reader, in);
+}
+
+TEST_CASE(testClone)
+{
+    nitf_Error error;
+    nitf_IOHandle in;
+    nitf_Reader *reader;
+    nitf_Record *record;
+    nitf_Record *clone;
+
+    record = readRecord(testName, TEST_FILE_NAME, 1, &reader, &in);
+    clone = nitf_Record_clone(record, &error);
+    TEST_ASSERT(clone);
+    closeRecord(&record, &reader, in);
+
+    /* The clone gets parsed TREs, which outlive the lazy record */
+    TEST_ASSERT_EQ_INT(countLazyTREs(clone), 0);
+    checkTREs(testName, clone);
+    nitf_Record_destruct(&clone);
+}
+
+TEST_CASE(testWriteBack)
+{
+    nitf_IOHandle in;
+    nitf_Reader *reader;
+    nitf_Record *record;
+
+    /* Untouched TREs are written back verbatim, and stay unparsed */
+    record = readRecord(testName, TEST_FILE_NAME, 1, &reader, &in);
+    writeRecord(testName, record, COPY_FILE_NAME);
+    TEST_ASSERT_EQ_INT(countLazyTREs(record), NUM_TRES);
+    closeRecord(&record, &reader, in);
+
+    record = readRecord(testName, COPY_FILE_NAME, 0, &reader, &in);
+    checkTREs(testName, record);
+    checkPixels(testName, reader);
+    closeRecord(&record, &reader, in);
+}
+
+int main(int argc, char **argv)
+{
+    CHECK(testEager);
+    CHECK(testUnparsed);
+    CHECK(testParseOne);
+    CHECK(testClone);
+    CHECK(testWriteBack);
+    remove(TEST_FILE_NAME);
+    remove(COPY_FILE_NAME);
+    return 0;
+}
@@ -0,0 +1,337 @@
+/* =========================================================================
+ * This file is part of NITRO
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2010, General Dynamics - Advanced Information Systems
+ *
+ * NITRO is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <import/nitf.h>
+#include "Test.h"
+
+#define TEST_FILE_NAME "test_mmap_read.ntf"
+#define NUM_ROWS 300
+#define NUM_COLS 260
+#define NUM_ROWS_PER_BLOCK 64
+#define NUM_COLS_PER_BLOCK 48
+#define MAX_BANDS 3
+
+static nitf_Uint32 pixel(nitf_Uint32 numBits, nitf_Uint32 band,
+                         nitf_Uint32 row, nitf_Uint32 col)
+{
+    nitf_Uint32 value = band * 97 + row * 7 + col * 3 + (row * col) % 13;
+    return numBits == 8 ? value & 0xff : (value ^ (row << 10)) & 0xffff;
+}
+
+/*
+ *  Write a 300 by 260 image of 64 by 48 blocks in the given mode
+ */
+static void writeImage(const char *testName, const char *mode,
+                       nitf_Uint32 numBands, nitf_Uint32 numBits)
+{
+    nitf_Error error;
+    nitf_Record *record;
+    nitf_ImageSegment *segment;
+    nitf_BandInfo **bands;
+    nitf_Writer *writer;
+    nitf_ImageWriter *imageWriter;
+    nitf_ImageSource *source;
+    nitf_IOHandle out;
+    nitf_Uint32 bytes = numBits / 8;
+    nitf_Uint8 *data[MAX_BANDS];
+    nitf_Uint32 band, row, col;
+
+    record = nitf_Record_construct(NITF_VER_21, &error);
+    TEST_ASSERT(record);
+    segment = nitf_Record_newImageSegment(record, &error);
+    TEST_ASSERT(segment);
+
+    bands = (nitf_BandInfo **) NITF_MALLOC(sizeof(nitf_BandInfo *)
+                                           * numBands);
+    TEST_ASSERT(bands);
+    for (band = 0; band < numBands; band++)
+    {
+        bands[band] = nitf_BandInfo_construct(&error);
+        TEST_ASSERT(bands[band]);
+        TEST_ASSERT(nitf_BandInfo_init(bands[band], "M", " ", "N", "   ",
+                                       0, 0, NULL, &error));
+    }
+    TEST_ASSERT(nitf_ImageSubheader_setPixelInformation(segment->subheader,
+                                                        "INT", numBits,
+                                                        numBits, "R",
+                                                        numBands == 1 ?
+                                                        "MONO" : "MULTI",
+                                                        "VIS", numBands,
+                                                        bands, &error));
+    TEST_ASSERT(nitf_ImageSubheader_setBlocking(segment->subheader,
+                                                NUM_ROWS, NUM_COLS,
+                                                NUM_ROWS_PER_BLOCK,
+                                                NUM_COLS_PER_BLOCK, mode,
+                                                &error));
+
+    out = nitf_IOHandle_create(TEST_FILE_NAME, NITF_ACCESS_WRITEONLY,
+                               NITF_CREATE, &error);
+    TEST_ASSERT(!NITF_INVALID_HANDLE(out));
+    writer = nitf_Writer_construct(&error);
+    TEST_ASSERT(writer);
+    TEST_ASSERT(nitf_Writer_prepare(writer, record, out, &error));
+    imageWriter = nitf_Writer_newImageWriter(writer, 0, &error);
+    TEST_ASSERT(imageWriter);
+
+    source = nitf_ImageSource_construct(&error);
+    TEST_ASSERT(source);
+    for (band = 0; band < numBands; band++)
+    {
+        nitf_BandSource *bandSource;
+
+        data[band] = (nitf_Uint8 *) NITF_MALLOC(NUM_ROWS * NUM_COLS * bytes);
+        TEST_ASSERT(data[band]);
+        for (row = 0; row < NUM_ROWS; row++)
+            for (col = 0; col < NUM_COLS; col++)
+            {
+                nitf_Uint32 value = pixel(numBits, band, row, col);
+
+                if (bytes == 1)
+                    data[band][row * NUM_COLS + col] = (nitf_Uint8) value;
+                else
+                    ((nitf_Uint16 *) data[band])[row * NUM_COLS + col] =
+                        (nitf_Uint16) value;
+            }
+        bandSource = nitf_MemorySource_construct((char *) data[band],
+                                                 NUM_ROWS * NUM_COLS * bytes,
+                                                 0, bytes, 0, &error);
+        TEST_ASSERT(bandSource);
+        TEST_ASSERT(nitf_ImageSource_addBand(source, bandSource, &error));
+    }
+    TEST_ASSERT(nitf_ImageWriter_attachSource(imageWriter, source, &error));
+    TEST_ASSERT(nitf_Writer_write(writer, &error));
+
+    nitf_IOHandle_close(out);
+    nitf_Writer_destruct(&writer);
+    nitf_Record_destruct(&record);
+    for (band = 0; band < numBands; band++)
+        NITF_FREE(data[band]);
+}
+
+/*
+ *  Read a window of all bands and compare it with the pattern
+ */
+static void checkWindow(const char *testName, nitf_ImageReader *image,
+                        nitf_Uint32 numBands, nitf_Uint32 numBits,
+                        nitf_Uint32 startRow, nitf_Uint32 startCol,
+                        nitf_Uint32 numRows, nitf_Uint32 numCols)
+{
+    nitf_Error error;
+    nitf_SubWindow window;
+    nitf_Uint32 bandList[MAX_BANDS] = { 0, 1, 2 };
+    nitf_Uint8 *buffers[MAX_BANDS];
+    nitf_Uint32 bytes = numBits / 8;
+    nitf_Uint32 band, row, col;
+    int padded;
+
+    memset(&window, 0, sizeof(window));
+    window.startRow = startRow;
+    window.startCol = startCol;
+    window.numRows = numRows;
+    window.numCols = numCols;
+    window.bandList = bandList;
+    window.numBands = numBands;
+
+    for (band = 0; band < numBands; band++)
+    {
+        buffers[band] = (nitf_Uint8 *) NITF_MALLOC(numRows * numCols * bytes);
+        TEST_ASSERT(buffers[band]);
+    }
+    TEST_ASSERT(nitf_ImageReader_read(image, &window, buffers, &padded,
+                                      &error));
+    for (band = 0; band < numBands; band++)
+    {
+        for (row = 0; row < numRows; row++)
+            for (col = 0; col < numCols; col++)
+            {
+                size_t n = (size_t) row * numCols + col;
+                nitf_Uint32 got = bytes == 1 ? buffers[band][n] :
+                    ((nitf_Uint16 *) buffers[band])[n];
+
+                TEST_ASSERT_EQ_INT(got, pixel(numBits, band, startRow + row,
+                                              startCol + col));
+            }
+        NITF_FREE(buffers[band]);
+    }
+}
+
+/*
+ *  Compare every borrowed block of an 8-bit image with the pattern. A "B"
+ *  mode block holds its bands one after the other, a "P" mode block holds
+ *  them interleaved and an "S" mode block holds one band. Pixels past the
+ *  edge of the image are zero.
+ */
+static void checkBorrowed(const char *testName, nitf_ImageReader *image,
+                          const char *mode, nitf_Uint32 numBands)
+{
+    nitf_Error error;
+    nitf_Uint32 blocksPerRow = (NUM_COLS + NUM_COLS_PER_BLOCK - 1)
+        / NUM_COLS_PER_BLOCK;
+    nitf_Uint32 blocksPerCol = (NUM_ROWS + NUM_ROWS_PER_BLOCK - 1)
+        / NUM_ROWS_PER_BLOCK;
+    nitf_Uint32 blocksPerBand = blocksPerRow * blocksPerCol;
+    size_t pixels = NUM_ROWS_PER_BLOCK * NUM_COLS_PER_BLOCK;
+    int interleaved = strcmp(mode, "P") == 0;
+    int separate = strcmp(mode, "S") == 0;
+    nitf_Uint32 blockBands = separate ? 1 : numBands;
+    nitf_Uint32 blockNumber;
+
+    for (blockNumber = 0;
+         blockNumber < blocksPerBand * (separate ? numBands : 1);
+         blockNumber++)
+    {
+        nitf_Uint32 block = blockNumber % blocksPerBand;
+        nitf_Uint32 firstBand = blockNumber / blocksPerBand;
+        const nitf_Uint8 *data;
+        nitf_Uint64 blockSize;
+        nitf_Uint32 band;
+        size_t i;
+
+        data = nitf_ImageReader_borrowBlock(image, blockNumber, &blockSize,
+                                            &error);
+        TEST_ASSERT(data);
+        TEST_ASSERT(blockSize == pixels * blockBands);
+
+        for (band = 0; band < blockBands; band++)
+            for (i = 0; i < pixels; i++)
+            {
+                nitf_Uint32 row = (block / blocksPerRow) * NUM_ROWS_PER_BLOCK
+                    + (nitf_Uint32) (i / NUM_COLS_PER_BLOCK);
+                nitf_Uint32 col = (block % blocksPerRow) * NUM_COLS_PER_BLOCK
+                    + (nitf_Uint32) (i % NUM_COLS_PER_BLOCK);
+                nitf_Uint32 want = row < NUM_ROWS && col < NUM_COLS ?
+                    pixel(8, firstBand + band, row, col) : 0;
+
+                TEST_ASSERT_EQ_INT(interleaved ? data[i * blockBands + band] :
+                                   data[band * pixels + i], want);
+            }
+    }
+}
+
+/*
+ *  Read an image through a memory mapped file, and borrow its blocks
+ */
+static void readMapped(const char *testName, const char *mode,
+                       nitf_Uint32 numBands, nitf_Uint32 numBits)
+{
+    nitf_Error error;
+    nitf_IOInterface *io;
+    nitf_Reader *reader;
+    nitf_Record *record;
+    nitf_ImageReader *image;
+    nitf_Uint64 blockSize;
+    nitf_Uint16 one = 1;
+
+    writeImage(testName, mode, numBands, numBits);
+    io = nitf_MMapAdapter_open(TEST_FILE_NAME, &error);
+    TEST_ASSERT(io);
+    reader = nitf_Reader_construct(&error);
+    TEST_ASSERT(reader);
+    record = nitf_Reader_readIO(reader, io, &error);
+    TEST_ASSERT(record);
+    image = nitf_Reader_newImageReader(reader, 0, &error);
+    TEST_ASSERT(image);
+
+    checkWindow(testName, image, numBands, numBits, 0, 0, NUM_ROWS, NUM_COLS);
+    checkWindow(testName, image, numBands, numBits, 40, 30, 150, 170);
+    if (numBits == 8)
+        checkBorrowed(testName, image, mode, numBands);
+    else if (*((nitf_Uint8 *) &one) == 1)
+    {
+        /* Pixels that need byte swapping cannot be borrowed */
+        TEST_ASSERT_NULL(nitf_ImageReader_borrowBlock(image, 0, &blockSize,
+                                                      &error));
+    }
+
+    /* Reads after borrowing still see the file */
+    checkWindow(testName, image, numBands, numBits,
+                NUM_ROWS - 5, NUM_COLS - 7, 5, 7);
+
+    nitf_ImageReader_destruct(&image);
+    nitf_Record_destruct(&record);
+    nitf_Reader_destruct(&reader);
+    nitf_IOInterface_close(io, &error);
+    nitf_IOInterface_destruct(&io);
+}
+
+TEST_CASE(testBlockInterleaved)
+{
+    readMapped(testName, "B", 2, 8);
+}
+
+TEST_CASE(testBandSequential)
+{
+    readMapped(testName, "S", 2, 8);
+}
+
+TEST_CASE(testPixelInterleaved)
+{
+    readMapped(testName, "P", 3, 8);
+}
+
+TEST_CASE(testSwapped)
+{
+    readMapped(testName, "B", 1, 16);
+}
+
+TEST_CASE(testNotMapped)
+{
+    nitf_Error error;
+    nitf_IOInterface *io;
+    nitf_Reader *reader;
+    nitf_Record *record;
+    nitf_ImageReader *image;
+    nitf_Uint64 blockSize;
+
+    /* Borrowing needs a mapping */
+    writeImage(testName, "B", 1, 8);
+    io = nitf_IOHandleAdapter_open(TEST_FILE_NAME, NITF_ACCESS_READONLY,
+                                   NITF_OPEN_EXISTING, &error);
+    TEST_ASSERT(io);
+    reader = nitf_Reader_construct(&error);
+    TEST_ASSERT(reader);
+    record = nitf_Reader_readIO(reader, io, &error);
+    TEST_ASSERT(record);
+    image = nitf_Reader_newImageReader(reader, 0, &error);
+    TEST_ASSERT(image);
+
+    TEST_ASSERT_NULL(nitf_ImageReader_borrowBlock(image, 0, &blockSize,
+                                                  &error));
+    checkWindow(testName, image, 1, 8, 0, 0, NUM_ROWS, NUM_COLS);
+
+    nitf_ImageReader_destruct(&image);
+    nitf_Record_destruct(&record);
+    nitf_Reader_destruct(&reader);
+    nitf_IOInterface_close(io, &error);
+    nitf_IOInterface_destruct(&io);
+}
+
+int main(int argc, char **argv)
+{
+    CHECK(testBlockInterleaved);
+    CHECK(testBandSequential);
+    CHECK(testPixelInterleaved);
+    CHECK(testSwapped);
+    CHECK(testNotMapped);
+    remove(TEST_FILE_NAME);
+    return 0;
+}
@@ -0,0 +1,375 @@
+/* =========================================================================
+ * This file is part of NITRO
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2010, General Dynamics - Advanced Information Systems
+ *
+ * NITRO is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <import/nitf.h>
+#include "Test.h"
+
+#define TEST_FILE_NAME "test_pad_omission.ntf"
+#define MAX_BANDS 3
+
+/* Value of a missing block in the block mask */
+#define NO_BLOCK 0xFFFFFFFF
+
+typedef struct
+{
+    const char *mode;
+    nitf_Uint32 numBands;
+    nitf_Uint32 numBits;
+    nitf_Uint32 numRows;
+    nitf_Uint32 numCols;
+    nitf_Uint32 numRowsPerBlock;
+    nitf_Uint32 numColsPerBlock;
+    const char *compression;
+    int sparse;                   /*!< Zero every third block if TRUE */
+}
+Layout;
+
+static nitf_Uint32 pixel(const Layout *layout, nitf_Uint32 band,
+                         nitf_Uint32 row, nitf_Uint32 col)
+{
+    nitf_Uint32 blocksPerRow = (layout->numCols + layout->numColsPerBlock - 1)
+        / layout->numColsPerBlock;
+    nitf_Uint32 block = (row / layout->numRowsPerBlock) * blocksPerRow
+        + col / layout->numColsPerBlock;
+    nitf_Uint32 value = (band * 97 + row * 7 + col * 3 + (row * col) % 13)
+        ^ ((row * 40503 + col * 9973) << 8);
+
+    if (layout->sparse && block % 3 == 1)
+        return 0;
+    return layout->numBits == 32 ? value :
+        value & ((((nitf_Uint32) 1) << layout->numBits) - 1);
+}
+
+static nitf_Uint32 load(const nitf_Uint8 *buffer, nitf_Uint32 bytes,
+                        size_t index)
+{
+    if (bytes == 1)
+        return buffer[index];
+    if (bytes == 2)
+        return ((const nitf_Uint16 *) buffer)[index];
+    return ((const nitf_Uint32 *) buffer)[index];
+}
+
+static nitf_Uint32 getUint(const nitf_Uint8 *data, size_t length)
+{
+    nitf_Uint32 value = 0;
+    size_t i;
+
+    for (i = 0; i < length; i++)
+        value = (value << 8) | data[i];
+    return value;
+}
+
+/*
+ *  Write the image with pad block omission enabled
+ */
+static void writeImage(const char *testName, const Layout *layout)
+{
+    nitf_Error error;
+    nitf_Record *record;
+    nitf_ImageSegment *segment;
+    nitf_BandInfo **bands;
+    nitf_Writer *writer;
+    nitf_ImageWriter *imageWriter;
+    nitf_ImageSource *source;
+    nitf_IOHandle out;
+    nitf_Uint32 bytes = layout->numBits / 8;
+    size_t size = (size_t) layout->numRows * layout->numCols * bytes;
+    nitf_Uint8 *data[MAX_BANDS];
+    nitf_Uint32 band, row, col;
+
+    record = nitf_Record_construct(NITF_VER_21, &error);
+    TEST_ASSERT(record);
+    segment = nitf_Record_newImageSegment(record, &error);
+    TEST_ASSERT(segment);
+    bands = (nitf_BandInfo **) NITF_MALLOC(sizeof(nitf_BandInfo *)
+                                           * layout->numBands);
+    TEST_ASSERT(bands);
+    for (band = 0; band < layout->numBands; band++)
+    {
+        bands[band] = nitf_BandInfo_construct(&error);
+        TEST_ASSERT(bands[band]);
+        TEST_ASSERT(nitf_BandInfo_init(bands[band], "M", " ", "N", "   ",
+                                       0, 0, NULL, &error));
+    }
+    TEST_ASSERT(nitf_ImageSubheader_setPixelInformation(segment->subheader,
+                                                        "INT",
+                                                        layout->numBits,
+                                                        layout->numBits, "R",
+                                                        layout->numBands == 1 ?
+                                                        "MONO" : "MULTI",
+                                                        "VIS",
+                                                        layout->numBands,
+                                                        bands, &error));
+    TEST_ASSERT(nitf_ImageSubheader_setBlocking(segment->subheader,
+                                                layout->numRows,
+                                                layout->numCols,
+                                                layout->numRowsPerBlock,
+                                                layout->numColsPerBlock,
+                                                layout->mode, &error));
+    if (layout->compression)
+        TEST_ASSERT(nitf_Field_setString(segment->subheader->
+                                         imageCompression,
+                                         layout->compression, &error));
+
+    out = nitf_IOHandle_create(TEST_FILE_NAME, NITF_ACCESS_WRITEONLY,
+                               NITF_CREATE, &error);
+    TEST_ASSERT(!NITF_INVALID_HANDLE(out));
+    writer = nitf_Writer_construct(&error);
+    TEST_ASSERT(writer);
+    TEST_ASSERT(nitf_Writer_prepare(writer, record, out, &error));
+    imageWriter = nitf_Writer_newImageWriter(writer, 0, &error);
+    TEST_ASSERT(imageWriter);
+    TEST_ASSERT(nitf_ImageWriter_enablePadBlockOmission(imageWriter,
+                                                        &error));
+
+    source = nitf_ImageSource_construct(&error);
+    TEST_ASSERT(source);
+    for (band = 0; band < layout->numBands; band++)
+    {
+        nitf_BandSource *bandSource;
+
+        data[band] = (nitf_Uint8 *) NITF_MALLOC(size);
+        TEST_ASSERT(data[band]);
+        for (row = 0; row < layout->numRows; row++)
+            for (col = 0; col < layout->numCols; col++)
+            {
+                nitf_Uint32 value = pixel(layout, band, row, col);
+                size_t n = (size_t) row * layout->numCols + col;
+
+                if (bytes == 1)
+                    data[band][n] = (nitf_Uint8) value;
+                else if (bytes == 2)
+                    ((nitf_Uint16 *) data[band])[n] = (nitf_Uint16) value;
+                else
+                    ((nitf_Uint32 *) data[band])[n] = value;
+            }
+        bandSource = nitf_MemorySource_construct((char *) data[band], size,
+                                                 0, bytes, 0, &error);
+        TEST_ASSERT(bandSource);
+        TEST_ASSERT(nitf_ImageSource_addBand(source, bandSource, &error));
+    }
+    TEST_ASSERT(nitf_ImageWriter_attachSource(imageWriter, source, &error));
+    TEST_ASSERT(nitf_Writer_write(writer, &error));
+
+    nitf_IOHandle_close(out);
+    nitf_Writer_destruct(&writer);
+    nitf_Record_destruct(&record);
+    for (band = 0; band < layout->numBands; band++)
+        NITF_FREE(data[band]);
+}
+
+/*
+ *  The image must be "NM", and the block mask must mark exactly the zero
+ *  blocks as missing, with the blocks present stored in order after the
+ *  masks. The image data is no longer than the masks and those blocks.
+ */
+static void checkMask(const char *testName, const Layout *layout,
+                      nitf_IOInterface *io, nitf_ImageSegment *segment)
+{
+    nitf_Error error;
+    nitf_Uint32 numBlocks = ((layout->numRows + layout->numRowsPerBlock - 1)
+                             / layout->numRowsPerBlock)
+        * ((layout->numCols + layout->numColsPerBlock - 1)
+           / layout->numColsPerBlock);
+    size_t blockSize = (size_t) layout->numRowsPerBlock
+        * layout->numColsPerBlock * layout->numBands * (layout->numBits / 8);
+    size_t length = (size_t) (segment->imageEnd - segment->imageOffset);
+    char compression[NITF_IC_SZ + 1];
+    nitf_Uint8 *data;
+    nitf_Uint32 padCodeLength;
+    nitf_Uint32 next = 0;
+    nitf_Uint32 present = 0;
+    size_t header;
+    nitf_Uint32 i;
+
+    TEST_ASSERT(nitf_Field_get(segment->subheader->imageCompression,
+                               compression, NITF_CONV_STRING,
+                               NITF_IC_SZ + 1, &error));
+    TEST_ASSERT(memcmp(compression, "NM", 2) == 0);
+
+    data = (nitf_Uint8 *) NITF_MALLOC(length);
+    TEST_ASSERT(data);
+    TEST_ASSERT(nitf_IOInterface_readAt(io, (nitf_Off) segment->imageOffset,
+                                        (char *) data, length, &error));
+
+    /*
+     * IMDATOFF, BMRLNTH, TMRLNTH and TPXCDLNTH (big endian), the pad
+     * value, then one block mask record per block
+     */
+    padCodeLength = getUint(data + 8, 2);
+    TEST_ASSERT(padCodeLength == 0 || padCodeLength == layout->numBits);
+    header = 10 + (padCodeLength + 7) / 8;
+    TEST_ASSERT_EQ_INT(getUint(data + 4, 2), 4);
+    TEST_ASSERT(header + (size_t) numBlocks * 4 <= length);
+
+    for (i = 0; i < numBlocks; i++)
+    {
+        nitf_Uint32 offset = getUint(data + header + (size_t) i * 4, 4);
+
+        if (layout->sparse && i % 3 == 1)
+        {
+            TEST_ASSERT(offset == NO_BLOCK);
+        }
+        else
+        {
+            TEST_ASSERT(offset == next);
+            next = offset + (nitf_Uint32) blockSize;
+            present++;
+        }
+    }
+    TEST_ASSERT(length == getUint(data, 4) + (size_t) present * blockSize);
+    NITF_FREE(data);
+}
+
+static void checkWindow(const char *testName, const Layout *layout,
+                        nitf_ImageReader *image, nitf_Uint32 startRow,
+                        nitf_Uint32 startCol, nitf_Uint32 numRows,
+                        nitf_Uint32 numCols)
+{
+    nitf_Error error;
+    nitf_SubWindow window;
+    nitf_Uint32 bandList[MAX_BANDS] = { 0, 1, 2 };
+    nitf_Uint8 *buffers[MAX_BANDS];
+    nitf_Uint32 bytes = layout->numBits / 8;
+    nitf_Uint32 band, row, col;
+    int padded;
+
+    memset(&window, 0, sizeof(window));
+    window.startRow = startRow;
+    window.startCol = startCol;
+    window.numRows = numRows;
+    window.numCols = numCols;
+    window.bandList = bandList;
+    window.numBands = layout->numBands;
+    for (band = 0; band < layout->numBands; band++)
+    {
+        buffers[band] = (nitf_Uint8 *) NITF_MALLOC((size_t) numRows
+                                                   * numCols * bytes);
+        TEST_ASSERT(buffers[band]);
+    }
+    TEST_ASSERT(nitf_ImageReader_read(image, &window, buffers, &padded,
+                                      &error));
+    for (band = 0; band < layout->numBands; band++)
+    {
+        for (row = 0; row < numRows; row++)
+            for (col = 0; col < numCols; col++)
+                TEST_ASSERT(load(buffers[band], bytes,
+                                 (size_t) row * numCols + col) ==
+                            pixel(layout, band, startRow + row,
+                                  startCol + col));
+        NITF_FREE(buffers[band]);
+    }
+}
+
+/*
+ *  Write the image, check the masks, and read it back uncached and
+ *  through the block cache
+ */
+static void omitPadBlocks(const char *testName, const Layout *layout)
+{
+    int cached;
+
+    writeImage(testName, layout);
+    for (cached = 0; cached < 2; cached++)
+    {
+        nitf_Error error;
+        nitf_IOInterface *io;
+        nitf_Reader *reader;
+        nitf_Record *record;
+        nitf_ImageReader *image;
+
+        io = nitf_IOHandleAdapter_open(TEST_FILE_NAME, NITF_ACCESS_READONLY,
+                                       NITF_OPEN_EXISTING, &error);
+        TEST_ASSERT(io);
+        reader = nitf_Reader_construct(&error);
+        TEST_ASSERT(reader);
+        record = nitf_Reader_readIO(reader, io, &error);
+        TEST_ASSERT(record);
+        if (!cached)
+            checkMask(testName, layout, io,
+                      (nitf_ImageSegment *) record->images->first->data);
+
+        image = nitf_Reader_newImageReader(reader, 0, &error);
+        TEST_ASSERT(image);
+        if (cached)
+            nitf_ImageReader_setReadCacheSize(image,
+                                              4 * (size_t) layout->
+                                              numRowsPerBlock
+                                              * layout->numCols
+                                              * layout->numBands
+                                              * (layout->numBits / 8));
+        checkWindow(testName, layout, image, 0, 0, layout->numRows,
+                    layout->numCols);
+        checkWindow(testName, layout, image, layout->numRows / 7,
+                    layout->numCols / 9, layout->numRows / 2,
+                    layout->numCols * 2 / 3);
+        checkWindow(testName, layout, image, layout->numRows - 3,
+                    layout->numCols - 4, 3, 4);
+
+        nitf_ImageReader_destruct(&image);
+        nitf_Record_destruct(&record);
+        nitf_Reader_destruct(&reader);
+        nitf_IOInterface_close(io, &error);
+        nitf_IOInterface_destruct(&io);
+    }
+}
+
+TEST_CASE(testSparse)
+{
+    Layout oneBand = { "B", 1, 8, 300, 260, 32, 48, NULL, 1 };
+    Layout blocked = { "B", 3, 8, 250, 200, 40, 64, NULL, 1 };
+    Layout pixels = { "P", 2, 16, 220, 190, 48, 32, NULL, 1 };
+    Layout wide = { "B", 1, 32, 150, 120, 64, 40, NULL, 1 };
+
+    omitPadBlocks(testName, &oneBand);
+    omitPadBlocks(testName, &blocked);
+    omitPadBlocks(testName, &pixels);
+    omitPadBlocks(testName, &wide);
+}
+
+/* Every band of a row of an R mode block, down to the last block row */
+TEST_CASE(testRowInterleaved)
+{
+    Layout rows = { "R", 3, 8, 160, 230, 64, 64, NULL, 1 };
+
+    omitPadBlocks(testName, &rows);
+}
+
+/* Already masked, and with no pad blocks at all */
+TEST_CASE(testMasked)
+{
+    Layout masked = { "B", 2, 8, 200, 230, 32, 48, "NM", 1 };
+    Layout dense = { "B", 2, 8, 200, 230, 32, 48, NULL, 0 };
+
+    omitPadBlocks(testName, &masked);
+    omitPadBlocks(testName, &dense);
+}
+
+int main(int argc, char **argv)
+{
+    CHECK(testSparse);
+    CHECK(testRowInterleaved);
+    CHECK(testMasked);
+    remove(TEST_FILE_NAME);
+    return 0;
+}
@@ -0,0 +1,269 @@
+/* =========================================================================
+ * This file is part of NITRO
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2010, General Dynamics - Advanced Information Systems
+ *
+ * NITRO is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <import/nitf.h>
+#include "Test.h"
+
+#define TEST_FILE_NAME "test_pixel_interleaved_read.ntf"
+#define NUM_ROWS 150
+#define NUM_COLS 140
+#define MAX_BANDS 5
+
+static nitf_Uint32 pixel(nitf_Uint32 numBits, nitf_Uint32 band,
+                         nitf_Uint32 row, nitf_Uint32 col)
+{
+    nitf_Uint32 value = (band * 97 + row * 7 + col * 3 + (row * col) % 13)
+        ^ ((row * 40503 + col * 9973) << 8);
+
+    return numBits == 32 ? value :
+        value & ((((nitf_Uint32) 1) << numBits) - 1);
+}
+
+static nitf_Uint32 load(const nitf_Uint8 *buffer, nitf_Uint32 bytes,
+                        size_t index)
+{
+    if (bytes == 1)
+        return buffer[index];
+    if (bytes == 2)
+        return ((const nitf_Uint16 *) buffer)[index];
+    return ((const nitf_Uint32 *) buffer)[index];
+}
+
+/*
+ *  Write a P mode image of 64 by 48 blocks
+ */
+static void writeImage(const char *testName, nitf_Uint32 numBands,
+                       nitf_Uint32 numBits)
+{
+    nitf_Error error;
+    nitf_Record *record;
+    nitf_ImageSegment *segment;
+    nitf_BandInfo **bands;
+    nitf_Writer *writer;
+    nitf_ImageWriter *imageWriter;
+    nitf_ImageSource *source;
+    nitf_IOHandle out;
+    nitf_Uint32 bytes = numBits / 8;
+    nitf_Uint8 *data[MAX_BANDS];
+    nitf_Uint32 band, row, col;
+
+    record = nitf_Record_construct(NITF_VER_21, &error);
+    TEST_ASSERT(record);
+    segment = nitf_Record_newImageSegment(record, &error);
+    TEST_ASSERT(segment);
+
+    bands = (nitf_BandInfo **) NITF_MALLOC(sizeof(nitf_BandInfo *)
+                                           * numBands);
+    TEST_ASSERT(bands);
+    for (band = 0; band < numBands; band++)
+    {
+        bands[band] = nitf_BandInfo_construct(&error);
+        TEST_ASSERT(bands[band]);
+        TEST_ASSERT(nitf_BandInfo_init(bands[band], "M", " ", "N", "   ",
+                                       0, 0, NULL, &error));
+    }
+    TEST_ASSERT(nitf_ImageSubheader_setPixelInformation(segment->subheader,
+                                                        "INT", numBits,
+                                                        numBits, "R",
+                                                        "MULTI", "VIS",
+                                                        numBands, bands,
+                                                        &error));
+    TEST_ASSERT(nitf_ImageSubheader_setBlocking(segment->subheader,
+                                                NUM_ROWS, NUM_COLS, 64, 48,
+                                                "P", &error));
+
+    out = nitf_IOHandle_create(TEST_FILE_NAME, NITF_ACCESS_WRITEONLY,
+                               NITF_CREATE, &error);
+    TEST_ASSERT(!NITF_INVALID_HANDLE(out));
+    writer = nitf_Writer_construct(&error);
+    TEST_ASSERT(writer);
+    TEST_ASSERT(nitf_Writer_prepare(writer, record, out, &error));
+    imageWriter = nitf_Writer_newImageWriter(writer, 0, &error);
+    TEST_ASSERT(imageWriter);
+
+    source = nitf_ImageSource_construct(&error);
+    TEST_ASSERT(source);
+    for (band = 0; band < numBands; band++)
+    {
+        nitf_BandSource *bandSource;
+
+        data[band] = (nitf_Uint8 *) NITF_MALLOC(NUM_ROWS * NUM_COLS * bytes);
+        TEST_ASSERT(data[band]);
+        for (row = 0; row < NUM_ROWS; row++)
+            for (col = 0; col < NUM_COLS; col++)
+            {
+                nitf_Uint32 value = pixel(numBits, band, row, col);
+                size_t n = row * NUM_COLS + col;
+
+                if (bytes == 1)
+                    data[band][n] = (nitf_Uint8) value;
+                else if (bytes == 2)
+                    ((nitf_Uint16 *) data[band])[n] = (nitf_Uint16) value;
+                else
+                    ((nitf_Uint32 *) data[band])[n] = value;
+            }
+        bandSource = nitf_MemorySource_construct((char *) data[band],
+                                                 NUM_ROWS * NUM_COLS * bytes,
+                                                 0, bytes, 0, &error);
+        TEST_ASSERT(bandSource);
+        TEST_ASSERT(nitf_ImageSource_addBand(source, bandSource, &error));
+    }
+    TEST_ASSERT(nitf_ImageWriter_attachSource(imageWriter, source, &error));
+    TEST_ASSERT(nitf_Writer_write(writer, &error));
+
+    nitf_IOHandle_close(out);
+    nitf_Writer_destruct(&writer);
+    nitf_Record_destruct(&record);
+    for (band = 0; band < numBands; band++)
+        NITF_FREE(data[band]);
+}
+
+/*
+ *  Read a window of the bands in bandList and compare it with the pattern
+ */
+static void checkWindow(const char *testName, nitf_ImageReader *image,
+                        nitf_Uint32 numBits, nitf_Uint32 *bandList,
+                        nitf_Uint32 numBands, nitf_Uint32 startRow,
+                        nitf_Uint32 startCol, nitf_Uint32 numRows,
+                        nitf_Uint32 numCols)
+{
+    nitf_Error error;
+    nitf_SubWindow window;
+    nitf_Uint8 *buffers[MAX_BANDS];
+    nitf_Uint32 bytes = numBits / 8;
+    nitf_Uint32 i, row, col;
+    int padded;
+
+    memset(&window, 0, sizeof(window));
+    window.startRow = startRow;
+    window.startCol = startCol;
+    window.numRows = numRows;
+    window.numCols = numCols;
+    window.bandList = bandList;
+    window.numBands = numBands;
+
+    for (i = 0; i < numBands; i++)
+    {
+        buffers[i] = (nitf_Uint8 *) NITF_MALLOC(numRows * numCols * bytes);
+        TEST_ASSERT(buffers[i]);
+    }
+    TEST_ASSERT(nitf_ImageReader_read(image, &window, buffers, &padded,
+                                      &error));
+    for (i = 0; i < numBands; i++)
+    {
+        for (row = 0; row < numRows; row++)
+            for (col = 0; col < numCols; col++)
+                TEST_ASSERT(load(buffers[i], bytes,
+                                 (size_t) row * numCols + col) ==
+                            pixel(numBits, bandList[i], startRow + row,
+                                  startCol + col));
+        NITF_FREE(buffers[i]);
+    }
+}
+
+/*
+ *  Read every subset of the bands, in a rotated order, in a few windows,
+ *  with and without read caching. This covers the all band deinterleave
+ *  and the reads that pick some of the bands.
+ */
+static void readSubsets(const char *testName, nitf_Uint32 numBands,
+                        nitf_Uint32 numBits)
+{
+    nitf_Error error;
+    nitf_IOHandle in;
+    nitf_Reader *reader;
+    nitf_Record *record;
+    nitf_ImageReader *image;
+    nitf_Uint32 subset;
+    int pass;
+
+    writeImage(testName, numBands, numBits);
+    for (pass = 0; pass < 2; pass++)
+    {
+        in = nitf_IOHandle_create(TEST_FILE_NAME, NITF_ACCESS_READONLY,
+                                  NITF_OPEN_EXISTING, &error);
+        TEST_ASSERT(!NITF_INVALID_HANDLE(in));
+        reader = nitf_Reader_construct(&error);
+        TEST_ASSERT(reader);
+        record = nitf_Reader_read(reader, in, &error);
+        TEST_ASSERT(record);
+        image = nitf_Reader_newImageReader(reader, 0, &error);
+        TEST_ASSERT(image);
+        if (pass == 1)
+            nitf_ImageReader_setReadCaching(image);
+
+        for (subset = 1; subset < (((nitf_Uint32) 1) << numBands); subset++)
+        {
+            nitf_Uint32 bandList[MAX_BANDS];
+            nitf_Uint32 numListed = 0;
+            nitf_Uint32 band;
+
+            for (band = 0; band < numBands; band++)
+            {
+                nitf_Uint32 rotated = (band + subset) % numBands;
+
+                if (subset & (((nitf_Uint32) 1) << rotated))
+                    bandList[numListed++] = rotated;
+            }
+            checkWindow(testName, image, numBits, bandList, numListed,
+                        0, 0, NUM_ROWS, NUM_COLS);
+            checkWindow(testName, image, numBits, bandList, numListed,
+                        13, 29, 97, 101);
+            checkWindow(testName, image, numBits, bandList, numListed,
+                        63, 45, 3, 5);
+        }
+
+        nitf_ImageReader_destruct(&image);
+        nitf_Record_destruct(&record);
+        nitf_Reader_destruct(&reader);
+        nitf_IOHandle_close(in);
+    }
+}
+
+TEST_CASE(test8Bit)
+{
+    readSubsets(testName, 2, 8);
+    readSubsets(testName, 3, 8);
+    readSubsets(testName, 4, 8);
+    readSubsets(testName, 5, 8);
+}
+
+TEST_CASE(test16Bit)
+{
+    readSubsets(testName, 3, 16);
+    readSubsets(testName, 4, 16);
+}
+
+TEST_CASE(test32Bit)
+{
+    readSubsets(testName, 2, 32);
+    readSubsets(testName, 3, 32);
+}
+
+int main(int argc, char **argv)
+{
+    CHECK(test8Bit);
+    CHECK(test16Bit);
+    CHECK(test32Bit);
+    remove(TEST_FILE_NAME);
+    return 0;
+}
@@ -0,0 +1,549 @@
+/* =========================================================================
+ * This file is part of NITRO
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2010, General Dynamics - Advanced Information Systems
+ *
+ * NITRO is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <import/nitf.h>
+#include "Test.h"
+
+#define TEST_FILE_NAME "test_read_ahead.ntf"
+#define MAX_BANDS 3
+
+typedef struct
+{
+    const char *mode;
+    nitf_Uint32 numBands;
+    nitf_Uint32 numBits;
+    nitf_Uint32 numRows;
+    nitf_Uint32 numCols;
+    nitf_Uint32 numRowsPerBlock;
+    nitf_Uint32 numColsPerBlock;
+}
+Layout;
+
+/* A strip scan */
+typedef struct
+{
+    int mode;                 /*!< NITF_READ_AHEAD_* */
+    nitf_Uint32 stripRows;    /*!< Rows per read, 0 for block rows */
+    int columns;              /*!< Read a column range if TRUE */
+    int backwards;            /*!< Scan bottom to top if TRUE */
+    int tinyCache;            /*!< Cache a single block if TRUE */
+}
+Scan;
+
+static const Scan scans[] =
+{
+    { NITF_READ_AHEAD_AUTO, 0, 0, 0, 0 },
+    { NITF_READ_AHEAD_AUTO, 21, 0, 0, 0 },
+    { NITF_READ_AHEAD_SEQUENTIAL, 37, 0, 0, 0 },
+    { NITF_READ_AHEAD_SEQUENTIAL, 16, 1, 0, 0 },
+    { NITF_READ_AHEAD_SEQUENTIAL, 30, 0, 1, 0 },
+    { NITF_READ_AHEAD_AUTO, 21, 0, 0, 1 },
+    { NITF_READ_AHEAD_SEQUENTIAL, 0, 1, 0, 1 }
+};
+
+#define NUM_SCANS (sizeof(scans) / sizeof(scans[0]))
+
+/*
+ *  The test decompressor reads uncompressed blocks, so an image written
+ *  as "NC" is read through the decompression path
+ */
+typedef struct _TestDecoder
+{
+    nitf_IOInterface *io;
+    nitf_Uint64 offset;
+    nitf_BlockingInfo *blockInfo;
+    nitf_Uint64 *blockMask;
+} TestDecoder;
+
+/* Blocks decoded, and whether the IO may still be read */
+static struct
+{
+    nitf_Mutex lock;
+    nitf_Uint32 decoded;
+    int closed;
+}
+decodes;
+
+static nitf_Uint32 pixel(const Layout *layout, nitf_Uint32 band,
+                         nitf_Uint32 row, nitf_Uint32 col)
+{
+    nitf_Uint32 value = (band * 97 + row * 7 + col * 3 + (row * col) % 13)
+        ^ ((row * 40503 + col * 9973) << 8);
+
+    return value & ((((nitf_Uint32) 1) << layout->numBits) - 1);
+}
+
+static nitf_DecompressionControl *decoderOpen(nitf_IOInterface *io,
+                                              nitf_Uint64 offset,
+                                              nitf_Uint64 fileLength,
+                                              nitf_BlockingInfo *blockInfo,
+                                              nitf_Uint64 *blockMask,
+                                              nitf_Error *error)
+{
+    TestDecoder *decoder;
+
+    (void) fileLength;
+    decoder = (TestDecoder *) NITF_MALLOC(sizeof(TestDecoder));
+    if (!decoder)
+    {
+        nitf_Error_init(error, NITF_STRERROR(NITF_ERRNO), NITF_CTXT,
+                        NITF_ERR_MEMORY);
+        return NULL;
+    }
+    decoder->io = io;
+    decoder->offset = offset;
+    decoder->blockInfo = blockInfo;
+    decoder->blockMask = blockMask;
+    return (nitf_DecompressionControl *) decoder;
+}
+
+static NITF_BOOL decoderReadBlockInto(nitf_DecompressionControl *control,
+                                      nitf_Uint32 blockNumber,
+                                      nitf_Uint8 *buffer, size_t size,
+                                      nitf_Error *error)
+{
+    const char *testName = "decoderReadBlockInto";
+    TestDecoder *decoder = (TestDecoder *) control;
+
+    nitf_Mutex_lock(&decodes.lock);
+    TEST_ASSERT(!decodes.closed);
+    decodes.decoded++;
+    nitf_Mutex_unlock(&decodes.lock);
+    TEST_ASSERT(size >= decoder->blockInfo->length);
+    return nitf_IOInterface_readAt(decoder->io,
+                                   (nitf_Off) (decoder->offset +
+                                               decoder->blockMask
+                                               [blockNumber]),
+                                   (char *) buffer,
+                                   decoder->blockInfo->length, error);
+}
+
+static nitf_Uint8 *decoderReadBlock(nitf_DecompressionControl *control,
+                                    nitf_Uint32 blockNumber,
+                                    nitf_Error *error)
+{
+    TestDecoder *decoder = (TestDecoder *) control;
+    nitf_Uint8 *block;
+
+    block = (nitf_Uint8 *) NITF_MALLOC(decoder->blockInfo->length);
+    if (!block)
+    {
+        nitf_Error_init(error, NITF_STRERROR(NITF_ERRNO), NITF_CTXT,
+                        NITF_ERR_MEMORY);
+        return NULL;
+    }
+    if (!decoderReadBlockInto(control, blockNumber, block,
+                              decoder->blockInfo->length, error))
+    {
+        NITF_FREE(block);
+        return NULL;
+    }
+    return block;
+}
+
+static NITF_BOOL decoderFreeBlock(nitf_DecompressionControl *control,
+                                  nitf_Uint8 *block, nitf_Error *error)
+{
+    (void) control;
+    (void) error;
+    NITF_FREE(block);
+    return NITF_SUCCESS;
+}
+
+static void decoderDestroy(nitf_DecompressionControl **control)
+{
+    NITF_FREE(*control);
+    *control = NULL;
+}
+
+static void writeImage(const char *testName, const Layout *layout)
+{
+    nitf_Error error;
+    nitf_Record *record;
+    nitf_ImageSegment *segment;
+    nitf_BandInfo **bands;
+    nitf_Writer *writer;
+    nitf_ImageWriter *imageWriter;
+    nitf_ImageSource *source;
+    nitf_IOHandle out;
+    nitf_Uint32 bytes = layout->numBits / 8;
+    size_t size = (size_t) layout->numRows * layout->numCols * bytes;
+    nitf_Uint8 *data[MAX_BANDS];
+    nitf_Uint32 band, row, col;
+
+    record = nitf_Record_construct(NITF_VER_21, &error);
+    TEST_ASSERT(record);
+    segment = nitf_Record_newImageSegment(record, &error);
+    TEST_ASSERT(segment);
+    bands = (nitf_BandInfo **) NITF_MALLOC(sizeof(nitf_BandInfo *)
+                                           * layout->numBands);
+    TEST_ASSERT(bands);
+    for (band = 0; band < layout->numBands; band++)
+    {
+        bands[band] = nitf_BandInfo_construct(&error);
+        TEST_ASSERT(bands[band]);
+        TEST_ASSERT(nitf_BandInfo_init(bands[band], "M", " ", "N", "   ",
+                                       0, 0, NULL, &error));
+    }
+    TEST_ASSERT(nitf_ImageSubheader_setPixelInformation(segment->subheader,
+                                                        "INT",
+                                                        layout->numBits,
+                                                        layout->numBits, "R",
+                                                        "MULTI", "VIS",
+                                                        layout->numBands,
+                                                        bands, &error));
+    TEST_ASSERT(nitf_ImageSubheader_setBlocking(segment->subheader,
+                                                layout->numRows,
+                                                layout->numCols,
+                                                layout->numRowsPerBlock,
+                                                layout->numColsPerBlock,
+                                                layout->mode, &error));
+
+    out = nitf_IOHandle_create(TEST_FILE_NAME, NITF_ACCESS_WRITEONLY,
+                               NITF_CREATE, &error);
+    TEST_ASSERT(!NITF_INVALID_HANDLE(out));
+    writer = nitf_Writer_construct(&error);
+    TEST_ASSERT(writer);
+    TEST_ASSERT(nitf_Writer_prepare(writer, record, out, &error));
+    imageWriter = nitf_Writer_newImageWriter(writer, 0, &error);
+    TEST_ASSERT(imageWriter);
+
+    source = nitf_ImageSource_construct(&error);
+    TEST_ASSERT(source);
+    for (band = 0; band < layout->numBands; band++)
+    {
+        nitf_BandSource *bandSource;
+
+        data[band] = (nitf_Uint8 *) NITF_MALLOC(size);
+        TEST_ASSERT(data[band]);
+        for (row = 0; row < layout->numRows; row++)
+            for (col = 0; col < layout->numCols; col++)
+            {
+                size_t n = (size_t) row * layout->numCols + col;
+
+                if (bytes == 1)
+                    data[band][n] = (nitf_Uint8) pixel(layout, band, row,
+                                                       col);
+                else
+                    ((nitf_Uint16 *) data[band])[n] =
+                        (nitf_Uint16) pixel(layout, band, row, col);
+            }
+        bandSource = nitf_MemorySource_construct((char *) data[band], size,
+                                                 0, bytes, 0, &error);
+        TEST_ASSERT(bandSource);
+        TEST_ASSERT(nitf_ImageSource_addBand(source, bandSource, &error));
+    }
+    TEST_ASSERT(nitf_ImageWriter_attachSource(imageWriter, source, &error));
+    TEST_ASSERT(nitf_Writer_write(writer, &error));
+
+    nitf_IOHandle_close(out);
+    nitf_Writer_destruct(&writer);
+    nitf_Record_destruct(&record);
+    for (band = 0; band < layout->numBands; band++)
+        NITF_FREE(data[band]);
+}
+
+/* The interface must outlive the nitf_ImageIO objects that use it */
+static nitf_DecompressionInterface iface;
+
+/*
+ *  Open the image, through the test decompressor if flags is not zero
+ */
+static nitf_ImageIO *openImage(const char *testName, nitf_IOInterface **io,
+                               nitf_Reader **reader, nitf_Record **record,
+                               nitf_Uint32 flags)
+{
+    nitf_Error error;
+    nitf_ImageSegment *segment;
+    nitf_ImageIO *image;
+
+    *io = nitf_IOHandleAdapter_open(TEST_FILE_NAME, NITF_ACCESS_READONLY,
+                                    NITF_OPEN_EXISTING, &error);
+    TEST_ASSERT(*io);
+    *reader = nitf_Reader_construct(&error);
+    TEST_ASSERT(*reader);
+    *record = nitf_Reader_readIO(*reader, *io, &error);
+    TEST_ASSERT(*record);
+    segment = (nitf_ImageSegment *) (*record)->images->first->data;
+    if (flags)
+    {
+        TEST_ASSERT(nitf_Field_setString(segment->subheader->
+                                         imageCompression, "C8", &error));
+        memset(&iface, 0, sizeof(iface));
+        iface.open = decoderOpen;
+        iface.readBlock = decoderReadBlock;
+        iface.freeBlock = decoderFreeBlock;
+        iface.destroyControl = decoderDestroy;
+        iface.readBlockInto = decoderReadBlockInto;
+        iface.flags = flags;
+    }
+    image = nitf_ImageIO_construct(segment->subheader, segment->imageOffset,
+                                   segment->imageEnd - segment->imageOffset,
+                                   NULL, flags ? &iface : NULL, &error);
+    TEST_ASSERT(image);
+    decodes.decoded = 0;
+    decodes.closed = 0;
+    return image;
+}
+
+static void closeImage(nitf_ImageIO **image, nitf_IOInterface **io,
+                       nitf_Reader **reader, nitf_Record **record)
+{
+    nitf_Error error;
+
+    nitf_ImageIO_destruct(image);
+    nitf_Record_destruct(record);
+    nitf_Reader_destruct(reader);
+    nitf_IOInterface_close(*io, &error);
+    nitf_IOInterface_destruct(io);
+}
+
+static void checkWindow(const char *testName, const Layout *layout,
+                        nitf_ImageIO *image, nitf_IOInterface *io,
+                        nitf_Uint32 startRow, nitf_Uint32 startCol,
+                        nitf_Uint32 numRows, nitf_Uint32 numCols)
+{
+    nitf_Error error;
+    nitf_SubWindow window;
+    nitf_Uint32 bandList[MAX_BANDS] = { 0, 1, 2 };
+    nitf_Uint8 *buffers[MAX_BANDS];
+    nitf_Uint32 bytes = layout->numBits / 8;
+    nitf_Uint32 band, row, col;
+    int padded;
+
+    memset(&window, 0, sizeof(window));
+    window.startRow = startRow;
+    window.startCol = startCol;
+    window.numRows = numRows;
+    window.numCols = numCols;
+    window.bandList = bandList;
+    window.numBands = layout->numBands;
+    for (band = 0; band < layout->numBands; band++)
+    {
+        buffers[band] = (nitf_Uint8 *) NITF_MALLOC((size_t) numRows
+                                                   * numCols * bytes);
+        TEST_ASSERT(buffers[band]);
+    }
+    TEST_ASSERT(nitf_ImageIO_read(image, io, &window, buffers, &padded,
+                                  &error));
+    for (band = 0; band < layout->numBands; band++)
+    {
+        for (row = 0; row < numRows; row++)
+            for (col = 0; col < numCols; col++)
+            {
+                size_t n = (size_t) row * numCols + col;
+                nitf_Uint32 got = bytes == 1 ? buffers[band][n] :
+                    ((nitf_Uint16 *) buffers[band])[n];
+
+                TEST_ASSERT_EQ_INT(got, pixel(layout, band, startRow + row,
+                                              startCol + col));
+            }
+        NITF_FREE(buffers[band]);
+    }
+}
+
+/* Bytes in a row of blocks of all bands */
+static size_t blockRowBytes(const Layout *layout)
+{
+    return (size_t) layout->numRowsPerBlock * layout->numColsPerBlock
+        * ((layout->numCols + layout->numColsPerBlock - 1)
+           / layout->numColsPerBlock)
+        * layout->numBands * (layout->numBits / 8);
+}
+
+/*
+ *  Scan the image in strips. The cache holds several strips, or a
+ *  single block.
+ */
+static void scanStrips(const char *testName, const Layout *layout,
+                       nitf_ImageIO *image, nitf_IOInterface *io,
+                       const Scan *scan)
+{
+    nitf_Uint32 stripRows = scan->stripRows ?
+        scan->stripRows : layout->numRowsPerBlock;
+    nitf_Uint32 numStrips = (layout->numRows + stripRows - 1) / stripRows;
+    nitf_Uint32 startCol = scan->columns ? layout->numCols / 5 : 0;
+    nitf_Uint32 numCols = scan->columns ?
+        layout->numCols / 2 : layout->numCols;
+    nitf_Uint32 i;
+
+    nitf_ImageIO_setReadCacheSize(image, scan->tinyCache ?
+                                  (size_t) layout->numRowsPerBlock
+                                  * layout->numColsPerBlock
+                                  * (layout->numBits / 8) :
+                                  4 * blockRowBytes(layout));
+    nitf_ImageIO_setReadAhead(image, scan->mode);
+    for (i = 0; i < numStrips; i++)
+    {
+        nitf_Uint32 strip = scan->backwards ? numStrips - 1 - i : i;
+        nitf_Uint32 startRow = strip * stripRows;
+        nitf_Uint32 numRows = startRow + stripRows > layout->numRows ?
+            layout->numRows - startRow : stripRows;
+
+        checkWindow(testName, layout, image, io, startRow, startCol,
+                    numRows, numCols);
+    }
+}
+
+/*
+ *  Scan in strips that are and are not aligned with the blocks, over a
+ *  column range and bottom to top, so every guess is wrong
+ */
+static void scanAll(const char *testName, const Layout *layout)
+{
+    size_t i;
+
+    writeImage(testName, layout);
+    for (i = 0; i < NUM_SCANS; i++)
+    {
+        nitf_IOInterface *io;
+        nitf_Reader *reader;
+        nitf_Record *record;
+        nitf_ImageIO *image = openImage(testName, &io, &reader, &record, 0);
+
+        scanStrips(testName, layout, image, io, &scans[i]);
+        closeImage(&image, &io, &reader, &record);
+    }
+}
+
+static const Layout blocked = { "B", 3, 8, 300, 260, 32, 48 };
+
+TEST_CASE(testBandSequential)
+{
+    scanAll(testName, &blocked);
+}
+
+TEST_CASE(testOtherModes)
+{
+    Layout sequential = { "S", 2, 8, 250, 200, 40, 64 };
+    Layout pixel = { "P", 2, 16, 220, 190, 48, 32 };
+    Layout row = { "R", 3, 8, 160, 230, 64, 64 };
+
+    scanAll(testName, &sequential);
+    scanAll(testName, &pixel);
+    scanAll(testName, &row);
+}
+
+/*
+ *  After a sequential read of the first row of blocks, the next read
+ *  waits for the read-ahead, so the second row of blocks has been
+ *  decoded by then
+ */
+TEST_CASE(testAhead)
+{
+    nitf_Uint32 blocksPerRow = (blocked.numCols + blocked.numColsPerBlock
+                                - 1) / blocked.numColsPerBlock;
+    nitf_IOInterface *io;
+    nitf_Reader *reader;
+    nitf_Record *record;
+    nitf_ImageIO *image;
+
+    writeImage(testName, &blocked);
+    image = openImage(testName, &io, &reader, &record,
+                      NITF_DECOMPRESSION_CONCURRENT_READ_BLOCK |
+                      NITF_DECOMPRESSION_READ_BLOCK_INTO);
+    nitf_ImageIO_setReadCacheSize(image, 4 * blockRowBytes(&blocked));
+    nitf_ImageIO_setReadAhead(image, NITF_READ_AHEAD_SEQUENTIAL);
+    checkWindow(testName, &blocked, image, io, 0, 0,
+                blocked.numRowsPerBlock, blocked.numCols);
+    checkWindow(testName, &blocked, image, io, 0, 0, 5, 7);
+    TEST_ASSERT_EQ_INT(decodes.decoded, 2 * blocksPerRow);
+    closeImage(&image, &io, &reader, &record);
+}
+
+/*
+ *  A scan with read-ahead and a cache big enough for two strips decodes
+ *  every block once, whether or not the blocks are decoded in place
+ */
+TEST_CASE(testDecodeOnce)
+{
+    nitf_Uint32 numBlocks = ((blocked.numRows + blocked.numRowsPerBlock - 1)
+                             / blocked.numRowsPerBlock)
+        * ((blocked.numCols + blocked.numColsPerBlock - 1)
+           / blocked.numColsPerBlock);
+    nitf_Uint32 flags[2] =
+    {
+        NITF_DECOMPRESSION_CONCURRENT_READ_BLOCK |
+            NITF_DECOMPRESSION_READ_BLOCK_INTO,
+        NITF_DECOMPRESSION_CONCURRENT_READ_BLOCK
+    };
+    int i;
+
+    writeImage(testName, &blocked);
+    for (i = 0; i < 2; i++)
+    {
+        nitf_IOInterface *io;
+        nitf_Reader *reader;
+        nitf_Record *record;
+        nitf_ImageIO *image = openImage(testName, &io, &reader, &record,
+                                        flags[i]);
+
+        scanStrips(testName, &blocked, image, io, &scans[0]);
+        TEST_ASSERT_EQ_INT(decodes.decoded, numBlocks);
+        closeImage(&image, &io, &reader, &record);
+    }
+}
+
+/*
+ *  Turning read-ahead off waits for the background thread, so the IO can
+ *  be closed right after
+ */
+TEST_CASE(testOff)
+{
+    nitf_Error error;
+    nitf_IOInterface *io;
+    nitf_Reader *reader;
+    nitf_Record *record;
+    nitf_ImageIO *image;
+
+    writeImage(testName, &blocked);
+    image = openImage(testName, &io, &reader, &record,
+                      NITF_DECOMPRESSION_CONCURRENT_READ_BLOCK |
+                      NITF_DECOMPRESSION_READ_BLOCK_INTO);
+    nitf_ImageIO_setReadCacheSize(image, 4 * blockRowBytes(&blocked));
+    nitf_ImageIO_setReadAhead(image, NITF_READ_AHEAD_SEQUENTIAL);
+    checkWindow(testName, &blocked, image, io, 0, 0,
+                blocked.numRowsPerBlock, blocked.numCols);
+    nitf_ImageIO_setReadAhead(image, NITF_READ_AHEAD_OFF);
+
+    nitf_Mutex_lock(&decodes.lock);
+    decodes.closed = 1;
+    nitf_Mutex_unlock(&decodes.lock);
+    nitf_IOInterface_close(io, &error);
+    nitf_ImageIO_destruct(&image);
+    nitf_Record_destruct(&record);
+    nitf_Reader_destruct(&reader);
+    nitf_IOInterface_destruct(&io);
+}
+
+int main(int argc, char **argv)
+{
+    nitf_Mutex_init(&decodes.lock);
+    CHECK(testBandSequential);
+    CHECK(testOtherModes);
+    CHECK(testAhead);
+    CHECK(testDecodeOnce);
+    CHECK(testOff);
+    nitf_Mutex_delete(&decodes.lock);
+    remove(TEST_FILE_NAME);
+    return 0;
+}
@@ -0,0 +1,345 @@
+/* =========================================================================
+ * This file is part of NITRO
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2010, General Dynamics - Advanced Information Systems
+ *
+ * NITRO is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <import/nitf.h>
+#include "Test.h"
+
+#define TEST_FILE_NAME "test_strip_write.ntf"
+#define MAX_BANDS 3
+
+typedef struct
+{
+    const char *mode;
+    nitf_Uint32 numBands;
+    nitf_Uint32 numBits;
+    nitf_Uint32 numRows;
+    nitf_Uint32 numCols;
+    nitf_Uint32 numRowsPerBlock;
+    nitf_Uint32 numColsPerBlock;
+}
+Layout;
+
+/* A strip setting */
+typedef struct
+{
+    nitf_Uint32 rows;             /*!< Rows per strip, added to blockRows */
+    nitf_Uint32 blockRows;        /*!< Block rows per strip */
+    int caching;                  /*!< Write caching, -1 to leave it alone */
+}
+Strip;
+
+/* The first strip setting is the row at a time reference */
+static const Strip strips[] =
+{
+    { 1, 0, -1 },
+    { 0, 0, -1 },
+    { 7, 0, -1 },
+    { 0, 2, -1 },
+    { 5, 1, -1 },
+    { 100000, 0, -1 },
+    { 0, 2, 0 },
+    { 7, 0, 1 }
+};
+
+#define NUM_STRIPS (sizeof(strips) / sizeof(strips[0]))
+
+static nitf_Uint32 pixel(const Layout *layout, nitf_Uint32 band,
+                         nitf_Uint32 row, nitf_Uint32 col)
+{
+    nitf_Uint32 value = (band * 97 + row * 7 + col * 3 + (row * col) % 13)
+        ^ ((row * 40503 + col * 9973) << 8);
+
+    return layout->numBits == 32 ? value :
+        value & ((((nitf_Uint32) 1) << layout->numBits) - 1);
+}
+
+static nitf_Uint32 load(const nitf_Uint8 *buffer, nitf_Uint32 bytes,
+                        size_t index)
+{
+    if (bytes == 1)
+        return buffer[index];
+    if (bytes == 2)
+        return ((const nitf_Uint16 *) buffer)[index];
+    return ((const nitf_Uint32 *) buffer)[index];
+}
+
+/*
+ *  Write the image with the strip setting. Unless the strip height is
+ *  zero, in which case the writer's default is kept.
+ */
+static void writeImage(const char *testName, const Layout *layout,
+                       const Strip *strip)
+{
+    nitf_Error error;
+    nitf_Record *record;
+    nitf_ImageSegment *segment;
+    nitf_BandInfo **bands;
+    nitf_Writer *writer;
+    nitf_ImageWriter *imageWriter;
+    nitf_ImageSource *source;
+    nitf_IOHandle out;
+    nitf_Uint32 bytes = (layout->numBits + 7) / 8;
+    size_t size = (size_t) layout->numRows * layout->numCols * bytes;
+    nitf_Uint32 stripRows = strip->rows + strip->blockRows
+        * layout->numRowsPerBlock;
+    nitf_Uint8 *data[MAX_BANDS];
+    nitf_Uint32 band, row, col;
+
+    record = nitf_Record_construct(NITF_VER_21, &error);
+    TEST_ASSERT(record);
+    segment = nitf_Record_newImageSegment(record, &error);
+    TEST_ASSERT(segment);
+    bands = (nitf_BandInfo **) NITF_MALLOC(sizeof(nitf_BandInfo *)
+                                           * layout->numBands);
+    TEST_ASSERT(bands);
+    for (band = 0; band < layout->numBands; band++)
+    {
+        bands[band] = nitf_BandInfo_construct(&error);
+        TEST_ASSERT(bands[band]);
+        TEST_ASSERT(nitf_BandInfo_init(bands[band], "M", " ", "N", "   ",
+                                       0, 0, NULL, &error));
+    }
+    TEST_ASSERT(nitf_ImageSubheader_setPixelInformation(segment->subheader,
+                                                        "INT",
+                                                        layout->numBits,
+                                                        layout->numBits, "R",
+                                                        layout->numBands == 1 ?
+                                                        "MONO" : "MULTI",
+                                                        "VIS",
+                                                        layout->numBands,
+                                                        bands, &error));
+    TEST_ASSERT(nitf_ImageSubheader_setBlocking(segment->subheader,
+                                                layout->numRows,
+                                                layout->numCols,
+                                                layout->numRowsPerBlock,
+                                                layout->numColsPerBlock,
+                                                layout->mode, &error));
+
+    out = nitf_IOHandle_create(TEST_FILE_NAME, NITF_ACCESS_WRITEONLY,
+                               NITF_CREATE, &error);
+    TEST_ASSERT(!NITF_INVALID_HANDLE(out));
+    writer = nitf_Writer_construct(&error);
+    TEST_ASSERT(writer);
+    TEST_ASSERT(nitf_Writer_prepare(writer, record, out, &error));
+    imageWriter = nitf_Writer_newImageWriter(writer, 0, &error);
+    TEST_ASSERT(imageWriter);
+    if (strip->caching >= 0)
+        nitf_ImageWriter_setWriteCaching(imageWriter, strip->caching);
+    if (stripRows > 0)
+        nitf_ImageWriter_setRowsPerStrip(imageWriter, stripRows);
+
+    source = nitf_ImageSource_construct(&error);
+    TEST_ASSERT(source);
+    for (band = 0; band < layout->numBands; band++)
+    {
+        nitf_BandSource *bandSource;
+
+        data[band] = (nitf_Uint8 *) NITF_MALLOC(size);
+        TEST_ASSERT(data[band]);
+        for (row = 0; row < layout->numRows; row++)
+            for (col = 0; col < layout->numCols; col++)
+            {
+                nitf_Uint32 value = pixel(layout, band, row, col);
+                size_t n = (size_t) row * layout->numCols + col;
+
+                if (bytes == 1)
+                    data[band][n] = (nitf_Uint8) value;
+                else if (bytes == 2)
+                    ((nitf_Uint16 *) data[band])[n] = (nitf_Uint16) value;
+                else
+                    ((nitf_Uint32 *) data[band])[n] = value;
+            }
+        bandSource = nitf_MemorySource_construct((char *) data[band], size,
+                                                 0, bytes, 0, &error);
+        TEST_ASSERT(bandSource);
+        TEST_ASSERT(nitf_ImageSource_addBand(source, bandSource, &error));
+    }
+    TEST_ASSERT(nitf_ImageWriter_attachSource(imageWriter, source, &error));
+    TEST_ASSERT(nitf_Writer_write(writer, &error));
+
+    nitf_IOHandle_close(out);
+    nitf_Writer_destruct(&writer);
+    nitf_Record_destruct(&record);
+    for (band = 0; band < layout->numBands; band++)
+        NITF_FREE(data[band]);
+}
+
+static void checkWindow(const char *testName, const Layout *layout,
+                        nitf_ImageReader *image, nitf_Uint32 startRow,
+                        nitf_Uint32 startCol, nitf_Uint32 numRows,
+                        nitf_Uint32 numCols)
+{
+    nitf_Error error;
+    nitf_SubWindow window;
+    nitf_Uint32 bandList[MAX_BANDS] = { 0, 1, 2 };
+    nitf_Uint8 *buffers[MAX_BANDS];
+    nitf_Uint32 bytes = (layout->numBits + 7) / 8;
+    nitf_Uint32 band, row, col;
+    int padded;
+
+    memset(&window, 0, sizeof(window));
+    window.startRow = startRow;
+    window.startCol = startCol;
+    window.numRows = numRows;
+    window.numCols = numCols;
+    window.bandList = bandList;
+    window.numBands = layout->numBands;
+    for (band = 0; band < layout->numBands; band++)
+    {
+        buffers[band] = (nitf_Uint8 *) NITF_MALLOC((size_t) numRows
+                                                   * numCols * bytes);
+        TEST_ASSERT(buffers[band]);
+    }
+    TEST_ASSERT(nitf_ImageReader_read(image, &window, buffers, &padded,
+                                      &error));
+    for (band = 0; band < layout->numBands; band++)
+    {
+        for (row = 0; row < numRows; row++)
+            for (col = 0; col < numCols; col++)
+                TEST_ASSERT(load(buffers[band], bytes,
+                                 (size_t) row * numCols + col) ==
+                            pixel(layout, band, startRow + row,
+                                  startCol + col));
+        NITF_FREE(buffers[band]);
+    }
+}
+
+/*
+ *  Read the image data of the file, and check the pixels
+ */
+static nitf_Uint8 *readImage(const char *testName, const Layout *layout,
+                             size_t *length)
+{
+    nitf_Error error;
+    nitf_IOInterface *io;
+    nitf_Reader *reader;
+    nitf_Record *record;
+    nitf_ImageSegment *segment;
+    nitf_ImageReader *image;
+    nitf_Uint8 *data;
+
+    io = nitf_IOHandleAdapter_open(TEST_FILE_NAME, NITF_ACCESS_READONLY,
+                                   NITF_OPEN_EXISTING, &error);
+    TEST_ASSERT(io);
+    reader = nitf_Reader_construct(&error);
+    TEST_ASSERT(reader);
+    record = nitf_Reader_readIO(reader, io, &error);
+    TEST_ASSERT(record);
+
+    segment = (nitf_ImageSegment *) record->images->first->data;
+    *length = (size_t) (segment->imageEnd - segment->imageOffset);
+    data = (nitf_Uint8 *) NITF_MALLOC(*length);
+    TEST_ASSERT(data);
+    TEST_ASSERT(nitf_IOInterface_readAt(io, (nitf_Off) segment->imageOffset,
+                                        (char *) data, *length, &error));
+
+    image = nitf_Reader_newImageReader(reader, 0, &error);
+    TEST_ASSERT(image);
+    checkWindow(testName, layout, image, 0, 0, layout->numRows,
+                layout->numCols);
+    checkWindow(testName, layout, image, layout->numRows / 7,
+                layout->numCols / 9, layout->numRows / 2,
+                layout->numCols * 2 / 3);
+    checkWindow(testName, layout, image, layout->numRows - 3,
+                layout->numCols - 4, 3, 4);
+
+    nitf_ImageReader_destruct(&image);
+    nitf_Record_destruct(&record);
+    nitf_Reader_destruct(&reader);
+    nitf_IOInterface_close(io, &error);
+    nitf_IOInterface_destruct(&io);
+    return data;
+}
+
+/*
+ *  Write the image row at a time as the reference, then with the default
+ *  strip, strips that do and do not cover whole block rows, a strip
+ *  taller than the image, and with write caching forced on and off. The
+ *  image data must be the same as the reference every time.
+ */
+static void writeStrips(const char *testName, const Layout *layout)
+{
+    nitf_Uint8 *reference = NULL;
+    size_t referenceLength = 0;
+    size_t i;
+
+    for (i = 0; i < NUM_STRIPS; i++)
+    {
+        nitf_Uint8 *data;
+        size_t length;
+
+        writeImage(testName, layout, &strips[i]);
+        data = readImage(testName, layout, &length);
+        if (!reference)
+        {
+            reference = data;
+            referenceLength = length;
+            continue;
+        }
+        TEST_ASSERT(length == referenceLength);
+        TEST_ASSERT(memcmp(data, reference, length) == 0);
+        NITF_FREE(data);
+    }
+    NITF_FREE(reference);
+}
+
+TEST_CASE(testModes)
+{
+    Layout blocked = { "B", 3, 8, 300, 260, 32, 48 };
+    Layout sequential = { "S", 2, 8, 250, 200, 40, 64 };
+    Layout pixels = { "P", 2, 16, 220, 190, 48, 32 };
+    Layout rows = { "R", 3, 8, 160, 230, 64, 64 };
+
+    writeStrips(testName, &blocked);
+    writeStrips(testName, &sequential);
+    writeStrips(testName, &pixels);
+    writeStrips(testName, &rows);
+}
+
+/*
+ *  12-bit pixels are packed sequentially, so strips spanning several
+ *  block rows must finish the blocks in file order, whatever the write
+ *  caching setting
+ */
+TEST_CASE(testPacked)
+{
+    Layout layout = { "B", 2, 12, 130, 170, 32, 48 };
+
+    writeStrips(testName, &layout);
+}
+
+/* A single tall block column */
+TEST_CASE(testTallBlocks)
+{
+    Layout layout = { "B", 1, 32, 600, 120, 512, 40 };
+
+    writeStrips(testName, &layout);
+}
+
+int main(int argc, char **argv)
+{
+    CHECK(testModes);
+    CHECK(testPacked);
+    CHECK(testTallBlocks);
+    remove(TEST_FILE_NAME);
+    return 0;
+}
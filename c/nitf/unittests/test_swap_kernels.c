@@ -0,0 +1,385 @@
+/* =========================================================================
+ * This file is part of NITRO
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2010, General Dynamics - Advanced Information Systems
+ *
+ * NITRO is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <import/nitf.h>
+#include "Test.h"
+
+/*
+ *  The byte swapping pixel format and unformat functions are internal to
+ *  ImageIO.c and are not declared in a header
+ */
+void nitf_ImageIO_unformatSwapExtend_2(nitf_Uint8 * buffer, size_t count,
+                                       nitf_Uint32 shiftCount);
+void nitf_ImageIO_unformatSwapExtend_4(nitf_Uint8 * buffer, size_t count,
+                                       nitf_Uint32 shiftCount);
+void nitf_ImageIO_unformatSwapExtend_8(nitf_Uint8 * buffer, size_t count,
+                                       nitf_Uint32 shiftCount);
+void nitf_ImageIO_formatMask_1(nitf_Uint8 * buffer, size_t count,
+                               nitf_Uint32 shiftCount);
+void nitf_ImageIO_formatMask_2(nitf_Uint8 * buffer, size_t count,
+                               nitf_Uint32 shiftCount);
+void nitf_ImageIO_formatMask_4(nitf_Uint8 * buffer, size_t count,
+                               nitf_Uint32 shiftCount);
+void nitf_ImageIO_formatMask_8(nitf_Uint8 * buffer, size_t count,
+                               nitf_Uint32 shiftCount);
+void nitf_ImageIO_formatShiftSwap_2(nitf_Uint8 * buffer, size_t count,
+                                    nitf_Uint32 shiftCount);
+void nitf_ImageIO_formatShiftSwap_4(nitf_Uint8 * buffer, size_t count,
+                                    nitf_Uint32 shiftCount);
+void nitf_ImageIO_formatShiftSwap_8(nitf_Uint8 * buffer, size_t count,
+                                    nitf_Uint32 shiftCount);
+void nitf_ImageIO_formatMaskSwap_2(nitf_Uint8 * buffer, size_t count,
+                                   nitf_Uint32 shiftCount);
+void nitf_ImageIO_formatMaskSwap_4(nitf_Uint8 * buffer, size_t count,
+                                   nitf_Uint32 shiftCount);
+void nitf_ImageIO_formatMaskSwap_8(nitf_Uint8 * buffer, size_t count,
+                                   nitf_Uint32 shiftCount);
+
+/*
+ *  Values are given as they are in the file and in memory. The functions
+ *  always swap, so values in the file are built with nitf_System_swap*,
+ *  which gives the same results on either byte order. Each test converts
+ *  three pixels, so a function that skips or swaps the wrong pixel fails.
+ */
+
+#define TEST_EQ_64(X1, X2) TEST_ASSERT((nitf_Uint64) (X1) == (nitf_Uint64) (X2))
+
+TEST_CASE(testUnformatSwapExtend)
+{
+    nitf_Int16 in16[3];
+    nitf_Int32 in32[3];
+    nitf_Int64 in64[3];
+
+    /* 12-bit pixels in 16 bits */
+    in16[0] = (nitf_Int16) nitf_System_swap16(0x0801);
+    in16[1] = (nitf_Int16) nitf_System_swap16(0x07ff);
+    in16[2] = (nitf_Int16) nitf_System_swap16(0x0fff);
+    nitf_ImageIO_unformatSwapExtend_2((nitf_Uint8 *) in16, 3, 4);
+    TEST_ASSERT_EQ_INT(in16[0], -2047);
+    TEST_ASSERT_EQ_INT(in16[1], 2047);
+    TEST_ASSERT_EQ_INT(in16[2], -1);
+
+    /* 20-bit pixels in 32 bits */
+    in32[0] = (nitf_Int32) nitf_System_swap32(0x00080001);
+    in32[1] = (nitf_Int32) nitf_System_swap32(0x0007ffff);
+    in32[2] = (nitf_Int32) nitf_System_swap32(0x000ffffe);
+    nitf_ImageIO_unformatSwapExtend_4((nitf_Uint8 *) in32, 3, 12);
+    TEST_ASSERT_EQ_INT(in32[0], -524287);
+    TEST_ASSERT_EQ_INT(in32[1], 524287);
+    TEST_ASSERT_EQ_INT(in32[2], -2);
+
+    /* 40-bit pixels in 64 bits */
+    in64[0] = (nitf_Int64) nitf_System_swap64(0x0000008000000001ULL);
+    in64[1] = (nitf_Int64) nitf_System_swap64(0x0000007fffffffffULL);
+    in64[2] = (nitf_Int64) nitf_System_swap64(0x000000fffffffffdULL);
+    nitf_ImageIO_unformatSwapExtend_8((nitf_Uint8 *) in64, 3, 24);
+    TEST_EQ_64(in64[0], 0xffffff8000000001ULL);
+    TEST_EQ_64(in64[1], 0x0000007fffffffffULL);
+    TEST_EQ_64(in64[2], (nitf_Int64) -3);
+}
+
+TEST_CASE(testFormatMask)
+{
+    nitf_Uint8 in8[3] = { 0xff, 0xc5, 0x3a };
+    nitf_Uint16 in16[3] = { 0xffff, 0xf123, 0x0456 };
+    nitf_Uint32 in32[3] = { 0xffffffff, 0xfff12345, 0x00054321 };
+    nitf_Uint64 in64[3] =
+        { 0xffffffffffffffffULL, 0xffffff1234567890ULL,
+          0x0000000987654321ULL };
+
+    /* The actual bits are the low bits, the unused high bits are cleared */
+    nitf_ImageIO_formatMask_1(in8, 3, 2);
+    TEST_ASSERT_EQ_INT(in8[0], 0x3f);
+    TEST_ASSERT_EQ_INT(in8[1], 0x05);
+    TEST_ASSERT_EQ_INT(in8[2], 0x3a);
+
+    nitf_ImageIO_formatMask_2((nitf_Uint8 *) in16, 3, 4);
+    TEST_ASSERT_EQ_INT(in16[0], 0x0fff);
+    TEST_ASSERT_EQ_INT(in16[1], 0x0123);
+    TEST_ASSERT_EQ_INT(in16[2], 0x0456);
+
+    nitf_ImageIO_formatMask_4((nitf_Uint8 *) in32, 3, 12);
+    TEST_ASSERT(in32[0] == 0x000fffff);
+    TEST_ASSERT(in32[1] == 0x00012345);
+    TEST_ASSERT(in32[2] == 0x00054321);
+
+    nitf_ImageIO_formatMask_8((nitf_Uint8 *) in64, 3, 24);
+    TEST_EQ_64(in64[0], 0x000000ffffffffffULL);
+    TEST_EQ_64(in64[1], 0x0000001234567890ULL);
+    TEST_EQ_64(in64[2], 0x0000000987654321ULL);
+}
+
+TEST_CASE(testFormatShiftSwap)
+{
+    nitf_Int16 in16[3] = { 0x0123, 0x0fff, 0x0800 };
+    nitf_Int32 in32[3] = { 0x00123456, 0x00ffffff, 0x00800001 };
+    nitf_Int64 in64[3] = { 0x0000123456789abcLL, 0x00007fffffffffffLL, 1 };
+
+    /* Left justified: the actual bits are shifted to the top */
+    nitf_ImageIO_formatShiftSwap_2((nitf_Uint8 *) in16, 3, 4);
+    TEST_ASSERT_EQ_INT(in16[0], (nitf_Int16) nitf_System_swap16(0x1230));
+    TEST_ASSERT_EQ_INT(in16[1], (nitf_Int16) nitf_System_swap16(0xfff0));
+    TEST_ASSERT_EQ_INT(in16[2], (nitf_Int16) nitf_System_swap16(0x8000));
+
+    nitf_ImageIO_formatShiftSwap_4((nitf_Uint8 *) in32, 3, 8);
+    TEST_ASSERT(in32[0] == (nitf_Int32) nitf_System_swap32(0x12345600));
+    TEST_ASSERT(in32[1] == (nitf_Int32) nitf_System_swap32(0xffffff00));
+    TEST_ASSERT(in32[2] == (nitf_Int32) nitf_System_swap32(0x80000100));
+
+    nitf_ImageIO_formatShiftSwap_8((nitf_Uint8 *) in64, 3, 16);
+    TEST_EQ_64(in64[0], nitf_System_swap64(0x123456789abc0000ULL));
+    TEST_EQ_64(in64[1], nitf_System_swap64(0x7fffffffffff0000ULL));
+    TEST_EQ_64(in64[2], nitf_System_swap64(0x0000000000010000ULL));
+}
+
+TEST_CASE(testFormatMaskSwap)
+{
+    nitf_Uint16 in16[3] = { 0xf123, 0xe456, 0x0789 };
+    nitf_Uint32 in32[3] = { 0xfff12345, 0x00054321, 0xfffffffe };
+    nitf_Uint64 in64[3] =
+        { 0xffffff1234567890ULL, 0x0000000987654321ULL,
+          0xfffffffffffffffeULL };
+
+    /* Each pixel is masked and then swapped in place */
+    nitf_ImageIO_formatMaskSwap_2((nitf_Uint8 *) in16, 3, 4);
+    TEST_ASSERT_EQ_INT(in16[0], nitf_System_swap16(0x0123));
+    TEST_ASSERT_EQ_INT(in16[1], nitf_System_swap16(0x0456));
+    TEST_ASSERT_EQ_INT(in16[2], nitf_System_swap16(0x0789));
+
+    nitf_ImageIO_formatMaskSwap_4((nitf_Uint8 *) in32, 3, 12);
+    TEST_ASSERT(in32[0] == nitf_System_swap32(0x00012345));
+    TEST_ASSERT(in32[1] == nitf_System_swap32(0x00054321));
+    TEST_ASSERT(in32[2] == nitf_System_swap32(0x000ffffe));
+
+    nitf_ImageIO_formatMaskSwap_8((nitf_Uint8 *) in64, 3, 24);
+    TEST_EQ_64(in64[0], nitf_System_swap64(0x0000001234567890ULL));
+    TEST_EQ_64(in64[1], nitf_System_swap64(0x0000000987654321ULL));
+    TEST_EQ_64(in64[2], nitf_System_swap64(0x000000fffffffffeULL));
+}
+
+#define TEST_FILE_NAME "test_swap_kernels.ntf"
+#define NUM_ROWS 40
+#define NUM_COLS 261
+#define NUM_BANDS 2
+
+/*
+ *  Pattern value of a pixel with numBitsActual bits, sign extended to
+ *  numBits for "SI"
+ */
+static nitf_Uint32 pixel(const char *pixelType, nitf_Uint32 numBits,
+                         nitf_Uint32 numBitsActual, nitf_Uint32 band,
+                         nitf_Uint32 row, nitf_Uint32 col)
+{
+    nitf_Uint32 mask = numBitsActual < 32 ?
+        (((nitf_Uint32) 1) << numBitsActual) - 1 : 0xffffffff;
+    nitf_Uint32 value;
+
+    value = (band * 97 + row * 7 + col * 3 + (row * col) % 13)
+        ^ ((row * 40503 + col * 9973) << 8);
+    value &= mask;
+    if (strcmp(pixelType, "SI") == 0 && (value & (mask ^ (mask >> 1))))
+        value |= ~mask;
+    if (numBits < 32)
+        value &= (((nitf_Uint32) 1) << numBits) - 1;
+    return value;
+}
+
+/*
+ *  Write an image and read it back with windows of every width up to a
+ *  few vectors, so each read also has pixels left over after the last
+ *  full vector. The reader uses the vector kernels where the machine has
+ *  them, and the pattern is computed one pixel at a time.
+ */
+static void roundTrip(const char *testName, const char *mode,
+                      const char *pixelType, nitf_Uint32 numBits,
+                      nitf_Uint32 numBitsActual, const char *justification)
+{
+    nitf_Error error;
+    nitf_Record *record;
+    nitf_ImageSegment *segment;
+    nitf_BandInfo **bands;
+    nitf_Writer *writer;
+    nitf_ImageWriter *imageWriter;
+    nitf_ImageSource *source;
+    nitf_IOHandle out;
+    nitf_Reader *reader;
+    nitf_ImageReader *image;
+    nitf_SubWindow window;
+    nitf_Uint32 bandList[NUM_BANDS] = { 0, 1 };
+    nitf_Uint32 bytes = numBits / 8;
+    nitf_Uint8 *data[NUM_BANDS];
+    nitf_Uint32 band, row, col, numCols;
+    int padded;
+
+    record = nitf_Record_construct(NITF_VER_21, &error);
+    TEST_ASSERT(record);
+    segment = nitf_Record_newImageSegment(record, &error);
+    TEST_ASSERT(segment);
+    bands = (nitf_BandInfo **) NITF_MALLOC(sizeof(nitf_BandInfo *)
+                                           * NUM_BANDS);
+    TEST_ASSERT(bands);
+    for (band = 0; band < NUM_BANDS; band++)
+    {
+        bands[band] = nitf_BandInfo_construct(&error);
+        TEST_ASSERT(bands[band]);
+        TEST_ASSERT(nitf_BandInfo_init(bands[band], "M", " ", "N", "   ",
+                                       0, 0, NULL, &error));
+    }
+    TEST_ASSERT(nitf_ImageSubheader_setPixelInformation(segment->subheader,
+                                                        pixelType, numBits,
+                                                        numBitsActual,
+                                                        justification,
+                                                        "MULTI", "VIS",
+                                                        NUM_BANDS, bands,
+                                                        &error));
+    TEST_ASSERT(nitf_ImageSubheader_setBlocking(segment->subheader,
+                                                NUM_ROWS, NUM_COLS, 16, 47,
+                                                mode, &error));
+
+    out = nitf_IOHandle_create(TEST_FILE_NAME, NITF_ACCESS_WRITEONLY,
+                               NITF_CREATE, &error);
+    TEST_ASSERT(!NITF_INVALID_HANDLE(out));
+    writer = nitf_Writer_construct(&error);
+    TEST_ASSERT(writer);
+    TEST_ASSERT(nitf_Writer_prepare(writer, record, out, &error));
+    imageWriter = nitf_Writer_newImageWriter(writer, 0, &error);
+    TEST_ASSERT(imageWriter);
+    source = nitf_ImageSource_construct(&error);
+    TEST_ASSERT(source);
+    for (band = 0; band < NUM_BANDS; band++)
+    {
+        nitf_BandSource *bandSource;
+
+        data[band] = (nitf_Uint8 *) NITF_MALLOC(NUM_ROWS * NUM_COLS * bytes);
+        TEST_ASSERT(data[band]);
+        for (row = 0; row < NUM_ROWS; row++)
+            for (col = 0; col < NUM_COLS; col++)
+            {
+                nitf_Uint32 value = pixel(pixelType, numBits, numBitsActual,
+                                          band, row, col);
+
+                if (bytes == 2)
+                    ((nitf_Uint16 *) data[band])[row * NUM_COLS + col] =
+                        (nitf_Uint16) value;
+                else
+                    ((nitf_Uint32 *) data[band])[row * NUM_COLS + col] =
+                        value;
+            }
+        bandSource = nitf_MemorySource_construct((char *) data[band],
+                                                 NUM_ROWS * NUM_COLS * bytes,
+                                                 0, bytes, 0, &error);
+        TEST_ASSERT(bandSource);
+        TEST_ASSERT(nitf_ImageSource_addBand(source, bandSource, &error));
+    }
+    TEST_ASSERT(nitf_ImageWriter_attachSource(imageWriter, source, &error));
+    TEST_ASSERT(nitf_Writer_write(writer, &error));
+    nitf_IOHandle_close(out);
+    nitf_Writer_destruct(&writer);
+    nitf_Record_destruct(&record);
+
+    out = nitf_IOHandle_create(TEST_FILE_NAME, NITF_ACCESS_READONLY,
+                               NITF_OPEN_EXISTING, &error);
+    TEST_ASSERT(!NITF_INVALID_HANDLE(out));
+    reader = nitf_Reader_construct(&error);
+    TEST_ASSERT(reader);
+    record = nitf_Reader_read(reader, out, &error);
+    TEST_ASSERT(record);
+    image = nitf_Reader_newImageReader(reader, 0, &error);
+    TEST_ASSERT(image);
+
+    for (numCols = 1; numCols <= NUM_COLS; numCols += numCols < 40 ? 1 : 220)
+    {
+        memset(&window, 0, sizeof(window));
+        window.startRow = 3;
+        window.startCol = NUM_COLS - numCols;
+        window.numRows = NUM_ROWS - 3;
+        window.numCols = numCols;
+        window.bandList = bandList;
+        window.numBands = NUM_BANDS;
+        TEST_ASSERT(nitf_ImageReader_read(image, &window, data, &padded,
+                                          &error));
+
+        for (band = 0; band < NUM_BANDS; band++)
+            for (row = 0; row < window.numRows; row++)
+                for (col = 0; col < numCols; col++)
+                {
+                    size_t n = (size_t) row * numCols + col;
+                    nitf_Uint32 got = bytes == 2 ?
+                        ((nitf_Uint16 *) data[band])[n] :
+                        ((nitf_Uint32 *) data[band])[n];
+
+                    TEST_ASSERT(got == pixel(pixelType, numBits,
+                                             numBitsActual, band,
+                                             window.startRow + row,
+                                             window.startCol + col));
+                }
+    }
+
+    for (band = 0; band < NUM_BANDS; band++)
+        NITF_FREE(data[band]);
+    nitf_ImageReader_destruct(&image);
+    nitf_Record_destruct(&record);
+    nitf_Reader_destruct(&reader);
+    nitf_IOHandle_close(out);
+}
+
+TEST_CASE(testSwap)
+{
+    roundTrip(testName, "B", "INT", 16, 16, "R");
+    roundTrip(testName, "B", "INT", 32, 32, "R");
+    roundTrip(testName, "B", "R", 32, 32, "R");
+    roundTrip(testName, "P", "INT", 16, 16, "R");
+}
+
+TEST_CASE(testSwapExtend)
+{
+    roundTrip(testName, "B", "SI", 16, 12, "R");
+    roundTrip(testName, "B", "SI", 32, 20, "R");
+}
+
+TEST_CASE(testSwapMask)
+{
+    roundTrip(testName, "B", "INT", 16, 11, "R");
+    roundTrip(testName, "B", "INT", 32, 25, "R");
+}
+
+TEST_CASE(testSwapShift)
+{
+    roundTrip(testName, "B", "SI", 16, 12, "L");
+    roundTrip(testName, "B", "INT", 16, 12, "L");
+    roundTrip(testName, "B", "SI", 32, 24, "L");
+    roundTrip(testName, "B", "INT", 32, 24, "L");
+}
+
+int main(int argc, char **argv)
+{
+    CHECK(testUnformatSwapExtend);
+    CHECK(testFormatMask);
+    CHECK(testFormatShiftSwap);
+    CHECK(testFormatMaskSwap);
+    CHECK(testSwap);
+    CHECK(testSwapExtend);
+    CHECK(testSwapMask);
+    CHECK(testSwapShift);
+    remove(TEST_FILE_NAME);
+    return 0;
+}
@@ -23,6 +23,7 @@
 #ifndef __IMPORT_NRT_H__
 #define __IMPORT_NRT_H__
 
+#include "nrt/Arena.h"
 #include "nrt/DateTime.h"
 #include "nrt/Debug.h"
 #include "nrt/Defines.h"
@@ -0,0 +1,114 @@
+/* =========================================================================
+ * This file is part of NITRO
+ * =========================================================================
+ * 
+ * (C) Copyright 2004 - 2010, General Dynamics - Advanced Information Systems
+ *
+ * NITRO is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public 
+ * License along with this program; 
+ * If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __NRT_ARENA_H__
+#define __NRT_ARENA_H__
+
+#include "nrt/System.h"
+
+/*!
+ *  \file
+ *  An arena is a region allocator.  While an arena is current on a
+ *  thread, nrt_Arena_malloc carves memory out of large chunks instead of
+ *  going to the heap, so many small objects (fields, list nodes, hash
+ *  pairs) land next to each other.  The chunks of every arena are kept in
+ *  a registry, so nrt_Arena_free may be called on any block at any time,
+ *  from any thread, whether or not an arena is current.  The chunks are
+ *  returned in bulk once the owner has released the arena and every block
+ *  in it has been freed.
+ *
+ *  When no arena is current, nrt_Arena_malloc is NRT_MALLOC: the block is
+ *  ordinary heap memory, and may be released with NRT_FREE as well.
+ */
+
+#define NRT_ARENA_DEFAULT_CHUNK_SIZE (64 * 1024)
+
+NRT_CXX_GUARD
+
+typedef struct _nrt_ArenaChunk
+{
+    struct _nrt_ArenaChunk *next;   /* The previously filled chunk */
+    size_t size;                    /* The usable bytes in this chunk */
+    size_t used;                    /* The bytes handed out so far */
+} nrt_ArenaChunk;
+
+typedef struct _nrt_Arena
+{
+    nrt_ArenaChunk *chunks;         /* The chunk being filled, then older */
+    size_t chunkSize;               /* Usable bytes in each new chunk */
+    volatile long live;             /* Live blocks, plus one for the owner */
+    long pending;                   /* Credit taken from live, not yet used */
+} nrt_Arena;
+
+/*!
+ *  Construct an arena.  The caller owns one reference to it, which is
+ *  given up with nrt_Arena_release.
+ *
+ *  \param chunkSize  The size of each chunk, or 0 for the default
+ *  \param error      Populated on failure
+ *  \return The new arena, or NULL on failure
+ */
+NRTAPI(nrt_Arena *) nrt_Arena_construct(size_t chunkSize, nrt_Error * error);
+
+/*!
+ *  Give up the owner reference to the arena.  If the arena is current on
+ *  this thread it stops being current.  The chunks are released now if
+ *  nothing allocated from the arena is still alive, otherwise when the
+ *  last block is freed.
+ *
+ *  \param arena  The arena, set to NULL on return
+ */
+NRTAPI(void) nrt_Arena_release(nrt_Arena ** arena);
+
+/*!
+ *  Make an arena current for nrt_Arena_malloc on the calling thread.  An
+ *  arena must not be current on two threads at once.  If the compiler
+ *  offers no thread local storage, this does nothing and all allocations
+ *  go to the heap.
+ *
+ *  \param arena  The arena to use, or NULL to allocate from the heap
+ *  \return The arena that was current before
+ */
+NRTAPI(nrt_Arena *) nrt_Arena_setCurrent(nrt_Arena * arena);
+
+/*!
+ *  Allocate from the current arena, or from the heap if there is none.
+ *  Requests larger than a quarter chunk always go to the heap.  A block
+ *  carved from an arena must be released with nrt_Arena_free, never
+ *  NRT_FREE.
+ *
+ *  \param size  The number of bytes
+ *  \return The block, or NULL if memory is exhausted
+ */
+NRTAPI(void *) nrt_Arena_malloc(size_t size);
+
+/*!
+ *  Free a block from nrt_Arena_malloc, or from NRT_MALLOC.  NULL is
+ *  ignored.
+ *
+ *  \param ptr  The block to free
+ */
+NRTAPI(void) nrt_Arena_free(void *ptr);
+
+NRT_CXX_ENDGUARD
+
+#endif
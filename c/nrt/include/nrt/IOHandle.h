@@ -32,6 +32,16 @@
 #define NRT_MAX_READ_ATTEMPTS 100
 #endif
 
+/*!
+ *  \struct nrt_IOVec
+ *  \brief One destination of a vectored read (see nrt_IOHandle_readvAt)
+ */
+typedef struct _NRT_IOVec
+{
+    char *buf;                  /* Where the bytes go */
+    size_t size;                /* How many bytes */
+} nrt_IOVec;
+
 NRT_CXX_GUARD
 /*!
  *  Create an IO handle.  If the file is set to create,
@@ -66,6 +76,55 @@ NRTAPI(nrt_IOHandle) nrt_IOHandle_create(const char *fname,
 NRTAPI(NRT_BOOL) nrt_IOHandle_read(nrt_IOHandle handle, char *buf, size_t size,
                                    nrt_Error * error);
 
+/*!
+ *  Read from the IO handle at an absolute offset.  Like nrt_IOHandle_read,
+ *  this function reads the requisite number of bytes or fails out.  The
+ *  read does not depend on the current file position, so several threads
+ *  may read from the same handle at once.  On Unix the file position is
+ *  left unchanged.
+ *
+ *  \param handle The handle to read from
+ *  \param offset The offset from the beginning of the file
+ *  \param buf    The buffer to read into
+ *  \param size   The number of bytes to read
+ *  \param error  Populated if function returns 0
+ *  \return       1 on success and 0 otherwise
+ */
+NRTAPI(NRT_BOOL) nrt_IOHandle_readAt(nrt_IOHandle handle, nrt_Off offset,
+                                     char *buf, size_t size,
+                                     nrt_Error * error);
+
+/*!
+ *  Read one contiguous range of the file into several buffers, as if
+ *  nrt_IOHandle_readAt were called for each buffer in turn with the
+ *  offset advanced by the sizes of the ones before it.  Where the system
+ *  has a vectored positional read (preadv) the whole range is read with
+ *  as few calls as it allows.
+ *
+ *  \param handle The handle to read from
+ *  \param offset The offset of the first byte of the range
+ *  \param vec    The buffers, in file order
+ *  \param count  The number of buffers
+ *  \param error  Populated if function returns 0
+ *  \return       1 on success and 0 otherwise
+ */
+NRTAPI(NRT_BOOL) nrt_IOHandle_readvAt(nrt_IOHandle handle, nrt_Off offset,
+                                      const nrt_IOVec * vec, int count,
+                                      nrt_Error * error);
+
+/*!
+ *  Tell the operating system that a range of the file will be read soon,
+ *  so it can start reading it into the page cache.  This is only a hint:
+ *  it does nothing where the system has no such call, and failures are
+ *  ignored.
+ *
+ *  \param handle The handle that will be read
+ *  \param offset The offset from the beginning of the file
+ *  \param length The number of bytes that will be read
+ */
+NRTAPI(void) nrt_IOHandle_adviseWillNeed(nrt_IOHandle handle, nrt_Off offset,
+                                         nrt_Off length);
+
 /*!
  *  Write to the IO handle.  This function attempts to write to the IO handle
  *  until it has written the requisite number of bytes (specified as the size
@@ -80,6 +139,24 @@ NRTAPI(NRT_BOOL) nrt_IOHandle_read(nrt_IOHandle handle, char *buf, size_t size,
 NRTAPI(NRT_BOOL) nrt_IOHandle_write(nrt_IOHandle handle, const char *buf,
                                     size_t size, nrt_Error * error);
 
+/*!
+ *  Write to the IO handle at an absolute offset.  Like nrt_IOHandle_write,
+ *  this function writes the requisite number of bytes or fails out.  The
+ *  write does not depend on the current file position, so several threads
+ *  may write different parts of the same handle at once.  On Unix the file
+ *  position is left unchanged.
+ *
+ *  \param handle The handle to write to
+ *  \param offset The offset from the beginning of the file
+ *  \param buf    The buffer to write from
+ *  \param size   The number of bytes to write
+ *  \param error  Populated if function returns 0
+ *  \return       1 on success and 0 otherwise
+ */
+NRTAPI(NRT_BOOL) nrt_IOHandle_writeAt(nrt_IOHandle handle, nrt_Off offset,
+                                      const char *buf, size_t size,
+                                      nrt_Error * error);
+
 /*!
  *  Seek into the handle at this point.  Basically
  *  has the same usage as lseek().  If whence is SEEK_SET, the seek
@@ -120,6 +197,28 @@ NRTAPI(nrt_Off) nrt_IOHandle_tell(nrt_IOHandle handle, nrt_Error * error);
  */
 NRTAPI(nrt_Off) nrt_IOHandle_getSize(nrt_IOHandle handle, nrt_Error * error);
 
+/*!
+ *  Map the first size bytes of the file into memory for reading.  The
+ *  handle must have been opened for reading.  The mapping does not depend
+ *  on the handle once it is made, so the handle may be closed while the
+ *  mapping is in use.
+ *
+ *  \param handle The handle to map
+ *  \param size   The number of bytes to map, usually the file size
+ *  \param error  Populated if the function returns NULL
+ *  \return       The start of the mapping or NULL on failure
+ */
+NRTAPI(const char *) nrt_IOHandle_map(nrt_IOHandle handle, nrt_Off size,
+                                      nrt_Error * error);
+
+/*!
+ *  Release a mapping made by nrt_IOHandle_map.
+ *
+ *  \param map  The start of the mapping
+ *  \param size The size given to nrt_IOHandle_map
+ */
+NRTAPI(void) nrt_IOHandle_unmap(const char *map, nrt_Off size);
+
 /*!
  *  Close the IO handle.
  *
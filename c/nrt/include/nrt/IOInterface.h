@@ -39,6 +39,40 @@ typedef nrt_Off(*NRT_IO_INTERFACE_GET_SIZE) (NRT_DATA *, nrt_Error *);
 typedef int (*NRT_IO_INTERFACE_GET_MODE) (NRT_DATA *, nrt_Error *);
 typedef NRT_BOOL(*NRT_IO_INTERFACE_CLOSE) (NRT_DATA *, nrt_Error *);
 typedef void (*NRT_IO_INTERFACE_DESTRUCT) (NRT_DATA *);
+typedef NRT_BOOL(*NRT_IO_INTERFACE_READ_AT) (NRT_DATA *, nrt_Off, char *,
+                                             size_t, nrt_Error *);
+typedef const char *(*NRT_IO_INTERFACE_GET_MAPPING) (NRT_DATA *, nrt_Off *);
+typedef void (*NRT_IO_INTERFACE_ADVISE_WILL_NEED) (NRT_DATA *, nrt_Off,
+                                                   nrt_Off);
+typedef NRT_BOOL(*NRT_IO_INTERFACE_READV_AT) (NRT_DATA *, nrt_Off,
+                                              const nrt_IOVec *, int,
+                                              nrt_Error *);
+
+/**
+ * One read of a batch (see nrt_IOInterface_readBatch).  The buffers are
+ * filled in turn from one contiguous range of the interface.
+ */
+typedef struct _NRT_IORequest
+{
+    nrt_Off offset;             /* Offset of the first byte */
+    const nrt_IOVec *vec;       /* The buffers, in file order */
+    int count;                  /* The number of buffers */
+    void *user;                 /* Not used by the interface */
+} nrt_IORequest;
+
+/**
+ * Called as each read of a batch completes.  Returning NRT_FAILURE, with
+ * the error set, stops the batch.
+ */
+typedef NRT_BOOL(*NRT_IO_COMPLETION) (void *arg, nrt_IORequest * request,
+                                      nrt_Error * error);
+
+typedef NRT_BOOL(*NRT_IO_INTERFACE_READ_BATCH) (NRT_DATA *, nrt_IORequest *,
+                                                int, NRT_IO_COMPLETION,
+                                                void *, nrt_Error *);
+typedef NRT_BOOL(*NRT_IO_INTERFACE_WRITE_AT) (NRT_DATA *, nrt_Off,
+                                              const char *, size_t,
+                                              nrt_Error *);
 
 typedef struct _NRT_IIOInterface
 {
@@ -51,6 +85,13 @@ typedef struct _NRT_IIOInterface
     NRT_IO_INTERFACE_GET_MODE getMode;
     NRT_IO_INTERFACE_CLOSE close;
     NRT_IO_INTERFACE_DESTRUCT destruct;
+    /* Optional, may be NULL. Must go last so existing initializers work */
+    NRT_IO_INTERFACE_READ_AT readAt;
+    NRT_IO_INTERFACE_GET_MAPPING getMapping;
+    NRT_IO_INTERFACE_ADVISE_WILL_NEED adviseWillNeed;
+    NRT_IO_INTERFACE_READV_AT readvAt;
+    NRT_IO_INTERFACE_READ_BATCH readBatch;
+    NRT_IO_INTERFACE_WRITE_AT writeAt;
 } nrt_IIOInterface;
 
 typedef struct _NRT_IOInterface
@@ -65,12 +106,93 @@ typedef struct _NRT_IOInterface
 NRTAPI(NRT_BOOL) nrt_IOInterface_read(nrt_IOInterface *, char *buf, size_t size,
                                       nrt_Error * error);
 
+/**
+ * Reads data from the interface at an absolute offset.  If the interface
+ * supports positional reads (see nrt_IOInterface_canReadAt) the current
+ * offset is not used, and concurrent calls are safe.  Otherwise this falls
+ * back to a seek followed by a read and the caller must serialize access.
+ */
+NRTAPI(NRT_BOOL) nrt_IOInterface_readAt(nrt_IOInterface * io, nrt_Off offset,
+                                        char *buf, size_t size,
+                                        nrt_Error * error);
+
+/**
+ * Reads one contiguous range of the interface, starting at an absolute
+ * offset, into several buffers in turn (see nrt_IOHandle_readvAt).
+ * Interfaces without a vectored read get one nrt_IOInterface_readAt per
+ * buffer, with the same rules about the current offset.
+ */
+NRTAPI(NRT_BOOL) nrt_IOInterface_readvAt(nrt_IOInterface * io, nrt_Off offset,
+                                         const nrt_IOVec * vec, int count,
+                                         nrt_Error * error);
+
+/**
+ * Reads a batch of requests.  Interfaces that can have several reads in
+ * flight (see nrt_AsyncIOAdapter_construct) start them all and call
+ * onComplete, if not NULL, in the calling thread or in one of their own
+ * threads as each one finishes, in whatever order they finish.  The calls
+ * are never concurrent.  Other interfaces read the requests in order with
+ * nrt_IOInterface_readvAt.
+ *
+ * On failure some of the requests may not have been read, but no read is
+ * still in progress when this returns.
+ */
+NRTAPI(NRT_BOOL) nrt_IOInterface_readBatch(nrt_IOInterface * io,
+                                           nrt_IORequest * requests,
+                                           int count,
+                                           NRT_IO_COMPLETION onComplete,
+                                           void *arg, nrt_Error * error);
+
+/**
+ * Returns whether the interface reads batches concurrently, rather than
+ * one request at a time
+ */
+NRTAPI(NRT_BOOL) nrt_IOInterface_canReadBatch(nrt_IOInterface * io);
+
+/**
+ * Returns whether the interface supports positional reads
+ */
+NRTAPI(NRT_BOOL) nrt_IOInterface_canReadAt(nrt_IOInterface * io);
+
+/**
+ * Returns the whole contents of the interface as one read-only block of
+ * memory, or NULL if the interface is not backed by memory that can be
+ * handed out.  On success size is set to the number of bytes available.
+ * The memory remains valid until the interface is closed.
+ */
+NRTAPI(const char *) nrt_IOInterface_getMapping(nrt_IOInterface * io,
+                                                nrt_Off * size);
+
+/**
+ * Hints that a range of the interface will be read soon (see
+ * nrt_IOHandle_adviseWillNeed).  Does nothing if the interface has no use
+ * for the hint.
+ */
+NRTAPI(void) nrt_IOInterface_adviseWillNeed(nrt_IOInterface * io,
+                                            nrt_Off offset, nrt_Off length);
+
 /**
  * Writes data to the interface
  */
 NRTAPI(NRT_BOOL) nrt_IOInterface_write(nrt_IOInterface * io, const char *buf,
                                        size_t size, nrt_Error * error);
 
+/**
+ * Writes data to the interface at an absolute offset.  If the interface
+ * supports positional writes (see nrt_IOInterface_canWriteAt) the current
+ * offset is not used, and concurrent calls that write different ranges are
+ * safe.  Otherwise this falls back to a seek followed by a write and the
+ * caller must serialize access.
+ */
+NRTAPI(NRT_BOOL) nrt_IOInterface_writeAt(nrt_IOInterface * io, nrt_Off offset,
+                                         const char *buf, size_t size,
+                                         nrt_Error * error);
+
+/**
+ * Returns whether the interface supports positional writes
+ */
+NRTAPI(NRT_BOOL) nrt_IOInterface_canWriteAt(nrt_IOInterface * io);
+
 /**
  * Returns whether the interface is seekable
  */
@@ -124,8 +246,85 @@ NRTAPI(nrt_IOInterface *) nrt_IOHandleAdapter_open(const char *fname,
                                                    int creationFlags,
                                                    nrt_Error * error);
 
+/**
+ * Creates a read-only IOInterface that maps the file behind an IOHandle
+ * into memory.  Reads are copies out of the mapping, and the mapping itself
+ * is available through nrt_IOInterface_getMapping.  The interface takes
+ * ownership of the handle and closes it when the interface is closed.
+ */
+NRTAPI(nrt_IOInterface *) nrt_MMapAdapter_construct(nrt_IOHandle handle,
+                                                    nrt_Error * error);
+
+/**
+ * Opens a file read-only and creates an IOInterface that maps it into
+ * memory.
+ */
+NRTAPI(nrt_IOInterface *) nrt_MMapAdapter_open(const char *fname,
+                                               nrt_Error * error);
+
+/**
+ * Creates an IOInterface that wraps an IOHandle, like
+ * nrt_IOHandleAdapter_construct, and reads batches (see
+ * nrt_IOInterface_readBatch) with up to queueDepth reads in flight.
+ *
+ * On Linux the batches are submitted through io_uring when useRing is
+ * set and the kernel allows it.  Otherwise, or if the ring cannot be
+ * created, each batch is read by a pool of threads doing positional reads.
+ * Only one batch runs at a time per interface.
+ */
+NRTAPI(nrt_IOInterface *) nrt_AsyncIOAdapter_construct(nrt_IOHandle handle,
+                                                       int accessMode,
+                                                       int queueDepth,
+                                                       NRT_BOOL useRing,
+                                                       nrt_Error * error);
+
+/**
+ * Opens a file read-only and creates an nrt_AsyncIOAdapter for it that
+ * uses io_uring where available.  The file is closed when the interface
+ * is closed.
+ */
+NRTAPI(nrt_IOInterface *) nrt_AsyncIOAdapter_open(const char *fname,
+                                                  int queueDepth,
+                                                  nrt_Error * error);
+
+/**
+ * Returns whether an nrt_AsyncIOAdapter submits its batches through
+ * io_uring (rather than its thread pool)
+ */
+NRTAPI(NRT_BOOL) nrt_AsyncIOAdapter_usesRing(nrt_IOInterface * io);
+
+/**
+ * Creates an IOInterface that wraps another one and does its writes on a
+ * background thread.  Writes are copied into one of two buffers of
+ * bufferSize bytes (a default size if 0).  When that buffer is full it is
+ * handed to a thread that writes it to the wrapped interface, once the
+ * thread has finished with the other buffer, and writing continues into
+ * the other buffer.  Writes larger than a buffer are made directly.
+ *
+ * Reads, getSize and seeks from the end first write everything buffered.
+ * A failed background write is reported by the next call that waits for
+ * the thread, and by nrt_WriteBehindAdapter_flush.  The wrapped interface
+ * is not destructed with the adapter, but closing the adapter closes it.
+ */
+NRTAPI(nrt_IOInterface *) nrt_WriteBehindAdapter_construct(nrt_IOInterface *
+                                                           io,
+                                                           size_t bufferSize,
+                                                           nrt_Error * error);
+
+/**
+ * Writes everything buffered by an nrt_WriteBehindAdapter and leaves the
+ * wrapped interface positioned where the adapter is.  Does nothing for
+ * other interfaces.
+ */
+NRTAPI(NRT_BOOL) nrt_WriteBehindAdapter_flush(nrt_IOInterface * io,
+                                              nrt_Error * error);
+
 /**
  * Creats an IOInterface that wraps a buffer
+ *
+ * If buf is NULL the adapter allocates its own buffer and grows it as it
+ * is written (size and ownBuf are then ignored).  It may be positioned
+ * anywhere, and a gap left by writing past the end reads as zeros.
  */
 NRTAPI(nrt_IOInterface *) nrt_BufferAdapter_construct(char *buf, size_t size,
                                                       NRT_BOOL ownBuf,
@@ -26,12 +26,14 @@
 #include "nrt/Defines.h"
 #include "nrt/Types.h"
 #include "nrt/Memory.h"
+#include "nrt/Error.h"
 
 NRT_CXX_GUARD
 #if defined(WIN32)
 typedef LPCRITICAL_SECTION nrt_Mutex;
 #elif defined(__sgi)
 #   include <sys/atomic_ops.h>
+#   include <pthread.h>
 #   define NRT_MUTEX_INIT 0
 typedef int nrt_Mutex;
 #else
@@ -45,5 +47,39 @@ NRTPROT(void) nrt_Mutex_unlock(nrt_Mutex * m);
 NRTPROT(void) nrt_Mutex_init(nrt_Mutex * m);
 NRTPROT(void) nrt_Mutex_delete(nrt_Mutex * m);
 
+/*!
+ *  Function run by a thread started with nrt_Thread_create
+ *
+ *  \param data  The argument given to nrt_Thread_create
+ */
+typedef void (*NRT_THREAD_RUN_FUNCTION) (void *data);
+
+#if defined(WIN32)
+typedef HANDLE nrt_Thread;
+#else
+typedef pthread_t nrt_Thread;
+#endif
+
+/*!
+ *  Start a thread that calls run(data).  Every thread that is created
+ *  must be joined with nrt_Thread_join.
+ *
+ *  \param thread The thread handle to set
+ *  \param run    The function to run
+ *  \param data   The argument passed to run
+ *  \param error  Populated on failure
+ *  \return NRT_SUCCESS if the thread was started, NRT_FAILURE otherwise
+ */
+NRTPROT(NRT_BOOL) nrt_Thread_create(nrt_Thread * thread,
+                                    NRT_THREAD_RUN_FUNCTION run, void *data,
+                                    nrt_Error * error);
+
+/*!
+ *  Wait for a thread to finish and release its resources
+ *
+ *  \param thread The thread to join
+ */
+NRTPROT(void) nrt_Thread_join(nrt_Thread * thread);
+
 NRT_CXX_ENDGUARD
 #endif
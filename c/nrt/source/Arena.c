@@ -0,0 +1,286 @@
+/* =========================================================================
+ * This file is part of NITRO
+ * =========================================================================
+ * 
+ * (C) Copyright 2004 - 2010, General Dynamics - Advanced Information Systems
+ *
+ * NITRO is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public 
+ * License along with this program; 
+ * If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "nrt/Arena.h"
+
+/*
+ *  Blocks carry no header, so memory from the heap path is plain
+ *  NRT_MALLOC memory.  Instead, every chunk is entered in a registry,
+ *  sorted by address, and nrt_Arena_free looks a block up there to find
+ *  its arena.  Anything not inside a registered chunk came from the heap.
+ */
+typedef struct _ArenaEntry
+{
+    char *start;                    /* The first byte handed out */
+    char *end;                      /* One past the last usable byte */
+    nrt_Arena *arena;
+} ArenaEntry;
+
+#define ARENA_ALIGN(N) (((N) + 7) & ~((size_t) 7))
+#define ARENA_CHUNK_HEADER ARENA_ALIGN(sizeof(nrt_ArenaChunk))
+
+/*
+ *  The owner takes this many counts from live at a time, so an
+ *  allocation only needs an atomic operation once per batch
+ */
+#define ARENA_CREDIT_BATCH 256
+
+#if defined(_MSC_VER)
+#   define NRT_ARENA_TLS __declspec(thread)
+#elif defined(__GNUC__)
+#   define NRT_ARENA_TLS __thread
+#endif
+
+#ifdef NRT_ARENA_TLS
+static NRT_ARENA_TLS nrt_Arena *arenaCurrent = NULL;
+#else
+static nrt_Arena *arenaCurrent = NULL;
+#endif
+
+static ArenaEntry *arenaRegistry = NULL;
+static size_t arenaRegistryCapacity = 0;
+static volatile long arenaRegistrySize = 0;
+
+#ifndef WIN32
+static nrt_Mutex arenaMutex = NRT_MUTEX_INIT;
+#define ARENA_MUTEX() &arenaMutex
+#else
+static nrt_Mutex arenaMutex = NULL;
+static long arenaMutexInit = 0;
+
+NRTPRIV(nrt_Mutex *) ARENA_MUTEX(void)
+{
+    if (arenaMutex == NULL)
+    {
+        while (InterlockedExchange(&arenaMutexInit, 1) == 1)
+            /* loop, another thread owns the lock */ ;
+        if (arenaMutex == NULL)
+            nrt_Mutex_init(&arenaMutex);
+        InterlockedExchange(&arenaMutexInit, 0);
+    }
+    return &arenaMutex;
+}
+#endif
+
+/*
+ *  Add delta to the value, atomically, and return the result
+ */
+NRTPRIV(long) Arena_add(volatile long *value, long delta)
+{
+#if defined(WIN32)
+    return InterlockedExchangeAdd(value, delta) + delta;
+#elif defined(__GNUC__)
+    return __sync_add_and_fetch(value, delta);
+#else
+    long result;
+    nrt_Mutex_lock(ARENA_MUTEX());
+    result = (*value += delta);
+    nrt_Mutex_unlock(ARENA_MUTEX());
+    return result;
+#endif
+}
+
+/*
+ *  The index of the first entry that starts above ptr.  The registry
+ *  mutex must be held.
+ */
+NRTPRIV(size_t) Arena_search(const char *ptr)
+{
+    size_t low = 0;
+    size_t high = (size_t) arenaRegistrySize;
+    while (low < high)
+    {
+        size_t middle = low + (high - low) / 2;
+        if (arenaRegistry[middle].start <= ptr)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low;
+}
+
+NRTPRIV(NRT_BOOL) Arena_register(nrt_Arena * arena, nrt_ArenaChunk * chunk)
+{
+    char *start = (char *) chunk + ARENA_CHUNK_HEADER;
+    size_t at;
+
+    nrt_Mutex_lock(ARENA_MUTEX());
+    if ((size_t) arenaRegistrySize == arenaRegistryCapacity)
+    {
+        size_t capacity =
+            arenaRegistryCapacity ? 2 * arenaRegistryCapacity : 64;
+        ArenaEntry *registry = (ArenaEntry *)
+            NRT_REALLOC(arenaRegistry, capacity * sizeof(ArenaEntry));
+        if (!registry)
+        {
+            nrt_Mutex_unlock(ARENA_MUTEX());
+            return NRT_FAILURE;
+        }
+        arenaRegistry = registry;
+        arenaRegistryCapacity = capacity;
+    }
+
+    at = Arena_search(start);
+    memmove(&arenaRegistry[at + 1], &arenaRegistry[at],
+            ((size_t) arenaRegistrySize - at) * sizeof(ArenaEntry));
+    arenaRegistry[at].start = start;
+    arenaRegistry[at].end = start + chunk->size;
+    arenaRegistry[at].arena = arena;
+    Arena_add(&arenaRegistrySize, 1);
+    nrt_Mutex_unlock(ARENA_MUTEX());
+    return NRT_SUCCESS;
+}
+
+NRTPRIV(void) Arena_destroy(nrt_Arena * arena)
+{
+    nrt_ArenaChunk *chunk = arena->chunks;
+
+    nrt_Mutex_lock(ARENA_MUTEX());
+    for (; chunk; chunk = chunk->next)
+    {
+        size_t at = Arena_search((char *) chunk + ARENA_CHUNK_HEADER) - 1;
+        memmove(&arenaRegistry[at], &arenaRegistry[at + 1],
+                ((size_t) arenaRegistrySize - at - 1) * sizeof(ArenaEntry));
+        Arena_add(&arenaRegistrySize, -1);
+    }
+    if (arenaRegistrySize == 0)
+    {
+        NRT_FREE(arenaRegistry);
+        arenaRegistry = NULL;
+        arenaRegistryCapacity = 0;
+    }
+    nrt_Mutex_unlock(ARENA_MUTEX());
+
+    chunk = arena->chunks;
+    while (chunk)
+    {
+        nrt_ArenaChunk *next = chunk->next;
+        NRT_FREE(chunk);
+        chunk = next;
+    }
+    NRT_FREE(arena);
+}
+
+NRTAPI(nrt_Arena *) nrt_Arena_construct(size_t chunkSize, nrt_Error * error)
+{
+    nrt_Arena *arena = (nrt_Arena *) NRT_MALLOC(sizeof(nrt_Arena));
+    if (!arena)
+    {
+        nrt_Error_init(error, NRT_STRERROR(NRT_ERRNO), NRT_CTXT,
+                       NRT_ERR_MEMORY);
+        return NULL;
+    }
+    arena->chunks = NULL;
+    arena->chunkSize =
+        ARENA_ALIGN(chunkSize ? chunkSize : NRT_ARENA_DEFAULT_CHUNK_SIZE);
+    arena->live = 1;
+    arena->pending = 0;
+    return arena;
+}
+
+NRTAPI(void) nrt_Arena_release(nrt_Arena ** arena)
+{
+    if (*arena)
+    {
+        if (arenaCurrent == *arena)
+            arenaCurrent = NULL;
+
+        /* Hand back the owner count and any unused credit */
+        if (Arena_add(&(*arena)->live, -(1 + (*arena)->pending)) == 0)
+            Arena_destroy(*arena);
+        *arena = NULL;
+    }
+}
+
+NRTAPI(nrt_Arena *) nrt_Arena_setCurrent(nrt_Arena * arena)
+{
+    nrt_Arena *previous = arenaCurrent;
+#ifdef NRT_ARENA_TLS
+    arenaCurrent = arena;
+#else
+    (void) arena;
+#endif
+    return previous;
+}
+
+NRTAPI(void *) nrt_Arena_malloc(size_t size)
+{
+    nrt_Arena *arena = arenaCurrent;
+    nrt_ArenaChunk *chunk;
+    void *block;
+    size_t need = ARENA_ALIGN(size ? size : 1);
+
+    if (!arena || need > arena->chunkSize / 4)
+        return NRT_MALLOC(size);
+
+    chunk = arena->chunks;
+    if (!chunk || chunk->size - chunk->used < need)
+    {
+        chunk = (nrt_ArenaChunk *)
+            NRT_MALLOC(ARENA_CHUNK_HEADER + arena->chunkSize);
+        if (!chunk)
+            return NULL;
+        chunk->size = arena->chunkSize;
+        chunk->used = 0;
+        if (!Arena_register(arena, chunk))
+        {
+            NRT_FREE(chunk);
+            return NULL;
+        }
+        chunk->next = arena->chunks;
+        arena->chunks = chunk;
+    }
+
+    if (arena->pending == 0)
+    {
+        Arena_add(&arena->live, ARENA_CREDIT_BATCH);
+        arena->pending = ARENA_CREDIT_BATCH;
+    }
+    arena->pending--;
+
+    block = (char *) chunk + ARENA_CHUNK_HEADER + chunk->used;
+    chunk->used += need;
+    return block;
+}
+
+NRTAPI(void) nrt_Arena_free(void *ptr)
+{
+    nrt_Arena *arena = NULL;
+    if (!ptr)
+        return;
+
+    /* With no chunks registered, every block came from the heap */
+    if (Arena_add(&arenaRegistrySize, 0) > 0)
+    {
+        size_t at;
+        nrt_Mutex_lock(ARENA_MUTEX());
+        at = Arena_search((char *) ptr);
+        if (at > 0 && (char *) ptr < arenaRegistry[at - 1].end)
+            arena = arenaRegistry[at - 1].arena;
+        nrt_Mutex_unlock(ARENA_MUTEX());
+    }
+
+    if (!arena)
+        NRT_FREE(ptr);
+    else if (Arena_add(&arena->live, -1) == 0)
+        Arena_destroy(arena);
+}
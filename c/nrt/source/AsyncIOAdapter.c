@@ -0,0 +1,728 @@
+/* =========================================================================
+ * This file is part of NITRO
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2010, General Dynamics - Advanced Information Systems
+ *
+ * NITRO is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "nrt/IOInterface.h"
+
+/*
+ *  io_uring is driven through the raw system calls so there is no library
+ *  to find at build time.  The kernel headers must know about it; whether
+ *  the running kernel (or a container's seccomp policy) allows it is only
+ *  found out when the ring is set up.
+ */
+#if defined(__linux__) && !defined(WIN32)
+#   include <linux/version.h>
+#   if LINUX_VERSION_CODE >= KERNEL_VERSION(5,1,0)
+#       include <sys/syscall.h>
+#       if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#           include <sys/mman.h>
+#           include <sys/uio.h>
+#           include <linux/io_uring.h>
+#           define NRT_HAVE_IO_URING 1
+#       endif
+#   endif
+#endif
+
+/* Most threads a batch is read with when there is no ring */
+#define NRT_ASYNC_IO_MAX_THREADS 16
+
+/* Most buffers in one submitted read, the kernel's IOV_MAX */
+#define NRT_ASYNC_IO_MAX_IOV 1024
+
+/* Queue depth used by nrt_AsyncIOAdapter_open */
+#define NRT_ASYNC_IO_DEFAULT_DEPTH 32
+
+#ifdef NRT_HAVE_IO_URING
+typedef struct _AsyncIORing
+{
+    int fd;                     /* The ring, -1 if there is none */
+    unsigned entries;           /* Submission queue size */
+    unsigned *sqHead;
+    unsigned *sqTail;
+    unsigned *sqMask;
+    unsigned *sqArray;
+    struct io_uring_sqe *sqes;
+    unsigned *cqHead;
+    unsigned *cqTail;
+    unsigned *cqMask;
+    struct io_uring_cqe *cqes;
+    void *sqMap;                /* Mappings, for munmap */
+    size_t sqMapSize;
+    void *cqMap;                /* NULL if shared with the submission queue */
+    size_t cqMapSize;
+    size_t sqesSize;
+} AsyncIORing;
+#endif
+
+typedef struct _AsyncIOControl
+{
+    nrt_IOHandle handle;
+    int mode;
+    int queueDepth;             /* Reads in flight, or threads */
+    nrt_Mutex lock;             /* One batch at a time */
+#ifdef NRT_HAVE_IO_URING
+    AsyncIORing ring;
+#endif
+} AsyncIOControl;
+
+/* Shared state of a batch read by the thread pool */
+typedef struct _AsyncIOPoolWork
+{
+    nrt_IOHandle handle;
+    nrt_IORequest *requests;
+    int count;
+    int next;                   /* Next request to read */
+    int failed;                 /* Stop taking requests */
+    NRT_IO_COMPLETION onComplete;
+    void *arg;
+    nrt_Error error;            /* Why the batch failed */
+    nrt_Mutex lock;
+} AsyncIOPoolWork;
+
+NRTPRIV(void) AsyncIOAdapter_poolWorker(void *data)
+{
+    AsyncIOPoolWork *work = (AsyncIOPoolWork *) data;
+    nrt_Error error;
+    nrt_IORequest *request;
+    NRT_BOOL ok;
+
+    for (;;)
+    {
+        nrt_Mutex_lock(&(work->lock));
+        if (work->failed || work->next >= work->count)
+        {
+            nrt_Mutex_unlock(&(work->lock));
+            return;
+        }
+        request = &(work->requests[work->next++]);
+        nrt_Mutex_unlock(&(work->lock));
+
+        ok = nrt_IOHandle_readvAt(work->handle, request->offset,
+                                  request->vec, request->count, &error);
+
+        /* The completions are serialized by the lock */
+        nrt_Mutex_lock(&(work->lock));
+        if (!work->failed)
+        {
+            if (!ok)
+            {
+                work->error = error;
+                work->failed = 1;
+            }
+            else if (work->onComplete != NULL
+                     && !work->onComplete(work->arg, request, &(work->error)))
+                work->failed = 1;
+        }
+        nrt_Mutex_unlock(&(work->lock));
+    }
+}
+
+NRTPRIV(NRT_BOOL) AsyncIOAdapter_poolBatch(AsyncIOControl * control,
+                                           nrt_IORequest * requests,
+                                           int count,
+                                           NRT_IO_COMPLETION onComplete,
+                                           void *arg, nrt_Error * error)
+{
+    AsyncIOPoolWork work;
+    nrt_Thread threads[NRT_ASYNC_IO_MAX_THREADS];
+    nrt_Error threadError;      /* Thread creation error, not reported */
+    int nThreads;
+    int nStarted;
+    int i;
+
+    work.handle = control->handle;
+    work.requests = requests;
+    work.count = count;
+    work.next = 0;
+    work.failed = 0;
+    work.onComplete = onComplete;
+    work.arg = arg;
+    nrt_Mutex_init(&(work.lock));
+
+    /* This thread is one of the readers */
+    nThreads = control->queueDepth;
+    if (nThreads > NRT_ASYNC_IO_MAX_THREADS)
+        nThreads = NRT_ASYNC_IO_MAX_THREADS;
+    if (nThreads > count)
+        nThreads = count;
+    nThreads -= 1;
+
+    /* If a thread cannot be started, make do with the ones that were */
+    nStarted = 0;
+    while (nStarted < nThreads
+           && nrt_Thread_create(&(threads[nStarted]),
+                                AsyncIOAdapter_poolWorker, &work,
+                                &threadError))
+        nStarted++;
+
+    AsyncIOAdapter_poolWorker(&work);
+
+    for (i = 0; i < nStarted; i++)
+        nrt_Thread_join(&(threads[i]));
+    nrt_Mutex_delete(&(work.lock));
+
+    if (work.failed)
+    {
+        *error = work.error;
+        return NRT_FAILURE;
+    }
+    return NRT_SUCCESS;
+}
+
+#ifdef NRT_HAVE_IO_URING
+
+NRTPRIV(NRT_BOOL) AsyncIORing_setup(AsyncIORing * ring, unsigned entries)
+{
+    struct io_uring_params params;
+    char *sq;
+    char *cq;
+
+    ring->fd = -1;
+    memset(&params, 0, sizeof(params));
+    ring->fd = (int) syscall(__NR_io_uring_setup, entries, &params);
+    if (ring->fd < 0)
+    {
+        ring->fd = -1;
+        return NRT_FAILURE;
+    }
+    ring->entries = params.sq_entries;
+
+    ring->sqMapSize = params.sq_off.array
+        + params.sq_entries * sizeof(unsigned);
+    ring->cqMapSize = params.cq_off.cqes
+        + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        if (ring->cqMapSize > ring->sqMapSize)
+            ring->sqMapSize = ring->cqMapSize;
+    }
+
+    ring->sqMap = mmap(NULL, ring->sqMapSize, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, ring->fd,
+                       IORING_OFF_SQ_RING);
+    if (ring->sqMap == MAP_FAILED)
+        goto CATCH_ERROR;
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+        ring->cqMap = NULL;
+    else
+    {
+        ring->cqMap = mmap(NULL, ring->cqMapSize, PROT_READ | PROT_WRITE,
+                           MAP_SHARED | MAP_POPULATE, ring->fd,
+                           IORING_OFF_CQ_RING);
+        if (ring->cqMap == MAP_FAILED)
+        {
+            munmap(ring->sqMap, ring->sqMapSize);
+            goto CATCH_ERROR;
+        }
+    }
+
+    ring->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = (struct io_uring_sqe *)
+        mmap(NULL, ring->sqesSize, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED)
+    {
+        if (ring->cqMap != NULL)
+            munmap(ring->cqMap, ring->cqMapSize);
+        munmap(ring->sqMap, ring->sqMapSize);
+        goto CATCH_ERROR;
+    }
+
+    sq = (char *) ring->sqMap;
+    cq = (ring->cqMap != NULL) ? (char *) ring->cqMap : sq;
+    ring->sqHead = (unsigned *) (sq + params.sq_off.head);
+    ring->sqTail = (unsigned *) (sq + params.sq_off.tail);
+    ring->sqMask = (unsigned *) (sq + params.sq_off.ring_mask);
+    ring->sqArray = (unsigned *) (sq + params.sq_off.array);
+    ring->cqHead = (unsigned *) (cq + params.cq_off.head);
+    ring->cqTail = (unsigned *) (cq + params.cq_off.tail);
+    ring->cqMask = (unsigned *) (cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *) (cq + params.cq_off.cqes);
+    return NRT_SUCCESS;
+
+    CATCH_ERROR:
+    close(ring->fd);
+    ring->fd = -1;
+    return NRT_FAILURE;
+}
+
+NRTPRIV(void) AsyncIORing_destroy(AsyncIORing * ring)
+{
+    if (ring->fd < 0)
+        return;
+    munmap(ring->sqes, ring->sqesSize);
+    if (ring->cqMap != NULL)
+        munmap(ring->cqMap, ring->cqMapSize);
+    munmap(ring->sqMap, ring->sqMapSize);
+    close(ring->fd);
+    ring->fd = -1;
+}
+
+/*
+ *  Queue a vectored read of (the start of) the part of request index that
+ *  is not done.
+ *  The caller knows there is a free entry: no more than ring->entries
+ *  reads are ever in flight.
+ */
+NRTPRIV(void) AsyncIORing_queue(AsyncIORing * ring, nrt_IOHandle handle,
+                                const nrt_IORequest * request, int index,
+                                size_t done, struct iovec *iov)
+{
+    struct io_uring_sqe *sqe;
+    unsigned tail;
+    unsigned slot;
+    size_t skip = done;         /* Bytes of the next buffer already read */
+    int n = 0;
+    int i;
+
+    /* Longer requests complete short and the rest is queued again */
+    for (i = 0; i < request->count && n < NRT_ASYNC_IO_MAX_IOV; i++)
+    {
+        if (skip >= request->vec[i].size)
+        {
+            skip -= request->vec[i].size;
+            continue;
+        }
+        iov[n].iov_base = request->vec[i].buf + skip;
+        iov[n].iov_len = request->vec[i].size - skip;
+        skip = 0;
+        n++;
+    }
+
+    tail = *(ring->sqTail);
+    slot = tail & *(ring->sqMask);
+    sqe = &(ring->sqes[slot]);
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_READV;
+    sqe->fd = handle;
+    sqe->off = (unsigned long long) request->offset + done;
+    sqe->addr = (unsigned long) iov;
+    sqe->len = (unsigned) n;
+    sqe->user_data = (unsigned long long) index;
+    ring->sqArray[slot] = slot;
+    __atomic_store_n(ring->sqTail, tail + 1, __ATOMIC_RELEASE);
+}
+
+NRTPRIV(NRT_BOOL) AsyncIORing_batch(AsyncIOControl * control,
+                                    nrt_IORequest * requests, int count,
+                                    NRT_IO_COMPLETION onComplete, void *arg,
+                                    nrt_Error * error)
+{
+    AsyncIORing *ring = &(control->ring);
+    size_t *done = NULL;        /* Bytes read so far, per request */
+    size_t *total = NULL;       /* Bytes wanted, per request */
+    int *iovBase = NULL;        /* First iovec of each request */
+    struct iovec *iov = NULL;   /* Kernel's view of the buffers */
+    int nIov = 0;
+    int next = 0;               /* Next request to queue */
+    unsigned inFlight = 0;      /* Reads queued and not completed */
+    unsigned toSubmit = 0;      /* Reads queued and not yet submitted */
+    int failed = 0;
+    int i;
+
+    done = (size_t *) NRT_MALLOC(count * sizeof(size_t));
+    total = (size_t *) NRT_MALLOC(count * sizeof(size_t));
+    iovBase = (int *) NRT_MALLOC(count * sizeof(int));
+    for (i = 0; i < count; i++)
+        nIov += requests[i].count;
+    iov = (struct iovec *) NRT_MALLOC((nIov ? nIov : 1)
+                                      * sizeof(struct iovec));
+    if (!done || !total || !iovBase || !iov)
+    {
+        nrt_Error_init(error, NRT_STRERROR(NRT_ERRNO), NRT_CTXT,
+                       NRT_ERR_MEMORY);
+        failed = 1;
+        goto CLEANUP;
+    }
+
+    nIov = 0;
+    for (i = 0; i < count; i++)
+    {
+        int j;
+        done[i] = 0;
+        total[i] = 0;
+        for (j = 0; j < requests[i].count; j++)
+            total[i] += requests[i].vec[j].size;
+        iovBase[i] = nIov;
+        nIov += requests[i].count;
+    }
+
+    for (;;)
+    {
+        unsigned head;
+        unsigned tail;
+        int ret;
+
+        /* Keep the ring full until a read fails */
+        while (!failed && next < count && inFlight < ring->entries)
+        {
+            if (total[next] == 0)
+            {
+                if (onComplete != NULL
+                    && !onComplete(arg, &(requests[next]), error))
+                    failed = 1;
+                next++;
+                continue;
+            }
+            AsyncIORing_queue(ring, control->handle, &(requests[next]),
+                              next, 0, &(iov[iovBase[next]]));
+            next++;
+            inFlight++;
+            toSubmit++;
+        }
+        if (inFlight == 0)
+            break;
+
+        ret = (int) syscall(__NR_io_uring_enter, ring->fd, toSubmit, 1,
+                            IORING_ENTER_GETEVENTS, NULL, 0);
+        if (ret < 0)
+        {
+            if (errno == EINTR || errno == EAGAIN || errno == EBUSY)
+                continue;
+
+            /*
+             *  Nothing can be reaped, so reads that might be in flight
+             *  cannot be waited for.  This does not happen with a working
+             *  ring; tearing it down cancels what is left, and later
+             *  batches use the thread pool.
+             */
+            nrt_Error_init(error, strerror(errno), NRT_CTXT,
+                           NRT_ERR_READING_FROM_FILE);
+            AsyncIORing_destroy(ring);
+            failed = 1;
+            break;
+        }
+        toSubmit -= ((unsigned) ret < toSubmit) ? (unsigned) ret : toSubmit;
+
+        head = *(ring->cqHead);
+        tail = __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE);
+        while (head != tail)
+        {
+            struct io_uring_cqe *cqe = &(ring->cqes[head & *(ring->cqMask)]);
+            int index = (int) cqe->user_data;
+            int res = cqe->res;
+
+            head++;
+            if (res == -EINTR || res == -EAGAIN)
+            {
+                AsyncIORing_queue(ring, control->handle, &(requests[index]),
+                                  index, done[index],
+                                  &(iov[iovBase[index]]));
+                toSubmit++;
+                continue;
+            }
+
+            if (res > 0)
+            {
+                done[index] += (size_t) res;
+                if (done[index] < total[index])
+                {
+                    /* Short read, queue the rest */
+                    AsyncIORing_queue(ring, control->handle,
+                                      &(requests[index]), index, done[index],
+                                      &(iov[iovBase[index]]));
+                    toSubmit++;
+                    continue;
+                }
+            }
+
+            inFlight--;
+            if (failed)
+                continue;
+            if (res < 0)
+            {
+                nrt_Error_init(error, strerror(-res), NRT_CTXT,
+                               NRT_ERR_READING_FROM_FILE);
+                failed = 1;
+            }
+            else if (res == 0)
+            {
+                nrt_Error_init(error, "Unexpected end of file", NRT_CTXT,
+                               NRT_ERR_READING_FROM_FILE);
+                failed = 1;
+            }
+            else if (onComplete != NULL
+                     && !onComplete(arg, &(requests[index]), error))
+                failed = 1;
+        }
+        __atomic_store_n(ring->cqHead, head, __ATOMIC_RELEASE);
+    }
+
+    CLEANUP:
+    if (done)
+        NRT_FREE(done);
+    if (total)
+        NRT_FREE(total);
+    if (iovBase)
+        NRT_FREE(iovBase);
+    if (iov)
+        NRT_FREE(iov);
+    return failed ? NRT_FAILURE : NRT_SUCCESS;
+}
+#endif
+
+NRTPRIV(NRT_BOOL) AsyncIOAdapter_read(NRT_DATA * data, char *buf, size_t size,
+                                      nrt_Error * error)
+{
+    AsyncIOControl *control = (AsyncIOControl *) data;
+    return nrt_IOHandle_read(control->handle, buf, size, error);
+}
+
+NRTPRIV(NRT_BOOL) AsyncIOAdapter_write(NRT_DATA * data, const char *buf,
+                                       size_t size, nrt_Error * error)
+{
+    AsyncIOControl *control = (AsyncIOControl *) data;
+    return nrt_IOHandle_write(control->handle, buf, size, error);
+}
+
+NRTPRIV(NRT_BOOL) AsyncIOAdapter_writeAt(NRT_DATA * data, nrt_Off offset,
+                                         const char *buf, size_t size,
+                                         nrt_Error * error)
+{
+    AsyncIOControl *control = (AsyncIOControl *) data;
+    return nrt_IOHandle_writeAt(control->handle, offset, buf, size, error);
+}
+
+NRTPRIV(NRT_BOOL) AsyncIOAdapter_canSeek(NRT_DATA * data, nrt_Error * error)
+{
+    /* Silence compiler warnings about unused variables */
+    (void)data;
+    (void)error;
+    return NRT_SUCCESS;
+}
+
+NRTPRIV(nrt_Off) AsyncIOAdapter_seek(NRT_DATA * data, nrt_Off offset,
+                                     int whence, nrt_Error * error)
+{
+    AsyncIOControl *control = (AsyncIOControl *) data;
+    return nrt_IOHandle_seek(control->handle, offset, whence, error);
+}
+
+NRTPRIV(nrt_Off) AsyncIOAdapter_tell(NRT_DATA * data, nrt_Error * error)
+{
+    AsyncIOControl *control = (AsyncIOControl *) data;
+    return nrt_IOHandle_tell(control->handle, error);
+}
+
+NRTPRIV(nrt_Off) AsyncIOAdapter_getSize(NRT_DATA * data, nrt_Error * error)
+{
+    AsyncIOControl *control = (AsyncIOControl *) data;
+    return nrt_IOHandle_getSize(control->handle, error);
+}
+
+NRTPRIV(int) AsyncIOAdapter_getMode(NRT_DATA * data, nrt_Error * error)
+{
+    AsyncIOControl *control = (AsyncIOControl *) data;
+
+    /* Silence compiler warnings about unused variables */
+    (void)error;
+
+    return control->mode;
+}
+
+NRTPRIV(NRT_BOOL) AsyncIOAdapter_close(NRT_DATA * data, nrt_Error * error)
+{
+    AsyncIOControl *control = (AsyncIOControl *) data;
+
+    /* Silence compiler warnings about unused variables */
+    (void)error;
+
+    if (control && control->handle && !NRT_INVALID_HANDLE(control->handle))
+    {
+        nrt_IOHandle_close(control->handle);
+
+        /* See IOHandleAdapter_close */
+        control->handle = NRT_INVALID_HANDLE_VALUE;
+    }
+    return NRT_SUCCESS;
+}
+
+NRTPRIV(void) AsyncIOAdapter_destruct(NRT_DATA * data)
+{
+    AsyncIOControl *control = (AsyncIOControl *) data;
+
+    if (control)
+    {
+#ifdef NRT_HAVE_IO_URING
+        AsyncIORing_destroy(&(control->ring));
+#endif
+        nrt_Mutex_delete(&(control->lock));
+    }
+}
+
+NRTPRIV(NRT_BOOL) AsyncIOAdapter_readAt(NRT_DATA * data, nrt_Off offset,
+                                        char *buf, size_t size,
+                                        nrt_Error * error)
+{
+    AsyncIOControl *control = (AsyncIOControl *) data;
+    return nrt_IOHandle_readAt(control->handle, offset, buf, size, error);
+}
+
+NRTPRIV(void) AsyncIOAdapter_adviseWillNeed(NRT_DATA * data, nrt_Off offset,
+                                            nrt_Off length)
+{
+    AsyncIOControl *control = (AsyncIOControl *) data;
+    nrt_IOHandle_adviseWillNeed(control->handle, offset, length);
+}
+
+NRTPRIV(NRT_BOOL) AsyncIOAdapter_readvAt(NRT_DATA * data, nrt_Off offset,
+                                         const nrt_IOVec * vec, int count,
+                                         nrt_Error * error)
+{
+    AsyncIOControl *control = (AsyncIOControl *) data;
+    return nrt_IOHandle_readvAt(control->handle, offset, vec, count, error);
+}
+
+NRTPRIV(NRT_BOOL) AsyncIOAdapter_readBatch(NRT_DATA * data,
+                                           nrt_IORequest * requests,
+                                           int count,
+                                           NRT_IO_COMPLETION onComplete,
+                                           void *arg, nrt_Error * error)
+{
+    AsyncIOControl *control = (AsyncIOControl *) data;
+    NRT_BOOL ret;
+
+    if (count <= 0)
+        return NRT_SUCCESS;
+
+    nrt_Mutex_lock(&(control->lock));
+#ifdef NRT_HAVE_IO_URING
+    if (control->ring.fd >= 0)
+        ret = AsyncIORing_batch(control, requests, count, onComplete, arg,
+                                error);
+    else
+#endif
+        ret = AsyncIOAdapter_poolBatch(control, requests, count, onComplete,
+                                       arg, error);
+    nrt_Mutex_unlock(&(control->lock));
+    return ret;
+}
+
+static nrt_IIOInterface iAsyncIO = {
+    &AsyncIOAdapter_read,
+    &AsyncIOAdapter_write,
+    &AsyncIOAdapter_canSeek,
+    &AsyncIOAdapter_seek,
+    &AsyncIOAdapter_tell,
+    &AsyncIOAdapter_getSize,
+    &AsyncIOAdapter_getMode,
+    &AsyncIOAdapter_close,
+    &AsyncIOAdapter_destruct,
+    &AsyncIOAdapter_readAt,
+    NULL,
+    &AsyncIOAdapter_adviseWillNeed,
+    &AsyncIOAdapter_readvAt,
+    &AsyncIOAdapter_readBatch,
+    &AsyncIOAdapter_writeAt
+};
+
+NRTAPI(nrt_IOInterface *) nrt_AsyncIOAdapter_construct(nrt_IOHandle handle,
+                                                       int accessMode,
+                                                       int queueDepth,
+                                                       NRT_BOOL useRing,
+                                                       nrt_Error * error)
+{
+    nrt_IOInterface *impl = NULL;
+    AsyncIOControl *control = NULL;
+
+    if (queueDepth < 1)
+    {
+        nrt_Error_initf(error, NRT_CTXT, NRT_ERR_INVALID_PARAMETER,
+                        "Invalid queue depth %d", queueDepth);
+        return NULL;
+    }
+
+    impl = (nrt_IOInterface *) NRT_MALLOC(sizeof(nrt_IOInterface));
+    if (!impl)
+    {
+        nrt_Error_init(error, NRT_STRERROR(NRT_ERRNO), NRT_CTXT,
+                       NRT_ERR_MEMORY);
+        goto CATCH_ERROR;
+    }
+    memset(impl, 0, sizeof(nrt_IOInterface));
+
+    control = (AsyncIOControl *) NRT_MALLOC(sizeof(AsyncIOControl));
+    if (!control)
+    {
+        nrt_Error_init(error, NRT_STRERROR(NRT_ERRNO), NRT_CTXT,
+                       NRT_ERR_MEMORY);
+        goto CATCH_ERROR;
+    }
+    memset(control, 0, sizeof(AsyncIOControl));
+    control->handle = handle;
+    control->mode = accessMode;
+    control->queueDepth = queueDepth;
+    nrt_Mutex_init(&(control->lock));
+
+#ifdef NRT_HAVE_IO_URING
+    control->ring.fd = -1;
+    /* No ring is not an error, the thread pool is used instead */
+    if (useRing)
+        (void) AsyncIORing_setup(&(control->ring), (unsigned) queueDepth);
+#else
+    (void)useRing;
+#endif
+
+    impl->data = (NRT_DATA *) control;
+    impl->iface = &iAsyncIO;
+    return impl;
+
+    CATCH_ERROR:
+    {
+        if (impl)
+            nrt_IOInterface_destruct(&impl);
+        return NULL;
+    }
+}
+
+NRTAPI(nrt_IOInterface *) nrt_AsyncIOAdapter_open(const char *fname,
+                                                  int queueDepth,
+                                                  nrt_Error * error)
+{
+    nrt_IOInterface *impl;
+    nrt_IOHandle handle;
+
+    if (queueDepth < 1)
+        queueDepth = NRT_ASYNC_IO_DEFAULT_DEPTH;
+
+    handle = nrt_IOHandle_create(fname, NRT_ACCESS_READONLY,
+                                 NRT_OPEN_EXISTING, error);
+    if (NRT_INVALID_HANDLE(handle))
+        return NULL;
+
+    impl = nrt_AsyncIOAdapter_construct(handle, NRT_ACCESS_READONLY,
+                                        queueDepth, NRT_SUCCESS, error);
+    if (!impl)
+        nrt_IOHandle_close(handle);
+    return impl;
+}
+
+NRTAPI(NRT_BOOL) nrt_AsyncIOAdapter_usesRing(nrt_IOInterface * io)
+{
+    if (io == NULL || io->iface != &iAsyncIO)
+        return NRT_FAILURE;
+#ifdef NRT_HAVE_IO_URING
+    return ((AsyncIOControl *) io->data)->ring.fd >= 0;
+#else
+    return NRT_FAILURE;
+#endif
+}
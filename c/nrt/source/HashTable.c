@@ -21,6 +21,7 @@
  */
 
 #include "nrt/HashTable.h"
+#include "nrt/Arena.h"
 
 NRTAPI(nrt_HashTable *) nrt_HashTable_construct(int nbuckets, nrt_Error * error)
 {
@@ -28,7 +29,7 @@ NRTAPI(nrt_HashTable *) nrt_HashTable_construct(int nbuckets, nrt_Error * error)
     int hashSize;
 
     /* Create the hash table object itself */
-    nrt_HashTable *ht = (nrt_HashTable *) NRT_MALLOC(sizeof(nrt_HashTable));
+    nrt_HashTable *ht = (nrt_HashTable *) nrt_Arena_malloc(sizeof(nrt_HashTable));
     if (!ht)
     {
         /* If we had problems, error population and return */
@@ -47,7 +48,7 @@ NRTAPI(nrt_HashTable *) nrt_HashTable_construct(int nbuckets, nrt_Error * error)
     ht->nbuckets = nbuckets;
 
     /* Allocate the list of lists (still need to allocate each list */
-    ht->buckets = (nrt_List **) NRT_MALLOC(hashSize);
+    ht->buckets = (nrt_List **) nrt_Arena_malloc(hashSize);
     if (!ht->buckets)
     {
         /* If we had problems, error population, and */
@@ -55,7 +56,7 @@ NRTAPI(nrt_HashTable *) nrt_HashTable_construct(int nbuckets, nrt_Error * error)
         nrt_Error_init(error, NRT_STRERROR(NRT_ERRNO), NRT_CTXT,
                        NRT_ERR_MEMORY);
         /* Dont bother with the destructor */
-        NRT_FREE(ht);
+        nrt_Arena_free(ht);
         return NULL;
     }
     /* Make sure if we have to call the destructor we are good */
@@ -151,7 +152,7 @@ NRTAPI(void) nrt_HashTable_destruct(nrt_HashTable ** ht)
                             if (key)
                             {
                                 /* Free and NULL it */
-                                NRT_FREE(key);
+                                nrt_Arena_free(key);
                             }
                             /* If the adoption policy is to adopt...  */
                             if ((*ht)->adopt)
@@ -167,7 +168,7 @@ NRTAPI(void) nrt_HashTable_destruct(nrt_HashTable ** ht)
                             }
                             /* Finally, we know that we allocated the */
                             /* pair, so lets free it */
-                            NRT_FREE(pair);
+                            nrt_Arena_free(pair);
                         }
                     }
                     /* Now the list is empty, let's destroy it */
@@ -175,10 +176,10 @@ NRTAPI(void) nrt_HashTable_destruct(nrt_HashTable ** ht)
                 }
                 /* Now go on to the next bucket */
             }
-            NRT_FREE((*ht)->buckets);
+            nrt_Arena_free((*ht)->buckets);
         }
 
-        NRT_FREE(*ht);
+        nrt_Arena_free(*ht);
         *ht = NULL;
     }
 }
@@ -223,10 +224,10 @@ NRTAPI(NRT_DATA *) nrt_HashTable_remove(nrt_HashTable * ht, const char *key)
             nrt_List_remove(l, &iter);
 
             /* Delete the key -- that's ours */
-            NRT_FREE(pair->key);
+            nrt_Arena_free(pair->key);
 
             /* Free the pair */
-            NRT_FREE(pair);
+            nrt_Arena_free(pair);
 
             /* Return the value -- that's yours */
             return data;
@@ -350,7 +351,7 @@ NRTAPI(NRT_BOOL) nrt_HashTable_insert(nrt_HashTable * ht, const char *key,
     int bucket = ht->hash(ht, key);
 
     /* Malloc the pair -- that's our container item */
-    nrt_Pair *p = (nrt_Pair *) NRT_MALLOC(sizeof(nrt_Pair));
+    nrt_Pair *p = (nrt_Pair *) nrt_Arena_malloc(sizeof(nrt_Pair));
     if (!p)
     {
         /* There was a memory allocation error */
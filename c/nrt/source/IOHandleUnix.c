@@ -22,8 +22,17 @@
 
 #ifndef WIN32
 
+#include <sys/mman.h>
 #include "nrt/IOHandle.h"
 
+#if defined(__linux__) || defined(__FreeBSD__) || defined(__NetBSD__) \
+    || defined(__OpenBSD__)
+#   include <sys/uio.h>
+#   define NRT_HAVE_PREADV 1
+/* Buffers handed to one preadv call, well under any IOV_MAX */
+#   define NRT_IOVEC_BATCH 64
+#endif
+
 NRTAPI(nrt_IOHandle) nrt_IOHandle_create(const char *fname,
                                          nrt_AccessFlags access,
                                          nrt_CreationFlags creation,
@@ -102,6 +111,156 @@ NRTAPI(NRT_BOOL) nrt_IOHandle_read(nrt_IOHandle handle, char *buf, size_t size,
     return NRT_FAILURE;
 }
 
+NRTAPI(NRT_BOOL) nrt_IOHandle_readAt(nrt_IOHandle handle, nrt_Off offset,
+                                     char *buf, size_t size,
+                                     nrt_Error * error)
+{
+    ssize_t bytesRead = 0;      /* Number of bytes read during last read
+                                 * operation */
+    size_t totalBytesRead = 0;  /* Total bytes read thus far */
+    int i;                      /* iterator */
+
+    /* make sure the user actually wants data */
+    if (size <= 0)
+        return NRT_SUCCESS;
+
+    /* Interrogate the IO handle */
+    for (i = 1; i <= NRT_MAX_READ_ATTEMPTS; i++)
+    {
+        /* Make the next read */
+        bytesRead = pread(handle, buf + totalBytesRead, size - totalBytesRead,
+                          offset + (nrt_Off) totalBytesRead);
+
+        switch (bytesRead)
+        {
+        case -1:               /* Some type of error occured */
+            switch (errno)
+            {
+            case EINTR:
+            case EAGAIN:       /* A non-fatal error occured, keep trying */
+                break;
+
+            default:           /* We failed */
+                goto CATCH_ERROR;
+            }
+            break;
+
+        case 0:                /* EOF (unexpected) */
+            nrt_Error_init(error, "Unexpected end of file", NRT_CTXT,
+                           NRT_ERR_READING_FROM_FILE);
+            return NRT_FAILURE;
+
+        default:               /* We made progress */
+            totalBytesRead += (size_t) bytesRead;
+
+        }                       /* End of switch */
+
+        /* Check for success */
+        if (totalBytesRead == size)
+        {
+            return NRT_SUCCESS;
+        }
+
+    }                           /* End of for */
+
+    /* An error occured */
+    CATCH_ERROR:
+
+    nrt_Error_init(error, strerror(errno), NRT_CTXT, NRT_ERR_READING_FROM_FILE);
+    return NRT_FAILURE;
+}
+
+NRTAPI(NRT_BOOL) nrt_IOHandle_readvAt(nrt_IOHandle handle, nrt_Off offset,
+                                      const nrt_IOVec * vec, int count,
+                                      nrt_Error * error)
+{
+#ifdef NRT_HAVE_PREADV
+    struct iovec iov[NRT_IOVEC_BATCH]; /* Buffers for the next call */
+    int current = 0;            /* First buffer not yet filled */
+    size_t done = 0;            /* Bytes already in vec[current] */
+    int attempts = 0;           /* Calls in a row that made no progress */
+    int n;                      /* Buffers in this call */
+    ssize_t bytesRead;          /* Result of the last call */
+
+    while (current < count)
+    {
+        /* Skip empty buffers so a zero return really means end of file */
+        if (vec[current].size == done)
+        {
+            current++;
+            done = 0;
+            continue;
+        }
+
+        iov[0].iov_base = vec[current].buf + done;
+        iov[0].iov_len = vec[current].size - done;
+        for (n = 1; n < NRT_IOVEC_BATCH && current + n < count; n++)
+        {
+            iov[n].iov_base = vec[current + n].buf;
+            iov[n].iov_len = vec[current + n].size;
+        }
+
+        bytesRead = preadv(handle, iov, n, offset);
+        if (bytesRead < 0)
+        {
+            if ((errno == EINTR || errno == EAGAIN)
+                && ++attempts < NRT_MAX_READ_ATTEMPTS)
+                continue;
+            nrt_Error_init(error, strerror(errno), NRT_CTXT,
+                           NRT_ERR_READING_FROM_FILE);
+            return NRT_FAILURE;
+        }
+        if (bytesRead == 0)
+        {
+            nrt_Error_init(error, "Unexpected end of file", NRT_CTXT,
+                           NRT_ERR_READING_FROM_FILE);
+            return NRT_FAILURE;
+        }
+        attempts = 0;
+        offset += (nrt_Off) bytesRead;
+
+        /* Advance past what was filled, possibly stopping part way */
+        while (bytesRead > 0)
+        {
+            size_t left = vec[current].size - done;
+            if ((size_t) bytesRead < left)
+            {
+                done += (size_t) bytesRead;
+                break;
+            }
+            bytesRead -= (ssize_t) left;
+            current++;
+            done = 0;
+        }
+    }
+    return NRT_SUCCESS;
+#else
+    int i;
+
+    for (i = 0; i < count; i++)
+    {
+        if (!nrt_IOHandle_readAt(handle, offset, vec[i].buf, vec[i].size,
+                                 error))
+            return NRT_FAILURE;
+        offset += (nrt_Off) vec[i].size;
+    }
+    return NRT_SUCCESS;
+#endif
+}
+
+NRTAPI(void) nrt_IOHandle_adviseWillNeed(nrt_IOHandle handle, nrt_Off offset,
+                                         nrt_Off length)
+{
+#ifdef POSIX_FADV_WILLNEED
+    (void) posix_fadvise(handle, offset, length, POSIX_FADV_WILLNEED);
+#else
+    /* Silence compiler warnings about unused variables */
+    (void) handle;
+    (void) offset;
+    (void) length;
+#endif
+}
+
 NRTAPI(NRT_BOOL) nrt_IOHandle_write(nrt_IOHandle handle, const char *buf,
                                     size_t size, nrt_Error * error)
 {
@@ -124,6 +283,32 @@ NRTAPI(NRT_BOOL) nrt_IOHandle_write(nrt_IOHandle handle, const char *buf,
     return NRT_SUCCESS;
 }
 
+NRTAPI(NRT_BOOL) nrt_IOHandle_writeAt(nrt_IOHandle handle, nrt_Off offset,
+                                      const char *buf, size_t size,
+                                      nrt_Error * error)
+{
+    size_t bytesWritten = 0;    /* Total bytes written thus far */
+    ssize_t bytesThisWrite;     /* Bytes written by the last call */
+
+    while (bytesWritten < size)
+    {
+        bytesThisWrite = pwrite(handle, buf + bytesWritten,
+                                size - bytesWritten,
+                                offset + (nrt_Off) bytesWritten);
+        if (bytesThisWrite == -1)
+        {
+            if (errno == EINTR)
+                continue;
+            nrt_Error_init(error, strerror(errno), NRT_CTXT,
+                           NRT_ERR_WRITING_TO_FILE);
+            return NRT_FAILURE;
+        }
+        bytesWritten += (size_t) bytesThisWrite;
+    }
+
+    return NRT_SUCCESS;
+}
+
 NRTAPI(nrt_Off) nrt_IOHandle_seek(nrt_IOHandle handle, nrt_Off offset,
                                   int whence, nrt_Error * error)
 {
@@ -153,6 +338,33 @@ NRTAPI(nrt_Off) nrt_IOHandle_getSize(nrt_IOHandle handle, nrt_Error * error)
     return buf.st_size;
 }
 
+NRTAPI(const char *) nrt_IOHandle_map(nrt_IOHandle handle, nrt_Off size,
+                                      nrt_Error * error)
+{
+    void *map;
+
+    if ((size <= 0) || ((nrt_Uint64) size > (nrt_Uint64) ((size_t) -1)))
+    {
+        nrt_Error_initf(error, NRT_CTXT, NRT_ERR_INVALID_PARAMETER,
+                        "Cannot map %lld bytes", (long long) size);
+        return NULL;
+    }
+
+    map = mmap(NULL, (size_t) size, PROT_READ, MAP_SHARED, handle, 0);
+    if (map == MAP_FAILED)
+    {
+        nrt_Error_init(error, strerror(errno), NRT_CTXT,
+                       NRT_ERR_READING_FROM_FILE);
+        return NULL;
+    }
+    return (const char *) map;
+}
+
+NRTAPI(void) nrt_IOHandle_unmap(const char *map, nrt_Off size)
+{
+    munmap((void *) map, (size_t) size);
+}
+
 NRTAPI(void) nrt_IOHandle_close(nrt_IOHandle handle)
 {
     close(handle);
@@ -96,6 +96,80 @@ NRTAPI(NRT_BOOL) nrt_IOHandle_read(nrt_IOHandle handle, char *buf, size_t size,
     return NRT_SUCCESS;
 }
 
+NRTAPI(NRT_BOOL) nrt_IOHandle_readAt(nrt_IOHandle handle, nrt_Off offset,
+                                     char *buf, size_t size,
+                                     nrt_Error * error)
+{
+    static const DWORD MAX_READ_SIZE = (DWORD)-1;
+    size_t bytesRead = 0;
+    size_t bytesRemaining = size;
+
+    while (bytesRead < size)
+    {
+        /* Determine how many bytes to read */
+        const DWORD bytesToRead = (bytesRemaining > MAX_READ_SIZE) ?
+            MAX_READ_SIZE : (DWORD)bytesRemaining;
+
+        /* The offset is passed with the request, not the file pointer */
+        DWORD bytesThisRead = 0;
+        OVERLAPPED overlapped;
+        LARGE_INTEGER position;
+
+        position.QuadPart = offset + (nrt_Off)bytesRead;
+        memset(&overlapped, 0, sizeof(OVERLAPPED));
+        overlapped.Offset = position.LowPart;
+        overlapped.OffsetHigh = (DWORD)position.HighPart;
+
+        if (!ReadFile(handle,
+                      buf + bytesRead,
+                      bytesToRead,
+                      &bytesThisRead,
+                      &overlapped))
+        {
+            nrt_Error_init(error, NRT_STRERROR(NRT_ERRNO), NRT_CTXT,
+                           NRT_ERR_READING_FROM_FILE);
+            return NRT_FAILURE;
+        }
+        else if (bytesThisRead == 0)
+        {
+            nrt_Error_init(error, "Unexpected end of file", NRT_CTXT,
+                           NRT_ERR_READING_FROM_FILE);
+            return NRT_FAILURE;
+        }
+
+        bytesRead += bytesThisRead;
+        bytesRemaining -= bytesThisRead;
+    }
+
+    return NRT_SUCCESS;
+}
+
+NRTAPI(NRT_BOOL) nrt_IOHandle_readvAt(nrt_IOHandle handle, nrt_Off offset,
+                                      const nrt_IOVec * vec, int count,
+                                      nrt_Error * error)
+{
+    /* ReadFileScatter wants page sized, unbuffered buffers; read in turn */
+    int i;
+
+    for (i = 0; i < count; i++)
+    {
+        if (!nrt_IOHandle_readAt(handle, offset, vec[i].buf, vec[i].size,
+                                 error))
+            return NRT_FAILURE;
+        offset += (nrt_Off) vec[i].size;
+    }
+    return NRT_SUCCESS;
+}
+
+NRTAPI(void) nrt_IOHandle_adviseWillNeed(nrt_IOHandle handle, nrt_Off offset,
+                                         nrt_Off length)
+{
+    /* Windows has no per-range hint, its cache manager reads ahead itself */
+    (void)handle;
+    (void)offset;
+    (void)length;
+}
+
 NRTAPI(NRT_BOOL) nrt_IOHandle_write(nrt_IOHandle handle, const char *buf,
                                     size_t size, nrt_Error * error)
 {
@@ -133,6 +207,48 @@ NRTAPI(NRT_BOOL) nrt_IOHandle_write(nrt_IOHandle handle, const char *buf,
     return NRT_SUCCESS;
 }
 
+NRTAPI(NRT_BOOL) nrt_IOHandle_writeAt(nrt_IOHandle handle, nrt_Off offset,
+                                      const char *buf, size_t size,
+                                      nrt_Error * error)
+{
+    static const DWORD MAX_WRITE_SIZE = (DWORD)-1;
+    size_t bytesRemaining = size;
+    size_t bytesWritten = 0;
+
+    while (bytesWritten < size)
+    {
+        /* Determine how many bytes to write */
+        const DWORD bytesToWrite = (bytesRemaining > MAX_WRITE_SIZE) ?
+            MAX_WRITE_SIZE : (DWORD)bytesRemaining;
+
+        /* The offset is passed with the request, not the file pointer */
+        DWORD bytesThisWrite = 0;
+        OVERLAPPED overlapped;
+        LARGE_INTEGER position;
+
+        position.QuadPart = offset + (nrt_Off)bytesWritten;
+        memset(&overlapped, 0, sizeof(OVERLAPPED));
+        overlapped.Offset = position.LowPart;
+        overlapped.OffsetHigh = (DWORD)position.HighPart;
+
+        if (!WriteFile(handle,
+                       buf + bytesWritten,
+                       bytesToWrite,
+                       &bytesThisWrite,
+                       &overlapped))
+        {
+            nrt_Error_init(error, NRT_STRERROR(NRT_ERRNO), NRT_CTXT,
+                           NRT_ERR_WRITING_TO_FILE);
+            return NRT_FAILURE;
+        }
+
+        bytesRemaining -= bytesThisWrite;
+        bytesWritten += bytesThisWrite;
+    }
+
+    return NRT_SUCCESS;
+}
+
 NRTAPI(nrt_Off) nrt_IOHandle_seek(nrt_IOHandle handle, nrt_Off offset,
                                   int whence, nrt_Error * error)
 {
@@ -175,6 +291,53 @@ NRTAPI(nrt_Off) nrt_IOHandle_getSize(nrt_IOHandle handle, nrt_Error * error)
     return (nrt_Off)((off << 32) + ret);
 }
 
+NRTAPI(const char *) nrt_IOHandle_map(nrt_IOHandle handle, nrt_Off size,
+                                      nrt_Error * error)
+{
+    HANDLE mapping;
+    LPVOID view;
+    LARGE_INTEGER length;
+
+    if ((size <= 0) || ((nrt_Uint64) size > (nrt_Uint64) ((SIZE_T) -1)))
+    {
+        nrt_Error_initf(error, NRT_CTXT, NRT_ERR_INVALID_PARAMETER,
+                        "Cannot map %I64d bytes", (__int64) size);
+        return NULL;
+    }
+
+    length.QuadPart = size;
+    mapping = CreateFileMapping(handle, NULL, PAGE_READONLY,
+                                (DWORD) length.HighPart, length.LowPart,
+                                NULL);
+    if (mapping == NULL)
+    {
+        nrt_Error_initf(error, NRT_CTXT, NRT_ERR_READING_FROM_FILE,
+                        "CreateFileMapping failed with error [%d]",
+                        GetLastError());
+        return NULL;
+    }
+
+    /* The view keeps the mapping object alive */
+    view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, (SIZE_T) size);
+    CloseHandle(mapping);
+    if (view == NULL)
+    {
+        nrt_Error_initf(error, NRT_CTXT, NRT_ERR_READING_FROM_FILE,
+                        "MapViewOfFile failed with error [%d]",
+                        GetLastError());
+        return NULL;
+    }
+    return (const char *) view;
+}
+
+NRTAPI(void) nrt_IOHandle_unmap(const char *map, nrt_Off size)
+{
+    /* Silence compiler warnings about unused variables */
+    (void)size;
+
+    UnmapViewOfFile((LPCVOID) map);
+}
+
 NRTAPI(void) nrt_IOHandle_close(nrt_IOHandle handle)
 {
     CloseHandle(handle);
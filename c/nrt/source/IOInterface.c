@@ -13,20 +13,125 @@ typedef struct _BufferIOControl
     size_t mark;
     size_t bytesWritten;
     NRT_BOOL ownBuf;
+    NRT_BOOL growable;          /* The buffer is reallocated as needed */
 } BufferIOControl;
 
+typedef struct _MMapControl
+{
+    nrt_IOHandle handle;
+    const char *map;
+    nrt_Off size;
+    nrt_Off mark;
+} MMapControl;
+
 NRTAPI(NRT_BOOL) nrt_IOInterface_read(nrt_IOInterface * io, char *buf,
                                       size_t size, nrt_Error * error)
 {
     return io->iface->read(io->data, buf, size, error);
 }
 
+NRTAPI(NRT_BOOL) nrt_IOInterface_readAt(nrt_IOInterface * io, nrt_Off offset,
+                                        char *buf, size_t size,
+                                        nrt_Error * error)
+{
+    if (io->iface->readAt != NULL)
+        return io->iface->readAt(io->data, offset, buf, size, error);
+
+    if (!NRT_IO_SUCCESS(nrt_IOInterface_seek(io, offset, NRT_SEEK_SET, error)))
+        return NRT_FAILURE;
+    return nrt_IOInterface_read(io, buf, size, error);
+}
+
+NRTAPI(NRT_BOOL) nrt_IOInterface_readvAt(nrt_IOInterface * io, nrt_Off offset,
+                                         const nrt_IOVec * vec, int count,
+                                         nrt_Error * error)
+{
+    int i;
+
+    if (io->iface->readvAt != NULL)
+        return io->iface->readvAt(io->data, offset, vec, count, error);
+
+    for (i = 0; i < count; i++)
+    {
+        if (!nrt_IOInterface_readAt(io, offset, vec[i].buf, vec[i].size,
+                                    error))
+            return NRT_FAILURE;
+        offset += (nrt_Off) vec[i].size;
+    }
+    return NRT_SUCCESS;
+}
+
+NRTAPI(NRT_BOOL) nrt_IOInterface_readBatch(nrt_IOInterface * io,
+                                           nrt_IORequest * requests,
+                                           int count,
+                                           NRT_IO_COMPLETION onComplete,
+                                           void *arg, nrt_Error * error)
+{
+    int i;
+
+    if (io->iface->readBatch != NULL)
+        return io->iface->readBatch(io->data, requests, count, onComplete,
+                                    arg, error);
+
+    for (i = 0; i < count; i++)
+    {
+        if (!nrt_IOInterface_readvAt(io, requests[i].offset, requests[i].vec,
+                                     requests[i].count, error))
+            return NRT_FAILURE;
+        if (onComplete != NULL && !onComplete(arg, &(requests[i]), error))
+            return NRT_FAILURE;
+    }
+    return NRT_SUCCESS;
+}
+
+NRTAPI(NRT_BOOL) nrt_IOInterface_canReadBatch(nrt_IOInterface * io)
+{
+    return io->iface->readBatch != NULL;
+}
+
+NRTAPI(NRT_BOOL) nrt_IOInterface_canReadAt(nrt_IOInterface * io)
+{
+    return io->iface->readAt != NULL;
+}
+
+NRTAPI(const char *) nrt_IOInterface_getMapping(nrt_IOInterface * io,
+                                                nrt_Off * size)
+{
+    if (io->iface->getMapping == NULL)
+        return NULL;
+    return io->iface->getMapping(io->data, size);
+}
+
+NRTAPI(void) nrt_IOInterface_adviseWillNeed(nrt_IOInterface * io,
+                                            nrt_Off offset, nrt_Off length)
+{
+    if (io->iface->adviseWillNeed != NULL)
+        io->iface->adviseWillNeed(io->data, offset, length);
+}
+
 NRTAPI(NRT_BOOL) nrt_IOInterface_write(nrt_IOInterface * io, const char *buf,
                                        size_t size, nrt_Error * error)
 {
     return io->iface->write(io->data, buf, size, error);
 }
 
+NRTAPI(NRT_BOOL) nrt_IOInterface_writeAt(nrt_IOInterface * io, nrt_Off offset,
+                                         const char *buf, size_t size,
+                                         nrt_Error * error)
+{
+    if (io->iface->writeAt != NULL)
+        return io->iface->writeAt(io->data, offset, buf, size, error);
+
+    if (!NRT_IO_SUCCESS(nrt_IOInterface_seek(io, offset, NRT_SEEK_SET, error)))
+        return NRT_FAILURE;
+    return nrt_IOInterface_write(io, buf, size, error);
+}
+
+NRTAPI(NRT_BOOL) nrt_IOInterface_canWriteAt(nrt_IOInterface * io)
+{
+    return io->iface->writeAt != NULL;
+}
+
 NRTAPI(NRT_BOOL) nrt_IOInterface_canSeek(nrt_IOInterface * io,
                                          nrt_Error * error)
 {
@@ -92,6 +197,29 @@ NRTPRIV(NRT_BOOL) IOHandleAdapter_read(NRT_DATA * data, char *buf, size_t size,
     return nrt_IOHandle_read(control->handle, buf, size, error);
 }
 
+NRTPRIV(NRT_BOOL) IOHandleAdapter_readAt(NRT_DATA * data, nrt_Off offset,
+                                         char *buf, size_t size,
+                                         nrt_Error * error)
+{
+    IOHandleControl *control = (IOHandleControl *) data;
+    return nrt_IOHandle_readAt(control->handle, offset, buf, size, error);
+}
+
+NRTPRIV(NRT_BOOL) IOHandleAdapter_readvAt(NRT_DATA * data, nrt_Off offset,
+                                          const nrt_IOVec * vec, int count,
+                                          nrt_Error * error)
+{
+    IOHandleControl *control = (IOHandleControl *) data;
+    return nrt_IOHandle_readvAt(control->handle, offset, vec, count, error);
+}
+
+NRTPRIV(void) IOHandleAdapter_adviseWillNeed(NRT_DATA * data, nrt_Off offset,
+                                             nrt_Off length)
+{
+    IOHandleControl *control = (IOHandleControl *) data;
+    nrt_IOHandle_adviseWillNeed(control->handle, offset, length);
+}
+
 NRTPRIV(NRT_BOOL) IOHandleAdapter_write(NRT_DATA * data, const char *buf,
                                         size_t size, nrt_Error * error)
 {
@@ -99,6 +227,14 @@ NRTPRIV(NRT_BOOL) IOHandleAdapter_write(NRT_DATA * data, const char *buf,
     return nrt_IOHandle_write(control->handle, buf, size, error);
 }
 
+NRTPRIV(NRT_BOOL) IOHandleAdapter_writeAt(NRT_DATA * data, nrt_Off offset,
+                                          const char *buf, size_t size,
+                                          nrt_Error * error)
+{
+    IOHandleControl *control = (IOHandleControl *) data;
+    return nrt_IOHandle_writeAt(control->handle, offset, buf, size, error);
+}
+
 NRTPRIV(NRT_BOOL) IOHandleAdapter_canSeek(NRT_DATA * data, nrt_Error * error)
 {
     /* Silence compiler warnings about unused variables */
@@ -167,8 +303,9 @@ NRTPRIV(NRT_BOOL) BufferAdapter_read(NRT_DATA * data, char *buf, size_t size,
                                      nrt_Error * error)
 {
     BufferIOControl *control = (BufferIOControl *) data;
+    size_t end = control->growable ? control->bytesWritten : control->size;
 
-    if (size > control->size - control->mark)
+    if (control->mark > end || size > end - control->mark)
     {
         nrt_Error_init(error, "Invalid size requested - EOF", NRT_CTXT,
                        NRT_ERR_MEMORY);
@@ -183,12 +320,78 @@ NRTPRIV(NRT_BOOL) BufferAdapter_read(NRT_DATA * data, char *buf, size_t size,
     return NRT_SUCCESS;
 }
 
+NRTPRIV(NRT_BOOL) BufferAdapter_readAt(NRT_DATA * data, nrt_Off offset,
+                                       char *buf, size_t size,
+                                       nrt_Error * error)
+{
+    BufferIOControl *control = (BufferIOControl *) data;
+    size_t end = control->growable ? control->bytesWritten : control->size;
+
+    if ((offset < 0) || ((size_t) offset > end)
+        || (size > end - (size_t) offset))
+    {
+        nrt_Error_init(error, "Invalid size requested - EOF", NRT_CTXT,
+                       NRT_ERR_MEMORY);
+        return NRT_FAILURE;
+    }
+
+    if (size > 0)
+        memcpy(buf, (char *) (control->buf + offset), size);
+    return NRT_SUCCESS;
+}
+
+/*
+ *  Make room for size more bytes at the mark of a growable buffer. The
+ *  buffer at least doubles so a run of small writes is not quadratic, and
+ *  any gap left by a seek past the end is zero filled.
+ */
+NRTPRIV(NRT_BOOL) BufferAdapter_grow(BufferIOControl * control, size_t size,
+                                     nrt_Error * error)
+{
+    size_t needed = control->mark + size;
+    size_t newSize;
+    char *newBuf;
+
+    if (needed < control->mark)
+    {
+        nrt_Error_init(error, "Invalid size requested - overflow", NRT_CTXT,
+                       NRT_ERR_MEMORY);
+        return NRT_FAILURE;
+    }
+
+    if (needed > control->size)
+    {
+        newSize = control->size * 2;
+        if (newSize < needed)
+            newSize = needed;
+        newBuf = (char *) NRT_REALLOC(control->buf, newSize);
+        if (!newBuf)
+        {
+            nrt_Error_init(error, NRT_STRERROR(NRT_ERRNO), NRT_CTXT,
+                           NRT_ERR_MEMORY);
+            return NRT_FAILURE;
+        }
+        control->buf = newBuf;
+        control->size = newSize;
+    }
+
+    if (control->mark > control->bytesWritten)
+        memset(control->buf + control->bytesWritten, 0,
+               control->mark - control->bytesWritten);
+    return NRT_SUCCESS;
+}
+
 NRTPRIV(NRT_BOOL) BufferAdapter_write(NRT_DATA * data, const char *buf,
                                       size_t size, nrt_Error * error)
 {
     BufferIOControl *control = (BufferIOControl *) data;
 
-    if (size > control->size - control->mark)
+    if (control->growable)
+    {
+        if (!BufferAdapter_grow(control, size, error))
+            return NRT_FAILURE;
+    }
+    else if (size > control->size - control->mark)
     {
         nrt_Error_init(error, "Invalid size requested - EOF", NRT_CTXT,
                        NRT_ERR_MEMORY);
@@ -221,6 +424,23 @@ NRTPRIV(nrt_Off) BufferAdapter_seek(NRT_DATA * data, nrt_Off offset, int whence,
 {
     BufferIOControl *control = (BufferIOControl *) data;
 
+    /* A growable buffer may be positioned anywhere, it grows on write */
+    if (control->growable)
+    {
+        if (whence == NRT_SEEK_CUR)
+            offset += (nrt_Off) control->mark;
+        else if (whence == NRT_SEEK_END)
+            offset += (nrt_Off) control->bytesWritten;
+        if (offset < 0)
+        {
+            nrt_Error_init(error, "Invalid offset requested", NRT_CTXT,
+                           NRT_ERR_MEMORY);
+            return -1;
+        }
+        control->mark = (size_t) offset;
+        return control->mark;
+    }
+
     if (whence == NRT_SEEK_SET)
     {
         if (offset >= (nrt_Off) control->size)
@@ -267,7 +487,9 @@ NRTPRIV(nrt_Off) BufferAdapter_getSize(NRT_DATA * data, nrt_Error * error)
     /* Silence compiler warnings about unused variables */
     (void)error;
 
-    return (nrt_Off) control->bytesWritten;
+    /* A buffer given to the adapter is all data, as it is for read */
+    return (nrt_Off) (control->growable ? control->bytesWritten :
+                      control->size);
 }
 
 NRTPRIV(int) BufferAdapter_getMode(NRT_DATA * data, nrt_Error * error)
@@ -299,6 +521,156 @@ NRTPRIV(void) BufferAdapter_destruct(NRT_DATA * data)
     }
 }
 
+NRTPRIV(NRT_BOOL) MMapAdapter_readAt(NRT_DATA * data, nrt_Off offset,
+                                     char *buf, size_t size,
+                                     nrt_Error * error)
+{
+    MMapControl *control = (MMapControl *) data;
+
+    if ((offset < 0) || (offset > control->size)
+        || ((nrt_Uint64) size > (nrt_Uint64) (control->size - offset)))
+    {
+        nrt_Error_init(error, "Invalid size requested - EOF", NRT_CTXT,
+                       NRT_ERR_READING_FROM_FILE);
+        return NRT_FAILURE;
+    }
+
+    if (size > 0)
+        memcpy(buf, control->map + offset, size);
+    return NRT_SUCCESS;
+}
+
+NRTPRIV(NRT_BOOL) MMapAdapter_read(NRT_DATA * data, char *buf, size_t size,
+                                   nrt_Error * error)
+{
+    MMapControl *control = (MMapControl *) data;
+
+    if (!MMapAdapter_readAt(data, control->mark, buf, size, error))
+        return NRT_FAILURE;
+    control->mark += (nrt_Off) size;
+    return NRT_SUCCESS;
+}
+
+NRTPRIV(NRT_BOOL) MMapAdapter_write(NRT_DATA * data, const char *buf,
+                                    size_t size, nrt_Error * error)
+{
+    /* Silence compiler warnings about unused variables */
+    (void)data;
+    (void)buf;
+    (void)size;
+
+    nrt_Error_init(error, "Memory mapped IO is read-only", NRT_CTXT,
+                   NRT_ERR_WRITING_TO_FILE);
+    return NRT_FAILURE;
+}
+
+NRTPRIV(NRT_BOOL) MMapAdapter_canSeek(NRT_DATA * data, nrt_Error * error)
+{
+    /* Silence compiler warnings about unused variables */
+    (void)data;
+    (void)error;
+
+    return NRT_SUCCESS;
+}
+
+NRTPRIV(nrt_Off) MMapAdapter_seek(NRT_DATA * data, nrt_Off offset,
+                                  int whence, nrt_Error * error)
+{
+    MMapControl *control = (MMapControl *) data;
+    nrt_Off mark;
+
+    if (whence == NRT_SEEK_SET)
+        mark = offset;
+    else if (whence == NRT_SEEK_CUR)
+        mark = control->mark + offset;
+    else if (whence == NRT_SEEK_END)
+        mark = control->size + offset;
+    else
+    {
+        nrt_Error_init(error, "Invalid/unsupported seek directive", NRT_CTXT,
+                       NRT_ERR_SEEKING_IN_FILE);
+        return -1;
+    }
+
+    if (mark < 0)
+    {
+        nrt_Error_init(error, "Invalid offset requested", NRT_CTXT,
+                       NRT_ERR_SEEKING_IN_FILE);
+        return -1;
+    }
+    control->mark = mark;
+    return mark;
+}
+
+NRTPRIV(nrt_Off) MMapAdapter_tell(NRT_DATA * data, nrt_Error * error)
+{
+    MMapControl *control = (MMapControl *) data;
+
+    /* Silence compiler warnings about unused variables */
+    (void)error;
+
+    return control->mark;
+}
+
+NRTPRIV(nrt_Off) MMapAdapter_getSize(NRT_DATA * data, nrt_Error * error)
+{
+    MMapControl *control = (MMapControl *) data;
+
+    /* Silence compiler warnings about unused variables */
+    (void)error;
+
+    return control->size;
+}
+
+NRTPRIV(int) MMapAdapter_getMode(NRT_DATA * data, nrt_Error * error)
+{
+    /* Silence compiler warnings about unused variables */
+    (void)data;
+    (void)error;
+
+    return NRT_ACCESS_READONLY;
+}
+
+NRTPRIV(const char *) MMapAdapter_getMapping(NRT_DATA * data, nrt_Off * size)
+{
+    MMapControl *control = (MMapControl *) data;
+
+    if (control->map == NULL)
+        return NULL;
+    *size = control->size;
+    return control->map;
+}
+
+NRTPRIV(NRT_BOOL) MMapAdapter_close(NRT_DATA * data, nrt_Error * error)
+{
+    MMapControl *control = (MMapControl *) data;
+
+    /* Silence compiler warnings about unused variables */
+    (void)error;
+
+    if (control->map)
+    {
+        nrt_IOHandle_unmap(control->map, control->size);
+        control->map = NULL;
+    }
+    control->size = 0;
+    control->mark = 0;
+
+    if (!NRT_INVALID_HANDLE(control->handle))
+    {
+        nrt_IOHandle_close(control->handle);
+        control->handle = NRT_INVALID_HANDLE_VALUE;
+    }
+    return NRT_SUCCESS;
+}
+
+NRTPRIV(void) MMapAdapter_destruct(NRT_DATA * data)
+{
+    /* Closing is idempotent, so make sure nothing leaks if the caller
+     * never closed the interface */
+    MMapAdapter_close(data, NULL);
+}
+
 NRTAPI(nrt_IOInterface *) nrt_IOHandleAdapter_construct(nrt_IOHandle handle,
                                                         int accessMode,
                                                         nrt_Error * error)
@@ -312,7 +684,13 @@ NRTAPI(nrt_IOInterface *) nrt_IOHandleAdapter_construct(nrt_IOHandle handle,
         &IOHandleAdapter_getSize,
         &IOHandleAdapter_getMode,
         &IOHandleAdapter_close,
-        &IOHandleAdapter_destruct
+        &IOHandleAdapter_destruct,
+        &IOHandleAdapter_readAt,
+        NULL,
+        &IOHandleAdapter_adviseWillNeed,
+        &IOHandleAdapter_readvAt,
+        NULL,
+        &IOHandleAdapter_writeAt
     };
     nrt_IOInterface *impl = NULL;
     IOHandleControl *control = NULL;
@@ -373,6 +751,93 @@ NRTAPI(nrt_IOInterface *) nrt_IOHandleAdapter_open(const char *fname,
     return nrt_IOHandleAdapter_construct(handle, accessFlags, error);
 }
 
+NRTAPI(nrt_IOInterface *) nrt_MMapAdapter_construct(nrt_IOHandle handle,
+                                                    nrt_Error * error)
+{
+    static nrt_IIOInterface iMMap = {
+        &MMapAdapter_read,
+        &MMapAdapter_write,
+        &MMapAdapter_canSeek,
+        &MMapAdapter_seek,
+        &MMapAdapter_tell,
+        &MMapAdapter_getSize,
+        &MMapAdapter_getMode,
+        &MMapAdapter_close,
+        &MMapAdapter_destruct,
+        &MMapAdapter_readAt,
+        &MMapAdapter_getMapping
+    };
+    nrt_IOInterface *impl = NULL;
+    MMapControl *control = NULL;
+    nrt_Off size;
+
+    size = nrt_IOHandle_getSize(handle, error);
+    if (!NRT_IO_SUCCESS(size))
+        return NULL;
+
+    impl = (nrt_IOInterface *) NRT_MALLOC(sizeof(nrt_IOInterface));
+    if (!impl)
+    {
+        nrt_Error_init(error, NRT_STRERROR(NRT_ERRNO), NRT_CTXT,
+                       NRT_ERR_MEMORY);
+        goto CATCH_ERROR;
+    }
+    memset(impl, 0, sizeof(nrt_IOInterface));
+
+    control = (MMapControl *) NRT_MALLOC(sizeof(MMapControl));
+    if (!control)
+    {
+        nrt_Error_init(error, NRT_STRERROR(NRT_ERRNO), NRT_CTXT,
+                       NRT_ERR_MEMORY);
+        goto CATCH_ERROR;
+    }
+    memset(control, 0, sizeof(MMapControl));
+    control->handle = NRT_INVALID_HANDLE_VALUE;
+
+    impl->data = (NRT_DATA *) control;
+    impl->iface = &iMMap;
+
+    /* An empty file cannot be mapped, it simply has nothing to read */
+    if (size > 0)
+    {
+        control->map = nrt_IOHandle_map(handle, size, error);
+        if (!control->map)
+            goto CATCH_ERROR;
+    }
+    control->size = size;
+    control->handle = handle;
+    return impl;
+
+    CATCH_ERROR:
+    {
+        if (impl)
+            nrt_IOInterface_destruct(&impl);
+        return NULL;
+    }
+}
+
+NRTAPI(nrt_IOInterface *) nrt_MMapAdapter_open(const char *fname,
+                                               nrt_Error * error)
+{
+    nrt_IOInterface *impl;
+    nrt_IOHandle handle = nrt_IOHandle_create(fname, NRT_ACCESS_READONLY,
+                                              NRT_OPEN_EXISTING, error);
+    if (NRT_INVALID_HANDLE(handle))
+    {
+        char origMessage[NRT_MAX_EMESSAGE + 1];
+        strcpy(origMessage, error->message);
+
+        nrt_Error_initf(error, NRT_CTXT, NRT_ERR_INVALID_OBJECT,
+                        "Invalid IO handle (%s)", origMessage);
+        return NULL;
+    }
+
+    impl = nrt_MMapAdapter_construct(handle, error);
+    if (!impl)
+        nrt_IOHandle_close(handle);
+    return impl;
+}
+
 NRTAPI(nrt_IOInterface *) nrt_BufferAdapter_construct(char *buf, size_t size,
                                                       NRT_BOOL ownBuf,
                                                       nrt_Error * error)
@@ -386,7 +851,8 @@ NRTAPI(nrt_IOInterface *) nrt_BufferAdapter_construct(char *buf, size_t size,
         &BufferAdapter_getSize,
         &BufferAdapter_getMode,
         &BufferAdapter_close,
-        &BufferAdapter_destruct
+        &BufferAdapter_destruct,
+        &BufferAdapter_readAt
     };
     nrt_IOInterface *impl = NULL;
     BufferIOControl *control = NULL;
@@ -412,6 +878,14 @@ NRTAPI(nrt_IOInterface *) nrt_BufferAdapter_construct(char *buf, size_t size,
     control->size = size;
     control->ownBuf = ownBuf;
 
+    /* Without a buffer the adapter allocates and grows its own */
+    if (buf == NULL)
+    {
+        control->size = 0;
+        control->ownBuf = NRT_TRUE;
+        control->growable = NRT_TRUE;
+    }
+
     impl->data = (NRT_DATA *) control;
     impl->iface = &bufferInterface;
     return impl;
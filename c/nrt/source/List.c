@@ -21,13 +21,14 @@
  */
 
 #include "nrt/List.h"
+#include "nrt/Arena.h"
 
 NRTAPI(nrt_ListNode *) nrt_ListNode_construct(nrt_ListNode * prev,
                                               nrt_ListNode * next,
                                               NRT_DATA * data,
                                               nrt_Error * error)
 {
-    nrt_ListNode *node = (nrt_ListNode *) NRT_MALLOC(sizeof(nrt_ListNode));
+    nrt_ListNode *node = (nrt_ListNode *) nrt_Arena_malloc(sizeof(nrt_ListNode));
     if (node == NULL)
     {
         /* Init the error with the string value of errno */
@@ -55,7 +56,7 @@ NRTAPI(void) nrt_ListNode_destruct(nrt_ListNode ** this_node)
 {
     if (*this_node)
     {
-        NRT_FREE(*this_node);
+        nrt_Arena_free(*this_node);
         *this_node = NULL;
     }
 }
@@ -192,7 +193,7 @@ NRTAPI(nrt_List *) nrt_List_construct(nrt_Error * error)
 {
     /* New allocate a list */
     nrt_List *l;
-    l = (nrt_List *) NRT_MALLOC(sizeof(nrt_List));
+    l = (nrt_List *) nrt_Arena_malloc(sizeof(nrt_List));
     if (!l)
     {
         /* Initialize the error and return NULL */
@@ -263,7 +264,7 @@ NRTAPI(void) nrt_List_destruct(nrt_List ** this_list)
             if (data)
                 NRT_FREE(data);
         }
-        NRT_FREE(*this_list);
+        nrt_Arena_free(*this_list);
         *this_list = NULL;
     }
 
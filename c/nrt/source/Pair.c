@@ -21,11 +21,12 @@
  */
 
 #include "nrt/Pair.h"
+#include "nrt/Arena.h"
 
 NRTAPI(void) nrt_Pair_init(nrt_Pair * pair, const char *key, NRT_DATA * data)
 {
     size_t len = strlen(key);
-    pair->key = (char *) NRT_MALLOC(len + 1);
+    pair->key = (char *) nrt_Arena_malloc(len + 1);
     /* Help, we have an unchecked malloc here! */
     pair->key[len] = 0;
     strcpy(pair->key, key);
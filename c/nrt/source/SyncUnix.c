@@ -54,4 +54,57 @@ NRTPROT(void) nrt_Mutex_delete(nrt_Mutex * m)
 }
 #endif
 
+#if !defined(WIN32)
+/*
+ *  pthreads wants a function returning a pointer, so the thread starts
+ *  in a trampoline that owns a copy of the arguments
+ */
+typedef struct _ThreadStart
+{
+    NRT_THREAD_RUN_FUNCTION run;
+    void *data;
+} ThreadStart;
+
+NRTPRIV(void *) ThreadUnix_start(void *arg)
+{
+    ThreadStart start = *((ThreadStart *) arg);
+    NRT_FREE(arg);
+    (*start.run) (start.data);
+    return NULL;
+}
+
+NRTPROT(NRT_BOOL) nrt_Thread_create(nrt_Thread * thread,
+                                    NRT_THREAD_RUN_FUNCTION run, void *data,
+                                    nrt_Error * error)
+{
+    ThreadStart *start;
+    int status;
+
+    start = (ThreadStart *) NRT_MALLOC(sizeof(ThreadStart));
+    if (!start)
+    {
+        nrt_Error_init(error, NRT_STRERROR(NRT_ERRNO), NRT_CTXT,
+                       NRT_ERR_MEMORY);
+        return NRT_FAILURE;
+    }
+    start->run = run;
+    start->data = data;
+
+    status = pthread_create(thread, NULL, ThreadUnix_start, start);
+    if (status != 0)
+    {
+        NRT_FREE(start);
+        nrt_Error_initf(error, NRT_CTXT, NRT_ERR_UNK,
+                        "Unable to create thread: %s", NRT_STRERROR(status));
+        return NRT_FAILURE;
+    }
+    return NRT_SUCCESS;
+}
+
+NRTPROT(void) nrt_Thread_join(nrt_Thread * thread)
+{
+    pthread_join(*thread, NULL);
+}
+#endif
+
 NRT_CXX_ENDGUARD
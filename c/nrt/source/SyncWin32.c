@@ -22,6 +22,10 @@
 
 #include "nrt/Sync.h"
 
+#if defined(WIN32)
+#   include <process.h>
+#endif
+
 NRT_CXX_GUARD
 #if defined(WIN32)
 NRTPROT(void) nrt_Mutex_lock(nrt_Mutex * m)
@@ -62,6 +66,59 @@ NRTPROT(void) nrt_Mutex_delete(nrt_Mutex * m)
         NRT_FREE(lpCriticalSection);
     }
 }
+
+/*
+ *  The C runtime wants a __stdcall function returning unsigned, so the
+ *  thread starts in a trampoline that owns a copy of the arguments
+ */
+typedef struct _ThreadStart
+{
+    NRT_THREAD_RUN_FUNCTION run;
+    void *data;
+} ThreadStart;
+
+static unsigned __stdcall ThreadWin32_start(void *arg)
+{
+    ThreadStart start = *((ThreadStart *) arg);
+    NRT_FREE(arg);
+    (*start.run) (start.data);
+    return 0;
+}
+
+NRTPROT(NRT_BOOL) nrt_Thread_create(nrt_Thread * thread,
+                                    NRT_THREAD_RUN_FUNCTION run, void *data,
+                                    nrt_Error * error)
+{
+    ThreadStart *start;
+
+    start = (ThreadStart *) NRT_MALLOC(sizeof(ThreadStart));
+    if (!start)
+    {
+        nrt_Error_init(error, NRT_STRERROR(NRT_ERRNO), NRT_CTXT,
+                       NRT_ERR_MEMORY);
+        return NRT_FAILURE;
+    }
+    start->run = run;
+    start->data = data;
+
+    *thread = (HANDLE) _beginthreadex(NULL, 0, ThreadWin32_start, start, 0,
+                                      NULL);
+    if (*thread == 0)
+    {
+        NRT_FREE(start);
+        nrt_Error_initf(error, NRT_CTXT, NRT_ERR_UNK,
+                        "Unable to create thread: %s",
+                        NRT_STRERROR(NRT_ERRNO));
+        return NRT_FAILURE;
+    }
+    return NRT_SUCCESS;
+}
+
+NRTPROT(void) nrt_Thread_join(nrt_Thread * thread)
+{
+    WaitForSingleObject(*thread, INFINITE);
+    CloseHandle(*thread);
+}
 #endif
 
 NRT_CXX_ENDGUARD
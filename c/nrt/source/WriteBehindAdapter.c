@@ -0,0 +1,447 @@
+/* =========================================================================
+ * This file is part of NITRO
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2010, General Dynamics - Advanced Information Systems
+ *
+ * NITRO is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "nrt/IOInterface.h"
+
+/* Buffer size used when zero is given to nrt_WriteBehindAdapter_construct */
+#define NRT_WRITE_BEHIND_DEFAULT_SIZE (4 * 1024 * 1024)
+
+/* Records in a buffer start on this boundary */
+#define NRT_WRITE_BEHIND_ALIGN(n) \
+    (((n) + sizeof(nrt_Off) - 1) & ~(sizeof(nrt_Off) - 1))
+
+/*
+ *  A buffer holds a run of records, each a WriteBehindRecord followed by
+ *  its data.  A write that continues the last record is added to it, so
+ *  sequential writes make one record.
+ */
+typedef struct _WriteBehindRecord
+{
+    nrt_Off offset;             /* File offset of the data */
+    size_t size;                /* Bytes of data after the record */
+} WriteBehindRecord;
+
+typedef struct _WriteBehindBuffer
+{
+    char *data;
+    size_t used;                /* Bytes used, including record headers */
+    WriteBehindRecord *last;    /* Last record, NULL if the buffer is empty */
+} WriteBehindBuffer;
+
+typedef struct _WriteBehindControl
+{
+    nrt_IOInterface *io;        /* The wrapped interface */
+    nrt_Off position;           /* Position seen through the adapter */
+    size_t bufferSize;
+    WriteBehindBuffer buffers[2];
+    int filling;                /* Buffer taking new writes */
+    nrt_Thread thread;          /* Writes the other buffer */
+    NRT_BOOL running;           /* The thread has been started */
+    NRT_BOOL failed;            /* A background write failed */
+    nrt_Error error;            /* Error of the failed write */
+    nrt_Mutex lock;
+} WriteBehindControl;
+
+/*
+ *  Write every record of the buffer that is not filling.  Run on the
+ *  write thread, or directly if the thread cannot be started.
+ */
+NRTPRIV(void) WriteBehindAdapter_writeBuffer(void *data)
+{
+    WriteBehindControl *control = (WriteBehindControl *) data;
+    WriteBehindBuffer *buffer = &(control->buffers[1 - control->filling]);
+    size_t next = 0;
+
+    while (next < buffer->used)
+    {
+        WriteBehindRecord *record =
+            (WriteBehindRecord *) (buffer->data + next);
+
+        if (!nrt_IOInterface_writeAt(control->io, record->offset,
+                                     (const char *) (record + 1),
+                                     record->size, &(control->error)))
+        {
+            control->failed = 1;
+            break;
+        }
+        next = NRT_WRITE_BEHIND_ALIGN(next + sizeof(WriteBehindRecord)
+                                      + record->size);
+    }
+    buffer->used = 0;
+    buffer->last = NULL;
+}
+
+/*
+ *  Wait for the write thread, and report any write that failed.  A
+ *  failure is reported by every later call.
+ */
+NRTPRIV(NRT_BOOL) WriteBehindAdapter_wait(WriteBehindControl * control,
+                                          nrt_Error * error)
+{
+    if (control->running)
+    {
+        nrt_Thread_join(&(control->thread));
+        control->running = 0;
+    }
+    if (control->failed)
+    {
+        *error = control->error;
+        return NRT_FAILURE;
+    }
+    return NRT_SUCCESS;
+}
+
+/*
+ *  Hand the filling buffer to the write thread, after the thread has
+ *  finished with the other one
+ */
+NRTPRIV(NRT_BOOL) WriteBehindAdapter_submit(WriteBehindControl * control,
+                                            nrt_Error * error)
+{
+    nrt_Error threadError;
+
+    if (!WriteBehindAdapter_wait(control, error))
+        return NRT_FAILURE;
+    if (control->buffers[control->filling].used == 0)
+        return NRT_SUCCESS;
+
+    control->filling = 1 - control->filling;
+    if (nrt_Thread_create(&(control->thread),
+                          WriteBehindAdapter_writeBuffer, control,
+                          &threadError))
+        control->running = 1;
+    else
+        WriteBehindAdapter_writeBuffer(control);
+
+    return !control->failed || WriteBehindAdapter_wait(control, error);
+}
+
+/*
+ *  Write everything that is buffered and leave the wrapped interface at
+ *  the adapter's position
+ */
+NRTPRIV(NRT_BOOL) WriteBehindAdapter_drain(WriteBehindControl * control,
+                                           nrt_Error * error)
+{
+    if (!WriteBehindAdapter_submit(control, error)
+        || !WriteBehindAdapter_wait(control, error))
+        return NRT_FAILURE;
+
+    if (!nrt_IOInterface_canSeek(control->io, error))
+        return NRT_SUCCESS;
+    return NRT_IO_SUCCESS(nrt_IOInterface_seek(control->io,
+                                               control->position,
+                                               NRT_SEEK_SET, error));
+}
+
+NRTPRIV(NRT_BOOL) WriteBehindAdapter_queue(WriteBehindControl * control,
+                                           nrt_Off offset, const char *buf,
+                                           size_t size, nrt_Error * error)
+{
+    WriteBehindBuffer *buffer = &(control->buffers[control->filling]);
+    size_t start;
+
+    if (control->failed)
+        return WriteBehindAdapter_wait(control, error);
+
+    /* Continue the last record */
+    if (buffer->last != NULL
+        && buffer->last->offset + (nrt_Off) buffer->last->size == offset
+        && buffer->used + size <= control->bufferSize)
+    {
+        memcpy(buffer->data + buffer->used, buf, size);
+        buffer->used += size;
+        buffer->last->size += size;
+        return NRT_SUCCESS;
+    }
+
+    start = NRT_WRITE_BEHIND_ALIGN(buffer->used);
+    if (start + sizeof(WriteBehindRecord) + size > control->bufferSize)
+    {
+        if (!WriteBehindAdapter_submit(control, error))
+            return NRT_FAILURE;
+        buffer = &(control->buffers[control->filling]);
+        start = 0;
+
+        /* Too big to buffer, write it once the earlier writes are done */
+        if (sizeof(WriteBehindRecord) + size > control->bufferSize)
+            return WriteBehindAdapter_wait(control, error)
+                && nrt_IOInterface_writeAt(control->io, offset, buf, size,
+                                           error);
+    }
+
+    buffer->last = (WriteBehindRecord *) (buffer->data + start);
+    buffer->last->offset = offset;
+    buffer->last->size = size;
+    memcpy(buffer->last + 1, buf, size);
+    buffer->used = start + sizeof(WriteBehindRecord) + size;
+    return NRT_SUCCESS;
+}
+
+NRTPRIV(NRT_BOOL) WriteBehindAdapter_read(NRT_DATA * data, char *buf,
+                                          size_t size, nrt_Error * error)
+{
+    WriteBehindControl *control = (WriteBehindControl *) data;
+    NRT_BOOL ret;
+
+    nrt_Mutex_lock(&(control->lock));
+    ret = WriteBehindAdapter_drain(control, error)
+        && nrt_IOInterface_read(control->io, buf, size, error);
+    if (ret)
+        control->position += (nrt_Off) size;
+    nrt_Mutex_unlock(&(control->lock));
+    return ret;
+}
+
+NRTPRIV(NRT_BOOL) WriteBehindAdapter_write(NRT_DATA * data, const char *buf,
+                                           size_t size, nrt_Error * error)
+{
+    WriteBehindControl *control = (WriteBehindControl *) data;
+    NRT_BOOL ret;
+
+    nrt_Mutex_lock(&(control->lock));
+    ret = WriteBehindAdapter_queue(control, control->position, buf, size,
+                                   error);
+    if (ret)
+        control->position += (nrt_Off) size;
+    nrt_Mutex_unlock(&(control->lock));
+    return ret;
+}
+
+NRTPRIV(NRT_BOOL) WriteBehindAdapter_writeAt(NRT_DATA * data, nrt_Off offset,
+                                             const char *buf, size_t size,
+                                             nrt_Error * error)
+{
+    WriteBehindControl *control = (WriteBehindControl *) data;
+    NRT_BOOL ret;
+
+    nrt_Mutex_lock(&(control->lock));
+    ret = WriteBehindAdapter_queue(control, offset, buf, size, error);
+    nrt_Mutex_unlock(&(control->lock));
+    return ret;
+}
+
+NRTPRIV(NRT_BOOL) WriteBehindAdapter_canSeek(NRT_DATA * data,
+                                             nrt_Error * error)
+{
+    WriteBehindControl *control = (WriteBehindControl *) data;
+    return nrt_IOInterface_canSeek(control->io, error);
+}
+
+NRTPRIV(nrt_Off) WriteBehindAdapter_seek(NRT_DATA * data, nrt_Off offset,
+                                         int whence, nrt_Error * error)
+{
+    WriteBehindControl *control = (WriteBehindControl *) data;
+    nrt_Off size;
+    nrt_Off ret = -1;
+
+    nrt_Mutex_lock(&(control->lock));
+    switch (whence)
+    {
+    case NRT_SEEK_SET:
+        ret = offset;
+        break;
+    case NRT_SEEK_CUR:
+        ret = control->position + offset;
+        break;
+    case NRT_SEEK_END:
+        if (!WriteBehindAdapter_drain(control, error))
+            break;
+        size = nrt_IOInterface_getSize(control->io, error);
+        if (NRT_IO_SUCCESS(size))
+            ret = size + offset;
+        break;
+    default:
+        nrt_Error_initf(error, NRT_CTXT, NRT_ERR_INVALID_PARAMETER,
+                        "Invalid seek whence %d", whence);
+        break;
+    }
+    if (NRT_IO_SUCCESS(ret))
+        control->position = ret;
+    nrt_Mutex_unlock(&(control->lock));
+    return ret;
+}
+
+NRTPRIV(nrt_Off) WriteBehindAdapter_tell(NRT_DATA * data, nrt_Error * error)
+{
+    WriteBehindControl *control = (WriteBehindControl *) data;
+
+    /* Silence compiler warnings about unused variables */
+    (void)error;
+
+    return control->position;
+}
+
+NRTPRIV(nrt_Off) WriteBehindAdapter_getSize(NRT_DATA * data,
+                                            nrt_Error * error)
+{
+    WriteBehindControl *control = (WriteBehindControl *) data;
+    nrt_Off ret = -1;
+
+    nrt_Mutex_lock(&(control->lock));
+    if (WriteBehindAdapter_drain(control, error))
+        ret = nrt_IOInterface_getSize(control->io, error);
+    nrt_Mutex_unlock(&(control->lock));
+    return ret;
+}
+
+NRTPRIV(int) WriteBehindAdapter_getMode(NRT_DATA * data, nrt_Error * error)
+{
+    WriteBehindControl *control = (WriteBehindControl *) data;
+    return nrt_IOInterface_getMode(control->io, error);
+}
+
+NRTPRIV(NRT_BOOL) WriteBehindAdapter_close(NRT_DATA * data, nrt_Error * error)
+{
+    WriteBehindControl *control = (WriteBehindControl *) data;
+    NRT_BOOL ret;
+
+    nrt_Mutex_lock(&(control->lock));
+    ret = WriteBehindAdapter_drain(control, error);
+    nrt_Mutex_unlock(&(control->lock));
+    return nrt_IOInterface_close(control->io, error) && ret;
+}
+
+NRTPRIV(void) WriteBehindAdapter_destruct(NRT_DATA * data)
+{
+    WriteBehindControl *control = (WriteBehindControl *) data;
+    nrt_Error error;
+
+    if (control)
+    {
+        /* Errors are lost here, nrt_WriteBehindAdapter_flush reports them */
+        (void) WriteBehindAdapter_drain(control, &error);
+        if (control->buffers[0].data)
+            NRT_FREE(control->buffers[0].data);
+        if (control->buffers[1].data)
+            NRT_FREE(control->buffers[1].data);
+        nrt_Mutex_delete(&(control->lock));
+    }
+}
+
+NRTPRIV(NRT_BOOL) WriteBehindAdapter_readAt(NRT_DATA * data, nrt_Off offset,
+                                            char *buf, size_t size,
+                                            nrt_Error * error)
+{
+    WriteBehindControl *control = (WriteBehindControl *) data;
+    NRT_BOOL ret;
+
+    nrt_Mutex_lock(&(control->lock));
+    ret = WriteBehindAdapter_drain(control, error)
+        && nrt_IOInterface_readAt(control->io, offset, buf, size, error);
+    nrt_Mutex_unlock(&(control->lock));
+    return ret;
+}
+
+static nrt_IIOInterface iWriteBehind = {
+    &WriteBehindAdapter_read,
+    &WriteBehindAdapter_write,
+    &WriteBehindAdapter_canSeek,
+    &WriteBehindAdapter_seek,
+    &WriteBehindAdapter_tell,
+    &WriteBehindAdapter_getSize,
+    &WriteBehindAdapter_getMode,
+    &WriteBehindAdapter_close,
+    &WriteBehindAdapter_destruct,
+    &WriteBehindAdapter_readAt,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    &WriteBehindAdapter_writeAt
+};
+
+NRTAPI(nrt_IOInterface *) nrt_WriteBehindAdapter_construct(nrt_IOInterface *
+                                                           io,
+                                                           size_t bufferSize,
+                                                           nrt_Error * error)
+{
+    nrt_IOInterface *impl = NULL;
+    WriteBehindControl *control = NULL;
+    nrt_Off position;
+
+    position = nrt_IOInterface_tell(io, error);
+    if (!NRT_IO_SUCCESS(position))
+        return NULL;
+
+    if (bufferSize == 0)
+        bufferSize = NRT_WRITE_BEHIND_DEFAULT_SIZE;
+    bufferSize = NRT_WRITE_BEHIND_ALIGN(bufferSize);
+
+    impl = (nrt_IOInterface *) NRT_MALLOC(sizeof(nrt_IOInterface));
+    if (!impl)
+    {
+        nrt_Error_init(error, NRT_STRERROR(NRT_ERRNO), NRT_CTXT,
+                       NRT_ERR_MEMORY);
+        goto CATCH_ERROR;
+    }
+    memset(impl, 0, sizeof(nrt_IOInterface));
+
+    control = (WriteBehindControl *) NRT_MALLOC(sizeof(WriteBehindControl));
+    if (!control)
+    {
+        nrt_Error_init(error, NRT_STRERROR(NRT_ERRNO), NRT_CTXT,
+                       NRT_ERR_MEMORY);
+        goto CATCH_ERROR;
+    }
+    memset(control, 0, sizeof(WriteBehindControl));
+    control->io = io;
+    control->position = position;
+    control->bufferSize = bufferSize;
+    nrt_Mutex_init(&(control->lock));
+
+    impl->data = (NRT_DATA *) control;
+    impl->iface = &iWriteBehind;
+
+    control->buffers[0].data = (char *) NRT_MALLOC(bufferSize);
+    control->buffers[1].data = (char *) NRT_MALLOC(bufferSize);
+    if (!control->buffers[0].data || !control->buffers[1].data)
+    {
+        nrt_Error_init(error, NRT_STRERROR(NRT_ERRNO), NRT_CTXT,
+                       NRT_ERR_MEMORY);
+        goto CATCH_ERROR;
+    }
+    return impl;
+
+    CATCH_ERROR:
+    {
+        if (impl)
+            nrt_IOInterface_destruct(&impl);
+        return NULL;
+    }
+}
+
+NRTAPI(NRT_BOOL) nrt_WriteBehindAdapter_flush(nrt_IOInterface * io,
+                                              nrt_Error * error)
+{
+    WriteBehindControl *control;
+    NRT_BOOL ret;
+
+    if (io == NULL || io->iface != &iWriteBehind)
+        return NRT_SUCCESS;
+
+    control = (WriteBehindControl *) io->data;
+    nrt_Mutex_lock(&(control->lock));
+    ret = WriteBehindAdapter_drain(control, error);
+    nrt_Mutex_unlock(&(control->lock));
+    return ret;
+}
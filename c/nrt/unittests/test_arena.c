@@ -0,0 +1,215 @@
+/* =========================================================================
+ * This file is part of NITRO
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2010, General Dynamics - Advanced Information Systems
+ *
+ * NITRO is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <import/nrt.h>
+#include "Test.h"
+
+#define CHUNK_SIZE 4096
+#define NUM_BLOCKS 500
+
+static void fill(char *block, size_t size, int seed)
+{
+    size_t i;
+
+    for (i = 0; i < size; i++)
+        block[i] = (char) (seed * 31 + i);
+}
+
+static int check(const char *block, size_t size, int seed)
+{
+    size_t i;
+
+    for (i = 0; i < size; i++)
+        if (block[i] != (char) (seed * 31 + i))
+            return 0;
+    return 1;
+}
+
+static size_t blockSize(int i)
+{
+    return 1 + (i * 37) % 200;
+}
+
+/*
+ *  Allocate NUM_BLOCKS blocks of various sizes from the current arena
+ */
+static void allocate(const char *testName, char **blocks)
+{
+    int i;
+
+    for (i = 0; i < NUM_BLOCKS; i++)
+    {
+        blocks[i] = (char *) nrt_Arena_malloc(blockSize(i));
+        TEST_ASSERT(blocks[i]);
+        fill(blocks[i], blockSize(i), i);
+    }
+}
+
+static void checkAndFree(const char *testName, char **blocks)
+{
+    int i;
+
+    for (i = 0; i < NUM_BLOCKS; i++)
+    {
+        TEST_ASSERT(check(blocks[i], blockSize(i), i));
+        nrt_Arena_free(blocks[i]);
+    }
+}
+
+TEST_CASE(testHeap)
+{
+    char *blocks[NUM_BLOCKS];
+    char *block;
+
+    /* With no arena current, the blocks are heap memory */
+    TEST_ASSERT_NULL(nrt_Arena_setCurrent(NULL));
+    allocate(testName, blocks);
+    checkAndFree(testName, blocks);
+
+    block = (char *) nrt_Arena_malloc(100);
+    TEST_ASSERT(block);
+    NRT_FREE(block);
+    nrt_Arena_free(NULL);
+}
+
+TEST_CASE(testArena)
+{
+    nrt_Error error;
+    nrt_Arena *arena;
+    char *blocks[NUM_BLOCKS];
+
+    arena = nrt_Arena_construct(CHUNK_SIZE, &error);
+    TEST_ASSERT(arena);
+    TEST_ASSERT_NULL(nrt_Arena_setCurrent(arena));
+    allocate(testName, blocks);
+    TEST_ASSERT(nrt_Arena_setCurrent(NULL) == arena);
+
+    /* The blocks outlive the owner's reference */
+    nrt_Arena_release(&arena);
+    TEST_ASSERT_NULL(arena);
+    checkAndFree(testName, blocks);
+}
+
+TEST_CASE(testRelease)
+{
+    nrt_Error error;
+    nrt_Arena *arena;
+    char *blocks[NUM_BLOCKS];
+
+    /* Freeing every block first, then releasing a current arena */
+    arena = nrt_Arena_construct(0, &error);
+    TEST_ASSERT(arena);
+    nrt_Arena_setCurrent(arena);
+    allocate(testName, blocks);
+    checkAndFree(testName, blocks);
+    nrt_Arena_release(&arena);
+    TEST_ASSERT_NULL(nrt_Arena_setCurrent(NULL));
+}
+
+TEST_CASE(testLarge)
+{
+    nrt_Error error;
+    nrt_Arena *arena;
+    char *small;
+    char *large;
+
+    /* Requests larger than a quarter chunk go to the heap */
+    arena = nrt_Arena_construct(CHUNK_SIZE, &error);
+    TEST_ASSERT(arena);
+    nrt_Arena_setCurrent(arena);
+    small = (char *) nrt_Arena_malloc(CHUNK_SIZE / 8);
+    large = (char *) nrt_Arena_malloc(CHUNK_SIZE);
+    nrt_Arena_setCurrent(NULL);
+    TEST_ASSERT(small);
+    TEST_ASSERT(large);
+    fill(small, CHUNK_SIZE / 8, 1);
+    fill(large, CHUNK_SIZE, 2);
+    nrt_Arena_release(&arena);
+
+    TEST_ASSERT(check(small, CHUNK_SIZE / 8, 1));
+    TEST_ASSERT(check(large, CHUNK_SIZE, 2));
+    nrt_Arena_free(large);
+    nrt_Arena_free(small);
+}
+
+typedef struct
+{
+    char **blocks;
+    int first;
+    int ok;
+}
+FreeJob;
+
+static void freeBlocks(void *data)
+{
+    FreeJob *job = (FreeJob *) data;
+    int i;
+
+    job->ok = 1;
+    for (i = job->first; i < NUM_BLOCKS; i += 2)
+    {
+        if (!check(job->blocks[i], blockSize(i), i))
+            job->ok = 0;
+        nrt_Arena_free(job->blocks[i]);
+    }
+}
+
+TEST_CASE(testOtherThreads)
+{
+    nrt_Error error;
+    nrt_Arena *arena;
+    char *blocks[NUM_BLOCKS];
+    nrt_Thread threads[2];
+    FreeJob jobs[2];
+    int i;
+
+    /* Blocks may be freed from threads where the arena is not current */
+    arena = nrt_Arena_construct(CHUNK_SIZE, &error);
+    TEST_ASSERT(arena);
+    nrt_Arena_setCurrent(arena);
+    allocate(testName, blocks);
+    nrt_Arena_release(&arena);
+
+    for (i = 0; i < 2; i++)
+    {
+        jobs[i].blocks = blocks;
+        jobs[i].first = i;
+        jobs[i].ok = 0;
+        TEST_ASSERT(nrt_Thread_create(&threads[i], freeBlocks, &jobs[i],
+                                      &error));
+    }
+    for (i = 0; i < 2; i++)
+    {
+        nrt_Thread_join(&threads[i]);
+        TEST_ASSERT(jobs[i].ok);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    CHECK(testHeap);
+    CHECK(testArena);
+    CHECK(testRelease);
+    CHECK(testLarge);
+    CHECK(testOtherThreads);
+    return 0;
+}
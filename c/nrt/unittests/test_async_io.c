@@ -0,0 +1,190 @@
+/* =========================================================================
+ * This file is part of NITRO
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2010, General Dynamics - Advanced Information Systems
+ *
+ * NITRO is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <import/nrt.h>
+#include "Test.h"
+
+#define TEST_FILE_NAME "test_async_io.tmp"
+#define TEST_FILE_SIZE 200000
+#define TEST_REQUESTS 150
+#define TEST_REQUEST_SIZE 1000
+
+static unsigned char expected(int offset)
+{
+    return (unsigned char) ((offset * 7 + offset / 251) & 0xff);
+}
+
+static void writeTestFile(const char *testName)
+{
+    nrt_Error e;
+    nrt_IOHandle handle;
+    char buf[TEST_FILE_SIZE];
+    int i;
+
+    for (i = 0; i < TEST_FILE_SIZE; i++)
+        buf[i] = (char) expected(i);
+
+    handle = nrt_IOHandle_create(TEST_FILE_NAME, NRT_ACCESS_WRITEONLY,
+                                 NRT_CREATE, &e);
+    TEST_ASSERT(!NRT_INVALID_HANDLE(handle));
+    TEST_ASSERT(nrt_IOHandle_write(handle, buf, TEST_FILE_SIZE, &e));
+    nrt_IOHandle_close(handle);
+}
+
+static NRT_BOOL countCompletion(void *arg, nrt_IORequest * request,
+                                nrt_Error * error)
+{
+    (void) request;
+    (void) error;
+    *((int *) arg) += 1;
+    return NRT_SUCCESS;
+}
+
+static NRT_BOOL stopOnSecond(void *arg, nrt_IORequest * request,
+                             nrt_Error * error)
+{
+    (void) request;
+    if (++*((int *) arg) < 2)
+        return NRT_SUCCESS;
+    nrt_Error_init(error, "stopped", NRT_CTXT, NRT_ERR_UNK);
+    return NRT_FAILURE;
+}
+
+/*
+ *  Read TEST_REQUESTS scattered requests, each split over two buffers,
+ *  and check every byte
+ */
+static void readAndCheck(const char *testName, nrt_IOInterface * io)
+{
+    nrt_Error e;
+    static char buf[TEST_REQUESTS][TEST_REQUEST_SIZE];
+    nrt_IOVec vec[TEST_REQUESTS][2];
+    nrt_IORequest requests[TEST_REQUESTS];
+    int completed = 0;
+    int i, j;
+
+    memset(buf, 0, sizeof(buf));
+    for (i = 0; i < TEST_REQUESTS; i++)
+    {
+        /* Backwards through the file so completion order is not offset order */
+        requests[i].offset = (TEST_REQUESTS - 1 - i) * (TEST_REQUEST_SIZE + 300)
+            + 17;
+        vec[i][0].buf = buf[i];
+        vec[i][0].size = 300;
+        vec[i][1].buf = buf[i] + 300;
+        vec[i][1].size = TEST_REQUEST_SIZE - 300;
+        requests[i].vec = vec[i];
+        requests[i].count = 2;
+        requests[i].user = NULL;
+    }
+
+    TEST_ASSERT(nrt_IOInterface_readBatch(io, requests, TEST_REQUESTS,
+                                          countCompletion, &completed, &e));
+    TEST_ASSERT_EQ_INT(TEST_REQUESTS, completed);
+
+    for (i = 0; i < TEST_REQUESTS; i++)
+        for (j = 0; j < TEST_REQUEST_SIZE; j++)
+            TEST_ASSERT_EQ_INT(expected((int) requests[i].offset + j),
+                               (unsigned char) buf[i][j]);
+
+    /* A completion can stop the batch */
+    completed = 0;
+    TEST_ASSERT(!nrt_IOInterface_readBatch(io, requests, TEST_REQUESTS,
+                                           stopOnSecond, &completed, &e));
+    TEST_ASSERT_EQ_INT(2, completed);
+
+    /* Reading past the end fails */
+    requests[0].offset = TEST_FILE_SIZE - 10;
+    TEST_ASSERT(!nrt_IOInterface_readBatch(io, requests, 1, NULL, NULL, &e));
+}
+
+TEST_CASE(testRing)
+{
+    nrt_Error e;
+    nrt_IOInterface *io;
+    nrt_IOHandle handle;
+
+    writeTestFile(testName);
+    handle = nrt_IOHandle_create(TEST_FILE_NAME, NRT_ACCESS_READONLY,
+                                 NRT_OPEN_EXISTING, &e);
+    TEST_ASSERT(!NRT_INVALID_HANDLE(handle));
+
+    /* Falls back to the thread pool where io_uring is not available */
+    io = nrt_AsyncIOAdapter_construct(handle, NRT_ACCESS_READONLY, 8,
+                                      NRT_SUCCESS, &e);
+    TEST_ASSERT(io);
+    TEST_ASSERT(nrt_IOInterface_canReadBatch(io));
+    readAndCheck(testName, io);
+
+    nrt_IOInterface_close(io, &e);
+    nrt_IOInterface_destruct(&io);
+    TEST_ASSERT_NULL(io);
+}
+
+TEST_CASE(testThreadPool)
+{
+    nrt_Error e;
+    nrt_IOInterface *io;
+    nrt_IOHandle handle;
+
+    writeTestFile(testName);
+    handle = nrt_IOHandle_create(TEST_FILE_NAME, NRT_ACCESS_READONLY,
+                                 NRT_OPEN_EXISTING, &e);
+    TEST_ASSERT(!NRT_INVALID_HANDLE(handle));
+
+    io = nrt_AsyncIOAdapter_construct(handle, NRT_ACCESS_READONLY, 4,
+                                      NRT_FAILURE, &e);
+    TEST_ASSERT(io);
+    TEST_ASSERT(!nrt_AsyncIOAdapter_usesRing(io));
+    readAndCheck(testName, io);
+
+    nrt_IOInterface_close(io, &e);
+    nrt_IOInterface_destruct(&io);
+    TEST_ASSERT_NULL(io);
+}
+
+TEST_CASE(testSequentialFallback)
+{
+    nrt_Error e;
+    nrt_IOInterface *io;
+
+    writeTestFile(testName);
+    io = nrt_IOHandleAdapter_open(TEST_FILE_NAME, NRT_ACCESS_READONLY,
+                                  NRT_OPEN_EXISTING, &e);
+    TEST_ASSERT(io);
+    TEST_ASSERT(!nrt_IOInterface_canReadBatch(io));
+    TEST_ASSERT(!nrt_AsyncIOAdapter_usesRing(io));
+    readAndCheck(testName, io);
+
+    nrt_IOInterface_close(io, &e);
+    nrt_IOInterface_destruct(&io);
+    TEST_ASSERT_NULL(io);
+}
+
+int main(int argc, char **argv)
+{
+    CHECK(testRing);
+    CHECK(testThreadPool);
+    CHECK(testSequentialFallback);
+    remove(TEST_FILE_NAME);
+    return 0;
+}
@@ -0,0 +1,85 @@
+/* =========================================================================
+ * This file is part of NITRO
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2010, General Dynamics - Advanced Information Systems
+ *
+ * NITRO is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <import/nrt.h>
+#include "Test.h"
+
+TEST_CASE(testGrowable)
+{
+    nrt_Error e;
+    nrt_IOInterface *io;
+    char data[1000];
+    char buf[1000];
+    int i;
+
+    for (i = 0; i < 1000; i++)
+        data[i] = (char) (i * 7);
+
+    io = nrt_BufferAdapter_construct(NULL, 0, NRT_FALSE, &e);
+    TEST_ASSERT(io);
+
+    /* Many small writes, then one larger than the buffer so far */
+    for (i = 0; i < 100; i++)
+        TEST_ASSERT(nrt_IOInterface_write(io, data + i, 1, &e));
+    TEST_ASSERT(nrt_IOInterface_write(io, data + 100, 900, &e));
+    TEST_ASSERT_EQ_INT(1000, (int) nrt_IOInterface_getSize(io, &e));
+    TEST_ASSERT(nrt_IOInterface_readAt(io, 0, buf, 1000, &e));
+    TEST_ASSERT(memcmp(buf, data, 1000) == 0);
+
+    /* Nothing can be read past what was written */
+    TEST_ASSERT(!nrt_IOInterface_readAt(io, 500, buf, 501, &e));
+
+    /* A write past the end leaves a gap of zeros */
+    TEST_ASSERT(NRT_IO_SUCCESS(nrt_IOInterface_seek(io, 100, NRT_SEEK_END,
+                                                    &e)));
+    TEST_ASSERT(nrt_IOInterface_write(io, data, 10, &e));
+    TEST_ASSERT_EQ_INT(1110, (int) nrt_IOInterface_getSize(io, &e));
+    TEST_ASSERT(nrt_IOInterface_readAt(io, 1000, buf, 110, &e));
+    for (i = 0; i < 100; i++)
+        TEST_ASSERT(buf[i] == 0);
+    TEST_ASSERT(memcmp(buf + 100, data, 10) == 0);
+
+    nrt_IOInterface_destruct(&io);
+    TEST_ASSERT_NULL(io);
+}
+
+TEST_CASE(testFixed)
+{
+    nrt_Error e;
+    nrt_IOInterface *io;
+    char buf[10];
+
+    /* A buffer given to the adapter does not grow */
+    io = nrt_BufferAdapter_construct(buf, sizeof(buf), NRT_FALSE, &e);
+    TEST_ASSERT(io);
+    TEST_ASSERT_EQ_INT(10, (int) nrt_IOInterface_getSize(io, &e));
+    TEST_ASSERT(nrt_IOInterface_write(io, "0123456789", 10, &e));
+    TEST_ASSERT(!nrt_IOInterface_write(io, "a", 1, &e));
+    nrt_IOInterface_destruct(&io);
+}
+
+int main(int argc, char **argv)
+{
+    CHECK(testGrowable);
+    CHECK(testFixed);
+    return 0;
+}
@@ -0,0 +1,122 @@
+/* =========================================================================
+ * This file is part of NITRO
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2010, General Dynamics - Advanced Information Systems
+ *
+ * NITRO is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <import/nrt.h>
+#include "Test.h"
+
+#define TEST_FILE_NAME "test_write_behind.tmp"
+#define TEST_FILE_SIZE 50000
+#define TEST_BUFFER_SIZE 1000
+
+static char expected[TEST_FILE_SIZE];
+
+/*
+ *  Write the file through the adapter: sequential runs of several sizes,
+ *  some larger than a buffer, then overwrite parts of it out of order
+ */
+static void writeThrough(const char *testName, nrt_IOInterface * io)
+{
+    nrt_Error e;
+    char data[3000];
+    nrt_Off offset = 0;
+    int size = 1;
+    int i;
+
+    while (offset < TEST_FILE_SIZE)
+    {
+        if (offset + size > TEST_FILE_SIZE)
+            size = (int) (TEST_FILE_SIZE - offset);
+        for (i = 0; i < size; i++)
+            data[i] = expected[offset + i] = (char) ((offset + i) * 13);
+        TEST_ASSERT(nrt_IOInterface_write(io, data, size, &e));
+        offset += size;
+        TEST_ASSERT_EQ_INT((int) offset, (int) nrt_IOInterface_tell(io, &e));
+        size = (size * 7) % 2999 + 1;
+    }
+
+    for (offset = TEST_FILE_SIZE - 700; offset > 0; offset -= 4100)
+    {
+        for (i = 0; i < 500; i++)
+            data[i] = expected[offset + i] = (char) i;
+        TEST_ASSERT(NRT_IO_SUCCESS(nrt_IOInterface_seek(io, offset,
+                                                        NRT_SEEK_SET, &e)));
+        TEST_ASSERT(nrt_IOInterface_write(io, data, 500, &e));
+        TEST_ASSERT(nrt_IOInterface_writeAt(io, offset + 600, data, 100, &e));
+        memcpy(expected + offset + 600, data, 100);
+    }
+}
+
+TEST_CASE(testWriteBehind)
+{
+    nrt_Error e;
+    nrt_IOInterface *file;
+    nrt_IOInterface *io;
+    static char buf[TEST_FILE_SIZE];
+
+    file = nrt_IOHandleAdapter_open(TEST_FILE_NAME, NRT_ACCESS_READWRITE,
+                                    NRT_CREATE, &e);
+    TEST_ASSERT(file);
+
+    io = nrt_WriteBehindAdapter_construct(file, TEST_BUFFER_SIZE, &e);
+    TEST_ASSERT(io);
+    TEST_ASSERT(nrt_IOInterface_canWriteAt(io));
+    writeThrough(testName, io);
+
+    /* The size includes the buffered writes */
+    TEST_ASSERT_EQ_INT(TEST_FILE_SIZE, (int) nrt_IOInterface_getSize(io, &e));
+
+    /* The wrapped interface is left where the adapter is */
+    TEST_ASSERT(NRT_IO_SUCCESS(nrt_IOInterface_seek(io, 1234, NRT_SEEK_SET,
+                                                    &e)));
+    TEST_ASSERT(nrt_WriteBehindAdapter_flush(io, &e));
+    TEST_ASSERT_EQ_INT(1234, (int) nrt_IOInterface_tell(file, &e));
+
+    nrt_IOInterface_destruct(&io);
+    TEST_ASSERT_NULL(io);
+
+    TEST_ASSERT(nrt_IOInterface_readAt(file, 0, buf, TEST_FILE_SIZE, &e));
+    TEST_ASSERT(memcmp(buf, expected, TEST_FILE_SIZE) == 0);
+
+    nrt_IOInterface_close(file, &e);
+    nrt_IOInterface_destruct(&file);
+}
+
+TEST_CASE(testFlushOther)
+{
+    nrt_Error e;
+    nrt_IOInterface *io;
+    char buf[10];
+
+    /* Flushing an interface that is not an adapter does nothing */
+    io = nrt_BufferAdapter_construct(buf, sizeof(buf), NRT_FAILURE, &e);
+    TEST_ASSERT(io);
+    TEST_ASSERT(nrt_WriteBehindAdapter_flush(io, &e));
+    nrt_IOInterface_destruct(&io);
+}
+
+int main(int argc, char **argv)
+{
+    CHECK(testWriteBehind);
+    CHECK(testFlushOther);
+    remove(TEST_FILE_NAME);
+    return 0;
+}